@@ -8,10 +8,9 @@ namespace DuiLib
 
 	CGifAnimUI::CGifAnimUI(void)
 	{
-		m_pGifImage			=	NULL;
-		m_pPropertyItem		=	NULL;
-		m_nFrameCount		=	0;	
+		m_pGif				=	NULL;
 		m_nFramePosition	=	0;	
+		m_dwFrameDue		=	0;
 		m_bIsAutoPlay		=	true;
 		m_bIsAutoSize		=	false;
 		m_bIsPlaying		=	false;
@@ -21,9 +20,8 @@ namespace DuiLib
 
 	CGifAnimUI::~CGifAnimUI(void)
 	{
+		if( m_pManager != NULL ) m_pManager->KillAnimationTimer( this );
 		DeleteGif();
-		m_pManager->KillTimer( this, EVENT_TIEM_ID );
-
 	}
 
 	LPCTSTR CGifAnimUI::GetClass() const
@@ -45,7 +43,7 @@ namespace DuiLib
 	bool CGifAnimUI::DoPaint(HDC hDC, const RECT& rcPaint, CControlUI* pStopControl)
 	{
 		if( !::IntersectRect( &m_rcPaint, &rcPaint, &m_rcItem ) ) return true;
-		if ( NULL == m_pGifImage )
+		if ( NULL == m_pGif )
 		{		
 			InitGifImage();
 		}
@@ -56,7 +54,7 @@ namespace DuiLib
 	void CGifAnimUI::DoEvent( TEventUI& event )
 	{
 		if( event.Type == UIEVENT_TIMER )
-			OnTimer( (UINT_PTR)event.wParam );
+			OnTimer( (UINT_PTR)event.wParam, event.dwTimestamp );
 	}
 
 	void CGifAnimUI::SetVisible(bool bVisible /* = true */)
@@ -121,26 +119,26 @@ namespace DuiLib
 
 	void CGifAnimUI::PlayGif()
 	{
-		if (m_bIsPlaying || m_pGifImage == NULL || m_nFrameCount <= 1)
+		if (m_bIsPlaying || m_pGif == NULL || m_pGif->frames.GetFrameCount() <= 1 || m_pManager == NULL)
 		{
 			return;
 		}
 
-		long lPause = ((long*) m_pPropertyItem->value)[m_nFramePosition] * 10;
-		if ( lPause == 0 ) lPause = 100;
-		m_pManager->SetTimer( this, EVENT_TIEM_ID, lPause );
+		// 从当前帧开始完整显示一个帧间隔
+		m_dwFrameDue = ::GetTickCount() + m_pGif->frames.GetFrameDelay( m_nFramePosition );
+		if ( !m_pManager->SetAnimationTimer( this, m_dwFrameDue ) ) return;
 
 		m_bIsPlaying = true;
 	}
 
 	void CGifAnimUI::PauseGif()
 	{
-		if (!m_bIsPlaying || m_pGifImage == NULL)
+		if (!m_bIsPlaying || m_pGif == NULL)
 		{
 			return;
 		}
 
-		m_pManager->KillTimer(this, EVENT_TIEM_ID);
+		m_pManager->KillAnimationTimer(this);
 		this->Invalidate();
 		m_bIsPlaying = false;
 	}
@@ -152,7 +150,7 @@ namespace DuiLib
 			return;
 		}
 
-		m_pManager->KillTimer(this, EVENT_TIEM_ID);
+		m_pManager->KillAnimationTimer(this);
 		m_nFramePosition = 0;
 		this->Invalidate();
 		m_bIsPlaying = false;
@@ -160,26 +158,13 @@ namespace DuiLib
 
 	void CGifAnimUI::InitGifImage()
 	{
-		m_pGifImage = CRenderEngine::GdiplusLoadImage(GetBkImage());
-		if ( NULL == m_pGifImage ) return;
-		UINT nCount	= 0;
-		nCount	=	m_pGifImage->GetFrameDimensionsCount();
-		GUID* pDimensionIDs	=	new GUID[ nCount ];
-		m_pGifImage->GetFrameDimensionsList( pDimensionIDs, nCount );
-		m_nFrameCount	=	m_pGifImage->GetFrameCount( &pDimensionIDs[0] );
-		if (m_nFrameCount > 1)
-		{
-			int nSize = m_pGifImage->GetPropertyItemSize(PropertyTagFrameDelay);
-			m_pPropertyItem = (Gdiplus::PropertyItem*) malloc(nSize);
-			m_pGifImage->GetPropertyItem(PropertyTagFrameDelay, nSize, m_pPropertyItem);
-		}
-		delete[]  pDimensionIDs;
-		pDimensionIDs = NULL;
+		m_pGif = CPaintManagerUI::AcquireGif(GetBkImage());
+		if ( NULL == m_pGif ) return;
 
 		if (m_bIsAutoSize)
 		{
-			SetFixedWidth(m_pGifImage->GetWidth());
-			SetFixedHeight(m_pGifImage->GetHeight());
+			SetFixedWidth(m_pGif->nX);
+			SetFixedHeight(m_pGif->nY);
 		}
 		if (m_bIsAutoPlay)
 		{
@@ -189,41 +174,31 @@ namespace DuiLib
 
 	void CGifAnimUI::DeleteGif()
 	{
-		if ( m_pGifImage != NULL )
+		if ( m_pGif != NULL )
 		{
-			delete m_pGifImage;
-			m_pGifImage = NULL;
+			CPaintManagerUI::ReleaseGif( m_pGif );
+			m_pGif = NULL;
 		}
-
-		if ( m_pPropertyItem != NULL )
-		{
-			free( m_pPropertyItem );
-			m_pPropertyItem = NULL;
-		}
-		m_nFrameCount		=	0;	
 		m_nFramePosition	=	0;	
 	}
 
-	void CGifAnimUI::OnTimer( UINT_PTR idEvent )
+	void CGifAnimUI::OnTimer( UINT_PTR idEvent, DWORD dwTime )
 	{
-		if ( idEvent != EVENT_TIEM_ID )
+		if ( idEvent != ANIMATION_TIMERID || !m_bIsPlaying || m_pGif == NULL )
 			return;
-		m_pManager->KillTimer( this, EVENT_TIEM_ID );
 		this->Invalidate();
 
-		m_nFramePosition = (++m_nFramePosition) % m_nFrameCount;
-
-		long lPause = ((long*) m_pPropertyItem->value)[m_nFramePosition] * 10;
-		if ( lPause == 0 ) lPause = 100;
-		m_pManager->SetTimer( this, EVENT_TIEM_ID, lPause );
+		// 按累计的到期时间换帧，定时器晚到时跳过已经过期的帧；dwTime 是这一帧的时间，同一帧的动画一致
+		m_dwFrameDue = m_pGif->frames.Advance( m_nFramePosition, m_dwFrameDue, dwTime );
+		m_pManager->SetAnimationTimer( this, m_dwFrameDue );
 	}
 
 	void CGifAnimUI::DrawFrame( HDC hDC )
 	{
-		if ( NULL == hDC || NULL == m_pGifImage ) return;
-		GUID pageGuid = Gdiplus::FrameDimensionTime;
-		Gdiplus::Graphics graphics( hDC );
-		graphics.DrawImage( m_pGifImage, m_rcItem.left, m_rcItem.top, m_rcItem.right-m_rcItem.left, m_rcItem.bottom-m_rcItem.top );
-		m_pGifImage->SelectActiveFrame( &pageGuid, m_nFramePosition );
+		if ( NULL == hDC || NULL == m_pGif ) return;
+		// 各帧在位图中从上到下排列
+		RECT rcBmpPart = { 0, m_nFramePosition * m_pGif->nY, m_pGif->nX, (m_nFramePosition + 1) * m_pGif->nY };
+		RECT rcCorners = { 0 };
+		CRenderEngine::DrawImage( hDC, m_pGif->hBitmap, m_rcItem, m_rcPaint, rcBmpPart, rcCorners, m_pGif->bAlpha );
 	}
 }
@@ -5,12 +5,9 @@
 
 namespace DuiLib
 {
+	// 帧在 CPaintManagerUI::AcquireGif 中解码一次并在各控件间共享，换帧由窗口的定时器调度驱动
 	class UILIB_API CGifAnimUI : public CControlUI
 	{
-		enum
-		{ 
-			EVENT_TIEM_ID = 100,
-		};
 		DECLARE_DUICONTROL(CGifAnimUI)
 	public:
 		CGifAnimUI(void);
@@ -37,14 +34,13 @@ namespace DuiLib
 	private:
 		void	InitGifImage();
 		void	DeleteGif();
-		void    OnTimer( UINT_PTR idEvent );
+		void    OnTimer( UINT_PTR idEvent, DWORD dwTime );
 		void	DrawFrame( HDC hDC );		// 绘制GIF每帧
 
 	private:
-		Gdiplus::Image	*m_pGifImage;
-		UINT			m_nFrameCount;				// gif图片总帧数
-		UINT			m_nFramePosition;			// 当前放到第几帧
-		Gdiplus::PropertyItem*	m_pPropertyItem;	// 帧与帧之间间隔时间
+		const TGifInfo*	m_pGif;
+		int				m_nFramePosition;			// 当前放到第几帧
+		DWORD			m_dwFrameDue;				// 当前帧显示到什么时候
 
 		CDuiString		m_sBkImage;
 		bool			m_bIsAutoPlay;				// 是否自动播放gif
@@ -7,7 +7,8 @@ namespace DuiLib {
 	//
 	IMPLEMENT_DUICONTROL(CListUI)
 
-	CListUI::CListUI() : m_pCallback(NULL), m_bScrollSelect(false), m_iCurSel(-1), m_iExpandedItem(-1), m_bMultiSel(false)
+	CListUI::CListUI() : m_pCallback(NULL), m_bScrollSelect(false), m_iCurSel(-1), m_iExpandedItem(-1), m_bMultiSel(false),
+		m_pDataSource(NULL), m_cyVirtualItem(24), m_bVirtualEstimated(true), m_bBinding(false)
 	{
 		m_bFixedScrollbar = false;
 		m_pList = new CListBodyUI(this);
@@ -58,6 +59,8 @@ namespace DuiLib {
 
 	CControlUI* CListUI::GetItemAt(int iIndex) const
 	{
+		// 虚拟列表只有显示中的行才有列表项
+		if( m_pDataSource != NULL ) return m_pList->GetItemAt(m_VirtualLayout.FindSlot(iIndex));
 		return m_pList->GetItemAt(iIndex);
 	}
 
@@ -67,6 +70,10 @@ namespace DuiLib {
 		// We also need to recognize header sub-items
 		if( _tcsstr(pControl->GetClass(), _T("ListHeaderItemUI")) != NULL ) return m_pHeader->GetItemIndex(pControl);
 
+		if( m_pDataSource != NULL ) {
+			int iSlot = m_pList->GetItemIndex(pControl);
+			return iSlot < 0 ? -1 : m_VirtualLayout.GetSlotRow(iSlot);
+		}
 		return m_pList->GetItemIndex(pControl);
 	}
 
@@ -75,6 +82,7 @@ namespace DuiLib {
 		if( pControl->GetInterface(_T("ListHeader")) != NULL ) return CVerticalLayoutUI::SetItemIndex(pControl, iIndex);
 		// We also need to recognize header sub-items
 		if( _tcsstr(pControl->GetClass(), _T("ListHeaderItemUI")) != NULL ) return m_pHeader->SetItemIndex(pControl, iIndex);
+		if( m_pDataSource != NULL ) return false;
 
 		int iOrginIndex = m_pList->GetItemIndex(pControl);
 		if( iOrginIndex == -1 ) return false;
@@ -99,6 +107,7 @@ namespace DuiLib {
 
 	int CListUI::GetCount() const
 	{
+		if( m_pDataSource != NULL ) return m_VirtualLayout.GetCount();
 		return m_pList->GetCount();
 	}
 
@@ -124,6 +133,7 @@ namespace DuiLib {
 		// The list items should know about us
 		IListItemUI* pListItem = static_cast<IListItemUI*>(pControl->GetInterface(_T("ListItem")));
 		if( pListItem != NULL ) {
+			if( m_pDataSource != NULL ) return false;
 			pListItem->SetOwner(this);
 			pListItem->SetIndex(GetCount());
 			return m_pList->Add(pControl);
@@ -150,6 +160,7 @@ namespace DuiLib {
 			m_ListInfo.nColumns = MIN(m_pHeader->GetCount(), UILIST_MAX_COLUMNS);
 			return ret;
 		}
+		if( m_pDataSource != NULL ) return false;
 		if (!m_pList->AddAt(pControl, iIndex)) return false;
 
 		// The list items should know about us
@@ -175,6 +186,7 @@ namespace DuiLib {
 		if( pControl->GetInterface(_T("ListHeader")) != NULL ) return CVerticalLayoutUI::Remove(pControl);
 		// We also need to recognize header sub-items
 		if( _tcsstr(pControl->GetClass(), _T("ListHeaderItemUI")) != NULL ) return m_pHeader->Remove(pControl);
+		if( m_pDataSource != NULL ) return false;
 
 		int iIndex = m_pList->GetItemIndex(pControl);
 		if (iIndex == -1) return false;
@@ -200,6 +212,7 @@ namespace DuiLib {
 
 	bool CListUI::RemoveAt(int iIndex)
 	{
+		if( m_pDataSource != NULL ) return false;
 		if (!m_pList->RemoveAt(iIndex)) return false;
 
 		for(int i = iIndex; i < m_pList->GetCount(); ++i) {
@@ -223,6 +236,7 @@ namespace DuiLib {
 		m_iExpandedItem = -1;
 		m_aSelItems.Empty();
 		m_pList->RemoveAll();
+		m_VirtualLayout.ReleaseSlots();
 	}
 
 	void CListUI::SetPos(RECT rc, bool bNeedInvalidate)
@@ -329,7 +343,7 @@ namespace DuiLib {
 					if (m_aSelItems.GetSize() > 0) {					
 						int index = GetMaxSelItemIndex() + 1;
 						UnSelectAllItems();
-						index + 1 > m_pList->GetCount() ? SelectItem(GetCount() - 1, true) : SelectItem(index, true);					
+						index + 1 > GetCount() ? SelectItem(GetCount() - 1, true) : SelectItem(index, true);					
 					}
 				}
 				return;
@@ -346,7 +360,7 @@ namespace DuiLib {
 				SelectItem(FindSelectable(GetCount() - 1, true), true);
 				return;
 			case VK_RETURN:
-				if( m_iCurSel != -1 ) GetItemAt(m_iCurSel)->Activate();
+				if( m_iCurSel != -1 && GetItemAt(m_iCurSel) != NULL ) GetItemAt(m_iCurSel)->Activate();
 				return;
 			case 0x41:// Ctrl+A
 				{
@@ -435,10 +449,22 @@ namespace DuiLib {
 
 	bool CListUI::SelectItem(int iIndex, bool bTakeFocus)
 	{
+		if( m_bBinding ) return false;
 		// 取消所有选择项
 		UnSelectAllItems();
 		// 判断是否合法列表项
 		if( iIndex < 0 ) return false;
+		// 虚拟列表只记录选中的行，显示中的列表项同步选中状态
+		if( m_pDataSource != NULL ) {
+			if( iIndex >= GetCount() ) return false;
+			m_iCurSel = iIndex;
+			m_aSelItems.Add((LPVOID)iIndex);
+			SetVirtualItemSelected(iIndex, true);
+			EnsureVisible(iIndex);
+			if( bTakeFocus ) SetFocus();
+			if( m_pManager != NULL ) m_pManager->SendNotify(this, DUI_MSGTYPE_ITEMSELECT, iIndex);
+			return true;
+		}
 		CControlUI* pControl = GetItemAt(iIndex);
 		if( pControl == NULL ) return false;
 		IListItemUI* pListItem = static_cast<IListItemUI*>(pControl->GetInterface(_T("ListItem")));
@@ -460,9 +486,21 @@ namespace DuiLib {
 	
 	bool CListUI::SelectMultiItem(int iIndex, bool bTakeFocus)
 	{
+		if( m_bBinding ) return false;
 		if(!IsMultiSelect()) return SelectItem(iIndex, bTakeFocus);
 
 		if( iIndex < 0 ) return false;
+		if( m_pDataSource != NULL ) {
+			if( iIndex >= GetCount() ) return false;
+			if(m_aSelItems.Find((LPVOID)iIndex) >= 0) return false;
+			m_iCurSel = iIndex;
+			m_aSelItems.Add((LPVOID)iIndex);
+			SetVirtualItemSelected(iIndex, true);
+			EnsureVisible(iIndex);
+			if( bTakeFocus ) SetFocus();
+			if( m_pManager != NULL ) m_pManager->SendNotify(this, DUI_MSGTYPE_ITEMSELECT, iIndex);
+			return true;
+		}
 		CControlUI* pControl = GetItemAt(iIndex);
 		if( pControl == NULL ) return false;
 		IListItemUI* pListItem = static_cast<IListItemUI*>(pControl->GetInterface(_T("ListItem")));
@@ -493,7 +531,25 @@ namespace DuiLib {
 
 	bool CListUI::UnSelectItem(int iIndex, bool bOthers)
 	{
+		if( m_bBinding ) return false;
 		if(!IsMultiSelect()) return false;
+		if( m_pDataSource != NULL ) {
+			if(bOthers) {
+				for (int i = m_aSelItems.GetSize() - 1; i >= 0; --i) {
+					int iSelIndex = (int)m_aSelItems.GetAt(i);
+					if(iSelIndex == iIndex) continue;
+					SetVirtualItemSelected(iSelIndex, false);
+					m_aSelItems.Remove(i);
+				}
+				return true;
+			}
+			int aIndex = m_aSelItems.Find((LPVOID)iIndex);
+			if (aIndex < 0) return false;
+			SetVirtualItemSelected(iIndex, false);
+			if(m_iCurSel == iIndex) m_iCurSel = -1;
+			m_aSelItems.Remove(aIndex);
+			return true;
+		}
 		if(bOthers) {
 			for (int i = m_aSelItems.GetSize() - 1; i >= 0; --i) {
 				int iSelIndex = (int)m_aSelItems.GetAt(i);
@@ -525,6 +581,16 @@ namespace DuiLib {
 
 	void CListUI::SelectAllItems()
 	{
+		if( m_pDataSource != NULL ) {
+			m_aSelItems.Empty();
+			for (int i = 0; i < GetCount(); ++i) m_aSelItems.Add((LPVOID)i);
+			m_iCurSel = GetCount() - 1;
+			for (int i = 0; i < m_VirtualLayout.GetSlotCount(); ++i) {
+				int iRow = m_VirtualLayout.GetSlotRow(i);
+				if( iRow >= 0 ) SetVirtualItemSelected(iRow, true);
+			}
+			return;
+		}
 		for (int i = 0; i < GetCount(); ++i) {
 			CControlUI* pControl = GetItemAt(i);
 			if(pControl == NULL) continue;
@@ -856,7 +922,6 @@ namespace DuiLib {
 	void CListUI::EnsureVisible(int iIndex)
 	{
 		if( m_iCurSel < 0 ) return;
-		RECT rcItem = m_pList->GetItemAt(iIndex)->GetPos();
 		RECT rcList = m_pList->GetPos();
 		RECT rcListInset = m_pList->GetInset();
 
@@ -868,6 +933,14 @@ namespace DuiLib {
 		CScrollBarUI* pHorizontalScrollBar = m_pList->GetHorizontalScrollBar();
 		if( pHorizontalScrollBar && pHorizontalScrollBar->IsVisible() ) rcList.bottom -= pHorizontalScrollBar->GetFixedHeight();
 
+		// 虚拟列表的行不一定有列表项，按行的位置计算
+		if( m_pDataSource != NULL ) {
+			int iPos = m_pList->GetScrollPos().cy;
+			Scroll(0, m_VirtualLayout.GetScrollPosToShow(iIndex, iPos, rcList.bottom - rcList.top) - iPos);
+			return;
+		}
+
+		RECT rcItem = m_pList->GetItemAt(iIndex)->GetPos();
 		int iPos = m_pList->GetScrollPos().cy;
 		if( rcItem.top >= rcList.top && rcItem.bottom < rcList.bottom ) return;
 		int dx = 0;
@@ -883,6 +956,130 @@ namespace DuiLib {
 		m_pList->SetScrollPos(CDuiSize(sz.cx + dx, sz.cy + dy));
 	}
 
+	int CListUI::FindSelectable(int iIndex, bool bForward) const
+	{
+		// 虚拟列表的行没有对应的列表项可以检查，每一行都可以选择
+		if( m_pDataSource != NULL ) {
+			if( GetCount() == 0 ) return -1;
+			return CLAMP(iIndex, 0, GetCount() - 1);
+		}
+		return CVerticalLayoutUI::FindSelectable(iIndex, bForward);
+	}
+
+	void CListUI::SetDataSource(IListDataSourceUI* pDataSource)
+	{
+		if( m_pDataSource == pDataSource ) return;
+		// 切换数据源时原有的列表项全部删除
+		RemoveAll();
+		m_pDataSource = pDataSource;
+		m_VirtualLayout.Reset(m_pDataSource != NULL ? m_pDataSource->GetItemCount(this) : 0);
+		NeedUpdate();
+	}
+
+	IListDataSourceUI* CListUI::GetDataSource() const
+	{
+		return m_pDataSource;
+	}
+
+	bool CListUI::IsVirtual() const
+	{
+		return m_pDataSource != NULL;
+	}
+
+	void CListUI::SetVirtualItemHeight(int cy, bool bEstimated)
+	{
+		if( cy < 0 ) cy = 0;
+		if( m_cyVirtualItem == cy && m_bVirtualEstimated == bEstimated ) return;
+		m_cyVirtualItem = cy;
+		m_bVirtualEstimated = bEstimated;
+		if( m_pDataSource != NULL ) NeedUpdate();
+	}
+
+	int CListUI::GetVirtualItemHeight() const
+	{
+		return m_cyVirtualItem;
+	}
+
+	void CListUI::NotifyDataSetChanged()
+	{
+		if( m_pDataSource == NULL ) return;
+		UnSelectAllItems();
+		m_iExpandedItem = -1;
+		m_VirtualLayout.Reset(m_pDataSource->GetItemCount(this));
+		m_pList->NeedUpdate();
+	}
+
+	void CListUI::NotifyItemChanged(int iIndex)
+	{
+		if( m_pDataSource == NULL ) return;
+		CControlUI* pControl = GetItemAt(iIndex);
+		if( pControl == NULL ) return;
+		BindVirtualItem(pControl, iIndex);
+		// 行高可能变化，重新布局时测量
+		if( m_VirtualLayout.IsEstimated() ) m_pList->NeedUpdate();
+		else pControl->Invalidate();
+	}
+
+	void CListUI::NotifyItemsInserted(int iIndex, int nCount)
+	{
+		if( m_pDataSource == NULL || nCount <= 0 ) return;
+		iIndex = CLAMP(iIndex, 0, GetCount());
+		m_VirtualLayout.InsertRows(iIndex, nCount);
+		for (int i = 0; i < m_aSelItems.GetSize(); ++i) {
+			int iSelIndex = (int)m_aSelItems.GetAt(i);
+			if( iSelIndex >= iIndex ) m_aSelItems.SetAt(i, (LPVOID)(iSelIndex + nCount));
+		}
+		if( m_iCurSel >= iIndex ) m_iCurSel += nCount;
+		if( m_iExpandedItem >= iIndex ) m_iExpandedItem += nCount;
+		m_pList->NeedUpdate();
+	}
+
+	void CListUI::NotifyItemsRemoved(int iIndex, int nCount)
+	{
+		if( m_pDataSource == NULL || iIndex < 0 || iIndex >= GetCount() || nCount <= 0 ) return;
+		if( nCount > GetCount() - iIndex ) nCount = GetCount() - iIndex;
+		m_VirtualLayout.RemoveRows(iIndex, nCount);
+		for (int i = m_aSelItems.GetSize() - 1; i >= 0; --i) {
+			int iSelIndex = (int)m_aSelItems.GetAt(i);
+			if( iSelIndex >= iIndex + nCount ) m_aSelItems.SetAt(i, (LPVOID)(iSelIndex - nCount));
+			else if( iSelIndex >= iIndex ) m_aSelItems.Remove(i);
+		}
+		if( m_iCurSel >= iIndex + nCount ) m_iCurSel -= nCount;
+		else if( m_iCurSel >= iIndex ) m_iCurSel = -1;
+		if( m_iExpandedItem >= iIndex + nCount ) m_iExpandedItem -= nCount;
+		else if( m_iExpandedItem >= iIndex ) m_iExpandedItem = -1;
+		m_pList->NeedUpdate();
+	}
+
+	CVirtualListLayout* CListUI::GetVirtualLayout()
+	{
+		return &m_VirtualLayout;
+	}
+
+	void CListUI::SetVirtualItemSelected(int iIndex, bool bSelect)
+	{
+		CControlUI* pControl = GetItemAt(iIndex);
+		if( pControl == NULL ) return;
+		IListItemUI* pListItem = static_cast<IListItemUI*>(pControl->GetInterface(_T("ListItem")));
+		if( pListItem == NULL ) return;
+		m_bBinding = true;
+		pListItem->SelectMulti(bSelect);
+		m_bBinding = false;
+	}
+
+	void CListUI::BindVirtualItem(CControlUI* pControl, int iIndex)
+	{
+		if( pControl == NULL || iIndex < 0 ) return;
+		m_bBinding = true;
+		IListItemUI* pListItem = static_cast<IListItemUI*>(pControl->GetInterface(_T("ListItem")));
+		if( pListItem != NULL ) {
+			pListItem->SetIndex(iIndex);
+			pListItem->SelectMulti(m_aSelItems.Find((LPVOID)iIndex) >= 0);
+		}
+		m_pDataSource->BindItem(this, pControl, iIndex);
+		m_bBinding = false;
+	}
+
 	void CListUI::SetAttribute(LPCTSTR pstrName, LPCTSTR pstrValue)
 	{
 		if( _tcsicmp(pstrName, _T("header")) == 0 ) GetHeader()->SetVisible(_tcsicmp(pstrValue, _T("hidden")) != 0);
@@ -996,6 +1193,8 @@ namespace DuiLib {
 		else if( _tcsicmp(pstrName, _T("itemshowhtml")) == 0 ) SetItemShowHtml(_tcsicmp(pstrValue, _T("true")) == 0);
 		else if ( _tcscmp(pstrName, _T("multiselect")) == 0 ) SetMultiSelect(_tcscmp(pstrValue, _T("true")) == 0);
 		else if ( _tcscmp(pstrName, _T("itemrselected")) == 0 ) SetItemRSelected(_tcscmp(pstrValue, _T("true")) == 0);
+		else if( _tcsicmp(pstrName, _T("virtualitemheight")) == 0 ) SetVirtualItemHeight(_ttoi(pstrValue), m_bVirtualEstimated);
+		else if( _tcsicmp(pstrName, _T("virtualitemestimated")) == 0 ) SetVirtualItemHeight(m_cyVirtualItem, _tcsicmp(pstrValue, _T("true")) == 0);
 		else CVerticalLayoutUI::SetAttribute(pstrName, pstrValue);
 	}
 
@@ -1103,6 +1302,9 @@ namespace DuiLib {
 	{
 		if (!m_pList)
 			return FALSE;
+		// 虚拟列表的顺序由数据源决定
+		if (m_pDataSource != NULL)
+			return FALSE;
 		return m_pList->SortItems(pfnCompare, dwData);	
 	}
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -1180,6 +1382,12 @@ namespace DuiLib {
 			cx = m_pHorizontalScrollBar->GetScrollPos() - iLastScrollPos;
 		}
 
+		// 虚拟列表按新的滚动位置重新分配列表项，表头也在 SetPos 里移到了新位置
+		if( m_pOwner != NULL && m_pOwner->IsVirtual() ) {
+			SetPos(m_rcItem);
+			cx = cy = 0;
+		}
+
 		RECT rcPos;
 		for( int it2 = 0; it2 < m_items.GetSize(); it2++ ) {
 			CControlUI* pControl = static_cast<CControlUI*>(m_items[it2]);
@@ -1244,6 +1452,11 @@ namespace DuiLib {
 		if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() ) 
 			szAvailable.cx += m_pHorizontalScrollBar->GetScrollRange();
 
+		if( m_pOwner->IsVirtual() ) {
+			SetVirtualPos(rc, szAvailable);
+			return;
+		}
+
 		int cxNeeded = 0;
 		int nAdjustables = 0;
 		int cyFixed = 0;
@@ -1385,6 +1598,114 @@ namespace DuiLib {
 		ProcessScrollBar(rc, cxNeeded, cyNeeded);
 	}
 
+	void CListBodyUI::SetVirtualPos(RECT rc, SIZE szAvailable)
+	{
+		CVirtualListLayout* pLayout = m_pOwner->GetVirtualLayout();
+		IListDataSourceUI* pDataSource = m_pOwner->GetDataSource();
+		int cyItem = m_pOwner->m_cyVirtualItem;
+		if( m_pManager != NULL ) cyItem = m_pManager->GetDPIObj()->Scale(cyItem);
+		pLayout->SetItemHeight(cyItem, m_pOwner->m_bVirtualEstimated);
+		pLayout->SetSpacing(GetChildPadding());
+
+		int cxNeeded = 0;
+		CListHeaderUI* pHeader = m_pOwner->GetHeader();
+		if( pHeader != NULL && pHeader->GetCount() > 0 ) {
+			cxNeeded = MAX(0, pHeader->EstimateSize(CDuiSize(rc.right - rc.left, rc.bottom - rc.top)).cx);
+			if ( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible())
+			{
+				int nOffset = m_pHorizontalScrollBar->GetScrollPos();
+				RECT rcHeader = pHeader->GetPos();
+				rcHeader.left = rc.left - nOffset;
+				pHeader->SetPos(rcHeader);
+			}
+		}
+
+		int iPosX = rc.left;
+		if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() ) {
+			iPosX -= m_pHorizontalScrollBar->GetScrollPos();
+		}
+		int iScrollPos = 0;
+		if( m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible() ) {
+			iScrollPos = m_pVerticalScrollBar->GetScrollPos();
+		}
+
+		// 只为视口内的行分配列表项。估计行高时新显示的行测量后可见范围会变，
+		// 重新分配到不再变化为止；视口上方的行高不会改变，不需要调整滚动位置
+		int iFirst = -1;
+		int iLast = -1;
+		for( int nPass = 0; nPass < 8; nPass++ ) {
+			pLayout->GetVisibleRange(iScrollPos, szAvailable.cy, iFirst, iLast);
+			pLayout->AssignSlots(iFirst, iLast, m_aRebind);
+			while( GetCount() < pLayout->GetSlotCount() ) {
+				CControlUI* pControl = pDataSource->CreateItem(m_pOwner);
+				if( pControl == NULL ) break;
+				IListItemUI* pListItem = static_cast<IListItemUI*>(pControl->GetInterface(_T("ListItem")));
+				if( pListItem != NULL ) pListItem->SetOwner(m_pOwner);
+				Add(pControl);
+			}
+			for( size_t i = 0; i < m_aRebind.size(); i++ ) {
+				m_pOwner->BindVirtualItem(GetItemAt(m_aRebind[i]), pLayout->GetSlotRow(m_aRebind[i]));
+			}
+			if( !pLayout->IsEstimated() ) break;
+
+			bool bChanged = false;
+			for( int it = 0; it < GetCount(); it++ ) {
+				int iRow = pLayout->GetSlotRow(it);
+				if( iRow < 0 ) continue;
+				CControlUI* pControl = static_cast<CControlUI*>(m_items[it]);
+				SIZE sz = pControl->EstimateSize(szAvailable);
+				// 没有固定高度的列表项保持估计的行高
+				if( sz.cy == 0 ) continue;
+				if( sz.cy < pControl->GetMinHeight() ) sz.cy = pControl->GetMinHeight();
+				if( sz.cy > pControl->GetMaxHeight() ) sz.cy = pControl->GetMaxHeight();
+				RECT rcPadding = pControl->GetPadding();
+				if( pLayout->SetRowHeight(iRow, sz.cy + rcPadding.top + rcPadding.bottom) ) bChanged = true;
+			}
+			if( !bChanged ) break;
+		}
+
+		for( int it = 0; it < GetCount(); it++ ) {
+			CControlUI* pControl = static_cast<CControlUI*>(m_items[it]);
+			int iRow = pLayout->GetSlotRow(it);
+			if( iRow < 0 ) {
+				// 空闲的列表项不参与绘制和鼠标测试
+				pControl->SetPos(CDuiRect());
+				continue;
+			}
+			RECT rcPadding = pControl->GetPadding();
+			int cx = MAX(cxNeeded, szAvailable.cx - rcPadding.left - rcPadding.right);
+			if( cx < pControl->GetMinWidth() ) cx = pControl->GetMinWidth();
+			if( cx > pControl->GetMaxWidth() ) cx = pControl->GetMaxWidth();
+			int iPosY = rc.top + pLayout->GetRowTop(iRow) - iScrollPos;
+			RECT rcCtrl = { iPosX + rcPadding.left, iPosY + rcPadding.top, iPosX + rcPadding.left + cx, iPosY + pLayout->GetRowHeight(iRow) - rcPadding.bottom };
+			pControl->SetPos(rcCtrl);
+		}
+		int cyNeeded = pLayout->GetTotalHeight();
+
+		if( m_pHorizontalScrollBar != NULL ) {
+			if( cxNeeded > rc.right - rc.left ) {
+				if( m_pHorizontalScrollBar->IsVisible() ) {
+					m_pHorizontalScrollBar->SetScrollRange(cxNeeded - (rc.right - rc.left));
+				}
+				else {
+					m_pHorizontalScrollBar->SetVisible(true);
+					m_pHorizontalScrollBar->SetScrollRange(cxNeeded - (rc.right - rc.left));
+					m_pHorizontalScrollBar->SetScrollPos(0);
+					rc.bottom -= m_pHorizontalScrollBar->GetFixedHeight();
+				}
+			}
+			else {
+				if( m_pHorizontalScrollBar->IsVisible() ) {
+					m_pHorizontalScrollBar->SetVisible(false);
+					m_pHorizontalScrollBar->SetScrollRange(0);
+					m_pHorizontalScrollBar->SetScrollPos(0);
+					rc.bottom += m_pHorizontalScrollBar->GetFixedHeight();
+				}
+			}
+		}
+		ProcessScrollBar(rc, cxNeeded, cyNeeded);
+	}
+
 	void CListBodyUI::DoEvent(TEventUI& event)
 	{
 		if( !IsMouseEnabled() && event.Type > UIEVENT__MOUSEBEGIN && event.Type < UIEVENT__MOUSEEND ) {
@@ -49,6 +49,17 @@ namespace DuiLib {
 		virtual LPCTSTR GetItemText(CControlUI* pList, int iItem, int iSubItem) = 0;
 	};
 
+	// 虚拟列表的数据源：列表只为能看到的行创建列表项，滚动时把列表项绑定到新的行
+	class IListDataSourceUI
+	{
+	public:
+		virtual int GetItemCount(CControlUI* pList) = 0;
+		// 创建的列表项由列表释放
+		virtual CControlUI* CreateItem(CControlUI* pList) = 0;
+		// 把第 iIndex 行的数据设置到 pItem 上
+		virtual void BindItem(CControlUI* pList, CControlUI* pItem, int iIndex) = 0;
+	};
+
 	class IListOwnerUI
 	{
 	public:
@@ -149,6 +160,20 @@ namespace DuiLib {
 
 		void EnsureVisible(int iIndex);
 		void Scroll(int dx, int dy);
+		int FindSelectable(int iIndex, bool bForward = true) const;
+
+		// 虚拟列表：设置数据源后列表项由数据源创建和绑定，不能再调用 Add/Remove 添加删除列表项
+		void SetDataSource(IListDataSourceUI* pDataSource);
+		IListDataSourceUI* GetDataSource() const;
+		bool IsVirtual() const;
+		// bEstimated 为 true 时 cy 只是估计值，列表项第一次显示时按 EstimateSize 测量实际高度
+		void SetVirtualItemHeight(int cy, bool bEstimated = false);
+		int GetVirtualItemHeight() const;
+		void NotifyDataSetChanged();
+		void NotifyItemChanged(int iIndex);
+		void NotifyItemsInserted(int iIndex, int nCount);
+		void NotifyItemsRemoved(int iIndex, int nCount);
+		CVirtualListLayout* GetVirtualLayout();
 
 		bool IsDelayedDestroy() const;
 		void SetDelayedDestroy(bool bDelayed);
@@ -234,6 +259,8 @@ namespace DuiLib {
 	protected:
 		int GetMinSelItemIndex();
 		int GetMaxSelItemIndex();
+		void SetVirtualItemSelected(int iIndex, bool bSelect);
+		void BindVirtualItem(CControlUI* pControl, int iIndex);
 
 	protected:
 		bool m_bFixedScrollbar;
@@ -247,7 +274,13 @@ namespace DuiLib {
 		CListBodyUI* m_pList;
 		CListHeaderUI* m_pHeader;
 		TListInfoUI m_ListInfo;
+		IListDataSourceUI* m_pDataSource;
+		int m_cyVirtualItem;
+		bool m_bVirtualEstimated;
+		CVirtualListLayout m_VirtualLayout;
+		bool m_bBinding;	// 绑定列表项时忽略列表项回调的选择操作
 
+		friend class CListBodyUI;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -265,12 +298,14 @@ namespace DuiLib {
 		void DoEvent(TEventUI& event);
 		BOOL SortItems(PULVCompareFunc pfnCompare, UINT_PTR dwData);
 	protected:
+		void SetVirtualPos(RECT rc, SIZE szAvailable);
 		static int __cdecl ItemComareFunc(void *pvlocale, const void *item1, const void *item2);
 		int __cdecl ItemComareFunc(const void *item1, const void *item2);
 	protected:
 		CListUI* m_pOwner;
 		PULVCompareFunc m_pCompareFunc;
 		UINT_PTR m_compareData;
+		std::vector<int> m_aRebind;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -786,6 +786,8 @@ namespace DuiLib
 	//************************************
 	bool CTreeViewUI::Add( CTreeNodeUI* pControl )
 	{
+		// 虚拟模式下节点由数据源按展开后的行创建
+		if (IsVirtual()) return false;
 		if (!pControl) return false;
 		if (NULL == static_cast<CTreeNodeUI*>(pControl->GetInterface(_T("TreeNode")))) return false;
 
@@ -821,6 +823,7 @@ namespace DuiLib
 	//************************************
 	long CTreeViewUI::AddAt( CTreeNodeUI* pControl, int iIndex )
 	{
+		if (IsVirtual()) return -1;
 		if (!pControl) return -1;
 		if (NULL == static_cast<CTreeNodeUI*>(pControl->GetInterface(_T("TreeNode")))) return -1;
 		pControl->OnNotify += MakeDelegate(this,&CTreeViewUI::OnDBClickItem);
@@ -882,6 +885,7 @@ namespace DuiLib
 	//************************************
 	bool CTreeViewUI::Remove( CTreeNodeUI* pControl )
 	{
+		if(IsVirtual()) return false;
 		if(pControl->GetCountChild() > 0) {
 			int nCount = pControl->GetCountChild();
 			for(int nIndex = nCount - 1; nIndex >= 0; nIndex--) {
@@ -903,6 +907,7 @@ namespace DuiLib
 	//************************************
 	bool CTreeViewUI::RemoveAt( int iIndex )
 	{
+		if(IsVirtual()) return false;
 		CTreeNodeUI* pItem = (CTreeNodeUI*)GetItemAt(iIndex);
 		if(pItem->GetCountChild())
 			Remove(pItem);
@@ -54,6 +54,16 @@ namespace DuiLib
 		INNER_REGISTER_DUICONTROL(CHotKeyUI);
 		INNER_REGISTER_DUICONTROL(CFadeButtonUI);
 		INNER_REGISTER_DUICONTROL(CRingUI);
+
+		m_aSkinClasses.resize(GetSkinClassCount(), NULL);
+		for( UINT nClass = SKIN_CLASS_FIRST_CONTROL; nClass < m_aSkinClasses.size(); nClass++ ) {
+			CDuiString strClassName = _T("C");
+			strClassName += GetSkinClassName(nClass);
+			strClassName += _T("UI");
+			strClassName.MakeLower();
+			MAP_DUI_CTRATECLASS::iterator iter = m_mapControl.find(strClassName);
+			if( iter != m_mapControl.end() ) m_aSkinClasses[nClass] = iter->second;
+		}
 	}
 
 	CControlFactory::~CControlFactory()
@@ -72,6 +82,12 @@ namespace DuiLib
 		}
 	}
 
+	CControlUI* CControlFactory::CreateControl(UINT nSkinClassId)
+	{
+		if( nSkinClassId >= m_aSkinClasses.size() || m_aSkinClasses[nSkinClassId] == NULL ) return NULL;
+		return (CControlUI*) (m_aSkinClasses[nSkinClassId]());
+	}
+
 	void CControlFactory::RegistControl(CDuiString strClassName, CreateClass pFunc)
 	{
 		strClassName.MakeLower();
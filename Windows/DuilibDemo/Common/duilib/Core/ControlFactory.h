@@ -1,5 +1,6 @@
 #pragma once
 #include <map>
+#include <vector>
 namespace DuiLib 
 {
 	typedef CControlUI* (*CreateClass)();
@@ -9,6 +10,8 @@ namespace DuiLib
 	{
 	public:
 		CControlUI* CreateControl(CDuiString strClassName);
+		// 按预编译皮肤中的类别创建内置控件，不是内置控件时返回 NULL
+		CControlUI* CreateControl(UINT nSkinClassId);
 		void RegistControl(CDuiString strClassName, CreateClass pFunc);
 
 		static CControlFactory* GetInstance();
@@ -20,6 +23,7 @@ namespace DuiLib
 
 	private:
 		MAP_DUI_CTRATECLASS m_mapControl;
+		std::vector<CreateClass> m_aSkinClasses;	// 下标为 SkinClassId
 	};
 
 #define DECLARE_DUICONTROL(class_name)\
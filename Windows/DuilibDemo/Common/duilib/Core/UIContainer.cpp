@@ -779,6 +779,8 @@ namespace DuiLib
 			if( (uFlags & UIFIND_HITTEST) == 0 || IsMouseEnabled() ) pResult = m_pHorizontalScrollBar->FindControl(Proc, pData, uFlags);
 		}
 		if( pResult != NULL ) return pResult;
+		// 子孙控件都不需要更新时不再往下找
+		if( (uFlags & UIFIND_UPDATETEST) != 0 && !IsChildUpdateNeeded() ) return NULL;
 
 		if( (uFlags & UIFIND_HITTEST) == 0 || IsMouseChildEnabled() ) {
 			RECT rc = m_rcItem;
@@ -943,6 +945,97 @@ namespace DuiLib
 		}
 	}
 
+	// 布局引擎通过 EstimateSize 测量子控件
+	class CEstimateSizeMeasure : public ILayoutMeasure
+	{
+	public:
+		virtual TLayoutSize Measure(const TLayoutItem& item, TLayoutSize szAvailable)
+		{
+			SIZE sz = { szAvailable.cx, szAvailable.cy };
+			sz = static_cast<CControlUI*>(item.pData)->EstimateSize(sz);
+			TLayoutSize szResult = { sz.cx, sz.cy };
+			return szResult;
+		}
+	};
+
+	ILayoutMeasure* CContainerUI::GetLayoutMeasure()
+	{
+		static CEstimateSizeMeasure s_measure;
+		return &s_measure;
+	}
+
+	void CContainerUI::PrepareLayoutItems()
+	{
+		m_aLayoutItems.clear();
+		for( int it = 0; it < m_items.GetSize(); it++ ) {
+			CControlUI* pControl = static_cast<CControlUI*>(m_items[it]);
+			if( !pControl->IsVisible() ) continue;
+			if( pControl->IsFloat() ) {
+				SetFloatPos(it);
+				continue;
+			}
+
+			TLayoutItem item;
+			item.pData = pControl;
+			RECT rcPadding = pControl->GetPadding();
+			item.rcPadding.left = rcPadding.left;
+			item.rcPadding.top = rcPadding.top;
+			item.rcPadding.right = rcPadding.right;
+			item.rcPadding.bottom = rcPadding.bottom;
+			item.szFixed.cx = pControl->GetFixedWidth();
+			item.szFixed.cy = pControl->GetFixedHeight();
+			item.szMin.cx = pControl->GetMinWidth();
+			item.szMin.cy = pControl->GetMinHeight();
+			item.szMax.cx = pControl->GetMaxWidth();
+			item.szMax.cy = pControl->GetMaxHeight();
+			CLayoutEngine::ResetItem(item);
+			m_aLayoutItems.push_back(item);
+		}
+	}
+
+	TLayoutBox CContainerUI::GetLayoutBox(RECT rc) const
+	{
+		TLayoutBox box;
+		::ZeroMemory(&box, sizeof(box));
+		box.rc.left = rc.left;
+		box.rc.top = rc.top;
+		box.rc.right = rc.right;
+		box.rc.bottom = rc.bottom;
+		if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() ) {
+			box.szScrollRange.cx = m_pHorizontalScrollBar->GetScrollRange();
+			box.szScrollPos.cx = m_pHorizontalScrollBar->GetScrollPos();
+		}
+		if( m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible() ) {
+			box.szScrollRange.cy = m_pVerticalScrollBar->GetScrollRange();
+			box.szScrollPos.cy = m_pVerticalScrollBar->GetScrollPos();
+		}
+		box.iChildPadding = m_iChildPadding;
+		box.nAlign = LAYOUT_ALIGN_NEAR;
+		return box;
+	}
+
+	void CContainerUI::ApplyLayoutItems(bool bNeedInvalidate)
+	{
+		// 子控件的 SetPos 可能重入本容器的布局，每次都重新取 size
+		for( size_t it = 0; it < m_aLayoutItems.size(); it++ ) {
+			const TLayoutRect& rcPos = m_aLayoutItems[it].rcPos;
+			RECT rc = { rcPos.left, rcPos.top, rcPos.right, rcPos.bottom };
+			SetChildPos(static_cast<CControlUI*>(m_aLayoutItems[it].pData), rc, bNeedInvalidate);
+		}
+	}
+
+	void CContainerUI::SetChildPos(CControlUI* pControl, RECT rc, bool bNeedInvalidate)
+	{
+		// 和 CControlUI::SetPos 一样先修正空矩形，再和当前位置比较
+		if( rc.right < rc.left ) rc.right = rc.left;
+		if( rc.bottom < rc.top ) rc.bottom = rc.top;
+		if( !pControl->IsUpdateNeeded() && !pControl->IsChildUpdateNeeded() ) {
+			const RECT& rcOld = pControl->GetPos();
+			if( ::EqualRect(&rcOld, &rc) ) return;
+		}
+		pControl->SetPos(rc, bNeedInvalidate);
+	}
+
 	void CContainerUI::ProcessScrollBar(RECT rc, int cxRequired, int cyRequired)
 	{
 		while (m_pHorizontalScrollBar)
@@ -117,6 +117,15 @@ namespace DuiLib {
 		virtual void SetFloatPos(int iIndex);
 		virtual void ProcessScrollBar(RECT rc, int cxRequired, int cyRequired);
 
+		// 布局引擎的输入输出：收集可见、非浮动的子控件到 m_aLayoutItems，浮动的子控件直接设置位置
+		void PrepareLayoutItems();
+		// rc 为去掉内边距和滚动条后的区域
+		TLayoutBox GetLayoutBox(RECT rc) const;
+		void ApplyLayoutItems(bool bNeedInvalidate);
+		// 位置没有变化、自身和子孙控件都不需要更新时跳过，整棵子树不再重新布局
+		void SetChildPos(CControlUI* pControl, RECT rc, bool bNeedInvalidate);
+		static ILayoutMeasure* GetLayoutMeasure();
+
 	protected:
 		CStdPtrArray m_items;
 		RECT m_rcInset;
@@ -132,6 +141,7 @@ namespace DuiLib {
 		CScrollBarUI* m_pHorizontalScrollBar;
 		CDuiString	m_sVerticalScrollBarStyle;
 		CDuiString	m_sHorizontalScrollBarStyle;
+		std::vector<TLayoutItem> m_aLayoutItems;
 	};
 
 } // namespace DuiLib
@@ -7,6 +7,7 @@ namespace DuiLib {
 		:m_pManager(NULL), 
 		m_pParent(NULL), 
 		m_bUpdateNeeded(true),
+		m_bChildUpdateNeeded(false),
 		m_bMenuUsed(false),
 		m_bVisible(true), 
 		m_bInternVisible(true),
@@ -97,6 +98,12 @@ namespace DuiLib {
 	{
 		m_pManager = pManager;
 		m_pParent = pParent;
+		// 新加入的控件需要布局，祖先容器不能跳过它
+		if( m_bUpdateNeeded || m_bChildUpdateNeeded ) {
+			for( CControlUI* pAncestor = m_pParent; pAncestor != NULL; pAncestor = pAncestor->GetParent() ) {
+				pAncestor->m_bChildUpdateNeeded = true;
+			}
+		}
 		if( bInit && m_pParent ) Init();
 	}
 
@@ -376,6 +383,7 @@ namespace DuiLib {
 		}
 
 		m_bUpdateNeeded = false;
+		m_bChildUpdateNeeded = false;
 
 		if( bNeedInvalidate && IsVisible() ) {
 			invalidateRc.Join(m_rcItem);
@@ -762,10 +770,19 @@ namespace DuiLib {
 		return m_bUpdateNeeded;
 	}
 
+	bool CControlUI::IsChildUpdateNeeded() const
+	{
+		return m_bChildUpdateNeeded;
+	}
+
 	void CControlUI::NeedUpdate()
 	{
-		if( !IsVisible() ) return;
+		// 隐藏时也要记下来，重新显示后父容器不能跳过它
 		m_bUpdateNeeded = true;
+		for( CControlUI* pAncestor = GetParent(); pAncestor != NULL; pAncestor = pAncestor->GetParent() ) {
+			pAncestor->m_bChildUpdateNeeded = true;
+		}
+		if( !IsVisible() ) return;
 		Invalidate();
 
 		if( m_pManager != NULL ) m_pManager->NeedUpdate();
@@ -938,9 +955,8 @@ namespace DuiLib {
 			SetFixedHeight(rcPos.bottom - rcPos.top);
 		}
 		else if( _tcsicmp(pstrName, _T("float")) == 0 ) {
-			CDuiString nValue = pstrValue;
 			// 动态计算相对比例
-			if(nValue.Find(',') < 0) {
+			if( CDuiStringView(pstrValue).Find(_T(',')) < 0 ) {
 				SetFloat(_tcsicmp(pstrValue, _T("true")) == 0);
 			}
 			else {
@@ -957,16 +973,10 @@ namespace DuiLib {
 		else if( _tcsicmp(pstrName, _T("floatalign")) == 0) {
 			UINT uAlign = GetFloatAlign();
 			// 解析文字属性
-			while( *pstrValue != _T('\0') ) {
-				CDuiString sValue;
-				while( *pstrValue == _T(',') || *pstrValue == _T(' ') ) pstrValue = ::CharNext(pstrValue);
-
-				while( *pstrValue != _T('\0') && *pstrValue != _T(',') && *pstrValue != _T(' ') ) {
-					LPTSTR pstrTemp = ::CharNext(pstrValue);
-					while( pstrValue < pstrTemp) {
-						sValue += *pstrValue++;
-					}
-				}
+			CDuiStringView sList(pstrValue);
+			CDuiStringView sValue;
+			int iPos = 0;
+			while( sList.NextToken(iPos, _T(", "), sValue) ) {
 				if(sValue.CompareNoCase(_T("null")) == 0) {
 					uAlign = 0;
 				}
@@ -1049,8 +1059,7 @@ namespace DuiLib {
 		}
 		else if( _tcsicmp(pstrName, _T("colorhsl")) == 0 ) SetColorHSL(_tcsicmp(pstrValue, _T("true")) == 0);
 		else if( _tcsicmp(pstrName, _T("bordersize")) == 0 ) {
-			CDuiString nValue = pstrValue;
-			if(nValue.Find(',') < 0) {
+			if( CDuiStringView(pstrValue).Find(_T(',')) < 0 ) {
 				SetBorderSize(_ttoi(pstrValue));
 				RECT rcPadding = {0};
 				SetBorderSize(rcPadding);
@@ -1117,35 +1126,7 @@ namespace DuiLib {
 		}
 		else if( _tcsicmp(pstrName, _T("virtualwnd")) == 0 ) SetVirtualWnd(pstrValue);
 		else if( _tcsicmp(pstrName, _T("innerstyle")) == 0 ) {
-			CDuiString sXmlData = pstrValue;
-			sXmlData.Replace(_T("&quot;"), _T("\""));
-			LPCTSTR pstrList = sXmlData.GetData();
-			CDuiString sItem;
-			CDuiString sValue;
-			while( *pstrList != _T('\0') ) {
-				sItem.Empty();
-				sValue.Empty();
-				while( *pstrList != _T('\0') && *pstrList != _T('=') ) {
-					LPTSTR pstrTemp = ::CharNext(pstrList);
-					while( pstrList < pstrTemp) {
-						sItem += *pstrList++;
-					}
-				}
-				ASSERT( *pstrList == _T('=') );
-				if( *pstrList++ != _T('=') ) return;
-				ASSERT( *pstrList == _T('\"') );
-				if( *pstrList++ != _T('\"') ) return;
-				while( *pstrList != _T('\0') && *pstrList != _T('\"') ) {
-					LPTSTR pstrTemp = ::CharNext(pstrList);
-					while( pstrList < pstrTemp) {
-						sValue += *pstrList++;
-					}
-				}
-				ASSERT( *pstrList == _T('\"') );
-				if( *pstrList++ != _T('\"') ) return;
-				SetAttribute(sItem, sValue);
-				if( *pstrList++ != _T(' ') && *pstrList++ != _T(',') ) return;
-			}
+			ParseAttributeList(pstrValue, *this);
 		}
 		else {
 			AddCustomAttribute(pstrName, pstrValue);
@@ -1161,36 +1142,8 @@ namespace DuiLib {
 				return ApplyAttributeList(pStyle);
 			}
 		}
-		CDuiString sXmlData = pstrValue;
-		sXmlData.Replace(_T("&quot;"), _T("\""));
-		LPCTSTR pstrList = sXmlData.GetData();
 		// 解析样式属性
-		CDuiString sItem;
-		CDuiString sValue;
-		while( *pstrList != _T('\0') ) {
-			sItem.Empty();
-			sValue.Empty();
-			while( *pstrList != _T('\0') && *pstrList != _T('=') ) {
-				LPTSTR pstrTemp = ::CharNext(pstrList);
-				while( pstrList < pstrTemp) {
-					sItem += *pstrList++;
-				}
-			}
-			ASSERT( *pstrList == _T('=') );
-			if( *pstrList++ != _T('=') ) return this;
-			ASSERT( *pstrList == _T('\"') );
-			if( *pstrList++ != _T('\"') ) return this;
-			while( *pstrList != _T('\0') && *pstrList != _T('\"') ) {
-				LPTSTR pstrTemp = ::CharNext(pstrList);
-				while( pstrList < pstrTemp) {
-					sValue += *pstrList++;
-				}
-			}
-			ASSERT( *pstrList == _T('\"') );
-			if( *pstrList++ != _T('\"') ) return this;
-			SetAttribute(sItem, sValue);
-			if( *pstrList++ != _T(' ') && *pstrList++ != _T(',') ) return this;
-		}
+		ParseAttributeList(pstrValue, *this);
 		return this;
 	}
 
@@ -161,6 +161,8 @@ namespace DuiLib {
 
 		void Invalidate();
 		bool IsUpdateNeeded() const;
+		// 有子孙控件需要重新布局
+		bool IsChildUpdateNeeded() const;
 		void NeedUpdate();
 		void NeedParentUpdate();
 		DWORD GetAdjustColor(DWORD dwColor);
@@ -210,6 +212,7 @@ namespace DuiLib {
 		CDuiString m_sVirtualWnd;
 		CDuiString m_sName;
 		bool m_bUpdateNeeded;
+		bool m_bChildUpdateNeeded;
 		bool m_bMenuUsed;
 		RECT m_rcItem;
 		RECT m_rcPadding;
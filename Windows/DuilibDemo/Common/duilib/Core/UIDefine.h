@@ -4,6 +4,10 @@ namespace DuiLib
 {
 #define MAX_FONT_ID		30000
 #define CARET_TIMERID	0x1999
+// CPaintManagerUI 调度所有控件定时器的系统定时器
+#define SCHEDULER_TIMERID	0xF1
+// SetAnimationTimer 到期时 UIEVENT_TIMER 的 wParam，控件自己的定时器不要使用这个 ID
+#define ANIMATION_TIMERID	0xF1
 
 	// 列表类型
 	enum ListType
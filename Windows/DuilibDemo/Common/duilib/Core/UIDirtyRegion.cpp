@@ -0,0 +1,177 @@
+#include "UIDirtyRegion.h"
+
+namespace DuiLib {
+
+static bool IsEmptyDirtyRect(const CDirtyRegion::Rect& rc)
+{
+    return rc.right <= rc.left || rc.bottom <= rc.top;
+}
+
+static long long DirtyRectArea(const CDirtyRegion::Rect& rc)
+{
+    if( IsEmptyDirtyRect(rc) ) return 0;
+    return static_cast<long long>(rc.right - rc.left) * (rc.bottom - rc.top);
+}
+
+static bool ContainsDirtyRect(const CDirtyRegion::Rect& rcOuter, const CDirtyRegion::Rect& rcInner)
+{
+    return rcOuter.left <= rcInner.left && rcOuter.top <= rcInner.top &&
+        rcOuter.right >= rcInner.right && rcOuter.bottom >= rcInner.bottom;
+}
+
+static CDirtyRegion::Rect UnionDirtyRect(const CDirtyRegion::Rect& a, const CDirtyRegion::Rect& b)
+{
+    CDirtyRegion::Rect rc;
+    rc.left = a.left < b.left ? a.left : b.left;
+    rc.top = a.top < b.top ? a.top : b.top;
+    rc.right = a.right > b.right ? a.right : b.right;
+    rc.bottom = a.bottom > b.bottom ? a.bottom : b.bottom;
+    return rc;
+}
+
+static CDirtyRegion::Rect IntersectDirtyRect(const CDirtyRegion::Rect& a, const CDirtyRegion::Rect& b)
+{
+    CDirtyRegion::Rect rc;
+    rc.left = a.left > b.left ? a.left : b.left;
+    rc.top = a.top > b.top ? a.top : b.top;
+    rc.right = a.right < b.right ? a.right : b.right;
+    rc.bottom = a.bottom < b.bottom ? a.bottom : b.bottom;
+    return rc;
+}
+
+// 两个矩形合并后多画的面积
+static long long MergeWaste(const CDirtyRegion::Rect& a, const CDirtyRegion::Rect& b)
+{
+    return DirtyRectArea(UnionDirtyRect(a, b)) - DirtyRectArea(a) - DirtyRectArea(b) + DirtyRectArea(IntersectDirtyRect(a, b));
+}
+
+CDirtyRegion::CDirtyRegion(int nMaxRects) : m_nMaxRects(nMaxRects < 1 ? 1 : nMaxRects)
+{
+}
+
+void CDirtyRegion::Add(const Rect& rc)
+{
+    if( IsEmptyDirtyRect(rc) ) return;
+    _Insert(rc);
+    // 超过上限时合并多画面积最小的一对
+    while( static_cast<int>(m_aRects.size()) > m_nMaxRects ) {
+        size_t iBest = 0, jBest = 1;
+        long long nBest = -1;
+        for( size_t i = 0; i < m_aRects.size(); i++ ) {
+            for( size_t j = i + 1; j < m_aRects.size(); j++ ) {
+                long long nWaste = MergeWaste(m_aRects[i], m_aRects[j]);
+                if( nBest < 0 || nWaste < nBest ) {
+                    nBest = nWaste;
+                    iBest = i;
+                    jBest = j;
+                }
+            }
+        }
+        Rect rcMerged = UnionDirtyRect(m_aRects[iBest], m_aRects[jBest]);
+        m_aRects.erase(m_aRects.begin() + jBest);
+        m_aRects.erase(m_aRects.begin() + iBest);
+        _Insert(rcMerged);
+    }
+}
+
+void CDirtyRegion::Add(long left, long top, long right, long bottom)
+{
+    Rect rc = { left, top, right, bottom };
+    Add(rc);
+}
+
+void CDirtyRegion::_Insert(Rect rc)
+{
+    // 合并后的矩形可能又能和别的矩形合并，一直做到没有可合并的为止
+    for( ;; ) {
+        bool bMerged = false;
+        for( size_t i = 0; i < m_aRects.size(); ) {
+            const Rect& rcOld = m_aRects[i];
+            if( ContainsDirtyRect(rcOld, rc) ) return;
+            if( ContainsDirtyRect(rc, rcOld) ) {
+                m_aRects.erase(m_aRects.begin() + i);
+                continue;
+            }
+            // 合并后多画的面积不超过合并结果的 1/4 时合并，相邻的同高或同宽矩形多画面积为 0
+            Rect rcUnion = UnionDirtyRect(rcOld, rc);
+            if( MergeWaste(rcOld, rc) * 4 <= DirtyRectArea(rcUnion) ) {
+                m_aRects.erase(m_aRects.begin() + i);
+                rc = rcUnion;
+                bMerged = true;
+                break;
+            }
+            ++i;
+        }
+        if( !bMerged ) break;
+    }
+    m_aRects.push_back(rc);
+}
+
+void CDirtyRegion::Clear()
+{
+    m_aRects.clear();
+}
+
+bool CDirtyRegion::IsEmpty() const
+{
+    return m_aRects.empty();
+}
+
+int CDirtyRegion::GetCount() const
+{
+    return static_cast<int>(m_aRects.size());
+}
+
+const CDirtyRegion::Rect& CDirtyRegion::GetAt(int iIndex) const
+{
+    return m_aRects[iIndex];
+}
+
+CDirtyRegion::Rect CDirtyRegion::GetBounds() const
+{
+    Rect rc = { 0, 0, 0, 0 };
+    for( size_t i = 0; i < m_aRects.size(); i++ ) {
+        rc = i == 0 ? m_aRects[i] : UnionDirtyRect(rc, m_aRects[i]);
+    }
+    return rc;
+}
+
+long long CDirtyRegion::GetArea() const
+{
+    long long nArea = 0;
+    for( size_t i = 0; i < m_aRects.size(); i++ ) nArea += DirtyRectArea(m_aRects[i]);
+    return nArea;
+}
+
+void CDirtyRegion::Clip(const Rect& rcBound)
+{
+    for( size_t i = 0; i < m_aRects.size(); ) {
+        m_aRects[i] = IntersectDirtyRect(m_aRects[i], rcBound);
+        if( IsEmptyDirtyRect(m_aRects[i]) ) m_aRects.erase(m_aRects.begin() + i);
+        else ++i;
+    }
+}
+
+void CDirtyRegion::Detach(std::vector<Rect>& aRects)
+{
+    aRects.clear();
+    aRects.swap(m_aRects);
+}
+
+void CDirtyRegion::SetMaxRects(int nMaxRects)
+{
+    m_nMaxRects = nMaxRects < 1 ? 1 : nMaxRects;
+    // 下次 Add 时再按新的上限合并；上限调小时立即合并
+    if( static_cast<int>(m_aRects.size()) > m_nMaxRects ) {
+        std::vector<Rect> aRects;
+        aRects.swap(m_aRects);
+        for( size_t i = 0; i < aRects.size(); i++ ) Add(aRects[i]);
+    }
+}
+
+int CDirtyRegion::GetMaxRects() const
+{
+    return m_nMaxRects;
+}
+
+} // namespace DuiLib
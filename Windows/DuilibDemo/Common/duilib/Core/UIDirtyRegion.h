@@ -0,0 +1,61 @@
+#ifndef __UIDIRTYREGION_H__
+#define __UIDIRTYREGION_H__
+
+#pragma once
+
+// 窗口的脏区域：记录两次绘制之间失效的矩形，绘制时只重画这些矩形，而不是它们的外接矩形。
+// 两个离得很远的小控件（比如左上角的时钟和右下角的视频画面）同时刷新时，外接矩形几乎是整个窗口。
+// 矩形数量有上限，超过时合并多出面积最小的两个，重叠或相邻的矩形在多出的面积不大时直接合并。
+// 不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <vector>
+
+namespace DuiLib {
+
+	class CDirtyRegion
+	{
+	public:
+		struct Rect
+		{
+			long left;
+			long top;
+			long right;
+			long bottom;
+		};
+
+		enum { DEFAULT_MAX_RECTS = 8 };
+
+	public:
+		explicit CDirtyRegion(int nMaxRects = DEFAULT_MAX_RECTS);
+
+		// 加入一个失效矩形，空矩形忽略
+		void Add(const Rect& rc);
+		void Add(long left, long top, long right, long bottom);
+		void Clear();
+		bool IsEmpty() const;
+		int GetCount() const;
+		const Rect& GetAt(int iIndex) const;
+		// 所有矩形的外接矩形，区域为空时返回空矩形
+		Rect GetBounds() const;
+		// 矩形的面积之和，合并后的矩形之间可能有少量重叠
+		long long GetArea() const;
+		// 裁剪到 rcBound 以内，裁剪后为空的矩形去掉
+		void Clip(const Rect& rcBound);
+		// 取出所有矩形并清空，绘制时先取出，绘制过程中新的失效留到下一次
+		void Detach(std::vector<Rect>& aRects);
+
+		void SetMaxRects(int nMaxRects);
+		int GetMaxRects() const;
+
+	private:
+		void _Insert(Rect rc);
+
+	private:
+		std::vector<Rect> m_aRects;
+		int m_nMaxRects;
+	};
+
+} // namespace DuiLib
+
+#endif // __UIDIRTYREGION_H__
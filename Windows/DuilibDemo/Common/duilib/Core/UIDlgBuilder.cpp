@@ -2,6 +2,49 @@
 
 namespace DuiLib {
 
+	// 预编译皮肤的节点带有类别，XML 的节点按名字查
+	static UINT _GetClassId(const CMarkupNode& node)
+	{
+		UINT nClass = node.GetClassId();
+		if( nClass == SKIN_CLASS_UNKNOWN ) nClass = GetSkinClassId(node.GetName());
+		return nClass;
+	}
+
+	// 以下几个函数优先使用预编译皮肤中转换好的值，没有时按原来的方式解析字符串
+	static void _ParseInts(const CMarkupTypedValue* pTyped, LPCTSTR pstrValue, int* pValues, int nCount)
+	{
+		if( pTyped != NULL && pTyped->nType == CMarkupTypedValue::TYPE_INTS && (int)pTyped->nCount >= nCount ) {
+			for( int i = 0; i < nCount; i++ ) pValues[i] = pTyped->aValue[i];
+			return;
+		}
+		LPTSTR pstr = NULL;
+		pValues[0] = _tcstol(pstrValue, &pstr, 10); ASSERT(pstr);
+		for( int i = 1; i < nCount; i++ ) {
+			pValues[i] = _tcstol(pstr + 1, &pstr, 10); ASSERT(pstr);
+		}
+	}
+
+	static int _ParseInt(const CMarkupTypedValue* pTyped, LPCTSTR pstrValue)
+	{
+		int nValue = 0;
+		_ParseInts(pTyped, pstrValue, &nValue, 1);
+		return nValue;
+	}
+
+	static DWORD _ParseColor(const CMarkupTypedValue* pTyped, LPCTSTR pstrValue)
+	{
+		if( pTyped != NULL && pTyped->nType == CMarkupTypedValue::TYPE_COLOR ) return (DWORD)pTyped->aValue[0];
+		if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
+		LPTSTR pstr = NULL;
+		return _tcstoul(pstrValue, &pstr, 16);
+	}
+
+	static bool _ParseBool(const CMarkupTypedValue* pTyped, LPCTSTR pstrValue)
+	{
+		if( pTyped != NULL && pTyped->nType == CMarkupTypedValue::TYPE_BOOL ) return pTyped->aValue[0] != 0;
+		return _tcsicmp(pstrValue, _T("true")) == 0;
+	}
+
 	CDialogBuilder::CDialogBuilder() : m_pCallback(NULL), m_pstrtype(NULL)
 	{
 		m_instance = NULL;
@@ -61,14 +104,16 @@ namespace DuiLib {
 		if( !root.IsValid() ) return NULL;
 
 		if( pManager ) {
-			LPCTSTR pstrClass = NULL;
+			// 先把皮肤引用的图片交给后台线程解码，下面创建控件的同时图片已经在解码了
+			pManager->PreloadImages(m_xml);
+
 			int nAttributes = 0;
 			LPCTSTR pstrName = NULL;
 			LPCTSTR pstrValue = NULL;
-			LPTSTR pstr = NULL;
+			const CMarkupTypedValue* pTyped = NULL;
 			for( CMarkupNode node = root.GetChild() ; node.IsValid(); node = node.GetSibling() ) {
-				pstrClass = node.GetName();
-				if( _tcsicmp(pstrClass, _T("Image")) == 0 ) {
+				UINT nClass = _GetClassId(node);
+				if( nClass == SKIN_CLASS_IMAGE ) {
 					nAttributes = node.GetAttributeCount();
 					LPCTSTR pImageName = NULL;
 					LPCTSTR pImageResType = NULL;
@@ -77,6 +122,7 @@ namespace DuiLib {
 					for( int i = 0; i < nAttributes; i++ ) {
 						pstrName = node.GetAttributeName(i);
 						pstrValue = node.GetAttributeValue(i);
+						pTyped = node.GetAttributeTypedValue(i);
 						if( _tcsicmp(pstrName, _T("name")) == 0 ) {
 							pImageName = pstrValue;
 						}
@@ -84,16 +130,16 @@ namespace DuiLib {
 							pImageResType = pstrValue;
 						}
 						else if( _tcsicmp(pstrName, _T("mask")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							mask = _tcstoul(pstrValue, &pstr, 16);
+							mask = _ParseColor(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("shared")) == 0 ) {
-							shared = (_tcsicmp(pstrValue, _T("true")) == 0);
+							shared = _ParseBool(pTyped, pstrValue);
 						}
 					}
-					if( pImageName ) pManager->AddImage(pImageName, pImageResType, mask, false, shared);
+					// 正在预加载的图片绘制时才放进缓存，不在这里同步解码
+					if( pImageName && !pManager->IsImagePreloading(pImageName) ) pManager->AddImage(pImageName, pImageResType, mask, false, shared);
 				}
-				else if( _tcsicmp(pstrClass, _T("Font")) == 0 ) {
+				else if( nClass == SKIN_CLASS_FONT ) {
 					nAttributes = node.GetAttributeCount();
 					int id = -1;
 					LPCTSTR pFontName = NULL;
@@ -106,29 +152,30 @@ namespace DuiLib {
 					for( int i = 0; i < nAttributes; i++ ) {
 						pstrName = node.GetAttributeName(i);
 						pstrValue = node.GetAttributeValue(i);
+						pTyped = node.GetAttributeTypedValue(i);
 						if( _tcsicmp(pstrName, _T("id")) == 0 ) {
-							id = _tcstol(pstrValue, &pstr, 10);
+							id = _ParseInt(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("name")) == 0 ) {
 							pFontName = pstrValue;
 						}
 						else if( _tcsicmp(pstrName, _T("size")) == 0 ) {
-							size = _tcstol(pstrValue, &pstr, 10);
+							size = _ParseInt(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("bold")) == 0 ) {
-							bold = (_tcsicmp(pstrValue, _T("true")) == 0);
+							bold = _ParseBool(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("underline")) == 0 ) {
-							underline = (_tcsicmp(pstrValue, _T("true")) == 0);
+							underline = _ParseBool(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("italic")) == 0 ) {
-							italic = (_tcsicmp(pstrValue, _T("true")) == 0);
+							italic = _ParseBool(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("default")) == 0 ) {
-							defaultfont = (_tcsicmp(pstrValue, _T("true")) == 0);
+							defaultfont = _ParseBool(pTyped, pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("shared")) == 0 ) {
-							shared = (_tcsicmp(pstrValue, _T("true")) == 0);
+							shared = _ParseBool(pTyped, pstrValue);
 						}
 					}
 					if( id >= 0 ) {
@@ -136,7 +183,7 @@ namespace DuiLib {
 						if( defaultfont ) pManager->SetDefaultFont(pFontName, pManager->GetDPIObj()->Scale(size), bold, underline, italic, shared);
 					}
 				}
-				else if( _tcsicmp(pstrClass, _T("Default")) == 0 ) {
+				else if( nClass == SKIN_CLASS_DEFAULT ) {
 					nAttributes = node.GetAttributeCount();
 					LPCTSTR pControlName = NULL;
 					LPCTSTR pControlValue = NULL;
@@ -144,6 +191,7 @@ namespace DuiLib {
 					for( int i = 0; i < nAttributes; i++ ) {
 						pstrName = node.GetAttributeName(i);
 						pstrValue = node.GetAttributeValue(i);
+						pTyped = node.GetAttributeTypedValue(i);
 						if( _tcsicmp(pstrName, _T("name")) == 0 ) {
 							pControlName = pstrValue;
 						}
@@ -151,14 +199,14 @@ namespace DuiLib {
 							pControlValue = pstrValue;
 						}
 						else if( _tcsicmp(pstrName, _T("shared")) == 0 ) {
-							shared = (_tcsicmp(pstrValue, _T("true")) == 0);
+							shared = _ParseBool(pTyped, pstrValue);
 						}
 					}
 					if( pControlName ) {
 						pManager->AddDefaultAttributeList(pControlName, pControlValue, shared);
 					}
 				}
-				else if( _tcsicmp(pstrClass, _T("Style")) == 0 ) {
+				else if( nClass == SKIN_CLASS_STYLE ) {
 					nAttributes = node.GetAttributeCount();
 					LPCTSTR pName = NULL;
 					LPCTSTR pStyle = NULL;
@@ -166,6 +214,7 @@ namespace DuiLib {
 					for( int i = 0; i < nAttributes; i++ ) {
 						pstrName = node.GetAttributeName(i);
 						pstrValue = node.GetAttributeValue(i);
+						pTyped = node.GetAttributeTypedValue(i);
 						if( _tcsicmp(pstrName, _T("name")) == 0 ) {
 							pName = pstrValue;
 						}
@@ -173,14 +222,14 @@ namespace DuiLib {
 							pStyle = pstrValue;
 						}
 						else if( _tcsicmp(pstrName, _T("shared")) == 0 ) {
-							shared = (_tcsicmp(pstrValue, _T("true")) == 0);
+							shared = _ParseBool(pTyped, pstrValue);
 						}
 					}
 					if( pName ) {
 						pManager->AddStyle(pName, pStyle, shared);
 					}
 				}
-				else if (_tcsicmp(pstrClass, _T("Import")) == 0) {
+				else if( nClass == SKIN_CLASS_IMPORT ) {
 					nAttributes = node.GetAttributeCount();
 					LPCTSTR pstrPath = NULL;
 					for (int i = 0; i < nAttributes; i++) {
@@ -196,148 +245,130 @@ namespace DuiLib {
 				}
 			}
 
-			pstrClass = root.GetName();
-			if( _tcsicmp(pstrClass, _T("Window")) == 0 ) {
+			if( _GetClassId(root) == SKIN_CLASS_WINDOW ) {
 				if( pManager->GetPaintWindow() ) {
 					int nAttributes = root.GetAttributeCount();
 					for( int i = 0; i < nAttributes; i++ ) {
 						pstrName = root.GetAttributeName(i);
 						pstrValue = root.GetAttributeValue(i);
+						pTyped = root.GetAttributeTypedValue(i);
 						if( _tcsicmp(pstrName, _T("size")) == 0 ) {
-							LPTSTR pstr = NULL;
-							int cx = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							int cy = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr); 
+							int aSize[2] = { 0 };
+							_ParseInts(pTyped, pstrValue, aSize, 2);
+							int cx = aSize[0], cy = aSize[1];
 							pManager->SetInitSize(pManager->GetDPIObj()->Scale(cx), pManager->GetDPIObj()->Scale(cy));
 						} 
 						else if( _tcsicmp(pstrName, _T("sizebox")) == 0 ) {
-							RECT rcSizeBox = { 0 };
-							LPTSTR pstr = NULL;
-							rcSizeBox.left = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							rcSizeBox.top = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr);    
-							rcSizeBox.right = _tcstol(pstr + 1, &pstr, 10);  ASSERT(pstr);    
-							rcSizeBox.bottom = _tcstol(pstr + 1, &pstr, 10); ASSERT(pstr);    
+							int aRect[4] = { 0 };
+							_ParseInts(pTyped, pstrValue, aRect, 4);
+							RECT rcSizeBox = { aRect[0], aRect[1], aRect[2], aRect[3] };
 							pManager->SetSizeBox(rcSizeBox);
 						}
 						else if( _tcsicmp(pstrName, _T("caption")) == 0 ) {
-							RECT rcCaption = { 0 };
-							LPTSTR pstr = NULL;
-							rcCaption.left = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							rcCaption.top = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr);    
-							rcCaption.right = _tcstol(pstr + 1, &pstr, 10);  ASSERT(pstr);    
-							rcCaption.bottom = _tcstol(pstr + 1, &pstr, 10); ASSERT(pstr);    
+							int aRect[4] = { 0 };
+							_ParseInts(pTyped, pstrValue, aRect, 4);
+							RECT rcCaption = { aRect[0], aRect[1], aRect[2], aRect[3] };
 							pManager->SetCaptionRect(rcCaption);
 						}
 						else if( _tcsicmp(pstrName, _T("roundcorner")) == 0 ) {
-							LPTSTR pstr = NULL;
-							int cx = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							int cy = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr); 
+							int aSize[2] = { 0 };
+							_ParseInts(pTyped, pstrValue, aSize, 2);
+							int cx = aSize[0], cy = aSize[1];
 							pManager->SetRoundCorner(cx, cy);
 						} 
 						else if( _tcsicmp(pstrName, _T("mininfo")) == 0 ) {
-							LPTSTR pstr = NULL;
-							int cx = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							int cy = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr); 
+							int aSize[2] = { 0 };
+							_ParseInts(pTyped, pstrValue, aSize, 2);
+							int cx = aSize[0], cy = aSize[1];
 							pManager->SetMinInfo(cx, cy);
 						}
 						else if( _tcsicmp(pstrName, _T("maxinfo")) == 0 ) {
-							LPTSTR pstr = NULL;
-							int cx = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							int cy = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr); 
+							int aSize[2] = { 0 };
+							_ParseInts(pTyped, pstrValue, aSize, 2);
+							int cx = aSize[0], cy = aSize[1];
 							pManager->SetMaxInfo(cx, cy);
 						}
 						else if( _tcsicmp(pstrName, _T("showdirty")) == 0 ) {
-							pManager->SetShowUpdateRect(_tcsicmp(pstrValue, _T("true")) == 0);
+							pManager->SetShowUpdateRect(_ParseBool(pTyped, pstrValue));
+						}
+						else if( _tcsicmp(pstrName, _T("retainedpaint")) == 0 ) {
+							pManager->SetRetainedPaint(_ParseBool(pTyped, pstrValue));
 						} 
 						else if( _tcsicmp(pstrName, _T("opacity")) == 0 || _tcsicmp(pstrName, _T("alpha")) == 0 ) {
-							pManager->SetOpacity(_ttoi(pstrValue));
+							pManager->SetOpacity(_ParseInt(pTyped, pstrValue));
 						} 
 						else if( _tcscmp(pstrName, _T("layeredopacity")) == 0 ) {
-							pManager->SetLayeredOpacity(_ttoi(pstrValue));
+							pManager->SetLayeredOpacity(_ParseInt(pTyped, pstrValue));
 						} 
 						else if( _tcscmp(pstrName, _T("layered")) == 0 || _tcscmp(pstrName, _T("bktrans")) == 0) {
-							pManager->SetLayered(_tcsicmp(pstrValue, _T("true")) == 0);
+							pManager->SetLayered(_ParseBool(pTyped, pstrValue));
 						}
 						else if( _tcscmp(pstrName, _T("layeredimage")) == 0 ) {
 							pManager->SetLayered(true);
 							pManager->SetLayeredImage(pstrValue);
 						} 
 						else if( _tcscmp(pstrName, _T("noactivate")) == 0 ) {
-							pManager->SetNoActivate(_tcsicmp(pstrValue, _T("true")) == 0);
+							pManager->SetNoActivate(_ParseBool(pTyped, pstrValue));
 						}
 						else if( _tcsicmp(pstrName, _T("disabledfontcolor")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							LPTSTR pstr = NULL;
-							DWORD clrColor = _tcstoul(pstrValue, &pstr, 16);
+							DWORD clrColor = _ParseColor(pTyped, pstrValue);
 							pManager->SetDefaultDisabledColor(clrColor);
 						} 
 						else if( _tcsicmp(pstrName, _T("defaultfontcolor")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							LPTSTR pstr = NULL;
-							DWORD clrColor = _tcstoul(pstrValue, &pstr, 16);
+							DWORD clrColor = _ParseColor(pTyped, pstrValue);
 							pManager->SetDefaultFontColor(clrColor);
 						}
 						else if( _tcsicmp(pstrName, _T("linkfontcolor")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							LPTSTR pstr = NULL;
-							DWORD clrColor = _tcstoul(pstrValue, &pstr, 16);
+							DWORD clrColor = _ParseColor(pTyped, pstrValue);
 							pManager->SetDefaultLinkFontColor(clrColor);
 						} 
 						else if( _tcsicmp(pstrName, _T("linkhoverfontcolor")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							LPTSTR pstr = NULL;
-							DWORD clrColor = _tcstoul(pstrValue, &pstr, 16);
+							DWORD clrColor = _ParseColor(pTyped, pstrValue);
 							pManager->SetDefaultLinkHoverFontColor(clrColor);
 						} 
 						else if( _tcsicmp(pstrName, _T("selectedcolor")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							LPTSTR pstr = NULL;
-							DWORD clrColor = _tcstoul(pstrValue, &pstr, 16);
+							DWORD clrColor = _ParseColor(pTyped, pstrValue);
 							pManager->SetDefaultSelectedBkColor(clrColor);
 						} 
 						else if( _tcsicmp(pstrName, _T("shadowsize")) == 0 ) {
-							pManager->GetShadow()->SetSize(_ttoi(pstrValue));
+							pManager->GetShadow()->SetSize(_ParseInt(pTyped, pstrValue));
 						}
 						else if( _tcsicmp(pstrName, _T("shadowsharpness")) == 0 ) {
-							pManager->GetShadow()->SetSharpness(_ttoi(pstrValue));
+							pManager->GetShadow()->SetSharpness(_ParseInt(pTyped, pstrValue));
 						}
 						else if( _tcsicmp(pstrName, _T("shadowdarkness")) == 0 ) {
-							pManager->GetShadow()->SetDarkness(_ttoi(pstrValue));
+							pManager->GetShadow()->SetDarkness(_ParseInt(pTyped, pstrValue));
 						}
 						else if( _tcsicmp(pstrName, _T("shadowposition")) == 0 ) {
-							LPTSTR pstr = NULL;
-							int cx = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							int cy = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr); 
+							int aSize[2] = { 0 };
+							_ParseInts(pTyped, pstrValue, aSize, 2);
+							int cx = aSize[0], cy = aSize[1];
 							pManager->GetShadow()->SetPosition(cx, cy);
 						}
 						else if( _tcsicmp(pstrName, _T("shadowcolor")) == 0 ) {
-							if( *pstrValue == _T('#')) pstrValue = ::CharNext(pstrValue);
-							LPTSTR pstr = NULL;
-							DWORD clrColor = _tcstoul(pstrValue, &pstr, 16);
+							DWORD clrColor = _ParseColor(pTyped, pstrValue);
 							pManager->GetShadow()->SetColor(clrColor);
 						}
 						else if( _tcsicmp(pstrName, _T("shadowcorner")) == 0 ) {
-							RECT rcCorner = { 0 };
-							LPTSTR pstr = NULL;
-							rcCorner.left = _tcstol(pstrValue, &pstr, 10);  ASSERT(pstr);    
-							rcCorner.top = _tcstol(pstr + 1, &pstr, 10);    ASSERT(pstr);    
-							rcCorner.right = _tcstol(pstr + 1, &pstr, 10);  ASSERT(pstr);    
-							rcCorner.bottom = _tcstol(pstr + 1, &pstr, 10); ASSERT(pstr);    
+							int aRect[4] = { 0 };
+							_ParseInts(pTyped, pstrValue, aRect, 4);
+							RECT rcCorner = { aRect[0], aRect[1], aRect[2], aRect[3] };
 							pManager->GetShadow()->SetShadowCorner(rcCorner);
 						}
 						else if( _tcsicmp(pstrName, _T("shadowimage")) == 0 ) {
 							pManager->GetShadow()->SetImage(pstrValue);
 						}
 						else if( _tcsicmp(pstrName, _T("showshadow")) == 0 ) {
-							pManager->GetShadow()->ShowShadow(_tcsicmp(pstrValue, _T("true")) == 0);
+							pManager->GetShadow()->ShowShadow(_ParseBool(pTyped, pstrValue));
 						} 
 						else if( _tcsicmp(pstrName, _T("gdiplustext")) == 0 ) {
-							pManager->SetUseGdiplusText(_tcsicmp(pstrValue, _T("true")) == 0);
+							pManager->SetUseGdiplusText(_ParseBool(pTyped, pstrValue));
 						} 
 						else if( _tcsicmp(pstrName, _T("textrenderinghint")) == 0 ) {
-							pManager->SetGdiplusTextRenderingHint(_ttoi(pstrValue));
+							pManager->SetGdiplusTextRenderingHint(_ParseInt(pTyped, pstrValue));
 						} 
 						else if( _tcsicmp(pstrName, _T("tooltiphovertime")) == 0 ) {
-							pManager->SetHoverTime(_ttoi(pstrValue));
+							pManager->SetHoverTime(_ParseInt(pTyped, pstrValue));
 						} 
 					}
 				}
@@ -367,12 +398,13 @@ namespace DuiLib {
 		CControlUI* pReturn = NULL;
 		for( CMarkupNode node = pRoot->GetChild() ; node.IsValid(); node = node.GetSibling() ) {
 			LPCTSTR pstrClass = node.GetName();
-			if( _tcsicmp(pstrClass, _T("Image")) == 0 || _tcsicmp(pstrClass, _T("Font")) == 0 \
-				|| _tcsicmp(pstrClass, _T("Default")) == 0 || _tcsicmp(pstrClass, _T("Style")) == 0 ) continue;
+			UINT nClass = _GetClassId(node);
+			if( nClass == SKIN_CLASS_IMAGE || nClass == SKIN_CLASS_FONT \
+				|| nClass == SKIN_CLASS_DEFAULT || nClass == SKIN_CLASS_STYLE ) continue;
 
 			CControlUI* pControl = NULL;
-			if (_tcsicmp(pstrClass, _T("Import")) == 0) continue;
-			if( _tcsicmp(pstrClass, _T("Include")) == 0 ) {
+			if( nClass == SKIN_CLASS_IMPORT ) continue;
+			if( nClass == SKIN_CLASS_INCLUDE ) {
 				if( !node.HasAttributes() ) continue;
 				int count = 1;
 				LPTSTR pstr = NULL;
@@ -395,9 +427,13 @@ namespace DuiLib {
 				continue;
 			}
 			else {
-				CDuiString strClass;
-				strClass.Format(_T("C%sUI"), pstrClass);
-				pControl = dynamic_cast<CControlUI*>(CControlFactory::GetInstance()->CreateControl(strClass));
+				// 内置控件按类别直接创建，省掉拼类名和查表
+				if( nClass >= SKIN_CLASS_FIRST_CONTROL ) pControl = CControlFactory::GetInstance()->CreateControl(nClass);
+				if( pControl == NULL ) {
+					CDuiString strClass;
+					strClass.Format(_T("C%sUI"), pstrClass);
+					pControl = dynamic_cast<CControlUI*>(CControlFactory::GetInstance()->CreateControl(strClass));
+				}
 
 				// 检查插件
 				if( pControl == NULL ) {
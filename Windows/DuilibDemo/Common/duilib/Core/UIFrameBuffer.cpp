@@ -0,0 +1,289 @@
+#include "UIFrameBuffer.h"
+
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define UI_FRAMEBUFFER_HAVE_SIMD 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define UI_TARGET_SSE2
+#define UI_TARGET_AVX2
+#else
+#define UI_TARGET_SSE2 __attribute__((target("sse2")))
+#define UI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define UI_FRAMEBUFFER_HAVE_SIMD 0
+#endif
+
+namespace DuiLib {
+
+namespace {
+
+    const unsigned int kAlphaMask = 0xFF000000;
+
+    // 逐像素的参考实现，SIMD 版本处理行尾剩下的像素
+    inline void FillRow(unsigned int* pDst, int nCount, unsigned int dwValue)
+    {
+        for( int i = 0; i < nCount; i++ ) pDst[i] = dwValue;
+    }
+
+    inline void SetOpaqueRow(unsigned int* pDst, int nCount)
+    {
+        for( int i = 0; i < nCount; i++ ) {
+            if( pDst[i] != 0 ) pDst[i] |= kAlphaMask;
+        }
+    }
+
+    inline void RestoreAlphaRow(unsigned int* pDst, int nCount)
+    {
+        for( int i = 0; i < nCount; i++ ) {
+            if( (pDst[i] & kAlphaMask) == 0 && pDst[i] != 0 ) pDst[i] |= kAlphaMask;
+        }
+    }
+
+    inline void AlphaMaskRow(unsigned int* pDst, const unsigned int* pMask, int nCount)
+    {
+        for( int i = 0; i < nCount; i++ ) {
+            unsigned int a = pMask[i] >> 24;
+            unsigned int px = pDst[i];
+            unsigned int r = ((px >> 16) & 0xFF) * a / 255;
+            unsigned int g = ((px >> 8) & 0xFF) * a / 255;
+            unsigned int b = (px & 0xFF) * a / 255;
+            pDst[i] = b | (g << 8) | (r << 16) | (a << 24);
+        }
+    }
+
+#if UI_FRAMEBUFFER_HAVE_SIMD
+
+    UI_TARGET_SSE2 void FillRowSSE2(unsigned int* pDst, int nCount, unsigned int dwValue)
+    {
+        __m128i v = _mm_set1_epi32(static_cast<int>(dwValue));
+        int i = 0;
+        for( ; i + 4 <= nCount; i += 4 ) _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), v);
+        FillRow(pDst + i, nCount - i, dwValue);
+    }
+
+    UI_TARGET_SSE2 void SetOpaqueRowSSE2(unsigned int* pDst, int nCount)
+    {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(kAlphaMask));
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for( ; i + 4 <= nCount; i += 4 ) {
+            __m128i* p = reinterpret_cast<__m128i*>(pDst + i);
+            __m128i px = _mm_loadu_si128(p);
+            __m128i isZero = _mm_cmpeq_epi32(px, zero);
+            _mm_storeu_si128(p, _mm_or_si128(px, _mm_andnot_si128(isZero, alpha)));
+        }
+        SetOpaqueRow(pDst + i, nCount - i);
+    }
+
+    UI_TARGET_SSE2 void RestoreAlphaRowSSE2(unsigned int* pDst, int nCount)
+    {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(kAlphaMask));
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for( ; i + 4 <= nCount; i += 4 ) {
+            __m128i* p = reinterpret_cast<__m128i*>(pDst + i);
+            __m128i px = _mm_loadu_si128(p);
+            __m128i noAlpha = _mm_cmpeq_epi32(_mm_and_si128(px, alpha), zero);
+            __m128i isZero = _mm_cmpeq_epi32(px, zero);
+            _mm_storeu_si128(p, _mm_or_si128(px, _mm_and_si128(_mm_andnot_si128(isZero, noAlpha), alpha)));
+        }
+        RestoreAlphaRow(pDst + i, nCount - i);
+    }
+
+    // 8 个 16 位通道乘以 alpha 后截断除以 255：x / 255 == (x + 1 + (x >> 8)) >> 8，x <= 255 * 255
+    UI_TARGET_SSE2 inline __m128i MulDiv255SSE2(__m128i c, __m128i a)
+    {
+        __m128i x = _mm_mullo_epi16(c, a);
+        x = _mm_add_epi16(x, _mm_add_epi16(_mm_set1_epi16(1), _mm_srli_epi16(x, 8)));
+        return _mm_srli_epi16(x, 8);
+    }
+
+    UI_TARGET_SSE2 void AlphaMaskRowSSE2(unsigned int* pDst, const unsigned int* pMask, int nCount)
+    {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(kAlphaMask));
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for( ; i + 4 <= nCount; i += 4 ) {
+            __m128i* p = reinterpret_cast<__m128i*>(pDst + i);
+            __m128i px = _mm_loadu_si128(p);
+            __m128i mask = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pMask + i)), alpha);
+            // mask 的 alpha 在每个像素的第 3 个 16 位通道，复制到 4 个通道
+            __m128i maskLo = _mm_unpacklo_epi8(mask, zero);
+            __m128i maskHi = _mm_unpackhi_epi8(mask, zero);
+            maskLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(maskLo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            maskHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(maskHi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i lo = MulDiv255SSE2(_mm_unpacklo_epi8(px, zero), maskLo);
+            __m128i hi = MulDiv255SSE2(_mm_unpackhi_epi8(px, zero), maskHi);
+            __m128i color = _mm_andnot_si128(alpha, _mm_packus_epi16(lo, hi));
+            _mm_storeu_si128(p, _mm_or_si128(color, mask));
+        }
+        AlphaMaskRow(pDst + i, pMask + i, nCount - i);
+    }
+
+    UI_TARGET_AVX2 void FillRowAVX2(unsigned int* pDst, int nCount, unsigned int dwValue)
+    {
+        __m256i v = _mm256_set1_epi32(static_cast<int>(dwValue));
+        int i = 0;
+        for( ; i + 8 <= nCount; i += 8 ) _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), v);
+        FillRow(pDst + i, nCount - i, dwValue);
+    }
+
+    UI_TARGET_AVX2 void SetOpaqueRowAVX2(unsigned int* pDst, int nCount)
+    {
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kAlphaMask));
+        const __m256i zero = _mm256_setzero_si256();
+        int i = 0;
+        for( ; i + 8 <= nCount; i += 8 ) {
+            __m256i* p = reinterpret_cast<__m256i*>(pDst + i);
+            __m256i px = _mm256_loadu_si256(p);
+            __m256i isZero = _mm256_cmpeq_epi32(px, zero);
+            _mm256_storeu_si256(p, _mm256_or_si256(px, _mm256_andnot_si256(isZero, alpha)));
+        }
+        SetOpaqueRow(pDst + i, nCount - i);
+    }
+
+    UI_TARGET_AVX2 void RestoreAlphaRowAVX2(unsigned int* pDst, int nCount)
+    {
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kAlphaMask));
+        const __m256i zero = _mm256_setzero_si256();
+        int i = 0;
+        for( ; i + 8 <= nCount; i += 8 ) {
+            __m256i* p = reinterpret_cast<__m256i*>(pDst + i);
+            __m256i px = _mm256_loadu_si256(p);
+            __m256i noAlpha = _mm256_cmpeq_epi32(_mm256_and_si256(px, alpha), zero);
+            __m256i isZero = _mm256_cmpeq_epi32(px, zero);
+            _mm256_storeu_si256(p, _mm256_or_si256(px, _mm256_and_si256(_mm256_andnot_si256(isZero, noAlpha), alpha)));
+        }
+        RestoreAlphaRow(pDst + i, nCount - i);
+    }
+
+    UI_TARGET_AVX2 inline __m256i MulDiv255AVX2(__m256i c, __m256i a)
+    {
+        __m256i x = _mm256_mullo_epi16(c, a);
+        x = _mm256_add_epi16(x, _mm256_add_epi16(_mm256_set1_epi16(1), _mm256_srli_epi16(x, 8)));
+        return _mm256_srli_epi16(x, 8);
+    }
+
+    // unpack/shuffle/pack 都在 128 位的半边内进行，像素顺序不变
+    UI_TARGET_AVX2 void AlphaMaskRowAVX2(unsigned int* pDst, const unsigned int* pMask, int nCount)
+    {
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kAlphaMask));
+        const __m256i zero = _mm256_setzero_si256();
+        int i = 0;
+        for( ; i + 8 <= nCount; i += 8 ) {
+            __m256i* p = reinterpret_cast<__m256i*>(pDst + i);
+            __m256i px = _mm256_loadu_si256(p);
+            __m256i mask = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pMask + i)), alpha);
+            __m256i maskLo = _mm256_unpacklo_epi8(mask, zero);
+            __m256i maskHi = _mm256_unpackhi_epi8(mask, zero);
+            maskLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(maskLo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            maskHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(maskHi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m256i lo = MulDiv255AVX2(_mm256_unpacklo_epi8(px, zero), maskLo);
+            __m256i hi = MulDiv255AVX2(_mm256_unpackhi_epi8(px, zero), maskHi);
+            __m256i color = _mm256_andnot_si256(alpha, _mm256_packus_epi16(lo, hi));
+            _mm256_storeu_si256(p, _mm256_or_si256(color, mask));
+        }
+        AlphaMaskRow(pDst + i, pMask + i, nCount - i);
+    }
+
+#endif // UI_FRAMEBUFFER_HAVE_SIMD
+
+    inline PixelConvertLevel ClampLevel(PixelConvertLevel eLevel)
+    {
+        return eLevel > GetPixelConvertLevel() ? GetPixelConvertLevel() : eLevel;
+    }
+
+} // namespace
+
+void FillPixels(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, unsigned int dwValue,
+    PixelConvertLevel eLevel)
+{
+    if( nWidth <= 0 ) return;
+    eLevel = ClampLevel(eLevel);
+    for( int y = 0; y < nHeight; y++, pDst += nDstPitch ) {
+        // 清零是最常见的情况，memset 已经足够快
+        if( dwValue == 0 ) memset(pDst, 0, nWidth * sizeof(unsigned int));
+#if UI_FRAMEBUFFER_HAVE_SIMD
+        else if( eLevel == PIXEL_CONVERT_AVX2 ) FillRowAVX2(pDst, nWidth, dwValue);
+        else if( eLevel >= PIXEL_CONVERT_SSE2 ) FillRowSSE2(pDst, nWidth, dwValue);
+#endif
+        else FillRow(pDst, nWidth, dwValue);
+    }
+}
+
+void FillPixels(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, unsigned int dwValue)
+{
+    FillPixels(pDst, nDstPitch, nWidth, nHeight, dwValue, GetPixelConvertLevel());
+}
+
+void CopyPixels(unsigned int* pDst, ptrdiff_t nDstPitch, const unsigned int* pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight)
+{
+    if( nWidth <= 0 ) return;
+    for( int y = 0; y < nHeight; y++, pDst += nDstPitch, pSrc += nSrcPitch ) {
+        memcpy(pDst, pSrc, nWidth * sizeof(unsigned int));
+    }
+}
+
+void SetOpaqueIfNonZero(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, PixelConvertLevel eLevel)
+{
+    if( nWidth <= 0 ) return;
+    eLevel = ClampLevel(eLevel);
+    for( int y = 0; y < nHeight; y++, pDst += nDstPitch ) {
+#if UI_FRAMEBUFFER_HAVE_SIMD
+        if( eLevel == PIXEL_CONVERT_AVX2 ) SetOpaqueRowAVX2(pDst, nWidth);
+        else if( eLevel >= PIXEL_CONVERT_SSE2 ) SetOpaqueRowSSE2(pDst, nWidth);
+        else
+#endif
+        SetOpaqueRow(pDst, nWidth);
+    }
+}
+
+void SetOpaqueIfNonZero(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight)
+{
+    SetOpaqueIfNonZero(pDst, nDstPitch, nWidth, nHeight, GetPixelConvertLevel());
+}
+
+void RestoreGdiAlpha(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, PixelConvertLevel eLevel)
+{
+    if( nWidth <= 0 ) return;
+    eLevel = ClampLevel(eLevel);
+    for( int y = 0; y < nHeight; y++, pDst += nDstPitch ) {
+#if UI_FRAMEBUFFER_HAVE_SIMD
+        if( eLevel == PIXEL_CONVERT_AVX2 ) RestoreAlphaRowAVX2(pDst, nWidth);
+        else if( eLevel >= PIXEL_CONVERT_SSE2 ) RestoreAlphaRowSSE2(pDst, nWidth);
+        else
+#endif
+        RestoreAlphaRow(pDst, nWidth);
+    }
+}
+
+void RestoreGdiAlpha(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight)
+{
+    RestoreGdiAlpha(pDst, nDstPitch, nWidth, nHeight, GetPixelConvertLevel());
+}
+
+void ApplyAlphaMask(unsigned int* pDst, ptrdiff_t nDstPitch, const unsigned int* pMask, ptrdiff_t nMaskPitch, int nWidth, int nHeight,
+    PixelConvertLevel eLevel)
+{
+    if( nWidth <= 0 ) return;
+    eLevel = ClampLevel(eLevel);
+    for( int y = 0; y < nHeight; y++, pDst += nDstPitch, pMask += nMaskPitch ) {
+#if UI_FRAMEBUFFER_HAVE_SIMD
+        if( eLevel == PIXEL_CONVERT_AVX2 ) AlphaMaskRowAVX2(pDst, pMask, nWidth);
+        else if( eLevel >= PIXEL_CONVERT_SSE2 ) AlphaMaskRowSSE2(pDst, pMask, nWidth);
+        else
+#endif
+        AlphaMaskRow(pDst, pMask, nWidth);
+    }
+}
+
+void ApplyAlphaMask(unsigned int* pDst, ptrdiff_t nDstPitch, const unsigned int* pMask, ptrdiff_t nMaskPitch, int nWidth, int nHeight)
+{
+    ApplyAlphaMask(pDst, nDstPitch, pMask, nMaskPitch, nWidth, nHeight, GetPixelConvertLevel());
+}
+
+} // namespace DuiLib
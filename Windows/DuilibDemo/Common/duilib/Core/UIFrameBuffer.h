@@ -0,0 +1,36 @@
+#ifndef __UIFRAMEBUFFER_H__
+#define __UIFRAMEBUFFER_H__
+
+#pragma once
+
+// 32 位预乘 alpha BGRA 像素缓冲区上的矩形操作，分层窗口的离屏位图每次绘制都要用到。
+// 矩形用左上角像素的地址和行距（以像素为单位，自底向上的 DIB 传负数）表示，
+// x86 上按 CPU 选择 AVX2/SSE2 实现，输出与标量版本逐字节相同。不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include "UIPixelConvert.h"
+
+namespace DuiLib {
+
+	// 矩形内的像素都设为 dwValue
+	void FillPixels(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, unsigned int dwValue);
+	// 复制矩形，两个矩形不能重叠
+	void CopyPixels(unsigned int* pDst, ptrdiff_t nDstPitch, const unsigned int* pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight);
+	// 不为 0 的像素 alpha 置为 255，用于 WM_PRINT 得到的子窗口图像
+	void SetOpaqueIfNonZero(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight);
+	// alpha 为 0 而颜色不为 0 的像素 alpha 置为 255。GDI 绘制会把 alpha 清零，这些像素是 GDI 画上去的
+	void RestoreGdiAlpha(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight);
+	// 用 pMask 的 alpha 裁剪：颜色乘以 mask 的 alpha / 255（截断），alpha 换成 mask 的 alpha
+	void ApplyAlphaMask(unsigned int* pDst, ptrdiff_t nDstPitch, const unsigned int* pMask, ptrdiff_t nMaskPitch, int nWidth, int nHeight);
+
+	// 使用指定的实现，超过 CPU 支持的按 GetPixelConvertLevel 处理；用于和标量版本对比
+	void FillPixels(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, unsigned int dwValue,
+		PixelConvertLevel eLevel);
+	void SetOpaqueIfNonZero(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, PixelConvertLevel eLevel);
+	void RestoreGdiAlpha(unsigned int* pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, PixelConvertLevel eLevel);
+	void ApplyAlphaMask(unsigned int* pDst, ptrdiff_t nDstPitch, const unsigned int* pMask, ptrdiff_t nMaskPitch, int nWidth, int nHeight,
+		PixelConvertLevel eLevel);
+
+} // namespace DuiLib
+
+#endif // __UIFRAMEBUFFER_H__
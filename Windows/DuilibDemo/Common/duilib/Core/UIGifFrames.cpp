@@ -0,0 +1,213 @@
+#include "UIGifFrames.h"
+#include "UIPixelConvert.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 这里单独编译一份只有 GIF 的 stb_image，函数都是 static 的，与 UIRender.cpp 中的完整版本互不影响
+#define STB_IMAGE_STATIC
+#define STBI_ONLY_GIF
+#define STBI_NO_STDIO
+#define STBI_NO_FAILURE_STRINGS
+#define STB_IMAGE_IMPLEMENTATION
+#include "../Utils/stb_image.h"
+
+namespace DuiLib {
+
+namespace {
+
+const unsigned int GIF_DEFAULT_DELAY = 100;
+
+enum
+{
+    GIF_DISPOSE_NONE = 1,
+    GIF_DISPOSE_BACKGROUND = 2,
+    GIF_DISPOSE_PREVIOUS = 3,
+};
+
+// 按上一帧的处置方式处理画面，g->out 是上一帧的画面，区域还是上一帧的区域。
+// pRestore 是画上一帧之前的画面，为 NULL 时上一帧是第一帧，之前的画面全透明
+void DisposeFrame(stbi__gif* g, const stbi_uc* pRestore)
+{
+    int nDispose = (g->eflags & 0x1C) >> 2;
+    if( nDispose != GIF_DISPOSE_BACKGROUND && nDispose != GIF_DISPOSE_PREVIOUS ) return;
+    // 背景色一律按透明处理，和浏览器一致
+    if( nDispose == GIF_DISPOSE_BACKGROUND ) pRestore = NULL;
+    int cbRow = g->max_x - g->start_x;
+    for( int y = g->start_y; y < g->max_y; y += g->line_size ) {
+        if( pRestore != NULL ) memcpy(g->out + y + g->start_x, pRestore + y + g->start_x, cbRow);
+        else memset(g->out + y + g->start_x, 0, cbRow);
+    }
+}
+
+} // namespace
+
+CGifFrames::CGifFrames() : m_nWidth(0), m_nHeight(0), m_bAlpha(false), m_nDuration(0)
+{
+}
+
+bool CGifFrames::Decode(const unsigned char* pData, size_t nSize, size_t nMaxBytes)
+{
+    Clear();
+    if( pData == NULL || nSize < 13 || nSize > 0x7FFFFFFF ) return false;
+    if( memcmp(pData, "GIF87a", 6) != 0 && memcmp(pData, "GIF89a", 6) != 0 ) return false;
+    // stb 用 int 计算画面大小，先检查尺寸
+    int nWidth = pData[6] | (pData[7] << 8);
+    int nHeight = pData[8] | (pData[9] << 8);
+    if( nWidth == 0 || nHeight == 0 ) return false;
+    unsigned long long nFrameBytes = (unsigned long long)nWidth * nHeight * 4;
+    if( nFrameBytes > 0x7FFFFFFF || nFrameBytes > nMaxBytes ) return false;
+
+    stbi__context s;
+    stbi__start_mem(&s, pData, (int)nSize);
+    stbi__gif* g = (stbi__gif*)calloc(1, sizeof(stbi__gif));
+    if( g == NULL ) return false;
+
+    // stb 每一帧都新分配画面，上一帧的画面在 stb 复制之后正好是画这一帧之前的画面，留给“恢复到前一帧”使用
+    stbi_uc* pRestore = NULL;
+    for( ;; ) {
+        stbi_uc* pPrev = g->out;
+        if( pPrev != NULL ) {
+            DisposeFrame(g, pRestore);
+            // 处置已经做过，让 stb 原样复制上一帧的画面；同时去掉透明色标志，图形控制扩展只作用于一帧
+            g->eflags = GIF_DISPOSE_NONE << 2;
+        }
+        g->delay = 0;
+        int nComp = 0;
+        stbi_uc* pOut = stbi__gif_load_next(&s, g, &nComp, 4);
+        // 不使用 stb 的 old_out，所有中间画面由这里释放
+        g->old_out = NULL;
+        if( pPrev != NULL && pPrev != g->out ) {
+            STBI_FREE(pRestore);
+            pRestore = pPrev;
+        }
+        // NULL 为出错，返回 s 表示读到结束符
+        if( pOut == NULL || pOut == (stbi_uc*)&s ) break;
+        if( m_aPixels.size() + nFrameBytes > nMaxBytes ) break;
+
+        size_t nOffset = m_aPixels.size();
+        m_aPixels.resize(nOffset + (size_t)nFrameBytes);
+        if( ConvertToPremultipliedBGRA(g->out, &m_aPixels[nOffset], (size_t)nWidth * nHeight, 0) ) m_bAlpha = true;
+        unsigned int nDelay = (unsigned int)g->delay * 10;
+        if( nDelay == 0 ) nDelay = GIF_DEFAULT_DELAY;
+        m_aDelays.push_back(nDelay);
+        m_nDuration += nDelay;
+    }
+    STBI_FREE(g->out);
+    STBI_FREE(pRestore);
+    free(g);
+
+    if( m_aDelays.empty() ) {
+        Clear();
+        return false;
+    }
+    m_nWidth = nWidth;
+    m_nHeight = nHeight;
+    return true;
+}
+
+bool CGifFrames::Assign(const unsigned char* pRGBA, int nWidth, int nHeight)
+{
+    Clear();
+    if( pRGBA == NULL || nWidth <= 0 || nHeight <= 0 ) return false;
+    size_t nPixels = (size_t)nWidth * nHeight;
+    m_aPixels.resize(nPixels * 4);
+    m_bAlpha = ConvertToPremultipliedBGRA(pRGBA, &m_aPixels[0], nPixels, 0);
+    m_aDelays.push_back(GIF_DEFAULT_DELAY);
+    m_nDuration = GIF_DEFAULT_DELAY;
+    m_nWidth = nWidth;
+    m_nHeight = nHeight;
+    return true;
+}
+
+void CGifFrames::Clear()
+{
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_bAlpha = false;
+    m_nDuration = 0;
+    std::vector<unsigned int>().swap(m_aDelays);
+    std::vector<unsigned char>().swap(m_aPixels);
+}
+
+void CGifFrames::Truncate(int nFrames)
+{
+    if( nFrames < 0 ) nFrames = 0;
+    if( nFrames >= GetFrameCount() ) return;
+    if( nFrames == 0 ) {
+        Clear();
+        return;
+    }
+    m_aDelays.resize(nFrames);
+    m_nDuration = 0;
+    for( size_t i = 0; i < m_aDelays.size(); i++ ) m_nDuration += m_aDelays[i];
+    if( !m_aPixels.empty() ) {
+        std::vector<unsigned char>(m_aPixels.begin(), m_aPixels.begin() + (size_t)nFrames * m_nWidth * m_nHeight * 4).swap(m_aPixels);
+    }
+}
+
+void CGifFrames::FreePixels()
+{
+    std::vector<unsigned char>().swap(m_aPixels);
+}
+
+int CGifFrames::GetWidth() const
+{
+    return m_nWidth;
+}
+
+int CGifFrames::GetHeight() const
+{
+    return m_nHeight;
+}
+
+int CGifFrames::GetFrameCount() const
+{
+    return (int)m_aDelays.size();
+}
+
+bool CGifFrames::HasAlpha() const
+{
+    return m_bAlpha;
+}
+
+const unsigned char* CGifFrames::GetPixels() const
+{
+    return m_aPixels.empty() ? NULL : &m_aPixels[0];
+}
+
+const unsigned char* CGifFrames::GetFrameBits(int iFrame) const
+{
+    if( m_aPixels.empty() || iFrame < 0 || iFrame >= GetFrameCount() ) return NULL;
+    return &m_aPixels[(size_t)iFrame * m_nWidth * m_nHeight * 4];
+}
+
+unsigned int CGifFrames::GetFrameDelay(int iFrame) const
+{
+    if( iFrame < 0 || iFrame >= GetFrameCount() ) return 0;
+    return m_aDelays[iFrame];
+}
+
+unsigned int CGifFrames::GetDuration() const
+{
+    return m_nDuration;
+}
+
+unsigned int CGifFrames::Advance(int& iFrame, unsigned int nDue, unsigned int nNow) const
+{
+    int nCount = GetFrameCount();
+    if( nCount == 0 ) {
+        iFrame = 0;
+        return nNow;
+    }
+    if( iFrame < 0 || iFrame >= nCount ) iFrame = 0;
+    // 按差值比较，GetTickCount 回绕时也正确
+    if( (int)(nNow - nDue) < 0 ) return nDue;
+    if( nNow - nDue >= m_nDuration ) nDue = nNow;
+    do {
+        iFrame = (iFrame + 1) % nCount;
+        nDue += m_aDelays[iFrame];
+    } while( (int)(nNow - nDue) >= 0 );
+    return nDue;
+}
+
+} // namespace DuiLib
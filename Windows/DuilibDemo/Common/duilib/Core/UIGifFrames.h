@@ -0,0 +1,62 @@
+#ifndef __UIGIFFRAMES_H__
+#define __UIGIFFRAMES_H__
+
+#pragma once
+
+// GIF 动画的所有帧：整个文件只解码一次，每一帧都是合成好的整幅画面，像素为预乘 alpha 的 BGRA，
+// 各帧从上到下连续存放，可以直接复制到一张高为帧数倍的位图。
+// 1. 解码使用 stb_image 的 GIF 部分，并修正它在动画上的几个问题：处置方式 0 按“不处置”处理，
+//    “恢复到前一帧”恢复的是画这一帧之前的画面，图形控制扩展只作用于紧跟着的一帧，中间缓冲不再泄漏；
+// 2. 帧间隔以毫秒为单位，0 按 100 毫秒处理，与原来使用 GDI+ 时相同；
+// 3. Advance 按累计的到期时间换帧，定时器晚到时跳过已经过期的帧，动画速度不受定时器精度影响。
+// 不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <vector>
+
+namespace DuiLib {
+
+	class CGifFrames
+	{
+	public:
+		CGifFrames();
+
+		// 解码 GIF 文件，不是 GIF 或一帧都解不出来时返回 false。
+		// 中途出错或解码后的像素超过 nMaxBytes 时保留前面已经完成的帧
+		bool Decode(const unsigned char* pData, size_t nSize, size_t nMaxBytes = 256 * 1024 * 1024);
+		// 只有一帧的普通图片，pRGBA 为 stb_image 输出的 RGBA
+		bool Assign(const unsigned char* pRGBA, int nWidth, int nHeight);
+		void Clear();
+		// 只保留前 nFrames 帧，帧数不超过 nFrames 时不变；用于位图放不下所有帧的时候
+		void Truncate(int nFrames);
+		// 像素复制到位图之后释放，尺寸、帧数和帧间隔保留
+		void FreePixels();
+
+		int GetWidth() const;
+		int GetHeight() const;
+		int GetFrameCount() const;
+		bool HasAlpha() const;
+		// 所有帧的像素，FreePixels 之后为 NULL
+		const unsigned char* GetPixels() const;
+		const unsigned char* GetFrameBits(int iFrame) const;
+		// 第 iFrame 帧显示的毫秒数
+		unsigned int GetFrameDelay(int iFrame) const;
+		// 播放一轮的毫秒数
+		unsigned int GetDuration() const;
+
+		// 第 iFrame 帧显示到 nDue 为止，到 nNow 时换成应该显示的帧，返回新一帧的到期时间。
+		// 时间是回绕的毫秒计数（GetTickCount），落后超过一轮时不再追赶，从 nNow 开始显示下一帧
+		unsigned int Advance(int& iFrame, unsigned int nDue, unsigned int nNow) const;
+
+	private:
+		int m_nWidth;
+		int m_nHeight;
+		bool m_bAlpha;
+		unsigned int m_nDuration;
+		std::vector<unsigned int> m_aDelays;
+		std::vector<unsigned char> m_aPixels;
+	};
+
+} // namespace DuiLib
+
+#endif // __UIGIFFRAMES_H__
@@ -0,0 +1,924 @@
+#include "UIHtmlText.h"
+#include <algorithm>
+
+namespace DuiLib {
+
+namespace {
+
+struct TPoint
+{
+    int x;
+    int y;
+};
+
+template<typename T>
+const T* SkipSpace(IHtmlTextHostT<T>* pHost, const T* p)
+{
+    while( *p > T('\0') && *p <= T(' ') ) p = pHost->CharNext(p);
+    return p;
+}
+
+// 与 VC 运行库的 _tcstol 相同：long 为 32 位，溢出时取边界值，没有数字时 *ppEnd 指向开头
+template<typename T>
+int StrToL(const T* pstr, const T** ppEnd, int nBase)
+{
+    const T* p = pstr;
+    while( *p == T(' ') || ( *p >= T('\t') && *p <= T('\r') ) ) p++;
+    bool bNegative = false;
+    if( *p == T('-') ) bNegative = true, p++;
+    else if( *p == T('+') ) p++;
+    if( nBase == 16 && p[0] == T('0') && ( p[1] == T('x') || p[1] == T('X') ) ) p += 2;
+    const T* pDigits = p;
+    unsigned long long nValue = 0;
+    for( ;; p++ ) {
+        int nDigit;
+        if( *p >= T('0') && *p <= T('9') ) nDigit = *p - T('0');
+        else if( *p >= T('a') && *p <= T('z') ) nDigit = *p - T('a') + 10;
+        else if( *p >= T('A') && *p <= T('Z') ) nDigit = *p - T('A') + 10;
+        else break;
+        if( nDigit >= nBase ) break;
+        if( nValue <= 0x80000000ULL ) nValue = nValue * nBase + nDigit;
+    }
+    if( p == pDigits ) {
+        *ppEnd = pstr;
+        return 0;
+    }
+    *ppEnd = p;
+    if( bNegative ) return nValue >= 0x80000000ULL ? (int)0x80000000 : -(int)nValue;
+    return nValue > 0x7FFFFFFFULL ? 0x7FFFFFFF : (int)nValue;
+}
+
+template<typename T>
+bool FindAscii(const T* pstr, const char* pstrSub)
+{
+    for( ; *pstr != T('\0'); pstr++ ) {
+        int i = 0;
+        while( pstrSub[i] != '\0' && pstr[i] == T(pstrSub[i]) ) i++;
+        if( pstrSub[i] == '\0' ) return true;
+    }
+    return false;
+}
+
+template<typename T>
+bool EqualsAscii(const std::basic_string<T>& s, const char* pstr)
+{
+    size_t i = 0;
+    for( ; i < s.size(); i++ ) {
+        if( pstr[i] == '\0' || s[i] != T(pstr[i]) ) return false;
+    }
+    return pstr[i] == '\0';
+}
+
+template<typename T>
+void AppendChar(IHtmlTextHostT<T>* pHost, std::basic_string<T>& s, const T*& p)
+{
+    const T* pNext = pHost->CharNext(p);
+    while( p < pNext ) s += *p++;
+}
+
+inline void SetLayoutRect(TLayoutRect& rc, int left, int top, int right, int bottom)
+{
+    rc.left = left;
+    rc.top = top;
+    rc.right = right;
+    rc.bottom = bottom;
+}
+
+inline int MinInt(int a, int b) { return a < b ? a : b; }
+inline int MaxInt(int a, int b) { return a > b ? a : b; }
+
+// 排版时的状态。按原来的两步画法，每一行先测量行高，再从行首重新走一遍输出
+template<typename T>
+class CHtmlTextBuilder
+{
+public:
+    typedef typename CHtmlTextLayoutT<T>::Color Color;
+    typedef typename CHtmlTextLayoutT<T>::Run Run;
+
+    CHtmlTextBuilder(IHtmlTextHostT<T>* pHost, CHtmlTextLayoutT<T>& layout, const T* pstrText)
+        : m_pHost(pHost), m_layout(layout), m_pstrBegin(pstrText), m_pFont(NULL), m_bColorChanged(true), m_bOpaque(false)
+    {
+        m_color.nType = HTMLTEXT_COLOR_DEFAULT;
+        m_color.dwColor = 0;
+    }
+
+    void Build(int iFont, unsigned int uStyle, int nLinkRects);
+
+private:
+    void SelectFont(void* pFont)
+    {
+        m_pFont = pFont;
+        m_pHost->GetFontMetrics(pFont, m_tm);
+    }
+
+    void SetColor(const Color& color)
+    {
+        m_color = color;
+        m_bColorChanged = true;
+    }
+
+    void SetColor(const std::vector<Color>& aColors)
+    {
+        if( aColors.empty() ) {
+            Color color;
+            color.nType = HTMLTEXT_COLOR_DEFAULT;
+            color.dwColor = 0;
+            SetColor(color);
+        }
+        else SetColor(aColors.back());
+    }
+
+    int MeasureText(const T* pstr, int cch, int cxFailed)
+    {
+        // GetTextExtentPoint32 对负数长度失败，不改变原来的尺寸
+        if( cch < 0 ) return cxFailed;
+        return m_pHost->MeasureText(m_pFont, pstr, cch);
+    }
+
+    Run& AddRun(int nType, int x, int y)
+    {
+        if( m_bColorChanged ) {
+            if( m_layout.aColors.empty() || !( m_layout.aColors.back() == m_color ) ) m_layout.aColors.push_back(m_color);
+            m_bColorChanged = false;
+        }
+        Run run = Run();
+        run.nType = nType;
+        run.x = x;
+        run.y = y;
+        run.pFont = m_pFont;
+        run.iColor = (int)m_layout.aColors.size() - 1;
+        run.bSelected = m_bOpaque;
+        m_layout.aRuns.push_back(run);
+        return m_layout.aRuns.back();
+    }
+
+    void AddText(int x, int y, const T* pstr, int cch)
+    {
+        // TextOut 对负数长度失败，什么也不画
+        if( cch < 0 ) return;
+        Run& run = AddRun(HTMLTEXT_RUN_TEXT, x, y);
+        run.iText = (int)(pstr - m_pstrBegin);
+        run.cchText = cch;
+    }
+
+    void SetLinkRect(int i, int left, int top, int right, int bottom)
+    {
+        SetLayoutRect(m_layout.aLinks[i].rc, left, top, right, bottom);
+        m_layout.aLinks[i].bRect = true;
+    }
+
+    int LineHeight(const std::vector<int>& aPIndents) const
+    {
+        return m_tm.nHeight + m_tm.nExternalLeading + ( aPIndents.empty() ? 0 : aPIndents.back() );
+    }
+
+    void* TopFont(const std::vector<void*>& aFonts, void* pDefFont) const
+    {
+        return aFonts.empty() ? pDefFont : aFonts.back();
+    }
+
+private:
+    IHtmlTextHostT<T>* m_pHost;
+    CHtmlTextLayoutT<T>& m_layout;
+    const T* m_pstrBegin;
+    // 相当于原来 DC 上选入的字体、文字颜色和背景模式
+    void* m_pFont;
+    THtmlFontMetrics m_tm;
+    Color m_color;
+    bool m_bColorChanged;
+    bool m_bOpaque;
+};
+
+template<typename T>
+void CHtmlTextBuilder<T>::Build(int iFont, unsigned int uStyle, int nLinkRects)
+{
+    IHtmlTextHostT<T>* pHost = m_pHost;
+    TLayoutRect& rc = m_layout.rc;
+    const T* pstrText = m_pstrBegin;
+    bool bDraw = (uStyle & HTMLTEXT_CALCRECT) == 0;
+
+    std::vector<void*> aFontArray;
+    std::vector<Color> aColorArray;
+    std::vector<int> aPIndentArray;
+
+    void* pDefFont = pHost->GetFont(iFont);
+    SelectFont(pDefFont);
+
+    // 有对齐方式时先计算文字的大小，才能确定输出的位置
+    if( ( (uStyle & HTMLTEXT_CENTER) != 0 || (uStyle & HTMLTEXT_RIGHT) != 0 || (uStyle & HTMLTEXT_VCENTER) != 0 || (uStyle & HTMLTEXT_BOTTOM) != 0 ) && bDraw ) {
+        CHtmlTextLayoutT<T> text;
+        text.Build(pHost, m_pstrBegin, 9999, 100, iFont, uStyle | HTMLTEXT_CALCRECT, 0);
+        const TLayoutRect& rcText = text.rc;
+        if( (uStyle & HTMLTEXT_SINGLELINE) != 0 ) {
+            if( (uStyle & HTMLTEXT_CENTER) != 0 ) {
+                rc.left = rc.left + ((rc.right - rc.left) / 2) - ((rcText.right - rcText.left) / 2);
+                rc.right = rc.left + (rcText.right - rcText.left);
+            }
+            if( (uStyle & HTMLTEXT_RIGHT) != 0 ) {
+                rc.left = rc.right - (rcText.right - rcText.left);
+            }
+        }
+        if( (uStyle & HTMLTEXT_VCENTER) != 0 ) {
+            rc.top = rc.top + ((rc.bottom - rc.top) / 2) - ((rcText.bottom - rcText.top) / 2);
+            rc.bottom = rc.top + (rcText.bottom - rcText.top);
+        }
+        if( (uStyle & HTMLTEXT_BOTTOM) != 0 ) {
+            rc.top = rc.bottom - (rcText.bottom - rcText.top);
+        }
+    }
+
+    TPoint pt = { rc.left, rc.top };
+    int iLinkIndex = 0;
+    int cyLine = LineHeight(aPIndentArray);
+    int cyMinHeight = HTMLTEXT_ZERO;
+    int cxMaxWidth = HTMLTEXT_ZERO;
+    TPoint ptLinkStart = { HTMLTEXT_ZERO, HTMLTEXT_ZERO };
+    bool bLineEnd = false;
+    bool bInRaw = false;
+    bool bInLink = false;
+    bool bInSelected = false;
+    int iLineLinkIndex = 0;
+
+    // 排版习惯是图文底部对齐，所以每行都要分两步，先计算高度，再输出
+    std::vector<void*> aLineFontArray;
+    std::vector<Color> aLineColorArray;
+    std::vector<int> aLinePIndentArray;
+    const T* pstrLineBegin = pstrText;
+    const T* pstrCalcLineBegin = pstrText;
+    bool bLineInRaw = false;
+    bool bLineInLink = false;
+    bool bLineInSelected = false;
+    int cyLineHeight = 0;
+    bool bLineDraw = false; // 行的第二步：输出
+    while( *pstrText != T('\0') ) {
+        if( pt.x >= rc.right || *pstrText == T('\n') || bLineEnd ) {
+            if( *pstrText == T('\n') ) pstrText++;
+            if( bLineEnd ) bLineEnd = false;
+            if( !bLineDraw ) {
+                if( bInLink && iLinkIndex < nLinkRects ) {
+                    SetLinkRect(iLinkIndex++, ptLinkStart.x, ptLinkStart.y, MinInt(pt.x, rc.right), pt.y + cyLine);
+                    // 链接延续到下一行，下一个链接区域的内容相同。原来在数组已满时会写到数组之外
+                    if( iLinkIndex < nLinkRects ) {
+                        if( !m_layout.aLinks[iLinkIndex - 1].bLink ) m_layout.bCallerLinks = true;
+                        m_layout.aLinks[iLinkIndex].sLink = m_layout.aLinks[iLinkIndex - 1].sLink;
+                        m_layout.aLinks[iLinkIndex].bLink = true;
+                    }
+                }
+                for( int i = iLineLinkIndex; i < iLinkIndex; i++ ) {
+                    m_layout.aLinks[i].rc.bottom = pt.y + cyLine;
+                    m_layout.aLinks[i].bRect = true;
+                }
+                if( bDraw ) {
+                    bInLink = bLineInLink;
+                    iLinkIndex = iLineLinkIndex;
+                }
+            }
+            else {
+                if( bInLink && iLinkIndex < nLinkRects ) iLinkIndex++;
+                bLineInLink = bInLink;
+                iLineLinkIndex = iLinkIndex;
+            }
+            if( (uStyle & HTMLTEXT_SINGLELINE) != 0 && (!bDraw || bLineDraw) ) break;
+            // 只计算大小时没有高度限制，一行什么也放不下时（如很窄的区域中的 DT_END_ELLIPSIS）原来会一直换行下去
+            if( !bDraw && pstrText == pstrCalcLineBegin ) break;
+            pstrCalcLineBegin = pstrText;
+            if( bDraw ) bLineDraw = !bLineDraw; // !
+            pt.x = rc.left;
+            if( !bLineDraw ) pt.y += cyLine;
+            if( pt.y > rc.bottom && bDraw ) break;
+            ptLinkStart = pt;
+            cyLine = LineHeight(aPIndentArray);
+            if( pt.x >= rc.right ) break;
+        }
+        else if( !bInRaw && ( *pstrText == T('<') || *pstrText == T('{') )
+            && ( pstrText[1] >= T('a') && pstrText[1] <= T('z') )
+            && ( pstrText[2] == T(' ') || pstrText[2] == T('>') || pstrText[2] == T('}') ) ) {
+            pstrText++;
+            const T* pstrNextStart = NULL;
+            switch( *pstrText ) {
+            case T('a'):  // Link
+                {
+                    pstrText++;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    if( iLinkIndex < nLinkRects && !bLineDraw ) {
+                        typename CHtmlTextLayoutT<T>::Link& link = m_layout.aLinks[iLinkIndex];
+                        link.sLink.clear();
+                        link.bLink = true;
+                        while( *pstrText != T('\0') && *pstrText != T('>') && *pstrText != T('}') ) AppendChar(pHost, link.sLink, pstrText);
+                    }
+
+                    Color color;
+                    color.nType = HTMLTEXT_COLOR_DEFAULT;
+                    color.dwColor = 0;
+                    if( iLinkIndex < nLinkRects ) {
+                        color.nType = HTMLTEXT_COLOR_LINK;
+                        if( !m_layout.aLinks[iLinkIndex].bLink ) m_layout.bCallerLinks = true;
+                        color.sLink = m_layout.aLinks[iLinkIndex].sLink;
+                    }
+                    aColorArray.push_back(color);
+                    SetColor(color);
+                    void* pFont = TopFont(aFontArray, pDefFont);
+                    THtmlFontMetrics tm;
+                    pHost->GetFontMetrics(pFont, tm);
+                    if( tm.bUnderline == false ) {
+                        pFont = pHost->DeriveFont(pFont, tm.bBold, true, tm.bItalic);
+                        aFontArray.push_back(pFont);
+                        SelectFont(pFont);
+                        cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                    }
+                    ptLinkStart = pt;
+                    bInLink = true;
+                }
+                break;
+            case T('b'):  // Bold
+                {
+                    pstrText++;
+                    void* pFont = TopFont(aFontArray, pDefFont);
+                    THtmlFontMetrics tm;
+                    pHost->GetFontMetrics(pFont, tm);
+                    if( tm.bBold == false ) {
+                        pFont = pHost->DeriveFont(pFont, true, tm.bUnderline, tm.bItalic);
+                        aFontArray.push_back(pFont);
+                        SelectFont(pFont);
+                        cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                    }
+                }
+                break;
+            case T('c'):  // Color
+                {
+                    pstrText++;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    if( *pstrText == T('#') ) pstrText++;
+                    Color color;
+                    color.nType = HTMLTEXT_COLOR_VALUE;
+                    color.dwColor = (unsigned int)StrToL(pstrText, &pstrText, 16);
+                    aColorArray.push_back(color);
+                    SetColor(color);
+                }
+                break;
+            case T('f'):  // Font
+                {
+                    pstrText++;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    const T* pstrTemp = pstrText;
+                    int iFontId = StrToL(pstrText, &pstrText, 10);
+                    void* pFont = NULL;
+                    if( pstrTemp != pstrText ) {
+                        pFont = pHost->GetFont(iFontId);
+                    }
+                    else {
+                        std::basic_string<T> sFontName;
+                        int iFontSize = 10;
+                        std::basic_string<T> sFontAttr;
+                        while( *pstrText != T('\0') && *pstrText != T('>') && *pstrText != T('}') && *pstrText != T(' ') ) AppendChar(pHost, sFontName, pstrText);
+                        pstrText = SkipSpace(pHost, pstrText);
+                        if( *pstrText >= T('0') && *pstrText <= T('9') ) {
+                            iFontSize = StrToL(pstrText, &pstrText, 10);
+                        }
+                        pstrText = SkipSpace(pHost, pstrText);
+                        while( *pstrText != T('\0') && *pstrText != T('>') && *pstrText != T('}') ) AppendChar(pHost, sFontAttr, pstrText);
+                        for( size_t i = 0; i < sFontAttr.size(); i++ ) {
+                            if( sFontAttr[i] >= T('A') && sFontAttr[i] <= T('Z') ) sFontAttr[i] = (T)(sFontAttr[i] - T('A') + T('a'));
+                        }
+                        bool bBold = FindAscii(sFontAttr.c_str(), "bold");
+                        bool bUnderline = FindAscii(sFontAttr.c_str(), "underline");
+                        bool bItalic = FindAscii(sFontAttr.c_str(), "italic");
+                        pFont = pHost->GetFont(sFontName.c_str(), iFontSize, bBold, bUnderline, bItalic);
+                    }
+                    aFontArray.push_back(pFont);
+                    SelectFont(pFont);
+                    cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                }
+                break;
+            case T('i'):  // Italic or Image
+                {
+                    pstrNextStart = pstrText - 1;
+                    pstrText++;
+                    // 原来复制了之后的全部文字，file=' 和 res=' 在整个剩余文字中查找
+                    const T* pstrImageString = pstrText;
+                    int iWidth = 0;
+                    int iHeight = 0;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    void* pImage = NULL;
+                    std::basic_string<T> sName;
+                    while( *pstrText != T('\0') && *pstrText != T('>') && *pstrText != T('}') && *pstrText != T(' ') ) AppendChar(pHost, sName, pstrText);
+                    if( sName.empty() ) { // Italic
+                        pstrNextStart = NULL;
+                        void* pFont = TopFont(aFontArray, pDefFont);
+                        THtmlFontMetrics tm;
+                        pHost->GetFontMetrics(pFont, tm);
+                        if( tm.bItalic == false ) {
+                            pFont = pHost->DeriveFont(pFont, tm.bBold, tm.bUnderline, true);
+                            aFontArray.push_back(pFont);
+                            SelectFont(pFont);
+                            cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                        }
+                    }
+                    else {
+                        pstrText = SkipSpace(pHost, pstrText);
+                        int iImageListNum = StrToL(pstrText, &pstrText, 10);
+                        if( iImageListNum <= 0 ) iImageListNum = 1;
+                        pstrText = SkipSpace(pHost, pstrText);
+                        int iImageListIndex = StrToL(pstrText, &pstrText, 10);
+                        if( iImageListIndex < 0 || iImageListIndex >= iImageListNum ) iImageListIndex = 0;
+
+                        if( FindAscii(pstrImageString, "file=\'") || FindAscii(pstrImageString, "res=\'") ) {
+                            std::basic_string<T> sImageResType;
+                            std::basic_string<T> sImageName;
+                            const T* pStrImage = pstrImageString;
+                            std::basic_string<T> sItem;
+                            std::basic_string<T> sValue;
+                            while( *pStrImage != T('\0') ) {
+                                sItem.clear();
+                                sValue.clear();
+                                pStrImage = SkipSpace(pHost, pStrImage);
+                                while( *pStrImage != T('\0') && *pStrImage != T('=') && *pStrImage > T(' ') ) AppendChar(pHost, sItem, pStrImage);
+                                pStrImage = SkipSpace(pHost, pStrImage);
+                                if( *pStrImage++ != T('=') ) break;
+                                pStrImage = SkipSpace(pHost, pStrImage);
+                                if( *pStrImage++ != T('\'') ) break;
+                                while( *pStrImage != T('\0') && *pStrImage != T('\'') ) AppendChar(pHost, sValue, pStrImage);
+                                if( *pStrImage++ != T('\'') ) break;
+                                if( !sValue.empty() ) {
+                                    if( EqualsAscii(sItem, "file") || EqualsAscii(sItem, "res") ) {
+                                        sImageName = sValue;
+                                    }
+                                    else if( EqualsAscii(sItem, "restype") ) {
+                                        sImageResType = sValue;
+                                    }
+                                }
+                                if( *pStrImage++ != T(' ') ) break;
+                            }
+
+                            pImage = pHost->GetImage(sImageName.c_str(), sImageResType.c_str(), iWidth, iHeight);
+                        }
+                        else
+                            pImage = pHost->GetImage(sName.c_str(), NULL, iWidth, iHeight);
+
+                        if( pImage ) {
+                            if( iImageListNum > 1 ) iWidth /= iImageListNum;
+
+                            if( pt.x + iWidth > rc.right && pt.x > rc.left && (uStyle & HTMLTEXT_SINGLELINE) == 0 ) {
+                                bLineEnd = true;
+                            }
+                            else {
+                                pstrNextStart = NULL;
+                                if( bDraw && bLineDraw ) {
+                                    Run& run = AddRun(HTMLTEXT_RUN_IMAGE, pt.x, pt.y);
+                                    run.pImage = pImage;
+                                    SetLayoutRect(run.rcImage, pt.x, pt.y + cyLineHeight - iHeight, pt.x + iWidth, pt.y + cyLineHeight);
+                                    if( iHeight < cyLineHeight ) {
+                                        run.rcImage.bottom -= (cyLineHeight - iHeight) / 2;
+                                        run.rcImage.top = run.rcImage.bottom - iHeight;
+                                    }
+                                    SetLayoutRect(run.rcBmpPart, iWidth * iImageListIndex, 0, iWidth * (iImageListIndex + 1), iHeight);
+                                }
+
+                                cyLine = MaxInt(iHeight, cyLine);
+                                pt.x += iWidth;
+                                cyMinHeight = pt.y + iHeight;
+                                cxMaxWidth = MaxInt(cxMaxWidth, pt.x);
+                            }
+                        }
+                        else pstrNextStart = NULL;
+                    }
+                }
+                break;
+            case T('n'):  // Newline
+                {
+                    pstrText++;
+                    if( (uStyle & HTMLTEXT_SINGLELINE) != 0 ) break;
+                    bLineEnd = true;
+                }
+                break;
+            case T('p'):  // Paragraph
+                {
+                    pstrText++;
+                    if( pt.x > rc.left ) bLineEnd = true;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    int cyLineExtra = StrToL(pstrText, &pstrText, 10);
+                    aPIndentArray.push_back(cyLineExtra);
+                    cyLine = MaxInt(cyLine, m_tm.nHeight + m_tm.nExternalLeading + cyLineExtra);
+                }
+                break;
+            case T('r'):  // Raw Text
+                {
+                    pstrText++;
+                    bInRaw = true;
+                }
+                break;
+            case T('s'):  // Selected text background color
+                {
+                    pstrText++;
+                    bInSelected = !bInSelected;
+                    if( bDraw && bLineDraw ) m_bOpaque = bInSelected;
+                }
+                break;
+            case T('u'):  // Underline text
+                {
+                    pstrText++;
+                    void* pFont = TopFont(aFontArray, pDefFont);
+                    THtmlFontMetrics tm;
+                    pHost->GetFontMetrics(pFont, tm);
+                    if( tm.bUnderline == false ) {
+                        pFont = pHost->DeriveFont(pFont, tm.bBold, true, tm.bItalic);
+                        aFontArray.push_back(pFont);
+                        SelectFont(pFont);
+                        cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                    }
+                }
+                break;
+            case T('x'):  // X Indent
+                {
+                    pstrText++;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    int iWidth = StrToL(pstrText, &pstrText, 10);
+                    pt.x += iWidth;
+                    cxMaxWidth = MaxInt(cxMaxWidth, pt.x);
+                }
+                break;
+            case T('y'):  // Y Indent
+                {
+                    pstrText++;
+                    pstrText = SkipSpace(pHost, pstrText);
+                    cyLine = StrToL(pstrText, &pstrText, 10);
+                }
+                break;
+            }
+            if( pstrNextStart != NULL ) pstrText = pstrNextStart;
+            else {
+                while( *pstrText != T('\0') && *pstrText != T('>') && *pstrText != T('}') ) pstrText = pHost->CharNext(pstrText);
+                pstrText = pHost->CharNext(pstrText);
+            }
+        }
+        else if( !bInRaw && ( *pstrText == T('<') || *pstrText == T('{') ) && pstrText[1] == T('/') ) {
+            pstrText++;
+            pstrText++;
+            switch( *pstrText ) {
+            case T('c'):
+                {
+                    pstrText++;
+                    if( !aColorArray.empty() ) aColorArray.pop_back();
+                    SetColor(aColorArray);
+                }
+                break;
+            case T('p'):
+                pstrText++;
+                if( pt.x > rc.left ) bLineEnd = true;
+                if( !aPIndentArray.empty() ) aPIndentArray.pop_back();
+                cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                break;
+            case T('s'):
+                {
+                    pstrText++;
+                    bInSelected = !bInSelected;
+                    if( bDraw && bLineDraw ) m_bOpaque = bInSelected;
+                }
+                break;
+            case T('a'):
+                {
+                    if( iLinkIndex < nLinkRects ) {
+                        if( !bLineDraw ) SetLinkRect(iLinkIndex, ptLinkStart.x, ptLinkStart.y, MinInt(pt.x, rc.right), pt.y + m_tm.nHeight + m_tm.nExternalLeading);
+                        iLinkIndex++;
+                    }
+                    if( !aColorArray.empty() ) aColorArray.pop_back();
+                    SetColor(aColorArray);
+                    bInLink = false;
+                }
+                // fall through - </a> 同时结束链接的下划线字体
+            case T('b'):
+            case T('f'):
+            case T('i'):
+            case T('u'):
+                {
+                    pstrText++;
+                    if( !aFontArray.empty() ) aFontArray.pop_back();
+                    void* pFont = TopFont(aFontArray, pDefFont);
+                    THtmlFontMetrics tm;
+                    pHost->GetFontMetrics(pFont, tm);
+                    if( m_tm.bItalicFace && tm.bItalic == false ) {
+                        pt.x += pHost->GetSpaceOverhang(m_pFont) / 2; // 简单修正一下斜体混排的问题, 正确做法应该是http://support.microsoft.com/kb/244798/en-us
+                    }
+                    SelectFont(pFont);
+                    cyLine = MaxInt(cyLine, LineHeight(aPIndentArray));
+                }
+                break;
+            }
+            while( *pstrText != T('\0') && *pstrText != T('>') && *pstrText != T('}') ) pstrText = pHost->CharNext(pstrText);
+            pstrText = pHost->CharNext(pstrText);
+        }
+        else if( !bInRaw && ( ( *pstrText == T('<') && ( pstrText[1] == T('{') || pstrText[1] == T('}') ) && pstrText[2] == T('>') )
+            || ( *pstrText == T('{') && ( pstrText[1] == T('<') || pstrText[1] == T('>') ) && pstrText[2] == T('}') ) ) ) {
+            // <{> <}> {<} {>} 输出一个括号
+            int cxChar = MeasureText(&pstrText[1], 1, 0);
+            if( bDraw && bLineDraw ) AddText(pt.x, pt.y + cyLineHeight - m_tm.nHeight - m_tm.nExternalLeading, &pstrText[1], 1);
+            pt.x += cxChar;
+            cxMaxWidth = MaxInt(cxMaxWidth, pt.x);
+            pstrText += 3;
+        }
+        else if( !bInRaw && *pstrText == T(' ') ) {
+            int cxSpace = MeasureText(pstrText, 1, 0);
+            // Still need to paint the space because the font might have
+            // underline formatting.
+            if( bDraw && bLineDraw ) AddText(pt.x, pt.y + cyLineHeight - m_tm.nHeight - m_tm.nExternalLeading, pstrText, 1);
+            pt.x += cxSpace;
+            cxMaxWidth = MaxInt(cxMaxWidth, pt.x);
+            pstrText++;
+        }
+        else {
+            TPoint ptPos = pt;
+            int cchChars = 0;
+            int cchSize = 0;
+            int cchLastGoodWord = 0;
+            int cchLastGoodSize = 0;
+            const T* p = pstrText;
+            const T* pstrNext;
+            int cxText = 0;
+            if( ( !bInRaw && *p == T('<') ) || *p == T('{') ) p++, cchChars++, cchSize++;
+            while( *p != T('\0') && *p != T('\n') ) {
+                // 先按最大字符宽度估算，可能超出区域时才真正测量
+                if( bInRaw ) {
+                    if( ( *p == T('<') || *p == T('{') ) && p[1] == T('/')
+                        && p[2] == T('r') && ( p[3] == T('>') || p[3] == T('}') ) ) {
+                        p += 4;
+                        bInRaw = false;
+                        break;
+                    }
+                }
+                else {
+                    if( *p == T('<') || *p == T('{') ) break;
+                }
+                pstrNext = pHost->CharNext(p);
+                cchChars++;
+                cchSize += (int)(pstrNext - p);
+                cxText = cchChars * m_tm.nMaxCharWidth;
+                if( pt.x + cxText >= rc.right ) {
+                    cxText = MeasureText(pstrText, cchSize, cxText);
+                }
+                if( pt.x + cxText > rc.right ) {
+                    if( pt.x != rc.left ) {
+                        cchChars--;
+                        cchSize -= (int)(pstrNext - p);
+                    }
+                    if( (uStyle & HTMLTEXT_WORDBREAK) != 0 && cchLastGoodWord > 0 ) {
+                        cchChars = cchLastGoodWord;
+                        cchSize = cchLastGoodSize;
+                    }
+                    if( (uStyle & HTMLTEXT_END_ELLIPSIS) != 0 && cchChars > 0 ) {
+                        cchChars -= 1;
+                        const T* pstrPrev = pHost->CharPrev(pstrText, p);
+                        if( cchChars > 0 ) {
+                            cchChars -= 1;
+                            pstrPrev = pHost->CharPrev(pstrText, pstrPrev);
+                        }
+                        cchSize -= (int)(p - pstrPrev);
+                        pt.x = rc.right;
+                    }
+                    bLineEnd = true;
+                    cxMaxWidth = MaxInt(cxMaxWidth, pt.x);
+                    break;
+                }
+                if( !( ( p[0] >= T('a') && p[0] <= T('z') ) || ( p[0] >= T('A') && p[0] <= T('Z') ) ) ) {
+                    cchLastGoodWord = cchChars;
+                    cchLastGoodSize = cchSize;
+                }
+                p = pHost->CharNext(p);
+            }
+
+            cxText = MeasureText(pstrText, cchSize, cxText);
+            if( bDraw && bLineDraw ) {
+                if( (uStyle & HTMLTEXT_SINGLELINE) == 0 && (uStyle & HTMLTEXT_CENTER) != 0 ) {
+                    ptPos.x += (rc.right - rc.left - cxText) / 2;
+                }
+                else if( (uStyle & HTMLTEXT_SINGLELINE) == 0 && (uStyle & HTMLTEXT_RIGHT) != 0 ) {
+                    ptPos.x += (rc.right - rc.left - cxText);
+                }
+                AddText(ptPos.x, ptPos.y + cyLineHeight - m_tm.nHeight - m_tm.nExternalLeading, pstrText, cchSize);
+                if( pt.x >= rc.right && (uStyle & HTMLTEXT_END_ELLIPSIS) != 0 ) AddRun(HTMLTEXT_RUN_ELLIPSIS, ptPos.x + cxText, ptPos.y);
+            }
+            pt.x += cxText;
+            cxMaxWidth = MaxInt(cxMaxWidth, pt.x);
+            pstrText += cchSize;
+        }
+
+        if( pt.x >= rc.right || *pstrText == T('\n') || *pstrText == T('\0') ) bLineEnd = true;
+        if( bDraw && bLineEnd ) {
+            if( !bLineDraw ) {
+                aFontArray = aLineFontArray;
+                aColorArray = aLineColorArray;
+                aPIndentArray = aLinePIndentArray;
+
+                cyLineHeight = cyLine;
+                pstrText = pstrLineBegin;
+                bInRaw = bLineInRaw;
+                bInSelected = bLineInSelected;
+
+                SetColor(aColorArray);
+                SelectFont(TopFont(aFontArray, pDefFont));
+                if( bInSelected ) m_bOpaque = true;
+            }
+            else {
+                aLineFontArray = aFontArray;
+                aLineColorArray = aColorArray;
+                aLinePIndentArray = aPIndentArray;
+                pstrLineBegin = pstrText;
+                bLineInSelected = bInSelected;
+                bLineInRaw = bInRaw;
+            }
+        }
+    }
+
+    m_layout.nLinks = iLinkIndex;
+    m_layout.cxMaxWidth = cxMaxWidth;
+    m_layout.cyMinHeight = cyMinHeight;
+    m_layout.cyLastLine = pt.y + cyLine;
+
+    if( (uStyle & HTMLTEXT_CALCRECT) != 0 ) m_layout.GetCalcRect(rc);
+}
+
+template<typename T>
+size_t HashString(const std::basic_string<T>& s, size_t h)
+{
+    for( size_t i = 0; i < s.size(); i++ ) {
+        h ^= (size_t)s[i];
+        h *= (size_t)1099511628211ULL;
+    }
+    return h;
+}
+
+inline size_t HashInt(size_t h, unsigned int n)
+{
+    h ^= n;
+    h *= (size_t)1099511628211ULL;
+    return h;
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+bool CHtmlTextLayoutT<T>::Color::operator==(const Color& other) const
+{
+    return nType == other.nType && dwColor == other.dwColor && sLink == other.sLink;
+}
+
+template<typename T>
+CHtmlTextLayoutT<T>::CHtmlTextLayoutT() : nLinks(0), bCallerLinks(false), cxMaxWidth(HTMLTEXT_ZERO), cyMinHeight(HTMLTEXT_ZERO), cyLastLine(0)
+{
+    SetLayoutRect(rc, 0, 0, 0, 0);
+}
+
+template<typename T>
+void CHtmlTextLayoutT<T>::Build(IHtmlTextHostT<T>* pHost, const T* pstrText, int cx, int cy, int iFont, unsigned int uStyle, int nLinkRects, const T* const* ppLinks)
+{
+    Clear();
+    SetLayoutRect(rc, 0, 0, cx, cy);
+    if( pHost == NULL || pstrText == NULL ) return;
+    if( nLinkRects < 0 ) nLinkRects = 0;
+    Link link;
+    SetLayoutRect(link.rc, 0, 0, 0, 0);
+    link.bRect = false;
+    link.bLink = false;
+    aLinks.assign(nLinkRects, link);
+    for( int i = 0; ppLinks != NULL && i < nLinkRects; i++ ) {
+        if( ppLinks[i] != NULL ) aLinks[i].sLink = ppLinks[i];
+    }
+
+    CHtmlTextBuilder<T> builder(pHost, *this, pstrText);
+    builder.Build(iFont, uStyle, nLinkRects);
+}
+
+template<typename T>
+void CHtmlTextLayoutT<T>::Clear()
+{
+    SetLayoutRect(rc, 0, 0, 0, 0);
+    nLinks = 0;
+    bCallerLinks = false;
+    cxMaxWidth = HTMLTEXT_ZERO;
+    cyMinHeight = HTMLTEXT_ZERO;
+    cyLastLine = 0;
+    aRuns.clear();
+    aColors.clear();
+    aLinks.clear();
+}
+
+template<typename T>
+void CHtmlTextLayoutT<T>::Swap(CHtmlTextLayoutT& other)
+{
+    std::swap(rc, other.rc);
+    std::swap(nLinks, other.nLinks);
+    std::swap(bCallerLinks, other.bCallerLinks);
+    std::swap(cxMaxWidth, other.cxMaxWidth);
+    std::swap(cyMinHeight, other.cyMinHeight);
+    std::swap(cyLastLine, other.cyLastLine);
+    aRuns.swap(other.aRuns);
+    aColors.swap(other.aColors);
+    aLinks.swap(other.aLinks);
+}
+
+template<typename T>
+void CHtmlTextLayoutT<T>::GetCalcRect(TLayoutRect& rcText) const
+{
+    // 原来最宽处和图片底部的初始值是调用者坐标的 0
+    int cxRight = cxMaxWidth == HTMLTEXT_ZERO ? 0 : MaxInt(0, rcText.left + cxMaxWidth);
+    int cyImage = cyMinHeight == HTMLTEXT_ZERO ? 0 : rcText.top + cyMinHeight;
+    rcText.bottom = MaxInt(cyImage, rcText.top + cyLastLine);
+    rcText.right = MinInt(rcText.right, cxRight);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+bool CHtmlTextCacheT<T>::Key::operator==(const Key& other) const
+{
+    return iFont == other.iFont && cx == other.cx && cy == other.cy && uStyle == other.uStyle
+        && nLinkRects == other.nLinkRects && nFlags == other.nFlags && sText == other.sText;
+}
+
+template<typename T>
+size_t CHtmlTextCacheT<T>::KeyHash::operator()(const Key& key) const
+{
+    size_t h = HashString(key.sText, (size_t)14695981039346656037ULL);
+    h = HashInt(h, (unsigned int)key.iFont);
+    h = HashInt(h, (unsigned int)key.cx);
+    h = HashInt(h, (unsigned int)key.cy);
+    h = HashInt(h, key.uStyle);
+    h = HashInt(h, (unsigned int)key.nLinkRects);
+    return HashInt(h, key.nFlags);
+}
+
+template<typename T>
+CHtmlTextCacheT<T>::CHtmlTextCacheT(size_t nCapacity) : m_nCapacity(nCapacity)
+{
+}
+
+template<typename T>
+const CHtmlTextLayoutT<T>* CHtmlTextCacheT<T>::Find(const Key& key)
+{
+    typename std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash>::iterator it = m_index.find(key);
+    if( it == m_index.end() ) return NULL;
+    if( it->second != m_entries.begin() ) m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &it->second->layout;
+}
+
+template<typename T>
+const CHtmlTextLayoutT<T>* CHtmlTextCacheT<T>::Insert(const Key& key, CHtmlTextLayoutT<T>& layout)
+{
+    if( m_nCapacity == 0 ) return NULL;
+    typename std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash>::iterator it = m_index.find(key);
+    if( it == m_index.end() ) {
+        m_entries.push_front(Entry());
+        it = m_index.insert(std::make_pair(key, m_entries.begin())).first;
+        m_entries.front().pKey = &it->first;
+    }
+    else if( it->second != m_entries.begin() ) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+    }
+    m_entries.front().layout.Clear();
+    m_entries.front().layout.Swap(layout);
+    _Trim();
+    return &m_entries.front().layout;
+}
+
+template<typename T>
+void CHtmlTextCacheT<T>::Clear()
+{
+    m_index.clear();
+    m_entries.clear();
+}
+
+template<typename T>
+void CHtmlTextCacheT<T>::SetCapacity(size_t nCapacity)
+{
+    m_nCapacity = nCapacity;
+    _Trim();
+}
+
+template<typename T>
+size_t CHtmlTextCacheT<T>::GetCapacity() const
+{
+    return m_nCapacity;
+}
+
+template<typename T>
+size_t CHtmlTextCacheT<T>::GetCount() const
+{
+    return m_entries.size();
+}
+
+template<typename T>
+void CHtmlTextCacheT<T>::_Trim()
+{
+    while( m_entries.size() > m_nCapacity ) {
+        m_index.erase(*m_entries.back().pKey);
+        m_entries.pop_back();
+    }
+}
+
+template class CHtmlTextLayoutT<char>;
+template class CHtmlTextLayoutT<wchar_t>;
+template class CHtmlTextCacheT<char>;
+template class CHtmlTextCacheT<wchar_t>;
+
+} // namespace DuiLib
@@ -0,0 +1,204 @@
+#ifndef __UIHTMLTEXT_H__
+#define __UIHTMLTEXT_H__
+
+#pragma once
+
+// mini-html 文字（CRenderEngine::DrawHtmlText）的排版和排版结果缓存：
+// 1. 标签解析、换行、省略号和链接区域与原来 DrawHtmlText 的算法完全一致，
+//    字体、文字宽度和图片尺寸通过 IHtmlTextHostT 取得，结果是按顺序输出的文字片段和图片；
+// 2. 结果只与 (文字, 字体, 区域大小, 风格, 链接数组大小) 有关，位置保存为相对区域左上角的偏移，
+//    CHtmlTextCacheT 按这些条件缓存，再次绘制时直接输出文字片段，不再逐字测量；
+// 3. 链接的悬停颜色在绘制时才决定，同一份结果可以用于不同的鼠标位置。
+// 字体和图片用 void* 表示，字体、图片或 DPI 改变时由调用者清空缓存。不依赖 Windows 头文件。
+
+#include "UILayoutEngine.h"
+#include <stddef.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DuiLib {
+
+	// 排版用到的风格，与 DrawText 的 DT_ 常量相同
+	enum
+	{
+		HTMLTEXT_CENTER = 0x00000001,
+		HTMLTEXT_RIGHT = 0x00000002,
+		HTMLTEXT_VCENTER = 0x00000004,
+		HTMLTEXT_BOTTOM = 0x00000008,
+		HTMLTEXT_WORDBREAK = 0x00000010,
+		HTMLTEXT_SINGLELINE = 0x00000020,
+		HTMLTEXT_CALCRECT = 0x00000400,
+		HTMLTEXT_END_ELLIPSIS = 0x00008000,
+	};
+
+	enum
+	{
+		HTMLTEXT_RUN_TEXT = 0,
+		HTMLTEXT_RUN_ELLIPSIS,				// 超出区域时行尾的 "..."
+		HTMLTEXT_RUN_IMAGE,
+	};
+
+	enum
+	{
+		HTMLTEXT_COLOR_DEFAULT = 0,			// 绘制时传入的文字颜色
+		HTMLTEXT_COLOR_VALUE,				// <c> 指定的颜色
+		HTMLTEXT_COLOR_LINK,				// <a> 的颜色：鼠标悬停在内容相同的链接上时为悬停颜色，否则为文字颜色
+	};
+
+	// 原来有几处初始值是调用者坐标的 0 而不是区域的左上角，排版结果中用这个值表示，输出时换成 0
+	enum { HTMLTEXT_ZERO = -0x7FFFFFFF - 1 };
+
+	// 排版用到的字体度量（TEXTMETRIC 的一部分）和字体样式
+	struct THtmlFontMetrics
+	{
+		int nHeight;
+		int nExternalLeading;
+		int nMaxCharWidth;
+		bool bItalicFace;					// tmItalic
+		bool bBold;
+		bool bUnderline;
+		bool bItalic;
+	};
+
+	template<typename T>
+	class IHtmlTextHostT
+	{
+	public:
+		// 字体编号对应的字体，编号不存在时为默认字体
+		virtual void* GetFont(int iFont) = 0;
+		// 按名字、大小和样式查找字体，没有时创建
+		virtual void* GetFont(const T* pstrName, int nSize, bool bBold, bool bUnderline, bool bItalic) = 0;
+		// 与 pFont 名字和大小相同、样式不同的字体，没有时创建
+		virtual void* DeriveFont(void* pFont, bool bBold, bool bUnderline, bool bItalic) = 0;
+		virtual void GetFontMetrics(void* pFont, THtmlFontMetrics& tm) = 0;
+		// 文字宽度，cchText 不为负数
+		virtual int MeasureText(void* pFont, const T* pstrText, int cchText) = 0;
+		// 空格的 C 宽度（GetCharABCWidths），用于斜体之后的位置修正
+		virtual int GetSpaceOverhang(void* pFont) = 0;
+		// 图片和它的尺寸，找不到时返回 NULL。pstrType 为 NULL 时按名字查找
+		virtual void* GetImage(const T* pstrName, const T* pstrType, int& cx, int& cy) = 0;
+		// 多字节字符集下一个字符可能占多个单元
+		virtual const T* CharNext(const T* p) = 0;
+		virtual const T* CharPrev(const T* pStart, const T* p) = 0;
+	};
+
+	template<typename T>
+	class CHtmlTextLayoutT
+	{
+	public:
+		struct Run
+		{
+			int nType;
+			int x;							// 相对区域左上角
+			int y;
+			int iText;						// 文字在原字符串中的位置
+			int cchText;
+			void* pFont;
+			int iColor;						// aColors 的下标
+			bool bSelected;					// 背景用选中颜色填充（OPAQUE）
+			void* pImage;
+			TLayoutRect rcImage;			// 相对区域左上角
+			TLayoutRect rcBmpPart;
+		};
+
+		struct Color
+		{
+			int nType;
+			unsigned int dwColor;
+			std::basic_string<T> sLink;		// HTMLTEXT_COLOR_LINK 的链接内容
+
+			bool operator==(const Color& other) const;
+		};
+
+		// 调用者链接数组中这一次写过的项，没有写过的项保持原来的内容（sLink 为 Build 时传入的内容）
+		struct Link
+		{
+			TLayoutRect rc;					// 相对区域左上角，第一个 <a> 之前的 </a> 左上角为 HTMLTEXT_ZERO
+			std::basic_string<T> sLink;
+			bool bRect;
+			bool bLink;
+		};
+
+	public:
+		CHtmlTextLayoutT();
+
+		// 在 (0, 0, cx, cy) 中排版，nLinkRects 为调用者链接数组的大小，ppLinks 为数组中原来的链接内容
+		void Build(IHtmlTextHostT<T>* pHost, const T* pstrText, int cx, int cy, int iFont, unsigned int uStyle, int nLinkRects, const T* const* ppLinks = NULL);
+		void Clear();
+		void Swap(CHtmlTextLayoutT& other);
+		// HTMLTEXT_CALCRECT 的结果：rcText 为调用者坐标的区域，修改它的右边和底边
+		void GetCalcRect(TLayoutRect& rcText) const;
+
+	public:
+		TLayoutRect rc;						// 对齐后的区域，HTMLTEXT_CALCRECT 时为在 (0, 0) 计算出的大小
+		int nLinks;							// 链接数
+		// 读到了链接数组中这一次没有写过的项（如以换行开始的文字中的链接），结果与数组原来的内容有关，不能缓存
+		bool bCallerLinks;
+		// 以下相对区域左上角，没有输出文字或图片时为 HTMLTEXT_ZERO
+		int cxMaxWidth;						// 最宽处
+		int cyMinHeight;					// 最后一张图片的底部
+		int cyLastLine;						// 最后一行的底部
+		std::vector<Run> aRuns;
+		std::vector<Color> aColors;
+		std::vector<Link> aLinks;
+	};
+
+	template<typename T>
+	class CHtmlTextCacheT
+	{
+	public:
+		struct Key
+		{
+			std::basic_string<T> sText;
+			int iFont;
+			int cx;
+			int cy;
+			unsigned int uStyle;
+			int nLinkRects;
+			unsigned int nFlags;			// 由调用者区分不同的排版方式，如 DrawText 和 DrawHtmlText
+
+			bool operator==(const Key& other) const;
+		};
+
+		enum { DEFAULT_CAPACITY = 512 };
+
+	public:
+		explicit CHtmlTextCacheT(size_t nCapacity = DEFAULT_CAPACITY);
+
+		// 命中时移到最近使用，返回的结果在下一次 Insert、Clear 之前有效
+		const CHtmlTextLayoutT<T>* Find(const Key& key);
+		// 结果交换进缓存，layout 变为空；超过容量时淘汰最久未用的结果。容量为 0 时不缓存，返回 NULL
+		const CHtmlTextLayoutT<T>* Insert(const Key& key, CHtmlTextLayoutT<T>& layout);
+		void Clear();
+		void SetCapacity(size_t nCapacity);
+		size_t GetCapacity() const;
+		size_t GetCount() const;
+
+	private:
+		CHtmlTextCacheT(const CHtmlTextCacheT&);
+		CHtmlTextCacheT& operator=(const CHtmlTextCacheT&);
+
+		struct Entry
+		{
+			const Key* pKey;				// 指向 m_index 中的 key
+			CHtmlTextLayoutT<T> layout;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		void _Trim();
+
+	private:
+		size_t m_nCapacity;
+		std::list<Entry> m_entries;			// 表头最近使用
+		std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> m_index;
+	};
+
+} // namespace DuiLib
+
+#endif // __UIHTMLTEXT_H__
@@ -0,0 +1,242 @@
+#include "UIImageCache.h"
+
+namespace DuiLib {
+
+template<typename T>
+bool CImageCacheT<T>::Key::operator==(const Key& other) const
+{
+    return dwMask == other.dwMask && nHSL == other.nHSL && nInstance == other.nInstance &&
+        sName == other.sName && sType == other.sType;
+}
+
+template<typename T>
+size_t CImageCacheT<T>::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a，名字占绝大部分，其余字段混进去
+    size_t nHash = static_cast<size_t>(2166136261u);
+    for( size_t i = 0; i < key.sName.size(); i++ ) {
+        nHash = (nHash ^ static_cast<size_t>(key.sName[i])) * 16777619u;
+    }
+    for( size_t i = 0; i < key.sType.size(); i++ ) {
+        nHash = (nHash ^ static_cast<size_t>(key.sType[i])) * 16777619u;
+    }
+    nHash = (nHash ^ key.nInstance) * 16777619u;
+    nHash = (nHash ^ key.dwMask) * 16777619u;
+    nHash = (nHash ^ key.nHSL) * 16777619u;
+    return nHash;
+}
+
+template<typename T>
+CImageCacheT<T>::CImageCacheT(FreeFunc pfnFree, size_t nBudget) : m_pfnFree(pfnFree), m_nBudget(nBudget),
+    m_nBytes(0), m_nUnusedBytes(0), m_nHits(0), m_nMisses(0), m_nEvictions(0)
+{
+}
+
+template<typename T>
+CImageCacheT<T>::~CImageCacheT()
+{
+    std::vector<void*> aFree;
+    while( !m_unused.empty() ) _Remove(m_unused.front(), aFree);
+    // 仍被引用的图片交给持有者释放，这里只删除记录
+    for( typename std::unordered_map<void*, Entry*>::iterator it = m_images.begin(); it != m_images.end(); ++it ) {
+        delete it->second;
+    }
+    m_images.clear();
+    m_index.clear();
+    _Free(aFree);
+}
+
+template<typename T>
+void* CImageCacheT<T>::Acquire(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    typename std::unordered_map<Key, Entry*, KeyHash>::iterator it = m_index.find(key);
+    if( it == m_index.end() ) {
+        ++m_nMisses;
+        return NULL;
+    }
+    ++m_nHits;
+    Entry* pEntry = it->second;
+    if( pEntry->nRefs++ == 0 ) {
+        m_unused.erase(pEntry->itUnused);
+        m_nUnusedBytes -= pEntry->nBytes;
+    }
+    return pEntry->pImage;
+}
+
+template<typename T>
+void* CImageCacheT<T>::Insert(const Key& key, void* pImage, size_t nBytes)
+{
+    if( pImage == NULL ) return NULL;
+    std::vector<void*> aFree;
+    void* pResult = pImage;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        typename std::unordered_map<Key, Entry*, KeyHash>::iterator it = m_index.find(key);
+        if( it != m_index.end() ) {
+            // 其他线程抢先加载了同一张图片
+            Entry* pEntry = it->second;
+            if( pEntry->nRefs++ == 0 ) {
+                m_unused.erase(pEntry->itUnused);
+                m_nUnusedBytes -= pEntry->nBytes;
+            }
+            if( pEntry->pImage != pImage ) aFree.push_back(pImage);
+            pResult = pEntry->pImage;
+        }
+        else if( m_images.find(pImage) != m_images.end() ) {
+            // 同一张图片不能用两个 key 登记
+            return NULL;
+        }
+        else {
+            Entry* pEntry = new Entry;
+            pEntry->key = key;
+            pEntry->pImage = pImage;
+            pEntry->nBytes = nBytes;
+            pEntry->nRefs = 1;
+            pEntry->bIndexed = true;
+            m_index[key] = pEntry;
+            m_images[pImage] = pEntry;
+            m_nBytes += nBytes;
+            _Trim(aFree);
+        }
+    }
+    _Free(aFree);
+    return pResult;
+}
+
+template<typename T>
+bool CImageCacheT<T>::AddRef(void* pImage)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    typename std::unordered_map<void*, Entry*>::iterator it = m_images.find(pImage);
+    if( it == m_images.end() ) return false;
+    Entry* pEntry = it->second;
+    if( pEntry->nRefs++ == 0 ) {
+        m_unused.erase(pEntry->itUnused);
+        m_nUnusedBytes -= pEntry->nBytes;
+    }
+    return true;
+}
+
+template<typename T>
+bool CImageCacheT<T>::Release(void* pImage)
+{
+    std::vector<void*> aFree;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        typename std::unordered_map<void*, Entry*>::iterator it = m_images.find(pImage);
+        if( it == m_images.end() ) return false;
+        Entry* pEntry = it->second;
+        if( pEntry->nRefs > 0 && --pEntry->nRefs == 0 ) {
+            if( pEntry->bIndexed ) {
+                _Unuse(pEntry);
+                _Trim(aFree);
+            }
+            else {
+                _Remove(pEntry, aFree);
+            }
+        }
+    }
+    _Free(aFree);
+    return true;
+}
+
+template<typename T>
+bool CImageCacheT<T>::IsCached(void* pImage) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_images.find(pImage) != m_images.end();
+}
+
+template<typename T>
+void CImageCacheT<T>::Clear()
+{
+    std::vector<void*> aFree;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while( !m_unused.empty() ) _Remove(m_unused.front(), aFree);
+        for( typename std::unordered_map<Key, Entry*, KeyHash>::iterator it = m_index.begin(); it != m_index.end(); ++it ) {
+            it->second->bIndexed = false;
+        }
+        m_index.clear();
+    }
+    _Free(aFree);
+}
+
+template<typename T>
+void CImageCacheT<T>::SetBudget(size_t nBudget)
+{
+    std::vector<void*> aFree;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nBudget = nBudget;
+        _Trim(aFree);
+    }
+    _Free(aFree);
+}
+
+template<typename T>
+size_t CImageCacheT<T>::GetBudget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nBudget;
+}
+
+template<typename T>
+typename CImageCacheT<T>::Stats CImageCacheT<T>::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.nHits = m_nHits;
+    stats.nMisses = m_nMisses;
+    stats.nEvictions = m_nEvictions;
+    stats.nImages = m_images.size();
+    stats.nBytes = m_nBytes;
+    stats.nUnusedImages = m_unused.size();
+    stats.nUnusedBytes = m_nUnusedBytes;
+    stats.nBudget = m_nBudget;
+    return stats;
+}
+
+template<typename T>
+void CImageCacheT<T>::_Unuse(Entry* pEntry)
+{
+    pEntry->itUnused = m_unused.insert(m_unused.end(), pEntry);
+    m_nUnusedBytes += pEntry->nBytes;
+}
+
+template<typename T>
+void CImageCacheT<T>::_Remove(Entry* pEntry, std::vector<void*>& aFree)
+{
+    if( pEntry->nRefs == 0 && pEntry->bIndexed ) {
+        m_unused.erase(pEntry->itUnused);
+        m_nUnusedBytes -= pEntry->nBytes;
+    }
+    if( pEntry->bIndexed ) m_index.erase(pEntry->key);
+    m_images.erase(pEntry->pImage);
+    m_nBytes -= pEntry->nBytes;
+    aFree.push_back(pEntry->pImage);
+    delete pEntry;
+}
+
+template<typename T>
+void CImageCacheT<T>::_Trim(std::vector<void*>& aFree)
+{
+    while( m_nBytes > m_nBudget && !m_unused.empty() ) {
+        _Remove(m_unused.front(), aFree);
+        ++m_nEvictions;
+    }
+}
+
+template<typename T>
+void CImageCacheT<T>::_Free(const std::vector<void*>& aFree)
+{
+    // 在锁外释放，释放函数里可以再访问缓存
+    if( m_pfnFree == NULL ) return;
+    for( size_t i = 0; i < aFree.size(); i++ ) m_pfnFree(aFree[i]);
+}
+
+template class CImageCacheT<char>;
+template class CImageCacheT<wchar_t>;
+
+} // namespace DuiLib
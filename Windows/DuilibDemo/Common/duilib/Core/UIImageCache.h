@@ -0,0 +1,113 @@
+#ifndef __UIIMAGECACHE_H__
+#define __UIIMAGECACHE_H__
+
+#pragma once
+
+// 进程内共享的图片缓存策略：
+// 1. 按 (名字, restype, 资源模块, mask, HSL) 去重，多个 CPaintManagerUI 加载同一张图片时共用一份；
+// 2. 引用计数，被某个 CPaintManagerUI 的图片表引用的图片不会被淘汰；
+// 3. 没有引用的图片按最近使用顺序保留在 LRU 中，总字节数超过预算时从最久未用的开始释放。
+// 图片本身用 void* 表示，由构造时传入的函数释放，不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DuiLib {
+
+	template<typename T>
+	class CImageCacheT
+	{
+	public:
+		struct Key
+		{
+			std::basic_string<T> sName;
+			std::basic_string<T> sType;		// restype，文件图片为空
+			size_t nInstance;				// restype 图片所在的模块，文件图片为 0
+			unsigned int dwMask;
+			unsigned int nHSL;				// 加载时生效的 HSL 参数，不做 HSL 调整的图片为 0
+
+			bool operator==(const Key& other) const;
+		};
+
+		struct Stats
+		{
+			unsigned long long nHits;
+			unsigned long long nMisses;
+			unsigned long long nEvictions;
+			size_t nImages;
+			size_t nBytes;				// 缓存中所有图片的字节数，包括被引用的
+			size_t nUnusedImages;		// 没有引用、可以淘汰的图片
+			size_t nUnusedBytes;
+			size_t nBudget;
+		};
+
+		typedef void (*FreeFunc)(void* pImage);
+
+		enum { DEFAULT_BUDGET = 64 * 1024 * 1024 };
+
+	public:
+		explicit CImageCacheT(FreeFunc pfnFree, size_t nBudget = DEFAULT_BUDGET);
+		// 释放没有引用的图片；仍被引用的图片由持有者负责
+		~CImageCacheT();
+
+		// 命中时增加引用并返回图片，未命中返回 NULL
+		void* Acquire(const Key& key);
+		// 加入新加载的图片，引用计数为 1。同一个 key 已经存在时释放 pImage，返回已有的图片（同样增加引用）
+		void* Insert(const Key& key, void* pImage, size_t nBytes);
+		// 增加一个引用，pImage 必须由 Acquire/Insert 返回
+		bool AddRef(void* pImage);
+		// 减少一个引用，引用为 0 的图片进入 LRU；不是缓存中的图片返回 false，由调用方自己释放
+		bool Release(void* pImage);
+		bool IsCached(void* pImage) const;
+
+		// 释放所有没有引用的图片，被引用的图片不再能被查到（资源路径或 HSL 改变后使用），最后一个引用释放时才释放
+		void Clear();
+		void SetBudget(size_t nBudget);
+		size_t GetBudget() const;
+		Stats GetStats() const;
+
+	private:
+		CImageCacheT(const CImageCacheT&);
+		CImageCacheT& operator=(const CImageCacheT&);
+
+		struct Entry
+		{
+			Key key;
+			void* pImage;
+			size_t nBytes;
+			unsigned int nRefs;
+			bool bIndexed;		// 是否还能通过 key 查到
+			typename std::list<Entry*>::iterator itUnused;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		void _Unuse(Entry* pEntry);
+		void _Remove(Entry* pEntry, std::vector<void*>& aFree);
+		void _Trim(std::vector<void*>& aFree);
+		void _Free(const std::vector<void*>& aFree);
+
+	private:
+		FreeFunc m_pfnFree;
+		size_t m_nBudget;
+		mutable std::mutex m_mutex;
+		std::unordered_map<Key, Entry*, KeyHash> m_index;
+		std::unordered_map<void*, Entry*> m_images;
+		std::list<Entry*> m_unused;			// 没有引用的图片，表头最久未用
+		size_t m_nBytes;
+		size_t m_nUnusedBytes;
+		unsigned long long m_nHits;
+		unsigned long long m_nMisses;
+		unsigned long long m_nEvictions;
+	};
+
+} // namespace DuiLib
+
+#endif // __UIIMAGECACHE_H__
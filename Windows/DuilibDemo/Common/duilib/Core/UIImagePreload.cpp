@@ -0,0 +1,492 @@
+#include "UIMarkupDom.h"
+#include "UIImagePreload.h"
+#include "UIPixelConvert.h"
+#include "../Utils/stb_image.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_set>
+
+namespace DuiLib {
+
+namespace {
+
+    const unsigned int kMaxPreloadThreads = 4;
+
+    template<typename T>
+    inline unsigned int CharValue(T ch)
+    {
+        return static_cast<unsigned int>(ch) & (sizeof(T) == 1 ? 0xFF : 0xFFFFFFFF);
+    }
+
+    template<typename T>
+    inline bool IsWhitespace(T ch)
+    {
+        unsigned int c = CharValue(ch);
+        return c > 0 && c <= ' ';
+    }
+
+    template<typename T>
+    inline unsigned int FoldCase(T ch)
+    {
+        unsigned int c = CharValue(ch);
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+
+    template<typename T>
+    bool EqualsAscii(const std::basic_string<T>& s, const char* pLiteral)
+    {
+        size_t n = strlen(pLiteral);
+        if( s.size() != n ) return false;
+        for( size_t i = 0; i < n; ++i ) {
+            if( CharValue(s[i]) != static_cast<unsigned char>(pLiteral[i]) ) return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool EqualsNoCase(const T* p, const char* pLiteral)
+    {
+        if( p == NULL ) return false;
+        for( ; *pLiteral != 0; ++p, ++pLiteral ) {
+            if( FoldCase(*p) != FoldCase(*pLiteral) ) return false;
+        }
+        return *p == 0;
+    }
+
+    // 名字（去掉首尾空白）以 pSuffix 结尾，ASCII 不区分大小写
+    template<typename T>
+    bool EndsWithNoCase(const T* pBegin, const T* pEnd, const char* pSuffix)
+    {
+        while( pBegin < pEnd && IsWhitespace(*pBegin) ) ++pBegin;
+        while( pEnd > pBegin && IsWhitespace(pEnd[-1]) ) --pEnd;
+        size_t n = strlen(pSuffix);
+        if( static_cast<size_t>(pEnd - pBegin) < n ) return false;
+        const T* p = pEnd - n;
+        for( size_t i = 0; i < n; ++i ) {
+            if( FoldCase(p[i]) != FoldCase(pSuffix[i]) ) return false;
+        }
+        return true;
+    }
+
+    // 与 _tcstoul(p, &end, 16) 相同：可以有前导空白和 0x，溢出时为 0xFFFFFFFF
+    template<typename T>
+    unsigned int ParseHex(const T* p)
+    {
+        while( IsWhitespace(*p) ) ++p;
+        bool bNegative = false;
+        if( *p == '+' || *p == '-' ) bNegative = (*p++ == '-');
+        if( p[0] == '0' && (p[1] == 'x' || p[1] == 'X') ) p += 2;
+        unsigned long long nValue = 0;
+        bool bOverflow = false;
+        for( ;; ++p ) {
+            unsigned int c = CharValue(*p);
+            unsigned int nDigit;
+            if( c >= '0' && c <= '9' ) nDigit = c - '0';
+            else if( c >= 'a' && c <= 'f' ) nDigit = c - 'a' + 10;
+            else if( c >= 'A' && c <= 'F' ) nDigit = c - 'A' + 10;
+            else break;
+            nValue = nValue * 16 + nDigit;
+            if( nValue > 0xFFFFFFFFull ) bOverflow = true;
+        }
+        if( bOverflow ) return 0xFFFFFFFF;
+        unsigned int nResult = static_cast<unsigned int>(nValue);
+        return bNegative ? 0u - nResult : nResult;
+    }
+
+    template<typename T>
+    void AppendScale(std::basic_string<T>& sName, int nScale)
+    {
+        // 与 TDrawInfo::Parse 一致：每个 '.' 前插入 "@缩放比"
+        char szScale[16];
+        int nLength = 0;
+        szScale[nLength++] = '@';
+        char szDigits[12];
+        int nDigits = 0;
+        unsigned int n = nScale < 0 ? 0u - static_cast<unsigned int>(nScale) : static_cast<unsigned int>(nScale);
+        do {
+            szDigits[nDigits++] = static_cast<char>('0' + n % 10);
+            n /= 10;
+        } while( n != 0 );
+        if( nScale < 0 ) szScale[nLength++] = '-';
+        while( nDigits > 0 ) szScale[nLength++] = szDigits[--nDigits];
+
+        std::basic_string<T> sResult;
+        sResult.reserve(sName.size() + 8);
+        for( size_t i = 0; i < sName.size(); ++i ) {
+            if( sName[i] == '.' ) {
+                for( int k = 0; k < nLength; ++k ) sResult += static_cast<T>(szScale[k]);
+            }
+            sResult += sName[i];
+        }
+        sName.swap(sResult);
+    }
+
+    template<typename T>
+    class CSkinImageCollector
+    {
+    public:
+        CSkinImageCollector(int nScale, std::vector<SkinImageRef<T> >& refs) : m_nScale(nScale), m_refs(refs)
+        {
+            for( size_t i = 0; i < refs.size(); ++i ) m_names.insert(refs[i].sName);
+        }
+
+        // 同名的以第一次出现的为准，第一次带 restype 的名字之后也不再收集
+        void AddRef(const SkinImageRef<T>& ref, const std::basic_string<T>& sResType)
+        {
+            if( ref.sName.empty() || !m_names.insert(ref.sName).second ) return;
+            if( !sResType.empty() ) return;
+            const T* pName = ref.sName.c_str();
+            if( EndsWithNoCase(pName, pName + ref.sName.size(), ".gif") ) return;
+            m_refs.push_back(ref);
+        }
+
+        void AddImageString(const T* pValue)
+        {
+            SkinImageRef<T> ref;
+            std::basic_string<T> sResType;
+            ParseImageString(pValue, m_nScale, ref, sResType);
+            AddRef(ref, sResType);
+        }
+
+        // <Default>/<Style> 的 value，规则同 CControlUI::ApplyAttributeList（&quot; 已经由 XML 解析还原）
+        void AddAttributeList(const T* p)
+        {
+            std::basic_string<T> sValue;
+            while( *p != 0 ) {
+                const T* pName = p;
+                while( *p != 0 && *p != '=' ) ++p;
+                const T* pNameEnd = p;
+                if( *p++ != '=' ) return;
+                if( *p++ != '\"' ) return;
+                const T* pValue = p;
+                while( *p != 0 && *p != '\"' ) ++p;
+                if( *p != '\"' ) return;
+                if( EndsWithNoCase(pName, pNameEnd, "image") ) {
+                    sValue.assign(pValue, p);
+                    AddImageString(sValue.c_str());
+                }
+                ++p;
+                if( *p++ != ' ' && *p++ != ',' ) return;
+            }
+        }
+
+    private:
+        int m_nScale;
+        std::vector<SkinImageRef<T> >& m_refs;
+        std::unordered_set<std::basic_string<T> > m_names;
+    };
+
+} // namespace
+
+bool DecodeImage(const unsigned char* pData, size_t nSize, unsigned int dwMask, CDecodedImage& image)
+{
+    image.pBits = NULL;
+    image.nWidth = 0;
+    image.nHeight = 0;
+    image.bAlpha = false;
+    if( pData == NULL || nSize == 0 || nSize > INT_MAX ) return false;
+
+    int x = 0, y = 0, n = 0;
+    unsigned char* pImage = stbi_load_from_memory(pData, static_cast<int>(nSize), &x, &y, &n, 4);
+    if( pImage == NULL ) return false;
+    size_t nPixels = static_cast<size_t>(x) * static_cast<size_t>(y);
+    unsigned char* pBits = static_cast<unsigned char*>(malloc(nPixels * 4 > 0 ? nPixels * 4 : 1));
+    if( pBits == NULL ) {
+        stbi_image_free(pImage);
+        return false;
+    }
+    image.bAlpha = ConvertToPremultipliedBGRA(pImage, pBits, nPixels, dwMask);
+    stbi_image_free(pImage);
+    image.pBits = pBits;
+    image.nWidth = x;
+    image.nHeight = y;
+    return true;
+}
+
+void FreeDecodedImage(CDecodedImage& image)
+{
+    free(image.pBits);
+    image.pBits = NULL;
+}
+
+template<typename T>
+void ParseImageString(const T* pStr, int nScale, SkinImageRef<T>& ref, std::basic_string<T>& sResType)
+{
+    ref.sName = pStr != NULL ? pStr : std::basic_string<T>();
+    ref.dwMask = 0;
+    ref.bHSL = false;
+    ref.bShared = false;
+    sResType.clear();
+    if( pStr == NULL ) return;
+
+    std::basic_string<T> sItem;
+    std::basic_string<T> sValue;
+    const T* p = pStr;
+    while( *p != 0 ) {
+        sItem.clear();
+        sValue.clear();
+        while( IsWhitespace(*p) ) ++p;
+        while( *p != 0 && *p != '=' && CharValue(*p) > ' ' ) sItem += *p++;
+        while( IsWhitespace(*p) ) ++p;
+        if( *p++ != '=' ) break;
+        while( IsWhitespace(*p) ) ++p;
+        if( *p++ != '\'' ) break;
+        while( *p != 0 && *p != '\'' ) sValue += *p++;
+        if( *p++ != '\'' ) break;
+        if( !sValue.empty() ) {
+            if( EqualsAscii(sItem, "file") || EqualsAscii(sItem, "res") ) {
+                ref.sName = sValue;
+            }
+            else if( EqualsAscii(sItem, "restype") ) {
+                sResType = sValue;
+            }
+            else if( EqualsAscii(sItem, "mask") ) {
+                ref.dwMask = ParseHex(sValue.c_str() + (sValue[0] == '#' ? 1 : 0));
+            }
+            else if( EqualsAscii(sItem, "hsl") ) {
+                ref.bHSL = EqualsNoCase(sValue.c_str(), "true");
+            }
+        }
+        if( *p++ != ' ' ) break;
+    }
+    if( nScale != 100 ) AppendScale(ref.sName, nScale);
+}
+
+template<typename T>
+void CollectSkinImages(const CMarkupDomT<T>& dom, int nScale, std::vector<SkinImageRef<T> >& refs)
+{
+    typedef typename CMarkupDomT<T>::Node Node;
+    if( !dom.IsValid() || dom.GetRoot() == NULL ) return;
+
+    CSkinImageCollector<T> collector(nScale, refs);
+    const Node* pRoot = dom.GetRoot();
+    // 只有窗口下的第一层 <Image>/<Default>/<Style> 由 CDialogBuilder 处理，与它保持一致
+    for( const Node* pNode = pRoot->pChild; pNode != NULL; pNode = pNode->pNext ) {
+        if( EqualsNoCase(pNode->pName, "Image") ) {
+            SkinImageRef<T> ref;
+            ref.dwMask = 0;
+            ref.bHSL = false;
+            ref.bShared = false;
+            std::basic_string<T> sResType;
+            for( unsigned int i = 0; i < pNode->nAttributes; i++ ) {
+                const typename CMarkupDomT<T>::Attribute& attr = pNode->pAttributes[i];
+                if( EqualsNoCase(attr.pName, "name") ) ref.sName = attr.pValue;
+                else if( EqualsNoCase(attr.pName, "restype") ) sResType = attr.pValue;
+                else if( EqualsNoCase(attr.pName, "mask") ) ref.dwMask = ParseHex(attr.pValue + (attr.pValue[0] == '#' ? 1 : 0));
+                else if( EqualsNoCase(attr.pName, "shared") ) ref.bShared = EqualsNoCase(attr.pValue, "true");
+            }
+            collector.AddRef(ref, sResType);
+        }
+        else if( EqualsNoCase(pNode->pName, "Default") || EqualsNoCase(pNode->pName, "Style") ) {
+            for( unsigned int i = 0; i < pNode->nAttributes; i++ ) {
+                const typename CMarkupDomT<T>::Attribute& attr = pNode->pAttributes[i];
+                if( EqualsNoCase(attr.pName, "value") ) collector.AddAttributeList(attr.pValue);
+            }
+        }
+    }
+
+    // 先序遍历所有节点的属性
+    const Node* pNode = pRoot;
+    while( pNode != NULL ) {
+        for( unsigned int i = 0; i < pNode->nAttributes; i++ ) {
+            const typename CMarkupDomT<T>::Attribute& attr = pNode->pAttributes[i];
+            const T* pName = attr.pName;
+            const T* pNameEnd = pName;
+            while( *pNameEnd != 0 ) ++pNameEnd;
+            if( EndsWithNoCase(pName, pNameEnd, "image") ) collector.AddImageString(attr.pValue);
+        }
+        if( pNode->pChild != NULL ) {
+            pNode = pNode->pChild;
+            continue;
+        }
+        while( pNode != NULL && pNode->pNext == NULL ) pNode = pNode->pParent;
+        if( pNode != NULL ) pNode = pNode->pNext;
+    }
+}
+
+template void ParseImageString<char>(const char*, int, SkinImageRef<char>&, std::basic_string<char>&);
+template void ParseImageString<wchar_t>(const wchar_t*, int, SkinImageRef<wchar_t>&, std::basic_string<wchar_t>&);
+template void CollectSkinImages<char>(const CMarkupDomT<char>&, int, std::vector<SkinImageRef<char> >&);
+template void CollectSkinImages<wchar_t>(const CMarkupDomT<wchar_t>&, int, std::vector<SkinImageRef<wchar_t> >&);
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//
+//
+
+CImagePreloader::CImagePreloader(const LoadFunc& load, unsigned int nThreads) : m_load(load), m_nThreads(nThreads),
+    m_nQueued(0), m_nRunning(0), m_bStop(false)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    if( m_nThreads == 0 ) {
+        unsigned int nCores = std::thread::hardware_concurrency();
+        m_nThreads = nCores > 1 ? nCores - 1 : 1;
+        if( m_nThreads > kMaxPreloadThreads ) m_nThreads = kMaxPreloadThreads;
+    }
+}
+
+CImagePreloader::~CImagePreloader()
+{
+    Cancel();
+    for( size_t i = 0; i < m_items.size(); i++ ) FreeDecodedImage(m_items[i].image);
+}
+
+size_t CImagePreloader::Add(const std::vector<unsigned int>& aMasks)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    size_t nFirst = m_items.size();
+    for( size_t i = 0; i < aMasks.size(); i++ ) {
+        Item item;
+        item.dwMask = aMasks[i];
+        item.eState = STATE_QUEUED;
+        item.image.pBits = NULL;
+        item.image.nWidth = 0;
+        item.image.nHeight = 0;
+        item.image.bAlpha = false;
+        m_items.push_back(item);
+        m_queue.push_back(nFirst + i);
+    }
+    m_nQueued += aMasks.size();
+    if( !aMasks.empty() && m_workers.empty() ) {
+        for( unsigned int i = 0; i < m_nThreads; i++ ) m_workers.push_back(std::thread(&CImagePreloader::_WorkerProc, this));
+    }
+    lock.unlock();
+    m_wakeCond.notify_all();
+    return nFirst;
+}
+
+size_t CImagePreloader::GetCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_items.size();
+}
+
+bool CImagePreloader::Take(size_t nIndex, CDecodedImage& image)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if( nIndex >= m_items.size() ) return false;
+    Item& item = m_items[nIndex];
+    if( item.eState == STATE_QUEUED ) {
+        // 还在队列中，直接在调用线程解码，不必等前面的图片
+        item.eState = STATE_RUNNING;
+        --m_nQueued;
+        ++m_stats.nDecodedByCaller;
+        unsigned int dwMask = item.dwMask;
+        lock.unlock();
+
+        CDecodedImage decoded;
+        bool bOk = _Decode(nIndex, dwMask, decoded);
+
+        lock.lock();
+        item.eState = STATE_TAKEN;
+        if( bOk ) ++m_stats.nDecoded;
+        else ++m_stats.nFailed;
+        lock.unlock();
+        m_doneCond.notify_all();
+        if( bOk ) image = decoded;
+        return bOk;
+    }
+    if( item.eState == STATE_RUNNING ) {
+        ++m_stats.nWaits;
+        m_doneCond.wait(lock, [&item]() { return item.eState != STATE_RUNNING; });
+    }
+    return _TakeDone(item, image);
+}
+
+bool CImagePreloader::TryTake(size_t nIndex, CDecodedImage& image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if( nIndex >= m_items.size() ) return false;
+    return _TakeDone(m_items[nIndex], image);
+}
+
+bool CImagePreloader::IsIdle() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nQueued == 0 && m_nRunning == 0;
+}
+
+void CImagePreloader::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+        for( size_t i = 0; i < m_queue.size(); i++ ) {
+            Item& item = m_items[m_queue[i]];
+            if( item.eState == STATE_QUEUED ) item.eState = STATE_TAKEN;
+        }
+        m_queue.clear();
+        m_nQueued = 0;
+    }
+    m_wakeCond.notify_all();
+    for( size_t i = 0; i < m_workers.size(); i++ ) m_workers[i].join();
+    m_workers.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bStop = false;
+}
+
+CImagePreloader::Stats CImagePreloader::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void CImagePreloader::_WorkerProc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for( ;; ) {
+        m_wakeCond.wait(lock, [this]() { return m_bStop || !m_queue.empty(); });
+        if( m_bStop ) return;
+
+        size_t nIndex = m_queue.front();
+        m_queue.pop_front();
+        Item& item = m_items[nIndex];
+        if( item.eState != STATE_QUEUED ) continue;
+        item.eState = STATE_RUNNING;
+        --m_nQueued;
+        ++m_nRunning;
+        unsigned int dwMask = item.dwMask;
+        lock.unlock();
+
+        CDecodedImage decoded;
+        bool bOk = _Decode(nIndex, dwMask, decoded);
+
+        lock.lock();
+        --m_nRunning;
+        if( bOk ) {
+            item.image = decoded;
+            item.eState = STATE_DONE;
+            ++m_stats.nDecoded;
+        }
+        else {
+            item.eState = STATE_TAKEN;
+            ++m_stats.nFailed;
+        }
+        m_doneCond.notify_all();
+    }
+}
+
+bool CImagePreloader::_Decode(size_t nIndex, unsigned int dwMask, CDecodedImage& image)
+{
+    Source source;
+    source.pData = NULL;
+    source.nSize = 0;
+    if( !m_load || !m_load(nIndex, source) || source.pData == NULL ) {
+        image.pBits = NULL;
+        return false;
+    }
+    return DecodeImage(source.pData, source.nSize, dwMask, image);
+}
+
+bool CImagePreloader::_TakeDone(Item& item, CDecodedImage& image)
+{
+    if( item.eState != STATE_DONE ) return false;
+    image = item.image;
+    item.image.pBits = NULL;
+    item.eState = STATE_TAKEN;
+    return true;
+}
+
+} // namespace DuiLib
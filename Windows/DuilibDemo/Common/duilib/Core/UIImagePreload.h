@@ -0,0 +1,135 @@
+#ifndef __UIIMAGEPRELOAD_H__
+#define __UIIMAGEPRELOAD_H__
+
+#pragma once
+
+// 皮肤图片预加载：CDialogBuilder 解析完皮肤后，收集其中引用的图片，在后台线程并行读取和解码，
+// 首次绘制时 CPaintManagerUI 直接取用解码结果，不再在 WM_PAINT 中逐张同步解码。
+// 只依赖 UIMarkupDom.h 和 stb_image，不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DuiLib {
+
+	// 解码结果：预乘 alpha 的 BGRA，每行 nWidth * 4 字节，与 CRenderEngine::LoadImage 生成的 DIB 相同
+	struct CDecodedImage
+	{
+		unsigned char* pBits;	// malloc 分配，用 FreeDecodedImage 释放
+		int nWidth;
+		int nHeight;
+		bool bAlpha;			// 有半透明像素或 mask 色
+	};
+
+	// 解码 PNG/JPG/BMP 等，失败时 image.pBits 为 NULL
+	bool DecodeImage(const unsigned char* pData, size_t nSize, unsigned int dwMask, CDecodedImage& image);
+	void FreeDecodedImage(CDecodedImage& image);
+
+	template<typename T> class CMarkupDomT;
+
+	template<typename T>
+	struct SkinImageRef
+	{
+		std::basic_string<T> sName;		// 图片缓存的键，与 TDrawInfo::sImageName 相同（含 DPI 后缀）
+		unsigned int dwMask;
+		bool bHSL;
+		bool bShared;					// 来自 <Image shared="true">
+	};
+
+	// 按 TDrawInfo::Parse 的规则从图片描述串中取出文件名、restype、mask 和 hsl，nScale 为 DPI 缩放百分比
+	template<typename T>
+	void ParseImageString(const T* pStr, int nScale, SkinImageRef<T>& ref, std::basic_string<T>& sResType);
+
+	// 收集皮肤引用的图片：<Image> 节点、名字以 image 结尾的属性，以及 <Default>/<Style> 的 value 中的同类属性。
+	// 按名字去重，保留第一次出现的 mask；带 restype 的资源图片和 .gif 不收集
+	template<typename T>
+	void CollectSkinImages(const CMarkupDomT<T>& dom, int nScale, std::vector<SkinImageRef<T> >& refs);
+
+	class CImagePreloader
+	{
+	public:
+		struct Source
+		{
+			const unsigned char* pData;
+			size_t nSize;
+			std::shared_ptr<const void> pHolder;	// 保持 pData 有效，解码完就释放
+		};
+		// 读取第 nIndex 张图片的数据，在工作线程中调用，必须线程安全
+		typedef std::function<bool(size_t nIndex, Source& source)> LoadFunc;
+
+		struct Stats
+		{
+			size_t nDecoded;
+			size_t nFailed;
+			size_t nDecodedByCaller;	// 还没轮到后台解码就被 Take 的图片，在调用线程解码
+			size_t nWaits;				// Take 等待后台解码完成的次数
+		};
+
+	public:
+		// nThreads 为 0 时按 CPU 核数，1 到 4 个；线程在第一次 Add 时启动
+		explicit CImagePreloader(const LoadFunc& load, unsigned int nThreads = 0);
+		~CImagePreloader();
+
+		// 追加一批图片，第 i 张使用 aMasks[i] 作为透明色；返回第一张的序号
+		size_t Add(const std::vector<unsigned int>& aMasks);
+		size_t GetCount() const;
+
+		// 取走第 nIndex 张。还没开始的在当前线程解码，正在解码的等它完成；失败或已经取走返回 false
+		bool Take(size_t nIndex, CDecodedImage& image);
+		// 只取走已经解码完成的，不等待
+		bool TryTake(size_t nIndex, CDecodedImage& image);
+		// 是否所有图片都已经解码结束（不论是否取走）
+		bool IsIdle() const;
+		// 放弃还没开始的图片并等待工作线程退出，已经解码的仍可取走
+		void Cancel();
+
+		Stats GetStats() const;
+
+	private:
+		CImagePreloader(const CImagePreloader&);
+		CImagePreloader& operator=(const CImagePreloader&);
+
+		enum State
+		{
+			STATE_QUEUED = 0,
+			STATE_RUNNING,
+			STATE_DONE,
+			STATE_TAKEN,	// 已取走、失败或被取消
+		};
+
+		struct Item
+		{
+			unsigned int dwMask;
+			State eState;
+			CDecodedImage image;
+		};
+
+		void _WorkerProc();
+		bool _Decode(size_t nIndex, unsigned int dwMask, CDecodedImage& image);
+		bool _TakeDone(Item& item, CDecodedImage& image);
+
+	private:
+		LoadFunc m_load;
+		unsigned int m_nThreads;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wakeCond;		// 队列中有新图片或需要退出
+		std::condition_variable m_doneCond;		// 有图片解码结束
+		std::deque<Item> m_items;				// 只追加，元素地址不变
+		std::deque<size_t> m_queue;
+		std::vector<std::thread> m_workers;
+		size_t m_nQueued;						// 状态为 STATE_QUEUED 的图片数
+		size_t m_nRunning;
+		bool m_bStop;
+		Stats m_stats;
+	};
+
+} // namespace DuiLib
+
+#endif // __UIIMAGEPRELOAD_H__
@@ -0,0 +1,359 @@
+#include "UILayoutEngine.h"
+
+namespace DuiLib {
+
+static inline int _LayoutMax(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+// 约束按最大尺寸截断，固定尺寸优先
+static void _LimitAvailable(const TLayoutItem& item, TLayoutSize& szAvailable)
+{
+    int iMaxWidth = item.szFixed.cx;
+    int iMaxHeight = item.szFixed.cy;
+    if( iMaxWidth <= 0 ) iMaxWidth = item.szMax.cx;
+    if( iMaxHeight <= 0 ) iMaxHeight = item.szMax.cy;
+    if( szAvailable.cx > iMaxWidth ) szAvailable.cx = iMaxWidth;
+    if( szAvailable.cy > iMaxHeight ) szAvailable.cy = iMaxHeight;
+}
+
+void CLayoutEngine::ResetItem(TLayoutItem& item)
+{
+    item.nMeasured = 0;
+    item.rcPos.left = item.rcPos.top = item.rcPos.right = item.rcPos.bottom = 0;
+}
+
+TLayoutSize CLayoutEngine::Measure(TLayoutItem& item, TLayoutSize szAvailable, ILayoutMeasure* pMeasure)
+{
+    for( int i = 0; i < item.nMeasured; i++ ) {
+        if( item.szMeasureAvailable[i].cx == szAvailable.cx && item.szMeasureAvailable[i].cy == szAvailable.cy ) {
+            return item.szMeasureResult[i];
+        }
+    }
+    TLayoutSize sz = pMeasure->Measure(item, szAvailable);
+    // 两个位置轮流使用：测量和排列两遍的约束通常只有这两种
+    int iSlot = item.nMeasured < 2 ? item.nMeasured++ : 1;
+    item.szMeasureAvailable[iSlot] = szAvailable;
+    item.szMeasureResult[iSlot] = sz;
+    return sz;
+}
+
+TLayoutSize CLayoutEngine::ArrangeVertical(const TLayoutBox& box, std::vector<TLayoutItem>& aItems, ILayoutMeasure* pMeasure)
+{
+    const TLayoutRect& rc = box.rc;
+    TLayoutSize szAvailable = { rc.right - rc.left, rc.bottom - rc.top };
+    szAvailable.cx += box.szScrollRange.cx;
+    szAvailable.cy += box.szScrollRange.cy;
+
+    int cxNeeded = 0;
+    int nAdjustables = 0;
+    int cyFixed = 0;
+    int nEstimateNum = (int)aItems.size();
+    for( size_t it = 0; it < aItems.size(); it++ ) {
+        TLayoutItem& item = aItems[it];
+        const TLayoutRect& rcPadding = item.rcPadding;
+        TLayoutSize szControlAvailable = szAvailable;
+        szControlAvailable.cx -= rcPadding.left + rcPadding.right;
+        _LimitAvailable(item, szControlAvailable);
+        TLayoutSize sz = Measure(item, szControlAvailable, pMeasure);
+        if( sz.cy == 0 ) {
+            nAdjustables++;
+        }
+        else {
+            if( sz.cy < item.szMin.cy ) sz.cy = item.szMin.cy;
+            if( sz.cy > item.szMax.cy ) sz.cy = item.szMax.cy;
+        }
+        cyFixed += sz.cy + rcPadding.top + rcPadding.bottom;
+
+        sz.cx = _LayoutMax(sz.cx, 0);
+        if( sz.cx < item.szMin.cx ) sz.cx = item.szMin.cx;
+        if( sz.cx > item.szMax.cx ) sz.cx = item.szMax.cx;
+        cxNeeded = _LayoutMax(cxNeeded, sz.cx + rcPadding.left + rcPadding.right);
+    }
+    cyFixed += (nEstimateNum - 1) * box.iChildPadding;
+
+    // 自适应高度的子控件平分剩余空间，最后一个拿走余数
+    int cyExpand = 0;
+    if( nAdjustables > 0 ) cyExpand = _LayoutMax(0, (szAvailable.cy - cyFixed) / nAdjustables);
+    TLayoutSize szRemaining = szAvailable;
+    int iPosY = rc.top - box.szScrollPos.cy;
+    int iEstimate = 0;
+    int iAdjustable = 0;
+    int cyFixedRemaining = cyFixed;
+    int cyNeeded = 0;
+    for( size_t it = 0; it < aItems.size(); it++ ) {
+        TLayoutItem& item = aItems[it];
+        iEstimate += 1;
+        const TLayoutRect& rcPadding = item.rcPadding;
+        szRemaining.cy -= rcPadding.top;
+
+        TLayoutSize szControlAvailable = szRemaining;
+        szControlAvailable.cx -= rcPadding.left + rcPadding.right;
+        _LimitAvailable(item, szControlAvailable);
+        cyFixedRemaining = cyFixedRemaining - (rcPadding.top + rcPadding.bottom);
+        if( iEstimate > 1 ) cyFixedRemaining = cyFixedRemaining - box.iChildPadding;
+        TLayoutSize sz = Measure(item, szControlAvailable, pMeasure);
+        if( sz.cy == 0 ) {
+            iAdjustable++;
+            sz.cy = cyExpand;
+            if( iAdjustable == nAdjustables ) {
+                sz.cy = _LayoutMax(0, szRemaining.cy - rcPadding.bottom - cyFixedRemaining);
+            }
+            if( sz.cy < item.szMin.cy ) sz.cy = item.szMin.cy;
+            if( sz.cy > item.szMax.cy ) sz.cy = item.szMax.cy;
+        }
+        else {
+            if( sz.cy < item.szMin.cy ) sz.cy = item.szMin.cy;
+            if( sz.cy > item.szMax.cy ) sz.cy = item.szMax.cy;
+            cyFixedRemaining -= sz.cy;
+        }
+
+        // 宽度取最大宽度，没有设置时占满
+        sz.cx = item.szMax.cx;
+        if( sz.cx == 0 ) sz.cx = szAvailable.cx - rcPadding.left - rcPadding.right;
+        if( sz.cx < 0 ) sz.cx = 0;
+        if( sz.cx > szControlAvailable.cx ) sz.cx = szControlAvailable.cx;
+        if( sz.cx < item.szMin.cx ) sz.cx = item.szMin.cx;
+
+        TLayoutRect& rcCtrl = item.rcPos;
+        if( box.nAlign == LAYOUT_ALIGN_CENTER ) {
+            int iPosX = (rc.right + rc.left) / 2;
+            iPosX += box.szScrollRange.cx / 2;
+            iPosX -= box.szScrollPos.cx;
+            rcCtrl.left = iPosX - sz.cx / 2;
+            rcCtrl.top = iPosY + rcPadding.top;
+            rcCtrl.right = iPosX + sz.cx - sz.cx / 2;
+            rcCtrl.bottom = iPosY + sz.cy + rcPadding.top;
+        }
+        else if( box.nAlign == LAYOUT_ALIGN_FAR ) {
+            int iPosX = rc.right;
+            iPosX += box.szScrollRange.cx;
+            iPosX -= box.szScrollPos.cx;
+            rcCtrl.left = iPosX - rcPadding.right - sz.cx;
+            rcCtrl.top = iPosY + rcPadding.top;
+            rcCtrl.right = iPosX - rcPadding.right;
+            rcCtrl.bottom = iPosY + sz.cy + rcPadding.top;
+        }
+        else {
+            int iPosX = rc.left;
+            iPosX -= box.szScrollPos.cx;
+            rcCtrl.left = iPosX + rcPadding.left;
+            rcCtrl.top = iPosY + rcPadding.top;
+            rcCtrl.right = iPosX + rcPadding.left + sz.cx;
+            rcCtrl.bottom = iPosY + sz.cy + rcPadding.top;
+        }
+
+        iPosY += sz.cy + box.iChildPadding + rcPadding.top + rcPadding.bottom;
+        cyNeeded += sz.cy + rcPadding.top + rcPadding.bottom;
+        szRemaining.cy -= sz.cy + box.iChildPadding + rcPadding.bottom;
+    }
+    cyNeeded += (nEstimateNum - 1) * box.iChildPadding;
+
+    TLayoutSize szNeeded = { cxNeeded, cyNeeded };
+    return szNeeded;
+}
+
+TLayoutSize CLayoutEngine::ArrangeHorizontal(const TLayoutBox& box, std::vector<TLayoutItem>& aItems, ILayoutMeasure* pMeasure)
+{
+    const TLayoutRect& rc = box.rc;
+    // 横向布局的可用宽度不加横向滚动范围
+    TLayoutSize szAvailable = { rc.right - rc.left, rc.bottom - rc.top };
+    szAvailable.cy += box.szScrollRange.cy;
+
+    int cyNeeded = 0;
+    int nAdjustables = 0;
+    int cxFixed = 0;
+    int nEstimateNum = (int)aItems.size();
+    for( size_t it = 0; it < aItems.size(); it++ ) {
+        TLayoutItem& item = aItems[it];
+        const TLayoutRect& rcPadding = item.rcPadding;
+        TLayoutSize szControlAvailable = szAvailable;
+        szControlAvailable.cy -= rcPadding.top + rcPadding.bottom;
+        _LimitAvailable(item, szControlAvailable);
+        TLayoutSize sz = Measure(item, szControlAvailable, pMeasure);
+        if( sz.cx == 0 ) {
+            nAdjustables++;
+        }
+        else {
+            if( sz.cx < item.szMin.cx ) sz.cx = item.szMin.cx;
+            if( sz.cx > item.szMax.cx ) sz.cx = item.szMax.cx;
+        }
+        cxFixed += sz.cx + rcPadding.left + rcPadding.right;
+
+        sz.cy = _LayoutMax(sz.cy, 0);
+        if( sz.cy < item.szMin.cy ) sz.cy = item.szMin.cy;
+        if( sz.cy > item.szMax.cy ) sz.cy = item.szMax.cy;
+        cyNeeded = _LayoutMax(cyNeeded, sz.cy + rcPadding.top + rcPadding.bottom);
+    }
+    cxFixed += (nEstimateNum - 1) * box.iChildPadding;
+
+    int cxExpand = 0;
+    if( nAdjustables > 0 ) cxExpand = _LayoutMax(0, (szAvailable.cx - cxFixed) / nAdjustables);
+    TLayoutSize szRemaining = szAvailable;
+    int iPosX = rc.left - box.szScrollPos.cx;
+    int iEstimate = 0;
+    int iAdjustable = 0;
+    int cxFixedRemaining = cxFixed;
+    int cxNeeded = 0;
+    for( size_t it = 0; it < aItems.size(); it++ ) {
+        TLayoutItem& item = aItems[it];
+        iEstimate += 1;
+        const TLayoutRect& rcPadding = item.rcPadding;
+        szRemaining.cx -= rcPadding.left;
+
+        TLayoutSize szControlAvailable = szRemaining;
+        szControlAvailable.cy -= rcPadding.top + rcPadding.bottom;
+        _LimitAvailable(item, szControlAvailable);
+        cxFixedRemaining = cxFixedRemaining - (rcPadding.left + rcPadding.right);
+        if( iEstimate > 1 ) cxFixedRemaining = cxFixedRemaining - box.iChildPadding;
+        TLayoutSize sz = Measure(item, szControlAvailable, pMeasure);
+        if( sz.cx == 0 ) {
+            iAdjustable++;
+            sz.cx = cxExpand;
+            if( iAdjustable == nAdjustables ) {
+                sz.cx = _LayoutMax(0, szRemaining.cx - rcPadding.right - cxFixedRemaining);
+            }
+            if( sz.cx < item.szMin.cx ) sz.cx = item.szMin.cx;
+            if( sz.cx > item.szMax.cx ) sz.cx = item.szMax.cx;
+        }
+        else {
+            if( sz.cx < item.szMin.cx ) sz.cx = item.szMin.cx;
+            if( sz.cx > item.szMax.cx ) sz.cx = item.szMax.cx;
+            cxFixedRemaining -= sz.cx;
+        }
+
+        sz.cy = item.szMax.cy;
+        if( sz.cy == 0 ) sz.cy = szAvailable.cy - rcPadding.top - rcPadding.bottom;
+        if( sz.cy < 0 ) sz.cy = 0;
+        if( sz.cy > szControlAvailable.cy ) sz.cy = szControlAvailable.cy;
+        if( sz.cy < item.szMin.cy ) sz.cy = item.szMin.cy;
+
+        TLayoutRect& rcCtrl = item.rcPos;
+        if( box.nAlign == LAYOUT_ALIGN_CENTER ) {
+            int iPosY = (rc.bottom + rc.top) / 2;
+            iPosY += box.szScrollRange.cy / 2;
+            iPosY -= box.szScrollPos.cy;
+            rcCtrl.left = iPosX + rcPadding.left;
+            rcCtrl.top = iPosY - sz.cy / 2;
+            rcCtrl.right = iPosX + sz.cx + rcPadding.left;
+            rcCtrl.bottom = iPosY + sz.cy - sz.cy / 2;
+        }
+        else if( box.nAlign == LAYOUT_ALIGN_FAR ) {
+            int iPosY = rc.bottom;
+            iPosY += box.szScrollRange.cy;
+            iPosY -= box.szScrollPos.cy;
+            rcCtrl.left = iPosX + rcPadding.left;
+            rcCtrl.top = iPosY - rcPadding.bottom - sz.cy;
+            rcCtrl.right = iPosX + sz.cx + rcPadding.left;
+            rcCtrl.bottom = iPosY - rcPadding.bottom;
+        }
+        else {
+            int iPosY = rc.top;
+            iPosY -= box.szScrollPos.cy;
+            rcCtrl.left = iPosX + rcPadding.left;
+            rcCtrl.top = iPosY + rcPadding.top;
+            rcCtrl.right = iPosX + sz.cx + rcPadding.left;
+            rcCtrl.bottom = iPosY + sz.cy + rcPadding.top;
+        }
+
+        iPosX += sz.cx + box.iChildPadding + rcPadding.left + rcPadding.right;
+        cxNeeded += sz.cx + rcPadding.left + rcPadding.right;
+        szRemaining.cx -= sz.cx + box.iChildPadding + rcPadding.right;
+    }
+    cxNeeded += (nEstimateNum - 1) * box.iChildPadding;
+
+    TLayoutSize szNeeded = { cxNeeded, cyNeeded };
+    return szNeeded;
+}
+
+TLayoutSize CLayoutEngine::ArrangeTile(const TLayoutBox& box, TLayoutSize szItem, int& nColumns, std::vector<TLayoutItem>& aItems, ILayoutMeasure* pMeasure)
+{
+    const TLayoutRect& rc = box.rc;
+    if( szItem.cx > 0 ) nColumns = (rc.right - rc.left) / szItem.cx;
+    if( nColumns == 0 ) nColumns = 1;
+
+    int cyNeeded = 0;
+    int cxWidth = (rc.right - rc.left + box.szScrollRange.cx) / nColumns;
+    int cyHeight = 0;
+    int iCount = 0;
+    int iPosX = rc.left - box.szScrollPos.cx;
+    int ptX = iPosX;
+    int ptY = rc.top - box.szScrollPos.cy;
+    int iChildPadding = box.iChildPadding;
+    for( size_t it = 0; it < aItems.size(); it++ ) {
+        TLayoutItem& item = aItems[it];
+        TLayoutRect rcTile = { ptX, ptY, ptX + cxWidth, ptY };
+        if( (iCount % nColumns) == 0 ) {
+            // 行首计算整行的高度，行内的子控件都按行首控件的尺寸限制测量
+            int iIndex = iCount;
+            for( size_t it2 = it; it2 < aItems.size(); it2++ ) {
+                TLayoutItem& item2 = aItems[it2];
+                const TLayoutRect& rcPadding = item2.rcPadding;
+                TLayoutSize szAvailable = { rcTile.right - rcTile.left - rcPadding.left - rcPadding.right, 9999 };
+                if( iIndex == iCount || (iIndex + 1) % nColumns == 0 ) {
+                    szAvailable.cx -= iChildPadding / 2;
+                }
+                else {
+                    szAvailable.cx -= iChildPadding;
+                }
+
+                if( szAvailable.cx < item.szMin.cx ) szAvailable.cx = item.szMin.cx;
+                if( szAvailable.cx > item.szMax.cx ) szAvailable.cx = item.szMax.cx;
+
+                TLayoutSize szTile = Measure(item2, szAvailable, pMeasure);
+                if( szTile.cx < item.szMin.cx ) szTile.cx = item.szMin.cx;
+                if( szTile.cx > item.szMax.cx ) szTile.cx = item.szMax.cx;
+                if( szTile.cy < item.szMin.cy ) szTile.cy = item.szMin.cy;
+                if( szTile.cy > item.szMax.cy ) szTile.cy = item.szMax.cy;
+
+                cyHeight = _LayoutMax(cyHeight, szTile.cy + rcPadding.top + rcPadding.bottom);
+                if( (++iIndex % nColumns) == 0 ) break;
+            }
+        }
+
+        const TLayoutRect& rcPadding = item.rcPadding;
+        rcTile.left += rcPadding.left + iChildPadding / 2;
+        rcTile.right -= rcPadding.right + iChildPadding / 2;
+        if( (iCount % nColumns) == 0 ) {
+            rcTile.left -= iChildPadding / 2;
+        }
+
+        if( ((iCount + 1) % nColumns) == 0 ) {
+            rcTile.right += iChildPadding / 2;
+        }
+
+        // Set position
+        rcTile.top = ptY + rcPadding.top;
+        rcTile.bottom = ptY + cyHeight;
+
+        TLayoutSize szAvailable = { rcTile.right - rcTile.left, rcTile.bottom - rcTile.top };
+        TLayoutSize szTile = Measure(item, szAvailable, pMeasure);
+        if( szTile.cx == 0 ) szTile.cx = szAvailable.cx;
+        if( szTile.cy == 0 ) szTile.cy = szAvailable.cy;
+        if( szTile.cx < item.szMin.cx ) szTile.cx = item.szMin.cx;
+        if( szTile.cx > item.szMax.cx ) szTile.cx = item.szMax.cx;
+        if( szTile.cy < item.szMin.cy ) szTile.cy = item.szMin.cy;
+        if( szTile.cy > item.szMax.cy ) szTile.cy = item.szMax.cy;
+        TLayoutRect& rcPos = item.rcPos;
+        rcPos.left = (rcTile.left + rcTile.right - szTile.cx) / 2;
+        rcPos.top = (rcTile.top + rcTile.bottom - szTile.cy) / 2;
+        rcPos.right = rcPos.left + szTile.cx;
+        rcPos.bottom = rcPos.top + szTile.cy;
+
+        if( (++iCount % nColumns) == 0 ) {
+            ptX = iPosX;
+            ptY += cyHeight + iChildPadding;
+            cyHeight = 0;
+        }
+        else {
+            ptX += cxWidth;
+        }
+        cyNeeded = rcTile.bottom - rc.top + box.szScrollPos.cy;
+    }
+
+    TLayoutSize szNeeded = { 0, cyNeeded };
+    return szNeeded;
+}
+
+} // namespace DuiLib
@@ -0,0 +1,87 @@
+#ifndef __UILAYOUTENGINE_H__
+#define __UILAYOUTENGINE_H__
+
+#pragma once
+
+// 纵向、横向、平铺布局的计算：输入区域和子控件的尺寸限制，输出子控件的位置。
+// 1. 算法与 CVerticalLayoutUI/CHorizontalLayoutUI/CTileLayoutUI 原来的 SetPos 完全一致；
+// 2. 子控件的尺寸通过 ILayoutMeasure 测量，同一次布局中约束相同的测量只做一次，
+//    原来测量和排列两遍各调用一次 EstimateSize，固定尺寸的子控件现在只调用一次；
+// 3. 只计算位置，是否真正调用 SetPos 由容器决定。
+// 不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <vector>
+
+namespace DuiLib {
+
+	struct TLayoutSize
+	{
+		int cx;
+		int cy;
+	};
+
+	struct TLayoutRect
+	{
+		int left;
+		int top;
+		int right;
+		int bottom;
+	};
+
+	enum
+	{
+		LAYOUT_ALIGN_NEAR = 0,				// 左对齐或顶端对齐
+		LAYOUT_ALIGN_CENTER,
+		LAYOUT_ALIGN_FAR,					// 右对齐或底端对齐
+	};
+
+	// 布局区域，滚动条不可见时滚动范围和位置都为 0
+	struct TLayoutBox
+	{
+		TLayoutRect rc;						// 去掉内边距和滚动条后的区域
+		TLayoutSize szScrollRange;
+		TLayoutSize szScrollPos;
+		int iChildPadding;
+		int nAlign;							// 纵向布局为水平对齐，横向布局为垂直对齐
+	};
+
+	// 参与布局的子控件（可见、非浮动），尺寸限制已经按 DPI 缩放
+	struct TLayoutItem
+	{
+		void* pData;						// 调用者的控件指针
+		TLayoutRect rcPadding;
+		TLayoutSize szFixed;
+		TLayoutSize szMin;
+		TLayoutSize szMax;
+		TLayoutRect rcPos;					// 布局结果
+		// 测量缓存，只在一次布局中有效
+		int nMeasured;
+		TLayoutSize szMeasureAvailable[2];
+		TLayoutSize szMeasureResult[2];
+	};
+
+	class ILayoutMeasure
+	{
+	public:
+		virtual TLayoutSize Measure(const TLayoutItem& item, TLayoutSize szAvailable) = 0;
+	};
+
+	class CLayoutEngine
+	{
+	public:
+		// 清空测量缓存，每次布局前调用
+		static void ResetItem(TLayoutItem& item);
+		// 先查测量缓存，没有时调用 pMeasure
+		static TLayoutSize Measure(TLayoutItem& item, TLayoutSize szAvailable, ILayoutMeasure* pMeasure);
+
+		// 返回子控件需要的总尺寸，用于设置滚动条
+		static TLayoutSize ArrangeVertical(const TLayoutBox& box, std::vector<TLayoutItem>& aItems, ILayoutMeasure* pMeasure);
+		static TLayoutSize ArrangeHorizontal(const TLayoutBox& box, std::vector<TLayoutItem>& aItems, ILayoutMeasure* pMeasure);
+		// szItem.cx 大于 0 时按宽度重新计算列数并写回 nColumns
+		static TLayoutSize ArrangeTile(const TLayoutBox& box, TLayoutSize szItem, int& nColumns, std::vector<TLayoutItem>& aItems, ILayoutMeasure* pMeasure);
+	};
+
+} // namespace DuiLib
+
+#endif // __UILAYOUTENGINE_H__
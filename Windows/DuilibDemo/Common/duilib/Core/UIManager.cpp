@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include <zmouse.h>
+#include "../../util/MappedFile.h"
 
 namespace DuiLib {
 
@@ -25,6 +26,12 @@ namespace DuiLib {
 		rcChildWnd.bottom = pt.y;
 	}
 
+	// 自底向上的 32 位 DIB 中 (x, y) 处像素的地址，向下一行的行距是 -cx 个像素
+	static unsigned int* GetDibPixel(BYTE* pBits, int cx, int cy, int x, int y)
+	{
+		return reinterpret_cast<unsigned int*>(pBits) + static_cast<ptrdiff_t>(cy - 1 - y) * cx + x;
+	}
+
 	static UINT MapKeyState()
 	{
 		UINT uState = 0;
@@ -50,15 +57,6 @@ namespace DuiLib {
 		bool bPickNext;
 	} FINDSHORTCUT;
 
-	typedef struct tagTIMERINFO
-	{
-		CControlUI* pSender;
-		UINT nLocalID;
-		HWND hWnd;
-		UINT uWinTimer;
-		bool bKilled;
-	} TIMERINFO;
-
 
 	tagTDrawInfo::tagTDrawInfo()
 	{
@@ -189,10 +187,16 @@ namespace DuiLib {
 	CDuiString CPaintManagerUI::m_pStrResourceZipPwd;  //Garfield 20160325 带密码zip包解密
 	HANDLE CPaintManagerUI::m_hResourceZip = NULL;
 	bool CPaintManagerUI::m_bCachedResourceZip = true;
+	CZipResource* CPaintManagerUI::m_pResourceZipIndex = NULL;
 	int CPaintManagerUI::m_nResType = UILIB_FILE;
+	// 放在 m_SharedResInfo 之前，保证最后析构
+	CImageCache CPaintManagerUI::m_ImageCache(CPaintManagerUI::_FreeCachedImage);
+	CImageCache CPaintManagerUI::m_GifCache(CPaintManagerUI::_FreeCachedGif);
+	volatile LONG CPaintManagerUI::m_lTextLayoutGeneration = 0;
 	TResInfo CPaintManagerUI::m_SharedResInfo;
 	HINSTANCE CPaintManagerUI::m_hInstance = NULL;
 	bool CPaintManagerUI::m_bUseHSL = false;
+	bool CPaintManagerUI::m_bImagePreload = true;
 	short CPaintManagerUI::m_H = 180;
 	short CPaintManagerUI::m_S = 100;
 	short CPaintManagerUI::m_L = 100;
@@ -209,8 +213,13 @@ namespace DuiLib {
 		m_pOffscreenBits(NULL),
 		m_hbmpBackground(NULL),
 		m_pBackgroundBits(NULL),
+		m_hDcNativeScratch(NULL),
+		m_hbmpNativeScratch(NULL),
+		m_pNativeScratchBits(NULL),
 		m_hwndTooltip(NULL),
-		m_uTimerID(0x1000),
+		m_bSchedulerTimer(false),
+		m_dwSchedulerWake(0),
+		m_lTextLayoutCacheGeneration(m_lTextLayoutGeneration),
 		m_pRoot(NULL),
 		m_pFocus(NULL),
 		m_pEventHover(NULL),
@@ -223,10 +232,13 @@ namespace DuiLib {
 		m_bMouseCapture(false),
 		m_bUsedVirtualWnd(false),
 		m_bForceUseSharedRes(false),
+		m_pImagePreload(NULL),
 		m_nOpacity(0xFF),
 		m_bLayered(false),
 		m_bLayeredChanged(false),
 		m_bShowUpdateRect(false),
+		m_bRetainedPaint(true),
+		m_bOffscreenRetained(false),
 		m_bUseGdiplusText(false),
 		m_trh(0),
 		m_bDragMode(false),
@@ -275,6 +287,7 @@ namespace DuiLib {
 		m_szInitWindowSize.cx = 0;
 		m_szInitWindowSize.cy = 0;
 		m_szRoundCorner.cx = m_szRoundCorner.cy = 0;
+		m_szNativeScratch.cx = m_szNativeScratch.cy = 0;
 		::ZeroMemory(&m_rcSizeBox, sizeof(m_rcSizeBox));
 		::ZeroMemory(&m_rcCaption, sizeof(m_rcCaption));
 		::ZeroMemory(&m_rcLayeredInset, sizeof(m_rcLayeredInset));
@@ -300,6 +313,7 @@ namespace DuiLib {
 
 		::DeleteObject(m_ResInfo.m_DefaultFontInfo.hFont);
 		RemoveAllFonts();
+		_ReleaseImagePreload();
 		RemoveAllImages();
 		RemoveAllStyle();
 		RemoveAllDefaultAttributeList();
@@ -323,6 +337,8 @@ namespace DuiLib {
 		if( m_hDcBackground != NULL ) ::DeleteDC(m_hDcBackground);
 		if( m_hbmpOffscreen != NULL ) ::DeleteObject(m_hbmpOffscreen);
 		if( m_hbmpBackground != NULL ) ::DeleteObject(m_hbmpBackground);
+		if( m_hDcNativeScratch != NULL ) ::DeleteDC(m_hDcNativeScratch);
+		if( m_hbmpNativeScratch != NULL ) ::DeleteObject(m_hbmpNativeScratch);
 		if( m_hDcPaint != NULL ) ::ReleaseDC(m_hWndPaint, m_hDcPaint);
 		m_aPreMessages.Remove(m_aPreMessages.Find(this));
 		// 销毁拖拽图片
@@ -356,6 +372,7 @@ namespace DuiLib {
 			m_hDcPaint = ::GetDC(hWnd);
 			m_aPreMessages.Add(this);
 		}
+		_UpdateFrameClock();
 
 		SetTargetWnd(hWnd);
 		InitDragDrop();
@@ -421,6 +438,23 @@ namespace DuiLib {
 		return m_hResourceZip;
 	}
 
+	CZipResource* CPaintManagerUI::GetResourceZipIndex()
+	{
+		return m_pResourceZipIndex;
+	}
+
+	bool CPaintManagerUI::ReadResourceZipItem(LPCTSTR pstrName, CZipResource::Item& item)
+	{
+		if( m_pResourceZipIndex == NULL || pstrName == NULL ) return false;
+#ifdef UNICODE
+		char szName[MAX_PATH * 3];
+		if( ::WideCharToMultiByte(CP_UTF8, 0, pstrName, -1, szName, sizeof(szName), NULL, NULL) == 0 ) return false;
+		return m_pResourceZipIndex->Read(szName, item);
+#else
+		return m_pResourceZipIndex->Read(pstrName, item);
+#endif
+	}
+
 	void CPaintManagerUI::SetInstance(HINSTANCE hInst)
 	{
 		m_hInstance = hInst;
@@ -438,6 +472,11 @@ namespace DuiLib {
 
 	void CPaintManagerUI::SetResourcePath(LPCTSTR pStrPath)
 	{
+		// 图片缓存按名字查找，换了资源目录后旧的图片不能再命中
+		if( m_pStrResourcePath != pStrPath ) {
+			m_ImageCache.Clear();
+			m_GifCache.Clear();
+		}
 		m_pStrResourcePath = pStrPath;
 		if( m_pStrResourcePath.IsEmpty() ) return;
 		TCHAR cEnd = m_pStrResourcePath.GetAt(m_pStrResourcePath.GetLength() - 1);
@@ -447,6 +486,8 @@ namespace DuiLib {
 	void CPaintManagerUI::SetResourceZip(LPVOID pVoid, unsigned int len, LPCTSTR password)
 	{
 		if( m_pStrResourceZip == _T("membuffer") ) return;
+		m_ImageCache.Clear();
+		m_GifCache.Clear();
 		if( m_bCachedResourceZip && m_hResourceZip != NULL ) {
 			CloseZip((HZIP)m_hResourceZip);
 			m_hResourceZip = NULL;
@@ -467,11 +508,23 @@ namespace DuiLib {
 			m_hResourceZip = (HANDLE)OpenZip(pVoid, len, password);
 #endif
 		}
+		// 不带密码时建立中央目录索引，之后的读取不再逐项查找和重新定位
+		delete m_pResourceZipIndex;
+		m_pResourceZipIndex = NULL;
+		if( m_pStrResourceZipPwd.IsEmpty() ) {
+			m_pResourceZipIndex = new CZipResource;
+			if( !m_pResourceZipIndex->Open(pVoid, len) ) {
+				delete m_pResourceZipIndex;
+				m_pResourceZipIndex = NULL;
+			}
+		}
 	}
 
 	void CPaintManagerUI::SetResourceZip(LPCTSTR pStrPath, bool bCachedResourceZip, LPCTSTR password)
 	{
 		if( m_pStrResourceZip == pStrPath && m_bCachedResourceZip == bCachedResourceZip ) return;
+		m_ImageCache.Clear();
+		m_GifCache.Clear();
 		if( m_bCachedResourceZip && m_hResourceZip != NULL ) {
 			CloseZip((HZIP)m_hResourceZip);
 			m_hResourceZip = NULL;
@@ -493,6 +546,17 @@ namespace DuiLib {
 			m_hResourceZip = (HANDLE)OpenZip(sFile.GetData(), password);
 #endif
 		}
+		delete m_pResourceZipIndex;
+		m_pResourceZipIndex = NULL;
+		if( m_bCachedResourceZip && m_pStrResourceZipPwd.IsEmpty() ) {
+			CDuiString sFile = CPaintManagerUI::GetResourcePath();
+			sFile += CPaintManagerUI::GetResourceZip();
+			m_pResourceZipIndex = new CZipResource;
+			if( !m_pResourceZipIndex->Open(sFile.GetData()) ) {
+				delete m_pResourceZipIndex;
+				m_pResourceZipIndex = NULL;
+			}
+		}
 	}
 
 	void CPaintManagerUI::SetResourceType(int nType)
@@ -521,20 +585,30 @@ namespace DuiLib {
 			m_H = CLAMP(H, 0, 360);
 			m_S = CLAMP(S, 0, 200);
 			m_L = CLAMP(L, 0, 200);
-			AdjustSharedImagesHSL();
+			// 缓存的 key 包含加载时的 HSL 参数，下面会就地调整图片，旧的 key 不再对应
+			m_ImageCache.Clear();
+			// 所有窗口的图片放在一起分块并行调整，同一张图片只算一次
+			CStdPtrArray aImages;
+			_CollectHSLImages(m_SharedResInfo, aImages);
 			for( int i = 0; i < m_aPreMessages.GetSize(); i++ ) {
 				CPaintManagerUI* pManager = static_cast<CPaintManagerUI*>(m_aPreMessages[i]);
-				if( pManager != NULL ) pManager->AdjustImagesHSL();
+				if( pManager != NULL ) _CollectHSLImages(pManager->m_ResInfo, aImages);
+			}
+			CRenderEngine::AdjustImages(m_bUseHSL, aImages, m_H, m_S, m_L);
+			for( int i = 0; i < m_aPreMessages.GetSize(); i++ ) {
+				CPaintManagerUI* pManager = static_cast<CPaintManagerUI*>(m_aPreMessages[i]);
+				if( pManager != NULL ) pManager->Invalidate();
 			}
 		}
 	}
 
 	void CPaintManagerUI::ReloadSkin()
 	{
+		// 缓存只清一次，后面的窗口直接使用前面重新加载好的图片
 		ReloadSharedImages();
 		for( int i = 0; i < m_aPreMessages.GetSize(); i++ ) {
 			CPaintManagerUI* pManager = static_cast<CPaintManagerUI*>(m_aPreMessages[i]);
-			pManager->ReloadImages();
+			pManager->_ReloadWindowImages();
 		}
 	}
 
@@ -696,6 +770,19 @@ namespace DuiLib {
 		m_bShowUpdateRect = show;
 	}
 
+	bool CPaintManagerUI::IsRetainedPaint() const
+	{
+		return m_bRetainedPaint;
+	}
+
+	void CPaintManagerUI::SetRetainedPaint(bool bRetained)
+	{
+		if( m_bRetainedPaint == bRetained ) return;
+		m_bRetainedPaint = bRetained;
+		m_bOffscreenRetained = false;
+		if( m_hWndPaint != NULL ) Invalidate();
+	}
+
 	bool CPaintManagerUI::IsNoActivate()
 	{
 		return m_bNoActivate;
@@ -797,6 +884,19 @@ namespace DuiLib {
 		Invalidate();
 	}
 
+	const DWORD* CPaintManagerUI::GetLayeredShapeBits(SIZE& szBits) const
+	{
+		if( !m_bLayered ) return NULL;
+		// 重建离屏位图时 m_pBackgroundBits 不清空，以位图句柄为准
+		HBITMAP hBitmap = m_hbmpBackground != NULL ? m_hbmpBackground : m_hbmpOffscreen;
+		const BYTE* pBits = m_hbmpBackground != NULL ? (const BYTE*)m_pBackgroundBits : m_pOffscreenBits;
+		BITMAP bm = { 0 };
+		if( hBitmap == NULL || pBits == NULL || ::GetObject(hBitmap, sizeof(bm), &bm) == 0 ) return NULL;
+		szBits.cx = bm.bmWidth;
+		szBits.cy = bm.bmHeight;
+		return (const DWORD*)pBits;
+	}
+
 	CShadowUI* CPaintManagerUI::GetShadow()
 	{
 		return &m_shadow;
@@ -995,6 +1095,9 @@ namespace DuiLib {
 					return true;
 				}
 
+				// 把后台已经解码好的皮肤图片放进缓存，绘制时不再同步解码
+				if( m_pImagePreload != NULL ) _PublishPreloadedImages();
+
 				RECT rcClient = { 0 };
 				::GetClientRect(m_hWndPaint, &rcClient);
 
@@ -1110,6 +1213,40 @@ namespace DuiLib {
 					m_hbmpOffscreen = CRenderEngine::CreateARGB32Bitmap(m_hDcPaint, dwWidth, dwHeight, (LPBYTE*)&m_pOffscreenBits); 
 					ASSERT(m_hDcOffscreen);
 					ASSERT(m_hbmpOffscreen);
+					m_bOffscreenRetained = false;
+				}
+				// 保留绘制只重画脏区域里的矩形，离屏位图的其余部分还是上一帧的内容
+				bool bRetained = m_bRetainedPaint && m_bOffscreenPaint && !m_bLayered;
+				if( bRetained ) {
+					if( !m_bOffscreenRetained ) {
+						m_dirtyRegion.Add(rcClient.left, rcClient.top, rcClient.right, rcClient.bottom);
+					}
+					else {
+						// 不是通过 Invalidate 产生的失效（窗口被遮挡后露出、直接调用 InvalidateRect 等）也要重画
+						HRGN hRgnUpdate = ::CreateRectRgn(0, 0, 0, 0);
+						int nRgnType = ::GetUpdateRgn(m_hWndPaint, hRgnUpdate, FALSE);
+						if( nRgnType == SIMPLEREGION || nRgnType == COMPLEXREGION ) {
+							for( int i = 0; i < m_dirtyRegion.GetCount(); i++ ) {
+								const CDirtyRegion::Rect& rcDirty = m_dirtyRegion.GetAt(i);
+								HRGN hRgnDirty = ::CreateRectRgn(rcDirty.left, rcDirty.top, rcDirty.right, rcDirty.bottom);
+								::CombineRgn(hRgnUpdate, hRgnUpdate, hRgnDirty, RGN_DIFF);
+								::DeleteObject(hRgnDirty);
+							}
+							RECT rcRest = { 0 };
+							if( ::GetRgnBox(hRgnUpdate, &rcRest) != NULLREGION ) {
+								m_dirtyRegion.Add(rcRest.left, rcRest.top, rcRest.right, rcRest.bottom);
+							}
+						}
+						::DeleteObject(hRgnUpdate);
+					}
+					CDirtyRegion::Rect rcBound = { rcClient.left, rcClient.top, rcClient.right, rcClient.bottom };
+					m_dirtyRegion.Clip(rcBound);
+					m_dirtyRegion.Detach(m_aPaintRects);
+					m_bOffscreenRetained = true;
+				}
+				else {
+					m_dirtyRegion.Clear();
+					m_bOffscreenRetained = false;
 				}
 				// Begin Windows paint
 				PAINTSTRUCT ps = { 0 };
@@ -1117,15 +1254,31 @@ namespace DuiLib {
 				if( m_bOffscreenPaint ) {
 					HBITMAP hOldBitmap = (HBITMAP) ::SelectObject(m_hDcOffscreen, m_hbmpOffscreen);
 					int iSaveDC = ::SaveDC(m_hDcOffscreen);
-					if (m_bLayered) {
-						for( LONG y = rcClient.bottom - rcPaint.bottom; y < rcClient.bottom - rcPaint.top; ++y ) {
-							for( LONG x = rcPaint.left; x < rcPaint.right; ++x ) {
-								int i = (y * dwWidth + x) * 4;
-								*(DWORD*)(&m_pOffscreenBits[i]) = 0;
+					// 分层窗口直接操作离屏位图的像素，rcLayeredPaint 是 rcPaint 在客户区内的部分
+					RECT rcLayeredPaint = { 0 };
+					if( m_bLayered ) {
+						::IntersectRect(&rcLayeredPaint, &rcPaint, &rcClient);
+						::GdiFlush();
+						FillPixels(GetDibPixel(m_pOffscreenBits, dwWidth, dwHeight, rcLayeredPaint.left, rcLayeredPaint.top), -(ptrdiff_t)dwWidth,
+							rcLayeredPaint.right - rcLayeredPaint.left, rcLayeredPaint.bottom - rcLayeredPaint.top, 0);
+					}
+					if( bRetained ) {
+						for( size_t i = 0; i < m_aPaintRects.size(); i++ ) {
+							RECT rcDirty = { m_aPaintRects[i].left, m_aPaintRects[i].top, m_aPaintRects[i].right, m_aPaintRects[i].bottom };
+							// 控件只要和矩形相交就会整个重画，裁剪到矩形内，避免盖住矩形外没有重画的兄弟控件
+							int iSaveDirtyDC = ::SaveDC(m_hDcOffscreen);
+							::IntersectClipRect(m_hDcOffscreen, rcDirty.left, rcDirty.top, rcDirty.right, rcDirty.bottom);
+							m_pRoot->Paint(m_hDcOffscreen, rcDirty, NULL);
+							for( int j = 0; j < m_aPostPaintControls.GetSize(); j++ ) {
+								CControlUI* pPostPaintControl = static_cast<CControlUI*>(m_aPostPaintControls[j]);
+								pPostPaintControl->DoPostPaint(m_hDcOffscreen, rcDirty);
 							}
+							::RestoreDC(m_hDcOffscreen, iSaveDirtyDC);
 						}
 					}
-					m_pRoot->Paint(m_hDcOffscreen, rcPaint, NULL);
+					else {
+						m_pRoot->Paint(m_hDcOffscreen, rcPaint, NULL);
+					}
 
 					if( m_bLayered ) {
 						for( int i = 0; i < m_aNativeWindow.GetSize(); ) {
@@ -1141,30 +1294,29 @@ namespace DuiLib {
 							RECT rcTemp = { 0 };
 							if( !::IntersectRect(&rcTemp, &rcPaint, &rcChildWnd) ) continue;
 
-							COLORREF* pChildBitmapBits = NULL;
-							HDC hChildMemDC = ::CreateCompatibleDC(m_hDcOffscreen);
-							HBITMAP hChildBitmap = CRenderEngine::CreateARGB32Bitmap(hChildMemDC, rcChildWnd.right-rcChildWnd.left, rcChildWnd.bottom-rcChildWnd.top, (BYTE**)&pChildBitmapBits); 
-							::ZeroMemory(pChildBitmapBits, (rcChildWnd.right - rcChildWnd.left)*(rcChildWnd.bottom - rcChildWnd.top)*4);
-							HBITMAP hOldChildBitmap = (HBITMAP) ::SelectObject(hChildMemDC, hChildBitmap);
-							::SendMessage(hChildWnd, WM_PRINT, (WPARAM)hChildMemDC,(LPARAM)(PRF_CHECKVISIBLE|PRF_CHILDREN|PRF_CLIENT|PRF_OWNED));
-							COLORREF* pChildBitmapBit;
-							for( LONG y = 0; y < rcChildWnd.bottom-rcChildWnd.top; y++ ) {
-								for( LONG x = 0; x < rcChildWnd.right-rcChildWnd.left; x++ ) {
-									pChildBitmapBit = pChildBitmapBits+y*(rcChildWnd.right-rcChildWnd.left) + x;
-									if (*pChildBitmapBit != 0x00000000) *pChildBitmapBit |= 0xff000000;
-								}
-							}
-							::BitBlt(m_hDcOffscreen, rcChildWnd.left, rcChildWnd.top, rcChildWnd.right - rcChildWnd.left,
-								rcChildWnd.bottom - rcChildWnd.top, hChildMemDC, 0, 0, SRCCOPY);
-							::SelectObject(hChildMemDC, hOldChildBitmap);
-							::DeleteObject(hChildBitmap);
-							::DeleteDC(hChildMemDC);
+							int cxChild = rcChildWnd.right - rcChildWnd.left;
+							int cyChild = rcChildWnd.bottom - rcChildWnd.top;
+							unsigned int* pChildBits = _PrepareNativeScratch(cxChild, cyChild);
+							if( pChildBits == NULL ) continue;
+							ptrdiff_t nChildPitch = -(ptrdiff_t)m_szNativeScratch.cx;
+							FillPixels(pChildBits, nChildPitch, cxChild, cyChild, 0);
+							::SendMessage(hChildWnd, WM_PRINT, (WPARAM)m_hDcNativeScratch,(LPARAM)(PRF_CHECKVISIBLE|PRF_CHILDREN|PRF_CLIENT|PRF_OWNED));
+							::GdiFlush();
+							SetOpaqueIfNonZero(pChildBits, nChildPitch, cxChild, cyChild);
+							// 子窗口可能有一部分在客户区外
+							RECT rcCopy = { 0 };
+							if( !::IntersectRect(&rcCopy, &rcChildWnd, &rcClient) ) continue;
+							CopyPixels(GetDibPixel(m_pOffscreenBits, dwWidth, dwHeight, rcCopy.left, rcCopy.top), -(ptrdiff_t)dwWidth,
+								pChildBits + (rcCopy.top - rcChildWnd.top) * nChildPitch + (rcCopy.left - rcChildWnd.left), nChildPitch,
+								rcCopy.right - rcCopy.left, rcCopy.bottom - rcCopy.top);
 						}
 					}
 
-					for( int i = 0; i < m_aPostPaintControls.GetSize(); i++ ) {
-						CControlUI* pPostPaintControl = static_cast<CControlUI*>(m_aPostPaintControls[i]);
-						pPostPaintControl->DoPostPaint(m_hDcOffscreen, rcPaint);
+					if( !bRetained ) {
+						for( int i = 0; i < m_aPostPaintControls.GetSize(); i++ ) {
+							CControlUI* pPostPaintControl = static_cast<CControlUI*>(m_aPostPaintControls[i]);
+							pPostPaintControl->DoPostPaint(m_hDcOffscreen, rcPaint);
+						}
 					}
 
 					::RestoreDC(m_hDcOffscreen, iSaveDC);
@@ -1181,12 +1333,6 @@ namespace DuiLib {
 							rcLayeredClient.right -= m_rcLayeredInset.right;
 							rcLayeredClient.bottom -= m_rcLayeredInset.bottom;
 
-							COLORREF* pOffscreenBits = (COLORREF*)m_pOffscreenBits;
-							COLORREF* pBackgroundBits = m_pBackgroundBits;
-							BYTE A = 0;
-							BYTE R = 0;
-							BYTE G = 0;
-							BYTE B = 0;
 							if (!m_diLayered.sDrawString.IsEmpty()) {
 								if( m_hbmpBackground == NULL) {
 									m_hDcBackground = ::CreateCompatibleDC(m_hDcPaint);
@@ -1203,27 +1349,17 @@ namespace DuiLib {
 									CRenderClip::GenerateClip(m_hDcBackground, rcLayeredClient, clip);
 									CRenderEngine::DrawImageInfo(m_hDcBackground, this, rcLayeredClient, rcLayeredClient, &m_diLayered);
 								}
-								for( LONG y = rcClient.bottom - rcPaint.bottom; y < rcClient.bottom - rcPaint.top; ++y ) {
-									for( LONG x = rcPaint.left; x < rcPaint.right; ++x ) {
-										pOffscreenBits = (COLORREF*)(m_pOffscreenBits + y * dwWidth + x);
-										pBackgroundBits = m_pBackgroundBits + y * dwWidth + x;
-										A = (BYTE)((*pBackgroundBits) >> 24);
-										R = (BYTE)((*pOffscreenBits) >> 16) * A / 255;
-										G = (BYTE)((*pOffscreenBits) >> 8) * A / 255;
-										B = (BYTE)(*pOffscreenBits) * A / 255;
-										*pOffscreenBits = RGB(B, G, R) + ((DWORD)A << 24);
-									}
-								}
+								// 用分层背景图的 alpha 裁剪窗口内容
+								::GdiFlush();
+								ApplyAlphaMask(GetDibPixel(m_pOffscreenBits, dwWidth, dwHeight, rcLayeredPaint.left, rcLayeredPaint.top), -(ptrdiff_t)dwWidth,
+									GetDibPixel((BYTE*)m_pBackgroundBits, dwWidth, dwHeight, rcLayeredPaint.left, rcLayeredPaint.top), -(ptrdiff_t)dwWidth,
+									rcLayeredPaint.right - rcLayeredPaint.left, rcLayeredPaint.bottom - rcLayeredPaint.top);
 							}
 						}
 						else {
-							for( LONG y = rcClient.bottom - rcPaint.bottom; y < rcClient.bottom - rcPaint.top; ++y ) {
-								for( LONG x = rcPaint.left; x < rcPaint.right; ++x ) {
-									int i = (y * dwWidth + x) * 4;
-									if((m_pOffscreenBits[i + 3] == 0)&& (m_pOffscreenBits[i + 0] != 0 || m_pOffscreenBits[i + 1] != 0|| m_pOffscreenBits[i + 2] != 0))
-										m_pOffscreenBits[i + 3] = 255;
-								}
-							}
+							::GdiFlush();
+							RestoreGdiAlpha(GetDibPixel(m_pOffscreenBits, dwWidth, dwHeight, rcLayeredPaint.left, rcLayeredPaint.top), -(ptrdiff_t)dwWidth,
+								rcLayeredPaint.right - rcLayeredPaint.left, rcLayeredPaint.bottom - rcLayeredPaint.top);
 						}
 
 						BLENDFUNCTION bf = { AC_SRC_OVER, 0, m_nOpacity, AC_SRC_ALPHA };
@@ -1232,6 +1368,12 @@ namespace DuiLib {
 						POINT ptSrc   = { 0, 0 };
 						g_fUpdateLayeredWindow(m_hWndPaint, m_hDcPaint, &ptPos, &sizeWnd, m_hDcOffscreen, &ptSrc, 0, &bf, ULW_ALPHA);
 					}
+					else if( bRetained ) {
+						for( size_t i = 0; i < m_aPaintRects.size(); i++ ) {
+							const CDirtyRegion::Rect& rcDirty = m_aPaintRects[i];
+							::BitBlt(m_hDcPaint, rcDirty.left, rcDirty.top, rcDirty.right - rcDirty.left, rcDirty.bottom - rcDirty.top, m_hDcOffscreen, rcDirty.left, rcDirty.top, SRCCOPY);
+						}
+					}
 					else {
 						::BitBlt(m_hDcPaint, rcPaint.left, rcPaint.top, rcPaint.right - rcPaint.left, rcPaint.bottom - rcPaint.top, m_hDcOffscreen, rcPaint.left, rcPaint.top, SRCCOPY);
 					}
@@ -1240,7 +1382,15 @@ namespace DuiLib {
 					if( m_bShowUpdateRect && !m_bLayered ) {
 						HPEN hOldPen = (HPEN)::SelectObject(m_hDcPaint, m_hUpdateRectPen);
 						::SelectObject(m_hDcPaint, ::GetStockObject(HOLLOW_BRUSH));
-						::Rectangle(m_hDcPaint, rcPaint.left, rcPaint.top, rcPaint.right, rcPaint.bottom);
+						if( bRetained ) {
+							for( size_t i = 0; i < m_aPaintRects.size(); i++ ) {
+								const CDirtyRegion::Rect& rcDirty = m_aPaintRects[i];
+								::Rectangle(m_hDcPaint, rcDirty.left, rcDirty.top, rcDirty.right, rcDirty.bottom);
+							}
+						}
+						else {
+							::Rectangle(m_hDcPaint, rcPaint.left, rcPaint.top, rcPaint.right, rcPaint.bottom);
+						}
 						::SelectObject(m_hDcPaint, hOldPen);
 					}
 				}
@@ -1323,24 +1473,8 @@ namespace DuiLib {
 			return true;
 		case WM_TIMER:
 			{
-				for( int i = 0; i < m_aTimers.GetSize(); i++ ) {
-					const TIMERINFO* pTimer = static_cast<TIMERINFO*>(m_aTimers[i]);
-					if(pTimer->hWnd == m_hWndPaint && 
-						pTimer->uWinTimer == LOWORD(wParam) && 
-						pTimer->bKilled == false)
-					{
-						TEventUI event = { 0 };
-						event.Type = UIEVENT_TIMER;
-						event.pSender = pTimer->pSender;
-						event.dwTimestamp = ::GetTickCount();
-						event.ptMouse = m_ptLastMousePos;
-						event.wKeyState = MapKeyState();
-						event.wParam = pTimer->nLocalID;
-						event.lParam = lParam;
-						pTimer->pSender->Event(event);
-						break;
-					}
-				}
+				// 控件的定时器和动画都由调度器管理，窗口只有一个系统定时器
+				if( LOWORD(wParam) == SCHEDULER_TIMERID ) _OnSchedulerTimer();
 			}
 			break;
 		case WM_MOUSEHOVER:
@@ -1870,6 +2004,7 @@ namespace DuiLib {
 		RECT rcClient = { 0 };
 		::GetClientRect(m_hWndPaint, &rcClient);
 		::UnionRect(&m_rcLayeredUpdate, &m_rcLayeredUpdate, &rcClient);
+		m_dirtyRegion.Add(rcClient.left, rcClient.top, rcClient.right, rcClient.bottom);
 		::InvalidateRect(m_hWndPaint, NULL, FALSE);
 	}
 
@@ -1880,9 +2015,32 @@ namespace DuiLib {
 		if( rcItem.right < rcItem.left ) rcItem.right = rcItem.left;
 		if( rcItem.bottom < rcItem.top ) rcItem.bottom = rcItem.top;
 		::UnionRect(&m_rcLayeredUpdate, &m_rcLayeredUpdate, &rcItem);
+		m_dirtyRegion.Add(rcItem.left, rcItem.top, rcItem.right, rcItem.bottom);
 		::InvalidateRect(m_hWndPaint, &rcItem, FALSE);
 	}
 
+	unsigned int* CPaintManagerUI::_PrepareNativeScratch(int cx, int cy)
+	{
+		if( cx <= 0 || cy <= 0 ) return NULL;
+		if( m_hbmpNativeScratch == NULL || cx > m_szNativeScratch.cx || cy > m_szNativeScratch.cy ) {
+			if( m_hDcNativeScratch == NULL ) m_hDcNativeScratch = ::CreateCompatibleDC(m_hDcPaint);
+			if( m_hDcNativeScratch == NULL ) return NULL;
+			SIZE szNew = { MAX(cx, m_szNativeScratch.cx), MAX(cy, m_szNativeScratch.cy) };
+			BYTE* pBits = NULL;
+			HBITMAP hBitmap = CRenderEngine::CreateARGB32Bitmap(m_hDcPaint, szNew.cx, szNew.cy, &pBits);
+			if( hBitmap == NULL ) return NULL;
+			::SelectObject(m_hDcNativeScratch, hBitmap);
+			if( m_hbmpNativeScratch != NULL ) ::DeleteObject(m_hbmpNativeScratch);
+			m_hbmpNativeScratch = hBitmap;
+			m_pNativeScratchBits = pBits;
+			m_szNativeScratch = szNew;
+		}
+		// 子窗口画在临时位图的左上角
+		::SetViewportOrgEx(m_hDcNativeScratch, 0, 0, NULL);
+		::SelectClipRgn(m_hDcNativeScratch, NULL);
+		return GetDibPixel(m_pNativeScratchBits, m_szNativeScratch.cx, m_szNativeScratch.cy, 0, 0);
+	}
+
 	bool CPaintManagerUI::AttachDialog(CControlUI* pControl)
 	{
 		ASSERT(::IsWindow(m_hWndPaint));
@@ -2021,18 +2179,21 @@ namespace DuiLib {
 		//CMenuWnd::DestroyMenu();
 
 		// 清理共享资源
+		InvalidateTextLayouts();
 		// 图片
 		TImageInfo* data;
 		for( int i = 0; i< m_SharedResInfo.m_ImageHash.GetSize(); i++ ) {
 			if(LPCTSTR key = m_SharedResInfo.m_ImageHash.GetAt(i)) {
 				data = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(key, false));
 				if (data) {
-					CRenderEngine::FreeImage(data);
+					_ReleaseImage(data);
 					data = NULL;
 				}
 			}
 		}
 		m_SharedResInfo.m_ImageHash.RemoveAll();
+		m_ImageCache.Clear();
+		m_GifCache.Clear();
 		// 字体
 		TFontInfo* pFontInfo;
 		for( int i = 0; i< m_SharedResInfo.m_CustomFonts.GetSize(); i++ ) {
@@ -2081,6 +2242,8 @@ namespace DuiLib {
 			CloseZip((HZIP)m_hResourceZip);
 			m_hResourceZip = NULL;
 		}
+		delete m_pResourceZipIndex;
+		m_pResourceZipIndex = NULL;
 	}
 
 	CDPI * DuiLib::CPaintManagerUI::GetDPIObj()
@@ -2107,7 +2270,8 @@ namespace DuiLib {
 			prcNewWindow = &rc;
 		}
 		SetWindowPos(GetPaintWindow(), NULL, prcNewWindow->left, prcNewWindow->top, prcNewWindow->right - prcNewWindow->left, prcNewWindow->bottom - prcNewWindow->top, SWP_NOZORDER | SWP_NOACTIVATE);
-		if (GetRoot() != NULL) GetRoot()->NeedUpdate();
+		// 尺寸按 DPI 缩放后，位置没变的控件也要重新布局，不能被父容器跳过
+		if (GetRoot() != NULL) GetRoot()->FindControl(__MarkControlsForUpdate, NULL, UIFIND_ALL);
 		::PostMessage(GetPaintWindow(), WM_USER_SET_DPI, 0, 0);
 	}
 
@@ -2147,6 +2311,7 @@ namespace DuiLib {
 
 	void DuiLib::CPaintManagerUI::RebuildFont(TFontInfo * pFontInfo)
 	{
+		InvalidateTextLayouts();
 		::DeleteObject(pFontInfo->hFont);
 		LOGFONT lf = { 0 };
 		::GetObject(::GetStockObject(DEFAULT_GUI_FONT), sizeof(LOGFONT), &lf);
@@ -2232,81 +2397,111 @@ namespace DuiLib {
 	{
 		ASSERT(pControl!=NULL);
 		ASSERT(uElapse>0);
-		for( int i = 0; i< m_aTimers.GetSize(); i++ ) {
-			TIMERINFO* pTimer = static_cast<TIMERINFO*>(m_aTimers[i]);
-			if( pTimer->pSender == pControl
-				&& pTimer->hWnd == m_hWndPaint
-				&& pTimer->nLocalID == nTimerID ) {
-					if( pTimer->bKilled == true ) {
-						if( ::SetTimer(m_hWndPaint, pTimer->uWinTimer, uElapse, NULL) ) {
-							pTimer->bKilled = false;
-							return true;
-						}
-						return false;
-					}
-					return false;
-			}
-		}
-
-		m_uTimerID = (++m_uTimerID) % 0xF0; //0xf1-0xfe特殊用途
-		if( !::SetTimer(m_hWndPaint, m_uTimerID, uElapse, NULL) ) return FALSE;
-		TIMERINFO* pTimer = new TIMERINFO;
-		if( pTimer == NULL ) return FALSE;
-		pTimer->hWnd = m_hWndPaint;
-		pTimer->pSender = pControl;
-		pTimer->nLocalID = nTimerID;
-		pTimer->uWinTimer = m_uTimerID;
-		pTimer->bKilled = false;
-		return m_aTimers.Add(pTimer);
+		// 和原来一样，已经在运行的定时器不重新设置
+		if( m_timerScheduler.IsSet(pControl, nTimerID) ) return false;
+		if( uElapse == 0 ) uElapse = 1;
+		m_timerScheduler.Set(pControl, nTimerID, ::GetTickCount() + uElapse, uElapse);
+		_SetSchedulerWinTimer();
+		return true;
 	}
 
 	bool CPaintManagerUI::KillTimer(CControlUI* pControl, UINT nTimerID)
 	{
 		ASSERT(pControl!=NULL);
-		for( int i = 0; i< m_aTimers.GetSize(); i++ ) {
-			TIMERINFO* pTimer = static_cast<TIMERINFO*>(m_aTimers[i]);
-			if( pTimer->pSender == pControl
-				&& pTimer->hWnd == m_hWndPaint
-				&& pTimer->nLocalID == nTimerID )
-			{
-				if( pTimer->bKilled == false ) {
-					if( ::IsWindow(m_hWndPaint) ) ::KillTimer(pTimer->hWnd, pTimer->uWinTimer);
-					pTimer->bKilled = true;
-					return true;
-				}
-			}
-		}
-		return false;
+		_CancelFiredTimers(pControl, nTimerID, false);
+		if( !m_timerScheduler.Kill(pControl, nTimerID) ) return false;
+		_SetSchedulerWinTimer();
+		return true;
 	}
 
 	void CPaintManagerUI::KillTimer(CControlUI* pControl)
 	{
 		ASSERT(pControl!=NULL);
-		int count = m_aTimers.GetSize();
-		for( int i = 0, j = 0; i < count; i++ ) {
-			TIMERINFO* pTimer = static_cast<TIMERINFO*>(m_aTimers[i - j]);
-			if( pTimer->pSender == pControl && pTimer->hWnd == m_hWndPaint ) {
-				if( pTimer->bKilled == false ) ::KillTimer(pTimer->hWnd, pTimer->uWinTimer);
-				delete pTimer;
-				m_aTimers.Remove(i - j);
-				j++;
-			}
-		}
+		_CancelFiredTimers(pControl, 0, true);
+		if( m_timerScheduler.KillAll(pControl) > 0 ) _SetSchedulerWinTimer();
 	}
 
 	void CPaintManagerUI::RemoveAllTimers()
 	{
-		for( int i = 0; i < m_aTimers.GetSize(); i++ ) {
-			TIMERINFO* pTimer = static_cast<TIMERINFO*>(m_aTimers[i]);
-			if( pTimer->hWnd == m_hWndPaint ) {
-				if( pTimer->bKilled == false ) {
-					if( ::IsWindow(m_hWndPaint) ) ::KillTimer(m_hWndPaint, pTimer->uWinTimer);
-				}
-				delete pTimer;
-			}
+		m_timerScheduler.Clear();
+		_CancelFiredTimers(NULL, 0, true);
+		if( m_bSchedulerTimer && ::IsWindow(m_hWndPaint) ) ::KillTimer(m_hWndPaint, SCHEDULER_TIMERID);
+		m_bSchedulerTimer = false;
+	}
+
+	bool CPaintManagerUI::SetAnimationTimer(CControlUI* pControl, DWORD dwDueTime)
+	{
+		ASSERT(pControl!=NULL);
+		if( pControl == NULL ) return false;
+		m_timerScheduler.Set(pControl, ANIMATION_TIMERID, dwDueTime, 0);
+		_SetSchedulerWinTimer();
+		return true;
+	}
+
+	void CPaintManagerUI::KillAnimationTimer(CControlUI* pControl)
+	{
+		KillTimer(pControl, ANIMATION_TIMERID);
+	}
+
+	void CPaintManagerUI::_UpdateFrameClock()
+	{
+		// 按显示器刷新率对齐，取不到时按 60Hz
+		int nRefresh = m_hDcPaint != NULL ? ::GetDeviceCaps(m_hDcPaint, VREFRESH) : 0;
+		if( nRefresh <= 1 ) nRefresh = 60;
+		m_timerScheduler.SetFrameClock(0, 1000 / nRefresh);
+	}
+
+	void CPaintManagerUI::_SetSchedulerWinTimer(bool bForce)
+	{
+		if( !::IsWindow(m_hWndPaint) ) return;
+		unsigned int nWake = 0;
+		if( !m_timerScheduler.GetNextWake(nWake) ) {
+			if( m_bSchedulerTimer ) ::KillTimer(m_hWndPaint, SCHEDULER_TIMERID);
+			m_bSchedulerTimer = false;
+			return;
 		}
+		if( !bForce && m_bSchedulerTimer && m_dwSchedulerWake == nWake ) return;
+		// 小于系统定时器精度（10 毫秒）时由系统按最小间隔处理；同一个 ID 重新设置会替换原来的定时器
+		int nDelay = (int)(nWake - ::GetTickCount());
+		if( nDelay < 1 ) nDelay = 1;
+		m_bSchedulerTimer = ::SetTimer(m_hWndPaint, SCHEDULER_TIMERID, nDelay, NULL) != 0;
+		m_dwSchedulerWake = nWake;
+	}
 
-		m_aTimers.Empty();
+	void CPaintManagerUI::_OnSchedulerTimer()
+	{
+		// 同一帧里到期的定时器一起触发，事件的时间戳都是这一帧的时间。这一批放在局部变量里，
+		// 分发前先按下一次唤醒时间设置系统定时器：处理事件时进入模态循环，其他定时器照常触发
+		std::vector<CTimerScheduler::TFired> aFired;
+		DWORD dwFrame = m_timerScheduler.Collect(::GetTickCount(), aFired);
+		_SetSchedulerWinTimer(true);
+		if( aFired.empty() ) return;
+		m_aFiredTimerBatches.push_back(&aFired);
+		for( size_t i = 0; i < aFired.size(); i++ ) {
+			CControlUI* pControl = static_cast<CControlUI*>(aFired[i].pTarget);
+			if( pControl == NULL ) continue;
+			TEventUI event = { 0 };
+			event.Type = UIEVENT_TIMER;
+			event.pSender = pControl;
+			event.dwTimestamp = dwFrame;
+			event.ptMouse = m_ptLastMousePos;
+			event.wKeyState = MapKeyState();
+			event.wParam = aFired[i].nID;
+			pControl->Event(event);
+		}
+		m_aFiredTimerBatches.pop_back();
+	}
+
+	void CPaintManagerUI::_CancelFiredTimers(CControlUI* pControl, UINT nTimerID, bool bAllIDs)
+	{
+		for( size_t iBatch = 0; iBatch < m_aFiredTimerBatches.size(); iBatch++ ) {
+			std::vector<CTimerScheduler::TFired>& aFired = *m_aFiredTimerBatches[iBatch];
+			for( size_t i = 0; i < aFired.size(); i++ ) {
+				if( pControl != NULL && aFired[i].pTarget != pControl ) continue;
+				if( !bAllIDs && aFired[i].nID != nTimerID ) continue;
+				aFired[i].pTarget = NULL;
+			}
+		}
 	}
 
 	void CPaintManagerUI::SetCapture()
@@ -2694,6 +2889,7 @@ namespace DuiLib {
 
 	void CPaintManagerUI::SetDefaultFont(LPCTSTR pStrFontName, int nSize, bool bBold, bool bUnderline, bool bItalic, bool bShared)
 	{
+		InvalidateTextLayouts();
 		LOGFONT lf = { 0 };
 		::GetObject(::GetStockObject(DEFAULT_GUI_FONT), sizeof(LOGFONT), &lf);
 		if(lstrlen(pStrFontName) > 0) {
@@ -2754,6 +2950,8 @@ namespace DuiLib {
 
 	HFONT CPaintManagerUI::AddFont(int id, LPCTSTR pStrFontName, int nSize, bool bBold, bool bUnderline, bool bItalic, bool bShared)
 	{
+		// 同一个 id 的字体会被替换
+		InvalidateTextLayouts();
 		LOGFONT lf = { 0 };
 		::GetObject(::GetStockObject(DEFAULT_GUI_FONT), sizeof(LOGFONT), &lf);
 		if(lstrlen(pStrFontName) > 0) {
@@ -2849,6 +3047,16 @@ namespace DuiLib {
 				}
 			}
 			else {
+				CDuiString key = pstrPath;
+				key.Replace(_T("\\"), _T("/"));
+				CZipResource::Item item;
+				if (CPaintManagerUI::ReadResourceZipItem(key, item)) {
+					dwSize = static_cast<DWORD>(item.size);
+					if (dwSize == 0) break;
+					pData = new BYTE[dwSize];
+					::CopyMemory(pData, item.data, dwSize);
+					break;
+				}
 				sFile += CPaintManagerUI::GetResourceZip();
 				HZIP hz = NULL;
 				if (CPaintManagerUI::IsCachedResourceZip()) hz = (HZIP)CPaintManagerUI::GetResourceZipHandle();
@@ -2865,8 +3073,6 @@ namespace DuiLib {
 				if (hz == NULL) break;
 				ZIPENTRY ze;
 				int i = 0;
-				CDuiString key = pstrPath;
-				key.Replace(_T("\\"), _T("/"));
 				if (FindZipItem(hz, key, true, &i, &ze) != 0) break;
 				dwSize = ze.unc_size;
 				if (dwSize == 0) break;
@@ -3000,6 +3206,7 @@ namespace DuiLib {
 
 	void CPaintManagerUI::RemoveFont(HFONT hFont, bool bShared)
 	{
+		InvalidateTextLayouts();
 		TFontInfo* pFontInfo = NULL;
 		if (bShared)
 		{
@@ -3039,6 +3246,7 @@ namespace DuiLib {
 
 	void CPaintManagerUI::RemoveFont(int id, bool bShared)
 	{
+		InvalidateTextLayouts();
 		TCHAR idBuffer[16];
 		::ZeroMemory(idBuffer, sizeof(idBuffer));
 		_itot(id, idBuffer, 10);
@@ -3068,6 +3276,7 @@ namespace DuiLib {
 
 	void CPaintManagerUI::RemoveAllFonts(bool bShared)
 	{
+		InvalidateTextLayouts();
 		TFontInfo* pFontInfo;
 		if (bShared)
 		{
@@ -3147,10 +3356,39 @@ namespace DuiLib {
 		return pFontInfo;
 	}
 
+	CHtmlTextCache* CPaintManagerUI::GetTextLayoutCache()
+	{
+		// 排版结果保存了字体和图片的指针，它们改变之后整个缓存作废
+		LONG lGeneration = m_lTextLayoutGeneration;
+		if( m_lTextLayoutCacheGeneration != lGeneration ) {
+			m_TextLayoutCache.Clear();
+			m_lTextLayoutCacheGeneration = lGeneration;
+		}
+		return &m_TextLayoutCache;
+	}
+
+	LONG CPaintManagerUI::GetTextLayoutGeneration()
+	{
+		return m_lTextLayoutGeneration;
+	}
+
+	void CPaintManagerUI::InvalidateTextLayouts()
+	{
+		::InterlockedIncrement(&m_lTextLayoutGeneration);
+	}
+
 	const TImageInfo* CPaintManagerUI::GetImage(LPCTSTR bitmap)
 	{
 		TImageInfo* data = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(bitmap));
 		if( !data ) data = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(bitmap));
+		if( !data && m_pImagePreload != NULL ) {
+			// 预加载中的图片：还没解码完就等它（或在当前线程解码），然后放进缓存
+			DWORD mask = 0;
+			bool bUseHSL = false;
+			bool bShared = false;
+			data = _TakePreloadedImage(bitmap, mask, bUseHSL, bShared);
+			if( data ) data = _AddImageInfo(bitmap, data, NULL, mask, bUseHSL, bShared);
+		}
 		return data;
 	}
 
@@ -3171,7 +3409,13 @@ namespace DuiLib {
 	{
 		if( bitmap == NULL || bitmap[0] == _T('\0') ) return NULL;
 
-		TImageInfo* data = NULL;
+		// 其他窗口已经加载过同样的图片
+		TImageInfo* data = static_cast<TImageInfo*>(m_ImageCache.Acquire(_MakeImageKey(bitmap, type, mask, bUseHSL, instance)));
+		if( data != NULL ) {
+			if( m_pImagePreload != NULL ) _DropPreloadedImage(bitmap);
+			return _InsertImageInfo(bitmap, data, bShared);
+		}
+
 		if( type != NULL && lstrlen(type) > 0) {
 			if( isdigit(*bitmap) ) {
 				LPTSTR pstr = NULL;
@@ -3180,50 +3424,122 @@ namespace DuiLib {
 			}
 		}
 		else {
-			data = CRenderEngine::LoadImage(bitmap, NULL, mask, instance);
+			if( m_pImagePreload != NULL ) {
+				DWORD dwPreloadMask = 0;
+				bool bPreloadHSL = false;
+				bool bPreloadShared = false;
+				data = _TakePreloadedImage(bitmap, dwPreloadMask, bPreloadHSL, bPreloadShared);
+				if( data && dwPreloadMask != mask ) {
+					CRenderEngine::FreeImage(data);
+					data = NULL;
+				}
+			}
+			if( data == NULL ) data = CRenderEngine::LoadImage(bitmap, NULL, mask, instance);
 		}
 
 		if( data == NULL ) {
 			return NULL;
 		}
+		return _AddImageInfo(bitmap, data, type, mask, bUseHSL, bShared, instance);
+	}
+
+	CImageCache::Key CPaintManagerUI::_MakeImageKey(LPCTSTR bitmap, LPCTSTR type, DWORD mask, bool bUseHSL, HINSTANCE instance)
+	{
+		CImageCache::Key key;
+		key.sName = bitmap;
+		key.nInstance = 0;
+		if( type != NULL && type[0] != _T('\0') ) {
+			key.sType = type;
+			key.nInstance = (size_t)(instance != NULL ? instance : GetResourceDll());
+		}
+		key.dwMask = mask;
+		// 只有 hsl='true' 的图片受 HSL 影响：最高位表示加载时开启了 HSL，后面依次是 H(9 位)、S、L(各 8 位)
+		key.nHSL = 0;
+		if( bUseHSL ) {
+			key.nHSL = 1u << 30;
+			if( m_bUseHSL ) key.nHSL |= (1u << 31) | ((unsigned int)m_H << 16) | ((unsigned int)m_S << 8) | (unsigned int)m_L;
+		}
+		return key;
+	}
+
+	size_t CPaintManagerUI::_GetImageBytes(const TImageInfo* data)
+	{
+		size_t nBytes = (size_t)data->nX * data->nY * 4;
+		return data->pSrcBits != NULL ? nBytes * 2 : nBytes;
+	}
+
+	void CPaintManagerUI::_SetImageSource(TImageInfo* data)
+	{
+		// HSL 调整总是从加载时的像素计算，保留一份原图
+		data->pSrcBits = NULL;
+		if( !data->bUseHSL ) return;
+		LPBYTE pBits = CRenderEngine::GetImageBits(data);
+		if( pBits == NULL ) return;
+		data->pSrcBits = new BYTE[data->nX * data->nY * 4];
+		::CopyMemory(data->pSrcBits, pBits, data->nX * data->nY * 4);
+	}
+
+	void CPaintManagerUI::_FreeCachedImage(void* pImage)
+	{
+		CRenderEngine::FreeImage(static_cast<TImageInfo*>(pImage));
+	}
+
+	void CPaintManagerUI::_ReleaseImage(TImageInfo* data)
+	{
+		// 排版结果中保存了图片指针
+		InvalidateTextLayouts();
+		// 外部传入的 HBITMAP 不在缓存中，直接释放
+		if( !m_ImageCache.Release(data) ) CRenderEngine::FreeImage(data);
+	}
+
+	// 新加载的图片放进缓存；同样的图片已经在缓存中时释放 data，返回缓存中的那份（已增加引用）
+	TImageInfo* CPaintManagerUI::_CacheImageInfo(LPCTSTR bitmap, TImageInfo* data, LPCTSTR type, DWORD mask, bool bUseHSL, HINSTANCE instance)
+	{
+		CImageCache::Key key = _MakeImageKey(bitmap, type, mask, bUseHSL, instance);
 		data->bUseHSL = bUseHSL;
 		if( type != NULL ) data->sResType = type;
 		data->dwMask = mask;
-		if( data->bUseHSL ) {
-			data->pSrcBits = new BYTE[data->nX * data->nY * 4];
-			::CopyMemory(data->pSrcBits, data->pBits, data->nX * data->nY * 4);
-		}
-		else data->pSrcBits = NULL;
+		_SetImageSource(data);
 		if( m_bUseHSL ) CRenderEngine::AdjustImage(true, data, m_H, m_S, m_L);
-		if (data)
+		return static_cast<TImageInfo*>(m_ImageCache.Insert(key, data, _GetImageBytes(data)));
+	}
+
+	TImageInfo* CPaintManagerUI::_AddImageInfo(LPCTSTR bitmap, TImageInfo* data, LPCTSTR type, DWORD mask, bool bUseHSL, bool bShared, HINSTANCE instance)
+	{
+		data = _CacheImageInfo(bitmap, data, type, mask, bUseHSL, instance);
+		if( data == NULL ) return NULL;
+		return _InsertImageInfo(bitmap, data, bShared);
+	}
+
+	// data 的一个引用交给图片表
+	TImageInfo* CPaintManagerUI::_InsertImageInfo(LPCTSTR bitmap, TImageInfo* data, bool bShared)
+	{
+		if (bShared || m_bForceUseSharedRes)
 		{
-			if (bShared || m_bForceUseSharedRes)
+			TImageInfo* pOldImageInfo = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(bitmap));
+			if (pOldImageInfo)
 			{
-				TImageInfo* pOldImageInfo = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(bitmap));
-				if (pOldImageInfo)
-				{
-					CRenderEngine::FreeImage(pOldImageInfo);
-					m_SharedResInfo.m_ImageHash.Remove(bitmap);
-				}
+				m_SharedResInfo.m_ImageHash.Remove(bitmap);
+				_ReleaseImage(pOldImageInfo);
+			}
 
-				if( !m_SharedResInfo.m_ImageHash.Insert(bitmap, data) ) {
-					CRenderEngine::FreeImage(data);
-					data = NULL;
-				}
+			if( !m_SharedResInfo.m_ImageHash.Insert(bitmap, data) ) {
+				_ReleaseImage(data);
+				data = NULL;
 			}
-			else
+		}
+		else
+		{
+			TImageInfo* pOldImageInfo = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(bitmap));
+			if (pOldImageInfo)
 			{
-				TImageInfo* pOldImageInfo = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(bitmap));
-				if (pOldImageInfo)
-				{
-					CRenderEngine::FreeImage(pOldImageInfo);
-					m_ResInfo.m_ImageHash.Remove(bitmap);
-				}
+				m_ResInfo.m_ImageHash.Remove(bitmap);
+				_ReleaseImage(pOldImageInfo);
+			}
 
-				if( !m_ResInfo.m_ImageHash.Insert(bitmap, data) ) {
-					CRenderEngine::FreeImage(data);
-					data = NULL;
-				}
+			if( !m_ResInfo.m_ImageHash.Insert(bitmap, data) ) {
+				_ReleaseImage(data);
+				data = NULL;
 			}
 		}
 
@@ -3268,13 +3584,14 @@ namespace DuiLib {
 
 	void CPaintManagerUI::RemoveImage(LPCTSTR bitmap, bool bShared)
 	{
+		if( m_pImagePreload != NULL ) _DropPreloadedImage(bitmap);
 		TImageInfo* data = NULL;
 		if (bShared) 
 		{
 			data = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(bitmap));
 			if (data)
 			{
-				CRenderEngine::FreeImage(data) ;
+				_ReleaseImage(data);
 				m_SharedResInfo.m_ImageHash.Remove(bitmap);
 			}
 		}
@@ -3283,7 +3600,7 @@ namespace DuiLib {
 			data = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(bitmap));
 			if (data)
 			{
-				CRenderEngine::FreeImage(data) ;
+				_ReleaseImage(data);
 				m_ResInfo.m_ImageHash.Remove(bitmap);
 			}
 		}
@@ -3291,6 +3608,7 @@ namespace DuiLib {
 
 	void CPaintManagerUI::RemoveAllImages(bool bShared)
 	{
+		_ReleaseImagePreload();
 		if (bShared)
 		{
 			TImageInfo* data;
@@ -3298,7 +3616,7 @@ namespace DuiLib {
 				if(LPCTSTR key = m_SharedResInfo.m_ImageHash.GetAt(i)) {
 					data = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(key, false));
 					if (data) {
-						CRenderEngine::FreeImage(data);
+						_ReleaseImage(data);
 					}
 				}
 			}
@@ -3311,7 +3629,7 @@ namespace DuiLib {
 				if(LPCTSTR key = m_ResInfo.m_ImageHash.GetAt(i)) {
 					data = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(key, false));
 					if (data) {
-						CRenderEngine::FreeImage(data);
+						_ReleaseImage(data);
 					}
 				}
 			}
@@ -3319,33 +3637,17 @@ namespace DuiLib {
 		}
 	}
 
-	void CPaintManagerUI::AdjustSharedImagesHSL()
+	void CPaintManagerUI::_CollectHSLImages(const TResInfo& resInfo, CStdPtrArray& aImages)
 	{
 		TImageInfo* data;
-		for( int i = 0; i< m_SharedResInfo.m_ImageHash.GetSize(); i++ ) {
-			if(LPCTSTR key = m_SharedResInfo.m_ImageHash.GetAt(i)) {
-				data = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(key));
-				if( data && data->bUseHSL ) {
-					CRenderEngine::AdjustImage(m_bUseHSL, data, m_H, m_S, m_L);
-				}
+		for( int i = 0; i< resInfo.m_ImageHash.GetSize(); i++ ) {
+			if(LPCTSTR key = resInfo.m_ImageHash.GetAt(i)) {
+				data = static_cast<TImageInfo*>(resInfo.m_ImageHash.Find(key));
+				if( data && data->bUseHSL && aImages.Find(data) < 0 ) aImages.Add(data);
 			}
 		}
 	}
 
-	void CPaintManagerUI::AdjustImagesHSL()
-	{
-		TImageInfo* data;
-		for( int i = 0; i< m_ResInfo.m_ImageHash.GetSize(); i++ ) {
-			if(LPCTSTR key = m_ResInfo.m_ImageHash.GetAt(i)) {
-				data = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(key));
-				if( data && data->bUseHSL ) {
-					CRenderEngine::AdjustImage(m_bUseHSL, data, m_H, m_S, m_L);
-				}
-			}
-		}
-		Invalidate();
-	}
-
 	void CPaintManagerUI::PostAsyncNotify()
 	{
 		if (!m_bAsyncNotifyPosted) {
@@ -3355,89 +3657,329 @@ namespace DuiLib {
 	}
 	void CPaintManagerUI::ReloadSharedImages()
 	{
-		TImageInfo* data = nullptr;
-		TImageInfo* pNewData = nullptr;
-		for( int i = 0; i< m_SharedResInfo.m_ImageHash.GetSize(); i++ ) {
-			if(LPCTSTR bitmap = m_SharedResInfo.m_ImageHash.GetAt(i)) {
-				data = static_cast<TImageInfo*>(m_SharedResInfo.m_ImageHash.Find(bitmap));
-				if( data != NULL ) {
-					if( !data->sResType.IsEmpty() ) {
-						if( isdigit(*bitmap) ) {
-							LPTSTR pstr = NULL;
-							int iIndex = _tcstol(bitmap, &pstr, 10);
-							pNewData = CRenderEngine::LoadImage(iIndex, data->sResType.GetData(), data->dwMask);
-						}
-					}
-					else {
-						pNewData = CRenderEngine::LoadImage(bitmap, NULL, data->dwMask);
-					}
-					if( pNewData == NULL ) continue;
-
-					CRenderEngine::FreeImage(data, false);
-					data->hBitmap = pNewData->hBitmap;
-					data->pBits = pNewData->pBits;
-					data->nX = pNewData->nX;
-					data->nY = pNewData->nY;
-					data->bAlpha = pNewData->bAlpha;
-					data->pSrcBits = NULL;
-					if( data->bUseHSL ) {
-						data->pSrcBits = new BYTE[data->nX * data->nY * 4];
-						::CopyMemory(data->pSrcBits, data->pBits, data->nX * data->nY * 4);
-					}
-					else data->pSrcBits = NULL;
-					if( m_bUseHSL ) CRenderEngine::AdjustImage(true, data, m_H, m_S, m_L);
+		// 资源可能已经换了，缓存中的图片不再能按名字命中
+		m_ImageCache.Clear();
+		m_GifCache.Clear();
+		_ReloadImages(m_SharedResInfo.m_ImageHash);
+	}
+
+	void CPaintManagerUI::ReloadImages()
+	{
+		m_ImageCache.Clear();
+		m_GifCache.Clear();
+		_ReloadWindowImages();
+	}
+
+	void CPaintManagerUI::_ReloadWindowImages()
+	{
+		_ReleaseImagePreload();
+		RemoveAllDrawInfos();
+		_ReloadImages(m_ResInfo.m_ImageHash);
+		if( m_pRoot ) m_pRoot->Invalidate();
+	}
 
-					delete pNewData;
+	void CPaintManagerUI::_ReloadImages(CStdStringPtrMap& images)
+	{
+		// 旧图片可能同时被其他窗口引用（缓存中同样的图片只有一份），不能就地改写：
+		// 重新加载成新的 TImageInfo 放进缓存，只替换本表中的指针，再释放本表对旧图片的引用。
+		// 加载失败的保留旧图片
+		InvalidateTextLayouts();
+		for( int i = 0; i < images.GetSize(); i++ ) {
+			LPCTSTR bitmap = images.GetAt(i);
+			if( bitmap == NULL ) continue;
+			TImageInfo* data = static_cast<TImageInfo*>(images.Find(bitmap, false));
+			if( data == NULL ) continue;
+
+			LPCTSTR type = data->sResType.IsEmpty() ? NULL : data->sResType.GetData();
+			// 前面的窗口已经重新加载过同样的图片
+			TImageInfo* pNewData = static_cast<TImageInfo*>(m_ImageCache.Acquire(_MakeImageKey(bitmap, type, data->dwMask, data->bUseHSL, NULL)));
+			if( pNewData == NULL ) {
+				if( type != NULL ) {
+					if( isdigit(*bitmap) ) {
+						LPTSTR pstr = NULL;
+						int iIndex = _tcstol(bitmap, &pstr, 10);
+						pNewData = CRenderEngine::LoadImage(iIndex, type, data->dwMask);
+					}
+				}
+				else {
+					pNewData = CRenderEngine::LoadImage(bitmap, NULL, data->dwMask);
 				}
+				if( pNewData == NULL ) continue;
+				pNewData = _CacheImageInfo(bitmap, pNewData, type, data->dwMask, data->bUseHSL, NULL);
+				if( pNewData == NULL ) continue;
 			}
+
+			images.Set(bitmap, pNewData);
+			_ReleaseImage(data);
 		}
 	}
 
-	void CPaintManagerUI::ReloadImages()
+	/////////////////////////////////////////////////////////////////////////////////////
+	//
+	//
+
+	struct CPaintManagerUI::TImagePreload
 	{
-		RemoveAllDrawInfos();
+		// 等待放进缓存的图片，只在 UI 线程访问
+		struct TItem
+		{
+			CDuiString sName;
+			size_t nIndex;		// 在 pLoader 中的序号
+			DWORD dwMask;
+			bool bUseHSL;
+			bool bShared;
+		};
+		// 工作线程读取数据用，与 pLoader 中的序号一一对应
+		struct TSource
+		{
+			CDuiString sFile;		// 资源目录下的文件，使用资源 zip 时为空
+			CDuiString sPath;		// 按原样的路径，对应 LoadImage 最后直接读文件的兜底
+			std::string sZipKey;	// 资源 zip 中的名字（UTF-8）
+			CZipResource* pZip;
+		};
 
-		TImageInfo* data = nullptr;
-		TImageInfo* pNewData = nullptr;
-		for( int i = 0; i< m_ResInfo.m_ImageHash.GetSize(); i++ ) {
-			if(LPCTSTR bitmap = m_ResInfo.m_ImageHash.GetAt(i)) {
-				data = static_cast<TImageInfo*>(m_ResInfo.m_ImageHash.Find(bitmap));
-				if( data != NULL ) {
-					if( !data->sResType.IsEmpty() ) {
-						if( isdigit(*bitmap) ) {
-							LPTSTR pstr = NULL;
-							int iIndex = _tcstol(bitmap, &pstr, 10);
-							pNewData = CRenderEngine::LoadImage(iIndex, data->sResType.GetData(), data->dwMask);
-						}
-					}
-					else {
-						pNewData = CRenderEngine::LoadImage(bitmap, NULL, data->dwMask);
-					}
+		TImagePreload() : pLoader(NULL) {}
 
-					CRenderEngine::FreeImage(data, false);
-					if( pNewData == NULL ) {
-						m_ResInfo.m_ImageHash.Remove(bitmap);
-						continue;
-					}
-					data->hBitmap = pNewData->hBitmap;
-					data->pBits = pNewData->pBits;
-					data->nX = pNewData->nX;
-					data->nY = pNewData->nY;
-					data->bAlpha = pNewData->bAlpha;
-					data->pSrcBits = NULL;
-					if( data->bUseHSL ) {
-						data->pSrcBits = new BYTE[data->nX * data->nY * 4];
-						::CopyMemory(data->pSrcBits, data->pBits, data->nX * data->nY * 4);
-					}
-					else data->pSrcBits = NULL;
-					if( m_bUseHSL ) CRenderEngine::AdjustImage(true, data, m_H, m_S, m_L);
+		static bool MapFile(LPCTSTR pstrFile, CImagePreloader::Source& source)
+		{
+			if( pstrFile == NULL || *pstrFile == _T('\0') ) return false;
+			std::shared_ptr<CMappedFile> pFile(new CMappedFile);
+			if( !pFile->Open(pstrFile) || pFile->Size() == 0 ) return false;
+			source.pData = reinterpret_cast<const unsigned char*>(pFile->Data());
+			source.nSize = pFile->Size();
+			source.pHolder = pFile;
+			return true;
+		}
 
-					delete pNewData;
+		bool Load(size_t nIndex, CImagePreloader::Source& source)
+		{
+			TSource src;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				if( nIndex >= aSources.size() ) return false;
+				src = aSources[nIndex];
+			}
+			if( src.pZip != NULL ) {
+				CZipResource::Item item;
+				if( src.pZip->Read(src.sZipKey.c_str(), item) ) {
+					if( item.size == 0 ) return false;
+					source.pData = item.data;
+					source.nSize = item.size;
+					source.pHolder = item.holder;
+					return true;
 				}
+				// 索引中找不到时 LoadImage 还会用 unzip 再找一次，unzip 不能多线程使用，留给 LoadImage
+				return false;
 			}
+			if( MapFile(src.sFile, source) ) return true;
+			return MapFile(src.sPath, source);
 		}
 
-		if( m_pRoot ) m_pRoot->Invalidate();
+		std::mutex lock;
+		std::vector<TSource> aSources;
+		CStdStringPtrMap mItems;	// 名字 -> TItem*
+		CStdPtrArray aItems;
+		CImagePreloader* pLoader;
+	};
+
+	void CPaintManagerUI::SetImagePreload(bool bEnable)
+	{
+		m_bImagePreload = bEnable;
+	}
+
+	bool CPaintManagerUI::IsImagePreloadEnabled()
+	{
+		return m_bImagePreload;
+	}
+
+	void CPaintManagerUI::SetImageCacheBudget(size_t nBytes)
+	{
+		m_ImageCache.SetBudget(nBytes);
+	}
+
+	size_t CPaintManagerUI::GetImageCacheBudget()
+	{
+		return m_ImageCache.GetBudget();
+	}
+
+	CImageCache::Stats CPaintManagerUI::GetImageCacheStats()
+	{
+		return m_ImageCache.GetStats();
+	}
+
+	const TGifInfo* CPaintManagerUI::AcquireGif(LPCTSTR pstrPath)
+	{
+		if( pstrPath == NULL || pstrPath[0] == _T('\0') ) return NULL;
+		CImageCache::Key key = _MakeImageKey(pstrPath, NULL, 0, false, NULL);
+		TGifInfo* data = static_cast<TGifInfo*>(m_GifCache.Acquire(key));
+		if( data != NULL ) return data;
+		data = CRenderEngine::LoadGif(pstrPath);
+		if( data == NULL ) return NULL;
+		size_t nBytes = (size_t)data->nX * data->nY * data->frames.GetFrameCount() * 4;
+		return static_cast<TGifInfo*>(m_GifCache.Insert(key, data, nBytes));
+	}
+
+	void CPaintManagerUI::ReleaseGif(const TGifInfo* pGif)
+	{
+		if( pGif == NULL ) return;
+		TGifInfo* data = const_cast<TGifInfo*>(pGif);
+		if( !m_GifCache.Release(data) ) CRenderEngine::FreeGif(data);
+	}
+
+	void CPaintManagerUI::_FreeCachedGif(void* pGif)
+	{
+		CRenderEngine::FreeGif(static_cast<TGifInfo*>(pGif));
+	}
+
+	void CPaintManagerUI::PreloadImages(const CMarkup& xml)
+	{
+		if( !m_bImagePreload || !xml.IsValid() ) return;
+		// 带密码或不缓存的资源 zip 没有索引，只能用 unzip 逐个读取，不预加载
+		bool bZip = !m_pStrResourceZip.IsEmpty();
+		if( bZip && m_pResourceZipIndex == NULL ) return;
+
+		std::vector<SkinImageRef<TCHAR> > refs;
+		CollectSkinImages(xml.GetDom(), GetDPIObj()->GetScale(), refs);
+
+		std::vector<TImagePreload::TItem*> aNewItems;
+		std::vector<TImagePreload::TSource> aNewSources;
+		std::vector<unsigned int> aMasks;
+		for( size_t i = 0; i < refs.size(); i++ ) {
+			LPCTSTR pstrName = refs[i].sName.c_str();
+			if( m_ResInfo.m_ImageHash.Find(pstrName) != NULL || m_SharedResInfo.m_ImageHash.Find(pstrName) != NULL ) continue;
+			if( IsImagePreloading(pstrName) ) continue;
+			// 其他窗口已经加载过，直接共用
+			TImageInfo* pCached = static_cast<TImageInfo*>(m_ImageCache.Acquire(_MakeImageKey(pstrName, NULL, refs[i].dwMask, refs[i].bHSL, NULL)));
+			if( pCached != NULL ) {
+				_InsertImageInfo(pstrName, pCached, refs[i].bShared);
+				continue;
+			}
+
+			TImagePreload::TSource src;
+			LPCTSTR pstrPath = CResourceManager::GetInstance()->GetImagePath(pstrName);
+			src.sPath = (pstrPath != NULL && *pstrPath != _T('\0')) ? pstrPath : pstrName;
+			src.pZip = NULL;
+			if( bZip ) {
+				CDuiString sKey = src.sPath;
+				sKey.Replace(_T("\\"), _T("/"));
+#ifdef UNICODE
+				char szKey[MAX_PATH * 3] = { 0 };
+				if( ::WideCharToMultiByte(CP_UTF8, 0, sKey.GetData(), -1, szKey, sizeof(szKey), NULL, NULL) == 0 ) continue;
+				src.sZipKey = szKey;
+#else
+				src.sZipKey = sKey.GetData();
+#endif
+				src.pZip = m_pResourceZipIndex;
+			}
+			else {
+				src.sFile = m_pStrResourcePath + src.sPath;
+			}
+
+			TImagePreload::TItem* pItem = new TImagePreload::TItem;
+			pItem->sName = pstrName;
+			pItem->nIndex = 0;
+			pItem->dwMask = refs[i].dwMask;
+			pItem->bUseHSL = refs[i].bHSL;
+			pItem->bShared = refs[i].bShared;
+			aNewItems.push_back(pItem);
+			aNewSources.push_back(src);
+			aMasks.push_back(refs[i].dwMask);
+		}
+		if( aNewItems.empty() ) return;
+
+		if( m_pImagePreload == NULL ) {
+			m_pImagePreload = new TImagePreload;
+			TImagePreload* pPreload = m_pImagePreload;
+			m_pImagePreload->pLoader = new CImagePreloader([pPreload](size_t nIndex, CImagePreloader::Source& source) {
+				return pPreload->Load(nIndex, source);
+			});
+		}
+		{
+			std::lock_guard<std::mutex> guard(m_pImagePreload->lock);
+			m_pImagePreload->aSources.insert(m_pImagePreload->aSources.end(), aNewSources.begin(), aNewSources.end());
+		}
+		size_t nFirst = m_pImagePreload->pLoader->Add(aMasks);
+		for( size_t i = 0; i < aNewItems.size(); i++ ) {
+			TImagePreload::TItem* pItem = aNewItems[i];
+			pItem->nIndex = nFirst + i;
+			m_pImagePreload->mItems.Insert(pItem->sName, pItem);
+			m_pImagePreload->aItems.Add(pItem);
+		}
+	}
+
+	bool CPaintManagerUI::IsImagePreloading(LPCTSTR bitmap) const
+	{
+		if( m_pImagePreload == NULL || bitmap == NULL ) return false;
+		return m_pImagePreload->mItems.Find(bitmap, false) != NULL;
+	}
+
+	TImageInfo* CPaintManagerUI::_TakePreloadedImage(LPCTSTR bitmap, DWORD& dwMask, bool& bUseHSL, bool& bShared)
+	{
+		if( m_pImagePreload == NULL || bitmap == NULL ) return NULL;
+		TImagePreload::TItem* pItem = static_cast<TImagePreload::TItem*>(m_pImagePreload->mItems.Find(bitmap));
+		if( pItem == NULL ) return NULL;
+
+		TImageInfo* data = NULL;
+		CDecodedImage image;
+		if( m_pImagePreload->pLoader->Take(pItem->nIndex, image) ) {
+			data = CRenderEngine::CreateImageInfo(image.pBits, image.nWidth, image.nHeight, image.bAlpha);
+			FreeDecodedImage(image);
+		}
+		dwMask = pItem->dwMask;
+		bUseHSL = pItem->bUseHSL;
+		bShared = pItem->bShared;
+		_DropPreloadedImage(bitmap);
+		return data;
+	}
+
+	void CPaintManagerUI::_DropPreloadedImage(LPCTSTR bitmap)
+	{
+		if( m_pImagePreload == NULL || bitmap == NULL ) return;
+		TImagePreload::TItem* pItem = static_cast<TImagePreload::TItem*>(m_pImagePreload->mItems.Find(bitmap));
+		if( pItem == NULL ) return;
+		m_pImagePreload->mItems.Remove(bitmap);
+		m_pImagePreload->aItems.Remove(m_pImagePreload->aItems.Find(pItem));
+		delete pItem;
+		if( m_pImagePreload->aItems.IsEmpty() ) _ReleaseImagePreload();
+	}
+
+	void CPaintManagerUI::_PublishPreloadedImages()
+	{
+		if( m_pImagePreload == NULL ) return;
+		CImagePreloader* pLoader = m_pImagePreload->pLoader;
+		// 先判断是否空闲：之后 TryTake 拿不到的图片一定是解码失败的
+		bool bIdle = pLoader->IsIdle();
+		for( int i = 0; i < m_pImagePreload->aItems.GetSize(); ) {
+			TImagePreload::TItem* pItem = static_cast<TImagePreload::TItem*>(m_pImagePreload->aItems[i]);
+			CDecodedImage image;
+			if( !pLoader->TryTake(pItem->nIndex, image) ) {
+				i++;
+				continue;
+			}
+			// 同名图片已经用其他方式加入了缓存（如 restype 资源或外部 HBITMAP），以缓存中的为准
+			LPCTSTR pstrName = pItem->sName;
+			if( m_ResInfo.m_ImageHash.Find(pstrName) == NULL && m_SharedResInfo.m_ImageHash.Find(pstrName) == NULL ) {
+				TImageInfo* data = CRenderEngine::CreateImageInfo(image.pBits, image.nWidth, image.nHeight, image.bAlpha);
+				if( data != NULL ) _AddImageInfo(pstrName, data, NULL, pItem->dwMask, pItem->bUseHSL, pItem->bShared);
+			}
+			FreeDecodedImage(image);
+			m_pImagePreload->mItems.Remove(pstrName);
+			m_pImagePreload->aItems.Remove(i);
+			delete pItem;
+		}
+		// 剩下的都解码失败了，交给 LoadImage 按原来的方式再试（zip 中找不到的条目还会用 unzip 找）
+		if( bIdle || m_pImagePreload->aItems.IsEmpty() ) _ReleaseImagePreload();
+	}
+
+	void CPaintManagerUI::_ReleaseImagePreload()
+	{
+		if( m_pImagePreload == NULL ) return;
+		TImagePreload* pPreload = m_pImagePreload;
+		m_pImagePreload = NULL;
+		// 先停掉工作线程，它们还在使用 pPreload
+		delete pPreload->pLoader;
+		for( int i = 0; i < pPreload->aItems.GetSize(); i++ ) delete static_cast<TImagePreload::TItem*>(pPreload->aItems[i]);
+		delete pPreload;
 	}
 
 	const TDrawInfo* CPaintManagerUI::GetDrawInfo(LPCTSTR pStrImage, LPCTSTR pStrModify)
@@ -3741,6 +4283,12 @@ namespace DuiLib {
 		return NULL;
 	}
 
+	CControlUI* CALLBACK CPaintManagerUI::__MarkControlsForUpdate(CControlUI* pThis, LPVOID pData)
+	{
+		pThis->NeedUpdate();
+		return NULL;
+	}
+
 	bool CPaintManagerUI::TranslateAccelerator(LPMSG pMsg)
 	{
 		for (int i = 0; i < m_aTranslateAccelerator.GetSize(); i++)
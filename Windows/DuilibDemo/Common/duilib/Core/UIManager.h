@@ -117,6 +117,16 @@ namespace DuiLib {
 		DWORD dwMask;
 	} TImageInfo;
 
+	// GIF 动画，所有帧解码一次后从上到下放在一张预乘 alpha 的位图里
+	typedef struct UILIB_API tagTGifInfo
+	{
+		HBITMAP hBitmap;
+		int nX;
+		int nY;					// 一帧的尺寸
+		bool bAlpha;
+		CGifFrames frames;		// 帧数和帧间隔，像素已经复制到位图
+	} TGifInfo;
+
 	typedef struct UILIB_API tagTDrawInfo
 	{
 		tagTDrawInfo();
@@ -146,6 +156,12 @@ namespace DuiLib {
 		double bottom;
 	} TPercentInfo;
 
+	// 进程内共享的图片缓存，见 UIImageCache.h
+	typedef CImageCacheT<TCHAR> CImageCache;
+	// 文字排版结果的缓存，见 UIHtmlText.h
+	typedef CHtmlTextLayoutT<TCHAR> CHtmlTextLayout;
+	typedef CHtmlTextCacheT<TCHAR> CHtmlTextCache;
+
 	typedef struct UILIB_API tagTResInfo
 	{
 		DWORD m_dwDefaultDisabledColor;
@@ -244,6 +260,9 @@ namespace DuiLib {
 		void SetMaxInfo(int cx, int cy);
 		bool IsShowUpdateRect() const;
 		void SetShowUpdateRect(bool show);
+		// 保留绘制：离屏位图保留上次的内容，只重画失效的矩形（非分层窗口的离屏绘制有效）
+		bool IsRetainedPaint() const;
+		void SetRetainedPaint(bool bRetained);
 		bool IsNoActivate();
 		void SetNoActivate(bool bNoActivate);
 
@@ -258,6 +277,9 @@ namespace DuiLib {
 		void SetLayeredOpacity(BYTE nOpacity);
 		LPCTSTR GetLayeredImage();
 		void SetLayeredImage(LPCTSTR pstrImage);
+		// 分层窗口上一次绘制得到的形状：有分层背景图时是背景图的像素，否则是离屏位图。
+		// 自底向上的 32 位 DIB，大小由 szBits 返回；不是分层窗口或还没有绘制过时返回 NULL
+		const DWORD* GetLayeredShapeBits(SIZE& szBits) const;
 
 		CShadowUI* GetShadow();
 
@@ -275,6 +297,9 @@ namespace DuiLib {
 		static const CDuiString& GetResourceZipPwd();
 		static bool IsCachedResourceZip();
 		static HANDLE GetResourceZipHandle();
+		static CZipResource* GetResourceZipIndex();
+		// 通过资源 zip 的索引读取条目，名字与 FindZipItem 相同；没有索引（带密码或不缓存）或读取失败返回 false
+		static bool ReadResourceZipItem(LPCTSTR pstrName, CZipResource::Item& item);
 		static void SetInstance(HINSTANCE hInst);
 		static void SetCurrentPath(LPCTSTR pStrPath);
 		static void SetResourceDll(HINSTANCE hInst);
@@ -320,6 +345,11 @@ namespace DuiLib {
 		void RemoveAllFonts(bool bShared = false);
 		TFontInfo* GetFontInfo(int id);
 		TFontInfo* GetFontInfo(HFONT hFont);
+		// DrawText/DrawHtmlText 的排版结果缓存。字体、图片或 DPI 改变时 InvalidateTextLayouts，
+		// 所有窗口的缓存在下一次使用时清空
+		CHtmlTextCache* GetTextLayoutCache();
+		static LONG GetTextLayoutGeneration();
+		static void InvalidateTextLayouts();
 
 		const TImageInfo* GetImage(LPCTSTR bitmap);
 		const TImageInfo* GetImageEx(LPCTSTR bitmap, LPCTSTR type = NULL, DWORD mask = 0, bool bUseHSL = false, HINSTANCE instance = NULL);
@@ -330,6 +360,20 @@ namespace DuiLib {
 		static void ReloadSharedImages();
 		void ReloadImages();
 
+		// 皮肤图片预加载：PreloadImages 收集皮肤引用的图片，在后台线程并行读取和解码，
+		// 首次绘制前把解码好的图片放进图片缓存。CDialogBuilder::Create 会自动调用，默认开启
+		static void SetImagePreload(bool bEnable);
+		// 各窗口的图片表引用同一份图片；不再被引用的图片按 LRU 保留，总字节数超过预算时释放
+		static void SetImageCacheBudget(size_t nBytes);
+		static size_t GetImageCacheBudget();
+		static CImageCache::Stats GetImageCacheStats();
+		// GIF 动画按路径在进程内共享，所有帧只解码一次；AcquireGif 和 ReleaseGif 成对调用
+		static const TGifInfo* AcquireGif(LPCTSTR pstrPath);
+		static void ReleaseGif(const TGifInfo* pGif);
+		static bool IsImagePreloadEnabled();
+		void PreloadImages(const CMarkup& xml);
+		bool IsImagePreloading(LPCTSTR bitmap) const;
+
 		const TDrawInfo* GetDrawInfo(LPCTSTR pStrImage, LPCTSTR pStrModify);
 		void RemoveDrawInfo(LPCTSTR pStrImage, LPCTSTR pStrModify);
 		void RemoveAllDrawInfos();
@@ -376,6 +420,11 @@ namespace DuiLib {
 		bool KillTimer(CControlUI* pControl, UINT nTimerID);
 		void KillTimer(CControlUI* pControl);
 		void RemoveAllTimers();
+		// 定时器和动画由 CTimerScheduler 统一调度，窗口只有一个系统定时器，同一帧内到期的一起触发。
+		// 动画定时器只触发一次，dwDueTime 为 GetTickCount 的时间；到期时控件收到 wParam 为 ANIMATION_TIMERID 的
+		// UIEVENT_TIMER，dwTimestamp 为这一帧的时间，继续播放时重新设置
+		bool SetAnimationTimer(CControlUI* pControl, DWORD dwDueTime);
+		void KillAnimationTimer(CControlUI* pControl);
 
 		void SetCapture();
 		void ReleaseCapture();
@@ -447,11 +496,33 @@ namespace DuiLib {
 		static CControlUI* CALLBACK __FindControlFromClass(CControlUI* pThis, LPVOID pData);
 		static CControlUI* CALLBACK __FindControlsFromClass(CControlUI* pThis, LPVOID pData);
 		static CControlUI* CALLBACK __FindControlsFromUpdate(CControlUI* pThis, LPVOID pData);
+		static CControlUI* CALLBACK __MarkControlsForUpdate(CControlUI* pThis, LPVOID pData);
 
-		static void AdjustSharedImagesHSL();
-		void AdjustImagesHSL();
+		static void _CollectHSLImages(const TResInfo& resInfo, CStdPtrArray& aImages);
 		void PostAsyncNotify();
 
+		static CImageCache::Key _MakeImageKey(LPCTSTR bitmap, LPCTSTR type, DWORD mask, bool bUseHSL, HINSTANCE instance);
+		static size_t _GetImageBytes(const TImageInfo* data);
+		static void _SetImageSource(TImageInfo* data);
+		static void _FreeCachedImage(void* pImage);
+		static void _ReleaseImage(TImageInfo* data);
+		static void _FreeCachedGif(void* pGif);
+		void _UpdateFrameClock();
+		void _SetSchedulerWinTimer(bool bForce = false);
+		void _OnSchedulerTimer();
+		// pControl 为 NULL 时取消所有目标，bAllIDs 时忽略 nTimerID
+		void _CancelFiredTimers(CControlUI* pControl, UINT nTimerID, bool bAllIDs);
+		static TImageInfo* _CacheImageInfo(LPCTSTR bitmap, TImageInfo* data, LPCTSTR type, DWORD mask, bool bUseHSL, HINSTANCE instance);
+		TImageInfo* _AddImageInfo(LPCTSTR bitmap, TImageInfo* data, LPCTSTR type, DWORD mask, bool bUseHSL, bool bShared, HINSTANCE instance = NULL);
+		TImageInfo* _InsertImageInfo(LPCTSTR bitmap, TImageInfo* data, bool bShared);
+		static void _ReloadImages(CStdStringPtrMap& images);
+		void _ReloadWindowImages();
+		TImageInfo* _TakePreloadedImage(LPCTSTR bitmap, DWORD& dwMask, bool& bUseHSL, bool& bShared);
+		void _DropPreloadedImage(LPCTSTR bitmap);
+		void _PublishPreloadedImages();
+		void _ReleaseImagePreload();
+		unsigned int* _PrepareNativeScratch(int cx, int cy);
+
 	private:
 		CDuiString m_sName;
 		HWND m_hWndPaint;	//所附加的窗体的句柄
@@ -462,6 +533,11 @@ namespace DuiLib {
 		BYTE* m_pOffscreenBits;
 		HBITMAP m_hbmpBackground;
 		COLORREF* m_pBackgroundBits;
+		// 分层窗口取原生子窗口图像的临时位图，只增大不缩小，各个子窗口和每次绘制共用
+		HDC m_hDcNativeScratch;
+		HBITMAP m_hbmpNativeScratch;
+		BYTE* m_pNativeScratchBits;
+		SIZE m_szNativeScratch;
 
 		// 提示信息
 		HWND m_hwndTooltip;
@@ -485,7 +561,6 @@ namespace DuiLib {
 		RECT m_rcSizeBox;
 		SIZE m_szRoundCorner;
 		RECT m_rcCaption;
-		UINT m_uTimerID;
 		bool m_bFirstLayout;
 		bool m_bUpdateNeeded;
 		bool m_bFocusNeeded;
@@ -496,6 +571,10 @@ namespace DuiLib {
 		RECT m_rcLayeredInset;
 		bool m_bLayeredChanged;
 		RECT m_rcLayeredUpdate;
+		bool m_bRetainedPaint;
+		bool m_bOffscreenRetained;		// 离屏位图里是否是完整的上一帧
+		CDirtyRegion m_dirtyRegion;
+		std::vector<CDirtyRegion::Rect> m_aPaintRects;
 		TDrawInfo m_diLayered;
 
 		bool m_bMouseTracking;
@@ -506,7 +585,13 @@ namespace DuiLib {
 
 		//
 		CStdPtrArray m_aNotifiers;
-		CStdPtrArray m_aTimers;
+		CTimerScheduler m_timerScheduler;
+		// 正在分发的各批定时器（分发中进入模态循环时会嵌套），中途删除的目标置为 NULL
+		std::vector<std::vector<CTimerScheduler::TFired>*> m_aFiredTimerBatches;
+		bool m_bSchedulerTimer;
+		DWORD m_dwSchedulerWake;
+		CHtmlTextCache m_TextLayoutCache;
+		LONG m_lTextLayoutCacheGeneration;
 		CStdPtrArray m_aTranslateAccelerator;
 		CStdPtrArray m_aPreMessageFilters;
 		CStdPtrArray m_aMessageFilters;
@@ -524,6 +609,8 @@ namespace DuiLib {
 		
 		bool m_bForceUseSharedRes;
 		TResInfo m_ResInfo;
+		struct TImagePreload;
+		TImagePreload* m_pImagePreload;
 		
 		// 窗口阴影
 		CShadowUI m_shadow;
@@ -548,9 +635,14 @@ namespace DuiLib {
 		static CDuiString m_pStrResourceZipPwd;
 		static HANDLE m_hResourceZip;
 		static bool m_bCachedResourceZip;
+		static CZipResource* m_pResourceZipIndex;
 		static int m_nResType;
+		static CImageCache m_ImageCache;
+		static CImageCache m_GifCache;
+		static volatile LONG m_lTextLayoutGeneration;
 		static TResInfo m_SharedResInfo;
 		static bool m_bUseHSL;
+		static bool m_bImagePreload;
 		static short m_H;
 		static short m_S;
 		static short m_L;
@@ -9,62 +9,53 @@ namespace DuiLib {
 //
 //
 //
-CMarkupNode::CMarkupNode() : m_pOwner(NULL)
+CMarkupNode::CMarkupNode() : m_pNode(NULL), m_pOwner(NULL)
 {
 }
 
-CMarkupNode::CMarkupNode(CMarkup* pOwner, int iPos) : m_pOwner(pOwner), m_iPos(iPos), m_nAttributes(0)
+CMarkupNode::CMarkupNode(CMarkup* pOwner, CMarkup::XMLDOM::Node* pNode) : m_pNode(pNode), m_pOwner(pOwner)
 {
 }
 
 CMarkupNode CMarkupNode::GetSibling()
 {
     if( m_pOwner == NULL ) return CMarkupNode();
-    ULONG iPos = m_pOwner->m_pElements[m_iPos].iNext;
-    if( iPos == 0 ) return CMarkupNode();
-    return CMarkupNode(m_pOwner, iPos);
+    if( m_pNode->pNext == NULL ) return CMarkupNode();
+    return CMarkupNode(m_pOwner, m_pNode->pNext);
 }
 
 bool CMarkupNode::HasSiblings() const
 {
     if( m_pOwner == NULL ) return false;
-    ULONG iPos = m_pOwner->m_pElements[m_iPos].iNext;
-    return iPos > 0;
+    return m_pNode->pNext != NULL;
 }
 
 CMarkupNode CMarkupNode::GetChild()
 {
     if( m_pOwner == NULL ) return CMarkupNode();
-    ULONG iPos = m_pOwner->m_pElements[m_iPos].iChild;
-    if( iPos == 0 ) return CMarkupNode();
-    return CMarkupNode(m_pOwner, iPos);
+    if( m_pNode->pChild == NULL ) return CMarkupNode();
+    return CMarkupNode(m_pOwner, m_pNode->pChild);
 }
 
 CMarkupNode CMarkupNode::GetChild(LPCTSTR pstrName)
 {
     if( m_pOwner == NULL ) return CMarkupNode();
-    ULONG iPos = m_pOwner->m_pElements[m_iPos].iChild;
-    while( iPos != 0 ) {
-        if( _tcsicmp(m_pOwner->m_pstrXML + m_pOwner->m_pElements[iPos].iStart, pstrName) == 0 ) {
-            return CMarkupNode(m_pOwner, iPos);
-        }
-        iPos = m_pOwner->m_pElements[iPos].iNext;
-    }
-    return CMarkupNode();
+    CMarkup::XMLDOM::Node* pChild = m_pOwner->m_dom.FindChild(m_pNode, pstrName);
+    if( pChild == NULL ) return CMarkupNode();
+    return CMarkupNode(m_pOwner, pChild);
 }
 
 bool CMarkupNode::HasChildren() const
 {
     if( m_pOwner == NULL ) return false;
-    return m_pOwner->m_pElements[m_iPos].iChild != 0;
+    return m_pNode->pChild != NULL;
 }
 
 CMarkupNode CMarkupNode::GetParent()
 {
     if( m_pOwner == NULL ) return CMarkupNode();
-    ULONG iPos = m_pOwner->m_pElements[m_iPos].iParent;
-    if( iPos == 0 ) return CMarkupNode();
-    return CMarkupNode(m_pOwner, iPos);
+    if( m_pNode->pParent == NULL ) return CMarkupNode();
+    return CMarkupNode(m_pOwner, m_pNode->pParent);
 }
 
 bool CMarkupNode::IsValid() const
@@ -75,104 +66,83 @@ bool CMarkupNode::IsValid() const
 LPCTSTR CMarkupNode::GetName() const
 {
     if( m_pOwner == NULL ) return NULL;
-    return m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iStart;
+    return m_pNode->pName;
 }
 
 LPCTSTR CMarkupNode::GetValue() const
 {
     if( m_pOwner == NULL ) return NULL;
-    return m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iData;
+    return m_pNode->pValue;
+}
+
+UINT CMarkupNode::GetClassId() const
+{
+    if( m_pOwner == NULL ) return SKIN_CLASS_UNKNOWN;
+    return m_pNode->nClassId;
 }
 
 LPCTSTR CMarkupNode::GetAttributeName(int iIndex)
 {
     if( m_pOwner == NULL ) return NULL;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    if( iIndex < 0 || iIndex >= m_nAttributes ) return _T("");
-    return m_pOwner->m_pstrXML + m_aAttributes[iIndex].iName;
+    if( iIndex < 0 || iIndex >= (int)m_pNode->nAttributes ) return _T("");
+    return m_pNode->pAttributes[iIndex].pName;
 }
 
 LPCTSTR CMarkupNode::GetAttributeValue(int iIndex)
 {
     if( m_pOwner == NULL ) return NULL;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    if( iIndex < 0 || iIndex >= m_nAttributes ) return _T("");
-    return m_pOwner->m_pstrXML + m_aAttributes[iIndex].iValue;
+    if( iIndex < 0 || iIndex >= (int)m_pNode->nAttributes ) return _T("");
+    return m_pNode->pAttributes[iIndex].pValue;
 }
 
 LPCTSTR CMarkupNode::GetAttributeValue(LPCTSTR pstrName)
 {
     if( m_pOwner == NULL ) return NULL;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    for( int i = 0; i < m_nAttributes; i++ ) {
-        if( _tcsicmp(m_pOwner->m_pstrXML + m_aAttributes[i].iName, pstrName) == 0 ) return m_pOwner->m_pstrXML + m_aAttributes[i].iValue;
-    }
-    return _T("");
+    const CMarkup::XMLDOM::Attribute* pAttribute = m_pOwner->m_dom.FindAttribute(m_pNode, pstrName);
+    if( pAttribute == NULL ) return _T("");
+    return pAttribute->pValue;
 }
 
 bool CMarkupNode::GetAttributeValue(int iIndex, LPTSTR pstrValue, SIZE_T cchMax)
 {
     if( m_pOwner == NULL ) return false;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    if( iIndex < 0 || iIndex >= m_nAttributes ) return false;
-    _tcsncpy(pstrValue, m_pOwner->m_pstrXML + m_aAttributes[iIndex].iValue, cchMax);
+    if( iIndex < 0 || iIndex >= (int)m_pNode->nAttributes ) return false;
+    _tcsncpy(pstrValue, m_pNode->pAttributes[iIndex].pValue, cchMax);
     return true;
 }
 
 bool CMarkupNode::GetAttributeValue(LPCTSTR pstrName, LPTSTR pstrValue, SIZE_T cchMax)
 {
     if( m_pOwner == NULL ) return false;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    for( int i = 0; i < m_nAttributes; i++ ) {
-        if( _tcsicmp(m_pOwner->m_pstrXML + m_aAttributes[i].iName, pstrName) == 0 ) {
-            _tcsncpy(pstrValue, m_pOwner->m_pstrXML + m_aAttributes[i].iValue, cchMax);
-            return true;
-        }
-    }
-    return false;
+    const CMarkup::XMLDOM::Attribute* pAttribute = m_pOwner->m_dom.FindAttribute(m_pNode, pstrName);
+    if( pAttribute == NULL ) return false;
+    _tcsncpy(pstrValue, pAttribute->pValue, cchMax);
+    return true;
+}
+
+const CMarkupTypedValue* CMarkupNode::GetAttributeTypedValue(int iIndex)
+{
+    if( m_pOwner == NULL ) return NULL;
+    if( iIndex < 0 || iIndex >= (int)m_pNode->nAttributes ) return NULL;
+    return m_pNode->pAttributes[iIndex].pTyped;
 }
 
 int CMarkupNode::GetAttributeCount()
 {
     if( m_pOwner == NULL ) return 0;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    return m_nAttributes;
+    return (int)m_pNode->nAttributes;
 }
 
 bool CMarkupNode::HasAttributes()
 {
     if( m_pOwner == NULL ) return false;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    return m_nAttributes > 0;
+    return m_pNode->nAttributes > 0;
 }
 
 bool CMarkupNode::HasAttribute(LPCTSTR pstrName)
 {
     if( m_pOwner == NULL ) return false;
-    if( m_nAttributes == 0 ) _MapAttributes();
-    for( int i = 0; i < m_nAttributes; i++ ) {
-        if( _tcsicmp(m_pOwner->m_pstrXML + m_aAttributes[i].iName, pstrName) == 0 ) return true;
-    }
-    return false;
-}
-
-void CMarkupNode::_MapAttributes()
-{
-    m_nAttributes = 0;
-    LPCTSTR pstr = m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iStart;
-    LPCTSTR pstrEnd = m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iData;
-    pstr += _tcslen(pstr) + 1;
-    while( pstr < pstrEnd ) {
-        m_pOwner->_SkipWhitespace(pstr);
-        m_aAttributes[m_nAttributes].iName = pstr - m_pOwner->m_pstrXML;
-        pstr += _tcslen(pstr) + 1;
-        m_pOwner->_SkipWhitespace(pstr);
-        if( *pstr++ != _T('\"') ) return; // if( *pstr != _T('\"') ) { pstr = ::CharNext(pstr); return; }
-        
-        m_aAttributes[m_nAttributes++].iValue = pstr - m_pOwner->m_pstrXML;
-        if( m_nAttributes >= MAX_XML_ATTRIBUTES ) return;
-        pstr += _tcslen(pstr) + 1;
-    }
+    return m_pOwner->m_dom.FindAttribute(m_pNode, pstrName) != NULL;
 }
 
 
@@ -184,8 +154,8 @@ void CMarkupNode::_MapAttributes()
 CMarkup::CMarkup(LPCTSTR pstrXML)
 {
     m_pstrXML = NULL;
-    m_pElements = NULL;
-    m_nElements = 0;
+    m_pBinaryView = NULL;
+    m_pBinaryData = NULL;
     m_bPreserveWhitespace = true;
     if( pstrXML != NULL ) Load(pstrXML);
 }
@@ -197,7 +167,7 @@ CMarkup::~CMarkup()
 
 bool CMarkup::IsValid() const
 {
-    return m_pElements != NULL;
+    return m_dom.IsValid();
 }
 
 void CMarkup::SetPreserveWhitespace(bool bPreserve)
@@ -218,6 +188,7 @@ bool CMarkup::Load(LPCTSTR pstrXML)
 
 bool CMarkup::LoadFromMem(BYTE* pByte, DWORD dwSize, int encoding)
 {
+    Release();
 #ifdef _UNICODE
     if (encoding == XMLFILE_ENCODING_UTF8)
     {
@@ -332,12 +303,27 @@ bool CMarkup::LoadFromMem(BYTE* pByte, DWORD dwSize, int encoding)
     return bRes;
 }
 
+bool CMarkup::LoadFromBinary(const BYTE* pByte, DWORD dwSize)
+{
+    Release();
+    if( pByte == NULL || dwSize == 0 ) return _Failed(_T("Skin binary is empty"));
+    // 记录按 4 字节对齐读取，malloc 的内存满足要求
+    m_pBinaryData = static_cast<LPBYTE>(malloc(dwSize));
+    if( m_pBinaryData == NULL ) return _Failed(_T("Out of memory"));
+    ::CopyMemory(m_pBinaryData, pByte, dwSize);
+    bool bRes = _LoadBinary(m_pBinaryData, dwSize);
+    if( !bRes ) Release();
+    return bRes;
+}
+
 bool CMarkup::LoadFromFile(LPCTSTR pstrFilename, int encoding)
 {
     Release();
     CDuiString sFile = CPaintManagerUI::GetResourcePath();
     if( CPaintManagerUI::GetResourceZip().IsEmpty() ) {
         sFile += pstrFilename;
+        // 同目录下有不比 XML 旧的预编译皮肤时直接映射使用，失败再解析 XML
+        if( encoding == XMLFILE_ENCODING_UTF8 && _LoadBinaryFile(sFile) ) return true;
         HANDLE hFile = ::CreateFile(sFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
         if( hFile == INVALID_HANDLE_VALUE ) return _Failed(_T("Error opening file"));
         DWORD dwSize = ::GetFileSize(hFile, NULL);
@@ -362,6 +348,21 @@ bool CMarkup::LoadFromFile(LPCTSTR pstrFilename, int encoding)
         return ret;
     }
     else {
+		CDuiString key = pstrFilename;
+		key.Replace(_T("\\"), _T("/"));
+		CZipResource::Item item;
+		if( CPaintManagerUI::ReadResourceZipItem(key, item) ) {
+			DWORD dwSize = static_cast<DWORD>(item.size);
+			if( dwSize == 0 ) return _Failed(_T("File is empty"));
+			if ( dwSize > 4096*1024 ) return _Failed(_T("File too large"));
+			// LoadFromMem 可能原地改写数据（UTF-16 BE），不能直接用映射中的内存
+			BYTE* pByte = new BYTE[ dwSize ];
+			::CopyMemory(pByte, item.data, dwSize);
+			bool ret = LoadFromMem(pByte, dwSize, encoding);
+			delete[] pByte;
+			pByte = NULL;
+			return ret;
+		}
 		sFile += CPaintManagerUI::GetResourceZip();
 		HZIP hz = NULL;
         if( CPaintManagerUI::IsCachedResourceZip() ) hz = (HZIP)CPaintManagerUI::GetResourceZipHandle();
@@ -378,8 +379,6 @@ bool CMarkup::LoadFromFile(LPCTSTR pstrFilename, int encoding)
         if( hz == NULL ) return _Failed(_T("Error opening zip file"));
         ZIPENTRY ze; 
         int i = 0; 
-		CDuiString key = pstrFilename;
-		key.Replace(_T("\\"), _T("/"));
         if( FindZipItem(hz, key, true, &i, &ze) != 0 ) return _Failed(_T("Could not find ziped file"));
         DWORD dwSize = ze.unc_size;
         if( dwSize == 0 ) return _Failed(_T("File is empty"));
@@ -401,229 +400,108 @@ bool CMarkup::LoadFromFile(LPCTSTR pstrFilename, int encoding)
 
 void CMarkup::Release()
 {
+    m_dom.Release();
     if( m_pstrXML != NULL ) free(m_pstrXML);
-    if( m_pElements != NULL ) free(m_pElements);
     m_pstrXML = NULL;
-    m_pElements = NULL;
-    m_nElements = 0;
+    if( m_pBinaryView != NULL ) ::UnmapViewOfFile(m_pBinaryView);
+    m_pBinaryView = NULL;
+    if( m_pBinaryData != NULL ) free(m_pBinaryData);
+    m_pBinaryData = NULL;
 }
 
-void CMarkup::GetLastErrorMessage(LPTSTR pstrMessage, SIZE_T cchMax) const
+bool CMarkup::_LoadBinary(const void* pData, DWORD dwSize)
 {
-    _tcsncpy(pstrMessage, m_szErrorMsg, cchMax);
-}
-
-void CMarkup::GetLastErrorLocation(LPTSTR pstrSource, SIZE_T cchMax) const
-{
-    _tcsncpy(pstrSource, m_szErrorXML, cchMax);
-}
-
-CMarkupNode CMarkup::GetRoot()
-{
-    if( m_nElements == 0 ) return CMarkupNode();
-    return CMarkupNode(this, 1);
-}
-
-bool CMarkup::_Parse()
-{
-    _ReserveElement(); // Reserve index 0 for errors
     ::ZeroMemory(m_szErrorMsg, sizeof(m_szErrorMsg));
     ::ZeroMemory(m_szErrorXML, sizeof(m_szErrorXML));
-    LPTSTR pstrXML = m_pstrXML;
-    return _Parse(pstrXML, 0);
+#ifdef _UNICODE
+    CSkinBinaryReader reader;
+    if( !reader.Open(pData, dwSize) ) return _Failed(_T("Invalid skin binary"));
+    if( !LoadSkinBinary(reader, m_dom) ) return _Failed(_T("Out of memory"));
+    return true;
+#else
+    // 预编译皮肤的字符串是 UTF-16，只能在 Unicode 版本中直接使用
+    return _Failed(_T("Skin binary requires UNICODE"));
+#endif
 }
 
-bool CMarkup::_Parse(LPTSTR& pstrText, ULONG iParent)
+bool CMarkup::_LoadBinaryFile(LPCTSTR pstrXmlFile)
 {
-    _SkipWhitespace(pstrText);
-    ULONG iPrevious = 0;
-    for( ; ; ) 
-    {
-        if( *pstrText == _T('\0') && iParent <= 1 ) return true;
-        _SkipWhitespace(pstrText);
-        if( *pstrText != _T('<') ) return _Failed(_T("Expected start tag"), pstrText);
-        if( pstrText[1] == _T('/') ) return true;
-        *pstrText++ = _T('\0');
-        _SkipWhitespace(pstrText);
-        // Skip comment or processing directive
-        if( *pstrText == _T('!') || *pstrText == _T('?') ) {
-            TCHAR ch = *pstrText;
-            if( *pstrText == _T('!') ) ch = _T('-');
-            while( *pstrText != _T('\0') && !(*pstrText == ch && *(pstrText + 1) == _T('>')) ) pstrText = ::CharNext(pstrText);
-            if( *pstrText != _T('\0') ) pstrText += 2;
-            _SkipWhitespace(pstrText);
-            continue;
-        }
-        _SkipWhitespace(pstrText);
-        // Fill out element structure
-        XMLELEMENT* pEl = _ReserveElement();
-        ULONG iPos = pEl - m_pElements;
-        pEl->iStart = pstrText - m_pstrXML;
-        pEl->iParent = iParent;
-        pEl->iNext = pEl->iChild = 0;
-        if( iPrevious != 0 ) m_pElements[iPrevious].iNext = iPos;
-        else if( iParent > 0 ) m_pElements[iParent].iChild = iPos;
-        iPrevious = iPos;
-        // Parse name
-        LPCTSTR pstrName = pstrText;
-        _SkipIdentifier(pstrText);
-        LPTSTR pstrNameEnd = pstrText;
-        if( *pstrText == _T('\0') ) return _Failed(_T("Error parsing element name"), pstrText);
-        // Parse attributes
-        if( !_ParseAttributes(pstrText) ) return false;
-        _SkipWhitespace(pstrText);
-        if( pstrText[0] == _T('/') && pstrText[1] == _T('>') )
-        {
-            pEl->iData = pstrText - m_pstrXML;
-            *pstrText = _T('\0');
-            pstrText += 2;
-        }
-        else
-        {
-            if( *pstrText != _T('>') ) return _Failed(_T("Expected start-tag closing"), pstrText);
-            // Parse node data
-            pEl->iData = ++pstrText - m_pstrXML;
-            LPTSTR pstrDest = pstrText;
-            if( !_ParseData(pstrText, pstrDest, _T('<')) ) return false;
-            // Determine type of next element
-            if( *pstrText == _T('\0') && iParent <= 1 ) return true;
-            if( *pstrText != _T('<') ) return _Failed(_T("Expected end-tag start"), pstrText);
-            if( pstrText[0] == _T('<') && pstrText[1] != _T('/') ) 
-            {
-                if( !_Parse(pstrText, iPos) ) return false;
-            }
-            if( pstrText[0] == _T('<') && pstrText[1] == _T('/') ) 
-            {
-                *pstrDest = _T('\0');
-                *pstrText = _T('\0');
-                pstrText += 2;
-                _SkipWhitespace(pstrText);
-                SIZE_T cchName = pstrNameEnd - pstrName;
-                if( _tcsncmp(pstrText, pstrName, cchName) != 0 ) return _Failed(_T("Unmatched closing tag"), pstrText);
-                pstrText += cchName;
-                _SkipWhitespace(pstrText);
-                if( *pstrText++ != _T('>') ) return _Failed(_T("Unmatched closing tag"), pstrText);
-            }
-        }
-        *pstrNameEnd = _T('\0');
-        _SkipWhitespace(pstrText);
+#ifdef _UNICODE
+    // 预编译皮肤按保留空白的方式生成
+    if( !m_bPreserveWhitespace ) return false;
+
+    CDuiString sBinary = pstrXmlFile;
+    sBinary += _T(".skb");
+    HANDLE hFile = ::CreateFile(sBinary, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if( hFile == INVALID_HANDLE_VALUE ) return false;
+
+    // XML 比预编译皮肤新说明改过之后没有重新编译，以 XML 为准
+    FILETIME ftBinary = { 0 };
+    WIN32_FILE_ATTRIBUTE_DATA xmlData = { 0 };
+    if( !::GetFileTime(hFile, NULL, NULL, &ftBinary) ||
+        (::GetFileAttributesEx(pstrXmlFile, GetFileExInfoStandard, &xmlData) && ::CompareFileTime(&xmlData.ftLastWriteTime, &ftBinary) > 0) ) {
+        ::CloseHandle(hFile);
+        return false;
     }
-}
 
-CMarkup::XMLELEMENT* CMarkup::_ReserveElement()
-{
-    if( m_nElements == 0 ) m_nReservedElements = 0;
-    if( m_nElements >= m_nReservedElements ) {
-        m_nReservedElements += (m_nReservedElements / 2) + 500;
-        m_pElements = static_cast<XMLELEMENT*>(realloc(m_pElements, m_nReservedElements * sizeof(XMLELEMENT)));
+    DWORD dwSize = ::GetFileSize(hFile, NULL);
+    if( dwSize == INVALID_FILE_SIZE || dwSize < sizeof(SkinBinaryHeader) || dwSize > 4096*1024 ) {
+        ::CloseHandle(hFile);
+        return false;
     }
-    return &m_pElements[m_nElements++];
-}
-
-void CMarkup::_SkipWhitespace(LPCTSTR& pstr) const
-{
-    while( *pstr > _T('\0') && *pstr <= _T(' ') ) pstr = ::CharNext(pstr);
-}
-
-void CMarkup::_SkipWhitespace(LPTSTR& pstr) const
-{
-    while( *pstr > _T('\0') && *pstr <= _T(' ') ) pstr = ::CharNext(pstr);
+    HANDLE hMapping = ::CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    ::CloseHandle(hFile);
+    if( hMapping == NULL ) return false;
+    m_pBinaryView = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(hMapping);
+    if( m_pBinaryView == NULL ) return false;
+
+    if( _LoadBinary(m_pBinaryView, dwSize) ) return true;
+    Release();
+    return false;
+#else
+    return false;
+#endif
 }
 
-void CMarkup::_SkipIdentifier(LPCTSTR& pstr) const
+void CMarkup::GetLastErrorMessage(LPTSTR pstrMessage, SIZE_T cchMax) const
 {
-    // 属性只能用英文，所以这样处理没有问题
-    while( *pstr != _T('\0') && (*pstr == _T('_') || *pstr == _T(':') || _istalnum(*pstr)) ) pstr = ::CharNext(pstr);
+    _tcsncpy(pstrMessage, m_szErrorMsg, cchMax);
 }
 
-void CMarkup::_SkipIdentifier(LPTSTR& pstr) const
+void CMarkup::GetLastErrorLocation(LPTSTR pstrSource, SIZE_T cchMax) const
 {
-    // 属性只能用英文，所以这样处理没有问题
-    while( *pstr != _T('\0') && (*pstr == _T('_') || *pstr == _T(':') || _istalnum(*pstr)) ) pstr = ::CharNext(pstr);
-}
-
-bool CMarkup::_ParseAttributes(LPTSTR& pstrText)
-{   
-	// 无属性
-	LPTSTR pstrIdentifier = pstrText;
-	if( *pstrIdentifier == _T('/') && *++pstrIdentifier == _T('>') ) return true;
-    if( *pstrText == _T('>') ) return true;
-    *pstrText++ = _T('\0');
-    _SkipWhitespace(pstrText);
-    while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('/') ) {
-        _SkipIdentifier(pstrText);
-        LPTSTR pstrIdentifierEnd = pstrText;
-        _SkipWhitespace(pstrText);
-        if( *pstrText != _T('=') ) return _Failed(_T("Error while parsing attributes"), pstrText);
-        *pstrText++ = _T(' ');
-        *pstrIdentifierEnd = _T('\0');
-        _SkipWhitespace(pstrText);
-        if( *pstrText++ != _T('\"') ) return _Failed(_T("Expected attribute value"), pstrText);
-        LPTSTR pstrDest = pstrText;
-        if( !_ParseData(pstrText, pstrDest, _T('\"')) ) return false;
-        if( *pstrText == _T('\0') ) return _Failed(_T("Error while parsing attribute string"), pstrText);
-        *pstrDest = _T('\0');
-        if( pstrText != pstrDest ) *pstrText = _T(' ');
-        pstrText++;
-        _SkipWhitespace(pstrText);
-    }
-    return true;
+    _tcsncpy(pstrSource, m_szErrorXML, cchMax);
 }
 
-bool CMarkup::_ParseData(LPTSTR& pstrText, LPTSTR& pstrDest, char cEnd)
+CMarkupNode CMarkup::GetRoot()
 {
-    while( *pstrText != _T('\0') && *pstrText != cEnd ) {
-		if( *pstrText == _T('&') ) {
-			while( *pstrText == _T('&') ) {
-				_ParseMetaChar(++pstrText, pstrDest);
-			}
-			if (*pstrText == cEnd)
-				break;
-		}
-
-        if( *pstrText == _T(' ') ) {
-            *pstrDest++ = *pstrText++;
-            if( !m_bPreserveWhitespace ) _SkipWhitespace(pstrText);
-        }
-        else {
-            LPTSTR pstrTemp = ::CharNext(pstrText);
-            while( pstrText < pstrTemp) {
-                *pstrDest++ = *pstrText++;
-            }
-        }
-    }
-    // Make sure that MapAttributes() works correctly when it parses
-    // over a value that has been transformed.
-    LPTSTR pstrFill = pstrDest + 1;
-    while( pstrFill < pstrText ) *pstrFill++ = _T(' ');
-    return true;
+    if( m_dom.GetRoot() == NULL ) return CMarkupNode();
+    return CMarkupNode(this, m_dom.GetRoot());
 }
 
-void CMarkup::_ParseMetaChar(LPTSTR& pstrText, LPTSTR& pstrDest)
+bool CMarkup::_Parse()
 {
-    if( pstrText[0] == _T('a') && pstrText[1] == _T('m') && pstrText[2] == _T('p') && pstrText[3] == _T(';') ) {
-        *pstrDest++ = _T('&');
-        pstrText += 4;
-    }
-    else if( pstrText[0] == _T('l') && pstrText[1] == _T('t') && pstrText[2] == _T(';') ) {
-        *pstrDest++ = _T('<');
-        pstrText += 3;
-    }
-    else if( pstrText[0] == _T('g') && pstrText[1] == _T('t') && pstrText[2] == _T(';') ) {
-        *pstrDest++ = _T('>');
-        pstrText += 3;
-    }
-    else if( pstrText[0] == _T('q') && pstrText[1] == _T('u') && pstrText[2] == _T('o') && pstrText[3] == _T('t') && pstrText[4] == _T(';') ) {
-        *pstrDest++ = _T('\"');
-        pstrText += 5;
-    }
-    else if( pstrText[0] == _T('a') && pstrText[1] == _T('p') && pstrText[2] == _T('o') && pstrText[3] == _T('s') && pstrText[4] == _T(';') ) {
-        *pstrDest++ = _T('\'');
-        pstrText += 5;
-    }
-    else {
-        *pstrDest++ = _T('&');
-    }
+    ::ZeroMemory(m_szErrorMsg, sizeof(m_szErrorMsg));
+    ::ZeroMemory(m_szErrorXML, sizeof(m_szErrorXML));
+    if( m_dom.Parse(m_pstrXML, m_bPreserveWhitespace) ) return true;
+
+    // 与 XMLDOM::Error 一一对应
+    static LPCTSTR s_aErrors[] = {
+        _T(""),
+        _T("Expected start tag"),
+        _T("Error parsing element name"),
+        _T("Expected start-tag closing"),
+        _T("Expected end-tag start"),
+        _T("Unmatched closing tag"),
+        _T("Error while parsing attributes"),
+        _T("Expected attribute value"),
+        _T("Error while parsing attribute string"),
+        _T("Out of memory"),
+    };
+    int iError = m_dom.GetError();
+    if( iError < 0 || iError >= (int)lengthof(s_aErrors) ) iError = 0;
+    return _Failed(s_aErrors[iError], m_dom.GetErrorLocation());
 }
 
 bool CMarkup::_Failed(LPCTSTR pstrError, LPCTSTR pstrLocation)
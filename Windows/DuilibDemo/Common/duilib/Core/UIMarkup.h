@@ -26,6 +26,8 @@ namespace DuiLib {
 		bool Load(LPCTSTR pstrXML);
 		bool LoadFromMem(BYTE* pByte, DWORD dwSize, int encoding = XMLFILE_ENCODING_UTF8);
 		bool LoadFromFile(LPCTSTR pstrFilename, int encoding = XMLFILE_ENCODING_UTF8);
+		// 加载 tools/SkinCompiler 生成的预编译皮肤，数据会被拷贝
+		bool LoadFromBinary(const BYTE* pByte, DWORD dwSize);
 		void Release();
 		bool IsValid() const;
 
@@ -34,36 +36,24 @@ namespace DuiLib {
 		void GetLastErrorLocation(LPTSTR pstrSource, SIZE_T cchMax) const;
 
 		CMarkupNode GetRoot();
+		// 解析结果，供只读遍历（如收集皮肤中的图片）
+		const CMarkupDomT<TCHAR>& GetDom() const { return m_dom; }
 
 	private:
-		typedef struct tagXMLELEMENT
-		{
-			ULONG iStart;
-			ULONG iChild;
-			ULONG iNext;
-			ULONG iParent;
-			ULONG iData;
-		} XMLELEMENT;
+		typedef CMarkupDomT<TCHAR> XMLDOM;
 
 		LPTSTR m_pstrXML;
-		XMLELEMENT* m_pElements;
-		ULONG m_nElements;
-		ULONG m_nReservedElements;
+		LPVOID m_pBinaryView;	// 映射的预编译皮肤
+		LPBYTE m_pBinaryData;	// LoadFromBinary 拷贝的预编译皮肤
+		XMLDOM m_dom;
 		TCHAR m_szErrorMsg[100];
 		TCHAR m_szErrorXML[50];
 		bool m_bPreserveWhitespace;
 
 	private:
 		bool _Parse();
-		bool _Parse(LPTSTR& pstrText, ULONG iParent);
-		XMLELEMENT* _ReserveElement();
-		inline void _SkipWhitespace(LPTSTR& pstr) const;
-		inline void _SkipWhitespace(LPCTSTR& pstr) const;
-		inline void _SkipIdentifier(LPTSTR& pstr) const;
-		inline void _SkipIdentifier(LPCTSTR& pstr) const;
-		bool _ParseData(LPTSTR& pstrText, LPTSTR& pstrData, char cEnd);
-		void _ParseMetaChar(LPTSTR& pstrText, LPTSTR& pstrDest);
-		bool _ParseAttributes(LPTSTR& pstrText);
+		bool _LoadBinary(const void* pData, DWORD dwSize);
+		bool _LoadBinaryFile(LPCTSTR pstrXmlFile);
 		bool _Failed(LPCTSTR pstrError, LPCTSTR pstrLocation = NULL);
 	};
 
@@ -73,7 +63,7 @@ namespace DuiLib {
 		friend class CMarkup;
 	private:
 		CMarkupNode();
-		CMarkupNode(CMarkup* pOwner, int iPos);
+		CMarkupNode(CMarkup* pOwner, CMarkup::XMLDOM::Node* pNode);
 
 	public:
 		bool IsValid() const;
@@ -87,6 +77,8 @@ namespace DuiLib {
 		bool HasChildren() const;
 		LPCTSTR GetName() const;
 		LPCTSTR GetValue() const;
+		// 预编译皮肤中的节点类别（SkinClassId），从 XML 加载时为 SKIN_CLASS_UNKNOWN
+		UINT GetClassId() const;
 
 		bool HasAttributes();
 		bool HasAttribute(LPCTSTR pstrName);
@@ -96,21 +88,12 @@ namespace DuiLib {
 		LPCTSTR GetAttributeValue(LPCTSTR pstrName);
 		bool GetAttributeValue(int iIndex, LPTSTR pstrValue, SIZE_T cchMax);
 		bool GetAttributeValue(LPCTSTR pstrName, LPTSTR pstrValue, SIZE_T cchMax);
+		// 预编译皮肤中已经转换好的属性值，没有时返回 NULL
+		const CMarkupTypedValue* GetAttributeTypedValue(int iIndex);
 
 	private:
-		void _MapAttributes();
-
-		enum { MAX_XML_ATTRIBUTES = 64 };
-
-		typedef struct
-		{
-			ULONG iName;
-			ULONG iValue;
-		} XMLATTRIBUTE;
-
-		int m_iPos;
-		int m_nAttributes;
-		XMLATTRIBUTE m_aAttributes[MAX_XML_ATTRIBUTES];
+		// 属性在解析时已经整理好，节点只是 DOM 中的一个指针，拷贝代价很小
+		CMarkup::XMLDOM::Node* m_pNode;
 		CMarkup* m_pOwner;
 	};
 
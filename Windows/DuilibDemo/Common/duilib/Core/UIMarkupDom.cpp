@@ -0,0 +1,548 @@
+#include "UIMarkupDom.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace DuiLib {
+
+namespace {
+
+    const size_t kArenaAlign = 8;
+    const size_t kMinArenaBlock = 4096;
+
+    template<typename T>
+    inline unsigned int CharValue(T ch)
+    {
+        return static_cast<unsigned int>(ch) & (sizeof(T) == 1 ? 0xFF : 0xFFFFFFFF);
+    }
+
+    template<typename T>
+    inline bool IsWhitespace(T ch)
+    {
+        unsigned int c = CharValue(ch);
+        return c > 0 && c <= ' ';
+    }
+
+    // 属性只能用英文，非 ASCII 字符按原来的 _istalnum 处理成标识符的一部分
+    template<typename T>
+    inline bool IsIdentifier(T ch)
+    {
+        unsigned int c = CharValue(ch);
+        return c == '_' || c == ':' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+    }
+
+    template<typename T>
+    inline unsigned int FoldCase(T ch)
+    {
+        unsigned int c = CharValue(ch);
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+
+    template<typename T>
+    inline void SkipWhitespace(T*& pstr)
+    {
+        while( IsWhitespace(*pstr) ) ++pstr;
+    }
+
+    const unsigned int kNameHashSeed = 2166136261u;
+    const unsigned int kNameHashPrime = 16777619u;
+
+    // 跳过标识符的同时算出名字的哈希，驻留时不用再读一遍
+    template<typename T>
+    inline unsigned int SkipIdentifier(T*& pstr)
+    {
+        unsigned int nHash = kNameHashSeed;
+        while( *pstr != 0 && IsIdentifier(*pstr) ) {
+            nHash = (nHash ^ FoldCase(*pstr)) * kNameHashPrime;
+            ++pstr;
+        }
+        return nHash;
+    }
+
+    // 出错位置指向不符的字符之后，但不越过结尾的 0
+    template<typename T>
+    inline const T* SkipChar(const T* pstr)
+    {
+        return *pstr != 0 ? pstr + 1 : pstr;
+    }
+
+    template<typename T>
+    unsigned int HashName(const T* pName, size_t nLength)
+    {
+        unsigned int nHash = kNameHashSeed;
+        for( size_t i = 0; i < nLength; i++ ) {
+            nHash = (nHash ^ FoldCase(pName[i])) * kNameHashPrime;
+        }
+        return nHash;
+    }
+
+    template<typename T>
+    bool NameEquals(const T* pLeft, const T* pRight, size_t nLength)
+    {
+        for( size_t i = 0; i < nLength; i++ ) {
+            if( FoldCase(pLeft[i]) != FoldCase(pRight[i]) ) return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    size_t NameLength(const T* pName)
+    {
+        const T* p = pName;
+        while( *p != 0 ) ++p;
+        return p - pName;
+    }
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//
+//
+
+CMarkupArena::CMarkupArena() : m_pHead(NULL), m_nNextBlockSize(kMinArenaBlock), m_nAllocatedBytes(0)
+{
+}
+
+CMarkupArena::~CMarkupArena()
+{
+    Release();
+}
+
+void CMarkupArena::Reserve(size_t nBytes)
+{
+    if( nBytes > m_nNextBlockSize ) m_nNextBlockSize = nBytes;
+}
+
+void* CMarkupArena::Alloc(size_t nBytes)
+{
+    nBytes = (nBytes + kArenaAlign - 1) & ~(kArenaAlign - 1);
+    if( m_pHead == NULL || m_pHead->nSize - m_pHead->nUsed < nBytes ) {
+        size_t nSize = m_nNextBlockSize;
+        if( nSize < nBytes ) nSize = nBytes;
+        size_t nHeader = (sizeof(Block) + kArenaAlign - 1) & ~(kArenaAlign - 1);
+        Block* pBlock = static_cast<Block*>(malloc(nHeader + nSize));
+        if( pBlock == NULL ) return NULL;
+        pBlock->pNext = m_pHead;
+        pBlock->nSize = nHeader + nSize;
+        pBlock->nUsed = nHeader;
+        m_pHead = pBlock;
+        m_nAllocatedBytes += nHeader + nSize;
+        // 后续的块按倍数增长，块数保持在对数级
+        m_nNextBlockSize = nSize * 2;
+    }
+    void* p = reinterpret_cast<char*>(m_pHead) + m_pHead->nUsed;
+    m_pHead->nUsed += nBytes;
+    return p;
+}
+
+void CMarkupArena::Release()
+{
+    while( m_pHead != NULL ) {
+        Block* pNext = m_pHead->pNext;
+        free(m_pHead);
+        m_pHead = pNext;
+    }
+    m_nNextBlockSize = kMinArenaBlock;
+    m_nAllocatedBytes = 0;
+}
+
+size_t CMarkupArena::GetAllocatedBytes() const
+{
+    return m_nAllocatedBytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//
+//
+
+template<typename T>
+CMarkupDomT<T>::CMarkupDomT() : m_pRoot(NULL), m_nNodes(0), m_bValid(false), m_bPreserveWhitespace(true),
+    m_eError(ERROR_NONE), m_pErrorLocation(NULL), m_pNameSlots(NULL), m_nNameCapacity(0), m_nNames(0),
+    m_pScratch(NULL), m_nScratchCapacity(0)
+{
+}
+
+template<typename T>
+CMarkupDomT<T>::~CMarkupDomT()
+{
+    Release();
+    if( m_pScratch != NULL ) free(m_pScratch);
+}
+
+template<typename T>
+void CMarkupDomT<T>::Release()
+{
+    m_arena.Release();
+    m_pRoot = NULL;
+    m_nNodes = 0;
+    m_bValid = false;
+    m_pNameSlots = NULL;
+    m_nNameCapacity = 0;
+    m_nNames = 0;
+}
+
+template<typename T>
+bool CMarkupDomT<T>::Parse(T* pText, bool bPreserveWhitespace)
+{
+    Release();
+    m_bPreserveWhitespace = bPreserveWhitespace;
+    m_eError = ERROR_NONE;
+    m_pErrorLocation = NULL;
+    if( pText == NULL ) return false;
+
+    T* pstr = pText;
+    if( !_Parse(pstr, NULL) ) {
+        Release();
+        return false;
+    }
+    m_bValid = true;
+    return true;
+}
+
+template<typename T>
+bool CMarkupDomT<T>::_Parse(T*& pText, Node* pParent)
+{
+    SkipWhitespace(pText);
+    Node* pPrevious = NULL;
+    for( ; ; )
+    {
+        if( *pText == 0 && (pParent == NULL || pParent == m_pRoot) ) return true;
+        SkipWhitespace(pText);
+        if( *pText != '<' ) return _Failed(ERROR_EXPECTED_START_TAG, pText);
+        if( pText[1] == '/' ) return true;
+        *pText++ = 0;
+        SkipWhitespace(pText);
+        // Skip comment or processing directive
+        if( *pText == '!' || *pText == '?' ) {
+            T ch = *pText;
+            if( *pText == '!' ) ch = '-';
+            while( *pText != 0 && !(*pText == ch && *(pText + 1) == '>') ) ++pText;
+            if( *pText != 0 ) pText += 2;
+            SkipWhitespace(pText);
+            continue;
+        }
+        SkipWhitespace(pText);
+        // Fill out element structure
+        Node* pNode = static_cast<Node*>(m_arena.Alloc(sizeof(Node)));
+        if( pNode == NULL ) return _Failed(ERROR_OUT_OF_MEMORY, pText);
+        memset(pNode, 0, sizeof(Node));
+        pNode->pName = pText;
+        pNode->pParent = pParent;
+        if( pPrevious != NULL ) pPrevious->pNext = pNode;
+        else if( pParent != NULL ) pParent->pChild = pNode;
+        if( m_pRoot == NULL ) m_pRoot = pNode;
+        pPrevious = pNode;
+        m_nNodes++;
+        // Parse name
+        T* pName = pText;
+        unsigned int nHash = SkipIdentifier(pText);
+        T* pNameEnd = pText;
+        if( *pText == 0 ) return _Failed(ERROR_ELEMENT_NAME, pText);
+        pNode->nNameId = _InternName(pName, pNameEnd - pName, nHash);
+        if( pNode->nNameId == INVALID_NAME_ID ) return _Failed(ERROR_OUT_OF_MEMORY, pText);
+        // Parse attributes
+        if( !_ParseAttributes(pText, pNode) ) return false;
+        SkipWhitespace(pText);
+        if( pText[0] == '/' && pText[1] == '>' )
+        {
+            pNode->pValue = pText;
+            *pText = 0;
+            pText += 2;
+        }
+        else
+        {
+            if( *pText != '>' ) return _Failed(ERROR_EXPECTED_START_TAG_CLOSING, pText);
+            // Parse node data
+            pNode->pValue = ++pText;
+            T* pDest = pText;
+            if( !_ParseData(pText, pDest, '<') ) return false;
+            // Determine type of next element
+            // 没有结束标签就到了结尾：也要截断名字，否则名字会带上 '>' 和后面的内容，与驻留的 id 对不上
+            if( *pText == 0 && (pParent == NULL || pParent == m_pRoot) ) {
+                *pNameEnd = 0;
+                return true;
+            }
+            if( *pText != '<' ) return _Failed(ERROR_EXPECTED_END_TAG_START, pText);
+            if( pText[0] == '<' && pText[1] != '/' )
+            {
+                if( !_Parse(pText, pNode) ) return false;
+            }
+            if( pText[0] == '<' && pText[1] == '/' )
+            {
+                *pDest = 0;
+                *pText = 0;
+                pText += 2;
+                SkipWhitespace(pText);
+                size_t cchName = pNameEnd - pName;
+                for( size_t i = 0; i < cchName; i++ ) {
+                    if( pText[i] != pName[i] ) return _Failed(ERROR_UNMATCHED_CLOSING_TAG, pText);
+                }
+                pText += cchName;
+                SkipWhitespace(pText);
+                if( *pText != '>' ) return _Failed(ERROR_UNMATCHED_CLOSING_TAG, SkipChar(pText));
+                pText++;
+            }
+        }
+        *pNameEnd = 0;
+        SkipWhitespace(pText);
+    }
+}
+
+template<typename T>
+bool CMarkupDomT<T>::_ParseAttributes(T*& pText, Node* pNode)
+{
+    // 无属性
+    T* pIdentifier = pText;
+    if( *pIdentifier == '/' && *++pIdentifier == '>' ) return true;
+    if( *pText == '>' ) return true;
+    *pText++ = 0;
+    SkipWhitespace(pText);
+    size_t nAttributes = 0;
+    while( *pText != 0 && *pText != '>' && *pText != '/' ) {
+        T* pName = pText;
+        unsigned int nHash = SkipIdentifier(pText);
+        T* pIdentifierEnd = pText;
+        SkipWhitespace(pText);
+        if( *pText != '=' ) return _Failed(ERROR_PARSING_ATTRIBUTES, pText);
+        *pText++ = ' ';
+        unsigned int nNameId = _InternName(pName, pIdentifierEnd - pName, nHash);
+        if( nNameId == INVALID_NAME_ID ) return _Failed(ERROR_OUT_OF_MEMORY, pText);
+        *pIdentifierEnd = 0;
+        SkipWhitespace(pText);
+        if( *pText != '\"' ) return _Failed(ERROR_EXPECTED_ATTRIBUTE_VALUE, SkipChar(pText));
+        pText++;
+        T* pValue = pText;
+        T* pDest = pText;
+        if( !_ParseData(pText, pDest, '\"') ) return false;
+        if( *pText == 0 ) return _Failed(ERROR_PARSING_ATTRIBUTE_STRING, pText);
+        *pDest = 0;
+        if( pText != pDest ) *pText = ' ';
+        pText++;
+        SkipWhitespace(pText);
+
+        if( nAttributes == m_nScratchCapacity ) {
+            size_t nCapacity = m_nScratchCapacity == 0 ? 32 : m_nScratchCapacity * 2;
+            Attribute* pScratch = static_cast<Attribute*>(realloc(m_pScratch, nCapacity * sizeof(Attribute)));
+            if( pScratch == NULL ) return _Failed(ERROR_OUT_OF_MEMORY, pText);
+            m_pScratch = pScratch;
+            m_nScratchCapacity = nCapacity;
+        }
+        Attribute& attr = m_pScratch[nAttributes++];
+        attr.pName = pName;
+        attr.pValue = pValue;
+        attr.pTyped = NULL;
+        attr.nNameId = nNameId;
+    }
+
+    if( !SetAttributes(pNode, m_pScratch, nAttributes) ) return _Failed(ERROR_OUT_OF_MEMORY, pText);
+    return true;
+}
+
+template<typename T>
+bool CMarkupDomT<T>::_ParseData(T*& pText, T*& pDest, T cEnd)
+{
+    while( *pText != 0 && *pText != cEnd ) {
+        if( *pText == '&' ) {
+            while( *pText == '&' ) {
+                _ParseMetaChar(++pText, pDest);
+            }
+            // 转义字符在结尾时不能越过结尾的 0
+            if( *pText == cEnd || *pText == 0 )
+                break;
+        }
+
+        if( *pText == ' ' ) {
+            *pDest++ = *pText++;
+            if( !m_bPreserveWhitespace ) SkipWhitespace(pText);
+        }
+        else {
+            *pDest++ = *pText++;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+void CMarkupDomT<T>::_ParseMetaChar(T*& pText, T*& pDest)
+{
+    if( pText[0] == 'a' && pText[1] == 'm' && pText[2] == 'p' && pText[3] == ';' ) {
+        *pDest++ = '&';
+        pText += 4;
+    }
+    else if( pText[0] == 'l' && pText[1] == 't' && pText[2] == ';' ) {
+        *pDest++ = '<';
+        pText += 3;
+    }
+    else if( pText[0] == 'g' && pText[1] == 't' && pText[2] == ';' ) {
+        *pDest++ = '>';
+        pText += 3;
+    }
+    else if( pText[0] == 'q' && pText[1] == 'u' && pText[2] == 'o' && pText[3] == 't' && pText[4] == ';' ) {
+        *pDest++ = '\"';
+        pText += 5;
+    }
+    else if( pText[0] == 'a' && pText[1] == 'p' && pText[2] == 'o' && pText[3] == 's' && pText[4] == ';' ) {
+        *pDest++ = '\'';
+        pText += 5;
+    }
+    else {
+        *pDest++ = '&';
+    }
+}
+
+template<typename T>
+const typename CMarkupDomT<T>::NameSlot* CMarkupDomT<T>::_FindSlot(const T* pName, size_t nLength, unsigned int nHash) const
+{
+    if( m_nNameCapacity == 0 ) return NULL;
+    size_t nMask = m_nNameCapacity - 1;
+    for( size_t i = nHash & nMask; ; i = (i + 1) & nMask ) {
+        const NameSlot& slot = m_pNameSlots[i];
+        if( slot.pName == NULL ) return &slot;
+        if( slot.nHash == nHash && slot.nLength == nLength && NameEquals(slot.pName, pName, nLength) ) return &slot;
+    }
+}
+
+template<typename T>
+unsigned int CMarkupDomT<T>::_InternName(const T* pName, size_t nLength, unsigned int nHash)
+{
+    const NameSlot* pSlot = _FindSlot(pName, nLength, nHash);
+    if( pSlot != NULL && pSlot->pName != NULL ) return pSlot->nId;
+
+    // 装载因子保持在 1/2 以下；旧表留在 arena 里随文档一起释放
+    if( (m_nNames + 1) * 2 > m_nNameCapacity ) {
+        size_t nCapacity = m_nNameCapacity == 0 ? 64 : m_nNameCapacity * 2;
+        NameSlot* pSlots = static_cast<NameSlot*>(m_arena.Alloc(nCapacity * sizeof(NameSlot)));
+        if( pSlots == NULL ) return INVALID_NAME_ID;
+        memset(pSlots, 0, nCapacity * sizeof(NameSlot));
+        for( size_t i = 0; i < m_nNameCapacity; i++ ) {
+            const NameSlot& slot = m_pNameSlots[i];
+            if( slot.pName == NULL ) continue;
+            size_t j = slot.nHash & (nCapacity - 1);
+            while( pSlots[j].pName != NULL ) j = (j + 1) & (nCapacity - 1);
+            pSlots[j] = slot;
+        }
+        m_pNameSlots = pSlots;
+        m_nNameCapacity = nCapacity;
+        pSlot = _FindSlot(pName, nLength, nHash);
+    }
+
+    NameSlot* pNew = const_cast<NameSlot*>(pSlot);
+    pNew->pName = pName;
+    pNew->nLength = nLength;
+    pNew->nHash = nHash;
+    pNew->nId = static_cast<unsigned int>(m_nNames++);
+    return pNew->nId;
+}
+
+template<typename T>
+void CMarkupDomT<T>::BeginBuild()
+{
+    Release();
+    m_eError = ERROR_NONE;
+    m_pErrorLocation = NULL;
+}
+
+template<typename T>
+unsigned int CMarkupDomT<T>::AddName(const T* pName, size_t nLength)
+{
+    return _InternName(pName, nLength, HashName(pName, nLength));
+}
+
+template<typename T>
+typename CMarkupDomT<T>::Node* CMarkupDomT<T>::AddNode(Node* pParent, Node* pPrevious, const T* pName, unsigned int nNameId, const T* pValue)
+{
+    Node* pNode = static_cast<Node*>(m_arena.Alloc(sizeof(Node)));
+    if( pNode == NULL ) return NULL;
+    memset(pNode, 0, sizeof(Node));
+    pNode->pName = pName;
+    pNode->pValue = pValue;
+    pNode->pParent = pParent;
+    pNode->nNameId = nNameId;
+    if( pPrevious != NULL ) pPrevious->pNext = pNode;
+    else if( pParent != NULL ) pParent->pChild = pNode;
+    if( m_pRoot == NULL ) m_pRoot = pNode;
+    m_nNodes++;
+    return pNode;
+}
+
+template<typename T>
+bool CMarkupDomT<T>::SetAttributes(Node* pNode, const Attribute* pAttributes, size_t nCount)
+{
+    pNode->pAttributes = NULL;
+    pNode->nAttributes = 0;
+    pNode->nAttributeMask = 0;
+    if( nCount == 0 ) return true;
+    Attribute* pCopy = static_cast<Attribute*>(m_arena.Alloc(nCount * sizeof(Attribute)));
+    if( pCopy == NULL ) return false;
+    memcpy(pCopy, pAttributes, nCount * sizeof(Attribute));
+    for( size_t i = 0; i < nCount; i++ ) {
+        pNode->nAttributeMask |= 1u << (pCopy[i].nNameId & 31);
+    }
+    pNode->pAttributes = pCopy;
+    pNode->nAttributes = static_cast<unsigned int>(nCount);
+    return true;
+}
+
+template<typename T>
+void CMarkupDomT<T>::EndBuild()
+{
+    m_bValid = true;
+}
+
+template<typename T>
+unsigned int CMarkupDomT<T>::FindNameId(const T* pName) const
+{
+    if( pName == NULL ) return INVALID_NAME_ID;
+    size_t nLength = NameLength(pName);
+    const NameSlot* pSlot = _FindSlot(pName, nLength, HashName(pName, nLength));
+    if( pSlot == NULL || pSlot->pName == NULL ) return INVALID_NAME_ID;
+    return pSlot->nId;
+}
+
+template<typename T>
+typename CMarkupDomT<T>::Node* CMarkupDomT<T>::FindChild(const Node* pNode, unsigned int nNameId) const
+{
+    if( pNode == NULL || nNameId == INVALID_NAME_ID ) return NULL;
+    for( Node* pChild = pNode->pChild; pChild != NULL; pChild = pChild->pNext ) {
+        if( pChild->nNameId == nNameId ) return pChild;
+    }
+    return NULL;
+}
+
+template<typename T>
+typename CMarkupDomT<T>::Node* CMarkupDomT<T>::FindChild(const Node* pNode, const T* pName) const
+{
+    return FindChild(pNode, FindNameId(pName));
+}
+
+template<typename T>
+const typename CMarkupDomT<T>::Attribute* CMarkupDomT<T>::FindAttribute(const Node* pNode, unsigned int nNameId) const
+{
+    if( pNode == NULL || nNameId == INVALID_NAME_ID ) return NULL;
+    if( (pNode->nAttributeMask & (1u << (nNameId & 31))) == 0 ) return NULL;
+    for( unsigned int i = 0; i < pNode->nAttributes; i++ ) {
+        if( pNode->pAttributes[i].nNameId == nNameId ) return &pNode->pAttributes[i];
+    }
+    return NULL;
+}
+
+template<typename T>
+const typename CMarkupDomT<T>::Attribute* CMarkupDomT<T>::FindAttribute(const Node* pNode, const T* pName) const
+{
+    return FindAttribute(pNode, FindNameId(pName));
+}
+
+template<typename T>
+bool CMarkupDomT<T>::_Failed(Error eError, const T* pLocation)
+{
+    m_eError = eError;
+    m_pErrorLocation = pLocation;
+    return false; // Always return 'false'
+}
+
+template class CMarkupDomT<char>;
+template class CMarkupDomT<wchar_t>;
+
+} // namespace DuiLib
@@ -0,0 +1,178 @@
+#ifndef __UIMARKUPDOM_H__
+#define __UIMARKUPDOM_H__
+
+#pragma once
+
+// CMarkup 的解析内核，不依赖 Windows 头文件：
+// 1. 一遍扫描在原文上就地解析，节点、属性和名字表都从 CMarkupArena 按块分配，不再 realloc 整个元素数组；
+// 2. 标签名和属性名按 ASCII 忽略大小写驻留成整数 id，按名字查找子节点/属性时只比较 id。
+//    查找并不是 O(1)：FindAttribute 先用节点的 id 掩码排除，掩码命中后仍线性扫描该节点的属性；
+//    FindChild 线性扫描子节点链表。省掉的是逐字符的 _tcsicmp，不是扫描本身；
+// 3. 每个节点解析时就记下自己的属性区间和 id 掩码，不再在每个 CMarkupNode 上重新扫描属性。
+
+#include <stddef.h>
+
+namespace DuiLib {
+
+	class CMarkupArena
+	{
+	public:
+		CMarkupArena();
+		~CMarkupArena();
+
+		// 下一次新开的块至少为 nBytes，用于按原文长度预估
+		void Reserve(size_t nBytes);
+		void* Alloc(size_t nBytes);
+		void Release();
+		size_t GetAllocatedBytes() const;
+
+	private:
+		CMarkupArena(const CMarkupArena&);
+		CMarkupArena& operator=(const CMarkupArena&);
+
+		struct Block
+		{
+			Block* pNext;
+			size_t nSize;
+			size_t nUsed;
+		};
+
+		Block* m_pHead;
+		size_t m_nNextBlockSize;
+		size_t m_nAllocatedBytes;
+	};
+
+	// 预编译皮肤中已经转换好的属性值，内存布局与皮肤文件中的记录一致
+	struct CMarkupTypedValue
+	{
+		enum Type
+		{
+			TYPE_NONE = 0,
+			TYPE_INTS,		// 逗号分隔的十进制整数，如 "12"、"0,0,4,4"
+			TYPE_COLOR,		// "#" 加十六进制，如 "#FF2B2B2B"
+			TYPE_BOOL,		// "true"/"false"，不区分大小写
+		};
+
+		unsigned int nType;
+		unsigned int nCount;	// TYPE_INTS 时为整数个数，最多 4 个；其他类型为 1
+		int aValue[4];
+	};
+
+	template<typename T>
+	class CMarkupDomT
+	{
+	public:
+		enum { INVALID_NAME_ID = 0xFFFFFFFF };
+
+		enum Error
+		{
+			ERROR_NONE = 0,
+			ERROR_EXPECTED_START_TAG,
+			ERROR_ELEMENT_NAME,
+			ERROR_EXPECTED_START_TAG_CLOSING,
+			ERROR_EXPECTED_END_TAG_START,
+			ERROR_UNMATCHED_CLOSING_TAG,
+			ERROR_PARSING_ATTRIBUTES,
+			ERROR_EXPECTED_ATTRIBUTE_VALUE,
+			ERROR_PARSING_ATTRIBUTE_STRING,
+			ERROR_OUT_OF_MEMORY,
+		};
+
+		struct Attribute
+		{
+			const T* pName;
+			const T* pValue;
+			const CMarkupTypedValue* pTyped;	// 只有预编译皮肤有，XML 解析出来的为 NULL
+			unsigned int nNameId;
+		};
+
+		struct Node
+		{
+			const T* pName;
+			const T* pValue;
+			Node* pParent;
+			Node* pChild;
+			Node* pNext;
+			const Attribute* pAttributes;
+			unsigned int nAttributes;
+			unsigned int nNameId;
+			unsigned int nAttributeMask;	// 第 (id & 31) 位表示可能有该 id 的属性，用于快速排除
+			unsigned int nClassId;			// 预编译皮肤中解析好的节点类别，XML 解析出来的为 0
+		};
+
+	public:
+		CMarkupDomT();
+		~CMarkupDomT();
+
+		// pText 以 0 结尾，解析时会被改写，Release 之前必须保持有效
+		bool Parse(T* pText, bool bPreserveWhitespace);
+		void Release();
+
+		bool IsValid() const { return m_bValid; }
+		Node* GetRoot() const { return m_pRoot; }
+		Error GetError() const { return m_eError; }
+		const T* GetErrorLocation() const { return m_pErrorLocation; }
+
+		// 名字没有在文档中出现过时返回 INVALID_NAME_ID
+		unsigned int FindNameId(const T* pName) const;
+		Node* FindChild(const Node* pNode, unsigned int nNameId) const;
+		Node* FindChild(const Node* pNode, const T* pName) const;
+		const Attribute* FindAttribute(const Node* pNode, unsigned int nNameId) const;
+		const Attribute* FindAttribute(const Node* pNode, const T* pName) const;
+
+		// 不经过 XML 文本直接构造文档（预编译皮肤）：BeginBuild 之后按先序添加节点，最后 EndBuild。
+		// 名字、值和类型值都不拷贝，Release 之前必须保持有效
+		void BeginBuild();
+		unsigned int AddName(const T* pName, size_t nLength);
+		Node* AddNode(Node* pParent, Node* pPrevious, const T* pName, unsigned int nNameId, const T* pValue);
+		// 拷贝属性数组并计算节点的属性掩码，属性的 nNameId 须由 AddName 得到
+		bool SetAttributes(Node* pNode, const Attribute* pAttributes, size_t nCount);
+		void EndBuild();
+
+		size_t GetNodeCount() const { return m_nNodes; }
+		size_t GetNameCount() const { return m_nNames; }
+		size_t GetArenaBytes() const { return m_arena.GetAllocatedBytes(); }
+
+	private:
+		CMarkupDomT(const CMarkupDomT&);
+		CMarkupDomT& operator=(const CMarkupDomT&);
+
+		struct NameSlot
+		{
+			const T* pName;			// NULL 表示空槽
+			size_t nLength;
+			unsigned int nHash;
+			unsigned int nId;
+		};
+
+		bool _Parse(T*& pText, Node* pParent);
+		bool _ParseAttributes(T*& pText, Node* pNode);
+		bool _ParseData(T*& pText, T*& pDest, T cEnd);
+		void _ParseMetaChar(T*& pText, T*& pDest);
+		unsigned int _InternName(const T* pName, size_t nLength, unsigned int nHash);
+		const NameSlot* _FindSlot(const T* pName, size_t nLength, unsigned int nHash) const;
+		bool _Failed(Error eError, const T* pLocation);
+
+	private:
+		CMarkupArena m_arena;
+		Node* m_pRoot;
+		size_t m_nNodes;
+		bool m_bValid;
+		bool m_bPreserveWhitespace;
+		Error m_eError;
+		const T* m_pErrorLocation;
+
+		NameSlot* m_pNameSlots;		// 开放寻址，容量为 2 的幂
+		size_t m_nNameCapacity;
+		size_t m_nNames;
+
+		Attribute* m_pScratch;		// 解析单个节点属性用的临时区，节点解析完再整段拷进 arena
+		size_t m_nScratchCapacity;
+	};
+
+	typedef CMarkupDomT<char> CMarkupDomA;
+	typedef CMarkupDomT<wchar_t> CMarkupDomW;
+
+} // namespace DuiLib
+
+#endif // __UIMARKUPDOM_H__
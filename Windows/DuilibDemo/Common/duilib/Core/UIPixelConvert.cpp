@@ -0,0 +1,501 @@
+#include "UIPixelConvert.h"
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define UI_PIXEL_HAVE_SIMD 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define UI_TARGET_SSSE3
+#define UI_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define UI_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define UI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define UI_PIXEL_HAVE_SIMD 0
+#endif
+
+namespace DuiLib {
+
+namespace {
+
+    // 逐像素的参考实现，SIMD 版本的输出必须与它完全一致
+    bool ConvertScalar(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask)
+    {
+        bool bAlpha = false;
+        for( size_t i = 0; i < nPixels; i++ ) {
+            const unsigned char* s = pRGBA + i * 4;
+            unsigned char* d = pBGRA + i * 4;
+            unsigned int r = s[0], g = s[1], b = s[2], a = s[3];
+            if( a < 255 ) {
+                r = r * a / 255;
+                g = g * a / 255;
+                b = b * a / 255;
+                bAlpha = true;
+            }
+            unsigned int nPixel = b | (g << 8) | (r << 16) | (a << 24);
+            if( nPixel == dwMask ) {
+                nPixel = 0;
+                bAlpha = true;
+            }
+            d[0] = static_cast<unsigned char>(nPixel);
+            d[1] = static_cast<unsigned char>(nPixel >> 8);
+            d[2] = static_cast<unsigned char>(nPixel >> 16);
+            d[3] = static_cast<unsigned char>(nPixel >> 24);
+        }
+        return bAlpha;
+    }
+
+    const float kOneThird = 1.0f / 3;
+    const size_t kHSLTilePixels = 64 * 1024;
+
+    // 一次调整共用的参数
+    struct HSLParams
+    {
+        float fHue;     // 色相偏移，度
+        float fS;       // 饱和度倍数
+        float fL;       // 亮度倍数
+    };
+
+    inline HSLParams MakeHSLParams(short H, short S, short L)
+    {
+        HSLParams params;
+        params.fHue = static_cast<float>(H - 180);
+        params.fS = S / 100.0f;
+        params.fL = L / 100.0f;
+        return params;
+    }
+
+    // 按源像素缓存调整结果。皮肤图片的颜色很少（演示皮肤 4096 项的命中率在 99% 以上），同一种颜色只算一次；
+    // 完整的 24 位颜色表要 64MB，因此在调整过程中按需填充。键初始为 0，全透明的 0 调整后仍是 0，空表项同样正确
+    struct HSLTable
+    {
+        enum { BITS = 12, SIZE = 1 << BITS };
+
+        unsigned int aKeys[SIZE];
+        unsigned int aValues[SIZE];
+
+        HSLTable()
+        {
+            memset(aKeys, 0, sizeof(aKeys));
+            memset(aValues, 0, sizeof(aValues));
+        }
+
+        static unsigned int Slot(unsigned int nPixel)
+        {
+            return (nPixel * 2654435761u) >> (32 - BITS);
+        }
+    };
+
+    inline unsigned int LoadPixel(const unsigned char* p)
+    {
+        unsigned int nPixel;
+        memcpy(&nPixel, p, 4);
+        return nPixel;
+    }
+
+    inline void StorePixel(unsigned char* p, unsigned int nPixel)
+    {
+        memcpy(p, &nPixel, 4);
+    }
+
+    inline float HueToChannel(float p, float q, float t)
+    {
+        t = t < 0 ? t + 1 : (t > 1 ? t - 1 : t);
+        return 255 * (6 * t < 1 ? p + (q - p) * 6 * t : (2 * t < 1 ? q : (3 * t < 2 ? p + (q - p) * 6 * (2.0f * kOneThird - t) : p)));
+    }
+
+    inline unsigned int ChannelToByte(float c, unsigned int a)
+    {
+        unsigned int n = static_cast<unsigned int>(c < 0 ? 0 : (c > 255 ? 255 : c));
+        return n * a / 255;
+    }
+
+    // 参考实现，计算步骤与原来 CRenderEngine 的 RGBtoHSL/HSLtoRGB 相同，SIMD 版本按同样的顺序运算。
+    // 预乘的颜色先除以 alpha 还原，调整后再乘回去，保证结果仍是合法的预乘颜色
+    unsigned int AdjustHSLPixel(unsigned int nPixel, const HSLParams& params)
+    {
+        unsigned int a = nPixel >> 24;
+        float fA = static_cast<float>(a > 0 ? a : 1);
+        float nB = std::min((nPixel & 0xFF) / fA, 1.0f);
+        float nG = std::min(((nPixel >> 8) & 0xFF) / fA, 1.0f);
+        float nR = std::min(((nPixel >> 16) & 0xFF) / fA, 1.0f);
+        float m = std::min(std::min(nR, nG), nB);
+        float M = std::max(std::max(nR, nG), nB);
+        float fL = (m + M) * 0.5f;
+        float fH = 0, fS = 0;
+        if( M != m ) {
+            float f = (nR == m) ? (nG - nB) : ((nG == m) ? (nB - nR) : (nR - nG));
+            float n = (nR == m) ? 3.0f : ((nG == m) ? 5.0f : 1.0f);
+            fH = n - f / (M - m);
+            if( fH >= 6 ) fH -= 6;
+            fH *= 60;
+            fS = (2 * fL <= 1) ? ((M - m) / (M + m)) : ((M - m) / (2 - M - m));
+        }
+        fH += params.fHue;
+        fH = fH > 0 ? fH : fH + 360;
+        fS *= params.fS;
+        fL *= params.fL;
+
+        float q = 2 * fL < 1 ? fL * (1 + fS) : (fL + fS - fL * fS);
+        float p = 2 * fL - q;
+        float h = fH / 360;
+        return ChannelToByte(HueToChannel(p, q, h - kOneThird), a) |
+            (ChannelToByte(HueToChannel(p, q, h), a) << 8) |
+            (ChannelToByte(HueToChannel(p, q, h + kOneThird), a) << 16) | (a << 24);
+    }
+
+    void AdjustHSLScalar(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, const HSLParams& params, HSLTable& table)
+    {
+        for( size_t i = 0; i < nPixels; i++ ) {
+            unsigned int nPixel = LoadPixel(pSrc + i * 4);
+            unsigned int nSlot = HSLTable::Slot(nPixel);
+            if( table.aKeys[nSlot] != nPixel ) {
+                table.aKeys[nSlot] = nPixel;
+                table.aValues[nSlot] = AdjustHSLPixel(nPixel, params);
+            }
+            StorePixel(pDst + i * 4, table.aValues[nSlot]);
+        }
+    }
+
+#if UI_PIXEL_HAVE_SIMD
+
+    // 向量实现的做法：
+    // 1. pshufb 把 RGBA 换成 BGRA，同时把每个像素的 alpha 广播成乘数 (a, a, a, 255)；
+    // 2. 展开成 16 位相乘，乘积 x <= 255 * 255，用 (x + 1 + (x >> 8)) >> 8 得到与 x / 255 相同的整数商。
+    //    a == 255 时乘数全是 255，结果就是原值，因此不透明像素不需要单独分支；
+    // 3. 与 mask 按 32 位比较，相等的像素清零；alpha 不等于 255 或命中 mask 的像素累积到透明标志。
+    // 不满一个向量的尾部交给标量实现。
+
+    UI_TARGET_SSSE3 inline __m128i PremultiplySSSE3(__m128i px, __m128i swap, __m128i spread, __m128i opaque)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        __m128i bgra = _mm_shuffle_epi8(px, swap);
+        __m128i mul = _mm_or_si128(_mm_shuffle_epi8(px, spread), opaque);
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(bgra, zero), _mm_unpacklo_epi8(mul, zero));
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(bgra, zero), _mm_unpackhi_epi8(mul, zero));
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    UI_TARGET_SSSE3 bool ConvertSSSE3(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask)
+    {
+        const __m128i swap = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        const __m128i spread = _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1);
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m128i mask = _mm_set1_epi32(static_cast<int>(dwMask));
+        __m128i transparent = _mm_setzero_si128();
+        size_t i = 0;
+        for( ; i + 4 <= nPixels; i += 4 ) {
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRGBA + i * 4));
+            __m128i out = PremultiplySSSE3(px, swap, spread, opaque);
+            __m128i hit = _mm_cmpeq_epi32(out, mask);
+            out = _mm_andnot_si128(hit, out);
+            // alpha 字节不是 0xFF 的像素
+            __m128i partial = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(px, opaque), opaque), opaque);
+            transparent = _mm_or_si128(transparent, _mm_or_si128(hit, partial));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pBGRA + i * 4), out);
+        }
+        bool bAlpha = _mm_movemask_epi8(transparent) != 0;
+        if( ConvertScalar(pRGBA + i * 4, pBGRA + i * 4, nPixels - i, dwMask) ) bAlpha = true;
+        return bAlpha;
+    }
+
+    UI_TARGET_AVX2 bool ConvertAVX2(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask)
+    {
+        // pshufb、unpack 和 pack 都在各自的 128 位通道内进行，每个像素的 4 个字节不跨通道，可以直接套用
+        const __m256i swap = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        const __m256i spread = _mm256_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1,
+            3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1);
+        const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m256i mask = _mm256_set1_epi32(static_cast<int>(dwMask));
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi16(1);
+        __m256i transparent = _mm256_setzero_si256();
+        size_t i = 0;
+        for( ; i + 8 <= nPixels; i += 8 ) {
+            __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRGBA + i * 4));
+            __m256i bgra = _mm256_shuffle_epi8(px, swap);
+            __m256i mul = _mm256_or_si256(_mm256_shuffle_epi8(px, spread), opaque);
+            __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(bgra, zero), _mm256_unpacklo_epi8(mul, zero));
+            __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(bgra, zero), _mm256_unpackhi_epi8(mul, zero));
+            lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, one), _mm256_srli_epi16(lo, 8)), 8);
+            hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, one), _mm256_srli_epi16(hi, 8)), 8);
+            __m256i out = _mm256_packus_epi16(lo, hi);
+            __m256i hit = _mm256_cmpeq_epi32(out, mask);
+            out = _mm256_andnot_si256(hit, out);
+            __m256i partial = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(px, opaque), opaque), opaque);
+            transparent = _mm256_or_si256(transparent, _mm256_or_si256(hit, partial));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pBGRA + i * 4), out);
+        }
+        bool bAlpha = _mm256_movemask_epi8(transparent) != 0;
+        // 清掉上半部分寄存器，避免后面的 SSE 代码付出状态切换的代价
+        _mm256_zeroupper();
+        if( ConvertSSSE3(pRGBA + i * 4, pBGRA + i * 4, nPixels - i, dwMask) ) bAlpha = true;
+        return bAlpha;
+    }
+
+    UI_TARGET_SSSE3 inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    UI_TARGET_SSSE3 inline __m128i HueToChannelSSE(__m128 p, __m128 q, __m128 t, __m128i a)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 three = _mm_set1_ps(3.0f);
+        const __m128 six = _mm_set1_ps(6.0f);
+        t = Select(_mm_cmplt_ps(t, zero), _mm_add_ps(t, one), Select(_mm_cmpgt_ps(t, one), _mm_sub_ps(t, one), t));
+        __m128 qp6 = _mm_mul_ps(_mm_sub_ps(q, p), six);
+        __m128 rise = _mm_add_ps(p, _mm_mul_ps(qp6, t));
+        __m128 fall = _mm_add_ps(p, _mm_mul_ps(qp6, _mm_sub_ps(_mm_set1_ps(2.0f * kOneThird), t)));
+        __m128 c = Select(_mm_cmplt_ps(_mm_mul_ps(three, t), two), fall, p);
+        c = Select(_mm_cmplt_ps(_mm_mul_ps(two, t), one), q, c);
+        c = Select(_mm_cmplt_ps(_mm_mul_ps(six, t), one), rise, c);
+        c = _mm_mul_ps(_mm_set1_ps(255.0f), c);
+        c = _mm_min_ps(_mm_max_ps(c, zero), _mm_set1_ps(255.0f));
+        // 截断取整后乘 alpha，乘积不超过 255 * 255，用与 ConvertSSSE3 相同的方法除以 255
+        __m128i x = _mm_mullo_epi16(_mm_cvttps_epi32(c), a);
+        return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), _mm_srli_epi32(x, 8)), 8);
+    }
+
+    // 一次算 4 个像素，每个通道各占一个 float 向量，分支全部换成比较和选择
+    UI_TARGET_SSSE3 inline __m128i AdjustHSL4(__m128i px, const HSLParams& params)
+    {
+        const __m128i byteMask = _mm_set1_epi32(0xFF);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 six = _mm_set1_ps(6.0f);
+        __m128i a = _mm_srli_epi32(px, 24);
+        __m128 fA = _mm_cvtepi32_ps(_mm_max_epi16(a, _mm_set1_epi32(1)));
+        __m128 nB = _mm_min_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(px, byteMask)), fA), one);
+        __m128 nG = _mm_min_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 8), byteMask)), fA), one);
+        __m128 nR = _mm_min_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 16), byteMask)), fA), one);
+        __m128 m = _mm_min_ps(_mm_min_ps(nR, nG), nB);
+        __m128 M = _mm_max_ps(_mm_max_ps(nR, nG), nB);
+        __m128 fL = _mm_mul_ps(_mm_add_ps(m, M), _mm_set1_ps(0.5f));
+        __m128 d = _mm_sub_ps(M, m);
+        __m128 gray = _mm_cmpeq_ps(M, m);
+        // 灰色像素的分母换成 1，算出的色相和饱和度随后清零
+        __m128 dSafe = Select(gray, one, d);
+
+        __m128 rMin = _mm_cmpeq_ps(nR, m);
+        __m128 gMin = _mm_cmpeq_ps(nG, m);
+        __m128 f = Select(rMin, _mm_sub_ps(nG, nB), Select(gMin, _mm_sub_ps(nB, nR), _mm_sub_ps(nR, nG)));
+        __m128 n = Select(rMin, _mm_set1_ps(3.0f), Select(gMin, _mm_set1_ps(5.0f), one));
+        __m128 fH = _mm_sub_ps(n, _mm_div_ps(f, dSafe));
+        fH = Select(_mm_cmpge_ps(fH, six), _mm_sub_ps(fH, six), fH);
+        fH = _mm_andnot_ps(gray, _mm_mul_ps(fH, _mm_set1_ps(60.0f)));
+        __m128 lowL = _mm_cmple_ps(_mm_mul_ps(two, fL), one);
+        __m128 den = Select(lowL, _mm_add_ps(M, m), _mm_sub_ps(_mm_sub_ps(two, M), m));
+        __m128 fS = _mm_andnot_ps(gray, _mm_div_ps(d, Select(gray, one, den)));
+
+        fH = _mm_add_ps(fH, _mm_set1_ps(params.fHue));
+        fH = Select(_mm_cmpgt_ps(fH, zero), fH, _mm_add_ps(fH, _mm_set1_ps(360.0f)));
+        fS = _mm_mul_ps(fS, _mm_set1_ps(params.fS));
+        fL = _mm_mul_ps(fL, _mm_set1_ps(params.fL));
+
+        __m128 q = Select(_mm_cmplt_ps(_mm_mul_ps(two, fL), one), _mm_mul_ps(fL, _mm_add_ps(one, fS)),
+            _mm_sub_ps(_mm_add_ps(fL, fS), _mm_mul_ps(fL, fS)));
+        __m128 p = _mm_sub_ps(_mm_mul_ps(two, fL), q);
+        __m128 h = _mm_div_ps(fH, _mm_set1_ps(360.0f));
+        __m128 third = _mm_set1_ps(kOneThird);
+        __m128i outB = HueToChannelSSE(p, q, _mm_sub_ps(h, third), a);
+        __m128i outG = HueToChannelSSE(p, q, h, a);
+        __m128i outR = HueToChannelSSE(p, q, _mm_add_ps(h, third), a);
+        return _mm_or_si128(_mm_or_si128(outB, _mm_slli_epi32(outG, 8)),
+            _mm_or_si128(_mm_slli_epi32(outR, 16), _mm_slli_epi32(a, 24)));
+    }
+
+    // 逐个像素查颜色表，没查到的攒够 4 个一起计算，再填进表里并写到各自的位置
+    UI_TARGET_SSSE3 void AdjustHSLSSE(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, const HSLParams& params, HSLTable& table)
+    {
+        unsigned int aPending[4];
+        size_t aIndex[4];
+        int nPending = 0;
+        for( size_t i = 0; i < nPixels; i++ ) {
+            unsigned int nPixel = LoadPixel(pSrc + i * 4);
+            unsigned int nSlot = HSLTable::Slot(nPixel);
+            if( table.aKeys[nSlot] == nPixel ) {
+                StorePixel(pDst + i * 4, table.aValues[nSlot]);
+                continue;
+            }
+            aPending[nPending] = nPixel;
+            aIndex[nPending] = i;
+            if( ++nPending < 4 ) continue;
+
+            unsigned int aResults[4];
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPending));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aResults), AdjustHSL4(px, params));
+            for( int k = 0; k < 4; k++ ) {
+                unsigned int nPendingSlot = HSLTable::Slot(aPending[k]);
+                table.aKeys[nPendingSlot] = aPending[k];
+                table.aValues[nPendingSlot] = aResults[k];
+                StorePixel(pDst + aIndex[k] * 4, aResults[k]);
+            }
+            nPending = 0;
+        }
+        for( int k = 0; k < nPending; k++ ) StorePixel(pDst + aIndex[k] * 4, AdjustHSLPixel(aPending[k], params));
+    }
+
+    // SSE2 看 CPUID.1:EDX，SSSE3 看 CPUID.1:ECX；AVX2 还要求系统保存 YMM 状态（OSXSAVE 且 XCR0 的 XMM/YMM 位都打开）
+    PixelConvertLevel DetectLevel()
+    {
+        unsigned int regs[4] = { 0 };
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        unsigned int nMaxLeaf = static_cast<unsigned int>(info[0]);
+        __cpuid(info, 1);
+        regs[2] = static_cast<unsigned int>(info[2]);
+        regs[3] = static_cast<unsigned int>(info[3]);
+#else
+        unsigned int nMaxLeaf = __get_cpuid_max(0, 0);
+        __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        if( ((regs[2] >> 9) & 1) == 0 ) return ((regs[3] >> 26) & 1) ? PIXEL_CONVERT_SSE2 : PIXEL_CONVERT_SCALAR;
+        if( nMaxLeaf >= 7 && ((regs[2] >> 27) & 1) && ((regs[2] >> 28) & 1) ) {
+#if defined(_MSC_VER)
+            unsigned long long nXcr0 = _xgetbv(0);
+            __cpuidex(info, 7, 0);
+            regs[1] = static_cast<unsigned int>(info[1]);
+#else
+            unsigned int nXcr0Lo = 0, nXcr0Hi = 0;
+            __asm__("xgetbv" : "=a"(nXcr0Lo), "=d"(nXcr0Hi) : "c"(0));
+            unsigned long long nXcr0 = nXcr0Lo;
+            __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+            if( (nXcr0 & 6) == 6 && ((regs[1] >> 5) & 1) ) return PIXEL_CONVERT_AVX2;
+        }
+        return PIXEL_CONVERT_SSSE3;
+    }
+
+#endif // UI_PIXEL_HAVE_SIMD
+
+} // namespace
+
+PixelConvertLevel GetPixelConvertLevel()
+{
+#if UI_PIXEL_HAVE_SIMD
+    static const PixelConvertLevel s_eLevel = DetectLevel();
+    return s_eLevel;
+#else
+    return PIXEL_CONVERT_SCALAR;
+#endif
+}
+
+bool ConvertToPremultipliedBGRA(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask,
+    PixelConvertLevel eLevel)
+{
+    if( eLevel > GetPixelConvertLevel() ) eLevel = GetPixelConvertLevel();
+#if UI_PIXEL_HAVE_SIMD
+    if( eLevel == PIXEL_CONVERT_AVX2 ) return ConvertAVX2(pRGBA, pBGRA, nPixels, dwMask);
+    if( eLevel == PIXEL_CONVERT_SSSE3 ) return ConvertSSSE3(pRGBA, pBGRA, nPixels, dwMask);
+#endif
+    return ConvertScalar(pRGBA, pBGRA, nPixels, dwMask);
+}
+
+bool ConvertToPremultipliedBGRA(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask)
+{
+    return ConvertToPremultipliedBGRA(pRGBA, pBGRA, nPixels, dwMask, GetPixelConvertLevel());
+}
+
+namespace {
+
+    void AdjustHSL(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, const HSLParams& params,
+        PixelConvertLevel eLevel, HSLTable& table)
+    {
+#if UI_PIXEL_HAVE_SIMD
+        if( eLevel >= PIXEL_CONVERT_SSSE3 ) {
+            AdjustHSLSSE(pSrc, pDst, nPixels, params, table);
+            return;
+        }
+#endif
+        AdjustHSLScalar(pSrc, pDst, nPixels, params, table);
+    }
+
+} // namespace
+
+void AdjustPixelsHSL(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, short H, short S, short L,
+    PixelConvertLevel eLevel)
+{
+    if( H == 180 && S == 100 && L == 100 ) {
+        if( pSrc != pDst ) memmove(pDst, pSrc, nPixels * 4);
+        return;
+    }
+    if( eLevel > GetPixelConvertLevel() ) eLevel = GetPixelConvertLevel();
+    std::unique_ptr<HSLTable> pTable(new HSLTable);
+    AdjustHSL(pSrc, pDst, nPixels, MakeHSLParams(H, S, L), eLevel, *pTable);
+}
+
+void AdjustPixelsHSL(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, short H, short S, short L)
+{
+    AdjustPixelsHSL(pSrc, pDst, nPixels, H, S, L, GetPixelConvertLevel());
+}
+
+unsigned int AdjustColorHSL(unsigned int dwColor, short H, short S, short L)
+{
+    if( H == 180 && S == 100 && L == 100 ) return dwColor;
+    // 按不透明像素调整，预乘不起作用
+    unsigned int nPixel = AdjustHSLPixel(dwColor | 0xFF000000, MakeHSLParams(H, S, L));
+    return (nPixel & 0x00FFFFFF) | (dwColor & 0xFF000000);
+}
+
+void AdjustPixelsHSLParallel(const HSLTask* pTasks, size_t nTasks, short H, short S, short L, unsigned int nThreads)
+{
+    if( H == 180 && S == 100 && L == 100 ) {
+        for( size_t i = 0; i < nTasks; i++ ) AdjustPixelsHSL(pTasks[i].pSrc, pTasks[i].pDst, pTasks[i].nPixels, H, S, L);
+        return;
+    }
+
+    // 每张图片切成 kHSLTilePixels 个像素的块，各线程从同一个计数器领取，大图小图混在一起也能分得均匀
+    std::vector<std::pair<size_t, size_t> > tiles;
+    for( size_t i = 0; i < nTasks; i++ ) {
+        for( size_t nStart = 0; nStart < pTasks[i].nPixels; nStart += kHSLTilePixels ) tiles.push_back(std::make_pair(i, nStart));
+    }
+    if( tiles.empty() ) return;
+
+    const HSLParams params = MakeHSLParams(H, S, L);
+    const PixelConvertLevel eLevel = GetPixelConvertLevel();
+    std::atomic<size_t> nNext(0);
+    // 颜色表每个线程一份，在它处理的所有块之间复用
+    auto work = [&]() {
+        std::unique_ptr<HSLTable> pTable(new HSLTable);
+        for( ;; ) {
+            size_t nTile = nNext.fetch_add(1);
+            if( nTile >= tiles.size() ) break;
+            const HSLTask& task = pTasks[tiles[nTile].first];
+            size_t nStart = tiles[nTile].second;
+            size_t nCount = std::min(kHSLTilePixels, task.nPixels - nStart);
+            AdjustHSL(task.pSrc + nStart * 4, task.pDst + nStart * 4, nCount, params, eLevel, *pTable);
+        }
+    };
+
+    if( nThreads == 0 ) {
+        nThreads = std::thread::hardware_concurrency();
+        nThreads = nThreads > 1 ? nThreads - 1 : 0;
+    }
+    if( nThreads > tiles.size() - 1 ) nThreads = static_cast<unsigned int>(tiles.size() - 1);
+    std::vector<std::thread> workers;
+    for( unsigned int i = 0; i < nThreads; i++ ) workers.push_back(std::thread(work));
+    work();
+    for( size_t i = 0; i < workers.size(); i++ ) workers[i].join();
+}
+
+} // namespace DuiLib
@@ -0,0 +1,52 @@
+#ifndef __UIPIXELCONVERT_H__
+#define __UIPIXELCONVERT_H__
+
+#pragma once
+
+// 图片像素转换，x86 上按 CPU 选择 SIMD 实现，各实现的输出与标量版本逐字节相同。不依赖 Windows 头文件。
+// 1. 解码后 stb_image 的 RGBA 转成 DIB 使用的预乘 alpha BGRA，一遍完成通道交换、预乘、mask 色置透明和透明检测；
+// 2. 皮肤换色时的 HSL 调整，多张图片切成块由多个线程一起处理。
+
+#include <stddef.h>
+
+namespace DuiLib {
+
+	enum PixelConvertLevel
+	{
+		PIXEL_CONVERT_SCALAR = 0,
+		PIXEL_CONVERT_SSE2,
+		PIXEL_CONVERT_SSSE3,
+		PIXEL_CONVERT_AVX2,
+	};
+
+	// stb_image 的 RGBA 转成预乘 alpha 的 BGRA，等于 dwMask 的像素置为全透明；返回是否有透明像素。
+	// pRGBA 和 pBGRA 可以是同一块内存
+	bool ConvertToPremultipliedBGRA(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask);
+
+	// 当前 CPU 支持的最快实现，ConvertToPremultipliedBGRA 使用它
+	PixelConvertLevel GetPixelConvertLevel();
+	// 使用指定的实现，超过 CPU 支持的按 GetPixelConvertLevel 处理；用于和标量版本对比
+	bool ConvertToPremultipliedBGRA(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask,
+		PixelConvertLevel eLevel);
+
+	// HSL 调整，参数与 CPaintManagerUI::SetHSL 相同：H 0~360，S、L 0~200，(180, 100, 100) 表示不变。
+	// 像素是预乘 alpha 的 BGRA，按原色调整后重新预乘；pSrc 和 pDst 可以是同一块内存
+	void AdjustPixelsHSL(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, short H, short S, short L);
+	void AdjustPixelsHSL(const unsigned char* pSrc, unsigned char* pDst, size_t nPixels, short H, short S, short L,
+		PixelConvertLevel eLevel);
+
+	// 调整一个不预乘的 ARGB 颜色（0xAARRGGBB），alpha 不变
+	unsigned int AdjustColorHSL(unsigned int dwColor, short H, short S, short L);
+
+	struct HSLTask
+	{
+		const unsigned char* pSrc;
+		unsigned char* pDst;
+		size_t nPixels;
+	};
+	// 调整一批图片：切成固定大小的块，由 nThreads 个工作线程（0 表示按 CPU 核数）和调用线程一起处理，返回时全部完成
+	void AdjustPixelsHSLParallel(const HSLTask* pTasks, size_t nTasks, short H, short S, short L, unsigned int nThreads = 0);
+
+} // namespace DuiLib
+
+#endif // __UIPIXELCONVERT_H__
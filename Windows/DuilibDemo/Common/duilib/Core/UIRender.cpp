@@ -1,5 +1,7 @@
 #include "StdAfx.h"
 
+// 预加载线程会并发解码，stb_image 的失败原因是不加锁的全局变量，没有地方读取它，关掉
+#define STBI_NO_FAILURE_STRINGS
 #define STB_IMAGE_IMPLEMENTATION
 #include "..\Utils\stb_image.h"
 
@@ -19,6 +21,8 @@
 ///////////////////////////////////////////////////////////////////////////////////////
 namespace DuiLib {
 	static int g_iFontID = MAX_FONT_ID;
+	// GIF 的所有帧叠成一张位图，总大小的上限；超过的帧不解码
+	static const size_t GIF_MAX_BITMAP_BYTES = 64 * 1024 * 1024;
 
 	/////////////////////////////////////////////////////////////////////////////////////
 	//
@@ -73,49 +77,6 @@ namespace DuiLib {
 	//
 	//
 
-	static const float OneThird = 1.0f / 3;
-
-	static void RGBtoHSL(DWORD ARGB, float* H, float* S, float* L) {
-		const float
-			R = (float)GetRValue(ARGB),
-			G = (float)GetGValue(ARGB),
-			B = (float)GetBValue(ARGB),
-			nR = (R<0?0:(R>255?255:R))/255,
-			nG = (G<0?0:(G>255?255:G))/255,
-			nB = (B<0?0:(B>255?255:B))/255,
-			m = min(min(nR,nG),nB),
-			M = max(max(nR,nG),nB);
-		*L = (m + M)/2;
-		if (M==m) *H = *S = 0;
-		else {
-			const float
-				f = (nR==m)?(nG-nB):((nG==m)?(nB-nR):(nR-nG)),
-				i = (nR==m)?3.0f:((nG==m)?5.0f:1.0f);
-			*H = (i-f/(M-m));
-			if (*H>=6) *H-=6;
-			*H*=60;
-			*S = (2*(*L)<=1)?((M-m)/(M+m)):((M-m)/(2-M-m));
-		}
-	}
-
-	static void HSLtoRGB(DWORD* ARGB, float H, float S, float L) {
-		const float
-			q = 2*L<1?L*(1+S):(L+S-L*S),
-			p = 2*L-q,
-			h = H/360,
-			tr = h + OneThird,
-			tg = h,
-			tb = h - OneThird,
-			ntr = tr<0?tr+1:(tr>1?tr-1:tr),
-			ntg = tg<0?tg+1:(tg>1?tg-1:tg),
-			ntb = tb<0?tb+1:(tb>1?tb-1:tb),
-			B = 255*(6*ntr<1?p+(q-p)*6*ntr:(2*ntr<1?q:(3*ntr<2?p+(q-p)*6*(2.0f*OneThird-ntr):p))),
-			G = 255*(6*ntg<1?p+(q-p)*6*ntg:(2*ntg<1?q:(3*ntg<2?p+(q-p)*6*(2.0f*OneThird-ntg):p))),
-			R = 255*(6*ntb<1?p+(q-p)*6*ntb:(2*ntb<1?q:(3*ntb<2?p+(q-p)*6*(2.0f*OneThird-ntb):p)));
-		*ARGB &= 0xFF000000;
-		*ARGB |= RGB( (BYTE)(R<0?0:(R>255?255:R)), (BYTE)(G<0?0:(G>255?255:G)), (BYTE)(B<0?0:(B>255?255:B)) );
-	}
-
 	static COLORREF PixelAlpha(COLORREF clrSrc, double src_darken, COLORREF clrDest, double dest_darken)
 	{
 		return RGB (GetRValue (clrSrc) * src_darken + GetRValue (clrDest) * dest_darken, 
@@ -271,23 +232,47 @@ namespace DuiLib {
 
 	DWORD CRenderEngine::AdjustColor(DWORD dwColor, short H, short S, short L)
 	{
-		if( H == 180 && S == 100 && L == 100 ) return dwColor;
-		float fH, fS, fL;
-		float S1 = S / 100.0f;
-		float L1 = L / 100.0f;
-		RGBtoHSL(dwColor, &fH, &fS, &fL);
-		fH += (H - 180);
-		fH = fH > 0 ? fH : fH + 360; 
-		fS *= S1;
-		fL *= L1;
-		HSLtoRGB(&dwColor, fH, fS, fL);
-		return dwColor;
+		return AdjustColorHSL(dwColor, H, S, L);
+	}
+
+	static HBITMAP _CreateImageBitmap(int x, int y, LPBYTE* pBits)
+	{
+		BITMAPINFO bmi;
+		::ZeroMemory(&bmi, sizeof(BITMAPINFO));
+		bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		bmi.bmiHeader.biWidth = x;
+		bmi.bmiHeader.biHeight = -y;
+		bmi.bmiHeader.biPlanes = 1;
+		bmi.bmiHeader.biBitCount = 32;
+		bmi.bmiHeader.biCompression = BI_RGB;
+		bmi.bmiHeader.biSizeImage = x * y * 4;
+		return ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, (void**)pBits, NULL, 0);
+	}
+
+	TImageInfo* CRenderEngine::CreateImageInfo(const BYTE* pBits, int nWidth, int nHeight, bool bAlpha)
+	{
+		if( pBits == NULL || nWidth <= 0 || nHeight <= 0 ) return NULL;
+		LPBYTE pDest = NULL;
+		HBITMAP hBitmap = _CreateImageBitmap(nWidth, nHeight, &pDest);
+		if( !hBitmap ) return NULL;
+		::CopyMemory(pDest, pBits, (size_t)nWidth * nHeight * 4);
+
+		TImageInfo* data = new TImageInfo;
+		data->pBits = NULL;
+		data->pSrcBits = NULL;
+		data->hBitmap = hBitmap;
+		data->nX = nWidth;
+		data->nY = nHeight;
+		data->bAlpha = bAlpha;
+		return data;
 	}
 
 	TImageInfo* CRenderEngine::LoadImage(STRINGorID bitmap, LPCTSTR type, DWORD mask, HINSTANCE instance)
 	{
 		LPBYTE pData = NULL;
 		DWORD dwSize = 0;
+		CZipResource::Item zipItem;
+		const BYTE* pZipData = NULL;	// 资源 zip 索引中的数据，由 zipItem 持有，直接解码不拷贝
 		do 
 		{
 			if( type == NULL ) {
@@ -312,6 +297,14 @@ namespace DuiLib {
 					}
 				}
 				else {
+					CDuiString key = bitmap.m_lpstr;
+					key.Replace(_T("\\"), _T("/"));
+					if( CPaintManagerUI::ReadResourceZipItem(key, zipItem) ) {
+						if( zipItem.size == 0 ) break;
+						pZipData = zipItem.data;
+						dwSize = static_cast<DWORD>(zipItem.size);
+						break;
+					}
 					sFile += CPaintManagerUI::GetResourceZip();
 					CDuiString sFilePwd = CPaintManagerUI::GetResourceZipPwd();
 					HZIP hz = NULL;
@@ -329,8 +322,6 @@ namespace DuiLib {
 					if( hz == NULL ) break;
 					ZIPENTRY ze; 
 					int i = 0; 
-					CDuiString key = bitmap.m_lpstr;
-					key.Replace(_T("\\"), _T("/"));
 					if( FindZipItem(hz, key, true, &i, &ze) != 0 ) break;
 					dwSize = ze.unc_size;
 					if( dwSize == 0 ) break;
@@ -369,7 +360,7 @@ namespace DuiLib {
 			}
 		} while (0);
 
-		while (!pData)
+		while (!pData && !pZipData)
 		{
 			//读不到图片, 则直接去读取bitmap.m_lpstr指向的路径
 			HANDLE hFile = ::CreateFile(bitmap.m_lpstr, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, \
@@ -389,62 +380,27 @@ namespace DuiLib {
 			}
 			break;
 		}
-		if (!pData)
+		if (!pData && !pZipData)
 		{
 			return NULL;
 		}
 
 		LPBYTE pImage = NULL;
 		int x,y,n;
-		pImage = stbi_load_from_memory(pData, dwSize, &x, &y, &n, 4);
+		pImage = stbi_load_from_memory(pData != NULL ? pData : pZipData, dwSize, &x, &y, &n, 4);
 		delete[] pData;
 		if( !pImage ) {
 			return NULL;
 		}
 
-		BITMAPINFO bmi;
-		::ZeroMemory(&bmi, sizeof(BITMAPINFO));
-		bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-		bmi.bmiHeader.biWidth = x;
-		bmi.bmiHeader.biHeight = -y;
-		bmi.bmiHeader.biPlanes = 1;
-		bmi.bmiHeader.biBitCount = 32;
-		bmi.bmiHeader.biCompression = BI_RGB;
-		bmi.bmiHeader.biSizeImage = x * y * 4;
-
-		bool bAlphaChannel = false;
 		LPBYTE pDest = NULL;
-		HBITMAP hBitmap = ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, (void**)&pDest, NULL, 0);
+		HBITMAP hBitmap = _CreateImageBitmap(x, y, &pDest);
 		if( !hBitmap ) {
+			stbi_image_free(pImage);
 			return NULL;
 		}
 
-		for( int i = 0; i < x * y; i++ ) 
-		{
-			pDest[i*4 + 3] = pImage[i*4 + 3];
-			if( pDest[i*4 + 3] < 255 )
-			{
-				pDest[i*4] = (BYTE)(DWORD(pImage[i*4 + 2])*pImage[i*4 + 3]/255);
-				pDest[i*4 + 1] = (BYTE)(DWORD(pImage[i*4 + 1])*pImage[i*4 + 3]/255);
-				pDest[i*4 + 2] = (BYTE)(DWORD(pImage[i*4])*pImage[i*4 + 3]/255); 
-				bAlphaChannel = true;
-			}
-			else
-			{
-				pDest[i*4] = pImage[i*4 + 2];
-				pDest[i*4 + 1] = pImage[i*4 + 1];
-				pDest[i*4 + 2] = pImage[i*4]; 
-			}
-
-			if( *(DWORD*)(&pDest[i*4]) == mask ) {
-				pDest[i*4] = (BYTE)0;
-				pDest[i*4 + 1] = (BYTE)0;
-				pDest[i*4 + 2] = (BYTE)0; 
-				pDest[i*4 + 3] = (BYTE)0;
-				bAlphaChannel = true;
-			}
-		}
-
+		bool bAlphaChannel = ConvertToPremultipliedBGRA(pImage, pDest, (size_t)x * y, mask);
 		stbi_image_free(pImage);
 
 		TImageInfo* data = new TImageInfo;
@@ -492,6 +448,17 @@ namespace DuiLib {
 				}
 				else 
 				{
+					CDuiString key = bitmap.m_lpstr;
+					key.Replace(_T("\\"), _T("/")); 
+					CZipResource::Item item;
+					if( CPaintManagerUI::ReadResourceZipItem(key, item) )
+					{
+						dwSize = static_cast<DWORD>(item.size);
+						if( dwSize == 0 ) break;
+						pData = new BYTE[ dwSize ];
+						::CopyMemory(pData, item.data, dwSize);
+						break;
+					}
 					sFile += CPaintManagerUI::GetResourceZip();
 					HZIP hz = NULL;
 					if( CPaintManagerUI::IsCachedResourceZip() ) 
@@ -509,8 +476,6 @@ namespace DuiLib {
 					if( hz == NULL ) break;
 					ZIPENTRY ze; 
 					int i = 0; 
-					CDuiString key = bitmap.m_lpstr;
-					key.Replace(_T("\\"), _T("/")); 
 					if( FindZipItem(hz, key, true, &i, &ze) != 0 ) break;
 					dwSize = ze.unc_size;
 					if( dwSize == 0 ) break;
@@ -596,10 +561,10 @@ namespace DuiLib {
 	}
 #endif//USE_XIMAGE_EFFECT
 
-	Gdiplus::Image* CRenderEngine::GdiplusLoadImage(LPCTSTR pstrPath)
+	LPBYTE CRenderEngine::LoadResourceData(LPCTSTR pstrPath, DWORD& dwSize)
 	{
 		LPBYTE pData = NULL;
-		DWORD dwSize = 0;
+		dwSize = 0;
 
 		do 
 		{
@@ -624,6 +589,16 @@ namespace DuiLib {
 				}
 			}
 			else {
+				CDuiString key = pstrPath;
+				key.Replace(_T("\\"), _T("/"));
+				CZipResource::Item item;
+				if( CPaintManagerUI::ReadResourceZipItem(key, item) ) {
+					dwSize = static_cast<DWORD>(item.size);
+					if( dwSize == 0 ) break;
+					pData = new BYTE[ dwSize ];
+					::CopyMemory(pData, item.data, dwSize);
+					break;
+				}
 				sFile += CPaintManagerUI::GetResourceZip();
 				HZIP hz = NULL;
 				if( CPaintManagerUI::IsCachedResourceZip() ) hz = (HZIP)CPaintManagerUI::GetResourceZipHandle();
@@ -640,8 +615,6 @@ namespace DuiLib {
 				if( hz == NULL ) break;
 				ZIPENTRY ze; 
 				int i = 0; 
-				CDuiString key = pstrPath;
-				key.Replace(_T("\\"), _T("/"));
 				if( FindZipItem(hz, key, true, &i, &ze) != 0 ) break;
 				dwSize = ze.unc_size;
 				if( dwSize == 0 ) break;
@@ -677,7 +650,13 @@ namespace DuiLib {
 			}
 			break;
 		}
+		return pData;
+	}
 
+	Gdiplus::Image* CRenderEngine::GdiplusLoadImage(LPCTSTR pstrPath)
+	{
+		DWORD dwSize = 0;
+		LPBYTE pData = LoadResourceData(pstrPath, dwSize);
 		Gdiplus::Image* pImage = NULL;
 		if(pData != NULL) {
 			pImage = GdiplusLoadImage(pData, dwSize);
@@ -687,6 +666,56 @@ namespace DuiLib {
 		return pImage;
 	}
 
+	TGifInfo* CRenderEngine::LoadGif(LPCTSTR pstrPath)
+	{
+		DWORD dwSize = 0;
+		LPBYTE pData = LoadResourceData(pstrPath, dwSize);
+		if( pData == NULL ) return NULL;
+
+		TGifInfo* data = new TGifInfo;
+		if( !data->frames.Decode(pData, dwSize, GIF_MAX_BITMAP_BYTES) ) {
+			// 不是 GIF 时按普通图片显示一帧，和原来用 GDI+ 加载时一样
+			int x = 0, y = 0, n = 0;
+			LPBYTE pImage = stbi_load_from_memory(pData, dwSize, &x, &y, &n, 4);
+			if( pImage != NULL ) {
+				data->frames.Assign(pImage, x, y);
+				stbi_image_free(pImage);
+			}
+		}
+		delete[] pData;
+		pData = NULL;
+
+		// 所有帧从上到下放在一张位图里，绘制时按帧取源区域。
+		// 地址空间或 GDI 资源不够、CreateDIBSection 失败时帧数减半重试，最少只显示第一帧
+		int nFrames = data->frames.GetFrameCount();
+		LPBYTE pDest = NULL;
+		HBITMAP hBitmap = NULL;
+		while( nFrames > 0 ) {
+			hBitmap = _CreateImageBitmap(data->frames.GetWidth(), data->frames.GetHeight() * nFrames, &pDest);
+			if( hBitmap ) break;
+			nFrames /= 2;
+		}
+		if( !hBitmap ) {
+			delete data;
+			return NULL;
+		}
+		data->frames.Truncate(nFrames);
+		::CopyMemory(pDest, data->frames.GetPixels(), (size_t)data->frames.GetWidth() * data->frames.GetHeight() * nFrames * 4);
+		data->frames.FreePixels();
+		data->hBitmap = hBitmap;
+		data->nX = data->frames.GetWidth();
+		data->nY = data->frames.GetHeight();
+		data->bAlpha = data->frames.HasAlpha();
+		return data;
+	}
+
+	void CRenderEngine::FreeGif(TGifInfo* pGif)
+	{
+		if( pGif == NULL ) return;
+		if( pGif->hBitmap ) ::DeleteObject(pGif->hBitmap);
+		delete pGif;
+	}
+
 	Gdiplus::Image* CRenderEngine::GdiplusLoadImage( LPVOID pBuf,size_t dwSize )
 	{
 		HGLOBAL hMem = ::GlobalAlloc(GMEM_FIXED, dwSize);
@@ -1563,6 +1592,30 @@ namespace DuiLib {
 		ASSERT(::GetObjectType(hDC)==OBJ_DC || ::GetObjectType(hDC)==OBJ_MEMDC);
 		if( pstrText == NULL || pManager == NULL ) return;
 
+		// 测量结果只与文字、字体、区域大小和风格有关，保存为相对区域左上角的偏移（DT_MODIFYSTRING 会改写文字，不缓存）
+		POINT ptOrigin = { rc.left, rc.top };
+		CHtmlTextCache* pCache = NULL;
+		CHtmlTextCache::Key key;
+		if( (uStyle & DT_CALCRECT) != 0 && (uStyle & DT_MODIFYSTRING) == 0 ) {
+			bool bGdiplus = pManager->IsLayered() || pManager->IsUseGdiplusText();
+			key.sText = pstrText;
+			key.iFont = iFont;
+			key.cx = rc.right - rc.left;
+			key.cy = rc.bottom - rc.top;
+			key.uStyle = uStyle;
+			key.nLinkRects = 0;
+			key.nFlags = 1 | (bGdiplus ? 2 : 0) | (bGdiplus ? pManager->GetGdiplusTextRenderingHint() << 4 : 0);
+			pCache = pManager->GetTextLayoutCache();
+			const CHtmlTextLayout* pLayout = pCache->Find(key);
+			if( pLayout != NULL ) {
+				rc.left = ptOrigin.x + pLayout->rc.left;
+				rc.top = ptOrigin.y + pLayout->rc.top;
+				rc.right = ptOrigin.x + pLayout->rc.right;
+				rc.bottom = ptOrigin.y + pLayout->rc.bottom;
+				return;
+			}
+		}
+
 		if ( pManager->IsLayered() || pManager->IsUseGdiplusText())
 		{
 			HFONT hOldFont = (HFONT)::SelectObject(hDC, pManager->GetFont(iFont));
@@ -1688,8 +1741,120 @@ namespace DuiLib {
 			}
 			::SelectObject(hDC, hOldFont);
 		}
+		if( pCache != NULL ) {
+			CHtmlTextLayout layout;
+			layout.rc.left = rc.left - ptOrigin.x;
+			layout.rc.top = rc.top - ptOrigin.y;
+			layout.rc.right = rc.right - ptOrigin.x;
+			layout.rc.bottom = rc.bottom - ptOrigin.y;
+			pCache->Insert(key, layout);
+		}
 	}
 
+	// DrawHtmlText 排版时的字体、图片和文字测量，测量使用绘制的 DC
+	class CHtmlTextHost : public IHtmlTextHostT<TCHAR>
+	{
+	public:
+		CHtmlTextHost(HDC hDC, CPaintManagerUI* pManager) : m_hDC(hDC), m_pManager(pManager), m_hFont(NULL), m_hOldFont(NULL)
+		{
+		}
+
+		~CHtmlTextHost()
+		{
+			if( m_hOldFont != NULL ) ::SelectObject(m_hDC, m_hOldFont);
+		}
+
+		void* GetFont(int iFont)
+		{
+			TFontInfo* pFontInfo = m_pManager->GetFontInfo(iFont);
+			if( pFontInfo == NULL ) pFontInfo = m_pManager->GetDefaultFontInfo();
+			return pFontInfo;
+		}
+
+		void* GetFont(LPCTSTR pstrName, int nSize, bool bBold, bool bUnderline, bool bItalic)
+		{
+			// 没有名字时 AddFont 使用默认字体的名字，这里按同样的名字查找，避免每次都新建
+			LOGFONT lf = { 0 };
+			if( lstrlen(pstrName) == 0 ) {
+				::GetObject(::GetStockObject(DEFAULT_GUI_FONT), sizeof(LOGFONT), &lf);
+				pstrName = lf.lfFaceName;
+			}
+			HFONT hFont = m_pManager->GetFont(pstrName, nSize, bBold, bUnderline, bItalic);
+			// 每个新字体使用不同的 id：同一 id 会替换并删除原来的字体，而排版结果还引用着它
+			if( hFont == NULL ) hFont = m_pManager->AddFont(g_iFontID++, pstrName, nSize, bBold, bUnderline, bItalic);
+			return m_pManager->GetFontInfo(hFont);
+		}
+
+		void* DeriveFont(void* pFont, bool bBold, bool bUnderline, bool bItalic)
+		{
+			TFontInfo* pFontInfo = static_cast<TFontInfo*>(pFont);
+			return GetFont(pFontInfo->sFontName, pFontInfo->iSize, bBold, bUnderline, bItalic);
+		}
+
+		void GetFontMetrics(void* pFont, THtmlFontMetrics& tm)
+		{
+			const TFontInfo* pFontInfo = static_cast<const TFontInfo*>(pFont);
+			tm.nHeight = pFontInfo->tm.tmHeight;
+			tm.nExternalLeading = pFontInfo->tm.tmExternalLeading;
+			tm.nMaxCharWidth = pFontInfo->tm.tmMaxCharWidth;
+			tm.bItalicFace = pFontInfo->tm.tmItalic != 0;
+			tm.bBold = pFontInfo->bBold;
+			tm.bUnderline = pFontInfo->bUnderline;
+			tm.bItalic = pFontInfo->bItalic;
+		}
+
+		int MeasureText(void* pFont, LPCTSTR pstrText, int cchText)
+		{
+			_SelectFont(pFont);
+			SIZE szText = { 0 };
+			::GetTextExtentPoint32(m_hDC, pstrText, cchText, &szText);
+			return szText.cx;
+		}
+
+		int GetSpaceOverhang(void* pFont)
+		{
+			_SelectFont(pFont);
+			ABC abc = { 0 };
+			::GetCharABCWidths(m_hDC, _T(' '), _T(' '), &abc);
+			return abc.abcC;
+		}
+
+		void* GetImage(LPCTSTR pstrName, LPCTSTR pstrType, int& cx, int& cy)
+		{
+			const TImageInfo* pImageInfo = m_pManager->GetImageEx(pstrName, pstrType);
+			if( pImageInfo == NULL ) return NULL;
+			cx = pImageInfo->nX;
+			cy = pImageInfo->nY;
+			return const_cast<TImageInfo*>(pImageInfo);
+		}
+
+		LPCTSTR CharNext(LPCTSTR p)
+		{
+			return ::CharNext(p);
+		}
+
+		LPCTSTR CharPrev(LPCTSTR pStart, LPCTSTR p)
+		{
+			return ::CharPrev(pStart, p);
+		}
+
+	private:
+		void _SelectFont(void* pFont)
+		{
+			HFONT hFont = static_cast<TFontInfo*>(pFont)->hFont;
+			if( hFont == m_hFont ) return;
+			HFONT hOldFont = (HFONT)::SelectObject(m_hDC, hFont);
+			if( m_hOldFont == NULL ) m_hOldFont = hOldFont;
+			m_hFont = hFont;
+		}
+
+	private:
+		HDC m_hDC;
+		CPaintManagerUI* m_pManager;
+		HFONT m_hFont;
+		HFONT m_hOldFont;
+	};
+
 	void CRenderEngine::DrawHtmlText(HDC hDC, CPaintManagerUI* pManager, RECT& rc, LPCTSTR pstrText, DWORD dwTextColor, RECT* prcLinks, CDuiString* sLinks, int& nLinkRects, int iFont, UINT uStyle)
 	{
 		// 考虑到在xml编辑器中使用<>符号不方便，可以使用{}符号代替
@@ -1709,58 +1874,40 @@ namespace DuiLib {
 		//   Underline:        <u>text</u>
 		//   X Indent:         <x i>                where i = hor indent in pixels
 		//   Y Indent:         <y i>                where i = ver indent in pixels 
+		//
+		// 标签解析和换行在 CHtmlTextLayout 中完成（见 UIHtmlText.h），这里只输出排版结果
 
 		ASSERT(::GetObjectType(hDC)==OBJ_DC || ::GetObjectType(hDC)==OBJ_MEMDC);
 		if( pstrText == NULL || pManager == NULL ) return;
 		if( ::IsRectEmpty(&rc) ) return;
-
-		bool bDraw = (uStyle & DT_CALCRECT) == 0;
-
-		CStdPtrArray aFontArray(10);
-		CStdPtrArray aColorArray(10);
-		CStdPtrArray aPIndentArray(10);
-
-		RECT rcClip = { 0 };
-		::GetClipBox(hDC, &rcClip);
-		HRGN hOldRgn = ::CreateRectRgnIndirect(&rcClip);
-		HRGN hRgn = ::CreateRectRgnIndirect(&rc);
-		if( bDraw ) ::ExtSelectClipRgn(hDC, hRgn, RGN_AND);
-
-		TFontInfo* pDefFontInfo = pManager->GetFontInfo(iFont);
-		if(pDefFontInfo == NULL) {
-			pDefFontInfo = pManager->GetDefaultFontInfo();
-		}
-		TEXTMETRIC* pTm = &pDefFontInfo->tm;
-		HFONT hOldFont = (HFONT) ::SelectObject(hDC, pDefFontInfo->hFont);
-		::SetBkMode(hDC, TRANSPARENT);
-		::SetTextColor(hDC, RGB(GetBValue(dwTextColor), GetGValue(dwTextColor), GetRValue(dwTextColor)));
-		DWORD dwBkColor = pManager->GetDefaultSelectedBkColor();
-		::SetBkColor(hDC, RGB(GetBValue(dwBkColor), GetGValue(dwBkColor), GetRValue(dwBkColor)));
-
-		// If the drawstyle include a alignment, we'll need to first determine the text-size so
-		// we can draw it at the correct position...
-		if( ((uStyle & DT_CENTER) != 0 || (uStyle & DT_RIGHT) != 0 || (uStyle & DT_VCENTER) != 0 || (uStyle & DT_BOTTOM) != 0) && (uStyle & DT_CALCRECT) == 0 ) {
-			RECT rcText = { 0, 0, 9999, 100 };
-			int nLinks = 0;
-			DrawHtmlText(hDC, pManager, rcText, pstrText, dwTextColor, NULL, NULL, nLinks, iFont, uStyle | DT_CALCRECT);
-			if( (uStyle & DT_SINGLELINE) != 0 ){
-				if( (uStyle & DT_CENTER) != 0 ) {
-					rc.left = rc.left + ((rc.right - rc.left) / 2) - ((rcText.right - rcText.left) / 2);
-					rc.right = rc.left + (rcText.right - rcText.left);
-				}
-				if( (uStyle & DT_RIGHT) != 0 ) {
-					rc.left = rc.right - (rcText.right - rcText.left);
-				}
-			}
-			if( (uStyle & DT_VCENTER) != 0 ) {
-				rc.top = rc.top + ((rc.bottom - rc.top) / 2) - ((rcText.bottom - rcText.top) / 2);
-				rc.bottom = rc.top + (rcText.bottom - rcText.top);
-			}
-			if( (uStyle & DT_BOTTOM) != 0 ) {
-				rc.top = rc.bottom - (rcText.bottom - rcText.top);
+		if( prcLinks == NULL || sLinks == NULL ) nLinkRects = 0;
+
+		// 排版结果与区域的位置无关，按 (文字, 字体, 区域大小, 风格, 链接数组大小) 缓存
+		CHtmlTextCache::Key key;
+		key.sText = pstrText;
+		key.iFont = iFont;
+		key.cx = rc.right - rc.left;
+		key.cy = rc.bottom - rc.top;
+		key.uStyle = uStyle;
+		key.nLinkRects = nLinkRects;
+		key.nFlags = 0;
+		CHtmlTextCache* pCache = pManager->GetTextLayoutCache();
+		const CHtmlTextLayout* pLayout = pCache->Find(key);
+		CHtmlTextLayout layout;
+		if( pLayout == NULL ) {
+			LONG lGeneration = CPaintManagerUI::GetTextLayoutGeneration();
+			{
+				std::vector<LPCTSTR> aLinks(nLinkRects);
+				for( int i = 0; i < nLinkRects; i++ ) aLinks[i] = sLinks[i].GetData();
+				CHtmlTextHost host(hDC, pManager);
+				layout.Build(&host, pstrText, key.cx, key.cy, iFont, uStyle, nLinkRects, aLinks.empty() ? NULL : &aLinks[0]);
 			}
+			// 排版时新建了字体的结果只用这一次，下一次绘制时再缓存
+			if( lGeneration == CPaintManagerUI::GetTextLayoutGeneration() && !layout.bCallerLinks ) pLayout = pCache->Insert(key, layout);
+			if( pLayout == NULL ) pLayout = &layout;
 		}
 
+		// 悬停的链接按上一次绘制的链接区域判断
 		bool bHoverLink = false;
 		CDuiString sHoverLink;
 		POINT ptMouse = pManager->GetMousePos();
@@ -1771,607 +1918,85 @@ namespace DuiLib {
 			}
 		}
 
-		POINT pt = { rc.left, rc.top };
-		int iLinkIndex = 0;
-		int cyLine = pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1);
-		int cyMinHeight = 0;
-		int cxMaxWidth = 0;
-		POINT ptLinkStart = { 0 };
-		bool bLineEnd = false;
-		bool bInRaw = false;
-		bool bInLink = false;
-		bool bInSelected = false;
-		int iLineLinkIndex = 0;
-
-		// 排版习惯是图文底部对齐，所以每行绘制都要分两步，先计算高度，再绘制
-		CStdPtrArray aLineFontArray;
-		CStdPtrArray aLineColorArray;
-		CStdPtrArray aLinePIndentArray;
-		LPCTSTR pstrLineBegin = pstrText;
-		bool bLineInRaw = false;
-		bool bLineInLink = false;
-		bool bLineInSelected = false;
-		int cyLineHeight = 0;
-		bool bLineDraw = false; // 行的第二阶段：绘制
-		while( *pstrText != _T('\0') ) {
-			if( pt.x >= rc.right || *pstrText == _T('\n') || bLineEnd ) {
-				if( *pstrText == _T('\n') ) pstrText++;
-				if( bLineEnd ) bLineEnd = false;
-				if( !bLineDraw ) {
-					if( bInLink && iLinkIndex < nLinkRects ) {
-						::SetRect(&prcLinks[iLinkIndex++], ptLinkStart.x, ptLinkStart.y, MIN(pt.x, rc.right), pt.y + cyLine);
-						CDuiString *pStr1 = (CDuiString*)(sLinks + iLinkIndex - 1);
-						CDuiString *pStr2 = (CDuiString*)(sLinks + iLinkIndex);
-						*pStr2 = *pStr1;
-					}
-					for( int i = iLineLinkIndex; i < iLinkIndex; i++ ) {
-						prcLinks[i].bottom = pt.y + cyLine;
-					}
-					if( bDraw ) {
-						bInLink = bLineInLink;
-						iLinkIndex = iLineLinkIndex;
-					}
-				}
-				else {
-					if( bInLink && iLinkIndex < nLinkRects ) iLinkIndex++;
-					bLineInLink = bInLink;
-					iLineLinkIndex = iLinkIndex;
-				}
-				if( (uStyle & DT_SINGLELINE) != 0 && (!bDraw || bLineDraw) ) break;
-				if( bDraw ) bLineDraw = !bLineDraw; // !
-				pt.x = rc.left;
-				if( !bLineDraw ) pt.y += cyLine;
-				if( pt.y > rc.bottom && bDraw ) break;
-				ptLinkStart = pt;
-				cyLine = pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1);
-				if( pt.x >= rc.right ) break;
+		POINT ptOrigin = { rc.left, rc.top };
+		for( int i = 0; i < (int)pLayout->aLinks.size(); i++ ) {
+			const CHtmlTextLayout::Link& link = pLayout->aLinks[i];
+			if( link.bRect ) {
+				prcLinks[i].left = link.rc.left == HTMLTEXT_ZERO ? 0 : ptOrigin.x + link.rc.left;
+				prcLinks[i].top = link.rc.top == HTMLTEXT_ZERO ? 0 : ptOrigin.y + link.rc.top;
+				prcLinks[i].right = ptOrigin.x + link.rc.right;
+				prcLinks[i].bottom = ptOrigin.y + link.rc.bottom;
 			}
-			else if( !bInRaw && ( *pstrText == _T('<') || *pstrText == _T('{') )
-				&& ( pstrText[1] >= _T('a') && pstrText[1] <= _T('z') )
-				&& ( pstrText[2] == _T(' ') || pstrText[2] == _T('>') || pstrText[2] == _T('}') ) ) {
-					pstrText++;
-					LPCTSTR pstrNextStart = NULL;
-					switch( *pstrText ) {
-					case _T('a'):  // Link
-						{
-							pstrText++;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							if( iLinkIndex < nLinkRects && !bLineDraw ) {
-								CDuiString *pStr = (CDuiString*)(sLinks + iLinkIndex);
-								pStr->Empty();
-								while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('}') ) {
-									LPCTSTR pstrTemp = ::CharNext(pstrText);
-									while( pstrText < pstrTemp) {
-										*pStr += *pstrText++;
-									}
-								}
-							}
+			if( link.bLink ) sLinks[i] = link.sLink.c_str();
+		}
+		nLinkRects = pLayout->nLinks;
 
-							DWORD clrColor = dwTextColor;
-							if(clrColor == 0) pManager->GetDefaultLinkFontColor();
-							if( bHoverLink && iLinkIndex < nLinkRects ) {
-								CDuiString *pStr = (CDuiString*)(sLinks + iLinkIndex);
-								if( sHoverLink == *pStr ) clrColor = pManager->GetDefaultLinkHoverFontColor();
-							}
-							//else if( prcLinks == NULL ) {
-							//    if( ::PtInRect(&rc, ptMouse) )
-							//        clrColor = pManager->GetDefaultLinkHoverFontColor();
-							//}
-							aColorArray.Add((LPVOID)clrColor);
-							::SetTextColor(hDC,  RGB(GetBValue(clrColor), GetGValue(clrColor), GetRValue(clrColor)));
-							TFontInfo* pFontInfo = pDefFontInfo;
-							if( aFontArray.GetSize() > 0 ) pFontInfo = (TFontInfo*)aFontArray.GetAt(aFontArray.GetSize() - 1);
-							if( pFontInfo->bUnderline == false ) {
-								HFONT hFont = pManager->GetFont(pFontInfo->sFontName, pFontInfo->iSize, pFontInfo->bBold, true, pFontInfo->bItalic);
-								if( hFont == NULL ) hFont = pManager->AddFont(g_iFontID, pFontInfo->sFontName, pFontInfo->iSize, pFontInfo->bBold, true, pFontInfo->bItalic);
-								pFontInfo = pManager->GetFontInfo(hFont);
-								aFontArray.Add(pFontInfo);
-								pTm = &pFontInfo->tm;
-								::SelectObject(hDC, pFontInfo->hFont);
-								cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-							}
-							ptLinkStart = pt;
-							bInLink = true;
-						}
-						break;
-					case _T('b'):  // Bold
-						{
-							pstrText++;
-							TFontInfo* pFontInfo = pDefFontInfo;
-							if( aFontArray.GetSize() > 0 ) pFontInfo = (TFontInfo*)aFontArray.GetAt(aFontArray.GetSize() - 1);
-							if( pFontInfo->bBold == false ) {
-								HFONT hFont = pManager->GetFont(pFontInfo->sFontName, pFontInfo->iSize, true, pFontInfo->bUnderline, pFontInfo->bItalic);
-								if( hFont == NULL ) hFont = pManager->AddFont(g_iFontID, pFontInfo->sFontName, pFontInfo->iSize, true, pFontInfo->bUnderline, pFontInfo->bItalic);
-								pFontInfo = pManager->GetFontInfo(hFont);
-								aFontArray.Add(pFontInfo);
-								pTm = &pFontInfo->tm;
-								::SelectObject(hDC, pFontInfo->hFont);
-								cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-							}
-						}
-						break;
-					case _T('c'):  // Color
-						{
-							pstrText++;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							if( *pstrText == _T('#')) pstrText++;
-							DWORD clrColor = _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 16);
-							aColorArray.Add((LPVOID)clrColor);
-							::SetTextColor(hDC, RGB(GetBValue(clrColor), GetGValue(clrColor), GetRValue(clrColor)));
-						}
-						break;
-					case _T('f'):  // Font
-						{
-							pstrText++;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							LPCTSTR pstrTemp = pstrText;
-							int iFont = (int) _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-							if( pstrTemp != pstrText ) {
-								TFontInfo* pFontInfo = pManager->GetFontInfo(iFont);
-								aFontArray.Add(pFontInfo);
-								pTm = &pFontInfo->tm;
-								::SelectObject(hDC, pFontInfo->hFont);
-							}
-							else {
-								CDuiString sFontName;
-								int iFontSize = 10;
-								CDuiString sFontAttr;
-								bool bBold = false;
-								bool bUnderline = false;
-								bool bItalic = false;
-								while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('}') && *pstrText != _T(' ') ) {
-									pstrTemp = ::CharNext(pstrText);
-									while( pstrText < pstrTemp) {
-										sFontName += *pstrText++;
-									}
-								}
-								while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-								if( isdigit(*pstrText) ) {
-									iFontSize = (int) _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-								}
-								while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-								while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('}') ) {
-									pstrTemp = ::CharNext(pstrText);
-									while( pstrText < pstrTemp) {
-										sFontAttr += *pstrText++;
-									}
-								}
-								sFontAttr.MakeLower();
-								if( sFontAttr.Find(_T("bold")) >= 0 ) bBold = true;
-								if( sFontAttr.Find(_T("underline")) >= 0 ) bUnderline = true;
-								if( sFontAttr.Find(_T("italic")) >= 0 ) bItalic = true;
-								HFONT hFont = pManager->GetFont(sFontName, iFontSize, bBold, bUnderline, bItalic);
-								if( hFont == NULL ) hFont = pManager->AddFont(g_iFontID, sFontName, iFontSize, bBold, bUnderline, bItalic);
-								TFontInfo* pFontInfo = pManager->GetFontInfo(hFont);
-								aFontArray.Add(pFontInfo);
-								pTm = &pFontInfo->tm;
-								::SelectObject(hDC, pFontInfo->hFont);
-							}
-							cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-						}
-						break;
-					case _T('i'):  // Italic or Image
-						{    
-							pstrNextStart = pstrText - 1;
-							pstrText++;
-							CDuiString sImageString = pstrText;
-							int iWidth = 0;
-							int iHeight = 0;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							const TImageInfo* pImageInfo = NULL;
-							CDuiString sName;
-							while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('}') && *pstrText != _T(' ') ) {
-								LPCTSTR pstrTemp = ::CharNext(pstrText);
-								while( pstrText < pstrTemp) {
-									sName += *pstrText++;
-								}
-							}
-							if( sName.IsEmpty() ) { // Italic
-								pstrNextStart = NULL;
-								TFontInfo* pFontInfo = pDefFontInfo;
-								if( aFontArray.GetSize() > 0 ) pFontInfo = (TFontInfo*)aFontArray.GetAt(aFontArray.GetSize() - 1);
-								if( pFontInfo->bItalic == false ) {
-									HFONT hFont = pManager->GetFont(pFontInfo->sFontName, pFontInfo->iSize, pFontInfo->bBold, pFontInfo->bUnderline, true);
-									if( hFont == NULL ) hFont = pManager->AddFont(g_iFontID, pFontInfo->sFontName, pFontInfo->iSize, pFontInfo->bBold, pFontInfo->bUnderline, true);
-									pFontInfo = pManager->GetFontInfo(hFont);
-									aFontArray.Add(pFontInfo);
-									pTm = &pFontInfo->tm;
-									::SelectObject(hDC, pFontInfo->hFont);
-									cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-								}
-							}
-							else {
-								while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-								int iImageListNum = (int) _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-								if( iImageListNum <= 0 ) iImageListNum = 1;
-								while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-								int iImageListIndex = (int) _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-								if( iImageListIndex < 0 || iImageListIndex >= iImageListNum ) iImageListIndex = 0;
-
-								if( _tcsstr(sImageString.GetData(), _T("file=\'")) != NULL || _tcsstr(sImageString.GetData(), _T("res=\'")) != NULL ) {
-									CDuiString sImageResType;
-									CDuiString sImageName;
-									LPCTSTR pStrImage = sImageString.GetData();
-									CDuiString sItem;
-									CDuiString sValue;
-									while( *pStrImage != _T('\0') ) {
-										sItem.Empty();
-										sValue.Empty();
-										while( *pStrImage > _T('\0') && *pStrImage <= _T(' ') ) pStrImage = ::CharNext(pStrImage);
-										while( *pStrImage != _T('\0') && *pStrImage != _T('=') && *pStrImage > _T(' ') ) {
-											LPTSTR pstrTemp = ::CharNext(pStrImage);
-											while( pStrImage < pstrTemp) {
-												sItem += *pStrImage++;
-											}
-										}
-										while( *pStrImage > _T('\0') && *pStrImage <= _T(' ') ) pStrImage = ::CharNext(pStrImage);
-										if( *pStrImage++ != _T('=') ) break;
-										while( *pStrImage > _T('\0') && *pStrImage <= _T(' ') ) pStrImage = ::CharNext(pStrImage);
-										if( *pStrImage++ != _T('\'') ) break;
-										while( *pStrImage != _T('\0') && *pStrImage != _T('\'') ) {
-											LPTSTR pstrTemp = ::CharNext(pStrImage);
-											while( pStrImage < pstrTemp) {
-												sValue += *pStrImage++;
-											}
-										}
-										if( *pStrImage++ != _T('\'') ) break;
-										if( !sValue.IsEmpty() ) {
-											if( sItem == _T("file") || sItem == _T("res") ) {
-												sImageName = sValue;
-											}
-											else if( sItem == _T("restype") ) {
-												sImageResType = sValue;
-											}
-										}
-										if( *pStrImage++ != _T(' ') ) break;
-									}
+		// Return size of text when requested
+		if( (uStyle & DT_CALCRECT) != 0 ) {
+			TLayoutRect rcText = { rc.left, rc.top, rc.right, rc.bottom };
+			pLayout->GetCalcRect(rcText);
+			rc.right = rcText.right;
+			rc.bottom = rcText.bottom;
+			return;
+		}
 
-									pImageInfo = pManager->GetImageEx((LPCTSTR)sImageName, sImageResType);
-								}
-								else
-									pImageInfo = pManager->GetImageEx((LPCTSTR)sName);
+		RECT rcClip = { 0 };
+		::GetClipBox(hDC, &rcClip);
+		HRGN hOldRgn = ::CreateRectRgnIndirect(&rcClip);
+		HRGN hRgn = ::CreateRectRgnIndirect(&rc);
+		::ExtSelectClipRgn(hDC, hRgn, RGN_AND);
 
-								if( pImageInfo ) {
-									iWidth = pImageInfo->nX;
-									iHeight = pImageInfo->nY;
-									if( iImageListNum > 1 ) iWidth /= iImageListNum;
+		::SetBkMode(hDC, TRANSPARENT);
+		::SetTextColor(hDC, RGB(GetBValue(dwTextColor), GetGValue(dwTextColor), GetRValue(dwTextColor)));
+		DWORD dwBkColor = pManager->GetDefaultSelectedBkColor();
+		::SetBkColor(hDC, RGB(GetBValue(dwBkColor), GetGValue(dwBkColor), GetRValue(dwBkColor)));
 
-									if( pt.x + iWidth > rc.right && pt.x > rc.left && (uStyle & DT_SINGLELINE) == 0 ) {
-										bLineEnd = true;
-									}
-									else {
-										pstrNextStart = NULL;
-										if( bDraw && bLineDraw ) {
-											CDuiRect rcImage(pt.x, pt.y + cyLineHeight - iHeight, pt.x + iWidth, pt.y + cyLineHeight);
-											if( iHeight < cyLineHeight ) { 
-												rcImage.bottom -= (cyLineHeight - iHeight) / 2;
-												rcImage.top = rcImage.bottom -  iHeight;
-											}
-											CDuiRect rcBmpPart(0, 0, iWidth, iHeight);
-											rcBmpPart.left = iWidth * iImageListIndex;
-											rcBmpPart.right = iWidth * (iImageListIndex + 1);
-											CDuiRect rcCorner(0, 0, 0, 0);
-											DrawImage(hDC, pImageInfo->hBitmap, rcImage, rcImage, rcBmpPart, rcCorner, \
-												pImageInfo->bAlpha, 255);
-										}
-
-										cyLine = MAX(iHeight, cyLine);
-										pt.x += iWidth;
-										cyMinHeight = pt.y + iHeight;
-										cxMaxWidth = MAX(cxMaxWidth, pt.x);
-									}
-								}
-								else pstrNextStart = NULL;
-							}
-						}
-						break;
-					case _T('n'):  // Newline
-						{
-							pstrText++;
-							if( (uStyle & DT_SINGLELINE) != 0 ) break;
-							bLineEnd = true;
-						}
-						break;
-					case _T('p'):  // Paragraph
-						{
-							pstrText++;
-							if( pt.x > rc.left ) bLineEnd = true;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							int cyLineExtra = (int)_tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-							aPIndentArray.Add((LPVOID)cyLineExtra);
-							cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + cyLineExtra);
-						}
-						break;
-					case _T('r'):  // Raw Text
-						{
-							pstrText++;
-							bInRaw = true;
-						}
-						break;
-					case _T('s'):  // Selected text background color
-						{
-							pstrText++;
-							bInSelected = !bInSelected;
-							if( bDraw && bLineDraw ) {
-								if( bInSelected ) ::SetBkMode(hDC, OPAQUE);
-								else ::SetBkMode(hDC, TRANSPARENT);
-							}
-						}
-						break;
-					case _T('u'):  // Underline text
-						{
-							pstrText++;
-							TFontInfo* pFontInfo = pDefFontInfo;
-							if( aFontArray.GetSize() > 0 ) pFontInfo = (TFontInfo*)aFontArray.GetAt(aFontArray.GetSize() - 1);
-							if( pFontInfo->bUnderline == false ) {
-								HFONT hFont = pManager->GetFont(pFontInfo->sFontName, pFontInfo->iSize, pFontInfo->bBold, true, pFontInfo->bItalic);
-								if( hFont == NULL ) hFont = pManager->AddFont(g_iFontID, pFontInfo->sFontName, pFontInfo->iSize, pFontInfo->bBold, true, pFontInfo->bItalic);
-								pFontInfo = pManager->GetFontInfo(hFont);
-								aFontArray.Add(pFontInfo);
-								pTm = &pFontInfo->tm;
-								::SelectObject(hDC, pFontInfo->hFont);
-								cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-							}
-						}
-						break;
-					case _T('x'):  // X Indent
-						{
-							pstrText++;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							int iWidth = (int) _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-							pt.x += iWidth;
-							cxMaxWidth = MAX(cxMaxWidth, pt.x);
-						}
-						break;
-					case _T('y'):  // Y Indent
-						{
-							pstrText++;
-							while( *pstrText > _T('\0') && *pstrText <= _T(' ') ) pstrText = ::CharNext(pstrText);
-							cyLine = (int) _tcstol(pstrText, const_cast<LPTSTR*>(&pstrText), 10);
-						}
-						break;
-					}
-					if( pstrNextStart != NULL ) pstrText = pstrNextStart;
-					else {
-						while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('}') ) pstrText = ::CharNext(pstrText);
-						pstrText = ::CharNext(pstrText);
-					}
+		HFONT hOldFont = NULL;
+		void* pFont = NULL;
+		int iColor = -1;
+		bool bSelected = false;
+		for( size_t i = 0; i < pLayout->aRuns.size(); i++ ) {
+			const CHtmlTextLayout::Run& run = pLayout->aRuns[i];
+			if( run.nType == HTMLTEXT_RUN_IMAGE ) {
+				const TImageInfo* pImageInfo = static_cast<const TImageInfo*>(run.pImage);
+				RECT rcImage = { ptOrigin.x + run.rcImage.left, ptOrigin.y + run.rcImage.top, ptOrigin.x + run.rcImage.right, ptOrigin.y + run.rcImage.bottom };
+				RECT rcBmpPart = { run.rcBmpPart.left, run.rcBmpPart.top, run.rcBmpPart.right, run.rcBmpPart.bottom };
+				RECT rcCorner = { 0 };
+				DrawImage(hDC, pImageInfo->hBitmap, rcImage, rcImage, rcBmpPart, rcCorner, pImageInfo->bAlpha, 255);
+				continue;
 			}
-			else if( !bInRaw && ( *pstrText == _T('<') || *pstrText == _T('{') ) && pstrText[1] == _T('/') )
-			{
-				pstrText++;
-				pstrText++;
-				switch( *pstrText )
-				{
-				case _T('c'):
-					{
-						pstrText++;
-						aColorArray.Remove(aColorArray.GetSize() - 1);
-						DWORD clrColor = dwTextColor;
-						if( aColorArray.GetSize() > 0 ) clrColor = (int)aColorArray.GetAt(aColorArray.GetSize() - 1);
-						::SetTextColor(hDC, RGB(GetBValue(clrColor), GetGValue(clrColor), GetRValue(clrColor)));
-					}
-					break;
-				case _T('p'):
-					pstrText++;
-					if( pt.x > rc.left ) bLineEnd = true;
-					aPIndentArray.Remove(aPIndentArray.GetSize() - 1);
-					cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-					break;
-				case _T('s'):
-					{
-						pstrText++;
-						bInSelected = !bInSelected;
-						if( bDraw && bLineDraw ) {
-							if( bInSelected ) ::SetBkMode(hDC, OPAQUE);
-							else ::SetBkMode(hDC, TRANSPARENT);
-						}
-					}
-					break;
-				case _T('a'):
-					{
-						if( iLinkIndex < nLinkRects ) {
-							if( !bLineDraw ) ::SetRect(&prcLinks[iLinkIndex], ptLinkStart.x, ptLinkStart.y, MIN(pt.x, rc.right), pt.y + pTm->tmHeight + pTm->tmExternalLeading);
-							iLinkIndex++;
-						}
-						aColorArray.Remove(aColorArray.GetSize() - 1);
-						DWORD clrColor = dwTextColor;
-						if( aColorArray.GetSize() > 0 ) clrColor = (int)aColorArray.GetAt(aColorArray.GetSize() - 1);
-						::SetTextColor(hDC, RGB(GetBValue(clrColor), GetGValue(clrColor), GetRValue(clrColor)));
-						bInLink = false;
-					}
-				case _T('b'):
-				case _T('f'):
-				case _T('i'):
-				case _T('u'):
-					{
-						pstrText++;
-						aFontArray.Remove(aFontArray.GetSize() - 1);
-						TFontInfo* pFontInfo = (TFontInfo*)aFontArray.GetAt(aFontArray.GetSize() - 1);
-						if( pFontInfo == NULL ) pFontInfo = pDefFontInfo;
-						if( pTm->tmItalic && pFontInfo->bItalic == false ) {
-							ABC abc;
-							::GetCharABCWidths(hDC, _T(' '), _T(' '), &abc);
-							pt.x += abc.abcC / 2; // 简单修正一下斜体混排的问题, 正确做法应该是http://support.microsoft.com/kb/244798/en-us
-						}
-						pTm = &pFontInfo->tm;
-						::SelectObject(hDC, pFontInfo->hFont);
-						cyLine = MAX(cyLine, pTm->tmHeight + pTm->tmExternalLeading + (int)aPIndentArray.GetAt(aPIndentArray.GetSize() - 1));
-					}
-					break;
-				}
-				while( *pstrText != _T('\0') && *pstrText != _T('>') && *pstrText != _T('}') ) pstrText = ::CharNext(pstrText);
-				pstrText = ::CharNext(pstrText);
-			}
-			else if( !bInRaw &&  *pstrText == _T('<') && pstrText[2] == _T('>') && (pstrText[1] == _T('{')  || pstrText[1] == _T('}')) )
-			{
-				SIZE szSpace = { 0 };
-				::GetTextExtentPoint32(hDC, &pstrText[1], 1, &szSpace);
-				if( bDraw && bLineDraw ) ::TextOut(hDC, pt.x, pt.y + cyLineHeight - pTm->tmHeight - pTm->tmExternalLeading, &pstrText[1], 1);
-				pt.x += szSpace.cx;
-				cxMaxWidth = MAX(cxMaxWidth, pt.x);
-				pstrText++;pstrText++;pstrText++;
+			if( run.pFont != pFont ) {
+				pFont = run.pFont;
+				HFONT hFont = (HFONT)::SelectObject(hDC, static_cast<TFontInfo*>(pFont)->hFont);
+				if( hOldFont == NULL ) hOldFont = hFont;
 			}
-			else if( !bInRaw &&  *pstrText == _T('{') && pstrText[2] == _T('}') && (pstrText[1] == _T('<')  || pstrText[1] == _T('>')) )
-			{
-				SIZE szSpace = { 0 };
-				::GetTextExtentPoint32(hDC, &pstrText[1], 1, &szSpace);
-				if( bDraw && bLineDraw ) ::TextOut(hDC, pt.x,  pt.y + cyLineHeight - pTm->tmHeight - pTm->tmExternalLeading, &pstrText[1], 1);
-				pt.x += szSpace.cx;
-				cxMaxWidth = MAX(cxMaxWidth, pt.x);
-				pstrText++;pstrText++;pstrText++;
+			if( run.iColor != iColor ) {
+				iColor = run.iColor;
+				const CHtmlTextLayout::Color& color = pLayout->aColors[iColor];
+				DWORD clrColor = dwTextColor;
+				if( color.nType == HTMLTEXT_COLOR_VALUE ) clrColor = color.dwColor;
+				else if( color.nType == HTMLTEXT_COLOR_LINK && bHoverLink && sHoverLink == color.sLink.c_str() ) clrColor = pManager->GetDefaultLinkHoverFontColor();
+				::SetTextColor(hDC, RGB(GetBValue(clrColor), GetGValue(clrColor), GetRValue(clrColor)));
 			}
-			else if( !bInRaw &&  *pstrText == _T(' ') )
-			{
-				SIZE szSpace = { 0 };
-				::GetTextExtentPoint32(hDC, _T(" "), 1, &szSpace);
-				// Still need to paint the space because the font might have
-				// underline formatting.
-				if( bDraw && bLineDraw ) ::TextOut(hDC, pt.x,  pt.y + cyLineHeight - pTm->tmHeight - pTm->tmExternalLeading, _T(" "), 1);
-				pt.x += szSpace.cx;
-				cxMaxWidth = MAX(cxMaxWidth, pt.x);
-				pstrText++;
+			if( run.bSelected != bSelected ) {
+				bSelected = run.bSelected;
+				::SetBkMode(hDC, bSelected ? OPAQUE : TRANSPARENT);
 			}
-			else
-			{
-				POINT ptPos = pt;
-				int cchChars = 0;
-				int cchSize = 0;
-				int cchLastGoodWord = 0;
-				int cchLastGoodSize = 0;
-				LPCTSTR p = pstrText;
-				LPCTSTR pstrNext;
-				SIZE szText = { 0 };
-				if( !bInRaw && *p == _T('<') || *p == _T('{') ) p++, cchChars++, cchSize++;
-				while( *p != _T('\0') && *p != _T('\n') ) {
-					// This part makes sure that we're word-wrapping if needed or providing support
-					// for DT_END_ELLIPSIS. Unfortunately the GetTextExtentPoint32() call is pretty
-					// slow when repeated so often.
-					// TODO: Rewrite and use GetTextExtentExPoint() instead!
-					if( bInRaw ) {
-						if( ( *p == _T('<') || *p == _T('{') ) && p[1] == _T('/') 
-							&& p[2] == _T('r') && ( p[3] == _T('>') || p[3] == _T('}') ) ) {
-								p += 4;
-								bInRaw = false;
-								break;
-						}
-					}
-					else {
-						if( *p == _T('<') || *p == _T('{') ) break;
-					}
-					pstrNext = ::CharNext(p);
-					cchChars++;
-					cchSize += (int)(pstrNext - p);
-					szText.cx = cchChars * pTm->tmMaxCharWidth;
-					if( pt.x + szText.cx >= rc.right ) {
-						::GetTextExtentPoint32(hDC, pstrText, cchSize, &szText);
-					}
-					if( pt.x + szText.cx > rc.right ) {
-						if( pt.x + szText.cx > rc.right && pt.x != rc.left) {
-							cchChars--;
-							cchSize -= (int)(pstrNext - p);
-						}
-						if( (uStyle & DT_WORDBREAK) != 0 && cchLastGoodWord > 0 ) {
-							cchChars = cchLastGoodWord;
-							cchSize = cchLastGoodSize;                 
-						}
-						if( (uStyle & DT_END_ELLIPSIS) != 0 && cchChars > 0 ) {
-							cchChars -= 1;
-							LPCTSTR pstrPrev = ::CharPrev(pstrText, p);
-							if( cchChars > 0 ) {
-								cchChars -= 1;
-								pstrPrev = ::CharPrev(pstrText, pstrPrev);
-								cchSize -= (int)(p - pstrPrev);
-							}
-							else 
-								cchSize -= (int)(p - pstrPrev);
-							pt.x = rc.right;
-						}
-						bLineEnd = true;
-						cxMaxWidth = MAX(cxMaxWidth, pt.x);
-						break;
-					}
-					if (!( ( p[0] >= _T('a') && p[0] <= _T('z') ) || ( p[0] >= _T('A') && p[0] <= _T('Z') ) )) {
-						cchLastGoodWord = cchChars;
-						cchLastGoodSize = cchSize;
-					}
-					if( *p == _T(' ') ) {
-						cchLastGoodWord = cchChars;
-						cchLastGoodSize = cchSize;
-					}
-					p = ::CharNext(p);
-				}
-
-				::GetTextExtentPoint32(hDC, pstrText, cchSize, &szText);
-				if( bDraw && bLineDraw ) {
-					if( (uStyle & DT_SINGLELINE) == 0 && (uStyle & DT_CENTER) != 0 ) {
-						ptPos.x += (rc.right - rc.left - szText.cx)/2;
-					}
-					else if( (uStyle & DT_SINGLELINE) == 0 && (uStyle & DT_RIGHT) != 0) {
-						ptPos.x += (rc.right - rc.left - szText.cx);
-					}
-					::TextOut(hDC, ptPos.x, ptPos.y + cyLineHeight - pTm->tmHeight - pTm->tmExternalLeading, pstrText, cchSize);
-					if( pt.x >= rc.right && (uStyle & DT_END_ELLIPSIS) != 0 ) 
-						::TextOut(hDC, ptPos.x + szText.cx, ptPos.y, _T("..."), 3);
-				}
-				pt.x += szText.cx;
-				cxMaxWidth = MAX(cxMaxWidth, pt.x);
-				pstrText += cchSize;
-			}
-
-			if( pt.x >= rc.right || *pstrText == _T('\n') || *pstrText == _T('\0') ) bLineEnd = true;
-			if( bDraw && bLineEnd ) {
-				if( !bLineDraw ) {
-					aFontArray.Resize(aLineFontArray.GetSize());
-					::CopyMemory(aFontArray.GetData(), aLineFontArray.GetData(), aLineFontArray.GetSize() * sizeof(LPVOID));
-					aColorArray.Resize(aLineColorArray.GetSize());
-					::CopyMemory(aColorArray.GetData(), aLineColorArray.GetData(), aLineColorArray.GetSize() * sizeof(LPVOID));
-					aPIndentArray.Resize(aLinePIndentArray.GetSize());
-					::CopyMemory(aPIndentArray.GetData(), aLinePIndentArray.GetData(), aLinePIndentArray.GetSize() * sizeof(LPVOID));
-
-					cyLineHeight = cyLine;
-					pstrText = pstrLineBegin;
-					bInRaw = bLineInRaw;
-					bInSelected = bLineInSelected;
-
-					DWORD clrColor = dwTextColor;
-					if( aColorArray.GetSize() > 0 ) clrColor = (int)aColorArray.GetAt(aColorArray.GetSize() - 1);
-					::SetTextColor(hDC, RGB(GetBValue(clrColor), GetGValue(clrColor), GetRValue(clrColor)));
-					TFontInfo* pFontInfo = (TFontInfo*)aFontArray.GetAt(aFontArray.GetSize() - 1);
-					if( pFontInfo == NULL ) pFontInfo = pDefFontInfo;
-					pTm = &pFontInfo->tm;
-					::SelectObject(hDC, pFontInfo->hFont);
-					if( bInSelected ) ::SetBkMode(hDC, OPAQUE);
-				}
-				else {
-					aLineFontArray.Resize(aFontArray.GetSize());
-					::CopyMemory(aLineFontArray.GetData(), aFontArray.GetData(), aFontArray.GetSize() * sizeof(LPVOID));
-					aLineColorArray.Resize(aColorArray.GetSize());
-					::CopyMemory(aLineColorArray.GetData(), aColorArray.GetData(), aColorArray.GetSize() * sizeof(LPVOID));
-					aLinePIndentArray.Resize(aPIndentArray.GetSize());
-					::CopyMemory(aLinePIndentArray.GetData(), aPIndentArray.GetData(), aPIndentArray.GetSize() * sizeof(LPVOID));
-					pstrLineBegin = pstrText;
-					bLineInSelected = bInSelected;
-					bLineInRaw = bInRaw;
-				}
-			}
-
-			ASSERT(iLinkIndex<=nLinkRects);
+			if( run.nType == HTMLTEXT_RUN_ELLIPSIS ) ::TextOut(hDC, ptOrigin.x + run.x, ptOrigin.y + run.y, _T("..."), 3);
+			else ::TextOut(hDC, ptOrigin.x + run.x, ptOrigin.y + run.y, pstrText + run.iText, run.cchText);
 		}
 
-		nLinkRects = iLinkIndex;
+		// 有对齐方式时返回对齐后的区域
+		rc.left = ptOrigin.x + pLayout->rc.left;
+		rc.top = ptOrigin.y + pLayout->rc.top;
+		rc.right = ptOrigin.x + pLayout->rc.right;
+		rc.bottom = ptOrigin.y + pLayout->rc.bottom;
 
-		// Return size of text when requested
-		if( (uStyle & DT_CALCRECT) != 0 ) {
-			rc.bottom = MAX(cyMinHeight, pt.y + cyLine);
-			rc.right = MIN(rc.right, cxMaxWidth);
-		}
-
-		if( bDraw ) ::SelectClipRgn(hDC, hOldRgn);
+		::SelectClipRgn(hDC, hOldRgn);
 		::DeleteObject(hOldRgn);
 		::DeleteObject(hRgn);
 
-		::SelectObject(hDC, hOldFont);
+		if( hOldFont != NULL ) ::SelectObject(hDC, hOldFont);
 	}
 
 	HBITMAP CRenderEngine::GenerateBitmap(CPaintManagerUI* pManager, RECT rc, CControlUI* pStopControl, DWORD dwFilterColor)
@@ -2521,25 +2146,55 @@ namespace DuiLib {
 
 	void CRenderEngine::AdjustImage(bool bUseHSL, TImageInfo* imageInfo, short H, short S, short L)
 	{
-		if( imageInfo == NULL || imageInfo->bUseHSL == false || imageInfo->hBitmap == NULL || 
-			imageInfo->pBits == NULL || imageInfo->pSrcBits == NULL ) 
-			return;
-		if( bUseHSL == false || (H == 180 && S == 100 && L == 100)) {
-			::CopyMemory(imageInfo->pBits, imageInfo->pSrcBits, imageInfo->nX * imageInfo->nY * 4);
-			return;
-		}
+		CStdPtrArray aImages;
+		aImages.Add(imageInfo);
+		AdjustImages(bUseHSL, aImages, H, S, L);
+	}
 
-		float fH, fS, fL;
-		float S1 = S / 100.0f;
-		float L1 = L / 100.0f;
-		for( int i = 0; i < imageInfo->nX * imageInfo->nY; i++ ) {
-			RGBtoHSL(*(DWORD*)(imageInfo->pSrcBits + i*4), &fH, &fS, &fL);
-			fH += (H - 180);
-			fH = fH > 0 ? fH : fH + 360; 
-			fS *= S1;
-			fL *= L1;
-			HSLtoRGB((DWORD*)(imageInfo->pBits + i*4), fH, fS, fL);
+	void CRenderEngine::AdjustImages(bool bUseHSL, const CStdPtrArray& aImages, short H, short S, short L)
+	{
+		if( bUseHSL == false ) {
+			H = 180;
+			S = 100;
+			L = 100;
+		}
+		// 结果写到新建的 DIB 中，全部调整完再替换各图片的 hBitmap，正在显示的位图不会被改写
+		CStdPtrArray aTargets;
+		CStdPtrArray aBitmaps;
+		std::vector<HSLTask> tasks;
+		for( int i = 0; i < aImages.GetSize(); i++ ) {
+			TImageInfo* data = static_cast<TImageInfo*>(aImages.GetAt(i));
+			if( data == NULL || data->bUseHSL == false || data->hBitmap == NULL || data->pSrcBits == NULL ) continue;
+			if( aTargets.Find(data) >= 0 ) continue;
+			LPBYTE pBits = NULL;
+			HBITMAP hBitmap = _CreateImageBitmap(data->nX, data->nY, &pBits);
+			if( hBitmap == NULL ) continue;
+			HSLTask task = { data->pSrcBits, pBits, (size_t)data->nX * data->nY };
+			tasks.push_back(task);
+			aTargets.Add(data);
+			aBitmaps.Add(hBitmap);
 		}
+		if( tasks.empty() ) return;
+		AdjustPixelsHSLParallel(&tasks[0], tasks.size(), H, S, L);
+
+		for( int i = 0; i < aTargets.GetSize(); i++ ) {
+			TImageInfo* data = static_cast<TImageInfo*>(aTargets.GetAt(i));
+			HBITMAP hOldBitmap = data->hBitmap;
+			data->hBitmap = static_cast<HBITMAP>(aBitmaps.GetAt(i));
+			::DeleteObject(hOldBitmap);
+		}
+	}
+
+	LPBYTE CRenderEngine::GetImageBits(const TImageInfo* imageInfo)
+	{
+		if( imageInfo == NULL ) return NULL;
+		if( imageInfo->pBits != NULL ) return imageInfo->pBits;
+		if( imageInfo->hBitmap == NULL ) return NULL;
+		// LoadImage 创建的是自上而下的 32 位 DIB，像素就是 DIB 的内存
+		DIBSECTION ds;
+		if( ::GetObject(imageInfo->hBitmap, sizeof(ds), &ds) != sizeof(ds) ) return NULL;
+		if( ds.dsBm.bmBitsPixel != 32 ) return NULL;
+		return static_cast<LPBYTE>(ds.dsBm.bmBits);
 	}
 
 } // namespace DuiLib
@@ -34,7 +34,13 @@ namespace DuiLib {
 		static DWORD AdjustColor(DWORD dwColor, short H, short S, short L);
 		static HBITMAP CreateARGB32Bitmap(HDC hDC, int cx, int cy, BYTE** pBits);
 		static void AdjustImage(bool bUseHSL, TImageInfo* imageInfo, short H, short S, short L);
+		// 一起调整多张图片，分块并行计算，全部完成后再替换各图片的位图
+		static void AdjustImages(bool bUseHSL, const CStdPtrArray& aImages, short H, short S, short L);
+		// 图片的像素（预乘 alpha 的 BGRA），不是 32 位 DIB 时返回 NULL
+		static LPBYTE GetImageBits(const TImageInfo* imageInfo);
 		static TImageInfo* LoadImage(STRINGorID bitmap, LPCTSTR type = NULL, DWORD mask = 0, HINSTANCE instance = NULL);
+		// 用已经解码好的预乘 alpha BGRA 数据创建图片，数据会被复制
+		static TImageInfo* CreateImageInfo(const BYTE* pBits, int nWidth, int nHeight, bool bAlpha);
 #ifdef USE_XIMAGE_EFFECT
 		static CxImage *LoadGifImageX(STRINGorID bitmap, LPCTSTR type = NULL, DWORD mask = 0);
 #endif
@@ -42,8 +48,13 @@ namespace DuiLib {
 		static TImageInfo* LoadImage(LPCTSTR pStrImage, LPCTSTR type = NULL, DWORD mask = 0, HINSTANCE instance = NULL);
 		static TImageInfo* LoadImage(UINT nID, LPCTSTR type = NULL, DWORD mask = 0, HINSTANCE instance = NULL);
 
+		// 按图片的查找顺序（资源目录、资源 zip、绝对路径）读出文件内容，用 delete[] 释放
+		static LPBYTE LoadResourceData(LPCTSTR pstrPath, DWORD& dwSize);
 		static Gdiplus::Image*	GdiplusLoadImage(LPCTSTR pstrPath);
 		static Gdiplus::Image* GdiplusLoadImage(LPVOID pBuf, size_t dwSize);
+		// 解码 GIF 的所有帧，不是 GIF 时作为一帧加载；通常通过 CPaintManagerUI::AcquireGif 共享
+		static TGifInfo* LoadGif(LPCTSTR pstrPath);
+		static void FreeGif(TGifInfo* pGif);
 
 		static bool DrawIconImageString(HDC hDC, CPaintManagerUI* pManager, const RECT& rcItem, const RECT& rcPaint, \
 			LPCTSTR pStrImage, LPCTSTR pStrModify = NULL);
@@ -0,0 +1,196 @@
+#include "UIMarkupDom.h"
+#include "UISkinBinary.h"
+
+namespace DuiLib {
+
+namespace {
+
+    static_assert(sizeof(CMarkupTypedValue) == 24, "CMarkupTypedValue is stored in skin binaries");
+    static_assert(sizeof(SkinBinaryAttribute) == 32, "SkinBinaryAttribute layout changed");
+    static_assert(sizeof(SkinBinaryNode) == 24, "SkinBinaryNode layout changed");
+
+    // 与 SkinClassId 一一对应，内置控件的顺序与 CControlFactory 的注册顺序相同
+    const char* const kSkinClassNames[] = {
+        "",
+        "Window",
+        "Image",
+        "Font",
+        "Default",
+        "Style",
+        "Import",
+        "Include",
+        "Control",
+        "Container",
+        "Button",
+        "Combo",
+        "ComboBox",
+        "DateTime",
+        "Edit",
+        "ActiveX",
+        "Flash",
+        "GifAnim",
+        "GifAnimEx",
+        "GroupBox",
+        "IPAddress",
+        "IPAddressEx",
+        "Label",
+        "List",
+        "ListHeader",
+        "ListHeaderItem",
+        "ListLabelElement",
+        "ListTextElement",
+        "ListContainerElement",
+        "Menu",
+        "MenuElement",
+        "Option",
+        "CheckBox",
+        "Progress",
+        "RichEdit",
+        "ScrollBar",
+        "Slider",
+        "Text",
+        "TreeNode",
+        "TreeView",
+        "WebBrowser",
+        "AnimationTabLayout",
+        "ChildLayout",
+        "HorizontalLayout",
+        "TabLayout",
+        "TileLayout",
+        "VerticalLayout",
+        "RollText",
+        "ColorPalette",
+        "ListEx",
+        "ListContainerHeaderItem",
+        "ListTextExtElement",
+        "HotKey",
+        "FadeButton",
+        "Ring",
+    };
+
+    const unsigned int kSkinClassCount = sizeof(kSkinClassNames) / sizeof(kSkinClassNames[0]);
+
+    template<typename T>
+    unsigned int FindSkinClass(const T* pName)
+    {
+        if( pName == NULL || *pName == 0 ) return SKIN_CLASS_UNKNOWN;
+        for( unsigned int nClass = 1; nClass < kSkinClassCount; nClass++ ) {
+            const char* pClass = kSkinClassNames[nClass];
+            const T* p = pName;
+            for( ; *pClass != 0; ++pClass, ++p ) {
+                unsigned int c = static_cast<unsigned int>(*p);
+                if( c >= 'A' && c <= 'Z' ) c += 'a' - 'A';
+                unsigned int k = static_cast<unsigned char>(*pClass);
+                if( k >= 'A' && k <= 'Z' ) k += 'a' - 'A';
+                if( c != k ) break;
+            }
+            if( *pClass == 0 && *p == 0 ) return nClass;
+        }
+        return SKIN_CLASS_UNKNOWN;
+    }
+
+    // 表 [nOffset, nOffset + nCount * nRecordSize) 在数据范围内且 4 字节对齐
+    bool IsTableInRange(uint32_t nOffset, uint32_t nCount, size_t nRecordSize, size_t nSize)
+    {
+        if( (nOffset & 3) != 0 ) return false;
+        unsigned long long nEnd = static_cast<unsigned long long>(nOffset) + static_cast<unsigned long long>(nCount) * nRecordSize;
+        return nEnd <= nSize;
+    }
+
+} // namespace
+
+unsigned int GetSkinClassCount()
+{
+    return kSkinClassCount;
+}
+
+const char* GetSkinClassName(unsigned int nClassId)
+{
+    if( nClassId == SKIN_CLASS_UNKNOWN || nClassId >= kSkinClassCount ) return NULL;
+    return kSkinClassNames[nClassId];
+}
+
+unsigned int GetSkinClassId(const char* pName)
+{
+    return FindSkinClass(pName);
+}
+
+unsigned int GetSkinClassId(const wchar_t* pName)
+{
+    return FindSkinClass(pName);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//
+//
+
+CSkinBinaryReader::CSkinBinaryReader() : m_pHeader(NULL), m_pNodes(NULL), m_pAttributes(NULL), m_pNames(NULL),
+    m_pStrings(NULL), m_nMaxNodeAttributes(0)
+{
+}
+
+void CSkinBinaryReader::Close()
+{
+    m_pHeader = NULL;
+    m_pNodes = NULL;
+    m_pAttributes = NULL;
+    m_pNames = NULL;
+    m_pStrings = NULL;
+    m_nMaxNodeAttributes = 0;
+}
+
+bool CSkinBinaryReader::Open(const void* pData, size_t nSize)
+{
+    Close();
+    if( pData == NULL || nSize < sizeof(SkinBinaryHeader) || (reinterpret_cast<size_t>(pData) & 3) != 0 ) return false;
+
+    const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+    const SkinBinaryHeader* pHeader = static_cast<const SkinBinaryHeader*>(pData);
+    if( pHeader->nMagic != SKIN_BINARY_MAGIC || pHeader->nVersion != SKIN_BINARY_VERSION ) return false;
+    if( pHeader->nFileSize != nSize ) return false;
+    if( !IsTableInRange(pHeader->nNodeOffset, pHeader->nNodeCount, sizeof(SkinBinaryNode), nSize) ) return false;
+    if( !IsTableInRange(pHeader->nAttributeOffset, pHeader->nAttributeCount, sizeof(SkinBinaryAttribute), nSize) ) return false;
+    if( !IsTableInRange(pHeader->nNameOffset, pHeader->nNameCount, sizeof(SkinBinaryName), nSize) ) return false;
+    if( !IsTableInRange(pHeader->nStringOffset, pHeader->nStringCount, sizeof(uint16_t), nSize) ) return false;
+
+    // 字符串池以 0 结尾，池内任意偏移开始的字符串都不会越界
+    const uint16_t* pStrings = reinterpret_cast<const uint16_t*>(pBytes + pHeader->nStringOffset);
+    const uint32_t nStrings = pHeader->nStringCount;
+    if( nStrings == 0 || pStrings[nStrings - 1] != 0 ) return false;
+
+    const SkinBinaryName* pNames = reinterpret_cast<const SkinBinaryName*>(pBytes + pHeader->nNameOffset);
+    for( uint32_t i = 0; i < pHeader->nNameCount; i++ ) {
+        const SkinBinaryName& name = pNames[i];
+        if( name.nOffset >= nStrings || name.nLength >= nStrings - name.nOffset ) return false;
+        if( pStrings[name.nOffset + name.nLength] != 0 ) return false;
+    }
+
+    const SkinBinaryAttribute* pAttributes = reinterpret_cast<const SkinBinaryAttribute*>(pBytes + pHeader->nAttributeOffset);
+    for( uint32_t i = 0; i < pHeader->nAttributeCount; i++ ) {
+        const SkinBinaryAttribute& attr = pAttributes[i];
+        if( attr.nName >= pHeader->nNameCount || attr.nValue >= nStrings ) return false;
+        if( attr.typed.nType > CMarkupTypedValue::TYPE_BOOL || attr.typed.nCount > 4 ) return false;
+    }
+
+    // 父节点只能在前面，保证构造出来的是一棵树
+    uint32_t nMaxNodeAttributes = 0;
+    const SkinBinaryNode* pNodes = reinterpret_cast<const SkinBinaryNode*>(pBytes + pHeader->nNodeOffset);
+    for( uint32_t i = 0; i < pHeader->nNodeCount; i++ ) {
+        const SkinBinaryNode& node = pNodes[i];
+        if( node.nName >= pHeader->nNameCount || node.nValue >= nStrings ) return false;
+        if( node.nParent != SKIN_BINARY_NONE && node.nParent >= i ) return false;
+        if( node.nFirstAttribute > pHeader->nAttributeCount || node.nAttributeCount > pHeader->nAttributeCount - node.nFirstAttribute ) return false;
+        if( node.nAttributeCount > nMaxNodeAttributes ) nMaxNodeAttributes = node.nAttributeCount;
+    }
+
+    m_pHeader = pHeader;
+    m_pNodes = pNodes;
+    m_pAttributes = pAttributes;
+    m_pNames = pNames;
+    m_pStrings = pStrings;
+    m_nMaxNodeAttributes = nMaxNodeAttributes;
+    return true;
+}
+
+} // namespace DuiLib
@@ -0,0 +1,177 @@
+#ifndef __UISKINBINARY_H__
+#define __UISKINBINARY_H__
+
+#pragma once
+
+// 预编译皮肤：tools/SkinCompiler 离线把皮肤 XML 编成二进制，运行时映射文件后直接构造 CMarkup 的文档，
+// 省掉编码转换、XML 解析，以及 CDialogBuilder 中节点类名的字符串查找和数值转换。
+// 文件为小端、4 字节对齐：SkinBinaryHeader、节点表（先序）、属性表、名字表、UTF-16 字符串池。
+// 只依赖 UIMarkupDom.h，不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace DuiLib {
+
+	enum
+	{
+		SKIN_BINARY_MAGIC = 0x4E4B5344,		// "DSKN"
+		SKIN_BINARY_VERSION = 1,
+		SKIN_BINARY_NONE = 0xFFFFFFFF,
+	};
+
+	// 节点类别：CDialogBuilder 自己处理的标签和内置控件。编号会写进皮肤文件，只能在末尾追加
+	enum SkinClassId
+	{
+		SKIN_CLASS_UNKNOWN = 0,		// 插件或回调创建的控件
+		SKIN_CLASS_WINDOW,
+		SKIN_CLASS_IMAGE,
+		SKIN_CLASS_FONT,
+		SKIN_CLASS_DEFAULT,
+		SKIN_CLASS_STYLE,
+		SKIN_CLASS_IMPORT,
+		SKIN_CLASS_INCLUDE,
+		SKIN_CLASS_FIRST_CONTROL,	// 之后是 CControlFactory 内置注册的控件
+	};
+
+	unsigned int GetSkinClassCount();
+	// 类别对应的节点名，内置控件为类名去掉 "C" 前缀和 "UI" 后缀；越界返回 NULL
+	const char* GetSkinClassName(unsigned int nClassId);
+	// 节点名对应的类别，ASCII 不区分大小写，不认识的返回 SKIN_CLASS_UNKNOWN
+	unsigned int GetSkinClassId(const char* pName);
+	unsigned int GetSkinClassId(const wchar_t* pName);
+
+	struct SkinBinaryHeader
+	{
+		uint32_t nMagic;
+		uint32_t nVersion;
+		uint32_t nFileSize;
+		uint32_t nNodeCount;
+		uint32_t nNodeOffset;
+		uint32_t nAttributeCount;
+		uint32_t nAttributeOffset;
+		uint32_t nNameCount;
+		uint32_t nNameOffset;
+		uint32_t nStringCount;		// 字符串池的 UTF-16 码元数，池以 0 结尾
+		uint32_t nStringOffset;
+	};
+
+	struct SkinBinaryNode
+	{
+		uint32_t nName;				// 名字表下标
+		uint32_t nClassId;			// SkinClassId
+		uint32_t nParent;			// 父节点下标，顶层节点为 SKIN_BINARY_NONE；子节点按下标顺序排列
+		uint32_t nValue;			// 节点文本在字符串池中的偏移
+		uint32_t nFirstAttribute;
+		uint32_t nAttributeCount;
+	};
+
+	struct SkinBinaryAttribute
+	{
+		uint32_t nName;
+		uint32_t nValue;
+		CMarkupTypedValue typed;	// 值不是可识别的格式时 nType 为 TYPE_NONE
+	};
+
+	struct SkinBinaryName
+	{
+		uint32_t nOffset;
+		uint32_t nLength;
+	};
+
+	class CSkinBinaryReader
+	{
+	public:
+		CSkinBinaryReader();
+
+		// 校验头部、各表的范围和所有下标，数据在读取期间必须保持有效
+		bool Open(const void* pData, size_t nSize);
+		void Close();
+		bool IsOpen() const { return m_pHeader != NULL; }
+
+		uint32_t GetNodeCount() const { return m_pHeader->nNodeCount; }
+		uint32_t GetAttributeCount() const { return m_pHeader->nAttributeCount; }
+		uint32_t GetNameCount() const { return m_pHeader->nNameCount; }
+		uint32_t GetMaxNodeAttributes() const { return m_nMaxNodeAttributes; }
+
+		const SkinBinaryNode& GetNode(uint32_t nIndex) const { return m_pNodes[nIndex]; }
+		const SkinBinaryAttribute& GetAttribute(uint32_t nIndex) const { return m_pAttributes[nIndex]; }
+		const uint16_t* GetName(uint32_t nIndex) const { return m_pStrings + m_pNames[nIndex].nOffset; }
+		uint32_t GetNameLength(uint32_t nIndex) const { return m_pNames[nIndex].nLength; }
+		const uint16_t* GetString(uint32_t nOffset) const { return m_pStrings + nOffset; }
+
+	private:
+		const SkinBinaryHeader* m_pHeader;
+		const SkinBinaryNode* m_pNodes;
+		const SkinBinaryAttribute* m_pAttributes;
+		const SkinBinaryName* m_pNames;
+		const uint16_t* m_pStrings;
+		uint32_t m_nMaxNodeAttributes;
+	};
+
+	// 用预编译皮肤构造文档。字符串直接指向皮肤数据，T 必须是 16 位字符（Windows 的 wchar_t）
+	template<typename T>
+	bool LoadSkinBinary(const CSkinBinaryReader& reader, CMarkupDomT<T>& dom)
+	{
+		typedef typename CMarkupDomT<T>::Node Node;
+		typedef typename CMarkupDomT<T>::Attribute Attribute;
+		static_assert(sizeof(T) == sizeof(uint16_t), "skin binary strings are UTF-16");
+
+		dom.BeginBuild();
+		if( !reader.IsOpen() ) return false;
+
+		// 临时表：名字下标到文档中的 id，节点下标到节点及其最后一个子节点，单个节点的属性
+		const uint32_t nNames = reader.GetNameCount();
+		const uint32_t nNodes = reader.GetNodeCount();
+		size_t nBytes = nNames * sizeof(unsigned int) + nNodes * 2 * sizeof(Node*) + reader.GetMaxNodeAttributes() * sizeof(Attribute);
+		char* pScratch = static_cast<char*>(malloc(nBytes > 0 ? nBytes : 1));
+		if( pScratch == NULL ) return false;
+		Node** apNodes = reinterpret_cast<Node**>(pScratch);
+		Node** apLastChild = apNodes + nNodes;
+		Attribute* aAttributes = reinterpret_cast<Attribute*>(apLastChild + nNodes);
+		unsigned int* aNameIds = reinterpret_cast<unsigned int*>(aAttributes + reader.GetMaxNodeAttributes());
+
+		bool bOk = true;
+		for( uint32_t i = 0; bOk && i < nNames; i++ ) {
+			aNameIds[i] = dom.AddName(reinterpret_cast<const T*>(reader.GetName(i)), reader.GetNameLength(i));
+			bOk = aNameIds[i] != CMarkupDomT<T>::INVALID_NAME_ID;
+		}
+		Node* pLastTop = NULL;
+		for( uint32_t i = 0; bOk && i < nNodes; i++ ) {
+			const SkinBinaryNode& node = reader.GetNode(i);
+			Node* pParent = node.nParent == SKIN_BINARY_NONE ? NULL : apNodes[node.nParent];
+			Node*& pPrevious = node.nParent == SKIN_BINARY_NONE ? pLastTop : apLastChild[node.nParent];
+			Node* pNode = dom.AddNode(pParent, pPrevious, reinterpret_cast<const T*>(reader.GetName(node.nName)),
+				aNameIds[node.nName], reinterpret_cast<const T*>(reader.GetString(node.nValue)));
+			if( pNode == NULL ) {
+				bOk = false;
+				break;
+			}
+			pNode->nClassId = node.nClassId < GetSkinClassCount() ? node.nClassId : static_cast<unsigned int>(SKIN_CLASS_UNKNOWN);
+			pPrevious = pNode;
+			apNodes[i] = pNode;
+			apLastChild[i] = NULL;
+
+			for( uint32_t j = 0; j < node.nAttributeCount; j++ ) {
+				const SkinBinaryAttribute& attr = reader.GetAttribute(node.nFirstAttribute + j);
+				aAttributes[j].pName = reinterpret_cast<const T*>(reader.GetName(attr.nName));
+				aAttributes[j].pValue = reinterpret_cast<const T*>(reader.GetString(attr.nValue));
+				aAttributes[j].pTyped = attr.typed.nType != CMarkupTypedValue::TYPE_NONE ? &attr.typed : NULL;
+				aAttributes[j].nNameId = aNameIds[attr.nName];
+			}
+			bOk = dom.SetAttributes(pNode, aAttributes, node.nAttributeCount);
+		}
+		free(pScratch);
+
+		if( !bOk ) {
+			dom.Release();
+			return false;
+		}
+		dom.EndBuild();
+		return true;
+	}
+
+} // namespace DuiLib
+
+#endif // __UISKINBINARY_H__
@@ -0,0 +1,210 @@
+#include "UITimerScheduler.h"
+
+namespace DuiLib {
+
+CTimerScheduler::CTimerScheduler() : m_nSeq(0), m_nPhase(0), m_nInterval(0)
+{
+}
+
+void CTimerScheduler::Set(void* pTarget, unsigned int nID, unsigned int nDue, unsigned int nPeriod)
+{
+    TKey key(pTarget, nID);
+    std::map<TKey, int>::iterator it = m_mapSlots.find(key);
+    int iSlot;
+    if( it != m_mapSlots.end() ) {
+        iSlot = it->second;
+        _RemoveFromHeap(iSlot);
+    }
+    else {
+        if( !m_aFreeSlots.empty() ) {
+            iSlot = m_aFreeSlots.back();
+            m_aFreeSlots.pop_back();
+        }
+        else {
+            iSlot = (int)m_aSlots.size();
+            m_aSlots.push_back(TSlot());
+        }
+        m_aSlots[iSlot].pTarget = pTarget;
+        m_aSlots[iSlot].nID = nID;
+        m_aSlots[iSlot].iHeap = -1;
+        m_mapSlots[key] = iSlot;
+    }
+    m_aSlots[iSlot].nDue = nDue;
+    m_aSlots[iSlot].nPeriod = nPeriod;
+    _Push(iSlot);
+}
+
+bool CTimerScheduler::Kill(void* pTarget, unsigned int nID)
+{
+    std::map<TKey, int>::iterator it = m_mapSlots.find(TKey(pTarget, nID));
+    if( it == m_mapSlots.end() ) return false;
+    int iSlot = it->second;
+    m_mapSlots.erase(it);
+    _RemoveFromHeap(iSlot);
+    _FreeSlot(iSlot);
+    return true;
+}
+
+int CTimerScheduler::KillAll(void* pTarget)
+{
+    // 同一个目标的定时器在 map 中相邻
+    int nCount = 0;
+    std::map<TKey, int>::iterator it = m_mapSlots.lower_bound(TKey(pTarget, 0));
+    while( it != m_mapSlots.end() && it->first.first == pTarget ) {
+        int iSlot = it->second;
+        m_mapSlots.erase(it++);
+        _RemoveFromHeap(iSlot);
+        _FreeSlot(iSlot);
+        nCount++;
+    }
+    return nCount;
+}
+
+void CTimerScheduler::Clear()
+{
+    m_mapSlots.clear();
+    m_aSlots.clear();
+    m_aFreeSlots.clear();
+    m_aHeap.clear();
+}
+
+bool CTimerScheduler::IsSet(void* pTarget, unsigned int nID) const
+{
+    return m_mapSlots.find(TKey(pTarget, nID)) != m_mapSlots.end();
+}
+
+int CTimerScheduler::GetCount() const
+{
+    return (int)m_aHeap.size();
+}
+
+void CTimerScheduler::SetFrameClock(unsigned int nPhase, unsigned int nInterval)
+{
+    m_nPhase = nPhase;
+    m_nInterval = nInterval;
+}
+
+unsigned int CTimerScheduler::GetFrameInterval() const
+{
+    return m_nInterval;
+}
+
+unsigned int CTimerScheduler::GetFrameStart(unsigned int nTime) const
+{
+    if( m_nInterval == 0 ) return nTime;
+    return nTime - (nTime - m_nPhase) % m_nInterval;
+}
+
+unsigned int CTimerScheduler::GetFrameEnd(unsigned int nTime) const
+{
+    if( m_nInterval == 0 ) return nTime;
+    unsigned int nOffset = (nTime - m_nPhase) % m_nInterval;
+    return nOffset == 0 ? nTime : nTime + (m_nInterval - nOffset);
+}
+
+bool CTimerScheduler::GetNextWake(unsigned int& nWake) const
+{
+    if( m_aHeap.empty() ) return false;
+    nWake = GetFrameEnd(m_aSlots[m_aHeap[0]].nDue);
+    return true;
+}
+
+unsigned int CTimerScheduler::Collect(unsigned int nNow, std::vector<TFired>& aFired)
+{
+    unsigned int nFrame = GetFrameStart(nNow);
+    m_aRepeat.clear();
+    while( !m_aHeap.empty() ) {
+        int iSlot = m_aHeap[0];
+        TSlot& slot = m_aSlots[iSlot];
+        if( (int)(nFrame - slot.nDue) < 0 ) break;
+        _RemoveFromHeap(iSlot);
+        TFired fired = { slot.pTarget, slot.nID };
+        aFired.push_back(fired);
+        if( slot.nPeriod != 0 ) {
+            m_aRepeat.push_back(iSlot);
+        }
+        else {
+            m_mapSlots.erase(TKey(slot.pTarget, slot.nID));
+            _FreeSlot(iSlot);
+        }
+    }
+    // 全部取出后再放回周期定时器，一帧里每个定时器最多触发一次
+    for( size_t i = 0; i < m_aRepeat.size(); i++ ) {
+        TSlot& slot = m_aSlots[m_aRepeat[i]];
+        slot.nDue += slot.nPeriod;
+        if( (int)(slot.nDue - nFrame) <= 0 ) slot.nDue = nFrame + slot.nPeriod;
+        _Push(m_aRepeat[i]);
+    }
+    return nFrame;
+}
+
+bool CTimerScheduler::_Before(int iSlotA, int iSlotB) const
+{
+    const TSlot& a = m_aSlots[iSlotA];
+    const TSlot& b = m_aSlots[iSlotB];
+    int nDiff = (int)(a.nDue - b.nDue);
+    if( nDiff != 0 ) return nDiff < 0;
+    return (int)(a.nSeq - b.nSeq) < 0;
+}
+
+void CTimerScheduler::_Place(int iHeap, int iSlot)
+{
+    m_aHeap[iHeap] = iSlot;
+    m_aSlots[iSlot].iHeap = iHeap;
+}
+
+void CTimerScheduler::_SiftUp(int iHeap)
+{
+    int iSlot = m_aHeap[iHeap];
+    while( iHeap > 0 ) {
+        int iParent = (iHeap - 1) / 2;
+        if( !_Before(iSlot, m_aHeap[iParent]) ) break;
+        _Place(iHeap, m_aHeap[iParent]);
+        iHeap = iParent;
+    }
+    _Place(iHeap, iSlot);
+}
+
+void CTimerScheduler::_SiftDown(int iHeap)
+{
+    int nSize = (int)m_aHeap.size();
+    int iSlot = m_aHeap[iHeap];
+    for( ;; ) {
+        int iChild = iHeap * 2 + 1;
+        if( iChild >= nSize ) break;
+        if( iChild + 1 < nSize && _Before(m_aHeap[iChild + 1], m_aHeap[iChild]) ) iChild++;
+        if( !_Before(m_aHeap[iChild], iSlot) ) break;
+        _Place(iHeap, m_aHeap[iChild]);
+        iHeap = iChild;
+    }
+    _Place(iHeap, iSlot);
+}
+
+void CTimerScheduler::_Push(int iSlot)
+{
+    m_aSlots[iSlot].nSeq = m_nSeq++;
+    m_aHeap.push_back(iSlot);
+    _SiftUp((int)m_aHeap.size() - 1);
+}
+
+void CTimerScheduler::_RemoveFromHeap(int iSlot)
+{
+    int iHeap = m_aSlots[iSlot].iHeap;
+    if( iHeap < 0 ) return;
+    m_aSlots[iSlot].iHeap = -1;
+    int iLast = m_aHeap.back();
+    m_aHeap.pop_back();
+    if( iLast == iSlot ) return;
+    _Place(iHeap, iLast);
+    if( iHeap > 0 && _Before(iLast, m_aHeap[(iHeap - 1) / 2]) ) _SiftUp(iHeap);
+    else _SiftDown(iHeap);
+}
+
+void CTimerScheduler::_FreeSlot(int iSlot)
+{
+    m_aSlots[iSlot].pTarget = NULL;
+    m_aSlots[iSlot].iHeap = -1;
+    m_aFreeSlots.push_back(iSlot);
+}
+
+} // namespace DuiLib
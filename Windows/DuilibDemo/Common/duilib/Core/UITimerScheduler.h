@@ -0,0 +1,89 @@
+#ifndef __UITIMERSCHEDULER_H__
+#define __UITIMERSCHEDULER_H__
+
+#pragma once
+
+// 定时器调度：一个窗口里所有控件的定时器和动画共用一个系统定时器。
+// 1. 定时器按 (目标, ID) 区分，可以是一次性的，也可以按周期重复；到期时间放在二叉堆里，
+//    设置、删除都是 O(log N)，删除一个目标的所有定时器是 O(k log N)；
+// 2. 帧时钟：到期的定时器在它之后的第一个帧边界触发，同一帧内到期的定时器一次取出，
+//    窗口只需要在下一个帧边界唤醒一次，动画在同一次绘制中更新；帧间隔为 0 时不对齐；
+// 3. 时间是回绕的毫秒计数（GetTickCount），按差值比较，待触发的定时器之间相差不超过 24 天。
+// 不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace DuiLib {
+
+	class CTimerScheduler
+	{
+	public:
+		struct TFired
+		{
+			void* pTarget;
+			unsigned int nID;
+		};
+
+	public:
+		CTimerScheduler();
+
+		// nPeriod 为 0 时只触发一次；同一个 (pTarget, nID) 已经存在时替换
+		void Set(void* pTarget, unsigned int nID, unsigned int nDue, unsigned int nPeriod);
+		bool Kill(void* pTarget, unsigned int nID);
+		// 返回删除的个数
+		int KillAll(void* pTarget);
+		void Clear();
+		bool IsSet(void* pTarget, unsigned int nID) const;
+		int GetCount() const;
+
+		// 帧边界为 nPhase + k * nInterval
+		void SetFrameClock(unsigned int nPhase, unsigned int nInterval);
+		unsigned int GetFrameInterval() const;
+		// nTime 所在的帧开始的时间，即不晚于 nTime 的最后一个帧边界
+		unsigned int GetFrameStart(unsigned int nTime) const;
+		// 不早于 nTime 的第一个帧边界
+		unsigned int GetFrameEnd(unsigned int nTime) const;
+
+		// 下一次需要唤醒的时间：最早的到期时间之后的第一个帧边界；没有定时器时返回 false
+		bool GetNextWake(unsigned int& nWake) const;
+		// 取出到 nNow 所在帧开始时已经到期的定时器，按到期时间和设置的先后排列，追加到 aFired；
+		// 周期定时器排到下一个周期，落后超过一个周期时不补触发。返回这一帧的时间，作为动画的时间戳
+		unsigned int Collect(unsigned int nNow, std::vector<TFired>& aFired);
+
+	private:
+		struct TSlot
+		{
+			void* pTarget;
+			unsigned int nID;
+			unsigned int nDue;
+			unsigned int nPeriod;
+			unsigned int nSeq;			// 到期时间相同时先设置的先触发
+			int iHeap;					// 在堆中的位置，空闲时为 -1
+		};
+		typedef std::pair<void*, unsigned int> TKey;
+
+		bool _Before(int iSlotA, int iSlotB) const;
+		void _Place(int iHeap, int iSlot);
+		void _SiftUp(int iHeap);
+		void _SiftDown(int iHeap);
+		void _Push(int iSlot);
+		void _RemoveFromHeap(int iSlot);
+		void _FreeSlot(int iSlot);
+
+	private:
+		std::map<TKey, int> m_mapSlots;
+		std::vector<TSlot> m_aSlots;
+		std::vector<int> m_aFreeSlots;
+		std::vector<int> m_aHeap;				// 小顶堆，元素为槽位下标
+		std::vector<int> m_aRepeat;
+		unsigned int m_nSeq;
+		unsigned int m_nPhase;
+		unsigned int m_nInterval;
+	};
+
+} // namespace DuiLib
+
+#endif // __UITIMERSCHEDULER_H__
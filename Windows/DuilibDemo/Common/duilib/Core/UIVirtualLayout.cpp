@@ -0,0 +1,289 @@
+#include "UIVirtualLayout.h"
+
+namespace DuiLib {
+
+CVirtualListLayout::CVirtualListLayout() : m_nCount(0), m_cyItem(0), m_cySpacing(0), m_bEstimated(false), m_nTotal(0)
+{
+}
+
+void CVirtualListLayout::Reset(int nCount)
+{
+    m_nCount = nCount > 0 ? nCount : 0;
+    m_aMeasured.assign(m_bEstimated ? m_nCount : 0, 0);
+    m_aHeights.assign(m_bEstimated ? m_nCount : 0, m_cyItem);
+    _Build();
+    ReleaseSlots();
+}
+
+int CVirtualListLayout::GetCount() const
+{
+    return m_nCount;
+}
+
+void CVirtualListLayout::SetItemHeight(int cy, bool bEstimated)
+{
+    if( cy < 0 ) cy = 0;
+    if( cy == m_cyItem && bEstimated == m_bEstimated ) return;
+    if( bEstimated ) {
+        if( !m_bEstimated ) {
+            m_aMeasured.assign(m_nCount, 0);
+            m_aHeights.assign(m_nCount, cy);
+        }
+        else {
+            // 测量过的行保留实际高度
+            for( int i = 0; i < m_nCount; i++ ) {
+                if( !m_aMeasured[i] ) m_aHeights[i] = cy;
+            }
+        }
+    }
+    else {
+        std::vector<int>().swap(m_aHeights);
+        std::vector<unsigned char>().swap(m_aMeasured);
+    }
+    m_cyItem = cy;
+    m_bEstimated = bEstimated;
+    _Build();
+}
+
+int CVirtualListLayout::GetItemHeight() const
+{
+    return m_cyItem;
+}
+
+bool CVirtualListLayout::IsEstimated() const
+{
+    return m_bEstimated;
+}
+
+void CVirtualListLayout::SetSpacing(int cySpacing)
+{
+    if( cySpacing < 0 ) cySpacing = 0;
+    if( cySpacing == m_cySpacing ) return;
+    m_cySpacing = cySpacing;
+    _Build();
+}
+
+int CVirtualListLayout::GetSpacing() const
+{
+    return m_cySpacing;
+}
+
+bool CVirtualListLayout::SetRowHeight(int iIndex, int cy)
+{
+    if( !m_bEstimated || iIndex < 0 || iIndex >= m_nCount ) return false;
+    if( cy < 0 ) cy = 0;
+    m_aMeasured[iIndex] = 1;
+    int nDelta = cy - m_aHeights[iIndex];
+    if( nDelta == 0 ) return false;
+    m_aHeights[iIndex] = cy;
+    _Add(iIndex, nDelta);
+    m_nTotal += nDelta;
+    return true;
+}
+
+int CVirtualListLayout::GetRowHeight(int iIndex) const
+{
+    if( iIndex < 0 || iIndex >= m_nCount ) return 0;
+    return m_bEstimated ? m_aHeights[iIndex] : m_cyItem;
+}
+
+bool CVirtualListLayout::IsRowMeasured(int iIndex) const
+{
+    if( iIndex < 0 || iIndex >= m_nCount ) return false;
+    return !m_bEstimated || m_aMeasured[iIndex] != 0;
+}
+
+int CVirtualListLayout::GetRowTop(int iIndex) const
+{
+    if( iIndex <= 0 ) return 0;
+    if( iIndex > m_nCount ) iIndex = m_nCount;
+    if( !m_bEstimated ) return iIndex * (m_cyItem + m_cySpacing);
+    return _Prefix(iIndex);
+}
+
+int CVirtualListLayout::GetTotalHeight() const
+{
+    if( m_nCount == 0 ) return 0;
+    return m_nTotal - m_cySpacing;
+}
+
+int CVirtualListLayout::HitTest(int y) const
+{
+    if( y < 0 || y >= GetTotalHeight() ) return -1;
+    if( !m_bEstimated ) {
+        int cyExtent = m_cyItem + m_cySpacing;
+        if( cyExtent <= 0 ) return 0;
+        int iIndex = y / cyExtent;
+        return iIndex < m_nCount ? iIndex : m_nCount - 1;
+    }
+    // 在树状数组上二分：找出前缀和不超过 y 的最多行数
+    int nPos = 0;
+    int nStep = 1;
+    while( nStep * 2 <= m_nCount ) nStep *= 2;
+    for( ; nStep > 0; nStep /= 2 ) {
+        int nNext = nPos + nStep;
+        if( nNext <= m_nCount && m_aTree[nNext] <= y ) {
+            nPos = nNext;
+            y -= m_aTree[nNext];
+        }
+    }
+    return nPos < m_nCount ? nPos : m_nCount - 1;
+}
+
+void CVirtualListLayout::GetVisibleRange(int nScrollPos, int cyViewport, int& iFirst, int& iLast) const
+{
+    iFirst = iLast = -1;
+    int cyTotal = GetTotalHeight();
+    if( m_nCount == 0 || cyViewport <= 0 || cyTotal <= 0 ) return;
+    if( nScrollPos < 0 ) nScrollPos = 0;
+    if( nScrollPos >= cyTotal ) return;
+    int nBottom = nScrollPos + cyViewport - 1;
+    if( nBottom >= cyTotal ) nBottom = cyTotal - 1;
+
+    iFirst = HitTest(nScrollPos);
+    // 落在间距里时，上面一行已经完全滚出视口
+    if( GetRowTop(iFirst) + GetRowHeight(iFirst) <= nScrollPos && iFirst + 1 < m_nCount ) iFirst++;
+    iLast = HitTest(nBottom);
+    if( iLast < iFirst ) iLast = iFirst;
+}
+
+int CVirtualListLayout::GetScrollPosToShow(int iIndex, int nScrollPos, int cyViewport) const
+{
+    if( iIndex < 0 || iIndex >= m_nCount ) return nScrollPos;
+    int nTop = GetRowTop(iIndex);
+    int nBottom = nTop + GetRowHeight(iIndex);
+    int nPos = nScrollPos;
+    if( nTop < nScrollPos || nBottom - nTop > cyViewport ) nPos = nTop;
+    else if( nBottom > nScrollPos + cyViewport ) nPos = nBottom - cyViewport;
+    int nMax = GetTotalHeight() - cyViewport;
+    if( nPos > nMax ) nPos = nMax;
+    if( nPos < 0 ) nPos = 0;
+    return nPos;
+}
+
+void CVirtualListLayout::InsertRows(int iIndex, int nCount)
+{
+    if( nCount <= 0 ) return;
+    if( iIndex < 0 ) iIndex = 0;
+    if( iIndex > m_nCount ) iIndex = m_nCount;
+    m_nCount += nCount;
+    if( m_bEstimated ) {
+        m_aHeights.insert(m_aHeights.begin() + iIndex, nCount, m_cyItem);
+        m_aMeasured.insert(m_aMeasured.begin() + iIndex, nCount, 0);
+    }
+    _Build();
+    ReleaseSlots();
+}
+
+void CVirtualListLayout::RemoveRows(int iIndex, int nCount)
+{
+    if( iIndex < 0 || iIndex >= m_nCount || nCount <= 0 ) return;
+    if( nCount > m_nCount - iIndex ) nCount = m_nCount - iIndex;
+    m_nCount -= nCount;
+    if( m_bEstimated ) {
+        m_aHeights.erase(m_aHeights.begin() + iIndex, m_aHeights.begin() + iIndex + nCount);
+        m_aMeasured.erase(m_aMeasured.begin() + iIndex, m_aMeasured.begin() + iIndex + nCount);
+    }
+    _Build();
+    ReleaseSlots();
+}
+
+void CVirtualListLayout::AssignSlots(int iFirst, int iLast, std::vector<int>& aRebind)
+{
+    aRebind.clear();
+    if( iFirst < 0 || iLast < iFirst ) {
+        ReleaseSlots();
+        return;
+    }
+    // m_aScratch[i - iFirst] 为第 i 行已经占用的槽位
+    int nRows = iLast - iFirst + 1;
+    m_aScratch.assign(nRows, -1);
+    std::vector<int> aFree;
+    for( int i = 0; i < (int)m_aSlotRows.size(); i++ ) {
+        int iRow = m_aSlotRows[i];
+        if( iRow >= iFirst && iRow <= iLast && m_aScratch[iRow - iFirst] < 0 ) {
+            m_aScratch[iRow - iFirst] = i;
+        }
+        else {
+            m_aSlotRows[i] = -1;
+            aFree.push_back(i);
+        }
+    }
+    size_t nNextFree = 0;
+    for( int iRow = iFirst; iRow <= iLast; iRow++ ) {
+        if( m_aScratch[iRow - iFirst] >= 0 ) continue;
+        int iSlot;
+        if( nNextFree < aFree.size() ) {
+            iSlot = aFree[nNextFree++];
+        }
+        else {
+            iSlot = (int)m_aSlotRows.size();
+            m_aSlotRows.push_back(-1);
+        }
+        m_aSlotRows[iSlot] = iRow;
+        m_aScratch[iRow - iFirst] = iSlot;
+        aRebind.push_back(iSlot);
+    }
+}
+
+void CVirtualListLayout::ReleaseSlots()
+{
+    for( size_t i = 0; i < m_aSlotRows.size(); i++ ) m_aSlotRows[i] = -1;
+}
+
+int CVirtualListLayout::GetSlotCount() const
+{
+    return (int)m_aSlotRows.size();
+}
+
+int CVirtualListLayout::GetSlotRow(int iSlot) const
+{
+    if( iSlot < 0 || iSlot >= (int)m_aSlotRows.size() ) return -1;
+    return m_aSlotRows[iSlot];
+}
+
+int CVirtualListLayout::FindSlot(int iIndex) const
+{
+    if( iIndex < 0 ) return -1;
+    // 槽位数和视口内的行数相当，直接查找
+    for( size_t i = 0; i < m_aSlotRows.size(); i++ ) {
+        if( m_aSlotRows[i] == iIndex ) return (int)i;
+    }
+    return -1;
+}
+
+int CVirtualListLayout::_Extent(int iIndex) const
+{
+    return (m_bEstimated ? m_aHeights[iIndex] : m_cyItem) + m_cySpacing;
+}
+
+void CVirtualListLayout::_Build()
+{
+    m_nTotal = 0;
+    if( !m_bEstimated ) {
+        std::vector<int>().swap(m_aTree);
+        m_nTotal = m_nCount * (m_cyItem + m_cySpacing);
+        return;
+    }
+    m_aTree.assign(m_nCount + 1, 0);
+    for( int i = 1; i <= m_nCount; i++ ) {
+        m_aTree[i] += _Extent(i - 1);
+        m_nTotal += _Extent(i - 1);
+        int iParent = i + (i & -i);
+        if( iParent <= m_nCount ) m_aTree[iParent] += m_aTree[i];
+    }
+}
+
+void CVirtualListLayout::_Add(int iIndex, int nDelta)
+{
+    for( int i = iIndex + 1; i <= m_nCount; i += i & -i ) m_aTree[i] += nDelta;
+}
+
+int CVirtualListLayout::_Prefix(int nRows) const
+{
+    int nSum = 0;
+    for( int i = nRows; i > 0; i -= i & -i ) nSum += m_aTree[i];
+    return nSum;
+}
+
+} // namespace DuiLib
@@ -0,0 +1,83 @@
+#ifndef __UIVIRTUALLAYOUT_H__
+#define __UIVIRTUALLAYOUT_H__
+
+#pragma once
+
+// 虚拟列表的行布局：列表只为视口内的行创建列表项，这里记录每一行的高度和位置。
+// 1. 固定行高时行的位置直接计算；估计行高时未测量的行按估计值算，测量过的行用实际高度，
+//    行高的前缀和放在树状数组里，修改行高、求行的位置、按纵坐标找行都是 O(log N)；
+// 2. 槽位对应列表中复用的列表项，滚动时把离开视口的槽位分给新进入视口的行。
+// 不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <vector>
+
+namespace DuiLib {
+
+	class CVirtualListLayout
+	{
+	public:
+		CVirtualListLayout();
+
+		// 设置行数，所有行回到估计高度，所有槽位变为空闲
+		void Reset(int nCount);
+		int GetCount() const;
+		// bEstimated 为 false 时所有行都是 cy 高；为 true 时 cy 是未测量的行的高度
+		void SetItemHeight(int cy, bool bEstimated);
+		int GetItemHeight() const;
+		bool IsEstimated() const;
+		// 行与行之间的间距
+		void SetSpacing(int cySpacing);
+		int GetSpacing() const;
+
+		// 估计行高时记录测量到的高度，返回行高是否改变；固定行高时忽略
+		bool SetRowHeight(int iIndex, int cy);
+		int GetRowHeight(int iIndex) const;
+		bool IsRowMeasured(int iIndex) const;
+
+		// 第 iIndex 行顶部到第一行顶部的距离，iIndex 可以等于行数
+		int GetRowTop(int iIndex) const;
+		int GetTotalHeight() const;
+		// 纵坐标 y 所在的行，落在间距里时返回间距上面的行；y 超出范围时返回 -1
+		int HitTest(int y) const;
+		// 滚动位置为 nScrollPos、视口高 cyViewport 时能看到的行，没有时都为 -1
+		void GetVisibleRange(int nScrollPos, int cyViewport, int& iFirst, int& iLast) const;
+		// 让第 iIndex 行完整显示需要的最小滚动位置
+		int GetScrollPosToShow(int iIndex, int nScrollPos, int cyViewport) const;
+
+		// 在 iIndex 前插入或删除行，保留其他行测量过的高度；所有槽位变为空闲
+		void InsertRows(int iIndex, int nCount);
+		void RemoveRows(int iIndex, int nCount);
+
+		// 为 [iFirst, iLast] 中的行分配槽位：已经显示的行保留原来的槽位，离开的槽位分给新进入的行，
+		// 不够时增加槽位。aRebind 返回需要重新绑定数据的槽位。iFirst 为 -1 时所有槽位变为空闲
+		void AssignSlots(int iFirst, int iLast, std::vector<int>& aRebind);
+		void ReleaseSlots();
+		int GetSlotCount() const;
+		// 槽位当前显示的行，空闲时为 -1
+		int GetSlotRow(int iSlot) const;
+		// 行所在的槽位，没有显示时为 -1
+		int FindSlot(int iIndex) const;
+
+	private:
+		int _Extent(int iIndex) const;
+		void _Build();
+		void _Add(int iIndex, int nDelta);
+		int _Prefix(int nRows) const;
+
+	private:
+		int m_nCount;
+		int m_cyItem;
+		int m_cySpacing;
+		bool m_bEstimated;
+		int m_nTotal;							// 所有行高加上行数个间距
+		std::vector<int> m_aHeights;			// 仅估计行高时使用
+		std::vector<unsigned char> m_aMeasured;
+		std::vector<int> m_aTree;				// 树状数组，下标从 1 开始，每行的值为行高加间距
+		std::vector<int> m_aSlotRows;
+		std::vector<int> m_aScratch;
+	};
+
+} // namespace DuiLib
+
+#endif // __UIVIRTUALLAYOUT_H__
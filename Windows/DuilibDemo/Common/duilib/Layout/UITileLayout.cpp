@@ -78,107 +78,13 @@ namespace DuiLib
 		if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() ) rc.bottom -= m_pHorizontalScrollBar->GetFixedHeight();
 
 		// Position the elements
-		if( m_szItem.cx > 0 ) m_nColumns = (rc.right - rc.left) / m_szItem.cx;
-		if( m_nColumns == 0 ) m_nColumns = 1;
-
-		int cyNeeded = 0;
-		int cxWidth = (rc.right - rc.left) / m_nColumns;
-		if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() ) 
-			cxWidth = (rc.right - rc.left + m_pHorizontalScrollBar->GetScrollRange() ) / m_nColumns; ;
-
-		int cyHeight = 0;
-		int iCount = 0;
-		POINT ptTile = { rc.left, rc.top };
-		if( m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible() ) {
-			ptTile.y -= m_pVerticalScrollBar->GetScrollPos();
-		}
-		int iPosX = rc.left;
-		if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() ) {
-			iPosX -= m_pHorizontalScrollBar->GetScrollPos();
-			ptTile.x = iPosX;
-		}
-		for( int it1 = 0; it1 < m_items.GetSize(); it1++ ) {
-			CControlUI* pControl = static_cast<CControlUI*>(m_items[it1]);
-			if( !pControl->IsVisible() ) continue;
-			if( pControl->IsFloat() ) {
-				SetFloatPos(it1);
-				continue;
-			}
-
-			// Determine size
-			RECT rcTile = { ptTile.x, ptTile.y, ptTile.x + cxWidth, ptTile.y };
-			if( (iCount % m_nColumns) == 0 )
-			{
-				int iIndex = iCount;
-				for( int it2 = it1; it2 < m_items.GetSize(); it2++ ) {
-					CControlUI* pLineControl = static_cast<CControlUI*>(m_items[it2]);
-					if( !pLineControl->IsVisible() ) continue;
-					if( pLineControl->IsFloat() ) continue;
-
-					RECT rcPadding = pLineControl->GetPadding();
-					SIZE szAvailable = { rcTile.right - rcTile.left - rcPadding.left - rcPadding.right, 9999 };
-					if( iIndex == iCount || (iIndex + 1) % m_nColumns == 0 ) {
-						szAvailable.cx -= m_iChildPadding / 2;
-					}
-					else {
-						szAvailable.cx -= m_iChildPadding;
-					}
-
-					if( szAvailable.cx < pControl->GetMinWidth() ) szAvailable.cx = pControl->GetMinWidth();
-					if( szAvailable.cx > pControl->GetMaxWidth() ) szAvailable.cx = pControl->GetMaxWidth();
-
-					SIZE szTile = pLineControl->EstimateSize(szAvailable);
-					if( szTile.cx < pControl->GetMinWidth() ) szTile.cx = pControl->GetMinWidth();
-					if( szTile.cx > pControl->GetMaxWidth() ) szTile.cx = pControl->GetMaxWidth();
-					if( szTile.cy < pControl->GetMinHeight() ) szTile.cy = pControl->GetMinHeight();
-					if( szTile.cy > pControl->GetMaxHeight() ) szTile.cy = pControl->GetMaxHeight();
-
-					cyHeight = MAX(cyHeight, szTile.cy + rcPadding.top + rcPadding.bottom);
-					if( (++iIndex % m_nColumns) == 0) break;
-				}
-			}
-
-			RECT rcPadding = pControl->GetPadding();
-
-			rcTile.left += rcPadding.left + m_iChildPadding / 2;
-			rcTile.right -= rcPadding.right + m_iChildPadding / 2;
-			if( (iCount % m_nColumns) == 0 ) {
-				rcTile.left -= m_iChildPadding / 2;
-			}
-
-			if( ( (iCount + 1) % m_nColumns) == 0 ) {
-				rcTile.right += m_iChildPadding / 2;
-			}
-
-			// Set position
-			rcTile.top = ptTile.y + rcPadding.top;
-			rcTile.bottom = ptTile.y + cyHeight;
-
-			SIZE szAvailable = { rcTile.right - rcTile.left, rcTile.bottom - rcTile.top };
-			SIZE szTile = pControl->EstimateSize(szAvailable);
-			if( szTile.cx == 0 ) szTile.cx = szAvailable.cx;
-			if( szTile.cy == 0 ) szTile.cy = szAvailable.cy;
-			if( szTile.cx < pControl->GetMinWidth() ) szTile.cx = pControl->GetMinWidth();
-			if( szTile.cx > pControl->GetMaxWidth() ) szTile.cx = pControl->GetMaxWidth();
-			if( szTile.cy < pControl->GetMinHeight() ) szTile.cy = pControl->GetMinHeight();
-			if( szTile.cy > pControl->GetMaxHeight() ) szTile.cy = pControl->GetMaxHeight();
-			RECT rcPos = {(rcTile.left + rcTile.right - szTile.cx) / 2, (rcTile.top + rcTile.bottom - szTile.cy) / 2,
-				(rcTile.left + rcTile.right - szTile.cx) / 2 + szTile.cx, (rcTile.top + rcTile.bottom - szTile.cy) / 2 + szTile.cy};
-			pControl->SetPos(rcPos);
-
-			if( (++iCount % m_nColumns) == 0 ) {
-				ptTile.x = iPosX;
-				ptTile.y += cyHeight + m_iChildPadding;
-				cyHeight = 0;
-			}
-			else {
-				ptTile.x += cxWidth;
-			}
-			cyNeeded = rcTile.bottom - rc.top;
-			if( m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible() ) cyNeeded += m_pVerticalScrollBar->GetScrollPos();
-		}
+		PrepareLayoutItems();
+		TLayoutBox box = GetLayoutBox(rc);
+		TLayoutSize szItem = { m_szItem.cx, m_szItem.cy };
+		TLayoutSize szNeeded = CLayoutEngine::ArrangeTile(box, szItem, m_nColumns, m_aLayoutItems, GetLayoutMeasure());
+		ApplyLayoutItems(true);
 
 		// Process the scrollbar
-		ProcessScrollBar(rc, 0, cyNeeded);
+		ProcessScrollBar(rc, 0, szNeeded.cy);
 	}
 }
@@ -47,9 +47,23 @@
 
 #include "Utils/Utils.h"
 #include "Utils/unzip.h"
+#include "../util/ZipResource.h"
 #include "Utils/VersionHelpers.h"
+#include "Core/UIMarkupDom.h"
+#include "Core/UISkinBinary.h"
+#include "Core/UIPixelConvert.h"
+#include "Core/UIFrameBuffer.h"
+#include "Core/UIImagePreload.h"
+#include "Core/UIImageCache.h"
+#include "Core/UIDirtyRegion.h"
+#include "Core/UIVirtualLayout.h"
+#include "Core/UILayoutEngine.h"
+#include "Core/UIGifFrames.h"
+#include "Core/UITimerScheduler.h"
+#include "Core/UIHtmlText.h"
 #include "Core/UIMarkup.h"
 #include "Utils/observer_impl_base.h"
+#include "Utils/UIShadowRenderer.h"
 #include "Utils/UIShadow.h"
 #include "Utils/UIDelegate.h"
 #include "Utils/DragDropImpl.h"
@@ -103,6 +103,9 @@ protected:
 	// 图片阴影成员变量
 	CDuiString	m_sShadowImage;
 	RECT		m_rcShadowCorner;
+
+	// 算法阴影的生成和九宫格缓存
+	CShadowRenderer m_Renderer;
 };
 
 }
@@ -0,0 +1,377 @@
+#include "UIShadowRenderer.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace DuiLib
+{
+
+namespace
+{
+
+inline int Min(int a, int b) { return a < b ? a : b; }
+inline int Max(int a, int b) { return a > b ? a : b; }
+inline int Abs(int a) { return a < 0 ? -a : a; }
+
+inline bool IsEmptySpan(const CShadowRenderer::Span& span)
+{
+	return span.left >= span.right;
+}
+
+inline bool IsSameSpan(const CShadowRenderer::Span& a, const CShadowRenderer::Span& b)
+{
+	if(IsEmptySpan(a) || IsEmptySpan(b))
+		return IsEmptySpan(a) && IsEmptySpan(b);
+	return a.left == b.left && a.right == b.right;
+}
+
+inline int Sharpness(const CShadowRenderer::Params& params)
+{
+	return Max(params.nSharpness, 0);
+}
+
+// 锥形核的半径，阴影从形状向外延伸这么远
+inline int KernelRadius(const CShadowRenderer::Params& params)
+{
+	return Max(params.nSize, Sharpness(params));
+}
+
+// 核中心不衰减的半径
+inline int CenterRadius(const CShadowRenderer::Params& params)
+{
+	return Max(params.nSize - Sharpness(params), 0);
+}
+
+// 形状先收缩的像素，收缩是方形的：每行取上下各这么多行的交集，再向内收缩
+inline int ErodeSize(const CShadowRenderer::Params& params)
+{
+	return Max(Sharpness(params) - params.nSize, 0);
+}
+
+// 像素到 [left, right) 的水平距离
+inline int SpanDistance(const CShadowRenderer::Span& span, int x)
+{
+	return x < span.left ? span.left - x : (x >= span.right ? x - span.right + 1 : 0);
+}
+
+struct NinePatch
+{
+	int lx;		// 各行左边缘最靠右的位置
+	int rx;		// 各行右边缘离右侧最远的距离
+	int ty;		// 顶部和底部与中间行不同的行数
+	int by;
+	int ex;		// 拉伸的列、行两侧需要保持不变的宽度
+	int ey;
+	int px;		// 缓存的父窗体大小
+	int py;
+};
+
+bool GetNinePatch(const CShadowRenderer::Params& params, const CShadowRenderer::Span* aSpans, int cx, int cy, NinePatch& np)
+{
+	const CShadowRenderer::Span& mid = aSpans[cy / 2];
+	int nTop = cy / 2;
+	while(nTop > 0 && IsSameSpan(aSpans[nTop - 1], mid))
+		nTop--;
+	int nBottom = cy / 2 + 1;
+	while(nBottom < cy && IsSameSpan(aSpans[nBottom], mid))
+		nBottom++;
+
+	bool bAny = false;
+	int nMaxLeft = 0, nMinRight = cx;
+	for(int y = 0; y < cy; y++)
+	{
+		if(IsEmptySpan(aSpans[y])) continue;
+		bAny = true;
+		nMaxLeft = Max(nMaxLeft, aSpans[y].left);
+		nMinRight = Min(nMinRight, aSpans[y].right);
+	}
+	if(!bAny || nMaxLeft >= nMinRight) return false;
+
+	int nErode = ErodeSize(params);
+	np.lx = nMaxLeft;
+	np.rx = cx - nMinRight;
+	np.ty = nTop;
+	np.by = cy - nBottom;
+	// 收缩后所有行都盖住中间的列，这些列到各行的水平距离都是 0；垂直方向收缩和核都会让角影响到中间的行
+	np.ex = nErode + Abs(params.nXOffset);
+	np.ey = nErode + KernelRadius(params) + Abs(params.nYOffset);
+	np.px = np.lx + np.rx + 2 * np.ex + 1;
+	np.py = np.ty + np.by + 2 * np.ey + 1;
+	if(np.px > cx || np.py > cy) return false;
+
+	// 拉伸的列和行必须落在缓存的阴影里
+	int nStretchX = params.nSize + np.lx + np.ex;
+	int nStretchY = params.nSize + np.ty + np.ey;
+	if(nStretchX < 0 || nStretchX >= np.px + 2 * params.nSize) return false;
+	if(nStretchY < 0 || nStretchY >= np.py + 2 * params.nSize) return false;
+	return true;
+}
+
+void AppendSpanKey(std::vector<int>& aKey, const CShadowRenderer::Span& span, int cx)
+{
+	bool bEmpty = IsEmptySpan(span);
+	aKey.push_back(bEmpty ? 0 : 1);
+	aKey.push_back(bEmpty ? 0 : span.left);
+	aKey.push_back(bEmpty ? 0 : span.right - cx);
+}
+
+}
+
+CShadowRenderer::CShadowRenderer()
+: m_nCacheWidth(0)
+, m_nCacheHeight(0)
+, m_nStretchX(0)
+, m_nStretchY(0)
+{
+	m_stats.nRenders = 0;
+	m_stats.nCacheHits = 0;
+}
+
+void CShadowRenderer::RenderDirect(const Params& params, const Span* aSpans, int cx, int cy, unsigned int* pDst, ptrdiff_t nPitch)
+{
+	int nWidth = cx + 2 * params.nSize;
+	int nHeight = cy + 2 * params.nSize;
+	if(cx <= 0 || cy <= 0 || nWidth <= 0 || nHeight <= 0) return;
+
+	int nRadius = KernelRadius(params);
+	int nCenter = CenterRadius(params);
+	int nErode = ErodeSize(params);
+
+	// 收缩后的形状，阴影坐标；上下各多放 nRadius + 1 个空行，省去边界判断
+	int nPad = nRadius + 1;
+	Span empty = { 0, 0 };
+	std::vector<Span> aCore(nHeight + 2 * nPad, empty);
+	for(int y = 0; y < nHeight; y++)
+	{
+		int yParent = y - params.nSize;
+		if(yParent - nErode < 0 || yParent + nErode >= cy) continue;
+		int nLeft = aSpans[yParent - nErode].left, nRight = aSpans[yParent - nErode].right;
+		for(int k = yParent - nErode + 1; k <= yParent + nErode; k++)
+		{
+			nLeft = Max(nLeft, aSpans[k].left);
+			nRight = Min(nRight, aSpans[k].right);
+		}
+		if(nLeft + nErode >= nRight - nErode) continue;
+		aCore[y + nPad].left = nLeft + nErode + params.nSize;
+		aCore[y + nPad].right = nRight - nErode + params.nSize;
+	}
+	// aRun[i]：到第 i 行为止连续相同的行数
+	std::vector<int> aRun(aCore.size(), 1);
+	for(size_t i = 1; i < aCore.size(); i++)
+	{
+		if(IsSameSpan(aCore[i], aCore[i - 1]))
+			aRun[i] = aRun[i - 1] + 1;
+	}
+
+	// 原来的锥形核按距离的平方查表：中心半径以内不衰减，之后在 nSharpness + 1 的宽度内线性衰减
+	int nDarkness = Min(Max(params.nDarkness, 0), 255);
+	std::vector<unsigned int> aColors(nRadius * nRadius + 1);
+	for(int i = 0; i <= nRadius * nRadius; i++)
+	{
+		double dLength = sqrt(static_cast<double>(i));
+		unsigned int a = dLength < nCenter ? static_cast<unsigned int>(nDarkness) :
+			static_cast<unsigned int>((1 - (dLength - nCenter) / (Sharpness(params) + 1)) * nDarkness);
+		unsigned int r = ((params.dwColor >> 16) & 0xFF) * a / 255;
+		unsigned int g = ((params.dwColor >> 8) & 0xFF) * a / 255;
+		unsigned int b = (params.dwColor & 0xFF) * a / 255;
+		aColors[i] = a << 24 | r << 16 | g << 8 | b;
+	}
+
+	int nLastStart = 0, nLastEnd = 0;
+	for(int y = 0; y < nHeight; y++)
+	{
+		// 父窗体盖住的部分不画阴影
+		int nStart = 0, nEnd = 0;
+		int yParent = y - params.nSize + params.nYOffset;
+		if(yParent >= 0 && yParent < cy && !IsEmptySpan(aSpans[yParent]))
+		{
+			nStart = Max(aSpans[yParent].left + params.nSize - params.nXOffset, 0);
+			nEnd = Min(aSpans[yParent].right + params.nSize - params.nXOffset, nWidth);
+		}
+		if(nStart >= nEnd)
+			nStart = nEnd = 0;
+
+		// 上下 nRadius 行的形状和上一行看到的完全相同时，这一行与上一行相同，直接复制
+		unsigned int* pLine = pDst + y * nPitch;
+		const Span* pWindow = &aCore[y + nPad - nRadius];
+		if(y > 0 && aRun[y + nPad + nRadius] >= 2 * nRadius + 2 && nStart == nLastStart && nEnd == nLastEnd)
+		{
+			memcpy(pLine, pLine - nPitch, nWidth * sizeof(unsigned int));
+			continue;
+		}
+		nLastStart = nStart;
+		nLastEnd = nEnd;
+
+		// 只有离某一行的形状不超过 nRadius 的列才可能有阴影；附近各行都盖住的列，距离就是到最近一行的行距
+		int nLo = nWidth, nHi = 0;
+		int nInnerLeft = 0, nInnerRight = nWidth, nNearest = nRadius * nRadius + 1;
+		for(int k = 0; k <= 2 * nRadius; k++)
+		{
+			if(IsEmptySpan(pWindow[k])) continue;
+			nLo = Min(nLo, pWindow[k].left - nRadius);
+			nHi = Max(nHi, pWindow[k].right + nRadius);
+			nInnerLeft = Max(nInnerLeft, pWindow[k].left);
+			nInnerRight = Min(nInnerRight, pWindow[k].right);
+			nNearest = Min(nNearest, (k - nRadius) * (k - nRadius));
+		}
+		nLo = Max(nLo, 0);
+		nHi = Min(nHi, nWidth);
+		unsigned int dwInner = nNearest <= nRadius * nRadius ? aColors[nNearest] : 0;
+		for(int x = 0; x < nWidth; x++)
+		{
+			if(x < nLo || x >= nHi)
+			{
+				pLine[x] = 0;
+				continue;
+			}
+			if(x >= nInnerLeft && x < nInnerRight)
+			{
+				pLine[x] = dwInner;
+				continue;
+			}
+			int nBest = nRadius * nRadius + 1;
+			for(int k = 0; k <= 2 * nRadius; k++)
+			{
+				if(IsEmptySpan(pWindow[k])) continue;
+				int dx = SpanDistance(pWindow[k], x);
+				int d2 = dx * dx + (k - nRadius) * (k - nRadius);
+				if(d2 < nBest) nBest = d2;
+			}
+			pLine[x] = nBest <= nRadius * nRadius ? aColors[nBest] : 0;
+		}
+		for(int x = nStart; x < nEnd; x++)
+			pLine[x] = 0;
+	}
+}
+
+void CShadowRenderer::Render(const Params& params, const Span* aSpans, int cx, int cy, unsigned int* pDst, ptrdiff_t nPitch)
+{
+	int nWidth = cx + 2 * params.nSize;
+	int nHeight = cy + 2 * params.nSize;
+	if(cx <= 0 || cy <= 0 || nWidth <= 0 || nHeight <= 0) return;
+	m_stats.nRenders++;
+
+	NinePatch np;
+	if(!GetNinePatch(params, aSpans, cx, cy, np))
+	{
+		RenderDirect(params, aSpans, cx, cy, pDst, nPitch);
+		return;
+	}
+
+	// 参数和四个角的形状都相同时缓存的阴影可以直接拉伸
+	std::vector<int> aKey;
+	aKey.reserve(10 + 3 * (np.ty + np.by + 1));
+	aKey.push_back(params.nSize);
+	aKey.push_back(params.nSharpness);
+	aKey.push_back(params.nDarkness);
+	aKey.push_back(params.nXOffset);
+	aKey.push_back(params.nYOffset);
+	aKey.push_back(static_cast<int>(params.dwColor));
+	aKey.push_back(np.lx);
+	aKey.push_back(np.rx);
+	aKey.push_back(np.ty);
+	aKey.push_back(np.by);
+	for(int y = 0; y < np.ty; y++)
+		AppendSpanKey(aKey, aSpans[y], cx);
+	for(int y = cy - np.by; y < cy; y++)
+		AppendSpanKey(aKey, aSpans[y], cx);
+	AppendSpanKey(aKey, aSpans[cy / 2], cx);
+
+	if(aKey != m_aCacheKey)
+	{
+		// 按最小尺寸的父窗体生成：保留四个角，中间的行和列各剩下 2 * ex + 1、2 * ey + 1 个
+		std::vector<Span> aProxy(np.py);
+		for(int y = 0; y < np.py; y++)
+		{
+			const Span& span = y < np.ty ? aSpans[y] :
+				(y >= np.py - np.by ? aSpans[y - np.py + cy] : aSpans[cy / 2]);
+			aProxy[y] = span;
+			if(!IsEmptySpan(span))
+				aProxy[y].right = span.right - cx + np.px;
+		}
+		m_nCacheWidth = np.px + 2 * params.nSize;
+		m_nCacheHeight = np.py + 2 * params.nSize;
+		m_nStretchX = params.nSize + np.lx + np.ex;
+		m_nStretchY = params.nSize + np.ty + np.ey;
+		m_aCache.assign(static_cast<size_t>(m_nCacheWidth) * m_nCacheHeight, 0);
+		RenderDirect(params, &aProxy[0], np.px, np.py, &m_aCache[0], m_nCacheWidth);
+		m_aCacheKey.swap(aKey);
+	}
+	else
+	{
+		m_stats.nCacheHits++;
+	}
+
+	int nExtraX = nWidth - m_nCacheWidth;
+	int nExtraY = nHeight - m_nCacheHeight;
+	for(int y = 0; y < nHeight; y++)
+	{
+		unsigned int* pLine = pDst + y * nPitch;
+		if(y > m_nStretchY && y <= m_nStretchY + nExtraY)
+		{
+			// 中间拉伸的行都相同
+			memcpy(pLine, pDst + m_nStretchY * nPitch, nWidth * sizeof(unsigned int));
+			continue;
+		}
+		int ySrc = y <= m_nStretchY ? y : y - nExtraY;
+		const unsigned int* pSrc = &m_aCache[static_cast<size_t>(ySrc) * m_nCacheWidth];
+		memcpy(pLine, pSrc, m_nStretchX * sizeof(unsigned int));
+		unsigned int dwStretch = pSrc[m_nStretchX];
+		for(int x = m_nStretchX; x <= m_nStretchX + nExtraX; x++)
+			pLine[x] = dwStretch;
+		memcpy(pLine + m_nStretchX + nExtraX + 1, pSrc + m_nStretchX + 1,
+			(m_nCacheWidth - m_nStretchX - 1) * sizeof(unsigned int));
+	}
+}
+
+void CShadowRenderer::ClearCache()
+{
+	m_aCacheKey.clear();
+	m_aCache.clear();
+}
+
+CShadowRenderer::Stats CShadowRenderer::GetStats() const
+{
+	return m_stats;
+}
+
+void CShadowRenderer::SpansFromRects(const long* pRects, int nRects, int cx, int cy, std::vector<Span>& aSpans)
+{
+	Span empty = { cx, 0 };
+	aSpans.assign(Max(cy, 0), empty);
+	for(int i = 0; i < nRects; i++)
+	{
+		const long* pRect = pRects + i * 4;
+		int nLeft = Max(static_cast<int>(pRect[0]), 0);
+		int nRight = Min(static_cast<int>(pRect[2]), cx);
+		if(nLeft >= nRight) continue;
+		for(int y = Max(static_cast<int>(pRect[1]), 0); y < Min(static_cast<int>(pRect[3]), cy); y++)
+		{
+			aSpans[y].left = Min(aSpans[y].left, nLeft);
+			aSpans[y].right = Max(aSpans[y].right, nRight);
+		}
+	}
+}
+
+void CShadowRenderer::SpansFromAlpha(const unsigned int* pPixels, ptrdiff_t nPitch, int cx, int cy, unsigned char nThreshold,
+	std::vector<Span>& aSpans)
+{
+	Span empty = { cx, 0 };
+	aSpans.assign(Max(cy, 0), empty);
+	unsigned int dwThreshold = static_cast<unsigned int>(nThreshold) << 24 | 0xFFFFFF;
+	for(int y = 0; y < cy; y++)
+	{
+		const unsigned int* pLine = pPixels + y * nPitch;
+		int nLeft = 0;
+		while(nLeft < cx && pLine[nLeft] <= dwThreshold)
+			nLeft++;
+		if(nLeft == cx) continue;
+		int nRight = cx;
+		while(pLine[nRight - 1] <= dwThreshold)
+			nRight--;
+		aSpans[y].left = nLeft;
+		aSpans[y].right = nRight;
+	}
+}
+
+}
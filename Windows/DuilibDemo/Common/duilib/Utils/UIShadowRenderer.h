@@ -0,0 +1,74 @@
+#ifndef __UISHADOWRENDERER_H__
+#define __UISHADOWRENDERER_H__
+
+#pragma once
+
+// 算法阴影的生成，不依赖 Windows 头文件：
+// 1. 父窗体的形状用每行的范围表示，从窗口区域的矩形或者 alpha 蒙版得到（和原来一样假定父窗体是一整块，没有洞）；
+// 2. 与原来的算法相同：nSize 小于 nSharpness 时形状先收缩 nSharpness - nSize，每个像素按到形状的欧氏距离
+//    取原来锥形核的值。距离只在附近 2K + 1 行里找（K 为核半径），形状内部和远处直接填充；
+// 3. 圆角矩形这类只有四个角不同的形状，缓存一份最小尺寸的阴影，父窗体改变大小时只拉伸中间的行和列（九宫格）。
+
+#include <stddef.h>
+#include <vector>
+
+namespace DuiLib
+{
+
+class CShadowRenderer
+{
+public:
+	struct Params
+	{
+		int nSize;				// 阴影每边比父窗体大出的像素，可以为负
+		int nSharpness;			// 边缘渐变的宽度
+		int nDarkness;			// 0~255
+		int nXOffset;			// 阴影相对父窗体的偏移
+		int nYOffset;
+		unsigned int dwColor;	// 0x00RRGGBB，与 DIB 像素的字节顺序相同
+	};
+
+	// 一行的范围 [left, right)，left >= right 表示这一行为空
+	struct Span
+	{
+		int left;
+		int right;
+	};
+
+	struct Stats
+	{
+		unsigned int nRenders;
+		unsigned int nCacheHits;	// 只拉伸缓存，没有重新计算的次数
+	};
+
+public:
+	CShadowRenderer();
+
+	// 生成 (cx + 2 * nSize) x (cy + 2 * nSize) 的阴影，输出预乘 alpha 的 BGRA，父窗体盖住的部分为 0。
+	// aSpans 是父窗体 cy 行各自的范围；pDst 指向左上角像素，nPitch 是以像素为单位的行距，自底向上的 DIB 传负数
+	void Render(const Params& params, const Span* aSpans, int cx, int cy, unsigned int* pDst, ptrdiff_t nPitch);
+	// 不使用缓存完整计算一遍，Render 的输出与它逐像素相同
+	static void RenderDirect(const Params& params, const Span* aSpans, int cx, int cy, unsigned int* pDst, ptrdiff_t nPitch);
+	void ClearCache();
+	Stats GetStats() const;
+
+	// 从矩形列表得到每行的范围。每个矩形依次是 left、top、right、bottom，与 RGNDATA 里的 RECT 相同；
+	// 一行有多个矩形时取它们的外接范围
+	static void SpansFromRects(const long* pRects, int nRects, int cx, int cy, std::vector<Span>& aSpans);
+	// 从 32 位像素的 alpha 得到每行的范围，alpha 大于 nThreshold 的像素属于父窗体；pPixels 和 nPitch 的含义同 Render
+	static void SpansFromAlpha(const unsigned int* pPixels, ptrdiff_t nPitch, int cx, int cy, unsigned char nThreshold,
+		std::vector<Span>& aSpans);
+
+private:
+	std::vector<int> m_aCacheKey;
+	std::vector<unsigned int> m_aCache;		// 最小尺寸的阴影
+	int m_nCacheWidth;
+	int m_nCacheHeight;
+	int m_nStretchX;						// 缓存中要拉伸的列和行
+	int m_nStretchY;
+	Stats m_stats;
+};
+
+}
+
+#endif //__UISHADOWRENDERER_H__
@@ -0,0 +1,524 @@
+#include "StdAfx.h"
+#include "UIString.h"
+
+namespace DuiLib
+{
+	static int StrNLen(LPCTSTR pstr, int nMax)
+	{
+		int nLength = 0;
+		while( nLength < nMax && pstr[nLength] != '\0' ) nLength++;
+		return nLength;
+	}
+
+	CDuiString::CDuiString() : m_pstr(m_szBuffer), m_nLength(0), m_nCapacity(MAX_LOCAL_STRING_LEN)
+	{
+		m_szBuffer[0] = '\0';
+	}
+
+	CDuiString::CDuiString(const TCHAR ch) : m_pstr(m_szBuffer), m_nLength(ch != '\0' ? 1 : 0), m_nCapacity(MAX_LOCAL_STRING_LEN)
+	{
+		m_szBuffer[0] = ch;
+		m_szBuffer[1] = '\0';
+	}
+
+	CDuiString::CDuiString(LPCTSTR lpsz, int nLen) : m_pstr(m_szBuffer), m_nLength(0), m_nCapacity(MAX_LOCAL_STRING_LEN)
+	{      
+		ASSERT(!::IsBadStringPtr(lpsz,-1) || lpsz==NULL);
+		m_szBuffer[0] = '\0';
+		Assign(lpsz, nLen);
+	}
+
+	CDuiString::CDuiString(const CDuiString& src) : m_pstr(m_szBuffer), m_nLength(0), m_nCapacity(MAX_LOCAL_STRING_LEN)
+	{
+		m_szBuffer[0] = '\0';
+		_Assign(src.m_pstr, src.m_nLength);
+	}
+
+	CDuiString::CDuiString(CDuiString&& src) : m_pstr(m_szBuffer), m_nLength(src.m_nLength), m_nCapacity(MAX_LOCAL_STRING_LEN)
+	{
+		if( src.m_pstr != src.m_szBuffer ) {
+			// 直接接管堆上的缓冲区
+			m_pstr = src.m_pstr;
+			m_nCapacity = src.m_nCapacity;
+			src.m_pstr = src.m_szBuffer;
+			src.m_nCapacity = MAX_LOCAL_STRING_LEN;
+		}
+		else {
+			memcpy(m_szBuffer, src.m_szBuffer, (m_nLength + 1) * sizeof(TCHAR));
+		}
+		src.m_nLength = 0;
+		src.m_szBuffer[0] = '\0';
+	}
+
+	CDuiString::~CDuiString()
+	{
+		if( m_pstr != m_szBuffer ) free(m_pstr);
+	}
+
+	int CDuiString::GetLength() const
+	{ 
+		return m_nLength; 
+	}
+
+	CDuiString::operator LPCTSTR() const 
+	{ 
+		return m_pstr; 
+	}
+
+	void CDuiString::_Grow(int nCapacity)
+	{
+		if( nCapacity <= m_nCapacity ) return;
+		int nNewCapacity = m_nCapacity + m_nCapacity / 2;
+		if( nNewCapacity < nCapacity ) nNewCapacity = nCapacity;
+		if( m_pstr == m_szBuffer ) {
+			LPTSTR pstr = static_cast<LPTSTR>(malloc((nNewCapacity + 1) * sizeof(TCHAR)));
+			memcpy(pstr, m_szBuffer, (m_nLength + 1) * sizeof(TCHAR));
+			m_pstr = pstr;
+		}
+		else {
+			m_pstr = static_cast<LPTSTR>(realloc(m_pstr, (nNewCapacity + 1) * sizeof(TCHAR)));
+		}
+		m_nCapacity = nNewCapacity;
+	}
+
+	void CDuiString::Reserve(int nCapacity)
+	{
+		_Grow(nCapacity);
+	}
+
+	void CDuiString::_Assign(LPCTSTR pstr, int nLength)
+	{
+		if( nLength > m_nCapacity ) {
+			// 新缓冲区分配好之后旧的才释放，pstr 指向自身时也是安全的
+			LPTSTR pOld = m_pstr != m_szBuffer ? m_pstr : NULL;
+			int nNewCapacity = m_nCapacity + m_nCapacity / 2;
+			if( nNewCapacity < nLength ) nNewCapacity = nLength;
+			m_pstr = static_cast<LPTSTR>(malloc((nNewCapacity + 1) * sizeof(TCHAR)));
+			m_nCapacity = nNewCapacity;
+			memcpy(m_pstr, pstr, nLength * sizeof(TCHAR));
+			free(pOld);
+		}
+		else {
+			memmove(m_pstr, pstr, nLength * sizeof(TCHAR));
+		}
+		m_nLength = nLength;
+		m_pstr[nLength] = '\0';
+	}
+
+	void CDuiString::_Append(LPCTSTR pstr, int nLength)
+	{
+		if( nLength <= 0 ) return;
+		if( m_nLength + nLength > m_nCapacity ) {
+			// pstr 可能指向自身，扩容后要重新定位
+			bool bSelf = pstr >= m_pstr && pstr <= m_pstr + m_nLength;
+			size_t nOffset = bSelf ? pstr - m_pstr : 0;
+			_Grow(m_nLength + nLength);
+			if( bSelf ) pstr = m_pstr + nOffset;
+		}
+		memcpy(m_pstr + m_nLength, pstr, nLength * sizeof(TCHAR));
+		m_nLength += nLength;
+		m_pstr[m_nLength] = '\0';
+	}
+
+	void CDuiString::Append(LPCTSTR pstr, int nLength)
+	{
+		if( pstr == NULL ) return;
+		_Append(pstr, nLength < 0 ? (int) _tcslen(pstr) : StrNLen(pstr, nLength));
+	}
+
+	void CDuiString::Assign(LPCTSTR pstr, int cchMax)
+	{
+		if( pstr == NULL ) pstr = _T("");
+		_Assign(pstr, cchMax < 0 ? (int) _tcslen(pstr) : StrNLen(pstr, cchMax));
+	}
+
+	bool CDuiString::IsEmpty() const 
+	{ 
+		return m_nLength == 0; 
+	}
+
+	void CDuiString::Empty() 
+	{ 
+		if( m_pstr != m_szBuffer ) free(m_pstr);
+		m_pstr = m_szBuffer;
+		m_nLength = 0;
+		m_nCapacity = MAX_LOCAL_STRING_LEN;
+		m_szBuffer[0] = '\0'; 
+	}
+
+	LPCTSTR CDuiString::GetData() const
+	{
+		return m_pstr;
+	}
+
+	TCHAR CDuiString::GetAt(int nIndex) const
+	{
+		return m_pstr[nIndex];
+	}
+
+	TCHAR CDuiString::operator[] (int nIndex) const
+	{ 
+		return m_pstr[nIndex];
+	}   
+
+	const CDuiString& CDuiString::operator=(const CDuiString& src)
+	{      
+		if( this != &src ) _Assign(src.m_pstr, src.m_nLength);
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator=(CDuiString&& src)
+	{
+		if( this == &src ) return *this;
+		if( src.m_pstr != src.m_szBuffer ) {
+			if( m_pstr != m_szBuffer ) free(m_pstr);
+			m_pstr = src.m_pstr;
+			m_nLength = src.m_nLength;
+			m_nCapacity = src.m_nCapacity;
+			src.m_pstr = src.m_szBuffer;
+			src.m_nCapacity = MAX_LOCAL_STRING_LEN;
+		}
+		else {
+			_Assign(src.m_szBuffer, src.m_nLength);
+		}
+		src.m_nLength = 0;
+		src.m_szBuffer[0] = '\0';
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator=(LPCTSTR lpStr)
+	{      
+		if ( lpStr )
+		{
+			ASSERT(!::IsBadStringPtr(lpStr,-1));
+			Assign(lpStr);
+		}
+		else
+		{
+			Empty();
+		}
+		return *this;
+	}
+
+#ifdef _UNICODE
+
+	const CDuiString& CDuiString::operator=(LPCSTR lpStr)
+	{
+		if ( lpStr )
+		{
+			ASSERT(!::IsBadStringPtrA(lpStr,-1));
+			int cchStr = (int) strlen(lpStr) + 1;
+			LPWSTR pwstr = (LPWSTR) _alloca(cchStr * sizeof(WCHAR));
+			if( pwstr != NULL ) ::MultiByteToWideChar(::GetACP(), 0, lpStr, -1, pwstr, cchStr) ;
+			Assign(pwstr);
+		}
+		else
+		{
+			Empty();
+		}
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator+=(LPCSTR lpStr)
+	{
+		if ( lpStr )
+		{
+			ASSERT(!::IsBadStringPtrA(lpStr,-1));
+			int cchStr = (int) strlen(lpStr) + 1;
+			LPWSTR pwstr = (LPWSTR) _alloca(cchStr * sizeof(WCHAR));
+			if( pwstr != NULL ) ::MultiByteToWideChar(::GetACP(), 0, lpStr, -1, pwstr, cchStr) ;
+			Append(pwstr);
+		}
+		
+		return *this;
+	}
+
+#else
+
+	const CDuiString& CDuiString::operator=(LPCWSTR lpwStr)
+	{      
+		if ( lpwStr )
+		{
+			ASSERT(!::IsBadStringPtrW(lpwStr,-1));
+			int cchStr = ((int) wcslen(lpwStr) * 2) + 1;
+			LPSTR pstr = (LPSTR) _alloca(cchStr);
+			if( pstr != NULL ) ::WideCharToMultiByte(::GetACP(), 0, lpwStr, -1, pstr, cchStr, NULL, NULL);
+			Assign(pstr);
+		}
+		else
+		{
+			Empty();
+		}
+		
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator+=(LPCWSTR lpwStr)
+	{
+		if ( lpwStr )
+		{
+			ASSERT(!::IsBadStringPtrW(lpwStr,-1));
+			int cchStr = ((int) wcslen(lpwStr) * 2) + 1;
+			LPSTR pstr = (LPSTR) _alloca(cchStr);
+			if( pstr != NULL ) ::WideCharToMultiByte(::GetACP(), 0, lpwStr, -1, pstr, cchStr, NULL, NULL);
+			Append(pstr);
+		}
+		
+		return *this;
+	}
+
+#endif // _UNICODE
+
+	const CDuiString& CDuiString::operator=(const TCHAR ch)
+	{
+		m_pstr[0] = ch;
+		m_pstr[1] = '\0';
+		m_nLength = (ch != '\0' ? 1 : 0);
+		return *this;
+	}
+
+	CDuiString CDuiString::operator+(const CDuiString& src) const
+	{
+		CDuiString sTemp;
+		sTemp.Reserve(m_nLength + src.m_nLength);
+		sTemp._Assign(m_pstr, m_nLength);
+		sTemp._Append(src.m_pstr, src.m_nLength);
+		return sTemp;
+	}
+
+	CDuiString CDuiString::operator+(LPCTSTR lpStr) const
+	{
+		if ( lpStr )
+		{
+			ASSERT(!::IsBadStringPtr(lpStr,-1));
+			int nLength = (int) _tcslen(lpStr);
+			CDuiString sTemp;
+			sTemp.Reserve(m_nLength + nLength);
+			sTemp._Assign(m_pstr, m_nLength);
+			sTemp._Append(lpStr, nLength);
+			return sTemp;
+		}
+
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator+=(const CDuiString& src)
+	{      
+		_Append(src.m_pstr, src.m_nLength);
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator+=(LPCTSTR lpStr)
+	{      
+		if ( lpStr )
+		{
+			ASSERT(!::IsBadStringPtr(lpStr,-1));
+			Append(lpStr);
+		}
+		
+		return *this;
+	}
+
+	const CDuiString& CDuiString::operator+=(const TCHAR ch)
+	{      
+		if( ch == '\0' ) return *this;
+		if( m_nLength == m_nCapacity ) _Grow(m_nLength + 1);
+		m_pstr[m_nLength++] = ch;
+		m_pstr[m_nLength] = '\0';
+		return *this;
+	}
+
+	bool CDuiString::operator == (const CDuiString& str) const
+	{
+		return m_nLength == str.m_nLength && memcmp(m_pstr, str.m_pstr, m_nLength * sizeof(TCHAR)) == 0;
+	}
+
+	bool CDuiString::operator != (const CDuiString& str) const { return !(*this == str); };
+	bool CDuiString::operator == (LPCTSTR str) const { return (Compare(str) == 0); };
+	bool CDuiString::operator != (LPCTSTR str) const { return (Compare(str) != 0); };
+	bool CDuiString::operator <= (LPCTSTR str) const { return (Compare(str) <= 0); };
+	bool CDuiString::operator <  (LPCTSTR str) const { return (Compare(str) <  0); };
+	bool CDuiString::operator >= (LPCTSTR str) const { return (Compare(str) >= 0); };
+	bool CDuiString::operator >  (LPCTSTR str) const { return (Compare(str) >  0); };
+
+	void CDuiString::SetAt(int nIndex, TCHAR ch)
+	{
+		ASSERT(nIndex>=0 && nIndex<GetLength());
+		m_pstr[nIndex] = ch;
+		if( ch == '\0' ) m_nLength = nIndex;
+	}
+
+	int CDuiString::Compare(LPCTSTR lpsz) const 
+	{ 
+		return _tcscmp(m_pstr, lpsz); 
+	}
+
+	int CDuiString::CompareNoCase(LPCTSTR lpsz) const 
+	{ 
+		return _tcsicmp(m_pstr, lpsz); 
+	}
+
+	void CDuiString::MakeUpper() 
+	{ 
+		_tcsupr(m_pstr); 
+	}
+
+	void CDuiString::MakeLower() 
+	{ 
+		_tcslwr(m_pstr); 
+	}
+
+	CDuiString CDuiString::Left(int iLength) const
+	{
+		if( iLength < 0 ) iLength = 0;
+		if( iLength > m_nLength ) iLength = m_nLength;
+		CDuiString sTemp;
+		sTemp._Assign(m_pstr, iLength);
+		return sTemp;
+	}
+
+	CDuiString CDuiString::Mid(int iPos, int iLength) const
+	{
+		if( iLength < 0 ) iLength = m_nLength - iPos;
+		if( iPos + iLength > m_nLength ) iLength = m_nLength - iPos;
+		if( iLength <= 0 ) return CDuiString();
+		CDuiString sTemp;
+		sTemp._Assign(m_pstr + iPos, iLength);
+		return sTemp;
+	}
+
+	CDuiString CDuiString::Right(int iLength) const
+	{
+		if( iLength < 0 ) iLength = 0;
+		int iPos = m_nLength - iLength;
+		if( iPos < 0 ) {
+			iPos = 0;
+			iLength = m_nLength;
+		}
+		CDuiString sTemp;
+		sTemp._Assign(m_pstr + iPos, iLength);
+		return sTemp;
+	}
+
+	int CDuiString::Find(TCHAR ch, int iPos /*= 0*/) const
+	{
+		ASSERT(iPos>=0 && iPos<=GetLength());
+		if( iPos != 0 && (iPos < 0 || iPos >= m_nLength) ) return -1;
+		LPCTSTR p = _tcschr(m_pstr + iPos, ch);
+		if( p == NULL ) return -1;
+		return (int)(p - m_pstr);
+	}
+
+	int CDuiString::Find(LPCTSTR pstrSub, int iPos /*= 0*/) const
+	{
+		ASSERT(!::IsBadStringPtr(pstrSub,-1));
+		ASSERT(iPos>=0 && iPos<=GetLength());
+		if( iPos != 0 && (iPos < 0 || iPos > m_nLength) ) return -1;
+		LPCTSTR p = _tcsstr(m_pstr + iPos, pstrSub);
+		if( p == NULL ) return -1;
+		return (int)(p - m_pstr);
+	}
+
+	int CDuiString::ReverseFind(TCHAR ch) const
+	{
+		LPCTSTR p = _tcsrchr(m_pstr, ch);
+		if( p == NULL ) return -1;
+		return (int)(p - m_pstr);
+	}
+
+	int CDuiString::Replace(LPCTSTR pstrFrom, LPCTSTR pstrTo)
+	{
+		int iPos = Find(pstrFrom);
+		if( iPos < 0 ) return 0;
+		int cchFrom = (int) _tcslen(pstrFrom);
+		if( cchFrom == 0 ) return 0;
+		int cchTo = (int) _tcslen(pstrTo);
+		// 一遍拼出结果，替换进去的内容不会再参与查找
+		CDuiString sTemp;
+		sTemp.Reserve(m_nLength);
+		int nCount = 0;
+		int iStart = 0;
+		while( iPos >= 0 ) {
+			sTemp._Append(m_pstr + iStart, iPos - iStart);
+			sTemp._Append(pstrTo, cchTo);
+			iStart = iPos + cchFrom;
+			iPos = Find(pstrFrom, iStart);
+			nCount++;
+		}
+		sTemp._Append(m_pstr + iStart, m_nLength - iStart);
+		*this = std::move(sTemp);
+		return nCount;
+	}
+    
+    int CDuiString::Format(LPCTSTR pstrFormat, ...)
+    {
+        int nRet;
+        va_list Args;
+
+        va_start(Args, pstrFormat);
+        nRet = InnerFormat(pstrFormat, Args);
+        va_end(Args);
+
+        return nRet;
+
+    }
+
+	int CDuiString::SmallFormat(LPCTSTR pstrFormat, ...)
+	{
+		CDuiString sFormat = pstrFormat;
+		TCHAR szBuffer[64] = { 0 };
+		va_list argList;
+		va_start(argList, pstrFormat);
+		// 长度按字符计，留一个给结尾的 0
+		int iRet = ::_vsntprintf(szBuffer, sizeof(szBuffer) / sizeof(szBuffer[0]) - 1, sFormat, argList);
+		va_end(argList);
+		Assign(szBuffer);
+		return iRet;
+	}
+	
+    int CDuiString::InnerFormat(LPCTSTR pstrFormat, va_list Args)
+    {
+#if _MSC_VER <= 1400
+        TCHAR *szBuffer = NULL;
+        int size = 512, nLen, counts;
+        szBuffer = (TCHAR*)malloc(size);
+        ZeroMemory(szBuffer, size);
+        while (TRUE){
+            counts = size / sizeof(TCHAR);
+            nLen = _vsntprintf (szBuffer, counts, pstrFormat, Args);
+            if (nLen != -1 && nLen < counts){
+                break;
+            }
+            if (nLen == -1){
+                size *= 2;
+            }else{
+                size += 1 * sizeof(TCHAR);
+            }
+
+            if ((szBuffer = (TCHAR*)realloc(szBuffer, size)) != NULL){
+                ZeroMemory(szBuffer, size);
+            }else{
+                break;
+            }
+        }
+
+        Assign(szBuffer);
+        free(szBuffer);
+        return nLen;
+#else
+        int nLen, totalLen;
+        TCHAR *szBuffer;
+        nLen = _vsntprintf(NULL, 0, pstrFormat, Args);
+        totalLen = (nLen + 1)*sizeof(TCHAR);
+        szBuffer = (TCHAR*)malloc(totalLen);
+        ZeroMemory(szBuffer, totalLen);
+        nLen = _vsntprintf(szBuffer, nLen + 1, pstrFormat, Args);
+        Assign(szBuffer);
+        free(szBuffer);
+        return nLen;
+
+#endif
+    }
+
+
+} // namespace DuiLib
@@ -0,0 +1,198 @@
+#ifndef __UISTRING_H__
+#define __UISTRING_H__
+
+#pragma once
+
+// CDuiString、CDuiStringView 和属性列表的解析。
+// TCHAR、_T、_tcs*、CharNext 和 _ASSERTE 由包含方提供：库内来自 StdAfx.h 带进来的 Windows 头文件。
+// UIBase.h 的 ASSERT 在这个文件之后才定义，模板里直接用 _ASSERTE
+
+namespace DuiLib
+{
+	/////////////////////////////////////////////////////////////////////////////////////
+	//
+
+	// 长度保存在对象里，GetLength 不再扫描字符串；不超过 MAX_LOCAL_STRING_LEN 的字符串放在对象内部，
+	// 皮肤里的属性名和属性值绝大多数不超过 31 个字符。堆上的缓冲区按 1.5 倍扩容，Assign 时保留容量，Empty 时释放
+	class UILIB_API CDuiString
+	{
+	public:
+		enum { MAX_LOCAL_STRING_LEN = 31 };
+
+		CDuiString();
+		CDuiString(const TCHAR ch);
+		CDuiString(const CDuiString& src);
+		CDuiString(CDuiString&& src);
+		CDuiString(LPCTSTR lpsz, int nLen = -1);
+		~CDuiString();
+
+		void Empty();
+		int GetLength() const;
+		bool IsEmpty() const;
+		TCHAR GetAt(int nIndex) const;
+		// nLength 为 -1 时追加整个字符串，否则最多追加 nLength 个字符
+		void Append(LPCTSTR pstr, int nLength = -1);
+		void Assign(LPCTSTR pstr, int nLength = -1);
+		// 预留至少 nCapacity 个字符的空间（不含结尾的 0）
+		void Reserve(int nCapacity);
+		LPCTSTR GetData() const;
+
+		void SetAt(int nIndex, TCHAR ch);
+		operator LPCTSTR() const;
+
+		TCHAR operator[] (int nIndex) const;
+		const CDuiString& operator=(const CDuiString& src);
+		const CDuiString& operator=(CDuiString&& src);
+		const CDuiString& operator=(const TCHAR ch);
+		const CDuiString& operator=(LPCTSTR pstr);
+#ifdef _UNICODE
+		const CDuiString& operator=(LPCSTR lpStr);
+		const CDuiString& operator+=(LPCSTR lpStr);
+#else
+		const CDuiString& operator=(LPCWSTR lpwStr);
+		const CDuiString& operator+=(LPCWSTR lpwStr);
+#endif
+		CDuiString operator+(const CDuiString& src) const;
+		CDuiString operator+(LPCTSTR pstr) const;
+		const CDuiString& operator+=(const CDuiString& src);
+		const CDuiString& operator+=(LPCTSTR pstr);
+		const CDuiString& operator+=(const TCHAR ch);
+
+		bool operator == (const CDuiString& str) const;
+		bool operator != (const CDuiString& str) const;
+		bool operator == (LPCTSTR str) const;
+		bool operator != (LPCTSTR str) const;
+		bool operator <= (LPCTSTR str) const;
+		bool operator <  (LPCTSTR str) const;
+		bool operator >= (LPCTSTR str) const;
+		bool operator >  (LPCTSTR str) const;
+
+		int Compare(LPCTSTR pstr) const;
+		int CompareNoCase(LPCTSTR pstr) const;
+
+		void MakeUpper();
+		void MakeLower();
+
+		CDuiString Left(int nLength) const;
+		CDuiString Mid(int iPos, int nLength = -1) const;
+		CDuiString Right(int nLength) const;
+
+		int Find(TCHAR ch, int iPos = 0) const;
+		int Find(LPCTSTR pstr, int iPos = 0) const;
+		int ReverseFind(TCHAR ch) const;
+		int Replace(LPCTSTR pstrFrom, LPCTSTR pstrTo);
+
+		int __cdecl Format(LPCTSTR pstrFormat, ...);
+		int __cdecl SmallFormat(LPCTSTR pstrFormat, ...);
+
+	protected:
+		int __cdecl InnerFormat(LPCTSTR pstrFormat, va_list Args);
+		// pstr 可以指向自身的缓冲区，nLength 必须是准确的长度
+		void _Assign(LPCTSTR pstr, int nLength);
+		void _Append(LPCTSTR pstr, int nLength);
+		void _Grow(int nCapacity);
+
+	protected:
+		LPTSTR m_pstr;
+		int m_nLength;
+		int m_nCapacity;		// 不含结尾的 0，使用 m_szBuffer 时为 MAX_LOCAL_STRING_LEN
+		TCHAR m_szBuffer[MAX_LOCAL_STRING_LEN + 1];
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////
+	//
+
+	// 不持有内存的只读字符串片段，不一定以 0 结尾。用于属性解析这类只读路径，避免为每一段构造 CDuiString
+	class CDuiStringView
+	{
+	public:
+		CDuiStringView() : m_pstr(_T("")), m_nLength(0) {}
+		CDuiStringView(LPCTSTR pstr) : m_pstr(pstr != NULL ? pstr : _T("")), m_nLength(pstr != NULL ? (int) _tcslen(pstr) : 0) {}
+		CDuiStringView(LPCTSTR pstr, int nLength) : m_pstr(pstr), m_nLength(nLength) {}
+		CDuiStringView(const CDuiString& src) : m_pstr(src.GetData()), m_nLength(src.GetLength()) {}
+
+		LPCTSTR GetData() const { return m_pstr; }
+		int GetLength() const { return m_nLength; }
+		bool IsEmpty() const { return m_nLength == 0; }
+		TCHAR operator[] (int nIndex) const { return m_pstr[nIndex]; }
+
+		int Compare(LPCTSTR pstr) const
+		{
+			int nRet = _tcsncmp(m_pstr, pstr, m_nLength);
+			if( nRet != 0 ) return nRet;
+			return pstr[m_nLength] == _T('\0') ? 0 : -1;
+		}
+		int CompareNoCase(LPCTSTR pstr) const
+		{
+			int nRet = _tcsnicmp(m_pstr, pstr, m_nLength);
+			if( nRet != 0 ) return nRet;
+			return pstr[m_nLength] == _T('\0') ? 0 : -1;
+		}
+		bool operator == (LPCTSTR pstr) const { return Compare(pstr) == 0; }
+		bool operator != (LPCTSTR pstr) const { return Compare(pstr) != 0; }
+
+		int Find(TCHAR ch, int iPos = 0) const
+		{
+			for( int i = (iPos < 0 ? 0 : iPos); i < m_nLength; i++ ) {
+				if( m_pstr[i] == ch ) return i;
+			}
+			return -1;
+		}
+		CDuiStringView Mid(int iPos, int nLength = -1) const
+		{
+			if( iPos < 0 ) iPos = 0;
+			if( iPos > m_nLength ) iPos = m_nLength;
+			if( nLength < 0 || nLength > m_nLength - iPos ) nLength = m_nLength - iPos;
+			return CDuiStringView(m_pstr + iPos, nLength);
+		}
+		// 从 iPos 开始跳过 pstrDelims 中的字符，取出下一段放到 sToken，iPos 移到这一段之后；没有更多内容时返回 false
+		bool NextToken(int& iPos, LPCTSTR pstrDelims, CDuiStringView& sToken) const
+		{
+			while( iPos < m_nLength && _tcschr(pstrDelims, m_pstr[iPos]) != NULL ) iPos++;
+			if( iPos >= m_nLength ) return false;
+			int iStart = iPos;
+			while( iPos < m_nLength && _tcschr(pstrDelims, m_pstr[iPos]) == NULL ) iPos++;
+			sToken = CDuiStringView(m_pstr + iStart, iPos - iStart);
+			return true;
+		}
+
+	protected:
+		LPCTSTR m_pstr;
+		int m_nLength;
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////
+	//
+
+	// 解析 name="value" 形式、以空格或逗号分隔的属性列表（ApplyAttributeList、innerstyle），&quot; 先换成引号，
+	// 每一对交给 target.SetAttribute。每一段按长度复制到复用的 sItem/sValue 中；格式不对时停止
+	template<typename T>
+	void ParseAttributeList(LPCTSTR pstrValue, T& target)
+	{
+		CDuiString sXmlData = pstrValue;
+		sXmlData.Replace(_T("&quot;"), _T("\""));
+		LPCTSTR pstrList = sXmlData.GetData();
+		CDuiString sItem;
+		CDuiString sValue;
+		while( *pstrList != _T('\0') ) {
+			LPCTSTR pstrStart = pstrList;
+			while( *pstrList != _T('\0') && *pstrList != _T('=') ) pstrList = ::CharNext(pstrList);
+			sItem.Assign(pstrStart, (int)(pstrList - pstrStart));
+			_ASSERTE( *pstrList == _T('=') );
+			if( *pstrList++ != _T('=') ) return;
+			_ASSERTE( *pstrList == _T('\"') );
+			if( *pstrList++ != _T('\"') ) return;
+			pstrStart = pstrList;
+			while( *pstrList != _T('\0') && *pstrList != _T('\"') ) pstrList = ::CharNext(pstrList);
+			sValue.Assign(pstrStart, (int)(pstrList - pstrStart));
+			_ASSERTE( *pstrList == _T('\"') );
+			if( *pstrList++ != _T('\"') ) return;
+			target.SetAttribute(sItem, sValue);
+			if( *pstrList != _T(' ') && *pstrList != _T(',') ) return;
+			pstrList++;
+		}
+	}
+
+} // namespace DuiLib
+
+#endif // __UISTRING_H__
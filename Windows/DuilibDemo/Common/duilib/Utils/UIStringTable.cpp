@@ -0,0 +1,410 @@
+#include "UIStringTable.h"
+
+#include <string.h>
+#include <new>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace DuiLib {
+
+	namespace {
+
+		const unsigned long long kSecret0 = 0x2d358dccaa6c78a5ull;
+		const unsigned long long kSecret1 = 0x8bb84b93962eacc9ull;
+		const unsigned long long kSecret2 = 0x4b33a62ed433d4a3ull;
+		const unsigned long long kSecret3 = 0x4d5a2da51de1aa47ull;
+
+		const size_t kMinSlots = 16;
+		const size_t kFirstBlock = 64;		// 字符池第一块的字符数，之后每块翻倍
+		const size_t kMaxBlock = 4096;
+		const size_t kNotFound = static_cast<size_t>(-1);
+
+		// 64x64 -> 128 位乘法，*pA 取低 64 位，*pB 取高 64 位
+		inline void Mum(unsigned long long* pA, unsigned long long* pB)
+		{
+#if defined(__SIZEOF_INT128__)
+			unsigned __int128 r = static_cast<unsigned __int128>(*pA) * *pB;
+			*pA = static_cast<unsigned long long>(r);
+			*pB = static_cast<unsigned long long>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			*pA = _umul128(*pA, *pB, pB);
+#else
+			unsigned long long ha = *pA >> 32, hb = *pB >> 32, la = static_cast<unsigned int>(*pA), lb = static_cast<unsigned int>(*pB);
+			unsigned long long rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+			unsigned long long c = t < rl;
+			unsigned long long lo = t + (rm1 << 32);
+			c += lo < t;
+			*pA = lo;
+			*pB = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+		}
+
+		inline unsigned long long Mix(unsigned long long a, unsigned long long b)
+		{
+			Mum(&a, &b);
+			return a ^ b;
+		}
+
+		inline unsigned long long Read8(const unsigned char* p)
+		{
+			unsigned long long v;
+			memcpy(&v, p, 8);
+			return v;
+		}
+
+		inline unsigned long long Read4(const unsigned char* p)
+		{
+			unsigned int v;
+			memcpy(&v, p, 4);
+			return v;
+		}
+
+		template<typename T>
+		inline size_t KeyLength(const T* pstrKey)
+		{
+			const T* p = pstrKey;
+			while( *p ) ++p;
+			return static_cast<size_t>(p - pstrKey);
+		}
+
+		inline size_t SlotsFor(size_t nCount)
+		{
+			// 负载不超过 0.8
+			size_t nSlots = kMinSlots;
+			while( nSlots * 4 < nCount * 5 ) nSlots <<= 1;
+			return nSlots;
+		}
+
+	} // namespace
+
+	template<typename T>
+	CStringPtrTableT<T>::CStringPtrTableT() : m_pSlots(NULL), m_nMask(0), m_pHead(NULL)
+	{
+	}
+
+	template<typename T>
+	CStringPtrTableT<T>::~CStringPtrTableT()
+	{
+		delete [] m_pSlots;
+		_FreeBlocks();
+	}
+
+	template<typename T>
+	unsigned long long CStringPtrTableT<T>::Hash(const T* pstrKey, size_t nLen)
+	{
+		// wyhash 的做法：按 16 字节一组和种子做 128 位乘法折叠，短 key 只读首尾
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(pstrKey);
+		size_t nBytes = nLen * sizeof(T);
+		unsigned long long nSeed = Mix(kSecret0, kSecret1);
+		unsigned long long a, b;
+		if( nBytes <= 16 ) {
+			if( nBytes >= 4 ) {
+				size_t nMid = (nBytes >> 3) << 2;
+				a = (Read4(p) << 32) | Read4(p + nMid);
+				b = (Read4(p + nBytes - 4) << 32) | Read4(p + nBytes - 4 - nMid);
+			}
+			else if( nBytes > 0 ) {
+				a = (static_cast<unsigned long long>(p[0]) << 16) | (static_cast<unsigned long long>(p[nBytes >> 1]) << 8) | p[nBytes - 1];
+				b = 0;
+			}
+			else {
+				a = b = 0;
+			}
+		}
+		else {
+			size_t i = nBytes;
+			if( i > 48 ) {
+				unsigned long long nSeed1 = nSeed, nSeed2 = nSeed;
+				do {
+					nSeed = Mix(Read8(p) ^ kSecret1, Read8(p + 8) ^ nSeed);
+					nSeed1 = Mix(Read8(p + 16) ^ kSecret2, Read8(p + 24) ^ nSeed1);
+					nSeed2 = Mix(Read8(p + 32) ^ kSecret3, Read8(p + 40) ^ nSeed2);
+					p += 48;
+					i -= 48;
+				} while( i > 48 );
+				nSeed ^= nSeed1 ^ nSeed2;
+			}
+			while( i > 16 ) {
+				nSeed = Mix(Read8(p) ^ kSecret1, Read8(p + 8) ^ nSeed);
+				p += 16;
+				i -= 16;
+			}
+			a = Read8(p + i - 16);
+			b = Read8(p + i - 8);
+		}
+		a ^= kSecret1;
+		b ^= nSeed;
+		Mum(&a, &b);
+		return Mix(a ^ kSecret0 ^ nBytes, b ^ kSecret1);
+	}
+
+	template<typename T>
+	void* CStringPtrTableT<T>::Find(const T* pstrKey) const
+	{
+		if( pstrKey == NULL || m_aEntries.empty() ) return NULL;
+		size_t nLen = KeyLength(pstrKey);
+		size_t nSlot = _Lookup(pstrKey, nLen, static_cast<unsigned int>(Hash(pstrKey, nLen)));
+		if( nSlot == kNotFound ) return NULL;
+		return m_aEntries[m_pSlots[nSlot].nEntry - 1].pData;
+	}
+
+	template<typename T>
+	bool CStringPtrTableT<T>::Insert(const T* pstrKey, void* pData)
+	{
+		if( pstrKey == NULL ) return false;
+		size_t nLen = KeyLength(pstrKey);
+		unsigned int nHash = static_cast<unsigned int>(Hash(pstrKey, nLen));
+		if( _Lookup(pstrKey, nLen, nHash) != kNotFound ) return false;
+		_Add(pstrKey, nLen, nHash, pData);
+		return true;
+	}
+
+	template<typename T>
+	void* CStringPtrTableT<T>::Set(const T* pstrKey, void* pData)
+	{
+		if( pstrKey == NULL ) return NULL;
+		size_t nLen = KeyLength(pstrKey);
+		unsigned int nHash = static_cast<unsigned int>(Hash(pstrKey, nLen));
+		size_t nSlot = _Lookup(pstrKey, nLen, nHash);
+		if( nSlot != kNotFound ) {
+			Entry& entry = m_aEntries[m_pSlots[nSlot].nEntry - 1];
+			void* pOldData = entry.pData;
+			entry.pData = pData;
+			return pOldData;
+		}
+		_Add(pstrKey, nLen, nHash, pData);
+		return NULL;
+	}
+
+	template<typename T>
+	bool CStringPtrTableT<T>::Remove(const T* pstrKey)
+	{
+		if( pstrKey == NULL || m_aEntries.empty() ) return false;
+		size_t nLen = KeyLength(pstrKey);
+		size_t nSlot = _Lookup(pstrKey, nLen, static_cast<unsigned int>(Hash(pstrKey, nLen)));
+		if( nSlot == kNotFound ) return false;
+		// pstrKey 可能就是表里的 key，_Erase 之后不能再访问
+		_Erase(nSlot);
+		return true;
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::Clear()
+	{
+		delete [] m_pSlots;
+		m_pSlots = NULL;
+		m_nMask = 0;
+		std::vector<Entry>().swap(m_aEntries);
+		_FreeBlocks();
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::Reserve(size_t nCount)
+	{
+		size_t nSlots = SlotsFor(nCount);
+		if( m_pSlots == NULL || nSlots > m_nMask + 1 ) _Rehash(nSlots);
+		m_aEntries.reserve(nCount);
+	}
+
+	template<typename T>
+	const T* CStringPtrTableT<T>::GetKeyAt(size_t iIndex) const
+	{
+		if( iIndex >= m_aEntries.size() ) return NULL;
+		return m_aEntries[iIndex].pstrKey;
+	}
+
+	template<typename T>
+	void* CStringPtrTableT<T>::GetDataAt(size_t iIndex) const
+	{
+		if( iIndex >= m_aEntries.size() ) return NULL;
+		return m_aEntries[iIndex].pData;
+	}
+
+	template<typename T>
+	typename CStringPtrTableT<T>::Stats CStringPtrTableT<T>::GetStats() const
+	{
+		Stats stats;
+		stats.nCount = m_aEntries.size();
+		stats.nSlots = m_pSlots != NULL ? m_nMask + 1 : 0;
+		stats.nMaxProbe = 0;
+		for( size_t i = 0; i < stats.nSlots; i++ ) {
+			if( m_pSlots[i].nEntry == 0 ) continue;
+			size_t nDist = (i - m_pSlots[i].nHash) & m_nMask;
+			if( nDist > stats.nMaxProbe ) stats.nMaxProbe = nDist;
+		}
+		stats.nPoolBlocks = 0;
+		stats.nPoolChars = 0;
+		for( Block* pBlock = m_pHead; pBlock != NULL; pBlock = pBlock->pNext ) {
+			stats.nPoolBlocks++;
+			stats.nPoolChars += pBlock->nSize;
+		}
+		return stats;
+	}
+
+	template<typename T>
+	size_t CStringPtrTableT<T>::_Lookup(const T* pstrKey, size_t nLen, unsigned int nHash) const
+	{
+		if( m_pSlots == NULL ) return kNotFound;
+		size_t nPos = nHash & m_nMask;
+		for( size_t nDist = 0; ; nDist++ ) {
+			const Slot& slot = m_pSlots[nPos];
+			if( slot.nEntry == 0 ) return kNotFound;
+			// 按 robin hood 的顺序，遇到离家更近的条目说明 key 不存在
+			if( ((nPos - slot.nHash) & m_nMask) < nDist ) return kNotFound;
+			if( slot.nHash == nHash ) {
+				const Entry& entry = m_aEntries[slot.nEntry - 1];
+				if( entry.nLen == nLen && memcmp(entry.pstrKey, pstrKey, nLen * sizeof(T)) == 0 ) return nPos;
+			}
+			nPos = (nPos + 1) & m_nMask;
+		}
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::_Add(const T* pstrKey, size_t nLen, unsigned int nHash, void* pData)
+	{
+		size_t nCount = m_aEntries.size() + 1;
+		if( m_pSlots == NULL || nCount * 5 > (m_nMask + 1) * 4 ) _Rehash(SlotsFor(nCount));
+
+		Entry entry;
+		entry.pstrKey = _CopyKey(pstrKey, nLen, entry.pBlock);
+		entry.pData = pData;
+		entry.nLen = static_cast<unsigned int>(nLen);
+		entry.nHash = nHash;
+		m_aEntries.push_back(entry);
+		_Place(nHash, static_cast<unsigned int>(m_aEntries.size()));
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::_Place(unsigned int nHash, unsigned int nEntry)
+	{
+		Slot cur;
+		cur.nHash = nHash;
+		cur.nEntry = nEntry;
+		size_t nPos = nHash & m_nMask;
+		size_t nDist = 0;
+		for( ;; ) {
+			Slot& slot = m_pSlots[nPos];
+			if( slot.nEntry == 0 ) {
+				slot = cur;
+				return;
+			}
+			// 离家更近的条目让位
+			size_t nOther = (nPos - slot.nHash) & m_nMask;
+			if( nOther < nDist ) {
+				Slot tmp = slot;
+				slot = cur;
+				cur = tmp;
+				nDist = nOther;
+			}
+			nPos = (nPos + 1) & m_nMask;
+			nDist++;
+		}
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::_Rehash(size_t nSlots)
+	{
+		delete [] m_pSlots;
+		m_pSlots = new Slot[nSlots];
+		memset(m_pSlots, 0, nSlots * sizeof(Slot));
+		m_nMask = nSlots - 1;
+		// 散列值保存在条目里，扩容不需要再访问 key
+		for( size_t i = 0; i < m_aEntries.size(); i++ ) {
+			_Place(m_aEntries[i].nHash, static_cast<unsigned int>(i + 1));
+		}
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::_Erase(size_t nSlot)
+	{
+		size_t nIndex = m_pSlots[nSlot].nEntry - 1;
+
+		// 后面不在自己家位置上的槽位依次前移一格
+		size_t nPos = nSlot;
+		for( ;; ) {
+			size_t nNext = (nPos + 1) & m_nMask;
+			const Slot& next = m_pSlots[nNext];
+			if( next.nEntry == 0 || ((nNext - next.nHash) & m_nMask) == 0 ) break;
+			m_pSlots[nPos] = next;
+			nPos = nNext;
+		}
+		m_pSlots[nPos].nHash = 0;
+		m_pSlots[nPos].nEntry = 0;
+
+		_ReleaseKey(m_aEntries[nIndex]);
+
+		// 最后一个条目填到空出来的位置，并修正指向它的槽位
+		size_t nLast = m_aEntries.size() - 1;
+		if( nIndex != nLast ) {
+			m_aEntries[nIndex] = m_aEntries[nLast];
+			nPos = m_aEntries[nIndex].nHash & m_nMask;
+			while( m_pSlots[nPos].nEntry != nLast + 1 ) nPos = (nPos + 1) & m_nMask;
+			m_pSlots[nPos].nEntry = static_cast<unsigned int>(nIndex + 1);
+		}
+		m_aEntries.pop_back();
+	}
+
+	template<typename T>
+	const T* CStringPtrTableT<T>::_CopyKey(const T* pstrKey, size_t nLen, Block*& pBlock)
+	{
+		size_t nNeed = nLen + 1;
+		if( m_pHead == NULL || m_pHead->nSize - m_pHead->nUsed < nNeed ) {
+			size_t nSize = m_pHead != NULL ? m_pHead->nSize * 2 : kFirstBlock;
+			if( nSize > kMaxBlock ) nSize = kMaxBlock;
+			if( nSize < nNeed ) nSize = nNeed;
+			// 表头的块即使已经没有 key 也会保留，换新块之前先释放
+			if( m_pHead != NULL && m_pHead->nLive == 0 ) {
+				Block* pEmpty = m_pHead;
+				m_pHead = pEmpty->pNext;
+				if( m_pHead != NULL ) m_pHead->pPrev = NULL;
+				::operator delete(pEmpty);
+			}
+			Block* pNew = static_cast<Block*>(::operator new(sizeof(Block) + nSize * sizeof(T)));
+			pNew->pPrev = NULL;
+			pNew->pNext = m_pHead;
+			pNew->nUsed = 0;
+			pNew->nSize = nSize;
+			pNew->nLive = 0;
+			if( m_pHead != NULL ) m_pHead->pPrev = pNew;
+			m_pHead = pNew;
+		}
+		T* pKey = m_pHead->Data() + m_pHead->nUsed;
+		memcpy(pKey, pstrKey, nLen * sizeof(T));
+		pKey[nLen] = 0;
+		m_pHead->nUsed += nNeed;
+		m_pHead->nLive += nNeed;
+		pBlock = m_pHead;
+		return pKey;
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::_ReleaseKey(const Entry& entry)
+	{
+		Block* pBlock = entry.pBlock;
+		pBlock->nLive -= entry.nLen + 1;
+		if( pBlock->nLive != 0 ) return;
+		if( pBlock == m_pHead ) {
+			// 表头的块从头开始重用
+			pBlock->nUsed = 0;
+			return;
+		}
+		pBlock->pPrev->pNext = pBlock->pNext;
+		if( pBlock->pNext != NULL ) pBlock->pNext->pPrev = pBlock->pPrev;
+		::operator delete(pBlock);
+	}
+
+	template<typename T>
+	void CStringPtrTableT<T>::_FreeBlocks()
+	{
+		while( m_pHead != NULL ) {
+			Block* pKill = m_pHead;
+			m_pHead = m_pHead->pNext;
+			::operator delete(pKill);
+		}
+	}
+
+	template class CStringPtrTableT<char>;
+	template class CStringPtrTableT<wchar_t>;
+
+} // namespace DuiLib
@@ -0,0 +1,102 @@
+#ifndef __UISTRINGTABLE_H__
+#define __UISTRINGTABLE_H__
+
+#pragma once
+
+// CStdStringPtrMap 的实现：字符串 -> 指针的散列表
+// 1. wyhash 风格的 64 位散列，一次处理 8 字节；
+// 2. 开放寻址 + robin hood 探测，负载超过 0.8 时自动扩容，删除时后移回填，不留墓碑；
+// 3. 条目按插入顺序存放在连续数组里，槽位只存散列值和条目下标，GetKeyAt 为 O(1)；
+// 4. key 复制到分块的字符池里，不再每个条目单独分配。块不会移动，GetKeyAt 返回的指针在该条目删除前一直有效。
+// 不依赖 Windows 头文件。
+
+#include <stddef.h>
+#include <vector>
+
+namespace DuiLib {
+
+	template<typename T>
+	class CStringPtrTableT
+	{
+	public:
+		struct Stats
+		{
+			size_t nCount;
+			size_t nSlots;
+			size_t nMaxProbe;			// 最长探测距离
+			size_t nPoolBlocks;
+			size_t nPoolChars;			// 字符池总容量（字符数）
+		};
+
+	public:
+		// 第一次插入时才分配内存
+		CStringPtrTableT();
+		~CStringPtrTableT();
+
+		void* Find(const T* pstrKey) const;
+		// key 已经存在时返回 false
+		bool Insert(const T* pstrKey, void* pData);
+		// 修改已有条目并返回旧值；不存在时插入，返回 NULL
+		void* Set(const T* pstrKey, void* pData);
+		bool Remove(const T* pstrKey);
+		// 删除所有条目并释放内存
+		void Clear();
+		// 预先分配 nCount 个条目需要的槽位
+		void Reserve(size_t nCount);
+
+		size_t GetSize() const { return m_aEntries.size(); }
+		// 删除条目时最后一个条目移到被删除的位置
+		const T* GetKeyAt(size_t iIndex) const;
+		void* GetDataAt(size_t iIndex) const;
+		Stats GetStats() const;
+
+		static unsigned long long Hash(const T* pstrKey, size_t nLen);
+
+	private:
+		CStringPtrTableT(const CStringPtrTableT&);
+		CStringPtrTableT& operator=(const CStringPtrTableT&);
+
+		struct Block
+		{
+			Block* pPrev;
+			Block* pNext;
+			size_t nUsed;
+			size_t nSize;
+			size_t nLive;				// 仍被条目使用的字符数，为 0 时整块释放
+			T* Data() { return reinterpret_cast<T*>(this + 1); }
+		};
+
+		struct Entry
+		{
+			const T* pstrKey;
+			Block* pBlock;
+			void* pData;
+			unsigned int nLen;
+			unsigned int nHash;
+		};
+
+		struct Slot
+		{
+			unsigned int nHash;
+			unsigned int nEntry;		// 条目下标 + 1，0 表示空槽
+		};
+
+		size_t _Lookup(const T* pstrKey, size_t nLen, unsigned int nHash) const;
+		void _Add(const T* pstrKey, size_t nLen, unsigned int nHash, void* pData);
+		void _Place(unsigned int nHash, unsigned int nEntry);
+		void _Rehash(size_t nSlots);
+		void _Erase(size_t nSlot);
+		const T* _CopyKey(const T* pstrKey, size_t nLen, Block*& pBlock);
+		void _ReleaseKey(const Entry& entry);
+		void _FreeBlocks();
+
+	private:
+		std::vector<Entry> m_aEntries;
+		Slot* m_pSlots;
+		size_t m_nMask;					// 槽位数 - 1，没有分配时为 0
+		Block* m_pHead;					// 最近分配的块在表头，新 key 写到表头的块
+	};
+
+} // namespace DuiLib
+
+#endif // __UISTRINGTABLE_H__
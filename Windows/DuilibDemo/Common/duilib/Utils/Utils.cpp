@@ -350,616 +350,57 @@ namespace DuiLib
 	}
 
 
-	/////////////////////////////////////////////////////////////////////////////////////
-	//
-	//
-
-	CDuiString::CDuiString() : m_pstr(m_szBuffer)
-	{
-		m_szBuffer[0] = '\0';
-	}
-
-	CDuiString::CDuiString(const TCHAR ch) : m_pstr(m_szBuffer)
-	{
-		m_szBuffer[0] = ch;
-		m_szBuffer[1] = '\0';
-	}
-
-	CDuiString::CDuiString(LPCTSTR lpsz, int nLen) : m_pstr(m_szBuffer)
-	{      
-		ASSERT(!::IsBadStringPtr(lpsz,-1) || lpsz==NULL);
-		m_szBuffer[0] = '\0';
-		Assign(lpsz, nLen);
-	}
-
-	CDuiString::CDuiString(const CDuiString& src) : m_pstr(m_szBuffer)
-	{
-		m_szBuffer[0] = '\0';
-		Assign(src.m_pstr);
-	}
-
-	CDuiString::~CDuiString()
-	{
-		if( m_pstr != m_szBuffer ) free(m_pstr);
-	}
-
-	int CDuiString::GetLength() const
-	{ 
-		return (int) _tcslen(m_pstr); 
-	}
-
-	CDuiString::operator LPCTSTR() const 
-	{ 
-		return m_pstr; 
-	}
-
-	void CDuiString::Append(LPCTSTR pstr)
-	{
-		int nNewLength = GetLength() + (int) _tcslen(pstr);
-		if( nNewLength >= MAX_LOCAL_STRING_LEN ) {
-			if( m_pstr == m_szBuffer ) {
-				m_pstr = static_cast<LPTSTR>(malloc((nNewLength + 1) * sizeof(TCHAR)));
-				_tcscpy(m_pstr, m_szBuffer);
-				_tcscat(m_pstr, pstr);
-			}
-			else {
-				m_pstr = static_cast<LPTSTR>(realloc(m_pstr, (nNewLength + 1) * sizeof(TCHAR)));
-				_tcscat(m_pstr, pstr);
-			}
-		}
-		else {
-			if( m_pstr != m_szBuffer ) {
-				free(m_pstr);
-				m_pstr = m_szBuffer;
-			}
-			_tcscat(m_szBuffer, pstr);
-		}
-	}
-
-	void CDuiString::Assign(LPCTSTR pstr, int cchMax)
-	{
-		if( pstr == NULL ) pstr = _T("");
-		cchMax = (cchMax < 0 ? (int) _tcslen(pstr) : cchMax);
-		if( cchMax < MAX_LOCAL_STRING_LEN ) {
-			if( m_pstr != m_szBuffer ) {
-				free(m_pstr);
-				m_pstr = m_szBuffer;
-			}
-		}
-		else if( cchMax > GetLength() || m_pstr == m_szBuffer ) {
-			if( m_pstr == m_szBuffer ) m_pstr = NULL;
-			m_pstr = static_cast<LPTSTR>(realloc(m_pstr, (cchMax + 1) * sizeof(TCHAR)));
-		}
-		_tcsncpy(m_pstr, pstr, cchMax);
-		m_pstr[cchMax] = '\0';
-	}
-
-	bool CDuiString::IsEmpty() const 
-	{ 
-		return m_pstr[0] == '\0'; 
-	}
-
-	void CDuiString::Empty() 
-	{ 
-		if( m_pstr != m_szBuffer ) free(m_pstr);
-		m_pstr = m_szBuffer;
-		m_szBuffer[0] = '\0'; 
-	}
-
-	LPCTSTR CDuiString::GetData() const
-	{
-		return m_pstr;
-	}
-
-	TCHAR CDuiString::GetAt(int nIndex) const
-	{
-		return m_pstr[nIndex];
-	}
-
-	TCHAR CDuiString::operator[] (int nIndex) const
-	{ 
-		return m_pstr[nIndex];
-	}   
-
-	const CDuiString& CDuiString::operator=(const CDuiString& src)
-	{      
-		Assign(src);
-		return *this;
-	}
-
-	const CDuiString& CDuiString::operator=(LPCTSTR lpStr)
-	{      
-		if ( lpStr )
-		{
-			ASSERT(!::IsBadStringPtr(lpStr,-1));
-			Assign(lpStr);
-		}
-		else
-		{
-			Empty();
-		}
-		return *this;
-	}
-
-#ifdef _UNICODE
-
-	const CDuiString& CDuiString::operator=(LPCSTR lpStr)
-	{
-		if ( lpStr )
-		{
-			ASSERT(!::IsBadStringPtrA(lpStr,-1));
-			int cchStr = (int) strlen(lpStr) + 1;
-			LPWSTR pwstr = (LPWSTR) _alloca(cchStr);
-			if( pwstr != NULL ) ::MultiByteToWideChar(::GetACP(), 0, lpStr, -1, pwstr, cchStr) ;
-			Assign(pwstr);
-		}
-		else
-		{
-			Empty();
-		}
-		return *this;
-	}
-
-	const CDuiString& CDuiString::operator+=(LPCSTR lpStr)
-	{
-		if ( lpStr )
-		{
-			ASSERT(!::IsBadStringPtrA(lpStr,-1));
-			int cchStr = (int) strlen(lpStr) + 1;
-			LPWSTR pwstr = (LPWSTR) _alloca(cchStr);
-			if( pwstr != NULL ) ::MultiByteToWideChar(::GetACP(), 0, lpStr, -1, pwstr, cchStr) ;
-			Append(pwstr);
-		}
-		
-		return *this;
-	}
-
-#else
-
-	const CDuiString& CDuiString::operator=(LPCWSTR lpwStr)
-	{      
-		if ( lpwStr )
-		{
-			ASSERT(!::IsBadStringPtrW(lpwStr,-1));
-			int cchStr = ((int) wcslen(lpwStr) * 2) + 1;
-			LPSTR pstr = (LPSTR) _alloca(cchStr);
-			if( pstr != NULL ) ::WideCharToMultiByte(::GetACP(), 0, lpwStr, -1, pstr, cchStr, NULL, NULL);
-			Assign(pstr);
-		}
-		else
-		{
-			Empty();
-		}
-		
-		return *this;
-	}
-
-	const CDuiString& CDuiString::operator+=(LPCWSTR lpwStr)
-	{
-		if ( lpwStr )
-		{
-			ASSERT(!::IsBadStringPtrW(lpwStr,-1));
-			int cchStr = ((int) wcslen(lpwStr) * 2) + 1;
-			LPSTR pstr = (LPSTR) _alloca(cchStr);
-			if( pstr != NULL ) ::WideCharToMultiByte(::GetACP(), 0, lpwStr, -1, pstr, cchStr, NULL, NULL);
-			Append(pstr);
-		}
-		
-		return *this;
-	}
-
-#endif // _UNICODE
-
-	const CDuiString& CDuiString::operator=(const TCHAR ch)
-	{
-		Empty();
-		m_szBuffer[0] = ch;
-		m_szBuffer[1] = '\0';
-		return *this;
-	}
-
-	CDuiString CDuiString::operator+(const CDuiString& src) const
-	{
-		CDuiString sTemp = *this;
-		sTemp.Append(src);
-		return sTemp;
-	}
-
-	CDuiString CDuiString::operator+(LPCTSTR lpStr) const
-	{
-		if ( lpStr )
-		{
-			ASSERT(!::IsBadStringPtr(lpStr,-1));
-			CDuiString sTemp = *this;
-			sTemp.Append(lpStr);
-			return sTemp;
-		}
-
-		return *this;
-	}
-
-	const CDuiString& CDuiString::operator+=(const CDuiString& src)
-	{      
-		Append(src);
-		return *this;
-	}
-
-	const CDuiString& CDuiString::operator+=(LPCTSTR lpStr)
-	{      
-		if ( lpStr )
-		{
-			ASSERT(!::IsBadStringPtr(lpStr,-1));
-			Append(lpStr);
-		}
-		
-		return *this;
-	}
-
-	const CDuiString& CDuiString::operator+=(const TCHAR ch)
-	{      
-		TCHAR str[] = { ch, '\0' };
-		Append(str);
-		return *this;
-	}
-
-	bool CDuiString::operator == (LPCTSTR str) const { return (Compare(str) == 0); };
-	bool CDuiString::operator != (LPCTSTR str) const { return (Compare(str) != 0); };
-	bool CDuiString::operator <= (LPCTSTR str) const { return (Compare(str) <= 0); };
-	bool CDuiString::operator <  (LPCTSTR str) const { return (Compare(str) <  0); };
-	bool CDuiString::operator >= (LPCTSTR str) const { return (Compare(str) >= 0); };
-	bool CDuiString::operator >  (LPCTSTR str) const { return (Compare(str) >  0); };
-
-	void CDuiString::SetAt(int nIndex, TCHAR ch)
-	{
-		ASSERT(nIndex>=0 && nIndex<GetLength());
-		m_pstr[nIndex] = ch;
-	}
-
-	int CDuiString::Compare(LPCTSTR lpsz) const 
-	{ 
-		return _tcscmp(m_pstr, lpsz); 
-	}
-
-	int CDuiString::CompareNoCase(LPCTSTR lpsz) const 
-	{ 
-		return _tcsicmp(m_pstr, lpsz); 
-	}
-
-	void CDuiString::MakeUpper() 
-	{ 
-		_tcsupr(m_pstr); 
-	}
-
-	void CDuiString::MakeLower() 
-	{ 
-		_tcslwr(m_pstr); 
-	}
-
-	CDuiString CDuiString::Left(int iLength) const
-	{
-		if( iLength < 0 ) iLength = 0;
-		if( iLength > GetLength() ) iLength = GetLength();
-		return CDuiString(m_pstr, iLength);
-	}
-
-	CDuiString CDuiString::Mid(int iPos, int iLength) const
-	{
-		if( iLength < 0 ) iLength = GetLength() - iPos;
-		if( iPos + iLength > GetLength() ) iLength = GetLength() - iPos;
-		if( iLength <= 0 ) return CDuiString();
-		return CDuiString(m_pstr + iPos, iLength);
-	}
-
-	CDuiString CDuiString::Right(int iLength) const
-	{
-		int iPos = GetLength() - iLength;
-		if( iPos < 0 ) {
-			iPos = 0;
-			iLength = GetLength();
-		}
-		return CDuiString(m_pstr + iPos, iLength);
-	}
-
-	int CDuiString::Find(TCHAR ch, int iPos /*= 0*/) const
-	{
-		ASSERT(iPos>=0 && iPos<=GetLength());
-		if( iPos != 0 && (iPos < 0 || iPos >= GetLength()) ) return -1;
-		LPCTSTR p = _tcschr(m_pstr + iPos, ch);
-		if( p == NULL ) return -1;
-		return (int)(p - m_pstr);
-	}
-
-	int CDuiString::Find(LPCTSTR pstrSub, int iPos /*= 0*/) const
-	{
-		ASSERT(!::IsBadStringPtr(pstrSub,-1));
-		ASSERT(iPos>=0 && iPos<=GetLength());
-		if( iPos != 0 && (iPos < 0 || iPos > GetLength()) ) return -1;
-		LPCTSTR p = _tcsstr(m_pstr + iPos, pstrSub);
-		if( p == NULL ) return -1;
-		return (int)(p - m_pstr);
-	}
-
-	int CDuiString::ReverseFind(TCHAR ch) const
-	{
-		LPCTSTR p = _tcsrchr(m_pstr, ch);
-		if( p == NULL ) return -1;
-		return (int)(p - m_pstr);
-	}
-
-	int CDuiString::Replace(LPCTSTR pstrFrom, LPCTSTR pstrTo)
-	{
-		CDuiString sTemp;
-		int nCount = 0;
-		int iPos = Find(pstrFrom);
-		if( iPos < 0 ) return 0;
-		int cchFrom = (int) _tcslen(pstrFrom);
-		int cchTo = (int) _tcslen(pstrTo);
-		while( iPos >= 0 ) {
-			sTemp = Left(iPos);
-			sTemp += pstrTo;
-			sTemp += Mid(iPos + cchFrom);
-			Assign(sTemp);
-			iPos = Find(pstrFrom, iPos + cchTo);
-			nCount++;
-		}
-		return nCount;
-	}
-    
-    int CDuiString::Format(LPCTSTR pstrFormat, ...)
-    {
-        int nRet;
-        va_list Args;
-
-        va_start(Args, pstrFormat);
-        nRet = InnerFormat(pstrFormat, Args);
-        va_end(Args);
-
-        return nRet;
-
-    }
-
-	int CDuiString::SmallFormat(LPCTSTR pstrFormat, ...)
-	{
-		CDuiString sFormat = pstrFormat;
-		TCHAR szBuffer[64] = { 0 };
-		va_list argList;
-		va_start(argList, pstrFormat);
-		int iRet = ::_vsntprintf(szBuffer, sizeof(szBuffer), sFormat, argList);
-		va_end(argList);
-		Assign(szBuffer);
-		return iRet;
-	}
-	
-    int CDuiString::InnerFormat(LPCTSTR pstrFormat, va_list Args)
-    {
-#if _MSC_VER <= 1400
-        TCHAR *szBuffer = NULL;
-        int size = 512, nLen, counts;
-        szBuffer = (TCHAR*)malloc(size);
-        ZeroMemory(szBuffer, size);
-        while (TRUE){
-            counts = size / sizeof(TCHAR);
-            nLen = _vsntprintf (szBuffer, counts, pstrFormat, Args);
-            if (nLen != -1 && nLen < counts){
-                break;
-            }
-            if (nLen == -1){
-                size *= 2;
-            }else{
-                size += 1 * sizeof(TCHAR);
-            }
-
-            if ((szBuffer = (TCHAR*)realloc(szBuffer, size)) != NULL){
-                ZeroMemory(szBuffer, size);
-            }else{
-                break;
-            }
-        }
-
-        Assign(szBuffer);
-        free(szBuffer);
-        return nLen;
-#else
-        int nLen, totalLen;
-        TCHAR *szBuffer;
-        nLen = _vsntprintf(NULL, 0, pstrFormat, Args);
-        totalLen = (nLen + 1)*sizeof(TCHAR);
-        szBuffer = (TCHAR*)malloc(totalLen);
-        ZeroMemory(szBuffer, totalLen);
-        nLen = _vsntprintf(szBuffer, nLen + 1, pstrFormat, Args);
-        Assign(szBuffer);
-        free(szBuffer);
-        return nLen;
-
-#endif
-    }
-
 	/////////////////////////////////////////////////////////////////////////////
 	//
 	//
 
-	static UINT HashKey(LPCTSTR Key)
-	{
-		UINT i = 0;
-		SIZE_T len = _tcslen(Key);
-		while( len-- > 0 ) i = (i << 5) + i + Key[len];
-		return i;
-	}
-
-	static UINT HashKey(const CDuiString& Key)
-	{
-		return HashKey((LPCTSTR)Key);
-	};
-
-	CStdStringPtrMap::CStdStringPtrMap(int nSize) : m_nCount(0)
+	CStdStringPtrMap::CStdStringPtrMap(int nSize)
 	{
-		if( nSize < 16 ) nSize = 16;
-		m_nBuckets = nSize;
-		m_aT = new TITEM*[nSize];
-		memset(m_aT, 0, nSize * sizeof(TITEM*));
 	}
 
 	CStdStringPtrMap::~CStdStringPtrMap()
 	{
-		if( m_aT ) {
-			int len = m_nBuckets;
-			while( len-- ) {
-				TITEM* pItem = m_aT[len];
-				while( pItem ) {
-					TITEM* pKill = pItem;
-					pItem = pItem->pNext;
-					delete pKill;
-				}
-			}
-			delete [] m_aT;
-			m_aT = NULL;
-		}
 	}
 
 	void CStdStringPtrMap::RemoveAll()
 	{
-		this->Resize(m_nBuckets);
+		m_table.Clear();
 	}
 
 	void CStdStringPtrMap::Resize(int nSize)
 	{
-		if( m_aT ) {
-			int len = m_nBuckets;
-			while( len-- ) {
-				TITEM* pItem = m_aT[len];
-				while( pItem ) {
-					TITEM* pKill = pItem;
-					pItem = pItem->pNext;
-					delete pKill;
-				}
-			}
-			delete [] m_aT;
-			m_aT = NULL;
-		}
-
-		if( nSize < 0 ) nSize = 0;
-		if( nSize > 0 ) {
-			m_aT = new TITEM*[nSize];
-			memset(m_aT, 0, nSize * sizeof(TITEM*));
-		} 
-		m_nBuckets = nSize;
-		m_nCount = 0;
+		m_table.Clear();
 	}
 
 	LPVOID CStdStringPtrMap::Find(LPCTSTR key, bool optimize) const
 	{
-		if( m_nBuckets == 0 || GetSize() == 0 ) return NULL;
-
-		UINT slot = HashKey(key) % m_nBuckets;
-		for( TITEM* pItem = m_aT[slot]; pItem; pItem = pItem->pNext ) {
-			if( pItem->Key == key ) {
-				if (optimize && pItem != m_aT[slot]) {
-					if (pItem->pNext) {
-						pItem->pNext->pPrev = pItem->pPrev;
-					}
-					pItem->pPrev->pNext = pItem->pNext;
-					pItem->pPrev = NULL;
-					pItem->pNext = m_aT[slot];
-					pItem->pNext->pPrev = pItem;
-					//将item移动至链条头部
-					m_aT[slot] = pItem;
-				}
-				return pItem->Data;
-			}        
-		}
-
-		return NULL;
+		return m_table.Find(key);
 	}
 
 	bool CStdStringPtrMap::Insert(LPCTSTR key, LPVOID pData)
 	{
-		if( m_nBuckets == 0 ) return false;
-		if( Find(key) ) return false;
-
-		// Add first in bucket
-		UINT slot = HashKey(key) % m_nBuckets;
-		TITEM* pItem = new TITEM;
-		pItem->Key = key;
-		pItem->Data = pData;
-		pItem->pPrev = NULL;
-		pItem->pNext = m_aT[slot];
-		if (pItem->pNext)
-			pItem->pNext->pPrev = pItem;
-		m_aT[slot] = pItem;
-		m_nCount++;
-		return true;
+		return m_table.Insert(key, pData);
 	}
 
 	LPVOID CStdStringPtrMap::Set(LPCTSTR key, LPVOID pData)
 	{
-		if( m_nBuckets == 0 ) return pData;
-
-		if (GetSize()>0) {
-			UINT slot = HashKey(key) % m_nBuckets;
-			// Modify existing item
-			for( TITEM* pItem = m_aT[slot]; pItem; pItem = pItem->pNext ) {
-				if( pItem->Key == key ) {
-					LPVOID pOldData = pItem->Data;
-					pItem->Data = pData;
-					return pOldData;
-				}
-			}
-		}
-
-		Insert(key, pData);
-		return NULL;
+		return m_table.Set(key, pData);
 	}
 
 	bool CStdStringPtrMap::Remove(LPCTSTR key)
 	{
-		if( m_nBuckets == 0 || GetSize() == 0 ) return false;
-
-		UINT slot = HashKey(key) % m_nBuckets;
-		TITEM** ppItem = &m_aT[slot];
-		while( *ppItem ) {
-			if( (*ppItem)->Key == key ) {
-				TITEM* pKill = *ppItem;
-				*ppItem = (*ppItem)->pNext;
-				if (*ppItem)
-					(*ppItem)->pPrev = pKill->pPrev;
-				delete pKill;
-				m_nCount--;
-				return true;
-			}
-			ppItem = &((*ppItem)->pNext);
-		}
-
-		return false;
+		return m_table.Remove(key);
 	}
 
 	int CStdStringPtrMap::GetSize() const
 	{
-#if 0//def _DEBUG
-		int nCount = 0;
-		int len = m_nBuckets;
-		while( len-- ) {
-			for( const TITEM* pItem = m_aT[len]; pItem; pItem = pItem->pNext ) nCount++;
-		}
-		ASSERT(m_nCount==nCount);
-#endif
-		return m_nCount;
+		return static_cast<int>(m_table.GetSize());
 	}
 
 	LPCTSTR CStdStringPtrMap::GetAt(int iIndex) const
 	{
-		if( m_nBuckets == 0 || GetSize() == 0 ) return false;
-
-		int pos = 0;
-		int len = m_nBuckets;
-		while( len-- ) {
-			for( TITEM* pItem = m_aT[len]; pItem; pItem = pItem->pNext ) {
-				if( pos++ == iIndex ) {
-					return pItem->Key.GetData();
-				}
-			}
-		}
-
-		return NULL;
+		if( iIndex < 0 ) return NULL;
+		return m_table.GetKeyAt(iIndex);
 	}
 
 	LPCTSTR CStdStringPtrMap::operator[] (int nIndex) const
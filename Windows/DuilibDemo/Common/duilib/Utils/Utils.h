@@ -4,6 +4,8 @@
 #pragma once
 #include "OAIdl.h"
 #include <vector>
+#include "UIStringTable.h"
+#include "UIString.h"
 
 namespace DuiLib
 {
@@ -130,78 +132,6 @@ namespace DuiLib
 	/////////////////////////////////////////////////////////////////////////////////////
 	//
 
-	class UILIB_API CDuiString
-	{
-	public:
-		enum { MAX_LOCAL_STRING_LEN = 63 };
-
-		CDuiString();
-		CDuiString(const TCHAR ch);
-		CDuiString(const CDuiString& src);
-		CDuiString(LPCTSTR lpsz, int nLen = -1);
-		~CDuiString();
-
-		void Empty();
-		int GetLength() const;
-		bool IsEmpty() const;
-		TCHAR GetAt(int nIndex) const;
-		void Append(LPCTSTR pstr);
-		void Assign(LPCTSTR pstr, int nLength = -1);
-		LPCTSTR GetData() const;
-
-		void SetAt(int nIndex, TCHAR ch);
-		operator LPCTSTR() const;
-
-		TCHAR operator[] (int nIndex) const;
-		const CDuiString& operator=(const CDuiString& src);
-		const CDuiString& operator=(const TCHAR ch);
-		const CDuiString& operator=(LPCTSTR pstr);
-#ifdef _UNICODE
-		const CDuiString& CDuiString::operator=(LPCSTR lpStr);
-		const CDuiString& CDuiString::operator+=(LPCSTR lpStr);
-#else
-		const CDuiString& CDuiString::operator=(LPCWSTR lpwStr);
-		const CDuiString& CDuiString::operator+=(LPCWSTR lpwStr);
-#endif
-		CDuiString operator+(const CDuiString& src) const;
-		CDuiString operator+(LPCTSTR pstr) const;
-		const CDuiString& operator+=(const CDuiString& src);
-		const CDuiString& operator+=(LPCTSTR pstr);
-		const CDuiString& operator+=(const TCHAR ch);
-
-		bool operator == (LPCTSTR str) const;
-		bool operator != (LPCTSTR str) const;
-		bool operator <= (LPCTSTR str) const;
-		bool operator <  (LPCTSTR str) const;
-		bool operator >= (LPCTSTR str) const;
-		bool operator >  (LPCTSTR str) const;
-
-		int Compare(LPCTSTR pstr) const;
-		int CompareNoCase(LPCTSTR pstr) const;
-
-		void MakeUpper();
-		void MakeLower();
-
-		CDuiString Left(int nLength) const;
-		CDuiString Mid(int iPos, int nLength = -1) const;
-		CDuiString Right(int nLength) const;
-
-		int Find(TCHAR ch, int iPos = 0) const;
-		int Find(LPCTSTR pstr, int iPos = 0) const;
-		int ReverseFind(TCHAR ch) const;
-		int Replace(LPCTSTR pstrFrom, LPCTSTR pstrTo);
-
-		int __cdecl Format(LPCTSTR pstrFormat, ...);
-		int __cdecl SmallFormat(LPCTSTR pstrFormat, ...);
-
-	protected:
-		int __cdecl InnerFormat(LPCTSTR pstrFormat, va_list Args);
-
-	protected:
-		LPTSTR m_pstr;
-		TCHAR m_szBuffer[MAX_LOCAL_STRING_LEN + 1];
-	};
-
 	static std::vector<CDuiString> StrSplit(CDuiString text, CDuiString sp)
 	{
 		std::vector<CDuiString> vResults;
@@ -219,6 +149,7 @@ namespace DuiLib
 	/////////////////////////////////////////////////////////////////////////////////////
 	//
 
+	// 旧的链式散列表的节点，CStdStringPtrMap 已不再使用，保留给外部代码
 	struct TITEM
 	{
 		CDuiString Key;
@@ -227,13 +158,17 @@ namespace DuiLib
 		struct TITEM* pNext;
 	};
 
+	// 字符串 -> 指针的散列表，实现见 CStringPtrTableT
+	// nSize 只为兼容旧接口，槽位随条目数自动扩容；GetAt 按插入顺序返回 key，Remove 会把最后一个条目移到被删除的位置
 	class UILIB_API CStdStringPtrMap
 	{
 	public:
 		CStdStringPtrMap(int nSize = 83);
 		~CStdStringPtrMap();
 
+		// 删除所有条目并释放内存
 		void Resize(int nSize = 83);
+		// optimize 已不再使用，查找不会修改散列表
 		LPVOID Find(LPCTSTR key, bool optimize = true) const;
 		bool Insert(LPCTSTR key, LPVOID pData);
 		LPVOID Set(LPCTSTR key, LPVOID pData);
@@ -244,9 +179,7 @@ namespace DuiLib
 		LPCTSTR operator[] (int nIndex) const;
 
 	protected:
-		TITEM** m_aT;
-		int m_nBuckets;
-		int m_nCount;
+		CStringPtrTableT<TCHAR> m_table;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -1,190 +1,841 @@
-#include "HttpClient.h"
+﻿#include "HttpClient.h"
 
 #include <assert.h>
-#include <memory>
+#include <string.h>
+#include <map>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <winhttp.h>
+#else
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+// 异步请求的工作线程数
+static const size_t kAsyncWorkerCount = 2;
 
 /**************************************************************************/
 
-HttpClient::HttpClient(const std::wstring& user_agent)
-    : m_user_agent(user_agent)
-    , m_hSession(NULL)
-    , m_hConnect(NULL)
-    , m_hRequest(NULL)
+#ifdef _WIN32
+
+// WinHttp 在同一个 session 内自动复用 keep-alive 连接，这里保持 session 和每个 host 的 connect 句柄。
+// 句柄按代引用计数：Close 只让当前这一代失效，正在使用它的请求结束后才真正关闭句柄，
+// 所以 http_close 不会关掉其他线程正在用的 connect 句柄，在回调里调用也不会等待自己
+class HttpConnectionPool
 {
+public:
+    explicit HttpConnectionPool(const std::wstring& user_agent)
+        : m_user_agent(user_agent)
+        , m_current(NULL)
+    {
+    }
 
-}
+    ~HttpConnectionPool()
+    {
+        Close();
+    }
 
-HttpClient::~HttpClient()
-{
-    http_close();
-}
+    DWORD Request(const std::wstring& url, const std::wstring& method
+        , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data);
 
-DWORD HttpClient::http_get(const std::wstring& url
-                           , const std::vector<std::wstring>& headers, std::string& resp_data)
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Generation* generation = m_current;
+        m_current = NULL;
+        if (NULL != generation && 0 == generation->users)
+        {
+            Destroy(generation);
+        }
+    }
+private:
+    struct Generation
+    {
+        HINTERNET hSession;
+        std::map<std::wstring, HINTERNET> connects;
+        int users;                  // 正在使用这一代句柄的请求数
+    };
+
+    static void Destroy(Generation* generation)
+    {
+        for (std::map<std::wstring, HINTERNET>::iterator it = generation->connects.begin(); generation->connects.end() != it; ++it)
+        {
+            ::WinHttpCloseHandle(it->second);
+        }
+        ::WinHttpCloseHandle(generation->hSession);
+        delete generation;
+    }
+
+    // 成功时 generation 的引用加一，请求结束后必须调用 ReleaseConnect
+    HINTERNET GetConnect(const std::wstring& host_name, INTERNET_PORT port, Generation*& generation, DWORD& error)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (NULL == m_current)
+        {
+            HINTERNET hSession = ::WinHttpOpen(m_user_agent.c_str()
+                , WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+            if (NULL == hSession)
+            {
+                error = ::GetLastError();
+                return NULL;
+            }
+            m_current = new Generation();
+            m_current->hSession = hSession;
+            m_current->users = 0;
+        }
+
+        wchar_t port_text[16] = { 0 };
+        ::swprintf_s(port_text, _countof(port_text), L":%u", port);
+        std::wstring key = host_name + port_text;
+        HINTERNET hConnect = NULL;
+        std::map<std::wstring, HINTERNET>::iterator it = m_current->connects.find(key);
+        if (m_current->connects.end() != it)
+        {
+            hConnect = it->second;
+        }
+        else
+        {
+            hConnect = ::WinHttpConnect(m_current->hSession, host_name.c_str(), port, 0);
+            if (NULL == hConnect)
+            {
+                error = ::GetLastError();
+                return NULL;
+            }
+            m_current->connects[key] = hConnect;
+        }
+
+        generation = m_current;
+        ++generation->users;
+        return hConnect;
+    }
+
+    void ReleaseConnect(Generation* generation)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (0 == --generation->users && generation != m_current)
+        {
+            Destroy(generation);
+        }
+    }
+private:
+    std::wstring m_user_agent;
+    std::mutex m_mutex;
+    Generation* m_current;
+};
+
+DWORD HttpConnectionPool::Request(const std::wstring& url, const std::wstring& method
+    , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
 {
-    DWORD ret = request(url, L"GET", headers, std::string(), resp_data);
-    http_close();
+    std::wstring host_name;
+    std::wstring url_path;
+    URL_COMPONENTS url_comp = {0};
+    url_comp.dwStructSize = sizeof(url_comp);
+
+    host_name.resize(url.size());
+    url_path.resize(url.size());
 
-    return ret;
+    url_comp.lpszHostName      = const_cast<wchar_t*>(host_name.data());
+    url_comp.dwHostNameLength  = static_cast<DWORD>(host_name.size());
+    url_comp.lpszUrlPath       = const_cast<wchar_t*>(url_path.data());
+    url_comp.dwUrlPathLength   = static_cast<DWORD>(url_path.size());
+    if (FALSE == ::WinHttpCrackUrl(url.c_str(), static_cast<DWORD>(url.size()), 0, &url_comp))
+    {
+        return ::GetLastError();
+    }
+    host_name.resize(url_comp.dwHostNameLength);
+    url_path.resize(url_comp.dwUrlPathLength);
+
+    DWORD error = ERROR_SUCCESS;
+    Generation* generation = NULL;
+    HINTERNET hConnect = GetConnect(host_name, url_comp.nPort, generation, error);
+    if (NULL == hConnect)
+    {
+        return error;
+    }
+
+    DWORD flags = (INTERNET_SCHEME_HTTP == url_comp.nScheme ? 0 : WINHTTP_FLAG_SECURE);
+    HINTERNET hRequest = ::WinHttpOpenRequest(hConnect, method.c_str(), url_path.c_str(),
+        NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
+    if (NULL == hRequest)
+    {
+        error = ::GetLastError();
+        ReleaseConnect(generation);
+        return error;
+    }
+
+    for (std::vector<std::wstring>::const_iterator it = headers.begin(); headers.end() != it; ++it)
+    {
+        ::WinHttpAddRequestHeaders(hRequest, it->c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_COALESCE);
+    }
+
+    DWORD ret = ERROR_SUCCESS;
+    WCHAR status_code[16] = {0};
+    DWORD buffer_length = sizeof(status_code);
+    void* body_data = body.empty() ? WINHTTP_NO_REQUEST_DATA : const_cast<char*>(body.data());
+    if (FALSE == ::WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0
+        , body_data, static_cast<DWORD>(body.size()), static_cast<DWORD>(body.size()), 0))
+    {
+        ret = ::GetLastError();
+    }
+    else if (FALSE == ::WinHttpReceiveResponse(hRequest, NULL))
+    {
+        ret = ::GetLastError();
+    }
+    else if (FALSE == ::WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE
+        , WINHTTP_HEADER_NAME_BY_INDEX, status_code, &buffer_length
+        , WINHTTP_NO_HEADER_INDEX))
+    {
+        ret = ::GetLastError();
+    }
+    else
+    {
+        // 直接读入 resp_data 的尾部，容量不够时由 string 按倍数扩容
+        DWORD size = 0;
+        while (TRUE == ::WinHttpQueryDataAvailable(hRequest, &size) && 0 != size)
+        {
+            size_t offset = resp_data.size();
+            resp_data.resize(offset + size);
+
+            DWORD read = 0;
+            if (FALSE == ::WinHttpReadData(hRequest, &resp_data[offset], size, &read))
+            {
+                resp_data.resize(offset);
+                ret = ::GetLastError();
+                break;
+            }
+            resp_data.resize(offset + read);
+        }
+    }
+    ::WinHttpCloseHandle(hRequest);
+    ReleaseConnect(generation);
+
+    if (ERROR_SUCCESS != ret)
+    {
+        return ret;
+    }
+
+    const WCHAR ok_status_code[] = { L'2', L'0', L'0', L'\0' };
+    if (0 != ::_wcsicmp(ok_status_code, status_code))
+    {
+        return EcHttpCodeError;
+    }
+
+    return ERROR_SUCCESS;
 }
 
-DWORD HttpClient::http_post(const std::wstring& url
-                           , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+#else
+
+struct HttpUrl
 {
-    DWORD ret = request(url, L"POST", headers, body, resp_data);
-    http_close();
+    bool secure;
+    std::string host;
+    unsigned short port;
+    std::string path;
+};
+
+static bool CrackUrl(const std::wstring& url, HttpUrl& result)
+{
+    std::string text;
+    for (size_t i = 0; i < url.size(); ++i)
+    {
+        text.push_back(url[i] < 0x80 ? static_cast<char>(url[i]) : '?');
+    }
 
-    return ret;
+    size_t pos = text.find("://");
+    if (std::string::npos == pos)
+    {
+        return false;
+    }
+    std::string scheme = text.substr(0, pos);
+    result.secure = (0 == strcasecmp(scheme.c_str(), "https"));
+    if (!result.secure && 0 != strcasecmp(scheme.c_str(), "http"))
+    {
+        return false;
+    }
+
+    pos += 3;
+    size_t path_pos = text.find('/', pos);
+    std::string authority = text.substr(pos, std::string::npos == path_pos ? std::string::npos : path_pos - pos);
+    result.path = (std::string::npos == path_pos ? "/" : text.substr(path_pos));
+    result.port = result.secure ? 443 : 80;
+
+    size_t colon = authority.rfind(':');
+    if (std::string::npos != colon)
+    {
+        result.port = static_cast<unsigned short>(atoi(authority.c_str() + colon + 1));
+        authority.resize(colon);
+    }
+    result.host = authority;
+    return !result.host.empty() && 0 != result.port;
 }
 
-DWORD HttpClient::http_put(const std::wstring& url
-	, const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+static std::string ToLower(const std::string& text)
 {
-    DWORD ret = request(url, L"PUT", headers, body, resp_data);
-    http_close();
+    std::string result(text);
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+        if (result[i] >= 'A' && result[i] <= 'Z')
+        {
+            result[i] = static_cast<char>(result[i] - 'A' + 'a');
+        }
+    }
+    return result;
+}
 
-    return ret;
+// 在 buffer 尾部追加最多 max_bytes 字节，返回 recv 的结果
+static ssize_t RecvAppend(int fd, std::string& buffer, size_t max_bytes)
+{
+    size_t offset = buffer.size();
+    buffer.resize(offset + max_bytes);
+    ssize_t count = ::recv(fd, &buffer[offset], max_bytes, 0);
+    buffer.resize(offset + (count > 0 ? static_cast<size_t>(count) : 0));
+    return count;
 }
 
-void HttpClient::http_close()
+// 按 host 保存空闲的 keep-alive socket。Close 之后，正在使用的连接用完直接关闭，不再放回
+class HttpConnectionPool
 {
-    if (m_hRequest)
+public:
+    explicit HttpConnectionPool(const std::wstring& user_agent)
+        : m_generation(0)
     {
-        WinHttpCloseHandle(m_hRequest);
-        m_hRequest = NULL;
+        for (size_t i = 0; i < user_agent.size(); ++i)
+        {
+            m_user_agent.push_back(user_agent[i] < 0x80 ? static_cast<char>(user_agent[i]) : '?');
+        }
     }
 
-    if (m_hConnect)
+    ~HttpConnectionPool()
     {
-        WinHttpCloseHandle(m_hConnect);
-        m_hConnect = NULL;
+        Close();
     }
 
-    if (m_hSession)
+    DWORD Request(const std::wstring& url, const std::wstring& method
+        , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data);
+
+    void Close()
     {
-        WinHttpCloseHandle(m_hSession);
-        m_hSession = NULL;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::map<std::string, std::vector<IdleConnection> >::iterator it = m_idle.begin(); m_idle.end() != it; ++it)
+        {
+            for (size_t i = 0; i < it->second.size(); ++i)
+            {
+                ::close(it->second[i].fd);
+            }
+        }
+        m_idle.clear();
+        ++m_generation;
     }
+private:
+    static const size_t kMaxIdlePerHost = 4;
+    static const int kIdleTimeoutSeconds = 30;
+    static const int kIoTimeoutSeconds = 30;
+
+    struct IdleConnection
+    {
+        int fd;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
+    int Acquire(const HttpUrl& url, const std::string& key, bool& reused, unsigned int& generation, DWORD& error);
+    void Release(const std::string& key, int fd, bool keep_alive, unsigned int generation);
+    static int Connect(const HttpUrl& url, DWORD& error);
+    static DWORD Exchange(int fd, const std::string& request, std::string& resp_data, int& status, bool& keep_alive, bool& received);
+private:
+    std::string m_user_agent;
+    std::mutex m_mutex;
+    std::map<std::string, std::vector<IdleConnection> > m_idle;
+    unsigned int m_generation;      // 每次 Close 加一
+};
+
+int HttpConnectionPool::Acquire(const HttpUrl& url, const std::string& key, bool& reused, unsigned int& generation, DWORD& error)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        generation = m_generation;
+        std::vector<IdleConnection>& idle = m_idle[key];
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        while (!idle.empty())
+        {
+            IdleConnection connection = idle.back();
+            idle.pop_back();
+            if (now - connection.idle_since < std::chrono::seconds(static_cast<int>(kIdleTimeoutSeconds)))
+            {
+                reused = true;
+                return connection.fd;
+            }
+            ::close(connection.fd);
+        }
+    }
+
+    reused = false;
+    return Connect(url, error);
 }
 
-DWORD HttpClient::request(const std::wstring& url, const std::wstring& method
-                          , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+void HttpConnectionPool::Release(const std::string& key, int fd, bool keep_alive, unsigned int generation)
 {
-    assert(NULL == m_hSession && NULL == m_hConnect && NULL == m_hRequest);
+    if (keep_alive)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<IdleConnection>& idle = m_idle[key];
+        if (generation == m_generation && idle.size() < kMaxIdlePerHost)
+        {
+            IdleConnection connection = { fd, std::chrono::steady_clock::now() };
+            idle.push_back(connection);
+            return;
+        }
+    }
+    ::close(fd);
+}
 
-    std::wstring host_name;
-    std::wstring url_path;
-    URL_COMPONENTS url_comp = {0};
-    url_comp.dwStructSize = sizeof(url_comp);
+int HttpConnectionPool::Connect(const HttpUrl& url, DWORD& error)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
 
-    host_name.resize(url.size());
-    url_path.resize(url.size());
+    char port[16] = { 0 };
+    snprintf(port, sizeof(port), "%u", url.port);
+    struct addrinfo* addrs = NULL;
+    int gai = ::getaddrinfo(url.host.c_str(), port, &hints, &addrs);
+    if (0 != gai)
+    {
+        error = (EAI_SYSTEM == gai ? errno : EHOSTUNREACH);
+        return -1;
+    }
 
-    url_comp.lpszHostName      = const_cast<wchar_t*>(host_name.data());
-    url_comp.dwHostNameLength  = host_name.size();
-    url_comp.lpszUrlPath       = const_cast<wchar_t*>(url_path.data());
-    url_comp.dwUrlPathLength   = url_path.size();
-    if (FALSE == ::WinHttpCrackUrl(url.c_str(), static_cast<DWORD>(url.size()), 0, &url_comp))
+    int fd = -1;
+    error = ECONNREFUSED;
+    for (struct addrinfo* addr = addrs; NULL != addr; addr = addr->ai_next)
     {
-        return ::GetLastError();
+        fd = ::socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0)
+        {
+            error = errno;
+            continue;
+        }
+        if (0 == ::connect(fd, addr->ai_addr, addr->ai_addrlen))
+        {
+            break;
+        }
+        error = errno;
+        ::close(fd);
+        fd = -1;
     }
+    ::freeaddrinfo(addrs);
 
-	m_hSession = ::WinHttpOpen(m_user_agent.c_str()
-        , WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-    if (NULL == m_hSession)
+    if (fd >= 0)
     {
-        return ::GetLastError();
+        struct timeval timeout = { kIoTimeoutSeconds, 0 };
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        int nodelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
     }
+    return fd;
+}
+
+DWORD HttpConnectionPool::Exchange(int fd, const std::string& request, std::string& resp_data, int& status, bool& keep_alive, bool& received)
+{
+    received = false;
+    keep_alive = false;
 
-	m_hConnect = ::WinHttpConnect(m_hSession, host_name.c_str(), url_comp.nPort, 0);
-    if (NULL == m_hConnect)
+    size_t sent = 0;
+    while (sent < request.size())
     {
-        return ::GetLastError();
+        ssize_t count = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0)
+        {
+            return (0 == count ? ECONNRESET : errno);
+        }
+        sent += static_cast<size_t>(count);
     }
 
-    DWORD flags = (INTERNET_SCHEME_HTTP == url_comp.nScheme ? 0 : WINHTTP_FLAG_SECURE);
-	m_hRequest = ::WinHttpOpenRequest(m_hConnect, method.c_str(), url_path.c_str(),
-        NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-    if (NULL == m_hRequest)
+    // 读取响应头
+    std::string buffer;
+    size_t header_end = std::string::npos;
+    while (std::string::npos == (header_end = buffer.find("\r\n\r\n")))
     {
-        return ::GetLastError();
+        ssize_t count = RecvAppend(fd, buffer, 4096);
+        if (count <= 0)
+        {
+            return (0 == count ? ECONNRESET : errno);
+        }
+        received = true;
     }
 
-    for (std::vector<std::wstring>::const_iterator it = headers.begin(); headers.end() != it; ++it)
+    std::string head = buffer.substr(0, header_end);
+    size_t pos = header_end + 4;
+    int major = 0;
+    int minor = 0;
+    if (3 != sscanf(head.c_str(), "HTTP/%d.%d %d", &major, &minor, &status))
     {
-        ::WinHttpAddRequestHeaders(m_hRequest, it->c_str(), (ULONG)-1L, WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_COALESCE);
+        return EcHttpProtocolError;
     }
 
-    if (0 == method.compare(L"GET"))
+    bool chunked = false;
+    bool has_length = false;
+    size_t content_length = 0;
+    keep_alive = (major > 1 || (1 == major && minor >= 1));
+    size_t line_start = head.find("\r\n");
+    while (std::string::npos != line_start)
     {
-        ::WinHttpSendRequest(m_hRequest, WINHTTP_NO_ADDITIONAL_HEADERS,
-            0, WINHTTP_NO_REQUEST_DATA, 0,
-            0, 0);
+        line_start += 2;
+        size_t line_end = head.find("\r\n", line_start);
+        std::string line = head.substr(line_start, std::string::npos == line_end ? std::string::npos : line_end - line_start);
+        size_t colon = line.find(':');
+        if (std::string::npos != colon)
+        {
+            std::string name = ToLower(line.substr(0, colon));
+            std::string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            if ("content-length" == name)
+            {
+                has_length = true;
+                content_length = static_cast<size_t>(strtoull(value.c_str(), NULL, 10));
+            }
+            else if ("transfer-encoding" == name)
+            {
+                chunked = (std::string::npos != ToLower(value).find("chunked"));
+            }
+            else if ("connection" == name)
+            {
+                std::string lower = ToLower(value);
+                if (std::string::npos != lower.find("close"))
+                {
+                    keep_alive = false;
+                }
+                else if (std::string::npos != lower.find("keep-alive"))
+                {
+                    keep_alive = true;
+                }
+            }
+        }
+        line_start = line_end;
     }
-    else if (0 == method.compare(L"POST"))
+
+    if (204 == status || 304 == status || (status >= 100 && status < 200))
     {
-        const void* body_data = reinterpret_cast<const void*>(body.c_str());
-        ::WinHttpSendRequest(m_hRequest, WINHTTP_NO_ADDITIONAL_HEADERS,
-            0, const_cast<void*>(body_data), body.size(),
-            body.size(), 0);
+        return ERROR_SUCCESS;
     }
-	else if (0 == method.compare(L"PUT"))
-	{
-		const void* body_data = reinterpret_cast<const void*>(body.c_str());
-		::WinHttpSendRequest(m_hRequest, WINHTTP_NO_ADDITIONAL_HEADERS,
-			0, const_cast<void*>(body_data), body.size(),
-			body.size(), 0);
-	}
 
-    if (ERROR_SUCCESS != ::GetLastError())
+    if (chunked)
     {
-        return ::GetLastError();
+        for (;;)
+        {
+            size_t line_end = std::string::npos;
+            while (std::string::npos == (line_end = buffer.find("\r\n", pos)))
+            {
+                if (RecvAppend(fd, buffer, 4096) <= 0)
+                {
+                    return EcHttpProtocolError;
+                }
+            }
+            size_t chunk_size = static_cast<size_t>(strtoull(buffer.c_str() + pos, NULL, 16));
+            pos = line_end + 2;
+            if (0 == chunk_size)
+            {
+                // 跳过 trailer，直到空行
+                for (;;)
+                {
+                    while (std::string::npos == (line_end = buffer.find("\r\n", pos)))
+                    {
+                        if (RecvAppend(fd, buffer, 4096) <= 0)
+                        {
+                            return EcHttpProtocolError;
+                        }
+                    }
+                    if (line_end == pos)
+                    {
+                        return ERROR_SUCCESS;
+                    }
+                    pos = line_end + 2;
+                }
+            }
+
+            resp_data.reserve(resp_data.size() + chunk_size);
+            while (buffer.size() < pos + chunk_size + 2)
+            {
+                if (RecvAppend(fd, buffer, pos + chunk_size + 2 - buffer.size()) <= 0)
+                {
+                    return EcHttpProtocolError;
+                }
+            }
+            resp_data.append(buffer, pos, chunk_size);
+            pos += chunk_size + 2;
+            if (pos >= 64 * 1024)
+            {
+                buffer.erase(0, pos);
+                pos = 0;
+            }
+        }
     }
 
-    if (FALSE == ::WinHttpReceiveResponse(m_hRequest, NULL))
+    if (has_length)
     {
-        return ::GetLastError();
+        // 已读到的部分直接拷贝，剩余部分直接 recv 到 resp_data 尾部
+        size_t offset = resp_data.size();
+        resp_data.reserve(offset + content_length);
+        resp_data.append(buffer, pos, std::min(content_length, buffer.size() - pos));
+        while (resp_data.size() - offset < content_length)
+        {
+            if (RecvAppend(fd, resp_data, content_length - (resp_data.size() - offset)) <= 0)
+            {
+                return EcHttpProtocolError;
+            }
+        }
+        return ERROR_SUCCESS;
     }
 
-    WCHAR status_code[16] = {0};
-    DWORD buffer_length = _countof(status_code);
-    if (FALSE == ::WinHttpQueryHeaders(m_hRequest, WINHTTP_QUERY_STATUS_CODE
-        , WINHTTP_HEADER_NAME_BY_INDEX, status_code, &buffer_length
-        , WINHTTP_NO_HEADER_INDEX))
+    // 没有长度信息，读到连接关闭为止
+    keep_alive = false;
+    resp_data.append(buffer, pos, std::string::npos);
+    for (;;)
     {
-        return ::GetLastError();
+        ssize_t count = RecvAppend(fd, resp_data, 16 * 1024);
+        if (0 == count)
+        {
+            return ERROR_SUCCESS;
+        }
+        if (count < 0)
+        {
+            return errno;
+        }
+    }
+}
+
+DWORD HttpConnectionPool::Request(const std::wstring& url, const std::wstring& method
+    , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+{
+    HttpUrl http_url;
+    if (!CrackUrl(url, http_url))
+    {
+        return EINVAL;
     }
+    if (http_url.secure)
+    {
+        return EcHttpUnsupported;
+    }
+
+    char port[16] = { 0 };
+    snprintf(port, sizeof(port), ":%u", http_url.port);
+    std::string key = http_url.host + port;
 
-    DWORD size = 0;
-    while (TRUE == ::WinHttpQueryDataAvailable(m_hRequest, &size))
+    std::string request;
+    request.reserve(256 + body.size());
+    for (size_t i = 0; i < method.size(); ++i)
+    {
+        request.push_back(static_cast<char>(method[i]));
+    }
+    request.append(" ").append(http_url.path).append(" HTTP/1.1\r\nHost: ").append(http_url.host);
+    if (80 != http_url.port)
     {
-        if (0 == size)
+        request.append(port);
+    }
+    request.append("\r\nUser-Agent: ").append(m_user_agent).append("\r\nConnection: keep-alive\r\n");
+    for (std::vector<std::wstring>::const_iterator it = headers.begin(); headers.end() != it; ++it)
+    {
+        for (size_t i = 0; i < it->size(); ++i)
         {
-            break;
+            request.push_back((*it)[i] < 0x80 ? static_cast<char>((*it)[i]) : '?');
         }
+        request.append("\r\n");
+    }
+    if (!body.empty() || 0 != method.compare(L"GET"))
+    {
+        char length[48] = { 0 };
+        snprintf(length, sizeof(length), "Content-Length: %u\r\n", static_cast<unsigned int>(body.size()));
+        request.append(length);
+    }
+    request.append("\r\n").append(body);
 
-        std::unique_ptr<char[]> buffer(new char[size]);
-        if (NULL == buffer.get())
+    // 复用的连接可能已被服务器关闭，这种情况下没有收到任何响应，换新连接重试一次
+    size_t resp_offset = resp_data.size();
+    for (int attempt = 0; ; ++attempt)
+    {
+        bool reused = false;
+        unsigned int generation = 0;
+        DWORD error = ERROR_SUCCESS;
+        int fd = Acquire(http_url, key, reused, generation, error);
+        if (fd < 0)
         {
-            break;
+            return error;
         }
 
-        DWORD lpdwNumberOfBytesRead = 0;
-        if (TRUE == ::WinHttpReadData(m_hRequest, buffer.get(), size, &lpdwNumberOfBytesRead))
+        int status = 0;
+        bool keep_alive = false;
+        bool received = false;
+        error = Exchange(fd, request, resp_data, status, keep_alive, received);
+        if (ERROR_SUCCESS == error)
         {
-            resp_data.append(buffer.get(), static_cast<size_t>(lpdwNumberOfBytesRead));
+            Release(key, fd, keep_alive, generation);
+            return (200 == status ? ERROR_SUCCESS : EcHttpCodeError);
         }
-        else
+
+        ::close(fd);
+        resp_data.resize(resp_offset);
+        if (!reused || received || attempt > 0)
         {
-            return ::GetLastError();
+            return error;
         }
     }
+}
 
-	const WCHAR ok_status_code[] = { L'2', L'0', L'0', L'\0' };
-	if (0 != ::_wcsicmp(ok_status_code, status_code))
-	{
-		return EcHttpCodeError;
-	}
+#endif
 
-    return ERROR_SUCCESS;
+/**************************************************************************/
+
+HttpClient::HttpClient(const std::wstring& user_agent)
+    : m_user_agent(user_agent)
+    , m_pool(new HttpConnectionPool(user_agent))
+    , m_stop(false)
+{
+
+}
+
+HttpClient::~HttpClient()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_task_mutex);
+        m_stop = true;
+    }
+    abort_pending_tasks();
+    m_task_cond.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].join();
+    }
+
+    delete m_pool;
+    m_pool = NULL;
+}
+
+DWORD HttpClient::http_get(const std::wstring& url
+                           , const std::vector<std::wstring>& headers, std::string& resp_data)
+{
+    return request(url, L"GET", headers, std::string(), resp_data);
+}
+
+DWORD HttpClient::http_post(const std::wstring& url
+                           , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+{
+    return request(url, L"POST", headers, body, resp_data);
+}
+
+DWORD HttpClient::http_put(const std::wstring& url
+    , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+{
+    return request(url, L"PUT", headers, body, resp_data);
+}
+
+void HttpClient::http_get_async(const std::wstring& url
+    , const std::vector<std::wstring>& headers, HttpCallback callback)
+{
+    AsyncTask task;
+    task.url = url;
+    task.method = L"GET";
+    task.headers = headers;
+    task.callback = callback;
+    post_task(task);
+}
+
+void HttpClient::http_post_async(const std::wstring& url
+    , const std::vector<std::wstring>& headers, const std::string& body, HttpCallback callback)
+{
+    AsyncTask task;
+    task.url = url;
+    task.method = L"POST";
+    task.headers = headers;
+    task.body = body;
+    task.callback = callback;
+    post_task(task);
+}
+
+void HttpClient::http_close()
+{
+    abort_pending_tasks();
+    m_pool->Close();
+}
+
+DWORD HttpClient::request(const std::wstring& url, const std::wstring& method
+                          , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data)
+{
+    return m_pool->Request(url, method, headers, body, resp_data);
+}
+
+void HttpClient::post_task(AsyncTask& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_task_mutex);
+        if (!m_stop)
+        {
+            if (m_workers.empty())
+            {
+                for (size_t i = 0; i < kAsyncWorkerCount; ++i)
+                {
+                    m_workers.push_back(std::thread(&HttpClient::worker_proc, this));
+                }
+            }
+            m_tasks.push_back(std::move(task));
+            m_task_cond.notify_one();
+            return;
+        }
+    }
+
+    if (task.callback)
+    {
+        task.callback(EcHttpAborted, std::string());
+    }
+}
+
+void HttpClient::worker_proc()
+{
+    for (;;)
+    {
+        AsyncTask task;
+        {
+            std::unique_lock<std::mutex> lock(m_task_mutex);
+            m_task_cond.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        std::string resp_data;
+        DWORD ret = request(task.url, task.method, task.headers, task.body, resp_data);
+        if (task.callback)
+        {
+            task.callback(ret, resp_data);
+        }
+    }
+}
+
+void HttpClient::abort_pending_tasks()
+{
+    std::deque<AsyncTask> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_task_mutex);
+        tasks.swap(m_tasks);
+    }
+
+    for (std::deque<AsyncTask>::iterator it = tasks.begin(); tasks.end() != it; ++it)
+    {
+        if (it->callback)
+        {
+            it->callback(EcHttpAborted, std::string());
+        }
+    }
 }
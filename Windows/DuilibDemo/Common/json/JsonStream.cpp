@@ -0,0 +1,793 @@
+﻿#include "JsonStream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////////////CJsonPullReader
+
+CJsonPullReader::CJsonPullReader(const char* data, size_t size)
+    : m_begin(data)
+    , m_end(data + size)
+    , m_cursor(data)
+{
+    // 与 Json::Reader 一样忽略 UTF-8 BOM
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        m_cursor += 3;
+}
+
+CJsonPullReader::Token CJsonPullReader::Fail()
+{
+    m_textBegin = m_textEnd = m_cursor;
+    return m_token = TokenError;
+}
+
+void CJsonPullReader::SkipSpace()
+{
+    while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\r' || *m_cursor == '\n'))
+        ++m_cursor;
+}
+
+CJsonPullReader::Token CJsonPullReader::Next()
+{
+    if (m_started && (m_token == TokenError || m_token == TokenEnd))
+        return m_token;
+
+    SkipSpace();
+    if (!m_started)
+    {
+        m_started = true;
+        return ReadValue();
+    }
+
+    if (m_depth == 0)
+    {
+        if (m_cursor != m_end)
+            return Fail();
+        m_textBegin = m_textEnd = m_cursor;
+        return m_token = TokenEnd;
+    }
+
+    if (m_token == TokenKey)
+        return ReadValue();
+
+    if (m_cursor >= m_end)
+        return Fail();
+
+    bool inArray = ((m_arrayBits >> (m_depth - 1)) & 1) != 0;
+    char close = inArray ? ']' : '}';
+    if (*m_cursor == close)
+    {
+        m_textBegin = m_cursor;
+        m_textEnd = ++m_cursor;
+        m_arrayBits &= ~(1ULL << (m_depth - 1));
+        --m_depth;
+        m_first = false;
+        return m_token = inArray ? TokenEndArray : TokenEndObject;
+    }
+
+    if (!m_first)
+    {
+        if (*m_cursor != ',')
+            return Fail();
+        ++m_cursor;
+        SkipSpace();
+    }
+
+    if (inArray)
+        return ReadValue();
+
+    if (m_cursor >= m_end || *m_cursor != '"')
+        return Fail();
+    if (ReadString(TokenKey) == TokenError)
+        return TokenError;
+    SkipSpace();
+    if (m_cursor >= m_end || *m_cursor != ':')
+        return Fail();
+    ++m_cursor;
+    m_first = false;
+    return m_token;
+}
+
+CJsonPullReader::Token CJsonPullReader::ReadValue()
+{
+    if (m_cursor >= m_end)
+        return Fail();
+
+    switch (*m_cursor)
+    {
+    case '{':
+    case '[':
+    {
+        if (m_depth >= kMaxDepth)
+            return Fail();
+        bool isArray = *m_cursor == '[';
+        if (isArray)
+            m_arrayBits |= 1ULL << m_depth;
+        ++m_depth;
+        m_first = true;
+        m_textBegin = m_cursor;
+        m_textEnd = ++m_cursor;
+        return m_token = isArray ? TokenBeginArray : TokenBeginObject;
+    }
+    case '"':
+        m_first = false;
+        return ReadString(TokenString);
+    case 't':
+        m_first = false;
+        return ReadLiteral("true", 4, TokenTrue);
+    case 'f':
+        m_first = false;
+        return ReadLiteral("false", 5, TokenFalse);
+    case 'n':
+        m_first = false;
+        return ReadLiteral("null", 4, TokenNull);
+    default:
+        m_first = false;
+        return ReadNumber();
+    }
+}
+
+static inline bool IsHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+CJsonPullReader::Token CJsonPullReader::ReadString(Token token)
+{
+    const char* p = m_cursor + 1;
+    bool escaped = false;
+    while (true)
+    {
+        if (p >= m_end)
+            return Fail();
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"')
+            break;
+        if (c < 0x20)
+        {
+            m_cursor = p;
+            return Fail();
+        }
+        if (c == '\\')
+        {
+            escaped = true;
+            if (++p >= m_end)
+                return Fail();
+            switch (*p)
+            {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                if (m_end - p < 5 || !IsHexDigit(p[1]) || !IsHexDigit(p[2]) || !IsHexDigit(p[3]) || !IsHexDigit(p[4]))
+                {
+                    m_cursor = p;
+                    return Fail();
+                }
+                p += 4;
+                break;
+            default:
+                m_cursor = p;
+                return Fail();
+            }
+        }
+        ++p;
+    }
+
+    m_textBegin = m_cursor + 1;
+    m_textEnd = p;
+    m_textEscaped = escaped;
+    m_cursor = p + 1;
+    return m_token = token;
+}
+
+CJsonPullReader::Token CJsonPullReader::ReadNumber()
+{
+    const char* p = m_cursor;
+    if (p < m_end && *p == '-')
+        ++p;
+    if (p >= m_end || *p < '0' || *p > '9')
+        return Fail();
+    if (*p == '0')
+        ++p;
+    else
+    {
+        while (p < m_end && *p >= '0' && *p <= '9')
+            ++p;
+    }
+    if (p < m_end && *p == '.')
+    {
+        ++p;
+        if (p >= m_end || *p < '0' || *p > '9')
+            return Fail();
+        while (p < m_end && *p >= '0' && *p <= '9')
+            ++p;
+    }
+    if (p < m_end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        if (p < m_end && (*p == '+' || *p == '-'))
+            ++p;
+        if (p >= m_end || *p < '0' || *p > '9')
+            return Fail();
+        while (p < m_end && *p >= '0' && *p <= '9')
+            ++p;
+    }
+
+    m_textBegin = m_cursor;
+    m_textEnd = p;
+    m_textEscaped = false;
+    m_cursor = p;
+    return m_token = TokenNumber;
+}
+
+CJsonPullReader::Token CJsonPullReader::ReadLiteral(const char* literal, size_t size, Token token)
+{
+    if (static_cast<size_t>(m_end - m_cursor) < size || memcmp(m_cursor, literal, size) != 0)
+        return Fail();
+    m_textBegin = m_cursor;
+    m_textEnd = m_cursor + size;
+    m_textEscaped = false;
+    m_cursor += size;
+    return m_token = token;
+}
+
+bool CJsonPullReader::SkipContainer()
+{
+    if (m_token != TokenBeginObject && m_token != TokenBeginArray)
+        return m_token != TokenError;
+
+    // 只匹配括号和字符串边界，被跳过的子树不做完整的语法检查
+    int level = 1;
+    const char* p = m_cursor;
+    while (p < m_end)
+    {
+        char c = *p++;
+        if (c == '"')
+        {
+            while (p < m_end && *p != '"')
+                p += (*p == '\\') ? 2 : 1;
+            if (p >= m_end)
+                break;
+            ++p;
+        }
+        else if (c == '{' || c == '[')
+        {
+            ++level;
+        }
+        else if (c == '}' || c == ']')
+        {
+            if (--level == 0)
+            {
+                bool isArray = m_token == TokenBeginArray;
+                if (c != (isArray ? ']' : '}'))
+                    break;
+                m_textBegin = p - 1;
+                m_textEnd = p;
+                m_cursor = p;
+                m_arrayBits &= ~(1ULL << (m_depth - 1));
+                --m_depth;
+                m_first = false;
+                m_token = isArray ? TokenEndArray : TokenEndObject;
+                return true;
+            }
+        }
+    }
+    m_cursor = p < m_end ? p : m_end;
+    Fail();
+    return false;
+}
+
+static void AppendUtf8(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+static uint32_t ReadHex4(const char* p)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            value |= c - 'a' + 10;
+        else
+            value |= c - 'A' + 10;
+    }
+    return value;
+}
+
+bool CJsonPullReader::GetString(std::string& value) const
+{
+    if (m_token != TokenString && m_token != TokenKey)
+        return false;
+
+    value.clear();
+    if (!m_textEscaped)
+    {
+        value.assign(m_textBegin, m_textEnd);
+        return true;
+    }
+
+    value.reserve(m_textEnd - m_textBegin);
+    for (const char* p = m_textBegin; p < m_textEnd; ++p)
+    {
+        if (*p != '\\')
+        {
+            value.push_back(*p);
+            continue;
+        }
+        ++p;
+        switch (*p)
+        {
+        case 'b': value.push_back('\b'); break;
+        case 'f': value.push_back('\f'); break;
+        case 'n': value.push_back('\n'); break;
+        case 'r': value.push_back('\r'); break;
+        case 't': value.push_back('\t'); break;
+        case 'u':
+        {
+            uint32_t cp = ReadHex4(p + 1);
+            p += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                // 代理对必须紧跟低位代理
+                if (m_textEnd - p < 7 || p[1] != '\\' || p[2] != 'u')
+                    return false;
+                uint32_t low = ReadHex4(p + 3);
+                if (low < 0xDC00 || low > 0xDFFF)
+                    return false;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                p += 6;
+            }
+            AppendUtf8(value, cp);
+            break;
+        }
+        default:
+            value.push_back(*p);    // '"' '\\' '/'
+            break;
+        }
+    }
+    return true;
+}
+
+bool CJsonPullReader::TextEquals(const char* text, size_t size) const
+{
+    if (m_token != TokenString && m_token != TokenKey)
+        return false;
+    if (!m_textEscaped)
+        return TextSize() == size && memcmp(m_textBegin, text, size) == 0;
+
+    std::string decoded;
+    return GetString(decoded) && decoded.size() == size && memcmp(decoded.data(), text, size) == 0;
+}
+
+bool CJsonPullReader::GetUInt64(uint64_t& value) const
+{
+    if (m_token != TokenNumber || *m_textBegin == '-')
+        return false;
+    uint64_t result = 0;
+    for (const char* p = m_textBegin; p < m_textEnd; ++p)
+    {
+        if (*p < '0' || *p > '9')
+            return false;       // 小数或指数形式
+        uint64_t digit = *p - '0';
+        if (result > (UINT64_MAX - digit) / 10)
+            return false;
+        result = result * 10 + digit;
+    }
+    value = result;
+    return true;
+}
+
+bool CJsonPullReader::GetInt64(int64_t& value) const
+{
+    if (m_token != TokenNumber)
+        return false;
+    bool negative = *m_textBegin == '-';
+    uint64_t magnitude = 0;
+    for (const char* p = m_textBegin + (negative ? 1 : 0); p < m_textEnd; ++p)
+    {
+        if (*p < '0' || *p > '9')
+            return false;
+        uint64_t digit = *p - '0';
+        if (magnitude > (UINT64_MAX - digit) / 10)
+            return false;
+        magnitude = magnitude * 10 + digit;
+    }
+    if (negative)
+    {
+        if (magnitude > static_cast<uint64_t>(INT64_MAX) + 1)
+            return false;
+        value = static_cast<int64_t>(0 - magnitude);
+    }
+    else
+    {
+        if (magnitude > static_cast<uint64_t>(INT64_MAX))
+            return false;
+        value = static_cast<int64_t>(magnitude);
+    }
+    return true;
+}
+
+bool CJsonPullReader::GetDouble(double& value) const
+{
+    if (m_token != TokenNumber)
+        return false;
+    // 输入缓冲不以 '\0' 结尾，拷到栈上再交给 strtod
+    char buffer[64];
+    size_t size = TextSize();
+    if (size >= sizeof(buffer))
+        return false;
+    memcpy(buffer, m_textBegin, size);
+    buffer[size] = '\0';
+    value = strtod(buffer, NULL);
+    return true;
+}
+
+bool CJsonPullReader::GetBool(bool& value) const
+{
+    if (m_token != TokenTrue && m_token != TokenFalse)
+        return false;
+    value = m_token == TokenTrue;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////JsonSelect
+
+namespace
+{
+    struct SelectSegment
+    {
+        const char* key;        // 数组元素或含转义的成员名为 NULL
+        size_t keySize;
+        bool isIndex;
+        size_t index;
+    };
+
+    enum PathMatch
+    {
+        PathMismatch,
+        PathEqual,
+        PathPrefix,             // 当前位置是路径的真前缀，需要进入容器
+    };
+
+    PathMatch MatchPath(const char* path, const SelectSegment* segments, int count, size_t& arrayIndex)
+    {
+        const char* p = path;
+        arrayIndex = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (segments[i].isIndex)
+            {
+                if (p[0] != '[' || p[1] != ']')
+                    return PathMismatch;
+                p += 2;
+                arrayIndex = segments[i].index;
+                continue;
+            }
+
+            if (i > 0)
+            {
+                if (*p != '.')
+                    return PathMismatch;
+                ++p;
+            }
+            const SelectSegment& segment = segments[i];
+            if (segment.key == NULL)
+                return PathMismatch;
+            size_t matched = 0;
+            while (*p != '\0' && *p != '.' && *p != '[')
+            {
+                char c = *p++;
+                if (c == '\\' && *p != '\0')
+                    c = *p++;
+                if (matched >= segment.keySize || segment.key[matched] != c)
+                    return PathMismatch;
+                ++matched;
+            }
+            if (matched != segment.keySize)
+                return PathMismatch;
+        }
+        return *p == '\0' ? PathEqual : PathPrefix;
+    }
+}
+
+bool JsonSelect(const char* data, size_t size, const char* const* paths, size_t pathCount, IJsonSelectHandler& handler)
+{
+    CJsonPullReader reader(data, size);
+    SelectSegment segments[CJsonPullReader::kMaxDepth];
+    size_t elementCount[CJsonPullReader::kMaxDepth];
+    const char* key = NULL;
+    size_t keySize = 0;
+
+    while (true)
+    {
+        CJsonPullReader::Token token = reader.Next();
+        switch (token)
+        {
+        case CJsonPullReader::TokenError:
+            return false;
+        case CJsonPullReader::TokenEnd:
+            return true;
+        case CJsonPullReader::TokenEndObject:
+        case CJsonPullReader::TokenEndArray:
+            continue;
+        case CJsonPullReader::TokenKey:
+        {
+            bool plain = reader.TextSize() == 0 || memchr(reader.TextBegin(), '\\', reader.TextSize()) == NULL;
+            key = plain ? reader.TextBegin() : NULL;
+            keySize = reader.TextSize();
+            continue;
+        }
+        default:
+            break;
+        }
+
+        // 值所在的路径长度等于父容器的深度
+        bool isContainer = token == CJsonPullReader::TokenBeginObject || token == CJsonPullReader::TokenBeginArray;
+        int level = reader.Depth() - (isContainer ? 1 : 0);
+        if (level > 0)
+        {
+            SelectSegment& segment = segments[level - 1];
+            bool parentIsArray = key == NULL && elementCount[level - 1] != static_cast<size_t>(-1);
+            if (parentIsArray)
+            {
+                segment.key = NULL;
+                segment.keySize = 0;
+                segment.isIndex = true;
+                segment.index = elementCount[level - 1]++;
+            }
+            else
+            {
+                segment.key = key;
+                segment.keySize = keySize;
+                segment.isIndex = false;
+                segment.index = 0;
+            }
+        }
+        key = NULL;
+
+        bool descend = false;
+        for (size_t i = 0; i < pathCount; ++i)
+        {
+            size_t arrayIndex = 0;
+            PathMatch match = MatchPath(paths[i], segments, level, arrayIndex);
+            if (match == PathEqual)
+            {
+                if (!handler.OnValue(i, arrayIndex, reader))
+                    return true;
+            }
+            else if (match == PathPrefix)
+            {
+                descend = true;
+            }
+        }
+
+        if (isContainer)
+        {
+            if (descend)
+                elementCount[level] = token == CJsonPullReader::TokenBeginArray ? 0 : static_cast<size_t>(-1);
+            else if (!reader.SkipContainer())
+                return false;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////CJsonStreamWriter
+
+CJsonStreamWriter::CJsonStreamWriter(size_t reserveBytes)
+{
+    m_buffer.reserve(reserveBytes);
+}
+
+void CJsonStreamWriter::Reset()
+{
+    m_buffer.clear();
+    m_needComma = false;
+    m_afterKey = false;
+}
+
+void CJsonStreamWriter::Separator()
+{
+    if (m_afterKey)
+        m_afterKey = false;
+    else if (m_needComma)
+        m_buffer.push_back(',');
+}
+
+CJsonStreamWriter& CJsonStreamWriter::BeginObject()
+{
+    Separator();
+    m_buffer.push_back('{');
+    m_needComma = false;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::EndObject()
+{
+    m_buffer.push_back('}');
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::BeginArray()
+{
+    Separator();
+    m_buffer.push_back('[');
+    m_needComma = false;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::EndArray()
+{
+    m_buffer.push_back(']');
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::Key(const char* name)
+{
+    return Key(name, strlen(name));
+}
+
+CJsonStreamWriter& CJsonStreamWriter::Key(const char* name, size_t size)
+{
+    Separator();
+    AppendQuoted(name, size);
+    m_buffer.push_back(':');
+    m_afterKey = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::String(const char* value)
+{
+    return String(value, strlen(value));
+}
+
+CJsonStreamWriter& CJsonStreamWriter::String(const char* value, size_t size)
+{
+    Separator();
+    AppendQuoted(value, size);
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::Int(int64_t value)
+{
+    Separator();
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    char digits[24];
+    char* p = digits + sizeof(digits);
+    do
+    {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+        *--p = '-';
+    m_buffer.append(p, digits + sizeof(digits));
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::UInt(uint64_t value)
+{
+    Separator();
+    char digits[24];
+    char* p = digits + sizeof(digits);
+    do
+    {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    m_buffer.append(p, digits + sizeof(digits));
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::Double(double value)
+{
+    Separator();
+    // 与 Json::FastWriter 一致：17 位有效数字，整数值补 ".0"，NaN 写成 null，Inf 写成 ±1e+9999
+    if (value != value)
+    {
+        m_buffer.append("null", 4);
+    }
+    else if (value - value != 0)
+    {
+        if (value < 0)
+            m_buffer.append("-1e+9999", 8);
+        else
+            m_buffer.append("1e+9999", 7);
+    }
+    else
+    {
+        char text[40];
+        int size = snprintf(text, sizeof(text), "%.17g", value);
+        m_buffer.append(text, size);
+        if (strpbrk(text, ".eE") == NULL)
+            m_buffer.append(".0", 2);
+    }
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::Bool(bool value)
+{
+    Separator();
+    if (value)
+        m_buffer.append("true", 4);
+    else
+        m_buffer.append("false", 5);
+    m_needComma = true;
+    return *this;
+}
+
+CJsonStreamWriter& CJsonStreamWriter::Null()
+{
+    Separator();
+    m_buffer.append("null", 4);
+    m_needComma = true;
+    return *this;
+}
+
+void CJsonStreamWriter::AppendQuoted(const char* value, size_t size)
+{
+    static const char kHex[] = "0123456789ABCDEF";
+    m_buffer.push_back('"');
+    const char* run = value;
+    const char* end = value + size;
+    for (const char* p = value; p < end; ++p)
+    {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        // 不需要转义的连续字符整段追加
+        m_buffer.append(run, p);
+        run = p + 1;
+        switch (c)
+        {
+        case '"': m_buffer.append("\\\"", 2); break;
+        case '\\': m_buffer.append("\\\\", 2); break;
+        case '\b': m_buffer.append("\\b", 2); break;
+        case '\f': m_buffer.append("\\f", 2); break;
+        case '\n': m_buffer.append("\\n", 2); break;
+        case '\r': m_buffer.append("\\r", 2); break;
+        case '\t': m_buffer.append("\\t", 2); break;
+        default:
+        {
+            char escape[6] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0x0F] };
+            m_buffer.append(escape, 6);
+            break;
+        }
+        }
+    }
+    m_buffer.append(run, end);
+    m_buffer.push_back('"');
+}
@@ -0,0 +1,588 @@
+#include "AsyncLogger.h"
+
+#include <string.h>
+#include <wchar.h>
+#include <time.h>
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+// 后台线程单次攒够这么多字节就先写一次文件
+static const size_t kMaxBatchBytes = 512 * 1024;
+// 每一轮从单个线程的缓冲最多取这么多条，避免一个线程刷屏时其他线程的记录长时间得不到处理
+static const size_t kMaxRecordsPerRing = 1024;
+
+enum LogRecordKind
+{
+    kRecordPad = 0,     // 环形缓冲尾部的填充，读到后跳到开头
+    kRecordLog = 1,
+};
+
+struct LogRecordHeader
+{
+    uint32_t size;      // 记录总长度（含 header），8 字节对齐
+    uint32_t kind;
+    int64_t timestamp;  // 微秒，system_clock
+    uint32_t siteId;
+    uint32_t argBytes;
+};
+
+static size_t AlignRecord(size_t size)
+{
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+//////////////////////////////////////////////////////////////////////////CLogRing
+
+// 单生产者（所属线程）单消费者（后台线程）的字节环形缓冲
+class CLogRing
+{
+public:
+    CLogRing(size_t capacity, unsigned long threadId)
+        : m_capacity(capacity)
+        , m_buffer(new uint8_t[capacity])
+        , m_head(0)
+        , m_tail(0)
+        , m_pendingHead(0)
+        , m_threadId(threadId)
+        , m_bOwnerExited(false)
+    {
+    }
+
+    // 生产者：预留 size 字节（8 字节对齐）连续空间，空间不足返回 NULL
+    uint8_t* Reserve(size_t size)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t offset = head & (m_capacity - 1);
+        size_t contiguous = m_capacity - offset;
+        size_t need = contiguous < size ? contiguous + size : size;
+        if (m_capacity - (head - tail) < need)
+            return NULL;
+
+        if (contiguous < size)
+        {
+            LogRecordHeader* pad = reinterpret_cast<LogRecordHeader*>(m_buffer.get() + offset);
+            pad->size = static_cast<uint32_t>(contiguous);
+            pad->kind = kRecordPad;
+            head += contiguous;
+            offset = 0;
+        }
+        m_pendingHead = head;
+        return m_buffer.get() + offset;
+    }
+
+    void Commit(size_t size)
+    {
+        m_head.store(m_pendingHead + size, std::memory_order_release);
+    }
+
+    // 消费者：返回下一条记录，没有时返回 NULL
+    const LogRecordHeader* Peek()
+    {
+        for (;;)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire))
+                return NULL;
+
+            const LogRecordHeader* record = reinterpret_cast<const LogRecordHeader*>(m_buffer.get() + (tail & (m_capacity - 1)));
+            if (record->kind != kRecordPad)
+                return record;
+            m_tail.store(tail + record->size, std::memory_order_release);
+        }
+    }
+
+    void Release(const LogRecordHeader* record)
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + record->size, std::memory_order_release);
+    }
+
+    size_t UsedBytes() const
+    {
+        return m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const { return m_capacity; }
+    unsigned long ThreadId() const { return m_threadId; }
+    bool IsEmpty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed); }
+    void SetOwnerExited() { m_bOwnerExited.store(true, std::memory_order_release); }
+    bool IsOwnerExited() const { return m_bOwnerExited.load(std::memory_order_acquire); }
+private:
+    const size_t m_capacity;
+    std::unique_ptr<uint8_t[]> m_buffer;
+    std::atomic<size_t> m_head;
+    std::atomic<size_t> m_tail;
+    size_t m_pendingHead;
+    unsigned long m_threadId;
+    std::atomic<bool> m_bOwnerExited;
+};
+
+// 线程退出时只标记，由后台线程读完剩余记录后回收
+struct LogThreadRingHolder
+{
+    std::shared_ptr<CLogRing> ring;
+    ~LogThreadRingHolder()
+    {
+        if (ring)
+            ring->SetOwnerExited();
+    }
+};
+
+static thread_local LogThreadRingHolder t_ringHolder;
+
+static unsigned long GetCurrentThreadIdPortable()
+{
+#ifdef _WIN32
+    return ::GetCurrentThreadId();
+#elif defined(__linux__)
+    return static_cast<unsigned long>(::syscall(SYS_gettid));
+#else
+    return static_cast<unsigned long>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+}
+
+static int64_t NowMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void LocalTimeOf(time_t seconds, struct tm& result)
+{
+#ifdef _WIN32
+    ::localtime_s(&result, &seconds);
+#else
+    ::localtime_r(&seconds, &result);
+#endif
+}
+
+static void AppendBytes(std::vector<uint8_t>& out, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+//////////////////////////////////////////////////////////////////////////CAsyncLogger
+
+std::atomic<int> CAsyncLogger::s_minLevel(TrackLevel);
+
+CAsyncLogger& CAsyncLogger::Instance()
+{
+    static CAsyncLogger s_logger;
+    return s_logger;
+}
+
+CAsyncLogger::CAsyncLogger()
+    : m_bStarted(false)
+    , m_droppedCount(0)
+{
+#ifdef _WIN32
+    m_processId = ::GetCurrentProcessId();
+#else
+    m_processId = static_cast<unsigned long>(::getpid());
+#endif
+}
+
+CAsyncLogger::~CAsyncLogger()
+{
+    Stop();
+}
+
+void CAsyncLogger::Start(const Config& config)
+{
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (m_bStarted.load(std::memory_order_acquire))
+        return;
+
+    m_config = config;
+    size_t ringBytes = 4096;
+    while (ringBytes < config.ringBytes)
+        ringBytes <<= 1;
+    m_config.ringBytes = ringBytes;
+
+    m_bStop = false;
+    m_worker = std::thread(&CAsyncLogger::WorkerProc, this);
+    m_bStarted.store(true, std::memory_order_release);
+}
+
+void CAsyncLogger::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        if (!m_bStarted.load(std::memory_order_acquire))
+            return;
+        m_bStarted.store(false, std::memory_order_release);
+        m_bStop = true;
+    }
+    m_wakeCond.notify_all();
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+uint32_t CAsyncLogger::RegisterSites(const LogSite* sites, size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_sitesMutex);
+    uint32_t firstId = static_cast<uint32_t>(m_sites.size() + 1);
+    for (size_t i = 0; i < count; ++i)
+        m_sites.push_back(sites + i);
+    return firstId;
+}
+
+const LogSite* CAsyncLogger::FindSite(uint32_t siteId)
+{
+    if (siteId == 0)
+        return NULL;
+    if (siteId > m_siteCache.size())
+    {
+        std::lock_guard<std::mutex> lock(m_sitesMutex);
+        m_siteCache = m_sites;
+    }
+    return siteId <= m_siteCache.size() ? m_siteCache[siteId - 1] : NULL;
+}
+
+CLogRing* CAsyncLogger::GetThreadRing()
+{
+    if (!t_ringHolder.ring)
+    {
+        std::shared_ptr<CLogRing> ring = std::make_shared<CLogRing>(m_config.ringBytes, GetCurrentThreadIdPortable());
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.push_back(ring);
+        t_ringHolder.ring = ring;
+    }
+    return t_ringHolder.ring.get();
+}
+
+void CAsyncLogger::WriteV(uint32_t siteId, const LogSite* site, va_list args)
+{
+    if (!IsStarted() || site == NULL || site->format == NULL)
+        return;
+
+    uint8_t argBuffer[kLogMaxArgBytes];
+    size_t argBytes = LogPackArgs(site->format, args, argBuffer, sizeof(argBuffer));
+    size_t recordSize = AlignRecord(sizeof(LogRecordHeader) + argBytes);
+
+    CLogRing* ring = GetThreadRing();
+    uint8_t* dst = ring->Reserve(recordSize);
+    if (dst == NULL)
+    {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        m_wakeCond.notify_one();
+        return;
+    }
+
+    LogRecordHeader* header = reinterpret_cast<LogRecordHeader*>(dst);
+    header->size = static_cast<uint32_t>(recordSize);
+    header->kind = kRecordLog;
+    header->timestamp = NowMicroseconds();
+    header->siteId = siteId;
+    header->argBytes = static_cast<uint32_t>(argBytes);
+    memcpy(dst + sizeof(LogRecordHeader), argBuffer, argBytes);
+    ring->Commit(recordSize);
+
+    // 缓冲过半时提前唤醒后台线程，否则等它按间隔轮询
+    if (ring->UsedBytes() > ring->Capacity() / 2)
+        m_wakeCond.notify_one();
+}
+
+void CAsyncLogger::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    if (!m_bStarted.load(std::memory_order_acquire))
+        return;
+    uint64_t request = ++m_flushRequested;
+    m_bWakeup = true;
+    m_wakeCond.notify_all();
+    m_flushCond.wait(lock, [&]() { return m_flushCompleted >= request || m_bStop; });
+}
+
+void CAsyncLogger::WorkerProc()
+{
+    m_textBatch.reserve(kMaxBatchBytes / sizeof(wchar_t) + 4096);
+    for (;;)
+    {
+        uint64_t flushRequest = 0;
+        bool bStop = false;
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            flushRequest = m_flushRequested;
+            bStop = m_bStop;
+        }
+
+        bool bHasRecord = DrainRings();
+        WritePending();
+        if (bHasRecord)
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        if (flushRequest > m_flushCompleted)
+        {
+            m_flushCompleted = flushRequest;
+            m_flushCond.notify_all();
+        }
+        if (bStop)
+            break;
+        if (!m_bWakeup && !m_bStop)
+            m_wakeCond.wait_for(lock, std::chrono::milliseconds(m_config.flushIntervalMs));
+        m_bWakeup = false;
+    }
+
+    CloseLogFile();
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_flushCompleted = m_flushRequested;
+    m_flushCond.notify_all();
+}
+
+bool CAsyncLogger::DrainRings()
+{
+    std::vector<std::shared_ptr<CLogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        rings = m_rings;
+    }
+
+    bool bHasRecord = false;
+    for (size_t i = 0; i < rings.size(); ++i)
+    {
+        CLogRing* ring = rings[i].get();
+        for (size_t count = 0; count < kMaxRecordsPerRing; ++count)
+        {
+            const LogRecordHeader* record = ring->Peek();
+            if (record == NULL)
+                break;
+
+            // 每批的第一条记录前检查切换文件：一批只写进一个文件，二进制日志的 site 定义随新文件重新写入
+            if (PendingBytes() == 0)
+                PrepareLogFile();
+            AppendRecord(reinterpret_cast<const uint8_t*>(record), ring->ThreadId());
+            ring->Release(record);
+            bHasRecord = true;
+            if (PendingBytes() >= kMaxBatchBytes || m_fileBytes + PendingBytes() >= m_config.maxFileBytes)
+                WritePending();
+        }
+    }
+
+    uint64_t dropped = m_droppedCount.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDropped)
+    {
+        if (PendingBytes() == 0)
+            PrepareLogFile();
+        AppendDropped(dropped - m_reportedDropped);
+        m_reportedDropped = dropped;
+    }
+
+    // 回收已退出线程的空缓冲
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (size_t i = 0; i < m_rings.size();)
+    {
+        if (m_rings[i]->IsOwnerExited() && m_rings[i]->IsEmpty())
+        {
+            m_rings[i] = m_rings.back();
+            m_rings.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return bHasRecord;
+}
+
+void CAsyncLogger::AppendRecord(const uint8_t* data, unsigned long threadId)
+{
+    const LogRecordHeader* record = reinterpret_cast<const LogRecordHeader*>(data);
+    const LogSite* site = FindSite(record->siteId);
+    if (site == NULL)
+        return;
+    const uint8_t* args = data + sizeof(LogRecordHeader);
+
+    if (!m_config.bBinaryFile)
+    {
+        LogLineInfo info = { m_config.moduleName.c_str(), m_processId, threadId, record->timestamp,
+            site->level, site->file, site->function, site->line };
+        LogAppendLine(m_textBatch, info, site->format, args, record->argBytes);
+        return;
+    }
+
+    if (record->siteId > m_siteWritten.size())
+        m_siteWritten.resize(record->siteId, false);
+    if (!m_siteWritten[record->siteId - 1])
+    {
+        size_t fileChars = strlen(site->file);
+        size_t functionChars = strlen(site->function);
+        size_t formatChars = wcslen(site->format);
+        LogFileSiteEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.header.type = kLogEntrySite;
+        entry.header.size = static_cast<uint32_t>(sizeof(entry) + fileChars + functionChars + formatChars * sizeof(wchar_t));
+        entry.siteId = record->siteId;
+        entry.line = site->line;
+        entry.level = static_cast<uint16_t>(site->level);
+        entry.fileChars = static_cast<uint16_t>(fileChars);
+        entry.functionChars = static_cast<uint16_t>(functionChars);
+        entry.formatChars = static_cast<uint16_t>(formatChars);
+        AppendBytes(m_binaryBatch, &entry, sizeof(entry));
+        AppendBytes(m_binaryBatch, site->file, fileChars);
+        AppendBytes(m_binaryBatch, site->function, functionChars);
+        AppendBytes(m_binaryBatch, site->format, formatChars * sizeof(wchar_t));
+        m_siteWritten[record->siteId - 1] = true;
+    }
+
+    LogFileRecordEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.header.type = kLogEntryRecord;
+    entry.header.size = static_cast<uint32_t>(sizeof(entry) + record->argBytes);
+    entry.timestamp = record->timestamp;
+    entry.siteId = record->siteId;
+    entry.threadId = static_cast<uint32_t>(threadId);
+    AppendBytes(m_binaryBatch, &entry, sizeof(entry));
+    AppendBytes(m_binaryBatch, args, record->argBytes);
+}
+
+void CAsyncLogger::AppendDropped(uint64_t count)
+{
+    if (m_config.bBinaryFile)
+    {
+        LogFileDroppedEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.header.type = kLogEntryDropped;
+        entry.header.size = sizeof(entry);
+        entry.count = count;
+        AppendBytes(m_binaryBatch, &entry, sizeof(entry));
+        return;
+    }
+
+    wchar_t buffer[96];
+    int length = ::swprintf(buffer, 96, L"[logger] %llu records dropped, ring buffer full\n",
+        static_cast<unsigned long long>(count));
+    if (length > 0)
+        m_textBatch.append(buffer, static_cast<size_t>(length));
+}
+
+size_t CAsyncLogger::PendingBytes() const
+{
+    return m_textBatch.size() * sizeof(wchar_t) + m_binaryBatch.size();
+}
+
+void CAsyncLogger::WritePending()
+{
+    if (!m_textBatch.empty())
+    {
+#ifdef _WIN32
+        if (m_config.bDebugOutput)
+            ::OutputDebugStringW(m_textBatch.c_str());
+#endif
+        if (m_file != NULL)
+            m_fileBytes += ::fwrite(m_textBatch.data(), sizeof(wchar_t), m_textBatch.size(), m_file) * sizeof(wchar_t);
+        m_textBatch.clear();
+    }
+    if (!m_binaryBatch.empty())
+    {
+        if (m_file != NULL)
+            m_fileBytes += ::fwrite(m_binaryBatch.data(), 1, m_binaryBatch.size(), m_file);
+        m_binaryBatch.clear();
+    }
+    if (m_file != NULL)
+        ::fflush(m_file);
+}
+
+bool CAsyncLogger::PrepareLogFile()
+{
+    if (m_file != NULL)
+    {
+        int64_t now = NowMicroseconds();
+        if (m_fileBytes >= m_config.maxFileBytes
+            || now - m_fileOpenTime >= static_cast<int64_t>(m_config.maxFileSeconds) * 1000000)
+        {
+            CloseLogFile();
+        }
+    }
+    return m_file != NULL || OpenLogFile();
+}
+
+bool CAsyncLogger::OpenLogFile()
+{
+    if (m_config.directory.empty())
+        return false;
+
+    int64_t now = NowMicroseconds();
+    struct tm localTime;
+    memset(&localTime, 0, sizeof(localTime));
+    LocalTimeOf(static_cast<time_t>(now / 1000000), localTime);
+
+#ifdef _WIN32
+    BOOL bRet = ::CreateDirectoryW(m_config.directory.c_str(), NULL);
+    if (FALSE == bRet && ERROR_ALREADY_EXISTS != ::GetLastError())
+        return false;
+
+    const wchar_t* extension = m_config.bBinaryFile ? L"binlog" : L"log";
+    wchar_t filePath[MAX_PATH] = { 0 };
+    for (int i = 0; ; ++i)  // 避免同名
+    {
+        ::swprintf_s(filePath, _countof(filePath) - 1, L"%s%s_%04d_%02d_%02d_%02d_%02d_%02d_%d.%s"
+            , m_config.directory.c_str(), m_config.fileNamePrefix.c_str()
+            , localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday
+            , localTime.tm_hour, localTime.tm_min, localTime.tm_sec, i, extension);
+        if (::GetFileAttributesW(filePath) == INVALID_FILE_ATTRIBUTES)
+            break;
+    }
+    m_file = ::_wfsopen(filePath, L"wb+", _SH_DENYWR);
+#else
+    ::mkdir(m_config.directory.c_str(), 0755);
+
+    const char* extension = m_config.bBinaryFile ? "binlog" : "log";
+    std::string prefix(m_config.fileNamePrefix.begin(), m_config.fileNamePrefix.end());
+    char filePath[1024] = { 0 };
+    for (int i = 0; ; ++i)  // 避免同名
+    {
+        ::snprintf(filePath, sizeof(filePath), "%s%s_%04d_%02d_%02d_%02d_%02d_%02d_%d.%s"
+            , m_config.directory.c_str(), prefix.c_str()
+            , localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday
+            , localTime.tm_hour, localTime.tm_min, localTime.tm_sec, i, extension);
+        if (::access(filePath, F_OK) != 0)
+            break;
+    }
+    m_file = ::fopen(filePath, "wb+");
+#endif
+
+    m_fileBytes = 0;
+    m_fileOpenTime = now;
+    if (m_file == NULL)
+        return false;
+
+    if (m_config.bBinaryFile)
+    {
+        // 新文件不认识之前文件里的 site 定义，全部重新写
+        m_siteWritten.clear();
+
+        LogFileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = kLogFileMagic;
+        header.version = kLogFileVersion;
+        header.wcharSize = sizeof(wchar_t);
+        header.processId = static_cast<uint32_t>(m_processId);
+        header.moduleNameChars = static_cast<uint32_t>(m_config.moduleName.size());
+        m_fileBytes += ::fwrite(&header, 1, sizeof(header), m_file);
+        m_fileBytes += ::fwrite(m_config.moduleName.data(), sizeof(wchar_t), m_config.moduleName.size(), m_file) * sizeof(wchar_t);
+    }
+    return true;
+}
+
+void CAsyncLogger::CloseLogFile()
+{
+    if (m_file != NULL)
+    {
+        ::fclose(m_file);
+        m_file = NULL;
+    }
+}
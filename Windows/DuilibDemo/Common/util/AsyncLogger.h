@@ -0,0 +1,148 @@
+/*
+* Module:   CAsyncLogger
+*
+* Function: 异步日志后端，Log::Write 的实际实现
+*
+*    1. 每个日志调用点在编译期生成一个 LogSite（短文件名、类名::函数名、行号、级别、格式串），首次执行时注册得到 site id。
+*    2. 调用线程只把 (site id, 参数, 时间戳) 以二进制记录写入本线程的 SPSC 环形缓冲，不做格式化和 IO。
+*    3. 后台线程轮流读取所有线程的环形缓冲（每轮每个线程限量），格式化成文本（或直接写二进制日志，由 LogDecoder 还原）
+*       后批量写文件，每批开始前按大小和时间切换日志文件。
+*    4. 环形缓冲写满时丢弃记录并计数，调用线程永远不会阻塞。
+*
+*    %s 参数的内容会在调用线程拷贝，不要求调用方保持存活。
+*/
+#ifndef __ASYNC_LOGGER_H__
+#define __ASYNC_LOGGER_H__
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include "LogFormat.h"
+
+#ifdef _WIN32
+typedef std::wstring LogPath;
+#else
+typedef std::string LogPath;
+#endif
+
+// 日志调用点的静态描述，由日志宏在编译期生成，生命周期与进程相同
+struct LogSite
+{
+    ENM_LOGGER_LEVEL level;
+    int line;
+    const char* file;           // 短文件名
+    const char* function;       // 类名::函数名
+    const wchar_t* format;
+};
+
+// 编译期计算短文件名：最后一个路径分隔符之后的部分
+inline constexpr const char* LogSiteFileName(const char* p, const char* last)
+{
+    return *p == '\0' ? last : LogSiteFileName(p + 1, (*p == '\\' || *p == '/') ? p + 1 : last);
+}
+
+// 编译期计算短函数名：只保留最后的 类名::函数名
+inline constexpr const char* LogSiteFuncName(const char* p, const char* start, const char* prev, const char* last)
+{
+    return *p == '\0' ? (last == start ? start : prev)
+        : (p[0] == ':' && p[1] == ':') ? LogSiteFuncName(p + 2, start, last, p + 2)
+        : LogSiteFuncName(p + 1, start, prev, last);
+}
+
+// 进入/退出标记按 TrackLevel 过滤
+inline constexpr int LogLevelRank(ENM_LOGGER_LEVEL level)
+{
+    return (level == InLevel || level == OutLevel) ? TrackLevel : level;
+}
+
+class CLogRing;
+
+class CAsyncLogger
+{
+public:
+    struct Config
+    {
+        LogPath directory;                      // 日志目录，以路径分隔符结尾
+        std::wstring fileNamePrefix = L"TRTCApp";
+        std::wstring moduleName;                // 启动时计算一次，写入每一行
+        size_t maxFileBytes = 32 * 1024 * 1024; // 单个文件超过该大小后切换新文件
+        unsigned int maxFileSeconds = 24 * 3600;// 单个文件写入超过该时长后切换新文件
+        size_t ringBytes = 256 * 1024;          // 每个线程的环形缓冲大小，向上取 2 的幂
+        unsigned int flushIntervalMs = 20;      // 后台线程空闲时的轮询间隔
+        bool bDebugOutput = true;               // 同时输出到调试器（仅 Windows，文本日志）
+        bool bBinaryFile = false;               // 写二进制日志（.binlog），需用 LogDecoder 转成文本
+    };
+public:
+    static CAsyncLogger& Instance();
+    ~CAsyncLogger();
+
+    void Start(const Config& config);           // 重复调用无效
+    void Stop();                                // 写完所有已提交的记录后关闭文件
+    bool IsStarted() const { return m_bStarted.load(std::memory_order_acquire); }
+
+    // 运行期级别过滤，日志宏先判断级别，被过滤的调用不会对参数求值
+    static void SetLogLevel(ENM_LOGGER_LEVEL level) { s_minLevel.store(LogLevelRank(level), std::memory_order_relaxed); }
+    static bool IsLevelEnabled(ENM_LOGGER_LEVEL level) { return LogLevelRank(level) >= s_minLevel.load(std::memory_order_relaxed); }
+
+    // 注册连续的 count 个调用点，返回第一个的 id（从 1 开始），可以在 Start 之前调用
+    uint32_t RegisterSites(const LogSite* sites, size_t count);
+
+    void WriteV(uint32_t siteId, const LogSite* site, va_list args);
+    void Flush();                               // 等待调用前提交的记录全部落盘
+    uint64_t GetDroppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+private:
+    CAsyncLogger();
+    CLogRing* GetThreadRing();
+    const LogSite* FindSite(uint32_t siteId);
+    void WorkerProc();
+    bool DrainRings();
+    void AppendRecord(const uint8_t* record, unsigned long threadId);
+    void AppendDropped(uint64_t count);
+    size_t PendingBytes() const;
+    void WritePending();
+    bool PrepareLogFile();
+    bool OpenLogFile();
+    void CloseLogFile();
+private:
+    static std::atomic<int> s_minLevel;
+
+    Config m_config;
+    std::atomic<bool> m_bStarted;
+    std::atomic<uint64_t> m_droppedCount;
+    uint64_t m_reportedDropped = 0;
+    unsigned long m_processId = 0;
+
+    std::mutex m_ringsMutex;
+    std::vector<std::shared_ptr<CLogRing>> m_rings;
+
+    std::mutex m_sitesMutex;
+    std::vector<const LogSite*> m_sites;        // 下标 = site id - 1，只追加
+    std::vector<const LogSite*> m_siteCache;    // 后台线程持有的 m_sites 副本，缺失时再加锁同步
+
+    std::thread m_worker;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCond;
+    std::condition_variable m_flushCond;
+    bool m_bStop = false;
+    bool m_bWakeup = false;
+    uint64_t m_flushRequested = 0;
+    uint64_t m_flushCompleted = 0;
+
+    std::wstring m_textBatch;                   // 文本日志待写内容
+    std::vector<uint8_t> m_binaryBatch;         // 二进制日志待写内容
+    std::vector<bool> m_siteWritten;            // 当前二进制文件中已写过定义的 site
+
+    FILE* m_file = NULL;
+    size_t m_fileBytes = 0;
+    int64_t m_fileOpenTime = 0;
+};
+
+#endif /* __ASYNC_LOGGER_H__ */
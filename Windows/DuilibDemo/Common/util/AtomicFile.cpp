@@ -0,0 +1,64 @@
+﻿#include "AtomicFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+bool WriteFileAtomic(const AtomicFilePath& path, const void* data, size_t size)
+{
+#ifdef _WIN32
+    std::wstring tmpPath = path + L".tmp";
+    HANDLE hFile = ::CreateFileW(tmpPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD written = 0;
+    BOOL bRet = ::WriteFile(hFile, data, static_cast<DWORD>(size), &written, NULL);
+    bRet = bRet && written == size && ::FlushFileBuffers(hFile);
+    ::CloseHandle(hFile);
+    if (!bRet)
+    {
+        ::DeleteFileW(tmpPath.c_str());
+        return false;
+    }
+    return ::MoveFileExW(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    const char* bytes = static_cast<const char*>(data);
+    size_t offset = 0;
+    while (offset < size)
+    {
+        ssize_t n = ::write(fd, bytes + offset, size - offset);
+        if (n <= 0)
+            break;
+        offset += static_cast<size_t>(n);
+    }
+    bool bRet = offset == size && ::fsync(fd) == 0;
+    bRet = ::close(fd) == 0 && bRet;
+    if (!bRet || ::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        ::unlink(tmpPath.c_str());
+        return false;
+    }
+
+    // rename 本身也要落盘，否则断电后目录项可能还是旧文件
+    std::string::size_type slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int dirFd = ::open(dir.c_str(), O_RDONLY);
+    if (dirFd >= 0)
+    {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+#endif
+}
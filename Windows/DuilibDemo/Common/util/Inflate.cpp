@@ -0,0 +1,487 @@
+﻿#include "Inflate.h"
+
+#include <string.h>
+
+namespace
+{
+    const int kMaxBits = 15;
+    const int kMaxLitLenCodes = 286;
+    const int kMaxDistCodes = 30;
+    const int kFixedLitLenCodes = 288;
+    const int kFastBits = 9;                    // 查表解码的位数，覆盖绝大多数字面量和长度码
+    const int kFastSymbolBits = 9;              // 查表项：低 9 位为符号，其上为码长，0 表示需要逐位解码
+
+    const uint16_t kLengthBase[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint16_t kLengthExtra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t kDistBase[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint16_t kDistExtra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t kCodeLengthOrder[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // 规范 Huffman 表：每种码长的符号个数 + 按码值排序的符号，以及短码的查找表
+    struct Huffman
+    {
+        uint16_t count[kMaxBits + 1];
+        uint16_t symbol[kFixedLitLenCodes];
+        uint16_t fast[1 << kFastBits];
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+        // 尽量把位缓冲补到 25 位以上，数据不够时有多少补多少
+        void Refill()
+        {
+            while (m_bitCount <= 24 && m_pos < m_size)
+            {
+                m_bitBuf |= static_cast<uint32_t>(m_data[m_pos++]) << m_bitCount;
+                m_bitCount += 8;
+            }
+        }
+
+        uint32_t Peek() const { return m_bitBuf; }
+        int BitCount() const { return m_bitCount; }
+
+        void Drop(int bits)
+        {
+            m_bitBuf >>= bits;
+            m_bitCount -= bits;
+        }
+
+        bool Bits(int need, int& value)
+        {
+            while (m_bitCount < need)
+            {
+                if (m_pos >= m_size)
+                    return false;
+                m_bitBuf |= static_cast<uint32_t>(m_data[m_pos++]) << m_bitCount;
+                m_bitCount += 8;
+            }
+            value = static_cast<int>(m_bitBuf & ((1u << need) - 1));
+            m_bitBuf >>= need;
+            m_bitCount -= need;
+            return true;
+        }
+
+        // 丢掉当前字节剩下的位，缓冲中预读的整字节退回输入
+        void AlignToByte()
+        {
+            m_pos -= m_bitCount / 8;
+            m_bitBuf = 0;
+            m_bitCount = 0;
+        }
+
+        size_t Position() const { return m_pos - m_bitCount / 8; }
+        const uint8_t* Data() const { return m_data; }
+        size_t Size() const { return m_size; }
+        void Skip(size_t bytes) { m_pos += bytes; }   // 只能在 AlignToByte 之后调用
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_pos = 0;
+        uint32_t m_bitBuf = 0;
+        int m_bitCount = 0;
+    };
+
+    // 解压输出：写到调用方的定长缓冲区，或者写到 std::string 并按需扩容（不超过 limit）
+    class Output
+    {
+    public:
+        Output(uint8_t* buffer, size_t capacity)
+            : m_data(buffer), m_pos(0), m_capacity(capacity), m_limit(capacity), m_string(NULL) {}
+
+        Output(std::string& out, size_t limit)
+            : m_data(NULL), m_pos(out.size()), m_capacity(out.size()), m_limit(limit), m_string(&out)
+        {
+            if (!out.empty())
+                m_data = reinterpret_cast<uint8_t*>(&out[0]);
+        }
+
+        // 结束时把 std::string 截到实际写入的长度
+        void Finish()
+        {
+            if (m_string != NULL)
+                m_string->resize(m_pos);
+        }
+
+        bool Reserve(size_t bytes)
+        {
+            if (m_capacity - m_pos >= bytes)
+                return true;
+            return Grow(bytes);
+        }
+
+        void Put(uint8_t value) { m_data[m_pos++] = value; }
+
+        // 调用前已经 Reserve(length)，distance 已检查不超过 Size()
+        void Copy(size_t distance, size_t length)
+        {
+            uint8_t* dst = m_data + m_pos;
+            const uint8_t* src = dst - distance;
+            m_pos += length;
+            if (distance >= length)
+            {
+                memcpy(dst, src, length);
+                return;
+            }
+            // 源和目标重叠（distance < length），只能逐字节复制
+            for (size_t i = 0; i < length; ++i)
+                dst[i] = src[i];
+        }
+
+        void Append(const uint8_t* data, size_t length)
+        {
+            memcpy(m_data + m_pos, data, length);
+            m_pos += length;
+        }
+
+        size_t Size() const { return m_pos; }
+    private:
+        bool Grow(size_t bytes)
+        {
+            if (m_string == NULL || m_limit - m_pos < bytes)
+                return false;
+            size_t capacity = m_capacity < 4096 ? 4096 : m_capacity * 2;
+            if (capacity > m_limit)
+                capacity = m_limit;
+            if (capacity < m_pos + bytes)
+                capacity = m_pos + bytes;
+            m_string->resize(capacity);
+            m_data = reinterpret_cast<uint8_t*>(&(*m_string)[0]);
+            m_capacity = capacity;
+            return true;
+        }
+    private:
+        uint8_t* m_data;
+        size_t m_pos;
+        size_t m_capacity;
+        size_t m_limit;
+        std::string* m_string;
+    };
+
+    // 返回 0 表示完整的码表，>0 表示不完整（只允许单个码的距离表），<0 表示码长超额
+    int BuildHuffman(Huffman& h, const uint8_t* lengths, int n)
+    {
+        memset(h.count, 0, sizeof(h.count));
+        for (int i = 0; i < n; ++i)
+            h.count[lengths[i]]++;
+        if (h.count[0] == n)
+            return 0;
+
+        int left = 1;
+        for (int len = 1; len <= kMaxBits; ++len)
+        {
+            left <<= 1;
+            left -= h.count[len];
+            if (left < 0)
+                return left;
+        }
+
+        uint16_t offsets[kMaxBits + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < kMaxBits; ++len)
+            offsets[len + 1] = offsets[len] + h.count[len];
+        for (int i = 0; i < n; ++i)
+        {
+            if (lengths[i] != 0)
+                h.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+        }
+
+        // 码长不超过 kFastBits 的码填进查找表；DEFLATE 的码从高位开始存放，表下标要按位反转
+        memset(h.fast, 0, sizeof(h.fast));
+        int code = 0;
+        int index = 0;
+        for (int len = 1; len <= kFastBits; ++len)
+        {
+            for (int i = 0; i < h.count[len]; ++i, ++code)
+            {
+                int reversed = 0;
+                for (int bit = 0; bit < len; ++bit)
+                    reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+                uint16_t entry = static_cast<uint16_t>((len << kFastSymbolBits) | h.symbol[index++]);
+                for (int slot = reversed; slot < (1 << kFastBits); slot += 1 << len)
+                    h.fast[slot] = entry;
+            }
+            code <<= 1;
+        }
+        return left;
+    }
+
+    int DecodeSymbol(BitReader& reader, const Huffman& h)
+    {
+        reader.Refill();
+        uint16_t entry = h.fast[reader.Peek() & ((1u << kFastBits) - 1)];
+        if (entry != 0)
+        {
+            int len = entry >> kFastSymbolBits;
+            // 输入已经用完，查到的码包含了缓冲区之外补的 0
+            if (len > reader.BitCount())
+                return -1;
+            reader.Drop(len);
+            return entry & ((1 << kFastSymbolBits) - 1);
+        }
+
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int len = 1; len <= kMaxBits; ++len)
+        {
+            int bit = 0;
+            if (!reader.Bits(1, bit))
+                return -1;
+            code |= bit;
+            int count = h.count[len];
+            if (code - count < first)
+                return h.symbol[index + (code - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    bool InflateCodes(BitReader& reader, Output& out, const Huffman& litLen, const Huffman& dist)
+    {
+        while (true)
+        {
+            int symbol = DecodeSymbol(reader, litLen);
+            if (symbol < 0)
+                return false;
+            if (symbol < 256)
+            {
+                if (!out.Reserve(1))
+                    return false;
+                out.Put(static_cast<uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256)
+                return true;
+
+            symbol -= 257;
+            if (symbol >= 29)
+                return false;
+            int extra = 0;
+            if (!reader.Bits(kLengthExtra[symbol], extra))
+                return false;
+            size_t length = kLengthBase[symbol] + extra;
+
+            symbol = DecodeSymbol(reader, dist);
+            if (symbol < 0 || symbol >= kMaxDistCodes)
+                return false;
+            if (!reader.Bits(kDistExtra[symbol], extra))
+                return false;
+            size_t distance = kDistBase[symbol] + extra;
+
+            if (distance > out.Size() || !out.Reserve(length))
+                return false;
+            out.Copy(distance, length);
+        }
+    }
+
+    bool InflateStored(BitReader& reader, Output& out)
+    {
+        reader.AlignToByte();
+        size_t pos = reader.Position();
+        if (pos + 4 > reader.Size())
+            return false;
+        const uint8_t* p = reader.Data() + pos;
+        size_t length = p[0] | (p[1] << 8);
+        size_t inverted = p[2] | (p[3] << 8);
+        if (length != (~inverted & 0xFFFF))
+            return false;
+        if (pos + 4 + length > reader.Size() || !out.Reserve(length))
+            return false;
+        out.Append(p + 4, length);
+        reader.Skip(4 + length);
+        return true;
+    }
+
+    bool InflateFixed(BitReader& reader, Output& out)
+    {
+        static Huffman s_litLen;
+        static Huffman s_dist;
+        static bool s_built = [] {
+            uint8_t lengths[kFixedLitLenCodes];
+            int i = 0;
+            for (; i < 144; ++i) lengths[i] = 8;
+            for (; i < 256; ++i) lengths[i] = 9;
+            for (; i < 280; ++i) lengths[i] = 7;
+            for (; i < kFixedLitLenCodes; ++i) lengths[i] = 8;
+            BuildHuffman(s_litLen, lengths, kFixedLitLenCodes);
+            for (i = 0; i < kMaxDistCodes; ++i) lengths[i] = 5;
+            BuildHuffman(s_dist, lengths, kMaxDistCodes);
+            return true;
+        }();
+        (void)s_built;
+        return InflateCodes(reader, out, s_litLen, s_dist);
+    }
+
+    bool InflateDynamic(BitReader& reader, Output& out)
+    {
+        int nlen = 0, ndist = 0, ncode = 0;
+        if (!reader.Bits(5, nlen) || !reader.Bits(5, ndist) || !reader.Bits(4, ncode))
+            return false;
+        nlen += 257;
+        ndist += 1;
+        ncode += 4;
+        if (nlen > kMaxLitLenCodes || ndist > kMaxDistCodes)
+            return false;
+
+        uint8_t lengths[kMaxLitLenCodes + kMaxDistCodes];
+        memset(lengths, 0, sizeof(lengths));
+        for (int i = 0; i < ncode; ++i)
+        {
+            int value = 0;
+            if (!reader.Bits(3, value))
+                return false;
+            lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(value);
+        }
+
+        Huffman lenCode;
+        if (BuildHuffman(lenCode, lengths, 19) != 0)
+            return false;
+
+        int index = 0;
+        while (index < nlen + ndist)
+        {
+            int symbol = DecodeSymbol(reader, lenCode);
+            if (symbol < 0)
+                return false;
+            if (symbol < 16)
+            {
+                lengths[index++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            int repeatValue = 0;
+            int repeat = 0;
+            if (symbol == 16)
+            {
+                if (index == 0 || !reader.Bits(2, repeat))
+                    return false;
+                repeatValue = lengths[index - 1];
+                repeat += 3;
+            }
+            else if (symbol == 17)
+            {
+                if (!reader.Bits(3, repeat))
+                    return false;
+                repeat += 3;
+            }
+            else
+            {
+                if (!reader.Bits(7, repeat))
+                    return false;
+                repeat += 11;
+            }
+            if (index + repeat > nlen + ndist)
+                return false;
+            while (repeat--)
+                lengths[index++] = static_cast<uint8_t>(repeatValue);
+        }
+
+        // 没有结束符的码表无法解出完整的块
+        if (lengths[256] == 0)
+            return false;
+
+        Huffman litLen;
+        int err = BuildHuffman(litLen, lengths, nlen);
+        if (err < 0 || (err > 0 && nlen - litLen.count[0] != 1))
+            return false;
+
+        Huffman dist;
+        err = BuildHuffman(dist, lengths + nlen, ndist);
+        if (err < 0 || (err > 0 && ndist - dist.count[0] != 1))
+            return false;
+
+        return InflateCodes(reader, out, litLen, dist);
+    }
+
+    bool InflateBlocks(BitReader& reader, Output& out)
+    {
+        int last = 0;
+        do
+        {
+            int type = 0;
+            if (!reader.Bits(1, last) || !reader.Bits(2, type))
+                return false;
+
+            bool ok = false;
+            if (type == 0)
+                ok = InflateStored(reader, out);
+            else if (type == 1)
+                ok = InflateFixed(reader, out);
+            else if (type == 2)
+                ok = InflateDynamic(reader, out);
+            if (!ok)
+                return false;
+        } while (!last);
+        return true;
+    }
+}
+
+bool InflateRaw(const uint8_t* data, size_t size, std::string& out, size_t maxOutput, size_t* consumed)
+{
+    BitReader reader(data, size);
+    size_t limit = out.size() + maxOutput;
+    if (limit < out.size())
+        limit = static_cast<size_t>(-1);
+    Output output(out, limit);
+    bool ok = InflateBlocks(reader, output);
+    output.Finish();
+    if (!ok)
+        return false;
+
+    if (consumed != NULL)
+        *consumed = reader.Position();
+    return true;
+}
+
+bool InflateRawTo(const uint8_t* data, size_t size, uint8_t* out, size_t outSize, size_t* produced)
+{
+    BitReader reader(data, size);
+    Output output(out, outSize);
+    bool ok = InflateBlocks(reader, output);
+    if (produced != NULL)
+        *produced = output.Size();
+    return ok;
+}
+
+bool InflateZlib(const uint8_t* data, size_t size, std::string& out, size_t maxOutput)
+{
+    if (size < 6)
+        return false;
+    // CMF/FLG：只接受 deflate、窗口不超过 32K、不带预置字典
+    if ((data[0] & 0x0F) != 8 || (data[0] >> 4) > 7 || (data[1] & 0x20) != 0)
+        return false;
+    if (((data[0] << 8) | data[1]) % 31 != 0)
+        return false;
+
+    size_t start = out.size();
+    size_t consumed = 0;
+    if (!InflateRaw(data + 2, size - 2, out, maxOutput, &consumed))
+        return false;
+    if (2 + consumed + 4 > size)
+        return false;
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = start; i < out.size(); ++i)
+    {
+        a = (a + static_cast<uint8_t>(out[i])) % 65521;
+        b = (b + a) % 65521;
+    }
+    const uint8_t* p = data + 2 + consumed;
+    uint32_t expected = (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    return ((b << 16) | a) == expected;
+}
@@ -0,0 +1,542 @@
+﻿#include "IniStore.h"
+#include "AtomicFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const size_t kArenaBlockSize = 4096;
+#ifdef _WIN32
+static const char kNewLine[] = "\r\n";
+#else
+static const char kNewLine[] = "\n";
+#endif
+
+static size_t HashBytes(const char* data, size_t size, size_t seed)
+{
+    // FNV-1a
+    unsigned long long hash = 14695981039346656037ULL ^ seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+static bool IsBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static IniStrRef Trim(const char* begin, const char* end)
+{
+    while (begin < end && IsBlank(*begin))
+        ++begin;
+    while (end > begin && IsBlank(*(end - 1)))
+        --end;
+    return IniStrRef(begin, end - begin);
+}
+
+size_t CIniStore::EntryKeyHash::operator()(const EntryKey& k) const
+{
+    return HashBytes(k.key.data, k.key.size, HashBytes(k.section.data, k.section.size, 0));
+}
+
+CIniStore::CIniStore()
+{
+}
+
+CIniStore::~CIniStore()
+{
+    SetAutoSave(0);
+    Save();
+}
+
+//************************************************************************
+// 函数说明:		映射文件并一遍扫描解析。键值只拷贝一次到 arena，不做编码转换。
+// 返 回 值:   	bool	文件不存在或无法打开时返回 false
+//************************************************************************
+bool CIniStore::Load(const IniPath& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+#ifdef _WIN32
+    HANDLE hFile = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize = { 0 };
+    if (!::GetFileSizeEx(hFile, &fileSize))
+    {
+        ::CloseHandle(hFile);
+        return false;
+    }
+    if (fileSize.QuadPart == 0)
+    {
+        ::CloseHandle(hFile);
+        return true;
+    }
+
+    HANDLE hMapping = ::CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    const char* view = hMapping ? static_cast<const char*>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+    if (view)
+    {
+        Parse(view, static_cast<size_t>(fileSize.QuadPart));
+        ::UnmapViewOfFile(view);
+    }
+    if (hMapping)
+        ::CloseHandle(hMapping);
+    ::CloseHandle(hFile);
+    return view != NULL;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    void* view = ::mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    Parse(static_cast<const char*>(view), static_cast<size_t>(st.st_size));
+    ::munmap(view, static_cast<size_t>(st.st_size));
+    return true;
+#endif
+}
+
+void CIniStore::Parse(const char* data, size_t size)
+{
+    const char* end = data + size;
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        data += 3;
+
+    // 整个文件预留在一个 arena 块里，解析过程中不再分配
+    if (m_arenaCap - m_arenaUsed < size + 1)
+    {
+        m_arena.push_back(std::unique_ptr<char[]>(new char[size + 1]));
+        m_arenaCap = size + 1;
+        m_arenaUsed = 0;
+        m_arenaBytes += size + 1;
+    }
+
+    // 文件中重复的键以第一个为准，与原来 CConfigMgr 的 map insert 一致
+    std::vector<bool> parsed;
+    // 还没有归属的注释和空行，挂到后面第一个新的节或键上
+    std::string comment;
+    size_t curSection = static_cast<size_t>(-1);
+    const char* line = data;
+    while (line < end)
+    {
+        const char* eol = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (eol == NULL)
+            eol = end;
+
+        const char* lineBegin = line;
+        IniStrRef text = Trim(line, eol);
+        line = eol + 1;
+        if (text.empty() || text.data[0] == ';' || text.data[0] == '#')
+        {
+            comment.append(lineBegin, eol);
+            if (eol == end)
+                comment.append(kNewLine);
+            else
+                comment.push_back('\n');
+            continue;
+        }
+
+        if (text.data[0] == '[')
+        {
+            const char* close = static_cast<const char*>(memchr(text.data, ']', text.size));
+            if (close != NULL)
+            {
+                size_t sectionCount = m_sections.size();
+                curSection = FindOrAddSection(Trim(text.data + 1, close));
+                if (m_sections.size() != sectionCount && !comment.empty())
+                {
+                    m_sections[curSection].comment = Store(comment);
+                    comment.clear();
+                }
+            }
+            continue;
+        }
+
+        const char* equal = static_cast<const char*>(memchr(text.data, '=', text.size));
+        if (equal == NULL || curSection == static_cast<size_t>(-1))
+            continue;
+
+        IniStrRef key = Trim(text.data, equal);
+        IniStrRef value = Trim(equal + 1, text.data + text.size);
+        if (key.empty() || value.empty())
+            continue;
+
+        EntryKey entryKey = { m_sections[curSection].name, key };
+        std::unordered_map<EntryKey, size_t, EntryKeyHash>::const_iterator itr = m_index.find(entryKey);
+        if (itr != m_index.end() && itr->second < parsed.size() && parsed[itr->second])
+            continue;
+
+        size_t index = SetLocked(m_sections[curSection].name, key, value);
+        if (parsed.size() <= index)
+            parsed.resize(index + 1, false);
+        parsed[index] = true;
+        if (!comment.empty())
+        {
+            m_entries[index].comment = Store(comment);
+            comment.clear();
+        }
+    }
+    if (!comment.empty())
+        m_trailer = Store(comment);
+    m_bDirty = false;
+}
+
+IniStrRef CIniStore::Store(IniStrRef str)
+{
+    if (m_arenaCap - m_arenaUsed < str.size + 1)
+    {
+        size_t blockSize = str.size + 1 > kArenaBlockSize ? str.size + 1 : kArenaBlockSize;
+        m_arena.push_back(std::unique_ptr<char[]>(new char[blockSize]));
+        m_arenaCap = blockSize;
+        m_arenaUsed = 0;
+        m_arenaBytes += blockSize;
+    }
+
+    char* dst = m_arena.back().get() + m_arenaUsed;
+    memcpy(dst, str.data, str.size);
+    dst[str.size] = '\0';   // arena 中的字符串都以 '\0' 结尾，方便 strtol 等直接使用
+    m_arenaUsed += str.size + 1;
+    return IniStrRef(dst, str.size);
+}
+
+size_t CIniStore::FindOrAddSection(IniStrRef name)
+{
+    for (size_t i = 0; i < m_sections.size(); ++i)
+    {
+        if (m_sections[i].name == name)
+            return i;
+    }
+
+    Section section;
+    section.name = Store(name);
+    m_sections.push_back(section);
+    return m_sections.size() - 1;
+}
+
+size_t CIniStore::SetLocked(IniStrRef section, IniStrRef key, IniStrRef value)
+{
+    EntryKey entryKey = { section, key };
+    std::unordered_map<EntryKey, size_t, EntryKeyHash>::iterator itr = m_index.find(entryKey);
+    size_t index = 0;
+    if (itr != m_index.end())
+    {
+        index = itr->second;
+        Entry& entry = m_entries[index];
+        if (entry.value == value)
+            return index;
+        if (value.size <= entry.valueCap)
+        {
+            // 音量等反复写入的值长度基本不变，原地覆盖，arena 不再增长
+            char* dst = const_cast<char*>(entry.value.data);
+            memmove(dst, value.data, value.size);
+            dst[value.size] = '\0';
+            entry.value.size = value.size;
+        }
+        else
+        {
+            m_arenaWaste += entry.valueCap + 1;
+            entry.value = Store(value);
+            entry.valueCap = value.size;
+        }
+    }
+    else
+    {
+        size_t sectionIndex = FindOrAddSection(section);
+        Entry entry;
+        entry.key = Store(key);
+        entry.value = Store(value);
+        entry.valueCap = value.size;
+        m_entries.push_back(entry);
+        index = m_entries.size() - 1;
+        m_sections[sectionIndex].entries.push_back(index);
+
+        EntryKey storedKey = { m_sections[sectionIndex].name, entry.key };
+        m_index.insert(std::make_pair(storedKey, index));
+    }
+
+    m_bDirty = true;
+    ++m_changeSeq;
+    if (m_saveDelayMs > 0)
+        m_saveCond.notify_all();
+    return index;
+}
+
+//************************************************************************
+// 函数说明:		废弃的值占了 arena 一半以上时，把仍在使用的字符串拷贝到一个新块，释放旧块并重建索引
+//************************************************************************
+void CIniStore::CompactArena()
+{
+    if (m_arenaWaste < kArenaBlockSize || m_arenaWaste * 2 < m_arenaBytes)
+        return;
+
+    size_t total = m_trailer.size + 1;
+    for (size_t i = 0; i < m_sections.size(); ++i)
+        total += m_sections[i].name.size + 1 + m_sections[i].comment.size + 1;
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        total += m_entries[i].key.size + 1 + m_entries[i].value.size + 1 + m_entries[i].comment.size + 1;
+
+    std::vector<std::unique_ptr<char[]>> oldArena;
+    oldArena.swap(m_arena);
+    m_arena.push_back(std::unique_ptr<char[]>(new char[total + 1]));
+    m_arenaCap = total + 1;
+    m_arenaUsed = 0;
+    m_arenaBytes = total + 1;
+    m_arenaWaste = 0;
+
+    m_trailer = Store(m_trailer);
+    for (size_t i = 0; i < m_sections.size(); ++i)
+    {
+        m_sections[i].name = Store(m_sections[i].name);
+        m_sections[i].comment = Store(m_sections[i].comment);
+    }
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        m_entries[i].key = Store(m_entries[i].key);
+        m_entries[i].value = Store(m_entries[i].value);
+        m_entries[i].valueCap = m_entries[i].value.size;
+        m_entries[i].comment = Store(m_entries[i].comment);
+    }
+
+    m_index.clear();
+    for (size_t i = 0; i < m_sections.size(); ++i)
+    {
+        const Section& section = m_sections[i];
+        for (size_t j = 0; j < section.entries.size(); ++j)
+        {
+            EntryKey entryKey = { section.name, m_entries[section.entries[j]].key };
+            m_index.insert(std::make_pair(entryKey, section.entries[j]));
+        }
+    }
+}
+
+const CIniStore::Entry* CIniStore::FindLocked(IniStrRef section, IniStrRef key) const
+{
+    EntryKey entryKey = { section, key };
+    std::unordered_map<EntryKey, size_t, EntryKeyHash>::const_iterator itr = m_index.find(entryKey);
+    if (itr == m_index.end() || m_entries[itr->second].value.empty())
+        return NULL;
+    return &m_entries[itr->second];
+}
+
+bool CIniStore::Get(IniStrRef section, IniStrRef key, IniStrRef& value) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry* entry = FindLocked(section, key);
+    if (entry == NULL)
+        return false;
+
+    value = entry->value;
+    return true;
+}
+
+bool CIniStore::GetString(IniStrRef section, IniStrRef key, std::string& value) const
+{
+    // 在锁内拷贝：其他线程的 Set 会原地覆盖值，Save 可能整理 arena
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry* entry = FindLocked(section, key);
+    if (entry == NULL)
+    {
+        value.clear();
+        return false;
+    }
+    value.assign(entry->value.data, entry->value.size);
+    return true;
+}
+
+int CIniStore::GetInt(IniStrRef section, IniStrRef key, int defaultValue) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry* entry = FindLocked(section, key);
+    if (entry == NULL)
+        return defaultValue;
+
+    const IniStrRef& ref = entry->value;
+    char* parseEnd = NULL;
+    long value = strtol(ref.data, &parseEnd, 10);
+    return parseEnd == ref.data ? defaultValue : static_cast<int>(value);
+}
+
+bool CIniStore::GetBool(IniStrRef section, IniStrRef key, bool defaultValue) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry* entry = FindLocked(section, key);
+    if (entry == NULL)
+        return defaultValue;
+
+    const IniStrRef& ref = entry->value;
+    if (ref == IniStrRef("true") || ref == IniStrRef("TRUE") || ref == IniStrRef("yes"))
+        return true;
+    if (ref == IniStrRef("false") || ref == IniStrRef("FALSE") || ref == IniStrRef("no"))
+        return false;
+
+    char* parseEnd = NULL;
+    long value = strtol(ref.data, &parseEnd, 10);
+    return parseEnd == ref.data ? defaultValue : value != 0;
+}
+
+void CIniStore::SetString(IniStrRef section, IniStrRef key, IniStrRef value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SetLocked(section, key, value);
+}
+
+void CIniStore::SetInt(IniStrRef section, IniStrRef key, int value)
+{
+    char buffer[16] = { 0 };
+    int len = snprintf(buffer, sizeof(buffer), "%d", value);
+    SetString(section, key, IniStrRef(buffer, len > 0 ? static_cast<size_t>(len) : 0));
+}
+
+size_t CIniStore::GetSectionCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sections.size();
+}
+
+size_t CIniStore::GetEntryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void CIniStore::Serialize(std::string& out) const
+{
+    size_t total = m_trailer.size;
+    for (size_t i = 0; i < m_sections.size(); ++i)
+        total += m_sections[i].comment.size + m_sections[i].name.size + 2 + sizeof(kNewLine) - 1;
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        total += m_entries[i].comment.size + m_entries[i].key.size + 1 + m_entries[i].value.size + sizeof(kNewLine) - 1;
+    out.reserve(total);
+    for (size_t i = 0; i < m_sections.size(); ++i)
+    {
+        const Section& section = m_sections[i];
+        if (section.entries.empty() && section.comment.empty())
+            continue;
+
+        out.append(section.comment.data, section.comment.size);
+        out.append("[").append(section.name.data, section.name.size).append("]").append(kNewLine);
+        for (size_t j = 0; j < section.entries.size(); ++j)
+        {
+            const Entry& entry = m_entries[section.entries[j]];
+            out.append(entry.comment.data, entry.comment.size);
+            out.append(entry.key.data, entry.key.size).append("=");
+            out.append(entry.value.data, entry.value.size).append(kNewLine);
+        }
+    }
+    out.append(m_trailer.data, m_trailer.size);
+}
+
+//************************************************************************
+// 函数说明:		有修改时写回文件：在锁内序列化，锁外先写 <path>.tmp 并落盘，再 rename 覆盖原文件。
+//				写盘期间又有修改时保持 dirty，由下一次 Save 写入
+// 返 回 值:   	bool
+//************************************************************************
+bool CIniStore::Save()
+{
+    std::lock_guard<std::mutex> writeLock(m_writeMutex);
+    std::string content;
+    IniPath path;
+    unsigned long long seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_bDirty)
+            return true;
+        if (m_path.empty())
+            return false;
+        Serialize(content);
+        path = m_path;
+        seq = m_changeSeq;
+    }
+
+    if (!WriteFileAtomic(path, content.data(), content.size()))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_changeSeq == seq)
+    {
+        m_bDirty = false;
+        CompactArena();
+    }
+    return true;
+}
+
+void CIniStore::SetAutoSave(unsigned int delayMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_saveDelayMs = delayMs;
+    if (delayMs > 0)
+    {
+        if (!m_saveThread.joinable())
+        {
+            m_bStopSave = false;
+            m_saveThread = std::thread(&CIniStore::AutoSaveProc, this);
+        }
+        m_saveCond.notify_all();
+        return;
+    }
+
+    if (m_saveThread.joinable())
+    {
+        m_bStopSave = true;
+        m_saveCond.notify_all();
+        lock.unlock();
+        m_saveThread.join();
+    }
+}
+
+void CIniStore::AutoSaveProc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_bStopSave)
+    {
+        if (!m_bDirty)
+        {
+            m_saveCond.wait(lock);
+            continue;
+        }
+
+        // 最后一次修改后 m_saveDelayMs 内没有新的修改才写盘
+        unsigned long long seq = m_changeSeq;
+        bool bChanged = m_saveCond.wait_for(lock, std::chrono::milliseconds(m_saveDelayMs),
+            [&]() { return m_bStopSave || m_changeSeq != seq; });
+        if (bChanged)
+            continue;
+
+        lock.unlock();
+        bool bSaved = Save();
+        lock.lock();
+        if (!bSaved)
+            m_saveCond.wait_for(lock, std::chrono::milliseconds(m_saveDelayMs));
+    }
+}
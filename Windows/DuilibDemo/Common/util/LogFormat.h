@@ -0,0 +1,125 @@
+/*
+* Module:   LogFormat
+*
+* Function: 日志参数打包、延迟格式化和二进制日志文件格式，CAsyncLogger 与 LogDecoder 共用
+*
+*    1. 调用线程用 LogPackArgs 按格式串把参数拷成带类型标记的字节流，不做格式化。
+*    2. 后台线程（文本日志）或 LogDecoder（二进制日志）用 LogAppendLine 还原成与原来一致的日志行。
+*    3. 二进制日志 = LogFileHeader + 若干条目；调用点元数据（LogSite）在每个文件中首次出现时写一条定义，
+*       之后的记录只带 site id 和参数字节流。
+*
+*    不依赖 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __LOG_FORMAT_H__
+#define __LOG_FORMAT_H__
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+typedef enum LOGGER_LEVEL
+{
+    TrackLevel      = 0,
+    InfoLevel       = 1,
+    WarningLevel    = 2,
+    ErrorLevel      = 3,
+    FatalLevel      = 4,
+
+    // 标识函数进入和退出
+    InLevel         = 5,
+    OutLevel        = 6
+} ENM_LOGGER_LEVEL;
+
+// 单条记录参数区上限，超出部分截断；单个字符串参数最多拷贝 kLogMaxStringChars 个字符
+static const size_t kLogMaxArgBytes = 4096;
+static const size_t kLogMaxStringChars = 1024;
+
+// 参数区中每个参数前的类型标记
+enum LogArgTag
+{
+    kLogArgInt = 'i',       // int64_t
+    kLogArgUInt = 'u',      // uint64_t
+    kLogArgDouble = 'f',    // double
+    kLogArgPointer = 'p',   // uint64_t
+    kLogArgWide = 'w',      // uint32_t 长度 + wchar_t[长度]
+    kLogArgNarrow = 'n',    // uint32_t 长度 + char[长度]
+};
+
+// 按格式串从 va_list 取出参数写入 buffer，返回写入的字节数
+size_t LogPackArgs(const wchar_t* format, va_list args, uint8_t* buffer, size_t capacity);
+
+// 按格式串和打包后的参数追加格式化结果
+void LogAppendFormatted(std::wstring& out, const wchar_t* format, const uint8_t* args, size_t argBytes);
+
+struct LogLineInfo
+{
+    const wchar_t* moduleName;
+    unsigned long processId;
+    unsigned long threadId;
+    int64_t timestamp;      // 微秒，system_clock
+    int level;              // ENM_LOGGER_LEVEL
+    const char* file;       // 短文件名
+    const char* function;   // 类名::函数名
+    int line;
+};
+
+// 追加一整行：模块、进程线程 id、时间、级别、函数、文件:行号、[格式化内容]
+void LogAppendLine(std::wstring& out, const LogLineInfo& info, const wchar_t* format, const uint8_t* args, size_t argBytes);
+
+//////////////////////////////////////////////////////////////////////////二进制日志文件
+
+static const uint32_t kLogFileMagic = 0x424C5254;   // "TRLB"
+static const uint16_t kLogFileVersion = 1;
+
+#pragma pack(push, 4)
+struct LogFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t wcharSize;         // 写入端 sizeof(wchar_t)，格式串和宽字符串参数按该宽度存储
+    uint32_t processId;
+    uint32_t moduleNameChars;   // 之后紧跟模块名 wchar_t[moduleNameChars]
+};
+
+enum LogFileEntryType
+{
+    kLogEntrySite = 1,          // LogFileSiteEntry + file char[] + function char[] + format wchar_t[]
+    kLogEntryRecord = 2,        // LogFileRecordEntry + 参数字节流
+    kLogEntryDropped = 3,       // LogFileDroppedEntry
+};
+
+struct LogFileEntryHeader
+{
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t size;              // 含本 header 的条目总长度
+};
+
+struct LogFileSiteEntry
+{
+    LogFileEntryHeader header;
+    uint32_t siteId;
+    int32_t line;
+    uint16_t level;
+    uint16_t fileChars;
+    uint16_t functionChars;
+    uint16_t formatChars;
+};
+
+struct LogFileRecordEntry
+{
+    LogFileEntryHeader header;
+    int64_t timestamp;
+    uint32_t siteId;
+    uint32_t threadId;
+};
+
+struct LogFileDroppedEntry
+{
+    LogFileEntryHeader header;
+    uint64_t count;
+};
+#pragma pack(pop)
+
+#endif /* __LOG_FORMAT_H__ */
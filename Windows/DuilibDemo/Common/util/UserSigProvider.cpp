@@ -0,0 +1,329 @@
+﻿#include "UserSigProvider.h"
+#include "Inflate.h"
+#include "json/JsonStream.h"
+
+#include <chrono>
+
+static const size_t kMaxUserSigJsonBytes = 64 * 1024;
+
+// UserSig 是把 base64 中的 '+' '/' '=' 分别替换成 '*' '-' '_' 之后的结果
+static bool DecodeUserSigBase64(const std::string& userSig, std::string& out)
+{
+    out.clear();
+    out.reserve(userSig.size() * 3 / 4);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < userSig.size(); ++i)
+    {
+        char c = userSig[i];
+        int value = 0;
+        if (c >= 'A' && c <= 'Z')
+            value = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            value = c - '0' + 52;
+        else if (c == '*' || c == '+')
+            value = 62;
+        else if (c == '-' || c == '/')
+            value = 63;
+        else if (c == '_' || c == '=')
+            break;
+        else
+            return false;
+
+        buffer = (buffer << 6) | value;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<char>((buffer >> bits) & 0xFF));
+        }
+    }
+    return !out.empty();
+}
+
+namespace
+{
+    const char* const kUserSigTimePaths[] = { "TLS\\.time", "TLS\\.expire", "TLS\\.expire_after" };
+
+    // 新旧两个版本的 UserSig 中，时间字段有的是数字，有的是数字字符串
+    struct UserSigTimeHandler : public IJsonSelectHandler
+    {
+        bool bHasValue[3] = { false, false, false };
+        int64_t value[3] = { 0, 0, 0 };
+
+        virtual bool OnValue(size_t pathIndex, size_t /*arrayIndex*/, CJsonPullReader& reader)
+        {
+            if (reader.Current() == CJsonPullReader::TokenString)
+            {
+                CJsonPullReader number(reader.TextBegin(), reader.TextSize());
+                bHasValue[pathIndex] = number.Next() == CJsonPullReader::TokenNumber && number.GetInt64(value[pathIndex]);
+            }
+            else
+            {
+                bHasValue[pathIndex] = reader.GetInt64(value[pathIndex]);
+            }
+            return true;
+        }
+    };
+}
+
+bool DecodeUserSigExpiry(const std::string& userSig, int64_t& issueTime, int64_t& expireTime)
+{
+    std::string compressed;
+    if (!DecodeUserSigBase64(userSig, compressed))
+        return false;
+
+    std::string json;
+    if (!InflateZlib(reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size(), json, kMaxUserSigJsonBytes))
+        return false;
+
+    UserSigTimeHandler handler;
+    if (!JsonSelect(json.data(), json.size(), kUserSigTimePaths, 3, handler))
+        return false;
+
+    int64_t lifetime = handler.bHasValue[1] ? handler.value[1] : handler.value[2];
+    if (!handler.bHasValue[0] || (!handler.bHasValue[1] && !handler.bHasValue[2]) || lifetime <= 0)
+        return false;
+    issueTime = handler.value[0];
+
+    expireTime = issueTime + lifetime;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////CUserSigProvider
+
+CUserSigProvider::CUserSigProvider(const UserSigFetcher& fetcher)
+    : m_fetcher(fetcher)
+{
+}
+
+CUserSigProvider::CUserSigProvider(const UserSigFetcher& fetcher, const Config& config, const UserSigClock& clock)
+    : m_fetcher(fetcher)
+    , m_clock(clock)
+    , m_config(config)
+{
+}
+
+CUserSigProvider::~CUserSigProvider()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_wakeCond.notify_all();
+    if (m_worker.joinable())
+        m_worker.join();
+
+    // 队列中未执行的获取不会再有结果；callback 约定只在工作线程中调用，且捕获的对象（窗口等）
+    // 此时可能已经销毁，所以不在析构线程上回调，直接丢弃
+    m_entries.clear();
+}
+
+std::string CUserSigProvider::MakeKey(uint32_t sdkAppId, const std::string& userId)
+{
+    return std::to_string(sdkAppId) + ":" + userId;
+}
+
+int64_t CUserSigProvider::Now() const
+{
+    if (m_clock)
+        return m_clock();
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool CUserSigProvider::IsUsable(const Entry& entry, int64_t now) const
+{
+    return !entry.userSig.empty() && now + m_config.expireMarginSeconds < entry.expireTime;
+}
+
+CUserSigProvider::Entry& CUserSigProvider::FindOrAdd(uint32_t sdkAppId, const std::string& userId)
+{
+    Entry& entry = m_entries[MakeKey(sdkAppId, userId)];
+    if (entry.userId.empty())
+    {
+        entry.sdkAppId = sdkAppId;
+        entry.userId = userId;
+    }
+    return entry;
+}
+
+void CUserSigProvider::StoreUserSig(Entry& entry, const std::string& userSig, int64_t now)
+{
+    int64_t issueTime = 0;
+    int64_t expireTime = 0;
+    if (!DecodeUserSigExpiry(userSig, issueTime, expireTime))
+    {
+        issueTime = now;
+        expireTime = now + m_config.fallbackLifetimeSeconds;
+    }
+
+    // 本地时钟和签发方可能有偏差，以拿到 UserSig 的时间为准计算剩余有效期
+    if (issueTime > now)
+        expireTime -= issueTime - now;
+
+    int64_t lifetime = expireTime - now;
+    int64_t ahead = m_config.refreshAheadSeconds;
+    if (ahead > lifetime / 2)
+        ahead = lifetime / 2;
+
+    entry.userSig = userSig;
+    entry.expireTime = expireTime;
+    entry.refreshTime = expireTime - ahead;
+}
+
+void CUserSigProvider::StartFetch(Entry& entry)
+{
+    if (entry.fetching)
+        return;
+    entry.fetching = true;
+    m_fetchQueue.push_back(MakeKey(entry.sdkAppId, entry.userId));
+    if (!m_worker.joinable())
+        m_worker = std::thread(&CUserSigProvider::WorkerProc, this);
+    m_wakeCond.notify_one();
+}
+
+bool CUserSigProvider::GetCached(uint32_t sdkAppId, const std::string& userId, std::string& userSig)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(MakeKey(sdkAppId, userId));
+    if (it == m_entries.end() || !IsUsable(it->second, Now()))
+        return false;
+    userSig = it->second.userSig;
+    return true;
+}
+
+bool CUserSigProvider::Get(uint32_t sdkAppId, const std::string& userId, std::string& userSig, const UserSigCallback& callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = Now();
+    Entry& entry = FindOrAdd(sdkAppId, userId);
+    if (IsUsable(entry, now))
+    {
+        userSig = entry.userSig;
+        if (now >= entry.refreshTime)
+            StartFetch(entry);
+        return true;
+    }
+
+    if (callback)
+        entry.waiters.push_back(callback);
+    StartFetch(entry);
+    return false;
+}
+
+void CUserSigProvider::Prefetch(uint32_t sdkAppId, const std::string& userId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry& entry = FindOrAdd(sdkAppId, userId);
+    if (!IsUsable(entry, Now()))
+        StartFetch(entry);
+}
+
+void CUserSigProvider::Put(uint32_t sdkAppId, const std::string& userId, const std::string& userSig)
+{
+    if (userSig.empty())
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry& entry = FindOrAdd(sdkAppId, userId);
+    StoreUserSig(entry, userSig, Now());
+}
+
+void CUserSigProvider::Invalidate(uint32_t sdkAppId, const std::string& userId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(MakeKey(sdkAppId, userId));
+    if (it == m_entries.end())
+        return;
+    it->second.userSig.clear();
+    it->second.expireTime = 0;
+    it->second.refreshTime = INT64_MAX;
+}
+
+void CUserSigProvider::CheckRefresh()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ScheduleRefresh(Now());
+}
+
+void CUserSigProvider::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCond.wait(lock, [this] { return m_bStop || (m_fetchQueue.empty() && m_running == 0); });
+}
+
+void CUserSigProvider::ScheduleRefresh(int64_t now)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        Entry& entry = it->second;
+        if (!entry.fetching && !entry.userSig.empty() && now >= entry.refreshTime)
+            StartFetch(entry);
+    }
+}
+
+void CUserSigProvider::WorkerProc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_bStop)
+    {
+        if (m_fetchQueue.empty())
+        {
+            m_idleCond.notify_all();
+            m_wakeCond.wait_for(lock, std::chrono::milliseconds(m_config.pollIntervalMs));
+            if (!m_bStop)
+                ScheduleRefresh(Now());
+            continue;
+        }
+
+        std::string key = m_fetchQueue.front();
+        m_fetchQueue.pop_front();
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+            continue;
+        uint32_t sdkAppId = it->second.sdkAppId;
+        std::string userId = it->second.userId;
+        ++m_running;
+        lock.unlock();
+
+        std::string userSig;
+        int code = m_fetcher ? m_fetcher(sdkAppId, userId, userSig) : EcUserSigEmpty;
+        if (code == 0 && userSig.empty())
+            code = EcUserSigEmpty;
+
+        lock.lock();
+        std::vector<UserSigCallback> waiters;
+        it = m_entries.find(key);
+        if (it != m_entries.end())
+        {
+            Entry& entry = it->second;
+            int64_t now = Now();
+            entry.fetching = false;
+            if (code == 0)
+            {
+                StoreUserSig(entry, userSig, now);
+            }
+            else if (!entry.userSig.empty())
+            {
+                // 后台刷新失败，旧的 UserSig 还能用到过期为止
+                entry.refreshTime = now + m_config.retryDelaySeconds;
+                if (IsUsable(entry, now))
+                {
+                    code = 0;
+                    userSig = entry.userSig;
+                }
+            }
+            waiters.swap(entry.waiters);
+        }
+        lock.unlock();
+
+        for (size_t i = 0; i < waiters.size(); ++i)
+            waiters[i](code, userSig);
+
+        lock.lock();
+        --m_running;
+    }
+    m_idleCond.notify_all();
+}
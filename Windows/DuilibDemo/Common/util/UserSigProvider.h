@@ -0,0 +1,115 @@
+﻿/*
+* Module:   CUserSigProvider
+*
+* Function: UserSig 缓存，GenerateTestUserSig 的实际实现
+*
+*    1. 按 (sdkAppId, userId) 缓存 UserSig，有效期从 UserSig 本身解出（TLS.time + TLS.expire / TLS.expire_after）。
+*    2. 到期前在后台线程提前刷新，刷新失败时保留旧的 UserSig 并按间隔重试。
+*    3. 同一用户的并发请求合并成一次获取，完成后统一回调。
+*    4. Get 只查缓存，不命中时把获取交给后台线程，调用线程（UI 线程）不会阻塞。
+*
+*    时钟和获取函数都可以替换，不依赖 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __USERSIG_PROVIDER_H__
+#define __USERSIG_PROVIDER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+enum UserSigErrorCode
+{
+    EcUserSigEmpty = -2,        // 获取函数返回成功但 UserSig 为空
+};
+
+// 从 UserSig 解出签发时间和过期时间（秒，Unix 时间），格式不认识时返回 false
+bool DecodeUserSigExpiry(const std::string& userSig, int64_t& issueTime, int64_t& expireTime);
+
+// code 为 0 表示成功，否则为获取函数的返回值或 UserSigErrorCode；只在 CUserSigProvider 的工作线程中调用，
+// CUserSigProvider 析构时尚未完成的请求直接丢弃，callback 不会被调用
+typedef std::function<void(int code, const std::string& userSig)> UserSigCallback;
+
+// 在 CUserSigProvider 的工作线程中同步执行，返回 0 表示成功
+typedef std::function<int(uint32_t sdkAppId, const std::string& userId, std::string& userSig)> UserSigFetcher;
+
+// 返回当前时间（秒，Unix 时间）
+typedef std::function<int64_t()> UserSigClock;
+
+class CUserSigProvider
+{
+public:
+    struct Config
+    {
+        int64_t refreshAheadSeconds = 24 * 3600;    // 距离过期不足该时长时后台刷新（不超过有效期的一半）
+        int64_t expireMarginSeconds = 60;           // 剩余有效期不足该时长的 UserSig 视为已过期
+        int64_t fallbackLifetimeSeconds = 3600;     // 解不出有效期时按该时长缓存
+        int64_t retryDelaySeconds = 30;             // 后台刷新失败后的重试间隔
+        unsigned int pollIntervalMs = 1000;         // 工作线程空闲时检查刷新的间隔
+    };
+public:
+    explicit CUserSigProvider(const UserSigFetcher& fetcher);
+    CUserSigProvider(const UserSigFetcher& fetcher, const Config& config, const UserSigClock& clock = UserSigClock());
+    ~CUserSigProvider();                    // 等待正在执行的获取结束，丢弃未完成请求的 callback
+
+    // 只查缓存，命中未过期的 UserSig 时返回 true
+    bool GetCached(uint32_t sdkAppId, const std::string& userId, std::string& userSig);
+
+    // 命中缓存时直接返回 true，callback 不会被调用；否则返回 false，获取完成后调用 callback
+    bool Get(uint32_t sdkAppId, const std::string& userId, std::string& userSig, const UserSigCallback& callback);
+
+    // 提前在后台获取，不关心结果
+    void Prefetch(uint32_t sdkAppId, const std::string& userId);
+
+    // 写入其他途径得到的 UserSig，之后同样会在过期前自动刷新
+    void Put(uint32_t sdkAppId, const std::string& userId, const std::string& userSig);
+
+    // 丢弃缓存（例如服务端提示 UserSig 失效），下一次 Get 重新获取
+    void Invalidate(uint32_t sdkAppId, const std::string& userId);
+
+    // 立即检查一遍需要刷新的条目，不等待下一个轮询间隔
+    void CheckRefresh();
+
+    // 等待所有已提交的获取完成（包括回调）
+    void WaitIdle();
+private:
+    struct Entry
+    {
+        uint32_t sdkAppId = 0;
+        std::string userId;
+        std::string userSig;
+        int64_t expireTime = 0;
+        int64_t refreshTime = INT64_MAX;    // 到达该时间后后台刷新
+        bool fetching = false;
+        std::vector<UserSigCallback> waiters;
+    };
+
+    static std::string MakeKey(uint32_t sdkAppId, const std::string& userId);
+    int64_t Now() const;
+    bool IsUsable(const Entry& entry, int64_t now) const;
+    Entry& FindOrAdd(uint32_t sdkAppId, const std::string& userId);
+    void StoreUserSig(Entry& entry, const std::string& userSig, int64_t now);
+    void StartFetch(Entry& entry);
+    void ScheduleRefresh(int64_t now);
+    void WorkerProc();
+private:
+    UserSigFetcher m_fetcher;
+    UserSigClock m_clock;
+    Config m_config;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCond;
+    std::condition_variable m_idleCond;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::deque<std::string> m_fetchQueue;
+    size_t m_running = 0;                   // 正在执行获取或回调的数量
+    bool m_bStop = false;
+    std::thread m_worker;
+};
+
+#endif /* __USERSIG_PROVIDER_H__ */
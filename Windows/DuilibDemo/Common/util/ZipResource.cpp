@@ -0,0 +1,586 @@
+﻿#include "ZipResource.h"
+#include "Inflate.h"
+#include "MappedFile.h"
+
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    const uint32_t kLocalHeaderSignature = 0x04034b50;
+    const uint32_t kCentralHeaderSignature = 0x02014b50;
+    const uint32_t kEndOfDirectorySignature = 0x06054b50;
+    const size_t kLocalHeaderSize = 30;
+    const size_t kCentralHeaderSize = 46;
+    const size_t kEndOfDirectorySize = 22;
+    const size_t kMaxCommentSize = 0xFFFF;
+
+    const uint16_t kMethodStored = 0;
+    const uint16_t kMethodDeflate = 8;
+    const uint16_t kFlagEncrypted = 0x0001;
+
+    const unsigned int kMaxWorkers = 4;
+
+    inline uint16_t Read16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    inline uint32_t Read32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+            (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint8_t FoldCase(uint8_t c)
+    {
+        return (c >= 'a' && c <= 'z') ? static_cast<uint8_t>(c - 'a' + 'A') : c;
+    }
+
+    // FNV-1a，按 ASCII 大写计算，与名字比较规则一致
+    uint32_t HashName(const uint8_t* name, size_t length)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= FoldCase(name[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    bool EqualNoCase(const uint8_t* a, const uint8_t* b, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (FoldCase(a[i]) != FoldCase(b[i]))
+                return false;
+        }
+        return true;
+    }
+
+    struct Crc32Table
+    {
+        uint32_t table[4][256];
+
+        Crc32Table()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                table[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                for (int t = 1; t < 4; ++t)
+                    table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    };
+
+    // 每次处理 4 字节（slicing-by-4）
+    uint32_t Crc32(const uint8_t* data, size_t size)
+    {
+        static const Crc32Table crc;
+        const uint32_t (*t)[256] = crc.table;
+        uint32_t c = 0xFFFFFFFFu;
+        while (size >= 4)
+        {
+            c ^= Read32(data);
+            c = t[3][c & 0xFF] ^ t[2][(c >> 8) & 0xFF] ^ t[1][(c >> 16) & 0xFF] ^ t[0][c >> 24];
+            data += 4;
+            size -= 4;
+        }
+        while (size-- > 0)
+            c = t[0][(c ^ *data++) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFFu;
+    }
+}
+
+// deflate 条目的解压状态、LRU 和后台线程；线程在第一次 Prefetch 时启动
+class CZipResource::Cache
+{
+public:
+    enum State
+    {
+        kIdle = 0,
+        kQueued,                        // 在预取队列中，还没有线程开始解压
+        kRunning,                       // 某个线程正在解压，其他读取者等待 doneCond
+    };
+
+    struct Slot
+    {
+        std::shared_ptr<const std::string> blob;
+        std::list<uint32_t>::iterator lruPos;
+        uint8_t state = kIdle;
+    };
+
+    explicit Cache(size_t entryCount) : slots(entryCount) {}
+
+    std::mutex mutex;
+    std::condition_variable wakeCond;   // 预取队列有新条目或需要退出
+    std::condition_variable doneCond;   // 有条目解压结束
+    std::vector<Slot> slots;
+    std::list<uint32_t> lru;            // 头部为最近使用
+    std::deque<uint32_t> queue;
+    std::vector<std::thread> workers;
+    unsigned int running = 0;           // 后台线程正在解压的条目数
+    bool stop = false;
+    Stats stats;
+};
+
+CZipResource::CZipResource()
+    : m_pFile(NULL)
+    , m_data(NULL)
+    , m_size(0)
+    , m_pCache(NULL)
+{
+}
+
+CZipResource::CZipResource(const Config& config)
+    : m_config(config)
+    , m_pFile(NULL)
+    , m_data(NULL)
+    , m_size(0)
+    , m_pCache(NULL)
+{
+}
+
+CZipResource::~CZipResource()
+{
+    Close();
+}
+
+bool CZipResource::Open(const char* path)
+{
+    Close();
+    CMappedFile* pFile = new CMappedFile;
+    if (!pFile->Open(path) || !Open(pFile->Data(), pFile->Size()))
+    {
+        delete pFile;
+        return false;
+    }
+    m_pFile = pFile;
+    return true;
+}
+
+#ifdef _WIN32
+bool CZipResource::Open(const wchar_t* path)
+{
+    Close();
+    CMappedFile* pFile = new CMappedFile;
+    if (!pFile->Open(path) || !Open(pFile->Data(), pFile->Size()))
+    {
+        delete pFile;
+        return false;
+    }
+    m_pFile = pFile;
+    return true;
+}
+#endif
+
+bool CZipResource::Open(const void* data, size_t size)
+{
+    Close();
+    if (data == NULL)
+        return false;
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size;
+    if (!ParseDirectory())
+    {
+        Close();
+        return false;
+    }
+    m_pCache = new Cache(m_entries.size());
+    return true;
+}
+
+void CZipResource::Close()
+{
+    if (m_pCache != NULL)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_pCache->mutex);
+            m_pCache->stop = true;
+        }
+        m_pCache->wakeCond.notify_all();
+        for (size_t i = 0; i < m_pCache->workers.size(); ++i)
+            m_pCache->workers[i].join();
+        delete m_pCache;
+        m_pCache = NULL;
+    }
+    delete m_pFile;
+    m_pFile = NULL;
+    m_data = NULL;
+    m_size = 0;
+    m_entries.clear();
+    m_names.clear();
+    m_slots.clear();
+}
+
+bool CZipResource::ParseDirectory()
+{
+    // 中央目录结束记录在文件末尾，后面最多跟 64K 的注释；与 unzip.cpp 一样从后往前找签名
+    if (m_size < kEndOfDirectorySize)
+        return false;
+    size_t minPos = m_size > kEndOfDirectorySize + kMaxCommentSize ? m_size - kEndOfDirectorySize - kMaxCommentSize : 0;
+    size_t eocd = m_size - kEndOfDirectorySize;
+    while (Read32(m_data + eocd) != kEndOfDirectorySignature)
+    {
+        if (eocd == minPos)
+            return false;
+        --eocd;
+    }
+
+    const uint8_t* end = m_data + eocd;
+    uint16_t diskNumber = Read16(end + 4);
+    uint16_t directoryDisk = Read16(end + 6);
+    uint16_t diskEntries = Read16(end + 8);
+    uint16_t totalEntries = Read16(end + 10);
+    uint32_t directorySize = Read32(end + 12);
+    uint32_t directoryOffset = Read32(end + 16);
+    if (diskNumber != 0 || directoryDisk != 0 || diskEntries != totalEntries)
+        return false;
+    if (totalEntries == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF)
+        return false;
+    if (static_cast<uint64_t>(directoryOffset) + directorySize > eocd)
+        return false;
+
+    // 文件前面可能拼接了其他数据（如自解压程序），偏移都要加上这段长度
+    size_t bias = eocd - directoryOffset - directorySize;
+    size_t pos = bias + directoryOffset;
+    const size_t directoryEnd = pos + directorySize;
+
+    m_entries.reserve(totalEntries);
+    for (uint32_t i = 0; i < totalEntries; ++i)
+    {
+        if (directoryEnd - pos < kCentralHeaderSize)
+            return false;
+        const uint8_t* header = m_data + pos;
+        if (Read32(header) != kCentralHeaderSignature)
+            return false;
+        size_t nameLength = Read16(header + 28);
+        size_t extraLength = Read16(header + 30);
+        size_t commentLength = Read16(header + 32);
+        size_t recordSize = kCentralHeaderSize + nameLength + extraLength + commentLength;
+        if (directoryEnd - pos < recordSize)
+            return false;
+
+        Entry entry;
+        entry.flags = Read16(header + 8);
+        entry.method = Read16(header + 10);
+        entry.crc32 = Read32(header + 16);
+        entry.compressedSize = Read32(header + 20);
+        entry.uncompressedSize = Read32(header + 24);
+        uint64_t localOffset = static_cast<uint64_t>(Read32(header + 42)) + bias;
+        if (localOffset > 0xFFFFFFFFu)
+            return false;
+        entry.localOffset = static_cast<uint32_t>(localOffset);
+        entry.nameOffset = static_cast<uint32_t>(m_names.size());
+        entry.nameLength = static_cast<uint32_t>(nameLength);
+        entry.hash = HashName(header + kCentralHeaderSize, nameLength);
+        m_names.append(reinterpret_cast<const char*>(header + kCentralHeaderSize), nameLength);
+        m_names.push_back('\0');
+        m_entries.push_back(entry);
+        pos += recordSize;
+    }
+
+    // 装载率不超过 1/2；重名时保留第一个，与 FindZipItem 的顺序查找结果相同
+    size_t capacity = 16;
+    while (capacity < m_entries.size() * 2)
+        capacity <<= 1;
+    m_slots.assign(capacity, 0);
+    const size_t mask = capacity - 1;
+    for (uint32_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& entry = m_entries[i];
+        const uint8_t* name = reinterpret_cast<const uint8_t*>(m_names.data()) + entry.nameOffset;
+        size_t slot = entry.hash & mask;
+        bool duplicate = false;
+        while (m_slots[slot] != 0)
+        {
+            const Entry& other = m_entries[m_slots[slot] - 1];
+            if (other.hash == entry.hash && other.nameLength == entry.nameLength &&
+                EqualNoCase(reinterpret_cast<const uint8_t*>(m_names.data()) + other.nameOffset, name, entry.nameLength))
+            {
+                duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if (!duplicate)
+            m_slots[slot] = i + 1;
+    }
+    return true;
+}
+
+int CZipResource::FindIndex(const char* name) const
+{
+    if (name == NULL || m_slots.empty())
+        return -1;
+    const uint8_t* key = reinterpret_cast<const uint8_t*>(name);
+    size_t length = strlen(name);
+    uint32_t hash = HashName(key, length);
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash & mask; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const Entry& entry = m_entries[m_slots[slot] - 1];
+        if (entry.hash == hash && entry.nameLength == length &&
+            EqualNoCase(reinterpret_cast<const uint8_t*>(m_names.data()) + entry.nameOffset, key, length))
+        {
+            return static_cast<int>(m_slots[slot] - 1);
+        }
+    }
+    return -1;
+}
+
+bool CZipResource::Find(const char* name, EntryInfo* info) const
+{
+    int index = FindIndex(name);
+    if (index < 0)
+        return false;
+    if (info != NULL)
+    {
+        const Entry& entry = m_entries[index];
+        info->index = static_cast<uint32_t>(index);
+        info->method = entry.method;
+        info->crc32 = entry.crc32;
+        info->compressedSize = entry.compressedSize;
+        info->uncompressedSize = entry.uncompressedSize;
+    }
+    return true;
+}
+
+bool CZipResource::Locate(const Entry& entry, const uint8_t*& data) const
+{
+    // 本地头中的文件名和扩展字段长度可能与中央目录不同，以本地头为准
+    if (entry.localOffset > m_size || m_size - entry.localOffset < kLocalHeaderSize)
+        return false;
+    const uint8_t* header = m_data + entry.localOffset;
+    if (Read32(header) != kLocalHeaderSignature)
+        return false;
+    size_t offset = static_cast<size_t>(entry.localOffset) + kLocalHeaderSize + Read16(header + 26) + Read16(header + 28);
+    if (offset > m_size || m_size - offset < entry.compressedSize)
+        return false;
+    data = m_data + offset;
+    return true;
+}
+
+bool CZipResource::Inflate(uint32_t index, std::shared_ptr<const std::string>& blob) const
+{
+    const Entry& entry = m_entries[index];
+    const uint8_t* data = NULL;
+    if (entry.uncompressedSize > m_config.maxEntryBytes || !Locate(entry, data))
+        return false;
+
+    std::shared_ptr<std::string> out = std::make_shared<std::string>();
+    out->resize(entry.uncompressedSize);
+    size_t produced = 0;
+    if (!InflateRawTo(data, entry.compressedSize, reinterpret_cast<uint8_t*>(&(*out)[0]), out->size(), &produced))
+        return false;
+    if (produced != entry.uncompressedSize || Crc32(reinterpret_cast<const uint8_t*>(out->data()), out->size()) != entry.crc32)
+        return false;
+    blob = out;
+    return true;
+}
+
+void CZipResource::Insert(uint32_t index, const std::shared_ptr<const std::string>& blob)
+{
+    // 调用方持有 m_pCache->mutex；超过总上限的单个条目只返回给调用方，不进 LRU
+    Cache& cache = *m_pCache;
+    if (blob->size() > m_config.cacheBytes)
+        return;
+    Cache::Slot& slot = cache.slots[index];
+    slot.blob = blob;
+    cache.lru.push_front(index);
+    slot.lruPos = cache.lru.begin();
+    cache.stats.cachedBytes += blob->size();
+    while (cache.stats.cachedBytes > m_config.cacheBytes)
+    {
+        uint32_t victim = cache.lru.back();
+        Cache::Slot& old = cache.slots[victim];
+        cache.stats.cachedBytes -= old.blob->size();
+        old.blob.reset();
+        cache.lru.pop_back();
+    }
+}
+
+bool CZipResource::Read(const char* name, Item& item)
+{
+    int index = FindIndex(name);
+    if (index < 0)
+        return false;
+    return ReadAt(static_cast<uint32_t>(index), item);
+}
+
+bool CZipResource::ReadAt(uint32_t index, Item& item)
+{
+    if (m_pCache == NULL || index >= m_entries.size())
+        return false;
+    const Entry& entry = m_entries[index];
+    if ((entry.flags & kFlagEncrypted) != 0)
+        return false;
+
+    Cache& cache = *m_pCache;
+    if (entry.method == kMethodStored)
+    {
+        const uint8_t* data = NULL;
+        if (entry.compressedSize != entry.uncompressedSize || !Locate(entry, data))
+            return false;
+        item.data = data;
+        item.size = entry.uncompressedSize;
+        item.holder.reset();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        ++cache.stats.reads;
+        ++cache.stats.storedReads;
+        return true;
+    }
+    if (entry.method != kMethodDeflate)
+        return false;
+
+    std::unique_lock<std::mutex> lock(cache.mutex);
+    ++cache.stats.reads;
+    Cache::Slot& slot = cache.slots[index];
+    bool waited = false;
+    for (;;)
+    {
+        if (slot.blob)
+        {
+            if (!waited)
+                ++cache.stats.cacheHits;
+            cache.lru.splice(cache.lru.begin(), cache.lru, slot.lruPos);
+            item.holder = slot.blob;
+            item.data = reinterpret_cast<const uint8_t*>(item.holder->data());
+            item.size = item.holder->size();
+            return true;
+        }
+        if (slot.state != Cache::kRunning)
+            break;
+        if (!waited)
+            ++cache.stats.waits;
+        waited = true;
+        cache.doneCond.wait(lock);
+    }
+    // 等到的解压失败了，或者结果大到没有进 LRU，自己再解一次
+    // 还在队列中的条目由当前线程接手，后台线程取到时发现状态已变会跳过
+    slot.state = Cache::kRunning;
+    lock.unlock();
+
+    std::shared_ptr<const std::string> blob;
+    bool ok = Inflate(index, blob);
+
+    lock.lock();
+    ++cache.stats.inflates;
+    slot.state = Cache::kIdle;
+    if (ok)
+        Insert(index, blob);
+    lock.unlock();
+    cache.doneCond.notify_all();
+    if (!ok)
+        return false;
+
+    item.holder = blob;
+    item.data = reinterpret_cast<const uint8_t*>(blob->data());
+    item.size = blob->size();
+    return true;
+}
+
+void CZipResource::Prefetch(const std::vector<std::string>& names)
+{
+    if (m_pCache == NULL)
+        return;
+    Cache& cache = *m_pCache;
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            int index = FindIndex(names[i].c_str());
+            if (index < 0)
+                continue;
+            const Entry& entry = m_entries[index];
+            Cache::Slot& slot = cache.slots[index];
+            if (entry.method != kMethodDeflate || (entry.flags & kFlagEncrypted) != 0 || slot.blob || slot.state != Cache::kIdle)
+                continue;
+            slot.state = Cache::kQueued;
+            cache.queue.push_back(static_cast<uint32_t>(index));
+            queued = true;
+        }
+        if (queued && cache.workers.empty())
+        {
+            unsigned int count = m_config.workerCount;
+            if (count == 0)
+            {
+                unsigned int cores = std::thread::hardware_concurrency();
+                count = cores > 1 ? cores - 1 : 1;
+                if (count > kMaxWorkers)
+                    count = kMaxWorkers;
+            }
+            for (unsigned int i = 0; i < count; ++i)
+                cache.workers.push_back(std::thread(&CZipResource::WorkerProc, this));
+        }
+    }
+    if (queued)
+        cache.wakeCond.notify_all();
+}
+
+void CZipResource::WaitIdle()
+{
+    if (m_pCache == NULL)
+        return;
+    Cache& cache = *m_pCache;
+    std::unique_lock<std::mutex> lock(cache.mutex);
+    cache.doneCond.wait(lock, [&cache]() { return cache.queue.empty() && cache.running == 0; });
+}
+
+void CZipResource::WorkerProc()
+{
+    Cache& cache = *m_pCache;
+    std::unique_lock<std::mutex> lock(cache.mutex);
+    for (;;)
+    {
+        cache.wakeCond.wait(lock, [&cache]() { return cache.stop || !cache.queue.empty(); });
+        if (cache.stop)
+            return;
+
+        uint32_t index = cache.queue.front();
+        cache.queue.pop_front();
+        Cache::Slot& slot = cache.slots[index];
+        if (slot.state != Cache::kQueued)
+        {
+            // 已被 Read 接手
+            if (cache.queue.empty() && cache.running == 0)
+                cache.doneCond.notify_all();
+            continue;
+        }
+        slot.state = Cache::kRunning;
+        ++cache.running;
+        lock.unlock();
+
+        std::shared_ptr<const std::string> blob;
+        bool ok = Inflate(index, blob);
+
+        lock.lock();
+        --cache.running;
+        ++cache.stats.inflates;
+        slot.state = Cache::kIdle;
+        if (ok)
+            Insert(index, blob);
+        cache.doneCond.notify_all();
+    }
+}
+
+CZipResource::Stats CZipResource::GetStats() const
+{
+    if (m_pCache == NULL)
+        return Stats();
+    std::lock_guard<std::mutex> lock(m_pCache->mutex);
+    return m_pCache->stats;
+}
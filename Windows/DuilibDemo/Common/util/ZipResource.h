@@ -0,0 +1,121 @@
+﻿/*
+* Module:   CZipResource
+*
+* Function: 资源 zip 的只读索引，代替 unzip.cpp 中每次 FindZipItem 都从头遍历中央目录
+*
+*    1. 打开时把中央目录解析成 名字 -> (偏移, 大小, 压缩方式) 的哈希表，名字按 ASCII 忽略大小写比较，与 FindZipItem(ic = true) 一致。
+*    2. 整个文件只映射一次；不压缩（stored）的条目直接返回映射中的指针，不拷贝。
+*    3. deflate 条目解压后放进按字节数淘汰的 LRU；Prefetch 把条目交给后台线程并行解压，Read 遇到正在解压的条目会等它完成。
+*    4. 只支持不加密的 stored/deflate 条目，不支持 zip64，遇到这些情况 Open/Read 返回 false，调用方退回 unzip.cpp。
+*
+*    Open/Close 不能和 Read/Prefetch 并发，Read/Prefetch 之间可以并发。不依赖 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __ZIP_RESOURCE_H__
+#define __ZIP_RESOURCE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CMappedFile;
+
+class CZipResource
+{
+public:
+    struct Config
+    {
+        size_t cacheBytes = 16 * 1024 * 1024;       // LRU 中解压数据的总字节数上限
+        unsigned int workerCount = 0;               // 后台解压线程数，0 表示按 CPU 核数（1 到 4 个）
+        size_t maxEntryBytes = 64 * 1024 * 1024;    // 解压后超过该大小的条目不读取
+    };
+
+    struct EntryInfo
+    {
+        uint32_t index = 0;             // 在中央目录中的序号，与 FindZipItem 返回的 index 相同
+        uint16_t method = 0;            // 0 为 stored，8 为 deflate
+        uint32_t crc32 = 0;
+        uint32_t compressedSize = 0;
+        uint32_t uncompressedSize = 0;
+    };
+
+    // 条目数据：stored 条目指向映射（holder 为空），deflate 条目由 holder 持有，被 LRU 淘汰后仍然有效
+    struct Item
+    {
+        const uint8_t* data = NULL;
+        size_t size = 0;
+        std::shared_ptr<const std::string> holder;
+    };
+
+    struct Stats
+    {
+        uint64_t reads = 0;
+        uint64_t storedReads = 0;       // 零拷贝返回的 stored 条目
+        uint64_t cacheHits = 0;
+        uint64_t inflates = 0;          // 实际执行的解压次数（包括后台预取）
+        uint64_t waits = 0;             // Read 等待后台解压完成的次数
+        size_t cachedBytes = 0;
+    };
+public:
+    CZipResource();
+    explicit CZipResource(const Config& config);
+    ~CZipResource();
+
+    bool Open(const char* path);
+#ifdef _WIN32
+    bool Open(const wchar_t* path);
+#endif
+    // 使用调用方的内存，Close 之前必须保持有效
+    bool Open(const void* data, size_t size);
+    void Close();
+    bool IsOpen() const { return m_data != NULL; }
+
+    size_t GetEntryCount() const { return m_entries.size(); }
+    // name 为 UTF-8，不做 '\\' 到 '/' 的转换（与 FindZipItem 一致，由调用方处理）
+    bool Find(const char* name, EntryInfo* info) const;
+    bool Read(const char* name, Item& item);
+    bool ReadAt(uint32_t index, Item& item);
+
+    // 在后台解压这些条目，结果进入 LRU；找不到、stored 或已缓存的条目直接忽略
+    void Prefetch(const std::vector<std::string>& names);
+    // 等待已提交的预取全部完成
+    void WaitIdle();
+
+    Stats GetStats() const;
+private:
+    CZipResource(const CZipResource&);
+    CZipResource& operator=(const CZipResource&);
+
+    struct Entry
+    {
+        uint32_t nameOffset;            // 在 m_names 中的偏移，以 0 结尾
+        uint32_t nameLength;
+        uint32_t hash;
+        uint32_t localOffset;
+        uint32_t compressedSize;
+        uint32_t uncompressedSize;
+        uint32_t crc32;
+        uint16_t method;
+        uint16_t flags;
+    };
+    class Cache;
+
+    bool ParseDirectory();
+    int FindIndex(const char* name) const;
+    bool Locate(const Entry& entry, const uint8_t*& data) const;
+    bool Inflate(uint32_t index, std::shared_ptr<const std::string>& blob) const;
+    void Insert(uint32_t index, const std::shared_ptr<const std::string>& blob);
+    void WorkerProc();
+private:
+    Config m_config;
+    CMappedFile* m_pFile;
+    const uint8_t* m_data;
+    size_t m_size;
+    std::vector<Entry> m_entries;
+    std::string m_names;
+    std::vector<uint32_t> m_slots;      // 开放寻址，存 序号 + 1，0 表示空槽；容量为 2 的幂
+    Cache* m_pCache;
+};
+
+#endif /* __ZIP_RESOURCE_H__ */
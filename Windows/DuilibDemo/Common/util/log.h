@@ -1,88 +1,107 @@
 #ifndef __TMPLOG_H__
 #define __TMPLOG_H__
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#endif
 #include <string>
 #include <assert.h>
+#include "AsyncLogger.h"
 
 // 宽字符转换宏
 #define __W(str)    L##str
 #define _W(str)     __W(str)
 
-typedef enum LOGGER_LEVEL
-{
-    TrackLevel      = 0,
-    InfoLevel       = 1,
-    WarningLevel    = 2,
-    ErrorLevel      = 3,
-    FatalLevel      = 4,
-
-    // 标识函数进入和退出
-    InLevel         = 5,
-    OutLevel        = 6
-} ENM_LOGGER_LEVEL;
+// 编译期日志级别：低于该级别的日志调用不生成代码（0 Track, 1 Info, 2 Warning, 3 Error, 4 Fatal）
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL   0
+#endif
 
 class Log
 {
 public:
-    Log(const std::wstring& strFilePath, const std::wstring& strFunctionName, int iLine);
+    // pSites 为 [进入, 退出] 两个调用点，firstSiteId 为进入调用点的 id
+    Log(const LogSite* pSites, uint32_t firstSiteId);
     ~Log();
 public:
-    static void Write(ENM_LOGGER_LEVEL logLevel,
-        const std::wstring& strFilePath,
-        const std::wstring& strFunctionName,
-        int iLine,
-        LPCWSTR pszFormat, ...);
+    // 由日志宏调用：格式化和写文件在后台线程完成
+    static void Write(uint32_t siteId, const LogSite* pSite, ...);
+    static void Flush();
+    static void SetLevel(ENM_LOGGER_LEVEL logLevel);
 public:
-    static FILE* _CreateFile();
+    static std::wstring _GetLogDirectory();
     static std::wstring _GetModuleName();
-    static std::wstring _GetShortFuncName(const std::wstring& strFunctionName);
     static std::wstring _GetDateTimeString();
-    static std::wstring _GetDWORString(DWORD dwVal);
-    static std::wstring _GetLevel(ENM_LOGGER_LEVEL logLevel);
 private:
-    const std::wstring      m_strFilePath;
-    const std::wstring      m_strFunctionName;
-    int                     m_iLine;
+    static void _StartLogger();
+private:
+    const LogSite*          m_pSites;
+    uint32_t                m_firstSiteId;
 };
 
+// 调用点元数据在编译期生成，首次执行时注册；级别被过滤时不对参数求值
+#define LOG_SITE_WRITE(level, formatstr, ...)                                                                   \
+        do                                                                                                      \
+        {                                                                                                       \
+            if (LogLevelRank(level) >= LOG_COMPILE_LEVEL && CAsyncLogger::IsLevelEnabled(level))                \
+            {                                                                                                   \
+                static constexpr LogSite __log_site__ = { level, __LINE__,                                      \
+                    LogSiteFileName(__FILE__, __FILE__),                                                        \
+                    LogSiteFuncName(__FUNCTION__, __FUNCTION__, __FUNCTION__, __FUNCTION__), formatstr };       \
+                static const uint32_t __log_site_id__ = CAsyncLogger::Instance().RegisterSites(&__log_site__, 1); \
+                Log::Write(__log_site_id__, &__log_site__, ##__VA_ARGS__);                                      \
+            }                                                                                                   \
+        } while (false)
+
 #if defined(USE_LOG)
-    #define LTRACE(formatstr, ...)      Log::Write(TrackLevel,    _W(__FILE__), _W(__FUNCTION__), __LINE__, formatstr, ##__VA_ARGS__)
-    #define LINFO(formatstr, ...)       Log::Write(InfoLevel,     _W(__FILE__), _W(__FUNCTION__), __LINE__, formatstr, ##__VA_ARGS__)
+    #define LTRACE(formatstr, ...)      LOG_SITE_WRITE(TrackLevel,    formatstr, ##__VA_ARGS__)
+    #define LINFO(formatstr, ...)       LOG_SITE_WRITE(InfoLevel,     formatstr, ##__VA_ARGS__)
 
     #define LWARNING(formatstr, ...)                                                                            \
             do                                                                                                  \
             {                                                                                                   \
-                Log::Write(WarningLevel, _W(__FILE__), _W(__FUNCTION__), __LINE__, formatstr, ##__VA_ARGS__);   \
-                assert(FALSE);                                                                               \
+                LOG_SITE_WRITE(WarningLevel, formatstr, ##__VA_ARGS__);                                         \
+                assert(false);                                                                               \
             } while (false)
 
     #define LERROR(formatstr, ...)                                                                              \
             do                                                                                                  \
             {                                                                                                   \
-                Log::Write(ErrorLevel, _W(__FILE__), _W(__FUNCTION__), __LINE__, formatstr, ##__VA_ARGS__);     \
-                assert(FALSE);                                                                               \
+                LOG_SITE_WRITE(ErrorLevel, formatstr, ##__VA_ARGS__);                                           \
+                assert(false);                                                                               \
             } while (false)
 
     #define LFATAL(formatstr, ...)                                                                              \
             do                                                                                                  \
             {                                                                                                   \
-                Log::Write(FatalLevel, _W(__FILE__), _W(__FUNCTION__), __LINE__, formatstr, ##__VA_ARGS__);     \
-                assert(FALSE);                                                                               \
+                LOG_SITE_WRITE(FatalLevel, formatstr, ##__VA_ARGS__);                                           \
+                assert(false);                                                                               \
             } while (false)
 
+    // level 须为编译期常量
     #define LOGOUT(level, formatstr, ...)                                                                       \
             do                                                                                                  \
             {                                                                                                   \
-                Log::Write(level, _W(__FILE__), _W(__FUNCTION__), __LINE__, formatstr, ##__VA_ARGS__)           \
+                LOG_SITE_WRITE(level, formatstr, ##__VA_ARGS__);                                                \
                 if (WarningLevel == level || ErrorLevel == level || FatalLevel == level)                        \
                 {                                                                                               \
-                    assert(FALSE);                                                                           \
+                    assert(false);                                                                           \
                 }                                                                                               \
             } while (false)
 
-    #define LOGGER                      Log __tmp_logger__(_W(__FILE__), _W(__FUNCTION__), __LINE__)
+#if LOG_COMPILE_LEVEL > 0
+    #define LOGGER
+#else
+    #define LOGGER                                                                                              \
+            static constexpr LogSite __log_scope_sites__[2] = {                                                 \
+                { InLevel, __LINE__, LogSiteFileName(__FILE__, __FILE__),                                       \
+                    LogSiteFuncName(__FUNCTION__, __FUNCTION__, __FUNCTION__, __FUNCTION__), L"" },             \
+                { OutLevel, __LINE__, LogSiteFileName(__FILE__, __FILE__),                                      \
+                    LogSiteFuncName(__FUNCTION__, __FUNCTION__, __FUNCTION__, __FUNCTION__), L"" } };           \
+            static const uint32_t __log_scope_site_id__ = CAsyncLogger::Instance().RegisterSites(__log_scope_sites__, 2); \
+            Log __tmp_logger__(__log_scope_sites__, __log_scope_site_id__)
+#endif
 #else
     #define LTRACE(formatstr, ...)
     #define LINFO(formatstr, ...)
@@ -33,6 +33,8 @@
   <ghost@aladdin.com>.  Other authors are noted in the change history
   that follows (in reverse chronological order):
 
+  2026-10-18 Multi-block transform with direct little-endian word loads;
+	added md5_hex and the SSE2/AVX2 multi-buffer md5_batch.
   1999-11-04 lpd Edited comments slightly for automatic TOC extraction.
   1999-10-18 lpd Fixed typo in header comment (ansi2knr rather than md5).
   1999-05-03 lpd Original version.
@@ -41,9 +43,8 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <stdio.h>
-#else
-#include <string.h>
 #endif
+#include <string.h>
 
 #include "md5.h"
 
@@ -128,162 +129,141 @@ DWORD TenMd5(BYTE *pbyBuf, DWORD dwSize, BYTE *pbyResult)
     return MD5_RESULT_LEN;
 }
 
-static void
-md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
-{
-    md5_word_t
-	a = pms->abcd[0], b = pms->abcd[1],
-	c = pms->abcd[2], d = pms->abcd[3];
-    md5_word_t t;
+#if defined(_MSC_VER)
+# include <stdlib.h>
+# define MD5_ROTL(x, n) _rotl((x), (n))
+#else
+# define MD5_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#endif
 
-#ifndef ARCH_IS_BIG_ENDIAN
-# define ARCH_IS_BIG_ENDIAN 1	/* slower, default implementation */
+/*
+ * Little-endian targets (every target this demo builds for) load the
+ * message words directly; memcpy of 4 bytes compiles to a single mov and
+ * has no alignment requirement.
+ */
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__) || \
+    (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+# define MD5_LOAD_WORD(p) md5_load_le(p)
+static inline md5_word_t md5_load_le(const md5_byte_t *p)
+{
+    md5_word_t w;
+    memcpy(&w, p, 4);
+    return w;
+}
+#else
+# define MD5_LOAD_WORD(p) \
+    ((md5_word_t)(p)[0] | ((md5_word_t)(p)[1] << 8) | ((md5_word_t)(p)[2] << 16) | ((md5_word_t)(p)[3] << 24))
 #endif
-#if ARCH_IS_BIG_ENDIAN
 
-    /*
-     * On big-endian machines, we must arrange the bytes in the right
-     * order.  (This also works on machines of unknown byte order.)
-     */
+/*
+ * F and G are written in the equivalent "select" forms which need one
+ * operation less than the RFC text.
+ */
+#define MD5_F(x, y, z) ((((y) ^ (z)) & (x)) ^ (z))
+#define MD5_G(x, y, z) ((((x) ^ (y)) & (z)) ^ (y))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_STEP(f, a, b, c, d, k, s, Ti) \
+    a += f(b, c, d) + X[k] + (Ti); \
+    a = MD5_ROTL(a, s) + b
+
+/* Run nblocks consecutive 64-byte blocks, keeping the state in registers. */
+static void
+md5_process_blocks(md5_word_t abcd[4], const md5_byte_t *data, size_t nblocks)
+{
+    md5_word_t a = abcd[0], b = abcd[1], c = abcd[2], d = abcd[3];
     md5_word_t X[16];
-    const md5_byte_t *xp = data;
     int i;
 
-    for (i = 0; i < 16; ++i, xp += 4)
-	X[i] = xp[0] + (xp[1] << 8) + (xp[2] << 16) + (xp[3] << 24);
-
-#else  /* !ARCH_IS_BIG_ENDIAN */
-
-    /*
-     * On little-endian machines, we can process properly aligned data
-     * without copying it.
-     */
-    md5_word_t xbuf[16];
-    const md5_word_t *X;
-
-    if (!((data - (const md5_byte_t *)0) & 3)) {
-	/* data are properly aligned */
-	X = (const md5_word_t *)data;
-    } else {
-	/* not aligned */
-	memcpy(xbuf, data, 64);
-	X = xbuf;
+    for (; nblocks > 0; --nblocks, data += 64)
+    {
+        md5_word_t aa = a, bb = b, cc = c, dd = d;
+
+        for (i = 0; i < 16; ++i)
+            X[i] = MD5_LOAD_WORD(data + i * 4);
+
+        /* Round 1. */
+        MD5_STEP(MD5_F, a, b, c, d,  0,  7,  T1);
+        MD5_STEP(MD5_F, d, a, b, c,  1, 12,  T2);
+        MD5_STEP(MD5_F, c, d, a, b,  2, 17,  T3);
+        MD5_STEP(MD5_F, b, c, d, a,  3, 22,  T4);
+        MD5_STEP(MD5_F, a, b, c, d,  4,  7,  T5);
+        MD5_STEP(MD5_F, d, a, b, c,  5, 12,  T6);
+        MD5_STEP(MD5_F, c, d, a, b,  6, 17,  T7);
+        MD5_STEP(MD5_F, b, c, d, a,  7, 22,  T8);
+        MD5_STEP(MD5_F, a, b, c, d,  8,  7,  T9);
+        MD5_STEP(MD5_F, d, a, b, c,  9, 12, T10);
+        MD5_STEP(MD5_F, c, d, a, b, 10, 17, T11);
+        MD5_STEP(MD5_F, b, c, d, a, 11, 22, T12);
+        MD5_STEP(MD5_F, a, b, c, d, 12,  7, T13);
+        MD5_STEP(MD5_F, d, a, b, c, 13, 12, T14);
+        MD5_STEP(MD5_F, c, d, a, b, 14, 17, T15);
+        MD5_STEP(MD5_F, b, c, d, a, 15, 22, T16);
+
+        /* Round 2. */
+        MD5_STEP(MD5_G, a, b, c, d,  1,  5, T17);
+        MD5_STEP(MD5_G, d, a, b, c,  6,  9, T18);
+        MD5_STEP(MD5_G, c, d, a, b, 11, 14, T19);
+        MD5_STEP(MD5_G, b, c, d, a,  0, 20, T20);
+        MD5_STEP(MD5_G, a, b, c, d,  5,  5, T21);
+        MD5_STEP(MD5_G, d, a, b, c, 10,  9, T22);
+        MD5_STEP(MD5_G, c, d, a, b, 15, 14, T23);
+        MD5_STEP(MD5_G, b, c, d, a,  4, 20, T24);
+        MD5_STEP(MD5_G, a, b, c, d,  9,  5, T25);
+        MD5_STEP(MD5_G, d, a, b, c, 14,  9, T26);
+        MD5_STEP(MD5_G, c, d, a, b,  3, 14, T27);
+        MD5_STEP(MD5_G, b, c, d, a,  8, 20, T28);
+        MD5_STEP(MD5_G, a, b, c, d, 13,  5, T29);
+        MD5_STEP(MD5_G, d, a, b, c,  2,  9, T30);
+        MD5_STEP(MD5_G, c, d, a, b,  7, 14, T31);
+        MD5_STEP(MD5_G, b, c, d, a, 12, 20, T32);
+
+        /* Round 3. */
+        MD5_STEP(MD5_H, a, b, c, d,  5,  4, T33);
+        MD5_STEP(MD5_H, d, a, b, c,  8, 11, T34);
+        MD5_STEP(MD5_H, c, d, a, b, 11, 16, T35);
+        MD5_STEP(MD5_H, b, c, d, a, 14, 23, T36);
+        MD5_STEP(MD5_H, a, b, c, d,  1,  4, T37);
+        MD5_STEP(MD5_H, d, a, b, c,  4, 11, T38);
+        MD5_STEP(MD5_H, c, d, a, b,  7, 16, T39);
+        MD5_STEP(MD5_H, b, c, d, a, 10, 23, T40);
+        MD5_STEP(MD5_H, a, b, c, d, 13,  4, T41);
+        MD5_STEP(MD5_H, d, a, b, c,  0, 11, T42);
+        MD5_STEP(MD5_H, c, d, a, b,  3, 16, T43);
+        MD5_STEP(MD5_H, b, c, d, a,  6, 23, T44);
+        MD5_STEP(MD5_H, a, b, c, d,  9,  4, T45);
+        MD5_STEP(MD5_H, d, a, b, c, 12, 11, T46);
+        MD5_STEP(MD5_H, c, d, a, b, 15, 16, T47);
+        MD5_STEP(MD5_H, b, c, d, a,  2, 23, T48);
+
+        /* Round 4. */
+        MD5_STEP(MD5_I, a, b, c, d,  0,  6, T49);
+        MD5_STEP(MD5_I, d, a, b, c,  7, 10, T50);
+        MD5_STEP(MD5_I, c, d, a, b, 14, 15, T51);
+        MD5_STEP(MD5_I, b, c, d, a,  5, 21, T52);
+        MD5_STEP(MD5_I, a, b, c, d, 12,  6, T53);
+        MD5_STEP(MD5_I, d, a, b, c,  3, 10, T54);
+        MD5_STEP(MD5_I, c, d, a, b, 10, 15, T55);
+        MD5_STEP(MD5_I, b, c, d, a,  1, 21, T56);
+        MD5_STEP(MD5_I, a, b, c, d,  8,  6, T57);
+        MD5_STEP(MD5_I, d, a, b, c, 15, 10, T58);
+        MD5_STEP(MD5_I, c, d, a, b,  6, 15, T59);
+        MD5_STEP(MD5_I, b, c, d, a, 13, 21, T60);
+        MD5_STEP(MD5_I, a, b, c, d,  4,  6, T61);
+        MD5_STEP(MD5_I, d, a, b, c, 11, 10, T62);
+        MD5_STEP(MD5_I, c, d, a, b,  2, 15, T63);
+        MD5_STEP(MD5_I, b, c, d, a,  9, 21, T64);
+
+        a += aa;
+        b += bb;
+        c += cc;
+        d += dd;
     }
-#endif
 
-#define ROTATE_LEFT(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
-
-    /* Round 1. */
-    /* Let [abcd k s i] denote the operation
-       a = b + ((a + F(b,c,d) + X[k] + T[i]) <<< s). */
-#define F(x, y, z) (((x) & (y)) | (~(x) & (z)))
-#define SET(a, b, c, d, k, s, Ti)\
-  t = a + F(b,c,d) + X[k] + Ti;\
-  a = ROTATE_LEFT(t, s) + b
-    /* Do the following 16 operations. */
-    SET(a, b, c, d,  0,  7,  T1);
-    SET(d, a, b, c,  1, 12,  T2);
-    SET(c, d, a, b,  2, 17,  T3);
-    SET(b, c, d, a,  3, 22,  T4);
-    SET(a, b, c, d,  4,  7,  T5);
-    SET(d, a, b, c,  5, 12,  T6);
-    SET(c, d, a, b,  6, 17,  T7);
-    SET(b, c, d, a,  7, 22,  T8);
-    SET(a, b, c, d,  8,  7,  T9);
-    SET(d, a, b, c,  9, 12, T10);
-    SET(c, d, a, b, 10, 17, T11);
-    SET(b, c, d, a, 11, 22, T12);
-    SET(a, b, c, d, 12,  7, T13);
-    SET(d, a, b, c, 13, 12, T14);
-    SET(c, d, a, b, 14, 17, T15);
-    SET(b, c, d, a, 15, 22, T16);
-#undef SET
-
-     /* Round 2. */
-     /* Let [abcd k s i] denote the operation
-          a = b + ((a + G(b,c,d) + X[k] + T[i]) <<< s). */
-#define G(x, y, z) (((x) & (z)) | ((y) & ~(z)))
-#define SET(a, b, c, d, k, s, Ti)\
-  t = a + G(b,c,d) + X[k] + Ti;\
-  a = ROTATE_LEFT(t, s) + b
-     /* Do the following 16 operations. */
-    SET(a, b, c, d,  1,  5, T17);
-    SET(d, a, b, c,  6,  9, T18);
-    SET(c, d, a, b, 11, 14, T19);
-    SET(b, c, d, a,  0, 20, T20);
-    SET(a, b, c, d,  5,  5, T21);
-    SET(d, a, b, c, 10,  9, T22);
-    SET(c, d, a, b, 15, 14, T23);
-    SET(b, c, d, a,  4, 20, T24);
-    SET(a, b, c, d,  9,  5, T25);
-    SET(d, a, b, c, 14,  9, T26);
-    SET(c, d, a, b,  3, 14, T27);
-    SET(b, c, d, a,  8, 20, T28);
-    SET(a, b, c, d, 13,  5, T29);
-    SET(d, a, b, c,  2,  9, T30);
-    SET(c, d, a, b,  7, 14, T31);
-    SET(b, c, d, a, 12, 20, T32);
-#undef SET
-
-     /* Round 3. */
-     /* Let [abcd k s t] denote the operation
-          a = b + ((a + H(b,c,d) + X[k] + T[i]) <<< s). */
-#define H(x, y, z) ((x) ^ (y) ^ (z))
-#define SET(a, b, c, d, k, s, Ti)\
-  t = a + H(b,c,d) + X[k] + Ti;\
-  a = ROTATE_LEFT(t, s) + b
-     /* Do the following 16 operations. */
-    SET(a, b, c, d,  5,  4, T33);
-    SET(d, a, b, c,  8, 11, T34);
-    SET(c, d, a, b, 11, 16, T35);
-    SET(b, c, d, a, 14, 23, T36);
-    SET(a, b, c, d,  1,  4, T37);
-    SET(d, a, b, c,  4, 11, T38);
-    SET(c, d, a, b,  7, 16, T39);
-    SET(b, c, d, a, 10, 23, T40);
-    SET(a, b, c, d, 13,  4, T41);
-    SET(d, a, b, c,  0, 11, T42);
-    SET(c, d, a, b,  3, 16, T43);
-    SET(b, c, d, a,  6, 23, T44);
-    SET(a, b, c, d,  9,  4, T45);
-    SET(d, a, b, c, 12, 11, T46);
-    SET(c, d, a, b, 15, 16, T47);
-    SET(b, c, d, a,  2, 23, T48);
-#undef SET
-
-     /* Round 4. */
-     /* Let [abcd k s t] denote the operation
-          a = b + ((a + I(b,c,d) + X[k] + T[i]) <<< s). */
-#define I(x, y, z) ((y) ^ ((x) | ~(z)))
-#define SET(a, b, c, d, k, s, Ti)\
-  t = a + I(b,c,d) + X[k] + Ti;\
-  a = ROTATE_LEFT(t, s) + b
-     /* Do the following 16 operations. */
-    SET(a, b, c, d,  0,  6, T49);
-    SET(d, a, b, c,  7, 10, T50);
-    SET(c, d, a, b, 14, 15, T51);
-    SET(b, c, d, a,  5, 21, T52);
-    SET(a, b, c, d, 12,  6, T53);
-    SET(d, a, b, c,  3, 10, T54);
-    SET(c, d, a, b, 10, 15, T55);
-    SET(b, c, d, a,  1, 21, T56);
-    SET(a, b, c, d,  8,  6, T57);
-    SET(d, a, b, c, 15, 10, T58);
-    SET(c, d, a, b,  6, 15, T59);
-    SET(b, c, d, a, 13, 21, T60);
-    SET(a, b, c, d,  4,  6, T61);
-    SET(d, a, b, c, 11, 10, T62);
-    SET(c, d, a, b,  2, 15, T63);
-    SET(b, c, d, a,  9, 21, T64);
-#undef SET
-
-     /* Then perform the following additions. (That is increment each
-        of the four registers by the value it had before this block
-        was started.) */
-    pms->abcd[0] += a;
-    pms->abcd[1] += b;
-    pms->abcd[2] += c;
-    pms->abcd[3] += d;
+    abcd[0] = a;
+    abcd[1] = b;
+    abcd[2] = c;
+    abcd[3] = d;
 }
 
 void
@@ -322,12 +302,15 @@ md5_append(md5_state_t *pms, const md5_byte_t *data, int nbytes)
 	    return;
 	p += copy;
 	left -= copy;
-	md5_process(pms, pms->buf);
+	md5_process_blocks(pms->abcd, pms->buf, 1);
     }
 
-    /* Process full blocks. */
-    for (; left >= 64; p += 64, left -= 64)
-	md5_process(pms, p);
+    /* Process full blocks straight from the caller's buffer. */
+    if (left >= 64) {
+	md5_process_blocks(pms->abcd, p, left >> 6);
+	p += left & ~63;
+	left &= 63;
+    }
 
     /* Process a final partial block. */
     if (left)
@@ -356,3 +339,410 @@ md5_finish(md5_state_t *pms, md5_byte_t digest[16])
     for (i = 0; i < 16; ++i)
 	digest[i] = (md5_byte_t)(pms->abcd[i >> 2] >> ((i & 3) << 3));
 }
+
+//////////////////////////////////////////////////////////////////////////hex
+
+void
+md5_hex(const md5_byte_t digest[16], char hex[33])
+{
+    /* Two output characters per table entry, one lookup per digest byte. */
+    static const char table[513] =
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+        "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+        "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+        "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+        "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+        "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+        "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+        "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+    int i;
+
+    for (i = 0; i < 16; ++i)
+        memcpy(hex + i * 2, table + digest[i] * 2, 2);
+    hex[32] = '\0';
+}
+
+//////////////////////////////////////////////////////////////////////////batch
+
+/*
+ * Multi-buffer hashing: MD5 is a strict chain within one message, so the
+ * only data parallelism is across messages. Each SIMD lane carries the
+ * state of one message; lane k of X[i] holds word i of that message's
+ * current block. Lanes whose message has already ended keep their state
+ * through a mask, so messages of different lengths can share a batch
+ * (it is fastest when they are of similar length).
+ */
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+# define MD5_HAVE_SIMD 1
+# include <emmintrin.h>
+# include <immintrin.h>
+# if defined(_MSC_VER)
+#  include <intrin.h>
+#  define MD5_TARGET_AVX2
+# else
+#  include <cpuid.h>
+#  define MD5_TARGET_AVX2 __attribute__((target("avx2")))
+# endif
+#else
+# define MD5_HAVE_SIMD 0
+#endif
+
+#define MD5_MAX_LANES 8
+
+typedef struct md5_lane_s
+{
+    const md5_byte_t *data;
+    size_t full_blocks;             /* blocks taken straight from data */
+    size_t total_blocks;            /* full_blocks plus 1 or 2 padding blocks */
+    md5_byte_t tail[128];           /* the rest of the message, padding and length */
+} md5_lane_t;
+
+static void
+md5_lane_init(md5_lane_t *lane, const md5_byte_t *data, size_t size)
+{
+    size_t rest = size & 63;
+    size_t tail_size = rest < 56 ? 64 : 128;
+    md5_word_t bits_lo = (md5_word_t)(size << 3);
+    md5_word_t bits_hi = (md5_word_t)((unsigned long long)size >> 29);
+    int i;
+
+    lane->data = data;
+    lane->full_blocks = size >> 6;
+    lane->total_blocks = lane->full_blocks + tail_size / 64;
+    if (rest)
+        memcpy(lane->tail, data + (size - rest), rest);
+    lane->tail[rest] = 0x80;
+    memset(lane->tail + rest + 1, 0, tail_size - rest - 1 - 8);
+    for (i = 0; i < 4; ++i)
+    {
+        lane->tail[tail_size - 8 + i] = (md5_byte_t)(bits_lo >> (i * 8));
+        lane->tail[tail_size - 4 + i] = (md5_byte_t)(bits_hi >> (i * 8));
+    }
+}
+
+static const md5_byte_t *
+md5_lane_block(const md5_lane_t *lane, size_t index)
+{
+    if (index < lane->full_blocks)
+        return lane->data + index * 64;
+    return lane->tail + (index - lane->full_blocks) * 64;
+}
+
+#if MD5_HAVE_SIMD
+
+/*
+ * The round code is shared by the SSE2 and AVX2 kernels; the vector
+ * operations are supplied as macros (VADD, VAND, VOR, VXOR, VSLL, VSRL,
+ * VSET1) before expanding MD5_SIMD_ROUNDS.
+ */
+#define MD5_VF(x, y, z) VXOR(VAND(VXOR(y, z), x), z)
+#define MD5_VG(x, y, z) VXOR(VAND(VXOR(x, y), z), y)
+#define MD5_VH(x, y, z) VXOR(VXOR(x, y), z)
+#define MD5_VI(x, y, z) VXOR(y, VOR(x, VXOR(z, ones)))
+#define MD5_VSTEP(f, a, b, c, d, k, s, Ti) \
+    a = VADD(a, VADD(f(b, c, d), VADD(X[k], VSET1((int)(Ti))))); \
+    a = VADD(VOR(VSLL(a, s), VSRL(a, 32 - s)), b)
+
+#define MD5_SIMD_ROUNDS \
+    MD5_VSTEP(MD5_VF, a, b, c, d,  0,  7,  T1); \
+    MD5_VSTEP(MD5_VF, d, a, b, c,  1, 12,  T2); \
+    MD5_VSTEP(MD5_VF, c, d, a, b,  2, 17,  T3); \
+    MD5_VSTEP(MD5_VF, b, c, d, a,  3, 22,  T4); \
+    MD5_VSTEP(MD5_VF, a, b, c, d,  4,  7,  T5); \
+    MD5_VSTEP(MD5_VF, d, a, b, c,  5, 12,  T6); \
+    MD5_VSTEP(MD5_VF, c, d, a, b,  6, 17,  T7); \
+    MD5_VSTEP(MD5_VF, b, c, d, a,  7, 22,  T8); \
+    MD5_VSTEP(MD5_VF, a, b, c, d,  8,  7,  T9); \
+    MD5_VSTEP(MD5_VF, d, a, b, c,  9, 12, T10); \
+    MD5_VSTEP(MD5_VF, c, d, a, b, 10, 17, T11); \
+    MD5_VSTEP(MD5_VF, b, c, d, a, 11, 22, T12); \
+    MD5_VSTEP(MD5_VF, a, b, c, d, 12,  7, T13); \
+    MD5_VSTEP(MD5_VF, d, a, b, c, 13, 12, T14); \
+    MD5_VSTEP(MD5_VF, c, d, a, b, 14, 17, T15); \
+    MD5_VSTEP(MD5_VF, b, c, d, a, 15, 22, T16); \
+    MD5_VSTEP(MD5_VG, a, b, c, d,  1,  5, T17); \
+    MD5_VSTEP(MD5_VG, d, a, b, c,  6,  9, T18); \
+    MD5_VSTEP(MD5_VG, c, d, a, b, 11, 14, T19); \
+    MD5_VSTEP(MD5_VG, b, c, d, a,  0, 20, T20); \
+    MD5_VSTEP(MD5_VG, a, b, c, d,  5,  5, T21); \
+    MD5_VSTEP(MD5_VG, d, a, b, c, 10,  9, T22); \
+    MD5_VSTEP(MD5_VG, c, d, a, b, 15, 14, T23); \
+    MD5_VSTEP(MD5_VG, b, c, d, a,  4, 20, T24); \
+    MD5_VSTEP(MD5_VG, a, b, c, d,  9,  5, T25); \
+    MD5_VSTEP(MD5_VG, d, a, b, c, 14,  9, T26); \
+    MD5_VSTEP(MD5_VG, c, d, a, b,  3, 14, T27); \
+    MD5_VSTEP(MD5_VG, b, c, d, a,  8, 20, T28); \
+    MD5_VSTEP(MD5_VG, a, b, c, d, 13,  5, T29); \
+    MD5_VSTEP(MD5_VG, d, a, b, c,  2,  9, T30); \
+    MD5_VSTEP(MD5_VG, c, d, a, b,  7, 14, T31); \
+    MD5_VSTEP(MD5_VG, b, c, d, a, 12, 20, T32); \
+    MD5_VSTEP(MD5_VH, a, b, c, d,  5,  4, T33); \
+    MD5_VSTEP(MD5_VH, d, a, b, c,  8, 11, T34); \
+    MD5_VSTEP(MD5_VH, c, d, a, b, 11, 16, T35); \
+    MD5_VSTEP(MD5_VH, b, c, d, a, 14, 23, T36); \
+    MD5_VSTEP(MD5_VH, a, b, c, d,  1,  4, T37); \
+    MD5_VSTEP(MD5_VH, d, a, b, c,  4, 11, T38); \
+    MD5_VSTEP(MD5_VH, c, d, a, b,  7, 16, T39); \
+    MD5_VSTEP(MD5_VH, b, c, d, a, 10, 23, T40); \
+    MD5_VSTEP(MD5_VH, a, b, c, d, 13,  4, T41); \
+    MD5_VSTEP(MD5_VH, d, a, b, c,  0, 11, T42); \
+    MD5_VSTEP(MD5_VH, c, d, a, b,  3, 16, T43); \
+    MD5_VSTEP(MD5_VH, b, c, d, a,  6, 23, T44); \
+    MD5_VSTEP(MD5_VH, a, b, c, d,  9,  4, T45); \
+    MD5_VSTEP(MD5_VH, d, a, b, c, 12, 11, T46); \
+    MD5_VSTEP(MD5_VH, c, d, a, b, 15, 16, T47); \
+    MD5_VSTEP(MD5_VH, b, c, d, a,  2, 23, T48); \
+    MD5_VSTEP(MD5_VI, a, b, c, d,  0,  6, T49); \
+    MD5_VSTEP(MD5_VI, d, a, b, c,  7, 10, T50); \
+    MD5_VSTEP(MD5_VI, c, d, a, b, 14, 15, T51); \
+    MD5_VSTEP(MD5_VI, b, c, d, a,  5, 21, T52); \
+    MD5_VSTEP(MD5_VI, a, b, c, d, 12,  6, T53); \
+    MD5_VSTEP(MD5_VI, d, a, b, c,  3, 10, T54); \
+    MD5_VSTEP(MD5_VI, c, d, a, b, 10, 15, T55); \
+    MD5_VSTEP(MD5_VI, b, c, d, a,  1, 21, T56); \
+    MD5_VSTEP(MD5_VI, a, b, c, d,  8,  6, T57); \
+    MD5_VSTEP(MD5_VI, d, a, b, c, 15, 10, T58); \
+    MD5_VSTEP(MD5_VI, c, d, a, b,  6, 15, T59); \
+    MD5_VSTEP(MD5_VI, b, c, d, a, 13, 21, T60); \
+    MD5_VSTEP(MD5_VI, a, b, c, d,  4,  6, T61); \
+    MD5_VSTEP(MD5_VI, d, a, b, c, 11, 10, T62); \
+    MD5_VSTEP(MD5_VI, c, d, a, b,  2, 15, T63); \
+    MD5_VSTEP(MD5_VI, b, c, d, a,  9, 21, T64)
+
+/*
+ * One kernel call runs one block for every lane. state[r * lanes + k] is
+ * register r of lane k, words[i * lanes + k] is word i of lane k's block,
+ * active[k] is all ones for lanes that still have blocks left.
+ */
+typedef void (*md5_kernel_t)(md5_word_t *state, const md5_word_t *words, const md5_word_t *active);
+
+#define VADD(x, y) _mm_add_epi32(x, y)
+#define VAND(x, y) _mm_and_si128(x, y)
+#define VOR(x, y) _mm_or_si128(x, y)
+#define VXOR(x, y) _mm_xor_si128(x, y)
+#define VSLL(x, n) _mm_slli_epi32(x, n)
+#define VSRL(x, n) _mm_srli_epi32(x, n)
+#define VSET1(x) _mm_set1_epi32(x)
+
+static void
+md5_kernel_sse2(md5_word_t *state, const md5_word_t *words, const md5_word_t *active)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i X[16];
+    __m128i a = _mm_loadu_si128((const __m128i *)(state + 0));
+    __m128i b = _mm_loadu_si128((const __m128i *)(state + 4));
+    __m128i c = _mm_loadu_si128((const __m128i *)(state + 8));
+    __m128i d = _mm_loadu_si128((const __m128i *)(state + 12));
+    __m128i aa = a, bb = b, cc = c, dd = d;
+    __m128i mask = _mm_loadu_si128((const __m128i *)active);
+    int i;
+
+    for (i = 0; i < 16; ++i)
+        X[i] = _mm_loadu_si128((const __m128i *)(words + i * 4));
+
+    MD5_SIMD_ROUNDS;
+
+    _mm_storeu_si128((__m128i *)(state + 0), VADD(aa, VAND(a, mask)));
+    _mm_storeu_si128((__m128i *)(state + 4), VADD(bb, VAND(b, mask)));
+    _mm_storeu_si128((__m128i *)(state + 8), VADD(cc, VAND(c, mask)));
+    _mm_storeu_si128((__m128i *)(state + 12), VADD(dd, VAND(d, mask)));
+}
+
+#undef VADD
+#undef VAND
+#undef VOR
+#undef VXOR
+#undef VSLL
+#undef VSRL
+#undef VSET1
+
+#define VADD(x, y) _mm256_add_epi32(x, y)
+#define VAND(x, y) _mm256_and_si256(x, y)
+#define VOR(x, y) _mm256_or_si256(x, y)
+#define VXOR(x, y) _mm256_xor_si256(x, y)
+#define VSLL(x, n) _mm256_slli_epi32(x, n)
+#define VSRL(x, n) _mm256_srli_epi32(x, n)
+#define VSET1(x) _mm256_set1_epi32(x)
+
+MD5_TARGET_AVX2 static void
+md5_kernel_avx2(md5_word_t *state, const md5_word_t *words, const md5_word_t *active)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i X[16];
+    __m256i a = _mm256_loadu_si256((const __m256i *)(state + 0));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(state + 8));
+    __m256i c = _mm256_loadu_si256((const __m256i *)(state + 16));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(state + 24));
+    __m256i aa = a, bb = b, cc = c, dd = d;
+    __m256i mask = _mm256_loadu_si256((const __m256i *)active);
+    int i;
+
+    for (i = 0; i < 16; ++i)
+        X[i] = _mm256_loadu_si256((const __m256i *)(words + i * 8));
+
+    MD5_SIMD_ROUNDS;
+
+    _mm256_storeu_si256((__m256i *)(state + 0), VADD(aa, VAND(a, mask)));
+    _mm256_storeu_si256((__m256i *)(state + 8), VADD(bb, VAND(b, mask)));
+    _mm256_storeu_si256((__m256i *)(state + 16), VADD(cc, VAND(c, mask)));
+    _mm256_storeu_si256((__m256i *)(state + 24), VADD(dd, VAND(d, mask)));
+}
+
+#undef VADD
+#undef VAND
+#undef VOR
+#undef VXOR
+#undef VSLL
+#undef VSRL
+#undef VSET1
+
+/* Lanes the CPU can run: 8 with AVX2 (and OS support for YMM state), 4 with SSE2, else 1. */
+static int
+md5_detect_lanes(void)
+{
+    unsigned int regs[4] = { 0 };
+    int sse2 = 0, avx2 = 0;
+
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    regs[2] = (unsigned int)info[2];
+    regs[3] = (unsigned int)info[3];
+#else
+    unsigned int max_leaf = __get_cpuid_max(0, 0);
+    __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    sse2 = (regs[3] >> 26) & 1;
+
+    /* OSXSAVE and AVX, then XCR0 must have both XMM and YMM state enabled. */
+    if (max_leaf >= 7 && ((regs[2] >> 27) & 1) && ((regs[2] >> 28) & 1))
+    {
+#if defined(_MSC_VER)
+        unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        regs[1] = (unsigned int)info[1];
+#else
+        unsigned int xcr0_lo = 0, xcr0_hi = 0;
+        __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        unsigned long long xcr0 = xcr0_lo;
+        __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        avx2 = (xcr0 & 6) == 6 && ((regs[1] >> 5) & 1);
+    }
+
+    return avx2 ? 8 : (sse2 ? 4 : 1);
+}
+
+/* Hash up to lanes messages at once. */
+static void
+md5_batch_group(md5_kernel_t kernel, int lanes, const md5_byte_t *const *data,
+                const size_t *sizes, size_t count, md5_byte_t (*digests)[16])
+{
+    md5_lane_t lane[MD5_MAX_LANES];
+    md5_word_t state[4 * MD5_MAX_LANES] = { 0 };   /* every used lane is set below; zeroed so -O3 does not warn */
+    md5_word_t words[16 * MD5_MAX_LANES];
+    md5_word_t active[MD5_MAX_LANES];
+    static const md5_byte_t idle_block[64] = { 0 };
+    static const md5_word_t init[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    size_t max_blocks = 0;
+    size_t j;
+    int k, i;
+
+    for (k = 0; k < lanes; ++k)
+    {
+        if ((size_t)k < count)
+        {
+            md5_lane_init(&lane[k], data[k], sizes[k]);
+            if (lane[k].total_blocks > max_blocks)
+                max_blocks = lane[k].total_blocks;
+        }
+        else
+        {
+            lane[k].total_blocks = 0;
+        }
+        for (i = 0; i < 4; ++i)
+            state[i * lanes + k] = init[i];
+    }
+
+    for (j = 0; j < max_blocks; ++j)
+    {
+        for (k = 0; k < lanes; ++k)
+        {
+            const md5_byte_t *block = idle_block;
+            active[k] = 0;
+            if (j < lane[k].total_blocks)
+            {
+                block = md5_lane_block(&lane[k], j);
+                active[k] = 0xffffffff;
+            }
+            for (i = 0; i < 16; ++i)
+                words[i * lanes + k] = MD5_LOAD_WORD(block + i * 4);
+        }
+        kernel(state, words, active);
+    }
+
+    for (k = 0; (size_t)k < count; ++k)
+    {
+        for (i = 0; i < 16; ++i)
+            digests[k][i] = (md5_byte_t)(state[(i >> 2) * lanes + k] >> ((i & 3) << 3));
+    }
+}
+
+#endif /* MD5_HAVE_SIMD */
+
+int
+md5_batch_lanes(void)
+{
+#if MD5_HAVE_SIMD
+    /* Function-local static: initialized once even when the first calls race. */
+    static const int lanes = md5_detect_lanes();
+    return lanes;
+#else
+    return 1;
+#endif
+}
+
+void
+md5_batch(const md5_byte_t *const *data, const size_t *sizes, size_t count, md5_byte_t (*digests)[16])
+{
+    size_t n = 0;
+
+#if MD5_HAVE_SIMD
+    int lanes = md5_batch_lanes();
+    if (lanes >= 4)
+    {
+        /* Full groups of 8 on AVX2, then whatever is left in groups of 4. */
+        while (lanes == 8 && count - n > 4)
+        {
+            size_t group = count - n < 8 ? count - n : 8;
+            md5_batch_group(md5_kernel_avx2, 8, data + n, sizes + n, group, digests + n);
+            n += group;
+        }
+        while (count - n > 1)
+        {
+            size_t group = count - n < 4 ? count - n : 4;
+            md5_batch_group(md5_kernel_sse2, 4, data + n, sizes + n, group, digests + n);
+            n += group;
+        }
+    }
+#endif
+
+    for (; n < count; ++n)
+    {
+        md5_state_t state;
+        md5_word_t abcd[4];
+        md5_lane_t lane;
+        int i;
+
+        /* Same padded tail as the SIMD path, so the length is not limited to int. */
+        md5_init(&state);
+        md5_lane_init(&lane, data[n], sizes[n]);
+        memcpy(abcd, state.abcd, sizeof(abcd));
+        md5_process_blocks(abcd, lane.data, lane.full_blocks);
+        md5_process_blocks(abcd, lane.tail, lane.total_blocks - lane.full_blocks);
+        for (i = 0; i < 16; ++i)
+            digests[n][i] = (md5_byte_t)(abcd[i >> 2] >> ((i & 3) << 3));
+    }
+}
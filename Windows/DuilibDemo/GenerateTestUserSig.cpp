@@ -5,7 +5,7 @@
 */
 
 #include "GenerateTestUserSig.h"
-#include "json/json.h"
+#include "json/JsonStream.h"
 #include <stdio.h>
 
 #ifdef _WIN64
@@ -13,8 +13,33 @@
     #include "tls_signature.h"
 #endif // WIN64
 
+namespace
+{
+    // 登录 cgi 的返回值中只关心 errorCode 和 data.userSig
+    const char* const kLoginRespPaths[] = { "errorCode", "data.userSig" };
+
+    struct LoginRespHandler : public IJsonSelectHandler
+    {
+        bool bHasCode = false;
+        int64_t code = -1;
+        std::string userSig;
+
+        virtual bool OnValue(size_t pathIndex, size_t /*arrayIndex*/, CJsonPullReader& reader)
+        {
+            if (pathIndex == 0)
+                bHasCode = reader.GetInt64(code);
+            else
+                reader.GetString(userSig);
+            return true;
+        }
+    };
+}
+
 GenerateTestUserSig::GenerateTestUserSig()
     : m_http_client(L"User-Agent")
+    , m_userSigProvider([this](uint32_t sdkAppId, const std::string& userId, std::string& userSig) {
+        return fetchUserSig(sdkAppId, userId, userSig);
+    })
 {
 
 }
@@ -35,7 +60,37 @@ uint32_t GenerateTestUserSig::getSdkAppId() const
     return m_AccountInfo._sdkAppId; 
 }
 
-std::string GenerateTestUserSig::getUserSigFromLocal(std::string userId) const
+std::string GenerateTestUserSig::getUserSigFromLocal(std::string userId)
+{
+    std::string sig;
+    if (m_userSigProvider.GetCached(m_AccountInfo._sdkAppId, userId, sig))
+        return sig;
+    sig = signUserSigLocal(userId);
+    m_userSigProvider.Put(m_AccountInfo._sdkAppId, userId, sig);
+    return sig;
+}
+
+bool GenerateTestUserSig::getUserSig(const std::string& userId, std::string& userSig, const UserSigCallback& callback)
+{
+    return m_userSigProvider.Get(m_AccountInfo._sdkAppId, userId, userSig, callback);
+}
+
+void GenerateTestUserSig::prefetchUserSig(const std::string& userId)
+{
+    m_userSigProvider.Prefetch(m_AccountInfo._sdkAppId, userId);
+}
+
+int GenerateTestUserSig::fetchUserSig(uint32_t sdkAppId, const std::string& userId, std::string& userSig)
+{
+    // usersig 只与 sdkAppId 和 userId 有关，这里的房间号不影响签发结果
+    if (m_AccountInfo._userSigFromServer)
+        userSig = getUserSigFromServer(userId, 0);
+    else
+        userSig = signUserSigLocal(userId);
+    return userSig.empty() ? EcUserSigEmpty : 0;
+}
+
+std::string GenerateTestUserSig::signUserSigLocal(const std::string& userId) const
 {
     //暂时不支持64位的本地签名库。
     std::string sig;
@@ -52,15 +107,18 @@ std::string GenerateTestUserSig::getUserSigFromServer(std::string userId, int ro
     std::wstring login_cgi = m_AccountInfo._loginServer;
 
     //int accountType = 14418;  //您可以在应用后台页面获取AccountType的值
-    Json::Value jsonObj;
-    jsonObj["pwd"] = "123";
-    jsonObj["appid"] = m_AccountInfo._sdkAppId;
-    jsonObj["roomnum"] = roomId;
-    jsonObj["privMap"] = 255;
-    //jsonObj["accounttype"] = accountType;
-    jsonObj["identifier"] = userId;
-    Json::FastWriter writer;
-    std::string jsonStr = writer.write(jsonObj);
+    std::lock_guard<std::mutex> lock(m_loginReqMutex);
+    CJsonStreamWriter& writer = m_loginReqWriter;
+    writer.Reset();
+    writer.BeginObject();
+    writer.Key("pwd").String("123");
+    writer.Key("appid").Int(m_AccountInfo._sdkAppId);
+    writer.Key("roomnum").Int(roomId);
+    writer.Key("privMap").Int(255);
+    //writer.Key("accounttype").Int(accountType);
+    writer.Key("identifier").String(userId);
+    writer.EndObject();
+    const std::string& jsonStr = writer.str();
     std::vector<std::wstring> headers;
     headers.push_back(L"Content-Type: application/json; charset=utf-8");
 
@@ -72,33 +130,16 @@ std::string GenerateTestUserSig::getUserSigFromServer(std::string userId, int ro
         //请求失败,请检查参数或网络。
         return std::string("");
     }
-    std::string _userSig = "";
+    LoginRespHandler resp;
+    if (!JsonSelect(respData.data(), respData.size(), kLoginRespPaths, sizeof(kLoginRespPaths) / sizeof(kLoginRespPaths[0]), resp))
     {
-        Json::Reader reader;
-        Json::Value root;
-        if (!reader.parse(respData, root))
-        {
-            //返回Json信息错误
-        }
-        if (root.isMember("errorCode"))
-        {
-            int code = root["errorCode"].asInt();
-            if (code != 0)
-            {
-                return std::string("");;
-            }
-            Json::Value data;
-            if (root.isMember("data"))
-            {
-                data = root["data"];
-                if (data.isMember("userSig"))
-                    _userSig = data["userSig"].asString();
-                //if (data.isMember("token"))
-                //    m_SdkAppInfo._token = data["token"].asString();
-                //if (data.isMember("privMapEncrypt"))
-                //    m_SdkAppInfo._privMapEncrypt = data["privMapEncrypt"].asString();
-            }
-        }
+        //返回Json信息错误
+        return std::string("");
+    }
+    if (!resp.bHasCode || resp.code != 0)
+    {
+        return std::string("");
     }
-    return _userSig;
+    //data 中的 token、privMapEncrypt 需要时加到 kLoginRespPaths 中
+    return resp.userSig;
 }
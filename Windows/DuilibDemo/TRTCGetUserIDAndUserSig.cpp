@@ -6,8 +6,63 @@
 
 #include "TRTCGetUserIDAndUserSig.h"
 #include "json/json.h"
+#include "json/JsonStream.h"
+#include "util/MappedFile.h"
 #include <stdio.h>
 
+namespace
+{
+    const char* const kConfigPaths[] = { "sdkappid", "users", "users[]", "users[].userId", "users[].userToken" };
+
+    // Config.json 只取 sdkappid 和 users 列表，userId/userToken 按数组下标填到同一个 UserInfo
+    struct ConfigHandler : public IJsonSelectHandler
+    {
+        bool bHasSdkAppId = false;
+        bool bHasUsers = false;
+        uint64_t sdkAppId = 0;
+        std::vector<UserInfo> users;
+        std::vector<unsigned char> fields;  // 每个元素已读到的字段，bit0 为 userId，bit1 为 userToken
+
+        virtual bool OnValue(size_t pathIndex, size_t arrayIndex, CJsonPullReader& reader)
+        {
+            if (pathIndex == 0)
+            {
+                bHasSdkAppId = reader.GetUInt64(sdkAppId);
+                return true;
+            }
+            if (pathIndex == 1)
+            {
+                bHasUsers = reader.Current() == CJsonPullReader::TokenBeginArray;
+                return true;
+            }
+            if (pathIndex == 2)
+            {
+                users.resize(arrayIndex + 1);
+                fields.resize(arrayIndex + 1, 0);
+                return true;
+            }
+
+            std::string& value = pathIndex == 3 ? users[arrayIndex].userId : users[arrayIndex].userSig;
+            if (!reader.GetString(value))
+                return false;
+            fields[arrayIndex] |= pathIndex == 3 ? 1 : 2;
+            return true;
+        }
+
+        bool IsComplete() const
+        {
+            if (!bHasSdkAppId || !bHasUsers)
+                return false;
+            for (size_t i = 0; i < fields.size(); ++i)
+            {
+                if (fields[i] != 3)
+                    return false;
+            }
+            return true;
+        }
+    };
+}
+
 TRTCGetUserIDAndUserSig::TRTCGetUserIDAndUserSig()
     : m_userInfos()
     , m_http_client(L"User-Agent")
@@ -28,55 +83,21 @@ TRTCGetUserIDAndUserSig& TRTCGetUserIDAndUserSig::instance()
 
 bool TRTCGetUserIDAndUserSig::loadFromConfig()
 {
-    FILE* file = NULL;
-    fopen_s(&file, "Config.json", "rb");
-    if (!file)
-    {
-        return false;
-    }
-
-    std::string data;
-    while (true)
-    {
-        char buffer[512] = { 0 };
-        size_t count = ::fread(buffer, 1, 512, file);
-        if (count == 0)
-        {
-            break;
-        }
-
-        data.append(buffer, count);
-    }
-
-    Json::Reader reader;
-    Json::Value root;
-    if (!reader.parse(data, root))
+    // 整个文件映射进来一次解析，不再分块 fread 拼接
+    CMappedFile file;
+    if (!file.Open("Config.json"))
     {
         return false;
     }
 
-    if (!root.isMember("sdkappid") || !root.isMember("users"))
+    ConfigHandler handler;
+    if (!JsonSelect(file.Data(), file.Size(), kConfigPaths, 5, handler) || !handler.IsComplete())
     {
         return false;
     }
 
-    m_AccountInfo._sdkAppId = root["sdkappid"].asUInt();
-
-    Json::Value users = root["users"];
-    for (int i = 0; i < users.size(); ++i)
-    {
-        Json::Value item = users[i];
-        if (!item.isMember("userId") || !item.isMember("userToken"))
-        {
-            return false;
-        }
-
-        UserInfo info;
-        info.userId = item["userId"].asString();
-        info.userSig = item["userToken"].asString();
-
-        m_userInfos.push_back(info);
-    }
+    m_AccountInfo._sdkAppId = static_cast<uint32_t>(handler.sdkAppId);
+    m_userInfos.insert(m_userInfos.end(), handler.users.begin(), handler.users.end());
 
     return true;
 }
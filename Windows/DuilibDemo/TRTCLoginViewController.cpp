@@ -82,6 +82,10 @@ void TRTCLoginViewController::InitLoginView()
     if (pEditName != nullptr)
         pEditName->SetText(Ansi2Wide(user_id).c_str());
 
+    //上次登录的用户大概率会再次进房，提前在后台签发 usersig
+    if (!user_id.empty() && GenerateTestUserSig::instance().getSdkAppId() != 0)
+        GenerateTestUserSig::instance().prefetchUserSig(user_id);
+
     m_pLoginStatus = static_cast<CLabelUI*>(m_pmUI.FindControl(_T("label_loginstatus")));
     m_pmUI.SetFocus(nullptr);
 
@@ -154,6 +158,9 @@ void TRTCLoginViewController::onBtnOpenSetting()
 
 void TRTCLoginViewController::onBtnEnterRoom()
 {
+    if (m_bWaitUserSig)
+        return;
+
     //先检查是否填写了 sdkappid ,只有填写了sdkappid才可以正常使用TRTCDuilibDemo信息。
     if (GenerateTestUserSig::instance().getSdkAppId() == 0)
     {
@@ -188,13 +195,28 @@ void TRTCLoginViewController::onBtnEnterRoom()
         info._userId = Wide2Ansi(strUserId);
     }
 
-    info._userSig = GenerateTestUserSig::instance().getUserSigFromLocal(info._userId);
-    if (info._userSig == "")
+    //缓存未命中时在后台签发，签好的 UserSig 随消息带回 UI 线程直接进房，不阻塞 UI 线程
+    HWND hWnd = GetHWND();
+    std::string userSig;
+    bool bCached = GenerateTestUserSig::instance().getUserSig(info._userId, userSig, [hWnd](int code, const std::string& userSig) {
+        std::string* pUserSig = new std::string(userSig);
+        if (!::PostMessage(hWnd, WM_USER_USERSIG_READY, (WPARAM)code, (LPARAM)pUserSig))
+            delete pUserSig;
+    });
+    if (!bCached)
     {
+        m_bWaitUserSig = true;
         if (m_pLoginStatus != nullptr)
-            m_pLoginStatus->SetText(L"user sign 获取失败");
+            m_pLoginStatus->SetText(L"正在获取 user sign...");
         return;
     }
+    enterRoom(userSig);
+}
+
+void TRTCLoginViewController::enterRoom(const std::string& userSig)
+{
+    CDataCenter::LocalUserInfo& info = CDataCenter::GetInstance()->getLocalUserInfo();
+    info._userSig = userSig;
 
     if (m_pSettingWnd) {
         if (TRTCSettingViewController::getRef() > 0)
@@ -280,6 +302,25 @@ LRESULT TRTCLoginViewController::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM
         if (m_bQuit)
             ::PostQuitMessage(0L);
     }
+    else if (uMsg == WM_USER_USERSIG_READY)
+    {
+        //房间号和用户名在点击进房时已经写入 CDataCenter，这里直接用带回的 UserSig 进房，不再重新走一遍缓存
+        std::string* pUserSig = reinterpret_cast<std::string*>(lParam);
+        bool bWaiting = m_bWaitUserSig;
+        m_bWaitUserSig = false;
+        if (bWaiting && (int)wParam == 0 && pUserSig != nullptr && !pUserSig->empty())
+        {
+            if (m_pLoginStatus != nullptr)
+                m_pLoginStatus->SetText(L"");
+            enterRoom(*pUserSig);
+        }
+        else if (bWaiting && m_pLoginStatus != nullptr)
+        {
+            m_pLoginStatus->SetText(L"user sign 获取失败");
+        }
+        delete pUserSig;
+        return 0;
+    }
     else if (uMsg == WM_NCACTIVATE)
     {
         if (!::IsIconic(*this)) return (wParam == 0) ? TRUE : FALSE;
@@ -35,10 +35,12 @@ private:
 protected:
     void onBtnOpenSetting();
     void onBtnEnterRoom();
+    void enterRoom(const std::string& userSig);
 public:
     TRTCSettingViewController* m_pSettingWnd = nullptr;
     CPaintManagerUI m_pmUI;
     CLabelUI* m_pLoginStatus = nullptr;
     bool m_bConfigUserSign = false;
     bool m_bQuit= true;
+    bool m_bWaitUserSig = false;    // 正在后台签发 UserSig，完成后以 WM_USER_USERSIG_READY 通知
 };
\ No newline at end of file
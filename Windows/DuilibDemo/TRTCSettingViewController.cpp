@@ -18,10 +18,8 @@
 #include "UserMassegeIdDefine.h"
 #include "MsgBoxWnd.h"
 #include "util/md5.h"
-#include <strstream>
 #include <iostream>
 #include <ctime>
-#include <iomanip>
 #include <algorithm>
 
 #define AUDIO_DEVICE_VOLUME_TICKET 100
@@ -729,14 +727,9 @@ void TRTCSettingViewController::NotifyOtherTab(TNotifyUI & msg)
             char* stableStr = const_cast<char*>(sourceStr.c_str());
             TenMd5(reinterpret_cast<BYTE*>(stableStr), sourceStr.size(), fingerPrintStableMD5);
 
-            std::strstream sstream;
-            for (int i = 0; i < MD5_RESULT_LEN; ++i)
-            {
-                sstream << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << static_cast<int>(fingerPrintStableMD5[i]);
-            }
-            std::string strResult;
-            sstream >> strResult;
-            std::transform(strResult.begin(), strResult.end(), strResult.begin(), ::tolower);
+            char hexResult[MD5_RESULT_LEN * 2 + 1] = { 0 };
+            md5_hex(fingerPrintStableMD5, hexResult);
+            std::string strResult = hexResult;
             std::wstring wstrResult = Ansi2Wide(strResult);
             std::wstring wstrUrl = format(L"播放地址: http://3891.liveplay.myqcloud.com/live/3891_%s.flv 已经复制到剪切板", wstrResult.c_str());
             CMsgWnd::ShowMessageBox(GetHWND(), _T("TRTCDuilibDemo"), wstrUrl.c_str(), 0xFFF08080);
@@ -4,6 +4,7 @@
 #include "util/log.h"
 #include "util/Base.h"
 #include "json/json.h"
+#include "json/JsonStream.h"
 #include <mutex>
 #include <iostream>
 #include <fstream>
@@ -328,7 +329,7 @@ void TRTCCloudCore::onVodPlayerError(int error)
 
 void TRTCCloudCore::onDeviceChange(const char* deviceId, TRTCDeviceType type, TRTCDeviceState state)
 {
-    LINFO(L"onDeviceChange type[%d], state[%d], deviceId[%s]\n", type, state, UTF82Wide(deviceId));
+    LINFO(L"onDeviceChange type[%d], state[%d], deviceId[%s]\n", type, state, UTF82Wide(deviceId).c_str());
     for (auto& itr : m_mapSDKMsgFilter)
     {
         if (itr.first == WM_USER_CMD_DeviceChange && itr.second != nullptr)
@@ -851,10 +852,16 @@ void TRTCCloudCore::showDashboardStyle(int logStyle)
 
 void TRTCCloudCore::connectOtherRoom(std::string userId, uint32_t roomId)
 {
-    std::string json = format("{\"roomId\":%d,\"userId\":\"%s\"}", roomId, userId.c_str());
+    //userId 可能含引号等需要转义的字符，不能直接拼接
+    CJsonStreamWriter& writer = m_jsonWriter;
+    writer.Reset();
+    writer.BeginObject();
+    writer.Key("roomId").UInt(roomId);
+    writer.Key("userId").String(userId);
+    writer.EndObject();
     if (m_pCloud)
     {
-        m_pCloud->connectOtherRoom(json.c_str());
+        m_pCloud->connectOtherRoom(writer.c_str());
     }
 }
 
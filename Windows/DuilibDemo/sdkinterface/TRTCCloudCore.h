@@ -2,6 +2,7 @@
 #include "ITRTCCloud.h"
 #include "ITXVodPlayer.h"
 #include "DataCenter.h"
+#include "json/JsonStream.h"
 #include <map>
 #include <string>
 #include <mutex>
@@ -121,6 +122,7 @@ private:
     ITXVodPlayer* m_pVodPlayer = nullptr;
     int m_mRefLocalPreview = 0;
     bool m_bFirstUpdateDevice = false;
+    CJsonStreamWriter m_jsonWriter;         // 拼接发给 SDK 的 JSON 参数，只在 UI 线程使用，Reset 后复用缓冲
 
     //云端混流功能
 
@@ -48,4 +48,5 @@
 #define WM_USER_VIEW_BTN_CLICK              WM_USER_UI_MSG_ID + 3    //View的按钮被点击了。
 #define WM_USER_CMD_CustomVideoCapture      WM_USER_UI_MSG_ID + 4     //
 #define WM_USER_CMD_CustomAudioCapture      WM_USER_UI_MSG_ID + 5
-#define WM_USER_CMD_RoleChange              WM_USER_UI_MSG_ID + 6     //用户角色变化了
\ No newline at end of file
+#define WM_USER_CMD_RoleChange              WM_USER_UI_MSG_ID + 6     //用户角色变化了
+#define WM_USER_USERSIG_READY               WM_USER_UI_MSG_ID + 7     //后台签发 UserSig 完成，wParam 为错误码，lParam 为 new 出的 std::string*（UserSig），由接收方 delete
\ No newline at end of file
@@ -0,0 +1,223 @@
+/*
+* Module:   AsyncLoggerTest
+*
+* Function: 多个线程同时写日志、单文件上限很小时，CAsyncLogger 按上限切换文件且不丢失、不重复记录；
+*           二进制日志切换后每个文件都自带用到的 site 定义
+*/
+#include "AsyncLogger.h"
+#include "TestUtil.h"
+
+#include <dirent.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int kWriterCount = 4;
+static const int kRecordsPerWriter = 20000;
+static const size_t kMaxFileBytes = 64 * 1024;
+
+static const LogSite kSites[] = {
+    { InfoLevel, 10, "AsyncLoggerTest.cpp", "Writer::Run", L"writer %d seq %d payload %ls" },
+    { WarningLevel, 20, "AsyncLoggerTest.cpp", "Writer::Chatty", L"chatty %d seq %d" },
+};
+
+static uint32_t g_firstSiteId = 0;
+
+static void Write(uint32_t index, ...)
+{
+    va_list args;
+    va_start(args, index);
+    CAsyncLogger::Instance().WriteV(g_firstSiteId + index, &kSites[index], args);
+    va_end(args);
+}
+
+static void WriterProc(int writer)
+{
+    for (int seq = 0; seq < kRecordsPerWriter; ++seq)
+    {
+        // 0 号线程写得最多，用另一个调用点，模拟刷屏的线程
+        if (writer == 0)
+        {
+            Write(1, writer, seq);
+            continue;
+        }
+        Write(0, writer, seq, L"0123456789abcdef");
+        if (seq % 64 == 0)
+            std::this_thread::yield();
+    }
+}
+
+static std::vector<std::string> ListFiles(const std::string& directory)
+{
+    std::vector<std::string> files;
+    DIR* dir = opendir(directory.c_str());
+    if (dir == NULL)
+        return files;
+    while (struct dirent* entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+            files.push_back(directory + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static void ClearDirectory(const std::string& directory)
+{
+    std::vector<std::string> files = ListFiles(directory);
+    for (size_t i = 0; i < files.size(); ++i)
+        remove(files[i].c_str());
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& path)
+{
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path.c_str(), "rb");
+    TEST_CHECK(file != NULL);
+    uint8_t buffer[65536];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + read);
+    fclose(file);
+    return data;
+}
+
+static void RunWriters(const std::string& directory, bool bBinaryFile)
+{
+    ClearDirectory(directory);
+
+    CAsyncLogger::Config config;
+    config.directory = directory;
+    config.fileNamePrefix = L"AsyncLoggerTest";
+    config.moduleName = L"AsyncLoggerTest";
+    config.maxFileBytes = kMaxFileBytes;
+    config.ringBytes = 1024 * 1024;
+    config.bDebugOutput = false;
+    config.bBinaryFile = bBinaryFile;
+    CAsyncLogger::Instance().Start(config);
+
+    std::vector<std::thread> writers;
+    for (int i = 0; i < kWriterCount; ++i)
+        writers.push_back(std::thread(WriterProc, i));
+    for (size_t i = 0; i < writers.size(); ++i)
+        writers[i].join();
+
+    CAsyncLogger::Instance().Flush();
+    CAsyncLogger::Instance().Stop();
+}
+
+static void TestTextRotation()
+{
+    const std::string directory = "AsyncLoggerTest_text/";
+    uint64_t droppedBefore = CAsyncLogger::Instance().GetDroppedCount();
+    RunWriters(directory, false);
+    uint64_t dropped = CAsyncLogger::Instance().GetDroppedCount() - droppedBefore;
+
+    std::vector<std::string> files = ListFiles(directory);
+    TEST_CHECK(files.size() >= 2);
+
+    std::set<std::pair<int, int> > seen;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        std::vector<uint8_t> data = ReadFile(files[i]);
+        // 每个文件最多超出上限一行
+        TEST_CHECK(data.size() <= kMaxFileBytes + 1024 * sizeof(wchar_t));
+        TEST_CHECK(data.size() % sizeof(wchar_t) == 0);
+
+        // 日志内容都是 ASCII，按 wchar_t 取低字节还原成窄字符串
+        std::string text;
+        const wchar_t* chars = reinterpret_cast<const wchar_t*>(data.data());
+        for (size_t k = 0; k < data.size() / sizeof(wchar_t); ++k)
+            text.push_back(static_cast<char>(chars[k]));
+
+        int lastSeq[kWriterCount];
+        for (int w = 0; w < kWriterCount; ++w)
+            lastSeq[w] = -1;
+
+        size_t lineBegin = 0;
+        while (lineBegin < text.size())
+        {
+            size_t lineEnd = text.find('\n', lineBegin);
+            TEST_CHECK(lineEnd != std::string::npos);
+            std::string line = text.substr(lineBegin, lineEnd - lineBegin);
+            lineBegin = lineEnd + 1;
+
+            int writer = -1, seq = -1;
+            size_t pos = line.find("writer ");
+            if (pos == std::string::npos)
+                pos = line.find("chatty ");
+            if (pos == std::string::npos)
+                continue;
+            TEST_CHECK(sscanf(line.c_str() + pos + 7, "%d seq %d", &writer, &seq) == 2);
+            TEST_CHECK(writer >= 0 && writer < kWriterCount);
+            TEST_CHECK(seq > lastSeq[writer]);
+            lastSeq[writer] = seq;
+            TEST_CHECK(seen.insert(std::make_pair(writer, seq)).second);
+        }
+    }
+    TEST_CHECK(seen.size() + dropped == static_cast<size_t>(kWriterCount * kRecordsPerWriter));
+    ClearDirectory(directory);
+}
+
+static void TestBinaryRotation()
+{
+    const std::string directory = "AsyncLoggerTest_bin/";
+    uint64_t droppedBefore = CAsyncLogger::Instance().GetDroppedCount();
+    RunWriters(directory, true);
+    uint64_t dropped = CAsyncLogger::Instance().GetDroppedCount() - droppedBefore;
+
+    std::vector<std::string> files = ListFiles(directory);
+    TEST_CHECK(files.size() >= 2);
+
+    size_t records = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        std::vector<uint8_t> data = ReadFile(files[i]);
+        TEST_CHECK(data.size() <= kMaxFileBytes + 1024);
+        TEST_CHECK(data.size() >= sizeof(LogFileHeader));
+
+        LogFileHeader header;
+        memcpy(&header, data.data(), sizeof(header));
+        TEST_CHECK(header.magic == kLogFileMagic);
+        size_t pos = sizeof(header) + header.moduleNameChars * header.wcharSize;
+
+        // 记录引用的 site 必须在同一个文件中先定义
+        std::set<uint32_t> defined;
+        while (pos < data.size())
+        {
+            LogFileEntryHeader entry;
+            TEST_CHECK(pos + sizeof(entry) <= data.size());
+            memcpy(&entry, &data[pos], sizeof(entry));
+            TEST_CHECK(entry.size >= sizeof(entry) && pos + entry.size <= data.size());
+            if (entry.type == kLogEntrySite)
+            {
+                LogFileSiteEntry site;
+                memcpy(&site, &data[pos], sizeof(site));
+                defined.insert(site.siteId);
+            }
+            else if (entry.type == kLogEntryRecord)
+            {
+                LogFileRecordEntry record;
+                memcpy(&record, &data[pos], sizeof(record));
+                TEST_CHECK(defined.count(record.siteId) == 1);
+                ++records;
+            }
+            pos += entry.size;
+        }
+    }
+    TEST_CHECK(records + dropped == static_cast<size_t>(kWriterCount * kRecordsPerWriter));
+    ClearDirectory(directory);
+}
+
+int main()
+{
+    g_firstSiteId = CAsyncLogger::Instance().RegisterSites(kSites, sizeof(kSites) / sizeof(kSites[0]));
+    TestTextRotation();
+    TestBinaryRotation();
+    printf("AsyncLoggerTest passed\n");
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+* Module:   AttributeListBench
+*
+* Function: ApplyAttributeList 解析属性列表的耗时：原来的 CDuiString（5903521，63 个字符的内部缓冲区，
+*           每次取长度都要 _tcslen）和逐个字符追加的解析循环，对比现在的 CDuiString 和 ParseAttributeList。
+*           属性列表由 Demo 全部皮肤 XML 的元素生成，每个元素的属性拼成一个 name="value" 列表，
+*           和 Style、innerstyle 的写法一样。SetAttribute 只累加首字符，耗时基本都在解析和字符串上。
+*           TCHAR 由 TcharShim 定义成 wchar_t，皮肤按字节展开成宽字符
+*
+*    不是测试，不注册到 ctest：./AttributeListBench [轮数]
+*/
+#include "StdAfx.h"
+#include "UIString.h"
+#include "UIMarkupDom.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        data.erase(0, 3);
+    return data;
+}
+
+// 原来的 CDuiString，只保留解析用到的操作，写法照搬
+class LegacyDuiString
+{
+public:
+    enum { MAX_LOCAL_STRING_LEN = 63 };
+
+    LegacyDuiString() : m_pstr(m_szBuffer) { m_szBuffer[0] = '\0'; }
+    LegacyDuiString(LPCTSTR lpsz, int nLen = -1) : m_pstr(m_szBuffer)
+    {
+        m_szBuffer[0] = '\0';
+        Assign(lpsz, nLen);
+    }
+    LegacyDuiString(const LegacyDuiString& src) : m_pstr(m_szBuffer)
+    {
+        m_szBuffer[0] = '\0';
+        Assign(src.m_pstr);
+    }
+    ~LegacyDuiString()
+    {
+        if (m_pstr != m_szBuffer) free(m_pstr);
+    }
+
+    int GetLength() const { return (int)_tcslen(m_pstr); }
+    operator LPCTSTR() const { return m_pstr; }
+    LPCTSTR GetData() const { return m_pstr; }
+
+    void Append(LPCTSTR pstr)
+    {
+        int nNewLength = GetLength() + (int)_tcslen(pstr);
+        if (nNewLength >= MAX_LOCAL_STRING_LEN) {
+            if (m_pstr == m_szBuffer) {
+                m_pstr = static_cast<LPTSTR>(malloc((nNewLength + 1) * sizeof(TCHAR)));
+                wcscpy(m_pstr, m_szBuffer);
+                wcscat(m_pstr, pstr);
+            }
+            else {
+                m_pstr = static_cast<LPTSTR>(realloc(m_pstr, (nNewLength + 1) * sizeof(TCHAR)));
+                wcscat(m_pstr, pstr);
+            }
+        }
+        else {
+            if (m_pstr != m_szBuffer) {
+                free(m_pstr);
+                m_pstr = m_szBuffer;
+            }
+            wcscat(m_szBuffer, pstr);
+        }
+    }
+
+    void Assign(LPCTSTR pstr, int cchMax = -1)
+    {
+        if (pstr == NULL) pstr = _T("");
+        cchMax = (cchMax < 0 ? (int)_tcslen(pstr) : cchMax);
+        if (cchMax < MAX_LOCAL_STRING_LEN) {
+            if (m_pstr != m_szBuffer) {
+                free(m_pstr);
+                m_pstr = m_szBuffer;
+            }
+        }
+        else if (cchMax > GetLength() || m_pstr == m_szBuffer) {
+            if (m_pstr == m_szBuffer) m_pstr = NULL;
+            m_pstr = static_cast<LPTSTR>(realloc(m_pstr, (cchMax + 1) * sizeof(TCHAR)));
+        }
+        wcsncpy(m_pstr, pstr, cchMax);
+        m_pstr[cchMax] = '\0';
+    }
+
+    void Empty()
+    {
+        if (m_pstr != m_szBuffer) free(m_pstr);
+        m_pstr = m_szBuffer;
+        m_szBuffer[0] = '\0';
+    }
+
+    const LegacyDuiString& operator=(const LegacyDuiString& src)
+    {
+        Assign(src);
+        return *this;
+    }
+
+    const LegacyDuiString& operator+=(LPCTSTR lpStr)
+    {
+        Append(lpStr);
+        return *this;
+    }
+
+    const LegacyDuiString& operator+=(const TCHAR ch)
+    {
+        TCHAR str[] = { ch, '\0' };
+        Append(str);
+        return *this;
+    }
+
+    LegacyDuiString Left(int iLength) const
+    {
+        if (iLength < 0) iLength = 0;
+        if (iLength > GetLength()) iLength = GetLength();
+        return LegacyDuiString(m_pstr, iLength);
+    }
+
+    LegacyDuiString Mid(int iPos, int iLength = -1) const
+    {
+        if (iLength < 0) iLength = GetLength() - iPos;
+        if (iPos + iLength > GetLength()) iLength = GetLength() - iPos;
+        if (iLength <= 0) return LegacyDuiString();
+        return LegacyDuiString(m_pstr + iPos, iLength);
+    }
+
+    int Find(LPCTSTR pstrSub, int iPos = 0) const
+    {
+        if (iPos != 0 && (iPos < 0 || iPos > GetLength())) return -1;
+        LPCTSTR p = _tcsstr(m_pstr + iPos, pstrSub);
+        if (p == NULL) return -1;
+        return (int)(p - m_pstr);
+    }
+
+    int Replace(LPCTSTR pstrFrom, LPCTSTR pstrTo)
+    {
+        LegacyDuiString sTemp;
+        int nCount = 0;
+        int iPos = Find(pstrFrom);
+        if (iPos < 0) return 0;
+        int cchFrom = (int)_tcslen(pstrFrom);
+        int cchTo = (int)_tcslen(pstrTo);
+        while (iPos >= 0) {
+            sTemp = Left(iPos);
+            sTemp += pstrTo;
+            sTemp += Mid(iPos + cchFrom);
+            Assign(sTemp);
+            iPos = Find(pstrFrom, iPos + cchTo);
+            nCount++;
+        }
+        return nCount;
+    }
+
+private:
+    LPTSTR m_pstr;
+    TCHAR m_szBuffer[MAX_LOCAL_STRING_LEN + 1];
+};
+
+struct AttributeSink
+{
+    size_t checksum;
+
+    void SetAttribute(LPCTSTR pstrName, LPCTSTR pstrValue)
+    {
+        checksum += static_cast<size_t>(pstrName[0]) + static_cast<size_t>(pstrValue[0]);
+    }
+};
+
+// 原来 ApplyAttributeList 的解析循环。分隔符的检查在列表末尾会多读一个字符，列表都以空格结尾，不会走到那里
+static void LegacyApplyAttributeList(LPCTSTR pstrValue, AttributeSink& sink)
+{
+    LegacyDuiString sXmlData = pstrValue;
+    sXmlData.Replace(_T("&quot;"), _T("\""));
+    LPCTSTR pstrList = sXmlData.GetData();
+    LegacyDuiString sItem;
+    LegacyDuiString sValue;
+    while (*pstrList != _T('\0')) {
+        sItem.Empty();
+        sValue.Empty();
+        while (*pstrList != _T('\0') && *pstrList != _T('=')) {
+            LPCTSTR pstrTemp = ::CharNext(pstrList);
+            while (pstrList < pstrTemp) {
+                sItem += *pstrList++;
+            }
+        }
+        if (*pstrList++ != _T('=')) return;
+        if (*pstrList++ != _T('\"')) return;
+        while (*pstrList != _T('\0') && *pstrList != _T('\"')) {
+            LPCTSTR pstrTemp = ::CharNext(pstrList);
+            while (pstrList < pstrTemp) {
+                sValue += *pstrList++;
+            }
+        }
+        if (*pstrList++ != _T('\"')) return;
+        sink.SetAttribute(sItem, sValue);
+        if (*pstrList++ != _T(' ') && *pstrList++ != _T(',')) return;
+    }
+}
+
+static std::wstring Widen(const char* pstr)
+{
+    std::wstring result;
+    for (; *pstr != '\0'; ++pstr)
+        result.push_back(static_cast<wchar_t>(static_cast<unsigned char>(*pstr)));
+    return result;
+}
+
+// 每个有属性的元素生成一个列表；值里有引号的属性放不进列表，跳过
+static void CollectLists(const CMarkupDomA::Node* pNode, std::vector<std::wstring>& lists, size_t& nAttributes)
+{
+    for (; pNode != NULL; pNode = pNode->pNext)
+    {
+        std::wstring list;
+        for (unsigned int i = 0; i < pNode->nAttributes; ++i)
+        {
+            const CMarkupDomA::Attribute& attr = pNode->pAttributes[i];
+            if (strchr(attr.pValue, '"') != NULL)
+                continue;
+            list += Widen(attr.pName) + L"=\"" + Widen(attr.pValue) + L"\" ";
+            ++nAttributes;
+        }
+        if (!list.empty())
+            lists.push_back(list);
+        CollectLists(pNode->pChild, lists, nAttributes);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    std::vector<std::wstring> lists;
+    size_t nAttributes = 0, nChars = 0;
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        std::string text = ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]);
+        CMarkupDomA dom;
+        if (text.empty() || !dom.Parse(&text[0], true))
+        {
+            fprintf(stderr, "cannot parse %s\n", kSkinFiles[i]);
+            return 1;
+        }
+        CollectLists(dom.GetRoot(), lists, nAttributes);
+    }
+    for (size_t i = 0; i < lists.size(); ++i)
+        nChars += lists[i].size();
+    printf("%zu attribute lists, %zu attributes, %.1f chars per list, %d rounds\n",
+        lists.size(), nAttributes, static_cast<double>(nChars) / lists.size(), rounds);
+
+    AttributeSink legacySink = { 0 };
+    double begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < lists.size(); ++i)
+            LegacyApplyAttributeList(lists[i].c_str(), legacySink);
+    }
+    const double legacyMs = (Now() - begin) * 1000.0 / rounds;
+
+    AttributeSink sink = { 0 };
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < lists.size(); ++i)
+            ParseAttributeList(lists[i].c_str(), sink);
+    }
+    const double newMs = (Now() - begin) * 1000.0 / rounds;
+
+    printf("old CDuiString + loop %8.3f ms   CDuiString + ParseAttributeList %8.3f ms   (%.1fx)\n",
+        legacyMs, newMs, legacyMs / newMs);
+    if (legacySink.checksum != sink.checksum)
+    {
+        fprintf(stderr, "checksum mismatch %zu != %zu\n", legacySink.checksum, sink.checksum);
+        return 1;
+    }
+    printf("checksum %zu\n", sink.checksum);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+* Module:   DirtyRegionBench
+*
+* Function: 按外接矩形重画与按 CDirtyRegion 的矩形分别重画的代价。控件树是合成的 1280x720 主窗口：
+*           标题栏、成员列表、4x4 视频宫格和底部工具栏，叶子控件有图标和文字。绘制按 DoPaint 的方式
+*           从根节点往下走，只进入与绘制矩形相交的控件，并把相交部分填进一块 32 位的帧缓冲模拟光栅化。
+*           每个场景是一帧内失效的控件，输出重画的矩形数、访问的控件数、像素数和每帧耗时（含 Add）
+*
+*    不是测试，不注册到 ctest：./DirtyRegionBench [帧数]
+*/
+#include "UIDirtyRegion.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+typedef CDirtyRegion::Rect Rect;
+
+static const long kWindowWidth = 1280;
+static const long kWindowHeight = 720;
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static Rect MakeRect(long left, long top, long right, long bottom)
+{
+    Rect rc = { left, top, right, bottom };
+    return rc;
+}
+
+struct Control
+{
+    Rect rc;
+    unsigned int dwColor;
+    std::vector<int> children;
+};
+
+class CControlTree
+{
+public:
+    CControlTree() : m_frame(kWindowWidth * kWindowHeight, 0)
+    {
+        const int root = AddControl(-1, MakeRect(0, 0, kWindowWidth, kWindowHeight));
+        const int title = AddControl(root, MakeRect(0, 0, kWindowWidth, 40));
+        AddGrid(title, MakeRect(0, 0, 480, 40), 12, 1, 2);
+        m_nClock = AddControl(title, MakeRect(1100, 10, 1180, 30));
+        const int members = AddControl(root, MakeRect(0, 40, 240, 660));
+        AddGrid(members, MakeRect(0, 40, 240, 660), 1, 20, 3);
+        const int videos = AddControl(root, MakeRect(240, 40, 1280, 660));
+        m_iFirstVideo = static_cast<int>(m_aControls.size());
+        AddGrid(videos, MakeRect(240, 40, 1280, 660), 4, 4, 3);
+        const int toolbar = AddControl(root, MakeRect(0, 660, kWindowWidth, kWindowHeight));
+        m_iFirstButton = static_cast<int>(m_aControls.size());
+        AddGrid(toolbar, MakeRect(240, 660, 1040, kWindowHeight), 12, 1, 2);
+    }
+
+    size_t GetControlCount() const { return m_aControls.size(); }
+    int GetClock() const { return m_nClock; }
+    // 视频格子和工具栏按钮都是 AddGrid 生成的，每个格子后面跟着它的子控件
+    int GetVideoTile(int i) const { return m_iFirstVideo + i * 4; }
+    int GetButton(int i) const { return m_iFirstButton + i * 3; }
+    const Rect& GetRect(int i) const { return m_aControls[i].rc; }
+
+    // 返回访问的控件数，像素数累加到 nPixels
+    int Paint(const Rect& rcPaint, long long& nPixels)
+    {
+        return PaintControl(0, rcPaint, nPixels);
+    }
+
+private:
+    int AddControl(int parent, const Rect& rc)
+    {
+        Control control;
+        control.rc = rc;
+        control.dwColor = 0xFF000000 | static_cast<unsigned int>(m_aControls.size() * 2654435761u);
+        m_aControls.push_back(control);
+        const int index = static_cast<int>(m_aControls.size()) - 1;
+        if (parent >= 0)
+            m_aControls[parent].children.push_back(index);
+        return index;
+    }
+
+    // cx x cy 的格子，每格有 nChildren 个子控件（背景以外的图标、文字等），格子之间留 4 像素
+    void AddGrid(int parent, const Rect& rc, int cx, int cy, int nChildren)
+    {
+        const long w = (rc.right - rc.left) / cx;
+        const long h = (rc.bottom - rc.top) / cy;
+        for (int y = 0; y < cy; ++y)
+        {
+            for (int x = 0; x < cx; ++x)
+            {
+                const Rect rcCell = MakeRect(rc.left + x * w + 2, rc.top + y * h + 2, rc.left + (x + 1) * w - 2, rc.top + (y + 1) * h - 2);
+                const int cell = AddControl(parent, rcCell);
+                const long cw = (rcCell.right - rcCell.left) / nChildren;
+                for (int c = 0; c < nChildren; ++c)
+                    AddControl(cell, MakeRect(rcCell.left + c * cw + 1, rcCell.top + 2, rcCell.left + (c + 1) * cw - 1, rcCell.bottom - 2));
+            }
+        }
+    }
+
+    int PaintControl(int index, const Rect& rcPaint, long long& nPixels)
+    {
+        const Control& control = m_aControls[index];
+        const Rect rc = MakeRect(std::max(control.rc.left, rcPaint.left), std::max(control.rc.top, rcPaint.top),
+            std::min(control.rc.right, rcPaint.right), std::min(control.rc.bottom, rcPaint.bottom));
+        if (rc.right <= rc.left || rc.bottom <= rc.top)
+            return 0;
+        for (long y = rc.top; y < rc.bottom; ++y)
+        {
+            unsigned int* pRow = &m_frame[y * kWindowWidth];
+            for (long x = rc.left; x < rc.right; ++x)
+                pRow[x] = control.dwColor;
+        }
+        nPixels += static_cast<long long>(rc.right - rc.left) * (rc.bottom - rc.top);
+        int nVisits = 1;
+        for (size_t i = 0; i < control.children.size(); ++i)
+            nVisits += PaintControl(control.children[i], rc, nPixels);
+        return nVisits;
+    }
+
+private:
+    std::vector<Control> m_aControls;
+    std::vector<unsigned int> m_frame;
+    int m_nClock;
+    int m_iFirstVideo;
+    int m_iFirstButton;
+};
+
+struct FrameResult
+{
+    int nRects;
+    int nVisits;
+    long long nPixels;
+};
+
+// 旧做法：失效矩形的外接矩形重画一次
+static FrameResult PaintBounds(CControlTree& tree, const std::vector<int>& dirty)
+{
+    Rect rcBounds = tree.GetRect(dirty[0]);
+    for (size_t i = 1; i < dirty.size(); ++i)
+    {
+        const Rect& rc = tree.GetRect(dirty[i]);
+        rcBounds = MakeRect(std::min(rcBounds.left, rc.left), std::min(rcBounds.top, rc.top),
+            std::max(rcBounds.right, rc.right), std::max(rcBounds.bottom, rc.bottom));
+    }
+    FrameResult result = { 1, 0, 0 };
+    result.nVisits = tree.Paint(rcBounds, result.nPixels);
+    return result;
+}
+
+static FrameResult PaintRegion(CControlTree& tree, CDirtyRegion& region, const std::vector<int>& dirty, std::vector<Rect>& rects)
+{
+    for (size_t i = 0; i < dirty.size(); ++i)
+        region.Add(tree.GetRect(dirty[i]));
+    region.Clip(MakeRect(0, 0, kWindowWidth, kWindowHeight));
+    region.Detach(rects);
+    FrameResult result = { static_cast<int>(rects.size()), 0, 0 };
+    for (size_t i = 0; i < rects.size(); ++i)
+        result.nVisits += tree.Paint(rects[i], result.nPixels);
+    return result;
+}
+
+static void RunScenario(const char* name, CControlTree& tree, const std::vector<std::vector<int> >& frames, int rounds)
+{
+    FrameResult bounds = { 0, 0, 0 };
+    FrameResult region = { 0, 0, 0 };
+    double begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        const FrameResult result = PaintBounds(tree, frames[r % frames.size()]);
+        bounds.nRects += result.nRects;
+        bounds.nVisits += result.nVisits;
+        bounds.nPixels += result.nPixels;
+    }
+    const double boundsUs = (Now() - begin) * 1e6 / rounds;
+
+    CDirtyRegion dirtyRegion;
+    std::vector<Rect> rects;
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        const FrameResult result = PaintRegion(tree, dirtyRegion, frames[r % frames.size()], rects);
+        region.nRects += result.nRects;
+        region.nVisits += result.nVisits;
+        region.nPixels += result.nPixels;
+    }
+    const double regionUs = (Now() - begin) * 1e6 / rounds;
+
+    printf("%-22s bounds: %4.1f rects %6.1f visits %8.0f px %8.1f us   region: %4.1f rects %6.1f visits %8.0f px %8.1f us   (%.1fx)\n",
+        name, static_cast<double>(bounds.nRects) / rounds, static_cast<double>(bounds.nVisits) / rounds,
+        static_cast<double>(bounds.nPixels) / rounds, boundsUs,
+        static_cast<double>(region.nRects) / rounds, static_cast<double>(region.nVisits) / rounds,
+        static_cast<double>(region.nPixels) / rounds, regionUs, boundsUs / regionUs);
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    CControlTree tree;
+    printf("%ldx%ld window, %zu controls, %d frames per scenario\n", kWindowWidth, kWindowHeight, tree.GetControlCount(), rounds);
+
+    std::vector<std::vector<int> > frames(1);
+    frames[0].push_back(tree.GetVideoTile(0));
+    RunScenario("one video tile", tree, frames, rounds);
+
+    // 右上角的时钟、左上角的视频画面和底部悬停的按钮
+    frames[0].clear();
+    frames[0].push_back(tree.GetClock());
+    frames[0].push_back(tree.GetVideoTile(0));
+    frames[0].push_back(tree.GetButton(5));
+    RunScenario("clock + video + hover", tree, frames, rounds);
+
+    // 所有视频画面都在刷新，相邻格子合并成大块
+    frames[0].clear();
+    for (int i = 0; i < 16; ++i)
+        frames[0].push_back(tree.GetVideoTile(i));
+    frames[0].push_back(tree.GetClock());
+    RunScenario("16 videos + clock", tree, frames, rounds);
+
+    // 每帧 12 个随机控件失效，超过 8 个矩形的上限
+    std::mt19937 rng(41);
+    frames.assign(64, std::vector<int>());
+    for (size_t f = 0; f < frames.size(); ++f)
+    {
+        for (int i = 0; i < 12; ++i)
+            frames[f].push_back(1 + static_cast<int>(rng() % (tree.GetControlCount() - 1)));
+    }
+    RunScenario("12 random controls", tree, frames, rounds);
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*
+* Module:   DirtyRegionTest
+*
+* Function: CDirtyRegion 的合并规则与不变量：包含关系、多画面积 1/4 的合并阈值（恰好等于时合并）、
+*           矩形数量上限（默认 8，超过时合并多画面积最小的一对）、SetMaxRects、Clip 和 Detach；
+*           随机序列中每个加入过的像素都要被覆盖，矩形数不超过上限，也没有矩形包含另一个
+*/
+#include "UIDirtyRegion.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+typedef CDirtyRegion::Rect Rect;
+
+static Rect MakeRect(long left, long top, long right, long bottom)
+{
+    Rect rc = { left, top, right, bottom };
+    return rc;
+}
+
+static bool SameRect(const Rect& a, const Rect& b)
+{
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+static bool Contains(const Rect& outer, const Rect& inner)
+{
+    return outer.left <= inner.left && outer.top <= inner.top && outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+static bool HasRect(const CDirtyRegion& region, const Rect& rc)
+{
+    for (int i = 0; i < region.GetCount(); ++i)
+    {
+        if (SameRect(region.GetAt(i), rc))
+            return true;
+    }
+    return false;
+}
+
+static bool Covers(const CDirtyRegion& region, long x, long y)
+{
+    for (int i = 0; i < region.GetCount(); ++i)
+    {
+        const Rect& rc = region.GetAt(i);
+        if (x >= rc.left && x < rc.right && y >= rc.top && y < rc.bottom)
+            return true;
+    }
+    return false;
+}
+
+static void TestEmpty()
+{
+    CDirtyRegion region;
+    TEST_CHECK(region.IsEmpty() && region.GetCount() == 0);
+    TEST_CHECK(region.GetMaxRects() == CDirtyRegion::DEFAULT_MAX_RECTS);
+    region.Add(10, 10, 10, 20);
+    region.Add(10, 10, 20, 10);
+    region.Add(20, 20, 10, 10);
+    TEST_CHECK(region.IsEmpty());
+    TEST_CHECK(SameRect(region.GetBounds(), MakeRect(0, 0, 0, 0)));
+    TEST_CHECK(region.GetArea() == 0);
+
+    // 上限至少为 1
+    CDirtyRegion one(0);
+    TEST_CHECK(one.GetMaxRects() == 1);
+    one.SetMaxRects(-3);
+    TEST_CHECK(one.GetMaxRects() == 1);
+}
+
+static void TestContainment()
+{
+    CDirtyRegion region;
+    region.Add(0, 0, 100, 100);
+    region.Add(10, 10, 20, 20);
+    region.Add(0, 0, 100, 100);
+    TEST_CHECK(region.GetCount() == 1);
+    TEST_CHECK(SameRect(region.GetAt(0), MakeRect(0, 0, 100, 100)));
+
+    // 新矩形包含旧矩形时替换掉旧的，不相干的留下
+    region.Clear();
+    region.Add(10, 10, 20, 20);
+    region.Add(500, 500, 510, 510);
+    region.Add(30, 30, 40, 40);
+    region.Add(0, 0, 50, 50);
+    TEST_CHECK(region.GetCount() == 2);
+    TEST_CHECK(HasRect(region, MakeRect(0, 0, 50, 50)));
+    TEST_CHECK(HasRect(region, MakeRect(500, 500, 510, 510)));
+}
+
+static void TestMergeThreshold()
+{
+    // 相邻的同高矩形多画面积为 0，直接合并
+    CDirtyRegion region;
+    region.Add(0, 0, 10, 10);
+    region.Add(10, 0, 20, 10);
+    TEST_CHECK(region.GetCount() == 1);
+    TEST_CHECK(SameRect(region.GetAt(0), MakeRect(0, 0, 20, 10)));
+
+    // (0,0,10,10) 和 (10,0,20,h) 的外接矩形是 200，多画 100 - 10h；h = 5 时恰好是 1/4，合并
+    region.Clear();
+    region.Add(0, 0, 10, 10);
+    region.Add(10, 0, 20, 5);
+    TEST_CHECK(region.GetCount() == 1);
+    TEST_CHECK(SameRect(region.GetAt(0), MakeRect(0, 0, 20, 10)));
+
+    // h = 4 时多画 60 > 50，不合并
+    region.Clear();
+    region.Add(0, 0, 10, 10);
+    region.Add(10, 0, 20, 4);
+    TEST_CHECK(region.GetCount() == 2);
+    TEST_CHECK(region.GetArea() == 140);
+
+    // 重叠部分不算多画：(0,0,10,10) 和 (5,5,15,15) 外接 225，面积和 200 减去重叠 25，多画 50 <= 56
+    region.Clear();
+    region.Add(0, 0, 10, 10);
+    region.Add(5, 5, 15, 15);
+    TEST_CHECK(region.GetCount() == 1);
+    TEST_CHECK(SameRect(region.GetAt(0), MakeRect(0, 0, 15, 15)));
+
+    // 对角相接的两个矩形多画一半，不合并
+    region.Clear();
+    region.Add(0, 0, 10, 10);
+    region.Add(10, 10, 20, 20);
+    TEST_CHECK(region.GetCount() == 2);
+
+    // 合并结果还能继续和别的矩形合并：先加左右两块，中间一块把三块连成一条
+    region.Clear();
+    region.Add(0, 0, 10, 10);
+    region.Add(20, 0, 30, 10);
+    TEST_CHECK(region.GetCount() == 2);
+    region.Add(10, 0, 20, 10);
+    TEST_CHECK(region.GetCount() == 1);
+    TEST_CHECK(SameRect(region.GetAt(0), MakeRect(0, 0, 30, 10)));
+}
+
+static void TestMaxRects()
+{
+    // 8 个互相离得很远的矩形都保留
+    CDirtyRegion region;
+    for (long k = 0; k < 7; ++k)
+        region.Add(100 + k * 100, 0, 110 + k * 100, 10);
+    region.Add(0, 0, 10, 10);
+    TEST_CHECK(region.GetCount() == 8);
+
+    // 第 9 个与 (0,0,10,10) 对角相邻，不满足 1/4 阈值，但这一对多画的面积最小，超过上限时合并它们
+    region.Add(11, 11, 21, 21);
+    TEST_CHECK(region.GetCount() == 8);
+    TEST_CHECK(HasRect(region, MakeRect(0, 0, 21, 21)));
+    for (long k = 0; k < 7; ++k)
+        TEST_CHECK(HasRect(region, MakeRect(100 + k * 100, 0, 110 + k * 100, 10)));
+
+    // 调小上限时立即合并，保留下来的像素仍然覆盖
+    region.SetMaxRects(3);
+    TEST_CHECK(region.GetMaxRects() == 3);
+    TEST_CHECK(region.GetCount() <= 3);
+    TEST_CHECK(Covers(region, 0, 0) && Covers(region, 20, 20));
+    for (long k = 0; k < 7; ++k)
+        TEST_CHECK(Covers(region, 100 + k * 100, 0) && Covers(region, 109 + k * 100, 9));
+
+    // 上限为 1 时退化成外接矩形
+    CDirtyRegion single(1);
+    single.Add(0, 0, 10, 10);
+    single.Add(500, 300, 510, 310);
+    TEST_CHECK(single.GetCount() == 1);
+    TEST_CHECK(SameRect(single.GetAt(0), MakeRect(0, 0, 510, 310)));
+}
+
+static void TestClipAndDetach()
+{
+    CDirtyRegion region;
+    region.Add(-20, -20, 10, 10);
+    region.Add(600, 400, 700, 500);
+    region.Add(2000, 2000, 2100, 2100);
+    TEST_CHECK(region.GetCount() == 3);
+    TEST_CHECK(SameRect(region.GetBounds(), MakeRect(-20, -20, 2100, 2100)));
+    region.Clip(MakeRect(0, 0, 640, 480));
+    TEST_CHECK(region.GetCount() == 2);
+    TEST_CHECK(HasRect(region, MakeRect(0, 0, 10, 10)));
+    TEST_CHECK(HasRect(region, MakeRect(600, 400, 640, 480)));
+    TEST_CHECK(region.GetArea() == 100 + 40 * 80);
+
+    std::vector<Rect> rects(5);
+    region.Detach(rects);
+    TEST_CHECK(rects.size() == 2);
+    TEST_CHECK(region.IsEmpty());
+    region.Detach(rects);
+    TEST_CHECK(rects.empty());
+}
+
+// 随机序列：每个加入过的像素都被覆盖，数量不超过上限，没有矩形包含另一个，Clip 之后都在边界内
+static void TestRandomInvariants()
+{
+    const long kWidth = 160, kHeight = 120;
+    std::mt19937 rng(41);
+    for (int iter = 0; iter < 2000; ++iter)
+    {
+        const int nMaxRects = 1 + static_cast<int>(rng() % 10);
+        CDirtyRegion region(nMaxRects);
+        std::vector<unsigned char> added(kWidth * kHeight, 0);
+        const int nAdds = 1 + static_cast<int>(rng() % 24);
+        for (int a = 0; a < nAdds; ++a)
+        {
+            // 大多是控件大小的小矩形，偶尔有空矩形和越界的矩形
+            const long left = static_cast<long>(rng() % (kWidth + 20)) - 10;
+            const long top = static_cast<long>(rng() % (kHeight + 20)) - 10;
+            const long right = left + static_cast<long>(rng() % 40) - 2;
+            const long bottom = top + static_cast<long>(rng() % 30) - 2;
+            region.Add(left, top, right, bottom);
+            for (long y = top < 0 ? 0 : top; y < bottom && y < kHeight; ++y)
+            {
+                for (long x = left < 0 ? 0 : left; x < right && x < kWidth; ++x)
+                    added[y * kWidth + x] = 1;
+            }
+
+            TEST_CHECK(region.GetCount() <= nMaxRects);
+            for (int i = 0; i < region.GetCount(); ++i)
+            {
+                const Rect& rc = region.GetAt(i);
+                TEST_CHECK(rc.right > rc.left && rc.bottom > rc.top);
+                TEST_CHECK(Contains(region.GetBounds(), rc));
+                for (int j = 0; j < region.GetCount(); ++j)
+                    TEST_CHECK(i == j || !Contains(rc, region.GetAt(j)));
+            }
+        }
+        for (long y = 0; y < kHeight; ++y)
+        {
+            for (long x = 0; x < kWidth; ++x)
+                TEST_CHECK(!added[y * kWidth + x] || Covers(region, x, y));
+        }
+
+        if (iter % 4 == 0)
+            region.SetMaxRects(1 + static_cast<int>(rng() % 4));
+        const Rect rcBound = MakeRect(0, 0, kWidth, kHeight);
+        region.Clip(rcBound);
+        TEST_CHECK(region.GetCount() <= region.GetMaxRects());
+        for (int i = 0; i < region.GetCount(); ++i)
+            TEST_CHECK(Contains(rcBound, region.GetAt(i)));
+        for (long y = 0; y < kHeight; ++y)
+        {
+            for (long x = 0; x < kWidth; ++x)
+                TEST_CHECK(!added[y * kWidth + x] || Covers(region, x, y));
+        }
+    }
+}
+
+int main()
+{
+    TestEmpty();
+    TestContainment();
+    TestMergeThreshold();
+    TestMaxRects();
+    TestClipAndDetach();
+    TestRandomInvariants();
+    printf("DirtyRegionTest passed\n");
+    return 0;
+}
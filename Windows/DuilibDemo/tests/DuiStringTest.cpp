@@ -0,0 +1,461 @@
+/*
+* Module:   DuiStringTest
+*
+* Function: CDuiString、CDuiStringView 和 ParseAttributeList，通过 TcharShim 按 TCHAR = wchar_t 编译。
+*           内部缓冲区 31/32 个字符的边界、自身追加和赋值、SetAt('\0') 截断、空模式和重叠模式的 Replace、
+*           移动后的状态、NextToken，以及随机操作序列与 std::wstring 对照
+*/
+#include "StdAfx.h"
+#include "UIString.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace DuiLib;
+
+static const int kLocal = CDuiString::MAX_LOCAL_STRING_LEN;
+
+// 字符串是否放在对象自己的缓冲区里
+static bool IsLocal(const CDuiString& s)
+{
+    const char* p = reinterpret_cast<const char*>(s.GetData());
+    const char* pObject = reinterpret_cast<const char*>(&s);
+    return p >= pObject && p < pObject + sizeof(s);
+}
+
+static bool Same(const CDuiString& s, const std::wstring& expected)
+{
+    return s.GetLength() == static_cast<int>(expected.size()) && wcslen(s.GetData()) == expected.size() &&
+        expected == s.GetData();
+}
+
+static std::wstring Letters(int n, wchar_t first = L'a')
+{
+    std::wstring s;
+    for (int i = 0; i < n; ++i)
+        s.push_back(static_cast<wchar_t>(first + i % 26));
+    return s;
+}
+
+static void TestLocalBoundary()
+{
+    TEST_CHECK(kLocal == 31);
+    const std::wstring s31 = Letters(31), s32 = Letters(32);
+
+    CDuiString a(s31.c_str());
+    TEST_CHECK(Same(a, s31) && IsLocal(a));
+    CDuiString b(s32.c_str());
+    TEST_CHECK(Same(b, s32) && !IsLocal(b));
+
+    // 第 32 个字符追加进来时才换到堆上
+    CDuiString c(Letters(30).c_str());
+    c += L'e';
+    TEST_CHECK(Same(c, s31) && IsLocal(c));
+    c += L'f';
+    TEST_CHECK(Same(c, s31 + L"f") && !IsLocal(c));
+
+    // Assign 保留堆上的容量，Empty 回到内部缓冲区
+    LPCTSTR pHeap = b.GetData();
+    b = L"short";
+    TEST_CHECK(Same(b, L"short") && b.GetData() == pHeap);
+    b.Empty();
+    TEST_CHECK(Same(b, L"") && IsLocal(b));
+
+    // 按长度构造和 Assign 恰好在边界上
+    CDuiString d(s32.c_str(), 31);
+    TEST_CHECK(Same(d, s31) && IsLocal(d));
+    d.Assign(s32.c_str(), 32);
+    TEST_CHECK(Same(d, s32));
+    d.Assign(s31.c_str(), 100);
+    TEST_CHECK(Same(d, s31));
+
+    // 拷贝和 + 的结果按长度决定位置
+    CDuiString e = a;
+    TEST_CHECK(Same(e, s31) && IsLocal(e));
+    CDuiString f = a + L"g";
+    TEST_CHECK(Same(f, s31 + L"g") && !IsLocal(f));
+    CDuiString g = CDuiString(L"abc") + CDuiString(L"def");
+    TEST_CHECK(Same(g, L"abcdef") && IsLocal(g));
+
+    // Reserve 之后追加不再移动缓冲区
+    CDuiString h;
+    h.Reserve(100);
+    LPCTSTR pReserved = h.GetData();
+    for (int i = 0; i < 100; ++i)
+        h += static_cast<TCHAR>(L'a' + i % 26);
+    TEST_CHECK(h.GetData() == pReserved && Same(h, Letters(100)));
+}
+
+static void TestSelfAliasing()
+{
+    // 自身追加：内部缓冲区内、跨过边界、堆上扩容
+    CDuiString s(L"abcd");
+    s += s;
+    TEST_CHECK(Same(s, L"abcdabcd"));
+    CDuiString t(Letters(16).c_str());
+    t += t;
+    TEST_CHECK(Same(t, Letters(16) + Letters(16)) && !IsLocal(t));
+    CDuiString u(Letters(40).c_str());
+    u.Append(u.GetData() + 10);
+    TEST_CHECK(Same(u, Letters(40) + Letters(40).substr(10)));
+    u.Append(u.GetData(), 3);
+    TEST_CHECK(Same(u, Letters(40) + Letters(40).substr(10) + L"abc"));
+    u += u.GetData() + u.GetLength();
+    TEST_CHECK(u.GetLength() == 73);
+
+    // 自身赋值：整个字符串、后缀、按长度截取的中间一段
+    CDuiString v(Letters(50).c_str());
+    const CDuiString& vRef = v;
+    v = vRef;
+    TEST_CHECK(Same(v, Letters(50)));
+    v = v.GetData();
+    TEST_CHECK(Same(v, Letters(50)));
+    v = v.GetData() + 45;
+    TEST_CHECK(Same(v, Letters(50).substr(45)));
+    CDuiString w(L"0123456789");
+    w.Assign(w.GetData() + 2, 3);
+    TEST_CHECK(Same(w, L"234"));
+    CDuiString& wRef = w;
+    w = std::move(wRef);
+    TEST_CHECK(Same(w, L"234"));
+
+    // + 的参数是自身
+    CDuiString x(Letters(20).c_str());
+    x = x + x;
+    TEST_CHECK(Same(x, Letters(20) + Letters(20)));
+    x = x + x.GetData();
+    TEST_CHECK(x.GetLength() == 80);
+}
+
+static void TestSetAt()
+{
+    CDuiString s(L"hello world");
+    s.SetAt(0, L'H');
+    TEST_CHECK(Same(s, L"Hello world"));
+    // 写入 0 截断长度，之后的追加和比较都按截断后的内容
+    s.SetAt(5, L'\0');
+    TEST_CHECK(Same(s, L"Hello") && s.GetLength() == 5);
+    TEST_CHECK(s == CDuiString(L"Hello") && s == L"Hello");
+    s += L"!";
+    TEST_CHECK(Same(s, L"Hello!"));
+    TEST_CHECK(s.Find(L'w') < 0 && s.ReverseFind(L'!') == 5);
+
+    CDuiString h(Letters(40).c_str());
+    h.SetAt(0, L'\0');
+    TEST_CHECK(h.IsEmpty() && Same(h, L""));
+    h += L'z';
+    TEST_CHECK(Same(h, L"z"));
+}
+
+static void TestReplace()
+{
+    // 空模式不替换
+    CDuiString s(L"abc");
+    TEST_CHECK(s.Replace(L"", L"x") == 0 && Same(s, L"abc"));
+    TEST_CHECK(s.Replace(L"zz", L"x") == 0 && Same(s, L"abc"));
+
+    // 重叠的匹配从左到右、不重叠地替换
+    CDuiString a(L"aaa");
+    TEST_CHECK(a.Replace(L"aa", L"b") == 1 && Same(a, L"ba"));
+    CDuiString b(L"aaaa");
+    TEST_CHECK(b.Replace(L"aa", L"a") == 2 && Same(b, L"aa"));
+
+    // 替换进去的内容不再参与查找
+    CDuiString c(L"aaa");
+    TEST_CHECK(c.Replace(L"a", L"aa") == 3 && Same(c, L"aaaaaa"));
+    CDuiString d(L"xyx");
+    TEST_CHECK(d.Replace(L"x", L"") == 2 && Same(d, L"y"));
+
+    // 模式和替换内容指向自身
+    CDuiString e(L"abcabc");
+    TEST_CHECK(e.Replace(e.GetData() + 3, L"x") == 2 && Same(e, L"xx"));
+    CDuiString f(L"ab-ab");
+    TEST_CHECK(f.Replace(L"-", f.GetData()) == 1 && Same(f, L"abab-abab"));
+
+    // 结果跨过内部缓冲区的边界
+    CDuiString g(L"&quot;&quot;&quot;&quot;&quot;&quot;");
+    TEST_CHECK(g.Replace(L"&quot;", L"\"") == 6 && Same(g, L"\"\"\"\"\"\""));
+    CDuiString h(L"a,b,c,d,e,f,g,h,i,j,k,l");
+    TEST_CHECK(h.Replace(L",", L", ") == 11 && Same(h, L"a, b, c, d, e, f, g, h, i, j, k, l"));
+}
+
+static void TestMove()
+{
+    // 内部缓冲区的内容被复制，堆上的缓冲区被接管；移动后的对象为空并可以继续使用
+    CDuiString a(L"short");
+    CDuiString b(std::move(a));
+    TEST_CHECK(Same(b, L"short") && IsLocal(b));
+    TEST_CHECK(Same(a, L"") && a.IsEmpty() && IsLocal(a));
+    a += L"again";
+    TEST_CHECK(Same(a, L"again"));
+
+    CDuiString c(Letters(40).c_str());
+    LPCTSTR pHeap = c.GetData();
+    CDuiString d(std::move(c));
+    TEST_CHECK(Same(d, Letters(40)) && d.GetData() == pHeap);
+    TEST_CHECK(Same(c, L"") && IsLocal(c));
+    c = Letters(35).c_str();
+    TEST_CHECK(Same(c, Letters(35)));
+
+    // 移动赋值：堆到堆释放旧的缓冲区，内部到堆时保留目标的缓冲区
+    CDuiString e(Letters(60).c_str());
+    pHeap = e.GetData();
+    d = std::move(e);
+    TEST_CHECK(Same(d, Letters(60)) && d.GetData() == pHeap);
+    TEST_CHECK(Same(e, L"") && IsLocal(e));
+    CDuiString f(L"tiny");
+    d = std::move(f);
+    TEST_CHECK(Same(d, L"tiny") && d.GetData() == pHeap);
+    TEST_CHECK(Same(f, L""));
+    f += f;
+    TEST_CHECK(Same(f, L""));
+
+    std::vector<CDuiString> v;
+    for (int i = 0; i < 100; ++i)
+        v.push_back(CDuiString(Letters(i).c_str()));
+    for (int i = 0; i < 100; ++i)
+        TEST_CHECK(Same(v[i], Letters(i)));
+}
+
+static void TestAccessors()
+{
+    CDuiString s(L"Hello, World");
+    TEST_CHECK(Same(s.Left(5), L"Hello") && Same(s.Left(-1), L"") && Same(s.Left(100), L"Hello, World"));
+    TEST_CHECK(Same(s.Mid(7), L"World") && Same(s.Mid(7, 3), L"Wor") && Same(s.Mid(20), L""));
+    TEST_CHECK(Same(s.Right(5), L"World") && Same(s.Right(100), L"Hello, World") && Same(s.Right(-1), L""));
+    TEST_CHECK(s.Find(L'o') == 4 && s.Find(L'o', 5) == 8 && s.Find(L'o', 12) == -1);
+    TEST_CHECK(s.Find(L"World") == 7 && s.Find(L"World", 8) == -1 && s.Find(L"", 12) == 12);
+    TEST_CHECK(s.CompareNoCase(L"hello, world") == 0 && s.Compare(L"Hello, World") == 0 && s < L"Z");
+    s.MakeUpper();
+    TEST_CHECK(Same(s, L"HELLO, WORLD"));
+    s.MakeLower();
+    TEST_CHECK(Same(s, L"hello, world"));
+
+    CDuiString c(L'x');
+    TEST_CHECK(Same(c, L"x"));
+    c = L'\0';
+    TEST_CHECK(Same(c, L""));
+    c = L'y';
+    TEST_CHECK(Same(c, L"y"));
+    CDuiString n(static_cast<LPCTSTR>(NULL));
+    TEST_CHECK(Same(n, L""));
+    n = static_cast<LPCTSTR>(NULL);
+    TEST_CHECK(Same(n, L""));
+
+    // 窄字符串按 ACP 转换，超过内部缓冲区的长度
+    CDuiString w;
+    w = "attribute value longer than the local buffer";
+    TEST_CHECK(Same(w, L"attribute value longer than the local buffer"));
+    w += " and more";
+    TEST_CHECK(Same(w, L"attribute value longer than the local buffer and more"));
+
+    // SmallFormat 最多 63 个字符
+    CDuiString f;
+    f.SmallFormat(L"%d,%d", 12, -3);
+    TEST_CHECK(Same(f, L"12,-3"));
+    f.SmallFormat(L"%ls", Letters(100).c_str());
+    TEST_CHECK(f.GetLength() <= 63);
+}
+
+static void TestView()
+{
+    CDuiStringView empty;
+    TEST_CHECK(empty.IsEmpty() && empty == L"" && empty.Find(L'a') == -1);
+    CDuiStringView null(static_cast<LPCTSTR>(NULL));
+    TEST_CHECK(null.IsEmpty() && null == L"");
+
+    // 不以 0 结尾的片段只比较自己的长度
+    const wchar_t* pText = L"abcdef";
+    CDuiStringView abc(pText, 3);
+    TEST_CHECK(abc == L"abc" && abc != L"ab" && abc != L"abcd" && abc.CompareNoCase(L"ABC") == 0);
+    TEST_CHECK(abc.Find(L'd') == -1 && abc.Find(L'c') == 2 && abc.Find(L'a', -5) == 0);
+    TEST_CHECK(abc.Mid(1) == L"bc" && abc.Mid(1, 1) == L"b" && abc.Mid(5).IsEmpty() && abc.Mid(-1, 2) == L"ab");
+
+    CDuiString s(L"Label");
+    CDuiStringView fromString(s);
+    TEST_CHECK(fromString.GetData() == s.GetData() && fromString.GetLength() == 5 && fromString[4] == L'l');
+}
+
+static void TestNextToken()
+{
+    std::vector<std::wstring> tokens;
+    CDuiStringView list(L" ,left,,vcenter  right, ");
+    CDuiStringView token;
+    int iPos = 0;
+    while (list.NextToken(iPos, L", ", token))
+        tokens.push_back(std::wstring(token.GetData(), token.GetLength()));
+    TEST_CHECK(tokens.size() == 3 && tokens[0] == L"left" && tokens[1] == L"vcenter" && tokens[2] == L"right");
+    TEST_CHECK(iPos == list.GetLength());
+    TEST_CHECK(!list.NextToken(iPos, L", ", token));
+
+    iPos = 0;
+    TEST_CHECK(!CDuiStringView(L"").NextToken(iPos, L", ", token));
+    iPos = 0;
+    TEST_CHECK(!CDuiStringView(L" ,, ").NextToken(iPos, L", ", token));
+
+    // 片段后面的内容不属于它，最后一段在片段的末尾结束
+    CDuiStringView part(L"top,bottom", 5);
+    iPos = 0;
+    TEST_CHECK(part.NextToken(iPos, L",", token) && token == L"top");
+    TEST_CHECK(part.NextToken(iPos, L",", token) && token == L"b");
+    TEST_CHECK(!part.NextToken(iPos, L",", token));
+
+    // 没有分隔符时整段是一个 token
+    iPos = 0;
+    TEST_CHECK(CDuiStringView(L"center").NextToken(iPos, L", ", token) && token == L"center" && iPos == 6);
+}
+
+struct AttributeRecorder
+{
+    std::vector<std::pair<std::wstring, std::wstring> > items;
+
+    void SetAttribute(LPCTSTR pstrName, LPCTSTR pstrValue)
+    {
+        items.push_back(std::make_pair(std::wstring(pstrName), std::wstring(pstrValue)));
+    }
+};
+
+static void TestParseAttributeList()
+{
+    // 写在 XML 属性里的列表用 &quot; 代替引号
+    AttributeRecorder r;
+    ParseAttributeList(L"name=\"btn\" pos=\"1,2,3,4\",text=&quot;OK&quot;", r);
+    TEST_CHECK(r.items.size() == 3);
+    TEST_CHECK(r.items[0].first == L"name" && r.items[0].second == L"btn");
+    TEST_CHECK(r.items[1].first == L"pos" && r.items[1].second == L"1,2,3,4");
+    TEST_CHECK(r.items[2].first == L"text" && r.items[2].second == L"OK");
+
+    // 空值、超过内部缓冲区的值、结尾的分隔符
+    r.items.clear();
+    const std::wstring sLong = L"file='" + Letters(60) + L".png' source='0,0,10,10'";
+    ParseAttributeList((L"text=\"\" bkimage=\"" + sLong + L"\" ").c_str(), r);
+    TEST_CHECK(r.items.size() == 2 && r.items[0].second.empty() && r.items[1].second == sLong);
+
+    // 格式不对时停在出错的位置，之前的属性已经设置
+    r.items.clear();
+    ParseAttributeList(L"a=\"1\" b=2 c=\"3\"", r);
+    TEST_CHECK(r.items.size() == 1 && r.items[0].second == L"1");
+    r.items.clear();
+    ParseAttributeList(L"a=\"1\";b=\"2\"", r);
+    TEST_CHECK(r.items.size() == 1);
+    r.items.clear();
+    ParseAttributeList(L"a=\"unterminated", r);
+    TEST_CHECK(r.items.empty());
+    r.items.clear();
+    ParseAttributeList(L"", r);
+    TEST_CHECK(r.items.empty());
+}
+
+// 随机操作序列与 std::wstring 对照，长度集中在内部缓冲区的边界附近
+static void TestRandomOps()
+{
+    std::mt19937 rng(45);
+    for (int round = 0; round < 200; ++round)
+    {
+        CDuiString s;
+        std::wstring ref;
+        for (int op = 0; op < 200; ++op)
+        {
+            const std::wstring piece = Letters(static_cast<int>(rng() % 40), static_cast<wchar_t>(L'a' + rng() % 3));
+            switch (rng() % 10)
+            {
+            case 0:
+                s = piece.c_str();
+                ref = piece;
+                break;
+            case 1:
+                s += piece.c_str();
+                ref += piece;
+                break;
+            case 2:
+            {
+                const int n = static_cast<int>(rng() % 45);
+                s.Append(piece.c_str(), n);
+                ref += piece.substr(0, n);
+                break;
+            }
+            case 3:
+            {
+                CDuiString moved(std::move(s));
+                s = std::move(moved);
+                break;
+            }
+            case 4:
+            {
+                const int iPos = ref.empty() ? 0 : static_cast<int>(rng() % ref.size());
+                const int n = static_cast<int>(rng() % 40) - 5;
+                s = s.Mid(iPos, n);
+                ref = n < 0 ? ref.substr(iPos) : ref.substr(iPos, n);
+                break;
+            }
+            case 5:
+            {
+                const std::wstring from = Letters(1 + static_cast<int>(rng() % 2), static_cast<wchar_t>(L'a' + rng() % 3));
+                const std::wstring to = Letters(static_cast<int>(rng() % 3), L'x');
+                int nCount = 0;
+                for (size_t iPos = ref.find(from); iPos != std::wstring::npos; iPos = ref.find(from, iPos + to.size()))
+                {
+                    ref.replace(iPos, from.size(), to);
+                    ++nCount;
+                }
+                TEST_CHECK(s.Replace(from.c_str(), to.c_str()) == nCount);
+                break;
+            }
+            case 6:
+                if (!ref.empty())
+                {
+                    const size_t iPos = rng() % ref.size();
+                    s.Append(s.GetData() + iPos);
+                    ref += ref.substr(iPos);
+                }
+                break;
+            case 7:
+                s = s + piece.c_str();
+                ref = ref + piece;
+                break;
+            case 8:
+                if (!ref.empty())
+                {
+                    const size_t iPos = rng() % ref.size();
+                    s.SetAt(static_cast<int>(iPos), L'\0');
+                    ref.resize(iPos);
+                }
+                break;
+            default:
+                if (ref.size() > 200)
+                {
+                    s.Empty();
+                    ref.clear();
+                }
+                else
+                {
+                    s += L'q';
+                    ref += L'q';
+                }
+                break;
+            }
+            TEST_CHECK(Same(s, ref));
+            TEST_CHECK(s.Find(L'c') == static_cast<int>(ref.find(L'c')));
+        }
+    }
+}
+
+int main()
+{
+    TestLocalBoundary();
+    TestSelfAliasing();
+    TestSetAt();
+    TestReplace();
+    TestMove();
+    TestAccessors();
+    TestView();
+    TestNextToken();
+    TestParseAttributeList();
+    TestRandomOps();
+    printf("DuiStringTest passed\n");
+    return 0;
+}
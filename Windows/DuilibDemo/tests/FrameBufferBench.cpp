@@ -0,0 +1,204 @@
+/*
+* Module:   FrameBufferBench
+*
+* Function: 分层窗口每次 WM_PAINT 在整个离屏位图上做的像素操作，1080p 和 4K 各一帧：
+*           清空、子窗口图像置不透明、恢复 GDI 清掉的 alpha、按背景 alpha 裁剪。
+*           原来 UIManager.cpp 中的逐像素循环对比 UIFrameBuffer 的标量、SSE2、AVX2 实现。
+*           像素混合了透明、只有颜色（GDI 画过）和不透明三种，每轮计时前恢复成同一份内容；
+*           清空为 0 时各级实现都用 memset，结果相同
+*
+*    不是测试，不注册到 ctest：./FrameBufferBench [轮数]
+*/
+#include "UIFrameBuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+enum FrameOp
+{
+    OP_CLEAR,
+    OP_SET_OPAQUE,
+    OP_RESTORE_GDI_ALPHA,
+    OP_APPLY_MASK,
+    OP_COUNT,
+};
+
+static const char* const kOpNames[] = { "clear", "child alpha", "gdi alpha", "mask blend" };
+static const char* const kLevelNames[] = { "scalar", "SSE2", "SSSE3", "AVX2" };
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 原来的循环，按 WM_PAINT 中的写法逐像素计算下标
+static void LegacyOp(FrameOp op, unsigned char* pOffscreenBits, const unsigned int* pBackgroundBits, long nWidth, long nHeight)
+{
+    switch (op)
+    {
+    case OP_CLEAR:
+        for (long y = 0; y < nHeight; ++y)
+        {
+            for (long x = 0; x < nWidth; ++x)
+            {
+                const long i = (y * nWidth + x) * 4;
+                *reinterpret_cast<unsigned int*>(&pOffscreenBits[i]) = 0;
+            }
+        }
+        break;
+    case OP_SET_OPAQUE:
+    {
+        unsigned int* pChildBitmapBits = reinterpret_cast<unsigned int*>(pOffscreenBits);
+        for (long y = 0; y < nHeight; y++)
+        {
+            for (long x = 0; x < nWidth; x++)
+            {
+                unsigned int* pChildBitmapBit = pChildBitmapBits + y * nWidth + x;
+                if (*pChildBitmapBit != 0x00000000)
+                    *pChildBitmapBit |= 0xff000000;
+            }
+        }
+        break;
+    }
+    case OP_RESTORE_GDI_ALPHA:
+        for (long y = 0; y < nHeight; ++y)
+        {
+            for (long x = 0; x < nWidth; ++x)
+            {
+                const long i = (y * nWidth + x) * 4;
+                if ((pOffscreenBits[i + 3] == 0) && (pOffscreenBits[i + 0] != 0 || pOffscreenBits[i + 1] != 0 || pOffscreenBits[i + 2] != 0))
+                    pOffscreenBits[i + 3] = 255;
+            }
+        }
+        break;
+    default:
+        // 原来按 BYTE* 加像素下标，指向了错误的内存；这里用修正后的下标，公式不变
+        for (long y = 0; y < nHeight; ++y)
+        {
+            for (long x = 0; x < nWidth; ++x)
+            {
+                unsigned int* pPixel = reinterpret_cast<unsigned int*>(pOffscreenBits) + y * nWidth + x;
+                const unsigned int* pBackground = pBackgroundBits + y * nWidth + x;
+                const unsigned char A = static_cast<unsigned char>((*pBackground) >> 24);
+                const unsigned char R = static_cast<unsigned char>(static_cast<unsigned char>((*pPixel) >> 16) * A / 255);
+                const unsigned char G = static_cast<unsigned char>(static_cast<unsigned char>((*pPixel) >> 8) * A / 255);
+                const unsigned char B = static_cast<unsigned char>(static_cast<unsigned char>(*pPixel) * A / 255);
+                *pPixel = (B | (G << 8) | (static_cast<unsigned int>(R) << 16)) + (static_cast<unsigned int>(A) << 24);
+            }
+        }
+        break;
+    }
+}
+
+static void RunOp(FrameOp op, unsigned int* pBits, const unsigned int* pMask, int nWidth, int nHeight, PixelConvertLevel eLevel)
+{
+    switch (op)
+    {
+    case OP_CLEAR:
+        FillPixels(pBits, nWidth, nWidth, nHeight, 0, eLevel);
+        break;
+    case OP_SET_OPAQUE:
+        SetOpaqueIfNonZero(pBits, nWidth, nWidth, nHeight, eLevel);
+        break;
+    case OP_RESTORE_GDI_ALPHA:
+        RestoreGdiAlpha(pBits, nWidth, nWidth, nHeight, eLevel);
+        break;
+    default:
+        ApplyAlphaMask(pBits, nWidth, pMask, nWidth, nWidth, nHeight, eLevel);
+        break;
+    }
+}
+
+// 界面上大片透明（圆角、阴影外）、GDI 画的文字 alpha 为 0、其余是不透明或半透明的图片
+static void MakeFrame(std::vector<unsigned int>& frame, std::vector<unsigned int>& mask, int nWidth, int nHeight)
+{
+    std::mt19937 rng(42);
+    frame.resize(static_cast<size_t>(nWidth) * nHeight);
+    mask.resize(frame.size());
+    for (size_t i = 0; i < frame.size(); ++i)
+    {
+        const unsigned int value = rng();
+        switch (value % 8)
+        {
+        case 0:
+            frame[i] = 0;
+            break;
+        case 1:
+        case 2:
+            frame[i] = value & 0x00FFFFFF;
+            break;
+        case 3:
+            frame[i] = value;
+            break;
+        default:
+            frame[i] = value | 0xFF000000;
+            break;
+        }
+        // 背景图只有边缘一圈是半透明的
+        const int x = static_cast<int>(i % nWidth), y = static_cast<int>(i / nWidth);
+        const bool bEdge = x < 16 || y < 16 || x >= nWidth - 16 || y >= nHeight - 16;
+        mask[i] = (bEdge ? (value >> 8) & 0xFF000000 : 0xFF000000) | 0x00F0F0F0;
+    }
+}
+
+// nLevel < 0 表示原来的循环；返回每轮毫秒数
+static double TimeOp(FrameOp op, int nLevel, const std::vector<unsigned int>& frame, const std::vector<unsigned int>& mask,
+    std::vector<unsigned int>& work, int nWidth, int nHeight, int rounds, size_t& checksum)
+{
+    double total = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        memcpy(&work[0], frame.data(), frame.size() * 4);
+        const double begin = Now();
+        if (nLevel < 0)
+            LegacyOp(op, reinterpret_cast<unsigned char*>(&work[0]), mask.data(), nWidth, nHeight);
+        else
+            RunOp(op, &work[0], mask.data(), nWidth, nHeight, static_cast<PixelConvertLevel>(nLevel));
+        total += Now() - begin;
+        checksum += work[work.size() / 3];
+    }
+    return total * 1000.0 / rounds;
+}
+
+static void RunFrame(int nWidth, int nHeight, int rounds, size_t& checksum)
+{
+    std::vector<unsigned int> frame, mask;
+    MakeFrame(frame, mask, nWidth, nHeight);
+    std::vector<unsigned int> work(frame.size());
+    printf("%dx%d\n", nWidth, nHeight);
+    for (int op = 0; op < OP_COUNT; ++op)
+    {
+        const double legacyMs = TimeOp(static_cast<FrameOp>(op), -1, frame, mask, work, nWidth, nHeight, rounds, checksum);
+        printf("  %-12s old loop %8.3f ms", kOpNames[op], legacyMs);
+        const int levels[] = { PIXEL_CONVERT_SCALAR, PIXEL_CONVERT_SSE2, PIXEL_CONVERT_AVX2 };
+        for (size_t k = 0; k < sizeof(levels) / sizeof(levels[0]); ++k)
+        {
+            // 超过 CPU 支持的级别会退回较低的实现，结果没有意义
+            if (levels[k] > GetPixelConvertLevel())
+            {
+                printf("   %s n/a", kLevelNames[levels[k]]);
+                continue;
+            }
+            const double ms = TimeOp(static_cast<FrameOp>(op), levels[k], frame, mask, work, nWidth, nHeight, rounds, checksum);
+            printf("   %s %8.3f ms (%4.1fx)", kLevelNames[levels[k]], ms, legacyMs / ms);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    printf("%d rounds, CPU level %s\n", rounds, kLevelNames[GetPixelConvertLevel()]);
+    size_t checksum = 0;
+    RunFrame(1920, 1080, rounds, checksum);
+    RunFrame(3840, 2160, rounds, checksum);
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
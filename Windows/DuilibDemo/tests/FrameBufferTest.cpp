@@ -0,0 +1,161 @@
+/*
+* Module:   FrameBufferTest
+*
+* Function: UIFrameBuffer 的矩形操作在各级实现下与原来 UIManager.cpp 中的逐像素循环逐字节相同，
+*           覆盖任意宽度、自底向上（负行距）的矩形，行距之外的像素不被改写
+*/
+#include "UIFrameBuffer.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+enum PixelOp
+{
+    OP_FILL,
+    OP_COPY,
+    OP_SET_OPAQUE,
+    OP_RESTORE_GDI_ALPHA,
+    OP_APPLY_MASK,
+    OP_COUNT,
+};
+
+// 透明、只有颜色、不透明和任意值都要出现
+static unsigned int RandomPixel(std::mt19937& rng)
+{
+    const unsigned int value = rng();
+    switch (value % 6)
+    {
+    case 0:
+        return 0;
+    case 1:
+        return value & 0x00FFFFFF;
+    case 2:
+        return value | 0xFF000000;
+    default:
+        return value;
+    }
+}
+
+// 原来的逐像素循环
+static unsigned int ReferencePixel(PixelOp op, unsigned int dwPixel, unsigned int dwOther, unsigned int dwFill)
+{
+    switch (op)
+    {
+    case OP_FILL:
+        return dwFill;
+    case OP_COPY:
+        return dwOther;
+    case OP_SET_OPAQUE:
+        return dwPixel != 0 ? dwPixel | 0xFF000000 : dwPixel;
+    case OP_RESTORE_GDI_ALPHA:
+        return (dwPixel >> 24) == 0 && (dwPixel & 0x00FFFFFF) != 0 ? dwPixel | 0xFF000000 : dwPixel;
+    default:
+    {
+        const unsigned int a = dwOther >> 24;
+        const unsigned int r = ((dwPixel >> 16) & 0xFF) * a / 255;
+        const unsigned int g = ((dwPixel >> 8) & 0xFF) * a / 255;
+        const unsigned int b = (dwPixel & 0xFF) * a / 255;
+        return (b | (g << 8) | (r << 16)) + (a << 24);
+    }
+    }
+}
+
+static void RunOp(PixelOp op, unsigned int* pTop, ptrdiff_t nPitch, const unsigned int* pOtherTop, int nWidth, int nHeight,
+    unsigned int dwFill, PixelConvertLevel eLevel)
+{
+    switch (op)
+    {
+    case OP_FILL:
+        FillPixels(pTop, nPitch, nWidth, nHeight, dwFill, eLevel);
+        break;
+    case OP_COPY:
+        CopyPixels(pTop, nPitch, pOtherTop, nPitch, nWidth, nHeight);
+        break;
+    case OP_SET_OPAQUE:
+        SetOpaqueIfNonZero(pTop, nPitch, nWidth, nHeight, eLevel);
+        break;
+    case OP_RESTORE_GDI_ALPHA:
+        RestoreGdiAlpha(pTop, nPitch, nWidth, nHeight, eLevel);
+        break;
+    default:
+        ApplyAlphaMask(pTop, nPitch, pOtherTop, nPitch, nWidth, nHeight, eLevel);
+        break;
+    }
+}
+
+static void TestMatchesReference()
+{
+    std::mt19937 rng(5);
+    for (int round = 0; round < 300; ++round)
+    {
+        const int nWidth = 1 + rng() % 70;
+        const int nHeight = 1 + rng() % 9;
+        const int nPitch = nWidth + rng() % 5;
+        const unsigned int dwFill = round % 2 != 0 ? 0 : 0x12345678u;
+        std::vector<unsigned int> base(nPitch * nHeight), other(nPitch * nHeight);
+        for (size_t i = 0; i < base.size(); ++i)
+        {
+            base[i] = RandomPixel(rng);
+            other[i] = RandomPixel(rng);
+        }
+
+        for (int op = 0; op < OP_COUNT; ++op)
+        {
+            for (int level = PIXEL_CONVERT_SCALAR; level <= PIXEL_CONVERT_AVX2; ++level)
+            {
+                // 自底向上的 DIB：第一行在内存的最后，行距为负
+                std::vector<unsigned int> out(base);
+                RunOp(static_cast<PixelOp>(op), &out[(nHeight - 1) * nPitch], -nPitch, &other[(nHeight - 1) * nPitch],
+                    nWidth, nHeight, dwFill, static_cast<PixelConvertLevel>(level));
+                for (int y = 0; y < nHeight; ++y)
+                {
+                    for (int x = 0; x < nPitch; ++x)
+                    {
+                        const size_t i = y * nPitch + x;
+                        const unsigned int expected = x < nWidth ?
+                            ReferencePixel(static_cast<PixelOp>(op), base[i], other[i], dwFill) : base[i];
+                        TEST_CHECK(out[i] == expected);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void TestAlphaMaskExhaustive()
+{
+    // 所有 (颜色, mask alpha) 组合，一行 8 个像素以走到 SIMD 的整块路径
+    for (unsigned int a = 0; a < 256; ++a)
+    {
+        for (unsigned int c = 0; c < 256; ++c)
+        {
+            const unsigned int dwPixel = c | (c << 8) | (c << 16) | ((255 - c) << 24);
+            const unsigned int dwMask = (a << 24) | 0x123456;
+            for (int level = PIXEL_CONVERT_SCALAR; level <= PIXEL_CONVERT_AVX2; ++level)
+            {
+                unsigned int pixels[8], masks[8];
+                for (int i = 0; i < 8; ++i)
+                {
+                    pixels[i] = dwPixel;
+                    masks[i] = dwMask;
+                }
+                ApplyAlphaMask(pixels, 8, masks, 8, 8, 1, static_cast<PixelConvertLevel>(level));
+                const unsigned int e = c * a / 255;
+                for (int i = 0; i < 8; ++i)
+                    TEST_CHECK(pixels[i] == ((a << 24) | (e << 16) | (e << 8) | e));
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestMatchesReference();
+    TestAlphaMaskExhaustive();
+    printf("FrameBufferTest passed\n");
+    return 0;
+}
@@ -0,0 +1,597 @@
+/*
+* Module:   GifFramesTest
+*
+* Function: CGifFrames 的解码与按 GIF 规范逐帧合成的参考实现对照：测试里带一个 GIF 编码器，生成含全局/局部调色板、
+*           透明色、隔行扫描、各种处置方式和没有图形控制扩展的帧的文件，逐帧逐字节比较。另外检查截断的文件
+*           保留已经完成的帧、按字节上限截断、Truncate、帧间隔，以及 Advance 在 GetTickCount 回绕前后的换帧
+*/
+#include "UIGifFrames.h"
+#include "UIPixelConvert.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+struct GifFrameSpec
+{
+    int left, top, width, height;
+    bool bGce;
+    int nDispose;                           // 0~7，只有 2、3 有作用
+    bool bTransparent;
+    int iTransparent;
+    int nDelay;                             // 1/100 秒
+    bool bInterlace;
+    std::vector<unsigned int> aLocalPalette; // 0xRRGGBB，空表示用全局调色板
+    std::vector<unsigned char> aIndices;    // 按显示顺序逐行
+};
+
+struct GifSpec
+{
+    int width, height;
+    int iBackground;
+    std::vector<unsigned int> aGlobalPalette;
+    std::vector<GifFrameSpec> aFrames;
+};
+
+static void Put16(std::vector<unsigned char>& out, int n)
+{
+    out.push_back(static_cast<unsigned char>(n & 0xFF));
+    out.push_back(static_cast<unsigned char>((n >> 8) & 0xFF));
+}
+
+// 调色板按 2 的幂补齐，返回 GIF 里的大小字段
+static int PutPalette(std::vector<unsigned char>& out, const std::vector<unsigned int>& aPalette)
+{
+    int nBits = 0;
+    while ((2 << nBits) < static_cast<int>(aPalette.size()))
+        ++nBits;
+    for (int i = 0; i < (2 << nBits); ++i)
+    {
+        const unsigned int c = i < static_cast<int>(aPalette.size()) ? aPalette[i] : 0;
+        out.push_back(static_cast<unsigned char>(c >> 16));
+        out.push_back(static_cast<unsigned char>(c >> 8));
+        out.push_back(static_cast<unsigned char>(c));
+    }
+    return nBits;
+}
+
+// 最小码长 8，码宽固定 9 位：每 200 个像素发一次清除码，字典不会长到要加宽
+static void PutRaster(std::vector<unsigned char>& out, const std::vector<unsigned char>& aIndices)
+{
+    std::vector<unsigned char> data;
+    unsigned int nBits = 0, nValid = 0;
+    auto emit = [&](unsigned int code) {
+        nBits |= code << nValid;
+        nValid += 9;
+        while (nValid >= 8)
+        {
+            data.push_back(static_cast<unsigned char>(nBits & 0xFF));
+            nBits >>= 8;
+            nValid -= 8;
+        }
+    };
+    for (size_t i = 0; i < aIndices.size(); ++i)
+    {
+        if (i % 200 == 0)
+            emit(256);
+        emit(aIndices[i]);
+    }
+    if (aIndices.empty())
+        emit(256);
+    emit(257);
+    if (nValid > 0)
+        data.push_back(static_cast<unsigned char>(nBits & 0xFF));
+
+    out.push_back(8);
+    for (size_t i = 0; i < data.size(); i += 255)
+    {
+        const size_t n = std::min<size_t>(255, data.size() - i);
+        out.push_back(static_cast<unsigned char>(n));
+        out.insert(out.end(), data.begin() + i, data.begin() + i + n);
+    }
+    out.push_back(0);
+}
+
+static std::vector<int> InterlacedRows(int height)
+{
+    std::vector<int> rows;
+    static const int kStart[] = { 0, 4, 2, 1 };
+    static const int kStep[] = { 8, 8, 4, 2 };
+    for (int pass = 0; pass < 4; ++pass)
+    {
+        for (int y = kStart[pass]; y < height; y += kStep[pass])
+            rows.push_back(y);
+    }
+    return rows;
+}
+
+// aFrameEnds 为每一帧数据结束（含块结束符）的位置
+static std::vector<unsigned char> EncodeGif(const GifSpec& spec, std::vector<size_t>* aFrameEnds = NULL)
+{
+    const char* pSignature = "GIF89a";
+    std::vector<unsigned char> out(pSignature, pSignature + 6);
+    Put16(out, spec.width);
+    Put16(out, spec.height);
+    const size_t iFlags = out.size();
+    out.push_back(0);
+    out.push_back(static_cast<unsigned char>(spec.iBackground));
+    out.push_back(0);
+    if (!spec.aGlobalPalette.empty())
+        out[iFlags] = static_cast<unsigned char>(0x80 | PutPalette(out, spec.aGlobalPalette));
+
+    for (size_t f = 0; f < spec.aFrames.size(); ++f)
+    {
+        const GifFrameSpec& frame = spec.aFrames[f];
+        if (frame.bGce)
+        {
+            out.push_back(0x21);
+            out.push_back(0xF9);
+            out.push_back(4);
+            out.push_back(static_cast<unsigned char>((frame.nDispose << 2) | (frame.bTransparent ? 1 : 0)));
+            Put16(out, frame.nDelay);
+            out.push_back(static_cast<unsigned char>(frame.iTransparent));
+            out.push_back(0);
+        }
+        out.push_back(0x2C);
+        Put16(out, frame.left);
+        Put16(out, frame.top);
+        Put16(out, frame.width);
+        Put16(out, frame.height);
+        const size_t iLocalFlags = out.size();
+        out.push_back(frame.bInterlace ? 0x40 : 0);
+        if (!frame.aLocalPalette.empty())
+            out[iLocalFlags] |= static_cast<unsigned char>(0x80 | PutPalette(out, frame.aLocalPalette));
+
+        std::vector<unsigned char> aStream;
+        if (frame.bInterlace)
+        {
+            const std::vector<int> rows = InterlacedRows(frame.height);
+            for (size_t i = 0; i < rows.size(); ++i)
+                aStream.insert(aStream.end(), frame.aIndices.begin() + rows[i] * frame.width,
+                    frame.aIndices.begin() + (rows[i] + 1) * frame.width);
+        }
+        else
+        {
+            aStream = frame.aIndices;
+        }
+        PutRaster(out, aStream);
+        if (aFrameEnds != NULL)
+            aFrameEnds->push_back(out.size());
+    }
+    out.push_back(0x3B);
+    return out;
+}
+
+// 按规范合成：画布开始全透明，背景色按透明处理；透明色只在带图形控制扩展且置了标志的那一帧有效；
+// 处置方式 2 把区域清成透明，3 恢复成画这一帧之前的画面，其他值不处置
+static std::vector<std::vector<unsigned char> > ComposeReference(const GifSpec& spec)
+{
+    std::vector<std::vector<unsigned char> > aResult;
+    const size_t nPixels = static_cast<size_t>(spec.width) * spec.height;
+    std::vector<unsigned char> canvas(nPixels * 4, 0);
+    for (size_t f = 0; f < spec.aFrames.size(); ++f)
+    {
+        const GifFrameSpec& frame = spec.aFrames[f];
+        const std::vector<unsigned int>& aPalette = frame.aLocalPalette.empty() ? spec.aGlobalPalette : frame.aLocalPalette;
+        const std::vector<unsigned char> before = canvas;
+        for (int y = 0; y < frame.height; ++y)
+        {
+            for (int x = 0; x < frame.width; ++x)
+            {
+                const int iIndex = frame.aIndices[y * frame.width + x];
+                if (frame.bGce && frame.bTransparent && iIndex == frame.iTransparent)
+                    continue;
+                unsigned char* p = &canvas[((frame.top + y) * spec.width + frame.left + x) * 4];
+                p[0] = static_cast<unsigned char>(aPalette[iIndex] >> 16);
+                p[1] = static_cast<unsigned char>(aPalette[iIndex] >> 8);
+                p[2] = static_cast<unsigned char>(aPalette[iIndex]);
+                p[3] = 255;
+            }
+        }
+        std::vector<unsigned char> bgra(nPixels * 4);
+        ConvertToPremultipliedBGRA(&canvas[0], &bgra[0], nPixels, 0);
+        aResult.push_back(bgra);
+
+        const int nDispose = frame.bGce ? frame.nDispose : 0;
+        if (nDispose != 2 && nDispose != 3)
+            continue;
+        for (int y = frame.top; y < frame.top + frame.height; ++y)
+        {
+            const size_t iOffset = (static_cast<size_t>(y) * spec.width + frame.left) * 4;
+            if (nDispose == 2)
+                memset(&canvas[iOffset], 0, frame.width * 4);
+            else
+                memcpy(&canvas[iOffset], &before[iOffset], frame.width * 4);
+        }
+    }
+    return aResult;
+}
+
+static unsigned int ReferenceDelay(const GifFrameSpec& frame)
+{
+    const unsigned int nDelay = frame.bGce ? static_cast<unsigned int>(frame.nDelay) * 10 : 0;
+    return nDelay == 0 ? 100 : nDelay;
+}
+
+static bool SameFrame(const CGifFrames& frames, int iFrame, const std::vector<unsigned char>& expected)
+{
+    const unsigned char* pBits = frames.GetFrameBits(iFrame);
+    return pBits != NULL && memcmp(pBits, &expected[0], expected.size()) == 0;
+}
+
+static GifFrameSpec SolidFrame(int left, int top, int width, int height, unsigned char iIndex)
+{
+    GifFrameSpec frame;
+    frame.left = left;
+    frame.top = top;
+    frame.width = width;
+    frame.height = height;
+    frame.bGce = true;
+    frame.nDispose = 1;
+    frame.bTransparent = false;
+    frame.iTransparent = 0;
+    frame.nDelay = 5;
+    frame.bInterlace = false;
+    frame.aIndices.assign(static_cast<size_t>(width) * height, iIndex);
+    return frame;
+}
+
+static GifSpec SmallSpec()
+{
+    GifSpec spec;
+    spec.width = 4;
+    spec.height = 4;
+    spec.iBackground = 3;
+    spec.aGlobalPalette.push_back(0xFF0000);
+    spec.aGlobalPalette.push_back(0x00FF00);
+    spec.aGlobalPalette.push_back(0x0000FF);
+    spec.aGlobalPalette.push_back(0xFFFFFF);
+    return spec;
+}
+
+// 像素 (x, y) 的 BGRA
+static unsigned int PixelAt(const CGifFrames& frames, int iFrame, int x, int y)
+{
+    const unsigned char* p = frames.GetFrameBits(iFrame) + (y * frames.GetWidth() + x) * 4;
+    return static_cast<unsigned int>(p[0]) | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned int>(p[3]) << 24);
+}
+
+static const unsigned int kRed = 0xFFFF0000;
+static const unsigned int kGreen = 0xFF00FF00;
+static const unsigned int kBlue = 0xFF0000FF;
+
+static void TestDisposeModes()
+{
+    // 整幅红色，中间 2x2 画绿色并按 nDispose 处置，再在左上角画一个蓝色像素
+    const int aExpected[][2] = { { 0, 0 }, { 1, 0 }, { 2, 1 }, { 3, 2 }, { 4, 0 } };
+    for (size_t i = 0; i < sizeof(aExpected) / sizeof(aExpected[0]); ++i)
+    {
+        GifSpec spec = SmallSpec();
+        spec.aFrames.push_back(SolidFrame(0, 0, 4, 4, 0));
+        spec.aFrames.push_back(SolidFrame(1, 1, 2, 2, 1));
+        spec.aFrames.back().nDispose = aExpected[i][0];
+        spec.aFrames.push_back(SolidFrame(0, 0, 1, 1, 2));
+        const std::vector<unsigned char> data = EncodeGif(spec);
+        CGifFrames frames;
+        TEST_CHECK(frames.Decode(&data[0], data.size()));
+        TEST_CHECK(frames.GetFrameCount() == 3);
+        TEST_CHECK(PixelAt(frames, 1, 1, 1) == kGreen);
+        TEST_CHECK(PixelAt(frames, 2, 0, 0) == kBlue);
+        TEST_CHECK(PixelAt(frames, 2, 3, 3) == kRed);
+        // 0 和未定义的值都不处置；2 清成透明；3 恢复成红色
+        const unsigned int nCenter = PixelAt(frames, 2, 1, 1);
+        if (aExpected[i][1] == 1)
+            TEST_CHECK(nCenter == 0);
+        else if (aExpected[i][1] == 2)
+            TEST_CHECK(nCenter == kRed);
+        else
+            TEST_CHECK(nCenter == kGreen);
+        TEST_CHECK(!frames.HasAlpha() || aExpected[i][1] == 1);
+    }
+
+    // 第一帧就“恢复到前一帧”：恢复成透明
+    GifSpec spec = SmallSpec();
+    spec.aFrames.push_back(SolidFrame(0, 0, 2, 2, 0));
+    spec.aFrames.back().nDispose = 3;
+    spec.aFrames.push_back(SolidFrame(3, 3, 1, 1, 1));
+    const std::vector<unsigned char> data = EncodeGif(spec);
+    CGifFrames frames;
+    TEST_CHECK(frames.Decode(&data[0], data.size()));
+    TEST_CHECK(PixelAt(frames, 0, 0, 0) == kRed);
+    TEST_CHECK(PixelAt(frames, 1, 0, 0) == 0);
+    TEST_CHECK(PixelAt(frames, 1, 3, 3) == kGreen);
+    TEST_CHECK(frames.HasAlpha());
+}
+
+static void TestTransparency()
+{
+    // 第二帧的透明色是 0，第三帧没有图形控制扩展，同一个索引要画出来
+    GifSpec spec = SmallSpec();
+    spec.aFrames.push_back(SolidFrame(0, 0, 4, 4, 1));
+    spec.aFrames.push_back(SolidFrame(0, 0, 4, 4, 0));
+    spec.aFrames.back().bTransparent = true;
+    spec.aFrames.back().iTransparent = 0;
+    spec.aFrames.back().aIndices[5] = 2;
+    spec.aFrames.push_back(SolidFrame(0, 0, 2, 1, 0));
+    spec.aFrames.back().bGce = false;
+    const std::vector<unsigned char> data = EncodeGif(spec);
+    CGifFrames frames;
+    TEST_CHECK(frames.Decode(&data[0], data.size()));
+    TEST_CHECK(frames.GetFrameCount() == 3);
+    TEST_CHECK(PixelAt(frames, 1, 0, 0) == kGreen);
+    TEST_CHECK(PixelAt(frames, 1, 1, 1) == kBlue);
+    TEST_CHECK(PixelAt(frames, 2, 0, 0) == kRed);
+    TEST_CHECK(PixelAt(frames, 2, 1, 1) == kBlue);
+    TEST_CHECK(PixelAt(frames, 2, 3, 3) == kGreen);
+    // 没有图形控制扩展的帧间隔按 100 毫秒
+    TEST_CHECK(frames.GetFrameDelay(0) == 50);
+    TEST_CHECK(frames.GetFrameDelay(2) == 100);
+    TEST_CHECK(frames.GetDuration() == 200);
+    TEST_CHECK(!frames.HasAlpha());
+
+    // 局部调色板的透明色
+    GifSpec local = SmallSpec();
+    local.aGlobalPalette.clear();
+    local.aFrames.push_back(SolidFrame(0, 0, 4, 4, 1));
+    local.aFrames.back().aLocalPalette = SmallSpec().aGlobalPalette;
+    local.aFrames.back().bTransparent = true;
+    local.aFrames.back().iTransparent = 1;
+    local.aFrames.back().aIndices[0] = 2;
+    const std::vector<unsigned char> localData = EncodeGif(local);
+    TEST_CHECK(frames.Decode(&localData[0], localData.size()));
+    TEST_CHECK(PixelAt(frames, 0, 0, 0) == kBlue);
+    TEST_CHECK(PixelAt(frames, 0, 1, 0) == 0);
+    TEST_CHECK(frames.HasAlpha());
+}
+
+static void TestInterlace()
+{
+    // 同样的内容隔行和不隔行存放，解出来要一样；13 行覆盖四遍扫描都不满的情况
+    std::mt19937 rng(7);
+    GifSpec spec = SmallSpec();
+    spec.width = 5;
+    spec.height = 13;
+    spec.aFrames.push_back(SolidFrame(0, 0, 5, 13, 0));
+    for (size_t i = 0; i < spec.aFrames[0].aIndices.size(); ++i)
+        spec.aFrames[0].aIndices[i] = static_cast<unsigned char>(rng() % 4);
+    GifSpec interlaced = spec;
+    interlaced.aFrames[0].bInterlace = true;
+    const std::vector<unsigned char> plain = EncodeGif(spec);
+    const std::vector<unsigned char> data = EncodeGif(interlaced);
+    TEST_CHECK(plain != data);
+    CGifFrames a, b;
+    TEST_CHECK(a.Decode(&plain[0], plain.size()));
+    TEST_CHECK(b.Decode(&data[0], data.size()));
+    TEST_CHECK(memcmp(a.GetPixels(), b.GetPixels(), 5 * 13 * 4) == 0);
+    TEST_CHECK(SameFrame(b, 0, ComposeReference(interlaced)[0]));
+}
+
+static void RandomPalette(std::mt19937& rng, std::vector<unsigned int>& aPalette)
+{
+    const int nSize = 2 << (rng() % 8);
+    aPalette.resize(rng() % nSize + 1);
+    for (size_t i = 0; i < aPalette.size(); ++i)
+        aPalette[i] = rng() & 0xFFFFFF;
+}
+
+static GifSpec RandomSpec(std::mt19937& rng)
+{
+    GifSpec spec;
+    spec.width = static_cast<int>(rng() % 24) + 1;
+    spec.height = static_cast<int>(rng() % 24) + 1;
+    spec.iBackground = static_cast<int>(rng() % 256);
+    if (rng() % 5 != 0)
+        RandomPalette(rng, spec.aGlobalPalette);
+    const int nFrames = static_cast<int>(rng() % 5) + 1;
+    for (int f = 0; f < nFrames; ++f)
+    {
+        GifFrameSpec frame;
+        frame.left = static_cast<int>(rng() % spec.width);
+        frame.top = static_cast<int>(rng() % spec.height);
+        frame.width = static_cast<int>(rng() % (spec.width - frame.left)) + 1;
+        frame.height = static_cast<int>(rng() % (spec.height - frame.top)) + 1;
+        frame.bGce = rng() % 10 < 7;
+        frame.nDispose = static_cast<int>(rng() % 8);
+        frame.bTransparent = rng() % 2 == 0;
+        frame.nDelay = static_cast<int>(rng() % 20);
+        frame.bInterlace = rng() % 10 < 3;
+        if (spec.aGlobalPalette.empty() || rng() % 10 < 4)
+            RandomPalette(rng, frame.aLocalPalette);
+        const size_t nColors = (frame.aLocalPalette.empty() ? spec.aGlobalPalette : frame.aLocalPalette).size();
+        frame.iTransparent = static_cast<int>(rng() % nColors);
+        frame.aIndices.resize(static_cast<size_t>(frame.width) * frame.height);
+        for (size_t i = 0; i < frame.aIndices.size(); ++i)
+        {
+            // 透明色多出现一些
+            frame.aIndices[i] = static_cast<unsigned char>(rng() % 3 == 0 ? frame.iTransparent : rng() % nColors);
+        }
+        spec.aFrames.push_back(frame);
+    }
+    return spec;
+}
+
+static void TestRandomAgainstReference()
+{
+    std::mt19937 rng(20240611);
+    for (int run = 0; run < 600; ++run)
+    {
+        const GifSpec spec = RandomSpec(rng);
+        const std::vector<unsigned char> data = EncodeGif(spec);
+        const std::vector<std::vector<unsigned char> > expected = ComposeReference(spec);
+        CGifFrames frames;
+        TEST_CHECK(frames.Decode(&data[0], data.size()));
+        TEST_CHECK(frames.GetWidth() == spec.width && frames.GetHeight() == spec.height);
+        TEST_CHECK(frames.GetFrameCount() == static_cast<int>(spec.aFrames.size()));
+        unsigned int nDuration = 0;
+        for (size_t f = 0; f < expected.size(); ++f)
+        {
+            if (!SameFrame(frames, static_cast<int>(f), expected[f]))
+                fprintf(stderr, "run %d frame %zu differs\n", run, f);
+            TEST_CHECK(SameFrame(frames, static_cast<int>(f), expected[f]));
+            TEST_CHECK(frames.GetFrameDelay(static_cast<int>(f)) == ReferenceDelay(spec.aFrames[f]));
+            nDuration += ReferenceDelay(spec.aFrames[f]);
+        }
+        TEST_CHECK(frames.GetDuration() == nDuration);
+    }
+}
+
+static void TestTruncated()
+{
+    std::mt19937 rng(99);
+    for (int run = 0; run < 40; ++run)
+    {
+        GifSpec spec = RandomSpec(rng);
+        while (spec.aFrames.size() < 3)
+            spec.aFrames.push_back(spec.aFrames.back());
+        std::vector<size_t> aFrameEnds;
+        const std::vector<unsigned char> data = EncodeGif(spec, &aFrameEnds);
+        const std::vector<std::vector<unsigned char> > expected = ComposeReference(spec);
+        for (size_t nCut = 0; nCut < data.size(); ++nCut)
+        {
+            // 截断的部分单独放一块内存，越界读能被 ASan 发现
+            std::vector<unsigned char> part(data.begin(), data.begin() + nCut);
+            CGifFrames frames;
+            const bool bOk = frames.Decode(part.empty() ? NULL : &part[0], part.size());
+            int nComplete = 0;
+            while (nComplete < static_cast<int>(aFrameEnds.size()) && aFrameEnds[nComplete] <= nCut)
+                ++nComplete;
+            if (nComplete > 0)
+                TEST_CHECK(bOk);
+            if (!bOk)
+            {
+                TEST_CHECK(frames.GetFrameCount() == 0 && frames.GetPixels() == NULL);
+                continue;
+            }
+            // 最后一帧可能只解出一部分，前面完整的帧都要和参考一致
+            TEST_CHECK(frames.GetFrameCount() >= nComplete);
+            for (int f = 0; f < nComplete; ++f)
+                TEST_CHECK(SameFrame(frames, f, expected[f]));
+        }
+    }
+
+    CGifFrames frames;
+    const unsigned char png[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 0, 0, 0, 0x0D, 'I', 'H', 'D', 'R' };
+    TEST_CHECK(!frames.Decode(png, sizeof(png)));
+    const unsigned char empty[] = { 'G', 'I', 'F', '8', '9', 'a', 0, 0, 1, 0, 0, 0, 0, 0x3B };
+    TEST_CHECK(!frames.Decode(empty, sizeof(empty)));
+}
+
+static void TestByteLimitAndTruncate()
+{
+    GifSpec spec = SmallSpec();
+    for (int i = 0; i < 5; ++i)
+    {
+        spec.aFrames.push_back(SolidFrame(0, 0, 4, 4, static_cast<unsigned char>(i % 3)));
+        spec.aFrames.back().nDelay = i + 1;
+    }
+    const std::vector<unsigned char> data = EncodeGif(spec);
+    const std::vector<std::vector<unsigned char> > expected = ComposeReference(spec);
+    const size_t nFrameBytes = 4 * 4 * 4;
+
+    CGifFrames frames;
+    TEST_CHECK(frames.Decode(&data[0], data.size(), nFrameBytes * 2 + 10));
+    TEST_CHECK(frames.GetFrameCount() == 2);
+    TEST_CHECK(frames.GetDuration() == 30);
+    TEST_CHECK(!frames.Decode(&data[0], data.size(), nFrameBytes - 1));
+
+    TEST_CHECK(frames.Decode(&data[0], data.size()));
+    TEST_CHECK(frames.GetFrameCount() == 5 && frames.GetDuration() == 150);
+    frames.Truncate(7);
+    TEST_CHECK(frames.GetFrameCount() == 5);
+    frames.Truncate(3);
+    TEST_CHECK(frames.GetFrameCount() == 3);
+    TEST_CHECK(frames.GetDuration() == 60);
+    TEST_CHECK(frames.GetFrameBits(3) == NULL);
+    for (int f = 0; f < 3; ++f)
+        TEST_CHECK(SameFrame(frames, f, expected[f]));
+    // 像素已经复制到位图之后也能截断
+    frames.FreePixels();
+    frames.Truncate(1);
+    TEST_CHECK(frames.GetFrameCount() == 1 && frames.GetDuration() == 10 && frames.GetPixels() == NULL);
+    frames.Truncate(0);
+    TEST_CHECK(frames.GetFrameCount() == 0 && frames.GetWidth() == 0);
+
+    const unsigned char rgba[] = { 255, 0, 0, 255, 0, 0, 255, 0 };
+    TEST_CHECK(frames.Assign(rgba, 2, 1));
+    TEST_CHECK(frames.GetFrameCount() == 1 && frames.GetFrameDelay(0) == 100 && frames.HasAlpha());
+    TEST_CHECK(PixelAt(frames, 0, 0, 0) == kRed && PixelAt(frames, 0, 1, 0) == 0);
+}
+
+static void TestAdvance()
+{
+    GifSpec spec = SmallSpec();
+    const int aDelays[] = { 10, 5, 20 };
+    for (int i = 0; i < 3; ++i)
+    {
+        spec.aFrames.push_back(SolidFrame(0, 0, 1, 1, 0));
+        spec.aFrames.back().nDelay = aDelays[i];
+    }
+    const std::vector<unsigned char> data = EncodeGif(spec);
+    CGifFrames frames;
+    TEST_CHECK(frames.Decode(&data[0], data.size()));
+    TEST_CHECK(frames.GetDuration() == 350);
+
+    // 没到期不换帧
+    int iFrame = 0;
+    TEST_CHECK(frames.Advance(iFrame, 1000, 999) == 1000 && iFrame == 0);
+    // 到期换下一帧，到期时间从原来的到期时间算起
+    TEST_CHECK(frames.Advance(iFrame, 1000, 1000) == 1050 && iFrame == 1);
+    // 晚了 60 毫秒，第 2 帧（50 毫秒）已经过期，直接到第 3 帧
+    iFrame = 0;
+    TEST_CHECK(frames.Advance(iFrame, 1000, 1060) == 1250 && iFrame == 2);
+    // 落后超过一轮不追赶，从现在开始显示下一帧
+    iFrame = 0;
+    TEST_CHECK(frames.Advance(iFrame, 1000, 1000 + 350) == 1400 && iFrame == 1);
+    // 越界的帧号从第一帧开始
+    iFrame = 7;
+    TEST_CHECK(frames.Advance(iFrame, 1000, 1000) == 1050 && iFrame == 1);
+
+    // GetTickCount 回绕：到期时间在回绕前，现在在回绕后
+    iFrame = 0;
+    unsigned int nDue = frames.Advance(iFrame, 0xFFFFFFF0u, 0x00000020u);
+    TEST_CHECK(iFrame == 1 && nDue == 0x00000022u);
+    TEST_CHECK(frames.Advance(iFrame, nDue, 0x00000021u) == nDue && iFrame == 1);
+    nDue = frames.Advance(iFrame, nDue, 0x00000022u);
+    TEST_CHECK(iFrame == 2 && nDue == 0x00000022u + 200);
+    // 到期时间在回绕后，现在还在回绕前：没有到期
+    iFrame = 0;
+    TEST_CHECK(frames.Advance(iFrame, 0x00000010u, 0xFFFFFFF0u) == 0x00000010u && iFrame == 0);
+
+    // 随机的定时器延迟（都小于一轮），帧号始终和从开始经过的时间对得上，跨过回绕
+    std::mt19937 rng(5);
+    const unsigned long long nStart = 0xFFFFFFFFull - 5000;
+    unsigned long long nNow = nStart;
+    iFrame = 0;
+    nDue = static_cast<unsigned int>(nStart + 100);
+    for (int step = 0; step < 2000; ++step)
+    {
+        nNow += rng() % 120;
+        nDue = frames.Advance(iFrame, nDue, static_cast<unsigned int>(nNow));
+        unsigned long long nElapsed = (nNow - nStart) % 350;
+        const int iExpected = nElapsed < 100 ? 0 : (nElapsed < 150 ? 1 : 2);
+        TEST_CHECK(iFrame == iExpected);
+        TEST_CHECK(static_cast<int>(nDue - static_cast<unsigned int>(nNow)) > 0);
+    }
+    TEST_CHECK(nNow > 0xFFFFFFFFull);
+
+    CGifFrames none;
+    iFrame = 3;
+    TEST_CHECK(none.Advance(iFrame, 10, 20) == 20 && iFrame == 0);
+}
+
+int main()
+{
+    TestDisposeModes();
+    TestTransparency();
+    TestInterlace();
+    TestRandomAgainstReference();
+    TestTruncated();
+    TestByteLimitAndTruncate();
+    TestAdvance();
+    printf("GifFramesTest passed\n");
+    return 0;
+}
@@ -0,0 +1,781 @@
+/*
+* Module:   HtmlTextTest
+*
+* Function: CHtmlTextLayoutT 与 CHtmlTextCacheT 的测试。用模拟的 IHtmlTextHostT 代替 GDI：等宽字体（宽度、
+*           行高按字体固定），派生字体按粗体/下划线/斜体复用，两张固定尺寸的图片。检查 b/c/a/f/n/p/x/y 标签、
+*           行内底部对齐、折行和行尾省略号、对齐和 CALCRECT、链接区域和内容（含跨行和数组已满），
+*           以及缓存的 LRU 淘汰、容量、Clear 和 key 的区分
+*/
+#include "UIHtmlText.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <deque>
+#include <string>
+
+using namespace DuiLib;
+
+typedef CHtmlTextLayoutT<wchar_t> Layout;
+typedef CHtmlTextCacheT<wchar_t> Cache;
+
+struct MockFont
+{
+    std::wstring sName;
+    int nSize;
+    int nHeight;
+    int nWidth;
+    bool bBold;
+    bool bUnderline;
+    bool bItalic;
+};
+
+// 字体 0：行高 16、字宽 6；字体 1：行高 24、字宽 10；按名字创建的字体行高为 nSize + 4、字宽为 nSize / 2。
+// 粗体字宽加 2。图片 smile.png 为 20x30，list.png 为 80x10（4 张的图片列表）
+class MockHost : public IHtmlTextHostT<wchar_t>
+{
+public:
+    MockHost() : nMeasureCalls(0), nLastSize(0), bLastBold(false), bLastUnderline(false), bLastItalic(false)
+    {
+        pFont0 = AddFont(L"", 0, 16, 6, false, false, false);
+        pFont1 = AddFont(L"", 0, 24, 10, false, false, false);
+    }
+
+    virtual void* GetFont(int iFont)
+    {
+        return iFont == 1 ? pFont1 : pFont0;
+    }
+
+    virtual void* GetFont(const wchar_t* pstrName, int nSize, bool bBold, bool bUnderline, bool bItalic)
+    {
+        sLastName = pstrName;
+        nLastSize = nSize;
+        bLastBold = bBold;
+        bLastUnderline = bUnderline;
+        bLastItalic = bItalic;
+        return FindOrAdd(pstrName, nSize, nSize + 4, nSize / 2, bBold, bUnderline, bItalic);
+    }
+
+    virtual void* DeriveFont(void* pFont, bool bBold, bool bUnderline, bool bItalic)
+    {
+        const MockFont* pBase = static_cast<MockFont*>(pFont);
+        int nWidth = pBase->nWidth - (pBase->bBold ? 2 : 0) + (bBold ? 2 : 0);
+        return FindOrAdd(pBase->sName, pBase->nSize, pBase->nHeight, nWidth, bBold, bUnderline, bItalic);
+    }
+
+    virtual void GetFontMetrics(void* pFont, THtmlFontMetrics& tm)
+    {
+        const MockFont* p = static_cast<MockFont*>(pFont);
+        tm.nHeight = p->nHeight;
+        tm.nExternalLeading = 0;
+        tm.nMaxCharWidth = p->nWidth;
+        tm.bItalicFace = p->bItalic;
+        tm.bBold = p->bBold;
+        tm.bUnderline = p->bUnderline;
+        tm.bItalic = p->bItalic;
+    }
+
+    virtual int MeasureText(void* pFont, const wchar_t* pstrText, int cchText)
+    {
+        (void)pstrText;
+        ++nMeasureCalls;
+        return cchText * static_cast<MockFont*>(pFont)->nWidth;
+    }
+
+    virtual int GetSpaceOverhang(void* pFont)
+    {
+        return static_cast<MockFont*>(pFont)->bItalic ? 4 : 0;
+    }
+
+    virtual void* GetImage(const wchar_t* pstrName, const wchar_t* pstrType, int& cx, int& cy)
+    {
+        sLastImageType = pstrType != NULL ? pstrType : L"(null)";
+        if (std::wstring(pstrName) == L"smile.png")
+        {
+            cx = 20;
+            cy = 30;
+            return &nImageSmile;
+        }
+        if (std::wstring(pstrName) == L"list.png")
+        {
+            cx = 80;
+            cy = 10;
+            return &nImageList;
+        }
+        return NULL;
+    }
+
+    virtual const wchar_t* CharNext(const wchar_t* p)
+    {
+        return *p != L'\0' ? p + 1 : p;
+    }
+
+    virtual const wchar_t* CharPrev(const wchar_t* pStart, const wchar_t* p)
+    {
+        return p > pStart ? p - 1 : pStart;
+    }
+
+private:
+    MockFont* AddFont(const std::wstring& sName, int nSize, int nHeight, int nWidth, bool bBold, bool bUnderline, bool bItalic)
+    {
+        MockFont font = { sName, nSize, nHeight, nWidth, bBold, bUnderline, bItalic };
+        m_fonts.push_back(font);
+        return &m_fonts.back();
+    }
+
+    MockFont* FindOrAdd(const std::wstring& sName, int nSize, int nHeight, int nWidth, bool bBold, bool bUnderline, bool bItalic)
+    {
+        for (size_t i = 0; i < m_fonts.size(); ++i)
+        {
+            MockFont& f = m_fonts[i];
+            if (f.sName == sName && f.nSize == nSize && f.nHeight == nHeight && f.nWidth == nWidth
+                && f.bBold == bBold && f.bUnderline == bUnderline && f.bItalic == bItalic)
+                return &f;
+        }
+        return AddFont(sName, nSize, nHeight, nWidth, bBold, bUnderline, bItalic);
+    }
+
+public:
+    MockFont* pFont0;
+    MockFont* pFont1;
+    int nMeasureCalls;
+    std::wstring sLastName;
+    int nLastSize;
+    bool bLastBold;
+    bool bLastUnderline;
+    bool bLastItalic;
+    std::wstring sLastImageType;
+    int nImageSmile;
+    int nImageList;
+
+private:
+    std::deque<MockFont> m_fonts; // deque 追加时不移动已有的字体
+};
+
+static bool SameRect(const TLayoutRect& rc, int left, int top, int right, int bottom)
+{
+    return rc.left == left && rc.top == top && rc.right == right && rc.bottom == bottom;
+}
+
+static std::wstring RunText(const wchar_t* pstrText, const Layout::Run& run)
+{
+    return std::wstring(pstrText + run.iText, run.cchText);
+}
+
+static bool IsTextRun(const Layout& layout, size_t i, const wchar_t* pstrText, const wchar_t* pstrRun, int x, int y)
+{
+    if (i >= layout.aRuns.size())
+        return false;
+    const Layout::Run& run = layout.aRuns[i];
+    return run.nType == HTMLTEXT_RUN_TEXT && run.x == x && run.y == y && RunText(pstrText, run) == pstrRun;
+}
+
+static const MockFont* RunFont(const Layout& layout, size_t i)
+{
+    return static_cast<const MockFont*>(layout.aRuns[i].pFont);
+}
+
+static const Layout::Color& RunColor(const Layout& layout, size_t i)
+{
+    return layout.aColors[layout.aRuns[i].iColor];
+}
+
+static void TestPlainText()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"ab cd";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    // 空格不打断文字，整段是一个 run
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab cd", 0, 0));
+    TEST_CHECK(RunFont(layout, 0) == host.pFont0);
+    TEST_CHECK(RunColor(layout, 0).nType == HTMLTEXT_COLOR_DEFAULT);
+    TEST_CHECK(layout.cxMaxWidth == 30);
+    TEST_CHECK(layout.cyLastLine == 16);
+    TEST_CHECK(layout.cyMinHeight == HTMLTEXT_ZERO);
+    TEST_CHECK(layout.nLinks == 0);
+    TEST_CHECK(SameRect(layout.rc, 0, 0, 100, 50));
+
+    // 空文字和空 host 什么也不输出
+    layout.Build(&host, L"", 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.empty());
+    layout.Build(NULL, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.empty());
+}
+
+static void TestBold()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"a<b>b</b>c";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 3);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"a", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"b", 6, 0));
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L"c", 14, 0));
+    TEST_CHECK(RunFont(layout, 0) == host.pFont0);
+    TEST_CHECK(RunFont(layout, 1)->bBold && RunFont(layout, 1)->nWidth == 8);
+    TEST_CHECK(RunFont(layout, 1) == host.DeriveFont(host.pFont0, true, false, false));
+    TEST_CHECK(RunFont(layout, 2) == host.pFont0);
+    TEST_CHECK(layout.cxMaxWidth == 20);
+
+    // 已经是粗体时 <b> 不再压入字体，</b> 弹出外层的字体
+    pstrText = L"<b>a<b>b</b>c</b>d";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 4);
+    TEST_CHECK(RunFont(layout, 0)->bBold);
+    TEST_CHECK(RunFont(layout, 1)->bBold);
+    TEST_CHECK(RunFont(layout, 2) == host.pFont0);
+    TEST_CHECK(RunFont(layout, 3) == host.pFont0);
+}
+
+static void TestColor()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"<c #FF0000>r</c>d{c 00ff00}g{/c}";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 3);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"r", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"d", 6, 0));
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L"g", 12, 0));
+    TEST_CHECK(RunColor(layout, 0).nType == HTMLTEXT_COLOR_VALUE && RunColor(layout, 0).dwColor == 0xFF0000);
+    TEST_CHECK(RunColor(layout, 1).nType == HTMLTEXT_COLOR_DEFAULT);
+    TEST_CHECK(RunColor(layout, 2).nType == HTMLTEXT_COLOR_VALUE && RunColor(layout, 2).dwColor == 0x00FF00);
+
+    // 嵌套的颜色按栈恢复，相邻的相同颜色共用一项
+    pstrText = L"<c 1>a<c 2>b</c>c</c>d";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 4);
+    TEST_CHECK(RunColor(layout, 0).dwColor == 1);
+    TEST_CHECK(RunColor(layout, 1).dwColor == 2);
+    TEST_CHECK(RunColor(layout, 2).dwColor == 1);
+    TEST_CHECK(RunColor(layout, 3).nType == HTMLTEXT_COLOR_DEFAULT);
+    TEST_CHECK(layout.aColors.size() == 4);
+    pstrText = L"<c 5>a</c><c 5>b</c>";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(layout.aRuns[0].iColor == layout.aRuns[1].iColor);
+    TEST_CHECK(layout.aColors.size() == 1);
+}
+
+static void TestFont()
+{
+    MockHost host;
+    // 按编号的字体，行内图文底部对齐
+    const wchar_t* pstrText = L"a<f 1>B</f>c";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 3);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"a", 0, 8));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"B", 6, 0));
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L"c", 16, 8));
+    TEST_CHECK(RunFont(layout, 1) == host.pFont1);
+    TEST_CHECK(RunFont(layout, 2) == host.pFont0);
+    TEST_CHECK(layout.cyLastLine == 24);
+
+    // 按名字、大小和属性的字体，属性不区分大小写
+    pstrText = L"<f Arial 20 Bold Italic>x</f>";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(host.sLastName == L"Arial");
+    TEST_CHECK(host.nLastSize == 20);
+    TEST_CHECK(host.bLastBold && !host.bLastUnderline && host.bLastItalic);
+    TEST_CHECK(RunFont(layout, 0)->sName == L"Arial" && RunFont(layout, 0)->nHeight == 24);
+    TEST_CHECK(layout.cyLastLine == 24);
+
+    // 没有大小时为 10
+    layout.Build(&host, L"<f Tahoma underline>x</f>", 100, 50, 0, 0, 0);
+    TEST_CHECK(host.sLastName == L"Tahoma");
+    TEST_CHECK(host.nLastSize == 10);
+    TEST_CHECK(!host.bLastBold && host.bLastUnderline && !host.bLastItalic);
+
+    // <f 1> 中的粗体从字体 1 派生
+    pstrText = L"<f 1><b>x</b></f>";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(RunFont(layout, 0)->bBold && RunFont(layout, 0)->nHeight == 24 && RunFont(layout, 0)->nWidth == 12);
+}
+
+static void TestNewlineAndParagraph()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"ab<n>cd";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd", 0, 16));
+    TEST_CHECK(layout.cyLastLine == 32);
+
+    // '\n' 与 <n> 相同
+    pstrText = L"ab\ncd";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd", 0, 16));
+
+    // 单行时 <n> 不换行
+    pstrText = L"ab<n>cd";
+    layout.Build(&host, pstrText, 100, 50, 0, HTMLTEXT_SINGLELINE, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd", 12, 0));
+
+    // <p> 增加行高，已有文字时另起一行，</p> 之后也另起一行
+    pstrText = L"<p 4>ab</p>cd";
+    layout.Build(&host, pstrText, 100, 80, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 4));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd", 0, 20));
+    TEST_CHECK(layout.cyLastLine == 36);
+    // 行中间的 <p> 同时增加了已有文字这一行的行高
+    pstrText = L"ab<p 2>cd";
+    layout.Build(&host, pstrText, 100, 80, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 2));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd", 0, 20));
+}
+
+static void TestIndent()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"a<x 10>b";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"b", 16, 0));
+    TEST_CHECK(layout.cxMaxWidth == 22);
+
+    // <y> 直接设置这一行的行高，文字底部对齐
+    pstrText = L"<y 30>ab<n>cd";
+    layout.Build(&host, pstrText, 100, 80, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 14));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd", 0, 30));
+    TEST_CHECK(layout.cyLastLine == 46);
+}
+
+static void TestImage()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"ab<i smile.png>c";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 3);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 14));
+    const Layout::Run& image = layout.aRuns[1];
+    TEST_CHECK(image.nType == HTMLTEXT_RUN_IMAGE);
+    TEST_CHECK(image.pImage == &host.nImageSmile);
+    TEST_CHECK(SameRect(image.rcImage, 12, 0, 32, 30));
+    TEST_CHECK(SameRect(image.rcBmpPart, 0, 0, 20, 30));
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L"c", 32, 14));
+    TEST_CHECK(layout.cyMinHeight == 30);
+    TEST_CHECK(host.sLastImageType == L"(null)");
+
+    // 图片列表取第 3 张，比行高矮的图片垂直居中
+    layout.Build(&host, L"<y 20><i list.png 4 2>", 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(layout.aRuns[0].pImage == &host.nImageList);
+    TEST_CHECK(SameRect(layout.aRuns[0].rcImage, 0, 5, 20, 15));
+    TEST_CHECK(SameRect(layout.aRuns[0].rcBmpPart, 40, 0, 60, 10));
+
+    // file=' ' 的写法带资源类型
+    layout.Build(&host, L"<i file='smile.png' restype='PNG'>", 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(layout.aRuns[0].pImage == &host.nImageSmile);
+    TEST_CHECK(host.sLastImageType == L"PNG");
+    // 与原来相同，file=' 在整个剩余文字中查找，之后有这种写法时前面的简写图片找不到
+    layout.Build(&host, L"<i list.png 4 2><i file='smile.png'>", 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(layout.aRuns[0].pImage == &host.nImageSmile);
+
+    // 放不下的图片换到下一行，找不到的图片忽略
+    pstrText = L"abcdef<i smile.png><i missing.png>";
+    layout.Build(&host, pstrText, 50, 100, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(layout.aRuns[1].nType == HTMLTEXT_RUN_IMAGE);
+    TEST_CHECK(SameRect(layout.aRuns[1].rcImage, 0, 16, 20, 46));
+}
+
+static void TestWordBreak()
+{
+    MockHost host;
+    // 每行放 5 个字符
+    const wchar_t* pstrText = L"aaa bbb";
+    Layout layout;
+    layout.Build(&host, pstrText, 30, 100, 0, HTMLTEXT_WORDBREAK, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"aaa ", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"bbb", 0, 16));
+
+    // 不按单词换行时从字符处断开，行首第一个放不下的字符仍然留在这一行
+    layout.Build(&host, pstrText, 30, 100, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"aaa bb", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"b", 0, 16));
+
+    // 一个单词比一行长时按字符断开
+    pstrText = L"abcdefghijk";
+    layout.Build(&host, pstrText, 30, 100, 0, HTMLTEXT_WORDBREAK, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"abcdef", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"ghijk", 0, 16));
+
+    // 行中间的标签之后放不下的文字移到下一行
+    pstrText = L"ab<b>cd efgh</b>";
+    layout.Build(&host, pstrText, 40, 100, 0, HTMLTEXT_WORDBREAK, 0);
+    TEST_CHECK(layout.aRuns.size() == 3);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"cd ", 12, 0));
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L"efgh", 0, 16));
+    TEST_CHECK(RunFont(layout, 2)->bBold);
+
+    // 超出区域底部的行不再输出
+    pstrText = L"a<n>b<n>c<n>d";
+    layout.Build(&host, pstrText, 30, 20, 0, 0, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"b", 0, 16));
+}
+
+static void TestEllipsis()
+{
+    MockHost host;
+    // 放不下时去掉最后两个字符，后面接 "..."
+    const wchar_t* pstrText = L"abcdefghij";
+    Layout layout;
+    layout.Build(&host, pstrText, 30, 50, 0, HTMLTEXT_SINGLELINE | HTMLTEXT_END_ELLIPSIS, 0);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"abcd", 0, 0));
+    TEST_CHECK(layout.aRuns[1].nType == HTMLTEXT_RUN_ELLIPSIS);
+    TEST_CHECK(layout.aRuns[1].x == 24 && layout.aRuns[1].y == 0);
+    TEST_CHECK(layout.aRuns[1].pFont == host.pFont0);
+
+    // 放得下时没有省略号
+    layout.Build(&host, L"abcde", 30, 50, 0, HTMLTEXT_SINGLELINE | HTMLTEXT_END_ELLIPSIS, 0);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(layout.aRuns[0].nType == HTMLTEXT_RUN_TEXT);
+
+    // 不在行首时放得下的 3 个字符也去掉两个；省略号用被截断处的字体
+    pstrText = L"ab<b>cdefgh</b>";
+    layout.Build(&host, pstrText, 40, 50, 0, HTMLTEXT_SINGLELINE | HTMLTEXT_END_ELLIPSIS, 0);
+    TEST_CHECK(layout.aRuns.size() == 3);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 0, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"c", 12, 0));
+    TEST_CHECK(layout.aRuns[2].nType == HTMLTEXT_RUN_ELLIPSIS && layout.aRuns[2].x == 20);
+    TEST_CHECK(RunFont(layout, 2)->bBold);
+
+    // 与原来相同，多行时截断后剩下的文字接着在下一行输出，之后的行放不下时再截断
+    pstrText = L"abcdefgh<n>ijklmnop";
+    layout.Build(&host, pstrText, 30, 50, 0, HTMLTEXT_END_ELLIPSIS, 0);
+    TEST_CHECK(layout.aRuns.size() == 6);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"abcd", 0, 0));
+    TEST_CHECK(layout.aRuns[1].nType == HTMLTEXT_RUN_ELLIPSIS && layout.aRuns[1].y == 0);
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L"efgh", 0, 16));
+    TEST_CHECK(IsTextRun(layout, 3, pstrText, L"ijkl", 0, 32));
+    TEST_CHECK(layout.aRuns[4].nType == HTMLTEXT_RUN_ELLIPSIS && layout.aRuns[4].y == 32);
+    TEST_CHECK(IsTextRun(layout, 5, pstrText, L"mnop", 0, 48));
+}
+
+static void TestAlignAndCalcRect()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"ab";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, HTMLTEXT_SINGLELINE | HTMLTEXT_CENTER | HTMLTEXT_VCENTER, 0);
+    TEST_CHECK(SameRect(layout.rc, 44, 17, 56, 33));
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 44, 17));
+
+    layout.Build(&host, pstrText, 100, 50, 0, HTMLTEXT_SINGLELINE | HTMLTEXT_RIGHT | HTMLTEXT_BOTTOM, 0);
+    TEST_CHECK(SameRect(layout.rc, 88, 34, 100, 50));
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 88, 34));
+
+    // 多行居中时每段文字各自居中
+    pstrText = L"ab<n>abcd";
+    layout.Build(&host, pstrText, 100, 50, 0, HTMLTEXT_CENTER, 0);
+    TEST_CHECK(IsTextRun(layout, 0, pstrText, L"ab", 44, 0));
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"abcd", 38, 16));
+
+    // CALCRECT 只计算大小，不输出
+    layout.Build(&host, pstrText, 100, 50, 0, HTMLTEXT_CALCRECT, 0);
+    TEST_CHECK(layout.aRuns.empty());
+    TEST_CHECK(SameRect(layout.rc, 0, 0, 24, 32));
+    TEST_CHECK(layout.cxMaxWidth == 24);
+    TEST_CHECK(layout.cyLastLine == 32);
+    // 调用者坐标下只改右边和底边
+    TLayoutRect rc = { 10, 20, 200, 300 };
+    layout.GetCalcRect(rc);
+    TEST_CHECK(SameRect(rc, 10, 20, 34, 52));
+    // 比区域宽的文字按区域截断
+    rc.right = 30;
+    layout.GetCalcRect(rc);
+    TEST_CHECK(rc.right == 30);
+
+    // 很窄的区域中放不下任何字符时 CALCRECT 也会结束
+    layout.Build(&host, L"abc", 1, 50, 0, HTMLTEXT_CALCRECT | HTMLTEXT_END_ELLIPSIS, 0);
+    TEST_CHECK(layout.aRuns.empty());
+}
+
+static void TestLinks()
+{
+    MockHost host;
+    const wchar_t* pstrText = L"go <a http://x>here</a> now";
+    Layout layout;
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 2);
+    TEST_CHECK(layout.nLinks == 1);
+    TEST_CHECK(layout.aLinks.size() == 2);
+    TEST_CHECK(layout.aLinks[0].bRect && layout.aLinks[0].bLink);
+    TEST_CHECK(SameRect(layout.aLinks[0].rc, 18, 0, 42, 16));
+    TEST_CHECK(layout.aLinks[0].sLink == L"http://x");
+    TEST_CHECK(!layout.aLinks[1].bRect && !layout.aLinks[1].bLink);
+    TEST_CHECK(!layout.bCallerLinks);
+    // 标签之后开头的空格单独输出
+    TEST_CHECK(layout.aRuns.size() == 4);
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"here", 18, 0));
+    TEST_CHECK(IsTextRun(layout, 2, pstrText, L" ", 42, 0));
+    TEST_CHECK(IsTextRun(layout, 3, pstrText, L"now", 48, 0));
+    // 链接文字带下划线，颜色记下链接内容，绘制时按悬停的链接选择颜色
+    TEST_CHECK(RunFont(layout, 1)->bUnderline);
+    TEST_CHECK(RunColor(layout, 1).nType == HTMLTEXT_COLOR_LINK && RunColor(layout, 1).sLink == L"http://x");
+    TEST_CHECK(RunFont(layout, 3) == host.pFont0);
+    TEST_CHECK(RunColor(layout, 3).nType == HTMLTEXT_COLOR_DEFAULT);
+
+    // 没有链接数组时 <a> 只是默认颜色加下划线
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 0);
+    TEST_CHECK(layout.nLinks == 0);
+    TEST_CHECK(layout.aLinks.empty());
+    TEST_CHECK(RunColor(layout, 1).nType == HTMLTEXT_COLOR_DEFAULT);
+    TEST_CHECK(RunFont(layout, 1)->bUnderline);
+
+    // 两个链接
+    pstrText = L"<a 1>ab</a> <a 2>cd</a>";
+    layout.Build(&host, pstrText, 100, 50, 0, 0, 2);
+    TEST_CHECK(layout.nLinks == 2);
+    TEST_CHECK(SameRect(layout.aLinks[0].rc, 0, 0, 12, 16) && layout.aLinks[0].sLink == L"1");
+    TEST_CHECK(SameRect(layout.aLinks[1].rc, 18, 0, 30, 16) && layout.aLinks[1].sLink == L"2");
+}
+
+static void TestLinkWrap()
+{
+    MockHost host;
+    // 跨行的链接每行一个区域，内容相同
+    const wchar_t* pstrText = L"<a L>aaaa bbbb</a>";
+    Layout layout;
+    layout.Build(&host, pstrText, 30, 100, 0, HTMLTEXT_WORDBREAK, 2);
+    TEST_CHECK(layout.nLinks == 2);
+    TEST_CHECK(SameRect(layout.aLinks[0].rc, 0, 0, 30, 16) && layout.aLinks[0].sLink == L"L");
+    TEST_CHECK(SameRect(layout.aLinks[1].rc, 0, 16, 24, 32) && layout.aLinks[1].sLink == L"L");
+    TEST_CHECK(layout.aLinks[1].bLink);
+    TEST_CHECK(!layout.bCallerLinks);
+    TEST_CHECK(layout.aRuns.size() == 2);
+    TEST_CHECK(IsTextRun(layout, 1, pstrText, L"bbbb", 0, 16));
+    TEST_CHECK(RunColor(layout, 1).nType == HTMLTEXT_COLOR_LINK && RunColor(layout, 1).sLink == L"L");
+    TEST_CHECK(RunFont(layout, 1)->bUnderline);
+
+    // 数组已满时不写到数组之外
+    layout.Build(&host, pstrText, 30, 100, 0, HTMLTEXT_WORDBREAK, 1);
+    TEST_CHECK(layout.nLinks == 1);
+    TEST_CHECK(layout.aLinks.size() == 1);
+    TEST_CHECK(SameRect(layout.aLinks[0].rc, 0, 0, 30, 16));
+    // 第二行没有区域，颜色仍是 <a> 压入的链接颜色
+    TEST_CHECK(RunColor(layout, 1).nType == HTMLTEXT_COLOR_LINK && RunColor(layout, 1).sLink == L"L");
+
+    // 以换行开始的文字跳过了第一行的测量，链接内容来自调用者数组原来的内容，结果不能缓存
+    pstrText = L"\n<a L>x</a>";
+    const wchar_t* aOldLinks[] = { L"old" };
+    layout.Build(&host, pstrText, 100, 100, 0, 0, 1, aOldLinks);
+    TEST_CHECK(layout.bCallerLinks);
+    TEST_CHECK(layout.aRuns.size() == 1);
+    TEST_CHECK(RunColor(layout, 0).nType == HTMLTEXT_COLOR_LINK && RunColor(layout, 0).sLink == L"old");
+    TEST_CHECK(layout.aLinks[0].sLink == L"old");
+    TEST_CHECK(!layout.aLinks[0].bLink);
+}
+
+static void BuildFor(MockHost& host, const Cache::Key& key, Layout& layout)
+{
+    layout.Build(&host, key.sText.c_str(), key.cx, key.cy, key.iFont, key.uStyle, key.nLinkRects);
+}
+
+static Cache::Key MakeKey(const wchar_t* pstrText)
+{
+    Cache::Key key;
+    key.sText = pstrText;
+    key.iFont = 0;
+    key.cx = 100;
+    key.cy = 50;
+    key.uStyle = 0;
+    key.nLinkRects = 0;
+    key.nFlags = 0;
+    return key;
+}
+
+static void TestCacheLru()
+{
+    MockHost host;
+    Cache cache(3);
+    TEST_CHECK(cache.GetCapacity() == 3);
+    TEST_CHECK(cache.GetCount() == 0);
+
+    const Cache::Key k1 = MakeKey(L"one"), k2 = MakeKey(L"two"), k3 = MakeKey(L"three"), k4 = MakeKey(L"four");
+    TEST_CHECK(cache.Find(k1) == NULL);
+
+    // Insert 把结果交换进缓存，传入的 layout 变为空
+    Layout layout;
+    BuildFor(host, k1, layout);
+    const Layout* p1 = cache.Insert(k1, layout);
+    TEST_CHECK(p1 != NULL);
+    TEST_CHECK(layout.aRuns.empty());
+    TEST_CHECK(p1->aRuns.size() == 1 && p1->aRuns[0].cchText == 3);
+    TEST_CHECK(cache.Find(k1) == p1);
+
+    BuildFor(host, k2, layout);
+    cache.Insert(k2, layout);
+    BuildFor(host, k3, layout);
+    cache.Insert(k3, layout);
+    TEST_CHECK(cache.GetCount() == 3);
+
+    // 命中的 k1 移到最近使用，超过容量时淘汰最久未用的 k2
+    TEST_CHECK(cache.Find(k1) == p1);
+    BuildFor(host, k4, layout);
+    cache.Insert(k4, layout);
+    TEST_CHECK(cache.GetCount() == 3);
+    TEST_CHECK(cache.Find(k2) == NULL);
+    TEST_CHECK(cache.Find(k1) == p1);
+    TEST_CHECK(cache.Find(k3) != NULL);
+    TEST_CHECK(cache.Find(k4) != NULL);
+
+    // 已有的 key 再次 Insert 时替换内容，不增加项数，结果仍在原处
+    BuildFor(host, MakeKey(L"replaced"), layout);
+    const Layout* p1Again = cache.Insert(k1, layout);
+    TEST_CHECK(p1Again == p1);
+    TEST_CHECK(cache.GetCount() == 3);
+    TEST_CHECK(p1->aRuns[0].cchText == 8);
+    // 原来的结果交换出来后被清空
+    TEST_CHECK(layout.aRuns.empty());
+    // k1 成为最近使用，接下来淘汰 k3
+    BuildFor(host, k2, layout);
+    cache.Insert(k2, layout);
+    TEST_CHECK(cache.Find(k3) == NULL);
+    TEST_CHECK(cache.Find(k1) == p1);
+}
+
+static void TestCacheCapacityAndClear()
+{
+    MockHost host;
+    Cache cache;
+    TEST_CHECK(cache.GetCapacity() == Cache::DEFAULT_CAPACITY);
+    Layout layout;
+    const wchar_t* aTexts[] = { L"a", L"b", L"c", L"d", L"e" };
+    for (int i = 0; i < 5; ++i)
+    {
+        const Cache::Key key = MakeKey(aTexts[i]);
+        BuildFor(host, key, layout);
+        cache.Insert(key, layout);
+    }
+    TEST_CHECK(cache.GetCount() == 5);
+
+    // 减小容量时只留下最近使用的
+    cache.SetCapacity(2);
+    TEST_CHECK(cache.GetCapacity() == 2);
+    TEST_CHECK(cache.GetCount() == 2);
+    TEST_CHECK(cache.Find(MakeKey(L"e")) != NULL);
+    TEST_CHECK(cache.Find(MakeKey(L"d")) != NULL);
+    TEST_CHECK(cache.Find(MakeKey(L"c")) == NULL);
+
+    // Clear：字体、图片或 DPI 变化时整个缓存失效
+    cache.Clear();
+    TEST_CHECK(cache.GetCount() == 0);
+    TEST_CHECK(cache.Find(MakeKey(L"e")) == NULL);
+    TEST_CHECK(cache.GetCapacity() == 2);
+
+    // 容量为 0 时不缓存
+    cache.SetCapacity(0);
+    BuildFor(host, MakeKey(L"a"), layout);
+    TEST_CHECK(cache.Insert(MakeKey(L"a"), layout) == NULL);
+    TEST_CHECK(cache.GetCount() == 0);
+    TEST_CHECK(!layout.aRuns.empty());
+}
+
+static void TestCacheKey()
+{
+    MockHost host;
+    Cache cache;
+    const Cache::Key base = MakeKey(L"abc");
+    Layout layout;
+    BuildFor(host, base, layout);
+    cache.Insert(base, layout);
+    TEST_CHECK(cache.Find(base) != NULL);
+
+    // 任何一项不同都是另一个排版结果
+    Cache::Key key = base;
+    key.sText = L"abd";
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    key.iFont = 1;
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    key.cx = 101;
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    key.cy = 49;
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    key.uStyle = HTMLTEXT_WORDBREAK;
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    key.nLinkRects = 1;
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    key.nFlags = 1;
+    TEST_CHECK(cache.Find(key) == NULL);
+    key = base;
+    TEST_CHECK(cache.Find(key) != NULL);
+    TEST_CHECK(cache.GetCount() == 1);
+
+    // 缓存的结果与重新排版的结果相同，只测量一次
+    key = MakeKey(L"<b>bold</b> <a x>link</a> text that wraps");
+    key.cx = 60;
+    key.uStyle = HTMLTEXT_WORDBREAK;
+    key.nLinkRects = 2;
+    BuildFor(host, key, layout);
+    Layout fresh;
+    BuildFor(host, key, fresh);
+    cache.Insert(key, layout);
+    host.nMeasureCalls = 0;
+    const Layout* pCached = cache.Find(key);
+    TEST_CHECK(pCached != NULL);
+    TEST_CHECK(host.nMeasureCalls == 0);
+    TEST_CHECK(pCached->aRuns.size() == fresh.aRuns.size());
+    for (size_t i = 0; i < fresh.aRuns.size(); ++i)
+    {
+        TEST_CHECK(pCached->aRuns[i].x == fresh.aRuns[i].x && pCached->aRuns[i].y == fresh.aRuns[i].y);
+        TEST_CHECK(pCached->aRuns[i].iText == fresh.aRuns[i].iText && pCached->aRuns[i].cchText == fresh.aRuns[i].cchText);
+    }
+    // 链接跨到了第二行
+    TEST_CHECK(pCached->nLinks == fresh.nLinks && pCached->nLinks == 2);
+    for (int i = 0; i < fresh.nLinks; ++i)
+    {
+        const TLayoutRect& rc = fresh.aLinks[i].rc;
+        TEST_CHECK(SameRect(pCached->aLinks[i].rc, rc.left, rc.top, rc.right, rc.bottom));
+        TEST_CHECK(pCached->aLinks[i].sLink == L"x");
+    }
+}
+
+int main()
+{
+    TestPlainText();
+    TestBold();
+    TestColor();
+    TestFont();
+    TestNewlineAndParagraph();
+    TestIndent();
+    TestImage();
+    TestWordBreak();
+    TestEllipsis();
+    TestAlignAndCalcRect();
+    TestLinks();
+    TestLinkWrap();
+    TestCacheLru();
+    TestCacheCapacityAndClear();
+    TestCacheKey();
+    printf("HtmlTextTest passed\n");
+    return 0;
+}
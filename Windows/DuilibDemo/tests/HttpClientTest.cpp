@@ -0,0 +1,270 @@
+/*
+* Module:   HttpClientTest
+*
+* Function: 用本机回环上的 HTTP 服务器测试 HttpClient 的 socket 实现：keep-alive 复用、Content-Length 和 chunked 响应、
+*           读到关闭为止的响应、服务器关闭空闲连接后的重试、异步请求的回调、http_close 对排队和正在执行的请求的处理
+*/
+#include "http/HttpClient.h"
+#include "LoopbackHttpServer.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 按路径返回不同格式的响应：
+//   /len/N       Content-Length，N 字节
+//   /chunked/N   chunked，N 字节分成不同大小的块，带 trailer
+//   /eof/N       HTTP/1.0 没有长度，写完关闭连接
+//   /drop        正常的 keep-alive 响应，之后服务器直接关闭连接（客户端下次复用时发现）
+//   /slow        等待 ReleaseSlow 之后再响应
+//   /status/N    返回状态码 N
+//   /echo        把请求体原样返回
+static std::mutex g_slowMutex;
+static std::condition_variable g_slowCond;
+static bool g_slowReleased = false;
+
+static void ReleaseSlow()
+{
+    std::lock_guard<std::mutex> lock(g_slowMutex);
+    g_slowReleased = true;
+    g_slowCond.notify_all();
+}
+
+// 内容由长度和下标决定，方便校验
+static std::string Body(size_t size)
+{
+    std::string body(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        body[i] = static_cast<char>('a' + (i * 7 + size) % 26);
+    return body;
+}
+
+static bool HandleRequest(const LoopbackHttpServer::Request& request, std::string& response)
+{
+    const std::string& path = request.path;
+    if (path.compare(0, 5, "/len/") == 0)
+    {
+        response = LoopbackHttpServer::Response(200, Body(static_cast<size_t>(atoi(path.c_str() + 5))));
+    }
+    else if (path.compare(0, 9, "/chunked/") == 0)
+    {
+        std::string data = Body(static_cast<size_t>(atoi(path.c_str() + 9)));
+        response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+        size_t offset = 0;
+        for (size_t step = 1; offset < data.size(); step = step * 3 + 1)
+        {
+            size_t size = std::min(step, data.size() - offset);
+            char length[32];
+            snprintf(length, sizeof(length), "%zx;ext=1\r\n", size);
+            response.append(length).append(data, offset, size).append("\r\n");
+            offset += size;
+        }
+        response.append("0\r\nX-Trailer: 1\r\n\r\n");
+    }
+    else if (path.compare(0, 5, "/eof/") == 0)
+    {
+        response = "HTTP/1.0 200 OK\r\n\r\n" + Body(static_cast<size_t>(atoi(path.c_str() + 5)));
+        return false;
+    }
+    else if (path == "/drop")
+    {
+        response = LoopbackHttpServer::Response(200, "drop");
+        return false;
+    }
+    else if (path == "/slow")
+    {
+        std::unique_lock<std::mutex> lock(g_slowMutex);
+        g_slowCond.wait(lock, []() { return g_slowReleased; });
+        response = LoopbackHttpServer::Response(200, "slow");
+    }
+    else if (path.compare(0, 8, "/status/") == 0)
+    {
+        response = LoopbackHttpServer::Response(atoi(path.c_str() + 8), "");
+    }
+    else if (path == "/echo")
+    {
+        response = LoopbackHttpServer::Response(200, request.body);
+    }
+    else
+    {
+        response = LoopbackHttpServer::Response(404, "");
+    }
+    return true;
+}
+
+static const std::vector<std::wstring> kNoHeaders;
+
+static void TestBodiesAndKeepAlive()
+{
+    LoopbackHttpServer server(HandleRequest);
+    HttpClient client(L"HttpClientTest");
+    const size_t sizes[] = { 0, 1, 2, 100, 4095, 4096, 4097, 65536, 300000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        std::string resp;
+        TEST_CHECK(client.http_get(server.Url("/len/" + std::to_string(sizes[i])), kNoHeaders, resp) == ERROR_SUCCESS);
+        TEST_CHECK(resp == Body(sizes[i]));
+        resp.clear();
+        TEST_CHECK(client.http_get(server.Url("/chunked/" + std::to_string(sizes[i])), kNoHeaders, resp) == ERROR_SUCCESS);
+        TEST_CHECK(resp == Body(sizes[i]));
+    }
+    // 同一个 host 的顺序请求都在一个连接上
+    TEST_CHECK(server.Connections() == 1);
+    TEST_CHECK(server.Requests() == 18);
+
+    // 响应追加到 resp_data 后面
+    std::string resp = "prefix";
+    TEST_CHECK(client.http_post(server.Url("/echo"), kNoHeaders, "hello body", resp) == ERROR_SUCCESS);
+    TEST_CHECK(resp == "prefixhello body");
+    resp.clear();
+    TEST_CHECK(client.http_put(server.Url("/echo"), kNoHeaders, std::string(100000, 'p'), resp) == ERROR_SUCCESS);
+    TEST_CHECK(resp == std::string(100000, 'p'));
+    TEST_CHECK(server.Connections() == 1);
+
+    // 非 200 是 EcHttpCodeError，连接仍然复用
+    resp.clear();
+    TEST_CHECK(client.http_get(server.Url("/status/404"), kNoHeaders, resp) == EcHttpCodeError);
+    TEST_CHECK(client.http_get(server.Url("/status/204"), kNoHeaders, resp) == EcHttpCodeError);
+    TEST_CHECK(server.Connections() == 1);
+
+    // 没有长度的响应读到关闭为止，连接不放回
+    resp.clear();
+    TEST_CHECK(client.http_get(server.Url("/eof/5000"), kNoHeaders, resp) == ERROR_SUCCESS);
+    TEST_CHECK(resp == Body(5000));
+    resp.clear();
+    TEST_CHECK(client.http_get(server.Url("/len/3"), kNoHeaders, resp) == ERROR_SUCCESS);
+    TEST_CHECK(server.Connections() == 2);
+
+    TEST_CHECK(client.http_get(L"https://127.0.0.1/", kNoHeaders, resp) == EcHttpUnsupported);
+}
+
+static void TestStaleConnectionRetry()
+{
+    LoopbackHttpServer server(HandleRequest);
+    HttpClient client(L"HttpClientTest");
+    for (int i = 0; i < 5; ++i)
+    {
+        // 服务器回完就关闭连接但没有说明；下一个请求在复用的连接上什么也收不到，换新连接重试一次
+        std::string resp;
+        TEST_CHECK(client.http_get(server.Url("/drop"), kNoHeaders, resp) == ERROR_SUCCESS);
+        TEST_CHECK(resp == "drop");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        resp.clear();
+        TEST_CHECK(client.http_get(server.Url("/len/10"), kNoHeaders, resp) == ERROR_SUCCESS);
+        TEST_CHECK(resp == Body(10));
+    }
+    // 每个 /drop 用的是上一次重试建立的连接：第一个连接加上 5 次重试
+    TEST_CHECK(server.Connections() == 6);
+    TEST_CHECK(server.Requests() == 10);
+
+    // 连不上不重试，返回系统错误码
+    std::string resp;
+    unsigned short port;
+    {
+        LoopbackHttpServer closed(HandleRequest);
+        port = closed.Port();
+    }
+    std::string url = "http://127.0.0.1:" + std::to_string(port) + "/len/1";
+    TEST_CHECK(client.http_get(std::wstring(url.begin(), url.end()), kNoHeaders, resp) != ERROR_SUCCESS);
+}
+
+static void TestAsync()
+{
+    LoopbackHttpServer server(HandleRequest);
+    std::mutex mutex;
+    std::condition_variable cond;
+    int done = 0;
+    int failures = 0;
+    {
+        HttpClient client(L"HttpClientTest");
+        const int kCount = 200;
+        for (int i = 0; i < kCount; ++i)
+        {
+            const size_t size = static_cast<size_t>(i * 37 % 5000);
+            HttpCallback callback = [&, size](DWORD ret, const std::string& resp) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ret != ERROR_SUCCESS || resp != Body(size))
+                    ++failures;
+                ++done;
+                cond.notify_all();
+            };
+            if (i % 2 == 0)
+                client.http_get_async(server.Url((i % 4 == 0 ? "/len/" : "/chunked/") + std::to_string(size)), kNoHeaders, callback);
+            else
+                client.http_post_async(server.Url("/echo"), kNoHeaders, Body(size), callback);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        TEST_CHECK(cond.wait_for(lock, std::chrono::seconds(30), [&]() { return done == kCount; }));
+    }
+    TEST_CHECK(failures == 0);
+    // 两个工作线程，每个一条连接
+    TEST_CHECK(server.Connections() <= 2);
+}
+
+static void TestCloseWithRequestsInFlight()
+{
+    LoopbackHttpServer server(HandleRequest);
+    std::mutex mutex;
+    std::condition_variable cond;
+    int ok = 0;
+    int aborted = 0;
+    HttpClient client(L"HttpClientTest");
+    HttpCallback callback = [&](DWORD ret, const std::string& resp) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ret == ERROR_SUCCESS && resp == "slow")
+            ++ok;
+        else if (ret == EcHttpAborted)
+            ++aborted;
+        cond.notify_all();
+    };
+    // 两个工作线程卡在 /slow 上，后面 8 个在排队
+    for (int i = 0; i < 10; ++i)
+        client.http_get_async(server.Url("/slow"), kNoHeaders, callback);
+    while (server.Requests() < 2)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // 排队的以 EcHttpAborted 回调；正在执行的照常完成，用完的连接不再放回
+    client.http_close();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        TEST_CHECK(aborted == 8);
+    }
+    ReleaseSlow();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        TEST_CHECK(cond.wait_for(lock, std::chrono::seconds(10), [&]() { return ok == 2; }));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const int connections = server.Connections();
+    std::string resp;
+    TEST_CHECK(client.http_get(server.Url("/len/1"), kNoHeaders, resp) == ERROR_SUCCESS);
+    TEST_CHECK(server.Connections() == connections + 1);
+
+    // 在回调中调用 http_close 不会卡住
+    bool closed = false;
+    client.http_get_async(server.Url("/len/1"), kNoHeaders, [&](DWORD, const std::string&) {
+        client.http_close();
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        cond.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    TEST_CHECK(cond.wait_for(lock, std::chrono::seconds(10), [&]() { return closed; }));
+}
+
+int main()
+{
+    TestBodiesAndKeepAlive();
+    TestStaleConnectionRetry();
+    TestAsync();
+    TestCloseWithRequestsInFlight();
+    printf("HttpClientTest passed\n");
+    return 0;
+}
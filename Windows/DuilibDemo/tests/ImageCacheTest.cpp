@@ -0,0 +1,179 @@
+/*
+* Module:   ImageCacheTest
+*
+* Function: CImageCacheT 的去重、引用计数和 LRU 淘汰，以及 ReloadSkin 使用的替换方式：
+*           Clear 之后第一个窗口加载新图片放进缓存，后面的窗口命中同一份，旧图片在最后一个引用释放时才释放
+*/
+#include "UIImageCache.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace DuiLib;
+
+typedef CImageCacheT<wchar_t> Cache;
+
+struct Image
+{
+    int id;
+};
+
+static std::mutex g_mutex;
+static std::set<void*> g_live;
+
+static void FreeImage(void* pImage)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    // 重复释放或释放不认识的指针
+    TEST_CHECK(g_live.erase(pImage) == 1);
+    delete static_cast<Image*>(pImage);
+}
+
+static Image* NewImage()
+{
+    Image* pImage = new Image();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_live.insert(pImage);
+    return pImage;
+}
+
+static bool IsLive(void* pImage)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_live.count(pImage) != 0;
+}
+
+static Cache::Key MakeKey(const wchar_t* name, unsigned int mask = 0, unsigned int hsl = 0)
+{
+    Cache::Key key;
+    key.sName = name;
+    key.nInstance = 0;
+    key.dwMask = mask;
+    key.nHSL = hsl;
+    return key;
+}
+
+static void TestSharingAndEviction()
+{
+    Cache cache(FreeImage, 1000);
+    TEST_CHECK(cache.Acquire(MakeKey(L"a")) == NULL);
+    Image* a = NewImage();
+    TEST_CHECK(cache.Insert(MakeKey(L"a"), a, 400) == a);
+    // 第二个窗口命中同一份；mask 或 HSL 不同是不同的图片
+    TEST_CHECK(cache.Acquire(MakeKey(L"a")) == a);
+    TEST_CHECK(cache.Acquire(MakeKey(L"a", 1)) == NULL);
+    TEST_CHECK(cache.Acquire(MakeKey(L"a", 0, 5)) == NULL);
+    Cache::Stats stats = cache.GetStats();
+    TEST_CHECK(stats.nHits == 1 && stats.nMisses == 3 && stats.nImages == 1 && stats.nBytes == 400 && stats.nUnusedImages == 0);
+
+    // 没有引用但在预算内，保留在 LRU 中
+    TEST_CHECK(cache.Release(a));
+    TEST_CHECK(cache.Release(a));
+    stats = cache.GetStats();
+    TEST_CHECK(stats.nUnusedImages == 1 && stats.nUnusedBytes == 400 && IsLive(a));
+    TEST_CHECK(cache.Acquire(MakeKey(L"a")) == a);
+
+    // 超过预算但都被引用时不淘汰
+    Image* b = NewImage();
+    Image* d = NewImage();
+    cache.Insert(MakeKey(L"b"), b, 400);
+    cache.Insert(MakeKey(L"d"), d, 400);
+    TEST_CHECK(cache.GetStats().nEvictions == 0 && IsLive(a) && IsLive(b) && IsLive(d));
+    cache.Release(b);
+    TEST_CHECK(!IsLive(b) && cache.GetStats().nEvictions == 1 && cache.GetStats().nBytes == 800);
+
+    // 淘汰最久未用的
+    cache.Release(a);
+    cache.Release(d);
+    Image* e = NewImage();
+    cache.Insert(MakeKey(L"e"), e, 300);
+    TEST_CHECK(!IsLive(a) && IsLive(d) && IsLive(e));
+    TEST_CHECK(cache.Acquire(MakeKey(L"a")) == NULL);
+
+    // 同一个 key 重复插入：释放新的，返回已有的并增加引用
+    Image* e2 = NewImage();
+    TEST_CHECK(cache.Insert(MakeKey(L"e"), e2, 300) == e);
+    TEST_CHECK(!IsLive(e2));
+    cache.Release(e);
+    cache.Release(e);
+
+    // 不是缓存中的图片由调用方自己释放
+    Image local;
+    TEST_CHECK(!cache.Release(&local));
+    TEST_CHECK(!cache.AddRef(&local));
+
+    cache.SetBudget(0);
+    TEST_CHECK(cache.GetStats().nImages == 0);
+    TEST_CHECK(!IsLive(d) && !IsLive(e));
+}
+
+static void TestReloadSwap()
+{
+    Cache cache(FreeImage, 1 << 20);
+    Image* old = NewImage();
+    // 两个窗口的图片表各持有一个引用
+    TEST_CHECK(cache.Insert(MakeKey(L"bk.png"), old, 100) == old);
+    TEST_CHECK(cache.Acquire(MakeKey(L"bk.png")) == old);
+
+    // 换皮肤：旧图片不再能查到，但仍然有效
+    cache.Clear();
+    TEST_CHECK(cache.Acquire(MakeKey(L"bk.png")) == NULL);
+    TEST_CHECK(IsLive(old) && cache.IsCached(old));
+
+    // 第一个窗口重新加载成新的图片，替换自己的指针后释放旧的
+    Image* fresh = NewImage();
+    TEST_CHECK(cache.Insert(MakeKey(L"bk.png"), fresh, 200) == fresh);
+    TEST_CHECK(cache.Release(old));
+    TEST_CHECK(IsLive(old));
+
+    // 第二个窗口直接命中新图片，释放旧图片的最后一个引用
+    TEST_CHECK(cache.Acquire(MakeKey(L"bk.png")) == fresh);
+    TEST_CHECK(cache.Release(old));
+    TEST_CHECK(!IsLive(old));
+    TEST_CHECK(cache.GetStats().nBytes == 200);
+
+    cache.Release(fresh);
+    cache.Release(fresh);
+    TEST_CHECK(IsLive(fresh));
+}
+
+static void TestConcurrentAcquire()
+{
+    Cache cache(FreeImage, 1500);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&cache, t]() {
+            for (int i = 0; i < 20000; ++i)
+            {
+                wchar_t name[2] = { static_cast<wchar_t>(L'a' + (i * 7 + t) % 26), 0 };
+                void* pImage = cache.Acquire(MakeKey(name));
+                if (pImage == NULL)
+                    pImage = cache.Insert(MakeKey(name), NewImage(), 100);
+                TEST_CHECK(pImage != NULL && IsLive(pImage));
+                cache.Release(pImage);
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+    Cache::Stats stats = cache.GetStats();
+    TEST_CHECK(stats.nUnusedImages == stats.nImages);
+    TEST_CHECK(stats.nBytes <= 1500);
+}
+
+int main()
+{
+    TestSharingAndEviction();
+    TestReloadSwap();
+    TestConcurrentAcquire();
+    // 析构时释放所有没有引用的图片
+    TEST_CHECK(g_live.empty());
+    printf("ImageCacheTest passed\n");
+    return 0;
+}
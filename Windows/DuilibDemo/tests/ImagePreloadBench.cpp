@@ -0,0 +1,189 @@
+/*
+* Module:   ImagePreloadBench
+*
+* Function: 首次绘制前的耗时（time to first paint），资源为 Demo 的 res/resouce/trtcskin：
+*           每个皮肤 XML 当作一个窗口，从开始解析皮肤计时，到第一次绘制用到的图片全部可用为止。
+*           顺序：解析、创建控件（用忙等 gap 毫秒模拟），WM_PAINT 中逐张读文件解码；
+*           预加载：解析后收集图片交给 CImagePreloader，创建控件的同时后台解码，WM_PAINT 中 Take
+*
+*    不是测试，不注册到 ctest：./ImagePreloadBench [轮数] [gap 毫秒...]
+*/
+#include "UIMarkupDom.h"
+#include "UIImagePreload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    return data;
+}
+
+// 创建控件占用 UI 线程的时间
+static void BusyWait(double ms)
+{
+    const double end = Now() + ms / 1000.0;
+    while (Now() < end)
+    {
+    }
+}
+
+static bool LoadImageFile(const std::string& name, CImagePreloader::Source& source)
+{
+    std::shared_ptr<std::string> data = std::make_shared<std::string>(ReadFile(std::string(SKIN_DIR) + "/" + name));
+    if (data->empty())
+        return false;
+    source.pData = reinterpret_cast<const unsigned char*>(data->data());
+    source.nSize = data->size();
+    source.pHolder = data;
+    return true;
+}
+
+static void Parse(const std::string& skin, std::string& text, CMarkupDomA& dom, std::vector<SkinImageRef<char> >& refs)
+{
+    text = skin;
+    dom.Parse(&text[0], true);
+    refs.clear();
+    CollectSkinImages(dom, 100, refs);
+}
+
+// 返回从开始解析到最后一张图片可用的毫秒数
+static double FirstPaintSequential(const std::string& skin, double gapMs, size_t& decoded)
+{
+    const double begin = Now();
+    std::string text;
+    CMarkupDomA dom;
+    std::vector<SkinImageRef<char> > refs;
+    Parse(skin, text, dom, refs);
+    BusyWait(gapMs);
+    for (size_t i = 0; i < refs.size(); ++i)
+    {
+        CImagePreloader::Source source;
+        CDecodedImage image;
+        if (LoadImageFile(refs[i].sName, source) && DecodeImage(source.pData, source.nSize, refs[i].dwMask, image))
+        {
+            ++decoded;
+            FreeDecodedImage(image);
+        }
+    }
+    return (Now() - begin) * 1000.0;
+}
+
+static double FirstPaintPreload(const std::string& skin, double gapMs, size_t& decoded, CImagePreloader::Stats& stats)
+{
+    const double begin = Now();
+    std::string text;
+    CMarkupDomA dom;
+    std::vector<SkinImageRef<char> > refs;
+    Parse(skin, text, dom, refs);
+    CImagePreloader preloader([&refs](size_t nIndex, CImagePreloader::Source& source) {
+        return LoadImageFile(refs[nIndex].sName, source);
+    });
+    std::vector<unsigned int> masks;
+    for (size_t i = 0; i < refs.size(); ++i)
+        masks.push_back(refs[i].dwMask);
+    preloader.Add(masks);
+    BusyWait(gapMs);
+    for (size_t i = 0; i < refs.size(); ++i)
+    {
+        CDecodedImage image;
+        if (preloader.Take(i, image))
+        {
+            ++decoded;
+            FreeDecodedImage(image);
+        }
+    }
+    const double elapsed = (Now() - begin) * 1000.0;
+    const CImagePreloader::Stats s = preloader.GetStats();
+    stats.nDecodedByCaller += s.nDecodedByCaller;
+    stats.nWaits += s.nWaits;
+    return elapsed;
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    std::vector<double> gaps;
+    for (int i = 2; i < argc; ++i)
+        gaps.push_back(atof(argv[i]));
+    if (gaps.empty())
+    {
+        gaps.push_back(0);
+        gaps.push_back(2);
+        gaps.push_back(5);
+    }
+
+    std::vector<std::string> skins;
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        std::string text = ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]);
+        if (text.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            text.erase(0, 3);
+        if (text.empty())
+        {
+            fprintf(stderr, "cannot read %s\n", kSkinFiles[i]);
+            return 1;
+        }
+        skins.push_back(text);
+    }
+    printf("%zu windows, %d rounds, %u hardware threads\n", skins.size(), rounds, std::thread::hardware_concurrency());
+
+    for (size_t g = 0; g < gaps.size(); ++g)
+    {
+        double sequentialMs = 0;
+        double preloadMs = 0;
+        size_t sequentialDecoded = 0;
+        size_t preloadDecoded = 0;
+        CImagePreloader::Stats stats = { 0, 0, 0, 0 };
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < skins.size(); ++i)
+            {
+                sequentialMs += FirstPaintSequential(skins[i], gaps[g], sequentialDecoded);
+                preloadMs += FirstPaintPreload(skins[i], gaps[g], preloadDecoded, stats);
+            }
+        }
+        // 每个窗口都扣掉创建控件的时间，剩下的是首次绘制前因图片多等的时间
+        const double windows = static_cast<double>(rounds) * skins.size();
+        printf("gap %4.1f ms   sequential %7.3f ms   preload %7.3f ms   image wait %7.3f -> %7.3f ms   "
+            "(decoded %zu/%zu, by caller %zu, waits %zu)\n",
+            gaps[g], sequentialMs / windows, preloadMs / windows,
+            sequentialMs / windows - gaps[g], preloadMs / windows - gaps[g],
+            sequentialDecoded, preloadDecoded, stats.nDecodedByCaller, stats.nWaits);
+    }
+    return 0;
+}
@@ -0,0 +1,430 @@
+/*
+* Module:   ImagePreloadTest
+*
+* Function: 皮肤图片预加载在 Linux 上编译运行：图片描述串的解析、从 Demo 皮肤收集引用的图片、
+*           DecodeImage 与原来 LoadImage 的逐像素转换一致，多个线程同时第一次解码 PNG（stb_image 的固定 Huffman 表），
+*           CImagePreloader 的后台解码、调用线程解码、等待、取消和失败
+*/
+#include "UIMarkupDom.h"
+#include "UIImagePreload.h"
+#include "../Utils/stb_image.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+// 4x4 RGBA，IDAT 是一个固定 Huffman 编码的块（BTYPE=1），会用到 stb_image 的 stbi__zdefault_length/distance。
+// 像素 (x, y) 为 R = 60x，G = 60y，B = 0x80，A = (x + y) 为奇数时 255，否则 128
+static const unsigned char kFixedHuffmanPng[] = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x08, 0x06, 0x00, 0x00, 0x00, 0xA9, 0xF1, 0x9E,
+    0x7E, 0x00, 0x00, 0x00, 0x3D, 0x49, 0x44, 0x41, 0x54, 0x78, 0x01, 0x63, 0x60, 0x60, 0x68, 0x68,
+    0xB0, 0x61, 0x68, 0xF8, 0x5F, 0x01, 0xA4, 0xB7, 0x00, 0x69, 0x06, 0x06, 0x9B, 0x86, 0xFF, 0x36,
+    0x36, 0x0D, 0x0D, 0x15, 0x40, 0x7A, 0x0B, 0x90, 0x66, 0x60, 0xA8, 0x00, 0xAA, 0xA8, 0x00, 0xAA,
+    0x00, 0xD2, 0x5B, 0x2A, 0x40, 0x2A, 0xB6, 0x00, 0x55, 0x6C, 0x01, 0xAA, 0x00, 0xD2, 0x5B, 0x80,
+    0x34, 0x00, 0xB8, 0xBD, 0x1F, 0x39, 0xCE, 0x53, 0x8E, 0xEC, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+    0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82,
+};
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    return data;
+}
+
+// 原来 CRenderEngine::LoadImage 中逐像素写 DIB 的循环
+static bool LegacyConvert(const unsigned char* pImage, unsigned char* pDest, int x, int y, unsigned int mask)
+{
+    bool bAlphaChannel = false;
+    for (int i = 0; i < x * y; i++)
+    {
+        pDest[i * 4 + 3] = pImage[i * 4 + 3];
+        if (pDest[i * 4 + 3] < 255)
+        {
+            pDest[i * 4] = static_cast<unsigned char>(static_cast<unsigned int>(pImage[i * 4 + 2]) * pImage[i * 4 + 3] / 255);
+            pDest[i * 4 + 1] = static_cast<unsigned char>(static_cast<unsigned int>(pImage[i * 4 + 1]) * pImage[i * 4 + 3] / 255);
+            pDest[i * 4 + 2] = static_cast<unsigned char>(static_cast<unsigned int>(pImage[i * 4]) * pImage[i * 4 + 3] / 255);
+            bAlphaChannel = true;
+        }
+        else
+        {
+            pDest[i * 4] = pImage[i * 4 + 2];
+            pDest[i * 4 + 1] = pImage[i * 4 + 1];
+            pDest[i * 4 + 2] = pImage[i * 4];
+        }
+        unsigned int pixel;
+        memcpy(&pixel, &pDest[i * 4], 4);
+        if (pixel == mask)
+        {
+            pDest[i * 4] = pDest[i * 4 + 1] = pDest[i * 4 + 2] = pDest[i * 4 + 3] = 0;
+            bAlphaChannel = true;
+        }
+    }
+    return bAlphaChannel;
+}
+
+static void CheckDecodeMatchesLegacy(const std::string& data, unsigned int dwMask)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    CDecodedImage image;
+    TEST_CHECK(DecodeImage(p, data.size(), dwMask, image));
+
+    int x = 0, y = 0, n = 0;
+    unsigned char* pImage = stbi_load_from_memory(p, static_cast<int>(data.size()), &x, &y, &n, 4);
+    TEST_CHECK(pImage != NULL);
+    std::vector<unsigned char> expected(static_cast<size_t>(x) * y * 4 + 1);
+    const bool bAlpha = LegacyConvert(pImage, &expected[0], x, y, dwMask);
+    stbi_image_free(pImage);
+
+    TEST_CHECK(image.nWidth == x && image.nHeight == y);
+    TEST_CHECK(image.bAlpha == bAlpha);
+    TEST_CHECK(memcmp(image.pBits, &expected[0], static_cast<size_t>(x) * y * 4) == 0);
+    FreeDecodedImage(image);
+    TEST_CHECK(image.pBits == NULL);
+}
+
+struct SkinImages
+{
+    std::vector<SkinImageRef<char> > refs;
+    std::vector<std::string> data;      // 与 refs 一一对应，文件不存在时为空
+};
+
+static SkinImages CollectDemoImages(int nScale)
+{
+    SkinImages images;
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        std::string text = ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]);
+        TEST_CHECK(!text.empty());
+        // 与 CMarkup::LoadFromMem 一样去掉 UTF-8 BOM
+        if (text.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            text.erase(0, 3);
+        CMarkupDomA dom;
+        TEST_CHECK(dom.Parse(&text[0], true));
+        CollectSkinImages(dom, nScale, images.refs);
+    }
+    for (size_t i = 0; i < images.refs.size(); ++i)
+        images.data.push_back(ReadFile(std::string(SKIN_DIR) + "/" + images.refs[i].sName));
+    return images;
+}
+
+static void TestParseImageString()
+{
+    SkinImageRef<char> ref;
+    std::string sResType;
+
+    ParseImageString("login/logo.png", 100, ref, sResType);
+    TEST_CHECK(ref.sName == "login/logo.png" && ref.dwMask == 0 && !ref.bHSL && sResType.empty());
+
+    ParseImageString("file='a.png' source='0,0,4,4' mask='#FFFF00FF' hsl='TRUE' corner='1,1,1,1'", 100, ref, sResType);
+    TEST_CHECK(ref.sName == "a.png" && ref.dwMask == 0xFFFF00FF && ref.bHSL && sResType.empty());
+
+    ParseImageString("res='b.png' restype='PNG' mask='0x10'", 100, ref, sResType);
+    TEST_CHECK(ref.sName == "b.png" && ref.dwMask == 0x10 && sResType == "PNG");
+
+    // DPI 缩放时每个 '.' 前插入 "@缩放比"，与 TDrawInfo::Parse 相同
+    ParseImageString("file='dir.v2/c.png'", 150, ref, sResType);
+    TEST_CHECK(ref.sName == "dir@150.v2/c@150.png");
+
+    // 格式不对时停在出错处，已经解析的项保留
+    ParseImageString("file='d.png' mask='#ff' broken", 100, ref, sResType);
+    TEST_CHECK(ref.sName == "d.png" && ref.dwMask == 0xFF);
+    ParseImageString("mask='#FFFFFFFFF'", 100, ref, sResType);
+    TEST_CHECK(ref.dwMask == 0xFFFFFFFF);
+    ParseImageString(static_cast<const char*>(NULL), 100, ref, sResType);
+    TEST_CHECK(ref.sName.empty());
+
+    SkinImageRef<wchar_t> wref;
+    std::wstring wResType;
+    ParseImageString(L"file='e.png' hsl='true'", 125, wref, wResType);
+    TEST_CHECK(wref.sName == L"e@125.png" && wref.bHSL);
+}
+
+static void TestCollect()
+{
+    std::string text =
+        "<Window>"
+        "  <Image name=\"shared.png\" mask=\"#FF00FF00\" shared=\"true\"/>"
+        "  <Image name=\"res.png\" restype=\"PNG\"/>"
+        "  <Default name=\"Button\" value=\"normalimage=&quot;file='btn.png' mask='#FF000000'&quot; hotimage=&quot;btn_hot.png&quot; text=&quot;x&quot;\"/>"
+        "  <VerticalLayout bkimage=\"bk.png\">"
+        "    <Button normalimage=\"btn.png\" pushedimage=\"anim.gif\" foreimage=\"res.png\" text=\"image\"/>"
+        "    <Label bkimage=\"file='shared.png' mask='#FF123456'\" Image=\"upper.jpg\"/>"
+        "  </VerticalLayout>"
+        "</Window>";
+    CMarkupDomA dom;
+    TEST_CHECK(dom.Parse(&text[0], true));
+    std::vector<SkinImageRef<char> > refs;
+    CollectSkinImages(dom, 100, refs);
+    // 按出现顺序去重：<Image> 和 <Default> 先于控件属性；.gif 和带 restype 的不收集，同名的也不再收集
+    TEST_CHECK(refs.size() == 5);
+    TEST_CHECK(refs[0].sName == "shared.png" && refs[0].dwMask == 0xFF00FF00 && refs[0].bShared);
+    TEST_CHECK(refs[1].sName == "btn.png" && refs[1].dwMask == 0xFF000000 && !refs[1].bShared);
+    TEST_CHECK(refs[2].sName == "btn_hot.png");
+    TEST_CHECK(refs[3].sName == "bk.png");
+    TEST_CHECK(refs[4].sName == "upper.jpg");
+
+    // 已有的引用参与去重，多个皮肤可以收集进同一个列表
+    CollectSkinImages(dom, 100, refs);
+    TEST_CHECK(refs.size() == 5);
+}
+
+static void TestDemoSkins()
+{
+    SkinImages images = CollectDemoImages(100);
+    TEST_CHECK(images.refs.size() == 45);
+    size_t missing = 0;
+    for (size_t i = 0; i < images.refs.size(); ++i)
+    {
+        for (size_t k = 0; k < i; ++k)
+            TEST_CHECK(images.refs[k].sName != images.refs[i].sName);
+        if (images.data[i].empty())
+        {
+            // 仓库中没有的两张，运行时走 LoadImage 的失败路径
+            TEST_CHECK(images.refs[i].sName.find("logo.jpg") != std::string::npos ||
+                images.refs[i].sName.find("shareWhiteBoard.png") != std::string::npos);
+            ++missing;
+            continue;
+        }
+        CheckDecodeMatchesLegacy(images.data[i], images.refs[i].dwMask);
+        // mask 色按解码结果中真实存在的颜色再测一次
+        CDecodedImage image;
+        TEST_CHECK(DecodeImage(reinterpret_cast<const unsigned char*>(images.data[i].data()), images.data[i].size(), 0, image));
+        unsigned int pixel;
+        memcpy(&pixel, image.pBits + (image.nWidth * image.nHeight / 2) * 4, 4);
+        FreeDecodedImage(image);
+        CheckDecodeMatchesLegacy(images.data[i], pixel);
+    }
+    TEST_CHECK(missing == 2);
+
+    SkinImages scaled = CollectDemoImages(200);
+    TEST_CHECK(scaled.refs.size() == images.refs.size());
+    TEST_CHECK(scaled.refs[0].sName.find("@200.") != std::string::npos);
+}
+
+static void TestDecodeErrors()
+{
+    CDecodedImage image;
+    image.pBits = reinterpret_cast<unsigned char*>(1);
+    TEST_CHECK(!DecodeImage(NULL, 10, 0, image));
+    TEST_CHECK(image.pBits == NULL);
+    const unsigned char garbage[] = "not an image at all";
+    TEST_CHECK(!DecodeImage(garbage, sizeof(garbage), 0, image));
+    TEST_CHECK(!DecodeImage(kFixedHuffmanPng, 0, 0, image));
+    // 截断的 PNG 不能崩溃
+    for (size_t n = 1; n < sizeof(kFixedHuffmanPng); ++n)
+    {
+        if (DecodeImage(kFixedHuffmanPng, n, 0, image))
+            FreeDecodedImage(image);
+    }
+}
+
+// 多个线程同时第一次解码 PNG：固定 Huffman 表是静态初始化的常量，不再由第一个解码者填写（在 TSan 下验证）
+static void TestConcurrentFirstDecode()
+{
+    const int kThreads = 4;
+    std::mutex mutex;
+    std::condition_variable cond;
+    int ready = 0;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.push_back(std::thread([&]() {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (++ready == kThreads)
+                    cond.notify_all();
+                else
+                    cond.wait(lock, [&]() { return ready == kThreads; });
+            }
+            CDecodedImage image;
+            if (!DecodeImage(kFixedHuffmanPng, sizeof(kFixedHuffmanPng), 0, image))
+            {
+                ++failures;
+                return;
+            }
+            for (int y = 0; y < 4; ++y)
+            {
+                for (int x = 0; x < 4; ++x)
+                {
+                    const unsigned char* p = image.pBits + (y * 4 + x) * 4;
+                    const unsigned int a = (x + y) % 2 ? 255 : 128;
+                    if (p[3] != a || p[2] != 60 * x * a / 255 || p[1] != 60 * y * a / 255 || p[0] != 0x80 * a / 255)
+                        ++failures;
+                }
+            }
+            if (!image.bAlpha)
+                ++failures;
+            FreeDecodedImage(image);
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+    TEST_CHECK(failures == 0);
+}
+
+static void TestPreloader()
+{
+    SkinImages images = CollectDemoImages(100);
+    std::vector<unsigned int> masks;
+    for (size_t i = 0; i < images.refs.size(); ++i)
+        masks.push_back(images.refs[i].dwMask);
+
+    // 后追加的序号从头对应图片
+    std::atomic<int> loads(0);
+    CImagePreloader::LoadFunc load = [&](size_t nIndex, CImagePreloader::Source& source) {
+        ++loads;
+        const std::string& data = images.data[nIndex % images.data.size()];
+        if (data.empty())
+            return false;
+        source.pData = reinterpret_cast<const unsigned char*>(data.data());
+        source.nSize = data.size();
+        return true;
+    };
+
+    // 后台全部解码完再取，结果与直接解码相同；失败的取不到
+    {
+        CImagePreloader preloader(load, 4);
+        TEST_CHECK(preloader.Add(masks) == 0);
+        TEST_CHECK(preloader.GetCount() == masks.size());
+        while (!preloader.IsIdle())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (size_t k = images.refs.size(); k-- > 0;)
+        {
+            CDecodedImage image;
+            const bool ok = preloader.TryTake(k, image);
+            TEST_CHECK(ok == !images.data[k].empty());
+            if (!ok)
+                continue;
+            CDecodedImage expected;
+            TEST_CHECK(DecodeImage(reinterpret_cast<const unsigned char*>(images.data[k].data()), images.data[k].size(), masks[k], expected));
+            TEST_CHECK(image.nWidth == expected.nWidth && image.nHeight == expected.nHeight && image.bAlpha == expected.bAlpha);
+            TEST_CHECK(memcmp(image.pBits, expected.pBits, static_cast<size_t>(image.nWidth) * image.nHeight * 4) == 0);
+            FreeDecodedImage(expected);
+            FreeDecodedImage(image);
+            // 只能取走一次
+            TEST_CHECK(!preloader.Take(k, image));
+        }
+        const CImagePreloader::Stats stats = preloader.GetStats();
+        TEST_CHECK(stats.nDecoded == masks.size() - 2 && stats.nFailed == 2);
+        TEST_CHECK(stats.nDecodedByCaller == 0);
+        CDecodedImage image;
+        TEST_CHECK(!preloader.Take(masks.size(), image));
+        TEST_CHECK(!preloader.TryTake(masks.size(), image));
+    }
+    TEST_CHECK(loads == static_cast<int>(masks.size()));
+
+    // 加载函数阻塞时：排在后面的由 Take 在调用线程解码，正在解码的 Take 等它完成
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool started = false;
+        bool release = false;
+        CImagePreloader::LoadFunc blocking = [&](size_t nIndex, CImagePreloader::Source& source) {
+            if (nIndex == 0)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                started = true;
+                cond.notify_all();
+                cond.wait(lock, [&]() { return release; });
+            }
+            source.pData = kFixedHuffmanPng;
+            source.nSize = sizeof(kFixedHuffmanPng);
+            return true;
+        };
+        CImagePreloader preloader(blocking, 1);
+        preloader.Add(std::vector<unsigned int>(3, 0));
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return started; });
+        }
+        CDecodedImage image;
+        TEST_CHECK(preloader.Take(2, image));
+        FreeDecodedImage(image);
+        TEST_CHECK(preloader.GetStats().nDecodedByCaller == 1);
+        TEST_CHECK(!preloader.TryTake(0, image));
+
+        std::thread releaser([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::lock_guard<std::mutex> lock(mutex);
+            release = true;
+            cond.notify_all();
+        });
+        TEST_CHECK(preloader.Take(0, image));
+        FreeDecodedImage(image);
+        releaser.join();
+        TEST_CHECK(preloader.GetStats().nWaits == 1);
+        TEST_CHECK(preloader.Take(1, image));
+        FreeDecodedImage(image);
+    }
+
+    // Cancel 放弃还没开始的，已经解码的仍可取走；之后可以继续 Add
+    {
+        CImagePreloader preloader(load, 1);
+        preloader.Add(masks);
+        preloader.Cancel();
+        TEST_CHECK(preloader.IsIdle());
+        size_t taken = 0;
+        for (size_t k = 0; k < masks.size(); ++k)
+        {
+            CDecodedImage image;
+            if (preloader.Take(k, image))
+            {
+                ++taken;
+                FreeDecodedImage(image);
+            }
+        }
+        const CImagePreloader::Stats stats = preloader.GetStats();
+        TEST_CHECK(taken == stats.nDecoded);
+        const size_t first = preloader.Add(std::vector<unsigned int>(1, 0));
+        TEST_CHECK(first == masks.size());
+        CDecodedImage image;
+        TEST_CHECK(preloader.Take(first, image) == !images.data[0].empty());
+        TEST_CHECK(!preloader.IsIdle() || preloader.GetStats().nDecoded + preloader.GetStats().nFailed > stats.nDecoded + stats.nFailed);
+        FreeDecodedImage(image);
+    }
+}
+
+int main()
+{
+    TestConcurrentFirstDecode();
+    TestParseImageString();
+    TestCollect();
+    TestDecodeErrors();
+    TestDemoSkins();
+    TestPreloader();
+    printf("ImagePreloadTest passed\n");
+    return 0;
+}
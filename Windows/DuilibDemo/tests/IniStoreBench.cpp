@@ -0,0 +1,250 @@
+/*
+* Module:   IniStoreBench
+*
+* Function: 10k 个键的配置文件：原来 CConfigMgr 的读取（getline + UTF82Wide + 根节点双重循环）、查找和整文件重写
+*           对比 CIniStore 的加载、查找和原子保存；以及后台延迟写盘期间 UI 线程 Get 的最长等待
+*
+*    不是测试，不注册到 ctest：./IniStoreBench
+*/
+#include "IniStore.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* kIniPath = "IniStoreBench.ini";
+static const int kSections = 100;
+static const int kKeysPerSection = 100;
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 代替 Windows 上的 MultiByteToWideChar，逐字符解码 UTF-8
+static std::wstring UTF82Wide(const std::string& str)
+{
+    std::wstring out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size();)
+    {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        unsigned int cp = extra == 0 ? c : c & (0x3F >> extra);
+        for (int k = 1; k <= extra && i + k < str.size(); ++k)
+            cp = (cp << 6) | (static_cast<unsigned char>(str[i + k]) & 0x3F);
+        out.push_back(static_cast<wchar_t>(cp));
+        i += extra + 1;
+    }
+    return out;
+}
+
+static std::string Wide2UTF8(const std::wstring& str)
+{
+    std::string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        unsigned int cp = static_cast<unsigned int>(str[i]);
+        if (cp < 0x80)
+            out.push_back(static_cast<char>(cp));
+        else if (cp < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+    return out;
+}
+
+// 原来 ConfigMgr.cpp 的 InitReadINI / GetValue / SetValue / WriteINI
+class LegacyConfig
+{
+public:
+    struct ININode
+    {
+        std::wstring root;
+        std::wstring key;
+        std::wstring value;
+    };
+
+    void InitReadINI(const char* path)
+    {
+        std::ifstream in(path);
+        std::string line, root;
+        std::vector<ININode> nodes;
+        while (getline(in, line))
+        {
+            std::string::size_type left = 0, right = 0, equal = 0;
+            std::string key, value;
+            if ((line.npos != (left = line.find("["))) && (line.npos != (right = line.find("]"))))
+                root = line.substr(left + 1, right - 1);
+            if (line.npos != (equal = line.find("=")))
+            {
+                key = line.substr(0, equal);
+                value = line.substr(equal + 1, line.size() - 1);
+            }
+            if (!root.empty() && !key.empty() && !value.empty())
+            {
+                ININode node = { UTF82Wide(root), UTF82Wide(key), UTF82Wide(value) };
+                nodes.push_back(node);
+            }
+        }
+
+        std::map<std::wstring, std::wstring> roots;
+        for (size_t i = 0; i < nodes.size(); ++i)
+            roots.insert(std::make_pair(nodes[i].root, L""));
+        for (std::map<std::wstring, std::wstring>::iterator itr = roots.begin(); itr != roots.end(); ++itr)
+        {
+            std::map<std::wstring, std::wstring> sub;
+            for (size_t i = 0; i < nodes.size(); ++i)
+            {
+                if (nodes[i].root == itr->first)
+                    sub.insert(std::make_pair(nodes[i].key, nodes[i].value));
+            }
+            m_ini.insert(std::make_pair(itr->first, sub));
+        }
+    }
+
+    bool GetValue(const std::wstring& root, const std::wstring& key, std::wstring& value)
+    {
+        std::map<std::wstring, std::map<std::wstring, std::wstring>>::iterator itr = m_ini.find(root);
+        if (itr == m_ini.end())
+            return false;
+        std::map<std::wstring, std::wstring>::iterator sub = itr->second.find(key);
+        if (sub == itr->second.end() || sub->second.empty())
+            return false;
+        value = sub->second;
+        return true;
+    }
+
+    void SetValue(const std::wstring& root, const std::wstring& key, const std::wstring& value)
+    {
+        m_ini[root][key] = value;
+    }
+
+    void WriteINI(const char* path)
+    {
+        std::ofstream out(path);
+        for (std::map<std::wstring, std::map<std::wstring, std::wstring>>::iterator itr = m_ini.begin(); itr != m_ini.end(); ++itr)
+        {
+            out << "[" << Wide2UTF8(itr->first) << "]" << std::endl;
+            for (std::map<std::wstring, std::wstring>::iterator sub = itr->second.begin(); sub != itr->second.end(); ++sub)
+                out << Wide2UTF8(sub->first) << "=" << Wide2UTF8(sub->second) << std::endl;
+        }
+    }
+
+private:
+    std::map<std::wstring, std::map<std::wstring, std::wstring>> m_ini;
+};
+
+static void WriteBenchFile()
+{
+    FILE* file = fopen(kIniPath, "wb");
+    for (int s = 0; s < kSections; ++s)
+    {
+        fprintf(file, "; section %d\n[Section%d]\n", s, s);
+        for (int k = 0; k < kKeysPerSection; ++k)
+            fprintf(file, "Key%d=value_%d_%d_\xE9\x9F\xB3\xE9\x87\x8F\n", k, s, k);
+    }
+    fclose(file);
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::vector<std::pair<std::string, std::string>> lookups;
+    for (int i = 0; i < 100000; ++i)
+        lookups.push_back(std::make_pair("Section" + std::to_string(rng() % kSections), "Key" + std::to_string(rng() % kKeysPerSection)));
+    std::vector<std::pair<std::wstring, std::wstring>> wideLookups;
+    for (size_t i = 0; i < lookups.size(); ++i)
+        wideLookups.push_back(std::make_pair(UTF82Wide(lookups[i].first), UTF82Wide(lookups[i].second)));
+
+    WriteBenchFile();
+    const int kRounds = 5;
+    double legacyLoad = 0, legacyGet = 0, legacySave = 0;
+    double storeLoad = 0, storeGet = 0, storeSave = 0;
+    size_t sink = 0;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        LegacyConfig legacy;
+        double begin = Now();
+        legacy.InitReadINI(kIniPath);
+        legacyLoad += Now() - begin;
+        begin = Now();
+        std::wstring wvalue;
+        for (size_t i = 0; i < wideLookups.size(); ++i)
+            sink += legacy.GetValue(wideLookups[i].first, wideLookups[i].second, wvalue) ? wvalue.size() : 0;
+        legacyGet += Now() - begin;
+        begin = Now();
+        legacy.SetValue(L"Section0", L"Key0", L"changed");
+        legacy.WriteINI(kIniPath);
+        legacySave += Now() - begin;
+        WriteBenchFile();
+
+        CIniStore store;
+        begin = Now();
+        store.Load(kIniPath);
+        storeLoad += Now() - begin;
+        begin = Now();
+        std::string value;
+        for (size_t i = 0; i < lookups.size(); ++i)
+            sink += store.GetString(lookups[i].first, lookups[i].second, value) ? value.size() : 0;
+        storeGet += Now() - begin;
+        begin = Now();
+        store.SetString("Section0", "Key0", "changed");
+        store.Save();
+        storeSave += Now() - begin;
+        WriteBenchFile();
+    }
+    printf("%d keys           load ms   get ns   set+save ms\n", kSections * kKeysPerSection);
+    printf("CConfigMgr     %9.2f %8.1f %11.2f\n", legacyLoad / kRounds * 1e3, legacyGet / kRounds / lookups.size() * 1e9,
+        legacySave / kRounds * 1e3);
+    printf("CIniStore      %9.2f %8.1f %11.2f   (save includes fsync)\n", storeLoad / kRounds * 1e3,
+        storeGet / kRounds / lookups.size() * 1e9, storeSave / kRounds * 1e3);
+
+    // 后台写盘时 UI 线程不停地 Get；单核机器上最长的一次主要是线程切换，同时看 p99
+    {
+        CIniStore store;
+        store.Load(kIniPath);
+        store.SetAutoSave(1);
+        std::atomic<bool> stop(false);
+        std::thread writer([&]() {
+            int i = 0;
+            while (!stop)
+            {
+                store.SetInt("Section1", "Key1", ++i);
+                std::this_thread::sleep_for(std::chrono::milliseconds(3));
+            }
+        });
+        std::vector<double> samples;
+        std::string value;
+        double end = Now() + 1.0;
+        while (Now() < end)
+        {
+            double begin = Now();
+            sink += store.GetString("Section2", "Key2", value) ? 1 : 0;
+            samples.push_back(Now() - begin);
+        }
+        stop = true;
+        writer.join();
+        std::sort(samples.begin(), samples.end());
+        printf("Get during auto save: p99 %.2f us   p99.99 %.1f us   max %.1f us\n", samples[samples.size() * 99 / 100] * 1e6,
+            samples[samples.size() * 9999 / 10000] * 1e6, samples.back() * 1e6);
+    }
+    remove(kIniPath);
+    return sink == 0;
+}
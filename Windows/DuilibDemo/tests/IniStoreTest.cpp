@@ -0,0 +1,206 @@
+/*
+* Module:   IniStoreTest
+*
+* Function: CIniStore 的加载、重复键、原地覆盖、arena 整理与原子保存
+*/
+#include "IniStore.h"
+#include "TestUtil.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+static const char* kIniPath = "IniStoreTest.ini";
+
+static void WriteText(const char* path, const std::string& text)
+{
+    FILE* file = fopen(path, "wb");
+    TEST_CHECK(file != NULL);
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+}
+
+static void TestLoad()
+{
+    std::string text = "\xEF\xBB\xBF[TRTCDemo]\r\nA=1\r\n B = hello \r\n;comment\r\nE=\r\n[S2]\nx=true\n";
+    for (int i = 0; i < 1000; ++i)
+        text += "k" + std::to_string(i) + "=" + std::to_string(i) + "\n";
+    WriteText(kIniPath, text);
+
+    CIniStore store;
+    TEST_CHECK(store.Load(kIniPath));
+    TEST_CHECK(store.GetInt("TRTCDemo", "A", 0) == 1);
+    std::string value;
+    TEST_CHECK(store.GetString("TRTCDemo", "B", value) && value == "hello");
+    TEST_CHECK(!store.GetString("TRTCDemo", "E", value));
+    TEST_CHECK(store.GetBool("S2", "x", false));
+    TEST_CHECK(store.GetInt("S2", "k999", 0) == 999);
+    TEST_CHECK(store.GetSectionCount() == 2);
+    TEST_CHECK(store.GetEntryCount() == 1003);
+
+    WriteText(kIniPath, "");
+    CIniStore empty;
+    TEST_CHECK(empty.Load(kIniPath));
+    TEST_CHECK(empty.GetEntryCount() == 0);
+
+    CIniStore missing;
+    TEST_CHECK(!missing.Load("IniStoreTest.missing.ini"));
+}
+
+static void TestDuplicateKeyFirstWins()
+{
+    WriteText(kIniPath, "[S]\na=first\nb=1\na=second\n[S]\na=third\n");
+    CIniStore store;
+    TEST_CHECK(store.Load(kIniPath));
+    std::string value;
+    TEST_CHECK(store.GetString("S", "a", value) && value == "first");
+    TEST_CHECK(store.GetEntryCount() == 2);
+
+    // 加载之后的 Set 仍然覆盖
+    store.SetString("S", "a", "set");
+    TEST_CHECK(store.GetString("S", "a", value) && value == "set");
+}
+
+static void TestInPlaceOverwrite()
+{
+    WriteText(kIniPath, "[Audio]\nvolume=100\n");
+    CIniStore store;
+    TEST_CHECK(store.Load(kIniPath));
+
+    IniStrRef before;
+    TEST_CHECK(store.Get("Audio", "volume", before));
+    const char* slot = before.data;
+    for (int i = 0; i < 100000; ++i)
+        store.SetInt("Audio", "volume", i % 101);
+
+    IniStrRef after;
+    TEST_CHECK(store.Get("Audio", "volume", after));
+    TEST_CHECK(after.data == slot);
+    TEST_CHECK(store.GetInt("Audio", "volume", -1) == 99999 % 101);
+
+    // 更短的值也原地写，之后再写回原长度
+    store.SetString("Audio", "volume", "7");
+    TEST_CHECK(store.Get("Audio", "volume", after) && after.data == slot && after.size == 1);
+    store.SetString("Audio", "volume", "100");
+    TEST_CHECK(store.Get("Audio", "volume", after) && after.data == slot);
+}
+
+static void TestCompactOnSave()
+{
+    WriteText(kIniPath, "[S]\nkeep=stay\n");
+    CIniStore store;
+    TEST_CHECK(store.Load(kIniPath));
+
+    // 每次都比上一次长，旧值全部变成废弃空间
+    std::string value;
+    for (int i = 0; i < 2000; ++i)
+    {
+        value += 'x';
+        store.SetString("S", "grow", value);
+    }
+    TEST_CHECK(store.Save());
+
+    std::string read;
+    TEST_CHECK(store.GetString("S", "grow", read) && read == value);
+    TEST_CHECK(store.GetString("S", "keep", read) && read == "stay");
+    TEST_CHECK(store.GetEntryCount() == 2);
+
+    // 整理之后索引仍然可用，新键和原地覆盖都正常
+    store.SetString("S", "grow", "short");
+    store.SetString("T", "new", "v");
+    TEST_CHECK(store.GetString("S", "grow", read) && read == "short");
+    TEST_CHECK(store.GetString("T", "new", read) && read == "v");
+    TEST_CHECK(store.Save());
+
+    CIniStore reload;
+    TEST_CHECK(reload.Load(kIniPath));
+    TEST_CHECK(reload.GetString("S", "grow", read) && read == "short");
+    TEST_CHECK(reload.GetString("S", "keep", read) && read == "stay");
+    TEST_CHECK(reload.GetString("T", "new", read) && read == "v");
+}
+
+static std::string ReadText(const char* path)
+{
+    std::string text;
+    FILE* file = fopen(path, "rb");
+    TEST_CHECK(file != NULL);
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, n);
+    fclose(file);
+    return text;
+}
+
+static void TestKeepComments()
+{
+    // 注释和空行跟着后面的节或键，末尾的注释留在末尾；修改、新增的键不影响它们
+    WriteText(kIniPath, "; head\n\n[S]\n# about a\na=1\nb=2\n\n;about T\n[T]\nx=1\n; tail");
+    {
+        CIniStore store;
+        TEST_CHECK(store.Load(kIniPath));
+        store.SetInt("S", "a", 5);
+        store.SetInt("S", "c", 3);
+        TEST_CHECK(store.Save());
+    }
+    TEST_CHECK(ReadText(kIniPath) == "; head\n\n[S]\n# about a\na=5\nb=2\nc=3\n\n;about T\n[T]\nx=1\n; tail\n");
+
+    // 保存后再加载，内容不变
+    CIniStore reload;
+    TEST_CHECK(reload.Load(kIniPath));
+    reload.SetInt("S", "a", 6);
+    reload.SetInt("S", "a", 5);
+    TEST_CHECK(reload.Save());
+    TEST_CHECK(ReadText(kIniPath) == "; head\n\n[S]\n# about a\na=5\nb=2\nc=3\n\n;about T\n[T]\nx=1\n; tail\n");
+}
+
+static void TestSaveWhileSetting()
+{
+    // 写盘在锁外：Save 期间的修改不能丢，也不能被标记为已保存
+    WriteText(kIniPath, "[S]\n");
+    CIniStore store;
+    TEST_CHECK(store.Load(kIniPath));
+    std::thread saver([&store]() {
+        for (int i = 0; i < 200; ++i)
+            TEST_CHECK(store.Save());
+    });
+    for (int i = 0; i < 20000; ++i)
+        store.SetInt("S", ("k" + std::to_string(i % 50)).c_str(), i);
+    saver.join();
+    TEST_CHECK(store.Save());
+
+    CIniStore reload;
+    TEST_CHECK(reload.Load(kIniPath));
+    for (int k = 0; k < 50; ++k)
+        TEST_CHECK(reload.GetInt("S", ("k" + std::to_string(k)).c_str(), -1) == 19950 + k);
+}
+
+static void TestAutoSave()
+{
+    WriteText(kIniPath, "[S]\na=1\n");
+    {
+        CIniStore store;
+        TEST_CHECK(store.Load(kIniPath));
+        store.SetAutoSave(20);
+        store.SetInt("S", "b", 3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        CIniStore reload;
+        TEST_CHECK(reload.Load(kIniPath));
+        TEST_CHECK(reload.GetInt("S", "b", 0) == 3);
+    }
+    remove(kIniPath);
+}
+
+int main()
+{
+    TestLoad();
+    TestDuplicateKeyFirstWins();
+    TestInPlaceOverwrite();
+    TestCompactOnSave();
+    TestKeepComments();
+    TestSaveWhileSetting();
+    TestAutoSave();
+    printf("IniStoreTest passed\n");
+    return 0;
+}
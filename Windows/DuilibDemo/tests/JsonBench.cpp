@@ -0,0 +1,144 @@
+/*
+* Module:   JsonBench
+*
+* Function: 热路径 JSON 的耗时：Config.json（大用户列表）用 JsonSelect 只取需要的字段对比 Json::Reader 建整棵 DOM；
+*           登录请求体用复用的 CJsonStreamWriter 对比每次新建 writer 和 Json::FastWriter
+*
+*    不是测试，不注册到 ctest：./JsonBench [用户数]
+*/
+#include "json/json.h"
+#include "json/JsonStream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct UserInfo
+{
+    std::string userId;
+    std::string userSig;
+};
+
+static const char* const kConfigPaths[] = { "sdkappid", "users[].userId", "users[].userToken" };
+
+struct ConfigHandler : public IJsonSelectHandler
+{
+    uint64_t sdkAppId = 0;
+    std::vector<UserInfo> users;
+
+    virtual bool OnValue(size_t pathIndex, size_t arrayIndex, CJsonPullReader& reader)
+    {
+        if (pathIndex == 0)
+            return reader.GetUInt64(sdkAppId);
+        if (users.size() <= arrayIndex)
+            users.resize(arrayIndex + 1);
+        return reader.GetString(pathIndex == 1 ? users[arrayIndex].userId : users[arrayIndex].userSig);
+    }
+};
+
+static std::string MakeConfig(int userCount)
+{
+    std::string text = "{\n    \"sdkappid\": 1400188888,\n    \"comment\": \"generated\",\n    \"users\": [\n";
+    for (int i = 0; i < userCount; ++i)
+    {
+        text += "        {\"userId\": \"user_" + std::to_string(i) + "\", \"userToken\": \"";
+        // UserSig 长度与真实的差不多
+        for (int k = 0; k < 6; ++k)
+            text += "eJwtjEELgjAYQP-KR-Xg2dm2";
+        text += "\", \"extra\": {\"nick\": \"n\", \"tags\": [1, 2, 3]}}";
+        text += i + 1 < userCount ? ",\n" : "\n";
+    }
+    text += "    ]\n}\n";
+    return text;
+}
+
+template <typename Fn>
+static double Measure(int rounds, Fn fn)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+        fn(i);
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / rounds;
+}
+
+int main(int argc, char* argv[])
+{
+    int userCount = argc > 1 ? atoi(argv[1]) : 10000;
+    std::string config = MakeConfig(userCount);
+    printf("Config.json: %d users, %.1f KB\n", userCount, config.size() / 1024.0);
+
+    std::vector<UserInfo> domUsers;
+    double domUs = Measure(10, [&](int) {
+        Json::Reader reader;
+        Json::Value root;
+        if (!reader.parse(config, root))
+            exit(1);
+        domUsers.clear();
+        const Json::Value& users = root["users"];
+        for (Json::ArrayIndex i = 0; i < users.size(); ++i)
+        {
+            UserInfo info;
+            info.userId = users[i]["userId"].asString();
+            info.userSig = users[i]["userToken"].asString();
+            domUsers.push_back(info);
+        }
+    });
+
+    std::vector<UserInfo> selectUsers;
+    double selectUs = Measure(10, [&](int) {
+        ConfigHandler handler;
+        if (!JsonSelect(config.data(), config.size(), kConfigPaths, 3, handler))
+            exit(1);
+        selectUsers.swap(handler.users);
+    });
+
+    if (domUsers.size() != selectUsers.size())
+        return 1;
+    for (size_t i = 0; i < domUsers.size(); ++i)
+    {
+        if (domUsers[i].userId != selectUsers[i].userId || domUsers[i].userSig != selectUsers[i].userSig)
+            return 1;
+    }
+    printf("parse   Json::Reader %9.1f us   JsonSelect %9.1f us   (%.1fx)\n", domUs, selectUs, domUs / selectUs);
+
+    const int kRequests = 100000;
+    size_t checksum = 0;
+    double fastWriterUs = Measure(kRequests, [&](int i) {
+        Json::Value root;
+        root["pwd"] = "123";
+        root["appid"] = 1400188888;
+        root["roomnum"] = i;
+        root["privMap"] = 255;
+        root["identifier"] = "user_123";
+        Json::FastWriter writer;
+        checksum += writer.write(root).size();
+    });
+    double newWriterUs = Measure(kRequests, [&](int i) {
+        CJsonStreamWriter writer;
+        writer.BeginObject();
+        writer.Key("pwd").String("123");
+        writer.Key("appid").Int(1400188888);
+        writer.Key("roomnum").Int(i);
+        writer.Key("privMap").Int(255);
+        writer.Key("identifier").String("user_123");
+        writer.EndObject();
+        checksum += writer.size();
+    });
+    CJsonStreamWriter reused;
+    double reusedWriterUs = Measure(kRequests, [&](int i) {
+        reused.Reset();
+        reused.BeginObject();
+        reused.Key("pwd").String("123");
+        reused.Key("appid").Int(1400188888);
+        reused.Key("roomnum").Int(i);
+        reused.Key("privMap").Int(255);
+        reused.Key("identifier").String("user_123");
+        reused.EndObject();
+        checksum += reused.size();
+    });
+    printf("write   FastWriter %6.3f us   new writer %6.3f us   reused writer %6.3f us   (checksum %zu)\n",
+        fastWriterUs, newWriterUs, reusedWriterUs, checksum);
+    return 0;
+}
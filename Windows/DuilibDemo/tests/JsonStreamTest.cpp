@@ -0,0 +1,619 @@
+/*
+* Module:   JsonStreamTest
+*
+* Function: CJsonPullReader / JsonSelect / CJsonStreamWriter 以 jsoncpp 1.8 为参照：随机文档经 CJsonStreamWriter 输出
+*           与 Json::FastWriter 逐字节相同、Json::Reader 读回相等，CJsonPullReader 读 FastWriter 的输出得到相同的值；
+*           以及转义和代理对、嵌套深度、数字边界、格式错误和截断的输入（截断的输入放在刚好大小的堆缓冲里，越界读在
+*           AddressSanitizer 下会报错）、JsonSelect 的路径匹配
+*/
+#include "json/json.h"
+#include "json/JsonStream.h"
+#include "TestUtil.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// 按 jsoncpp 的规则把数字放进 Json::Value：负数和不超过 INT_MAX 的为 intValue，更大的为 uintValue，其余为 realValue
+static Json::Value NumberValue(const CJsonPullReader& reader)
+{
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0;
+    if (reader.GetInt64(i) && (i < 0 || i <= Json::Value::maxInt))
+        return Json::Value(static_cast<Json::Value::LargestInt>(i));
+    if (reader.GetUInt64(u))
+        return Json::Value(static_cast<Json::Value::LargestUInt>(u));
+    TEST_CHECK(reader.GetDouble(d));
+    return Json::Value(d);
+}
+
+// reader 停在一个值的第一个 token 上，读完整个值
+static bool ReadValue(CJsonPullReader& reader, Json::Value& value)
+{
+    std::string text;
+    switch (reader.Current())
+    {
+    case CJsonPullReader::TokenBeginObject:
+        value = Json::Value(Json::objectValue);
+        while (reader.Next() == CJsonPullReader::TokenKey)
+        {
+            std::string key;
+            if (!reader.GetString(key))
+                return false;
+            reader.Next();
+            if (!ReadValue(reader, value[key]))
+                return false;
+        }
+        return reader.Current() == CJsonPullReader::TokenEndObject;
+    case CJsonPullReader::TokenBeginArray:
+        value = Json::Value(Json::arrayValue);
+        while (reader.Next() != CJsonPullReader::TokenEndArray)
+        {
+            if (!ReadValue(reader, value[value.size()]))
+                return false;
+        }
+        return true;
+    case CJsonPullReader::TokenString:
+        if (!reader.GetString(text))
+            return false;
+        value = Json::Value(text);
+        return true;
+    case CJsonPullReader::TokenNumber:
+        value = NumberValue(reader);
+        return true;
+    case CJsonPullReader::TokenTrue:
+        value = Json::Value(true);
+        return true;
+    case CJsonPullReader::TokenFalse:
+        value = Json::Value(false);
+        return true;
+    case CJsonPullReader::TokenNull:
+        value = Json::Value();
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 整个文档读成 Json::Value，顶层值之后必须是 TokenEnd
+static bool PullParse(const std::string& text, Json::Value& value)
+{
+    CJsonPullReader reader(text.data(), text.size());
+    reader.Next();
+    return ReadValue(reader, value) && reader.Next() == CJsonPullReader::TokenEnd;
+}
+
+// 只扫描 token，不解码
+static bool PullScan(const char* data, size_t size)
+{
+    CJsonPullReader reader(data, size);
+    while (true)
+    {
+        CJsonPullReader::Token token = reader.Next();
+        if (token == CJsonPullReader::TokenError)
+            return false;
+        if (token == CJsonPullReader::TokenEnd)
+            return true;
+    }
+}
+
+static void WriteValue(const Json::Value& value, CJsonStreamWriter& writer)
+{
+    switch (value.type())
+    {
+    case Json::nullValue: writer.Null(); break;
+    case Json::intValue: writer.Int(value.asLargestInt()); break;
+    case Json::uintValue: writer.UInt(value.asLargestUInt()); break;
+    case Json::realValue: writer.Double(value.asDouble()); break;
+    case Json::booleanValue: writer.Bool(value.asBool()); break;
+    case Json::stringValue:
+    {
+        const char* begin = NULL;
+        const char* end = NULL;
+        value.getString(&begin, &end);
+        writer.String(begin, end - begin);
+        break;
+    }
+    case Json::arrayValue:
+        writer.BeginArray();
+        for (Json::ArrayIndex i = 0; i < value.size(); ++i)
+            WriteValue(value[i], writer);
+        writer.EndArray();
+        break;
+    case Json::objectValue:
+    {
+        // 与 FastWriter 一样按成员名排序输出
+        Json::Value::Members members = value.getMemberNames();
+        writer.BeginObject();
+        for (size_t i = 0; i < members.size(); ++i)
+        {
+            writer.Key(members[i].data(), members[i].size());
+            WriteValue(value[members[i]], writer);
+        }
+        writer.EndObject();
+        break;
+    }
+    }
+}
+
+static std::string RandomString(std::mt19937& rng)
+{
+    static const char* const kPieces[] = { "a", "Z", "0", " ", "\"", "\\", "/", "\b", "\f", "\n", "\r", "\t", "\x01", "\x1F",
+        "\x7F", "\xE4\xBD\xA0", "\xF0\x9F\x98\x80", "\xC3\xA9", "userSig", "" };   // 最后一项代表 '\0'
+    std::string text;
+    const int count = rng() % 12;
+    for (int i = 0; i < count; ++i)
+    {
+        const size_t piece = rng() % (sizeof(kPieces) / sizeof(kPieces[0]));
+        if (piece + 1 == sizeof(kPieces) / sizeof(kPieces[0]))
+            text.push_back('\0');
+        else
+            text += kPieces[piece];
+    }
+    return text;
+}
+
+static Json::Value RandomValue(std::mt19937& rng, int depth)
+{
+    const int kind = rng() % (depth < 6 ? 10 : 8);
+    switch (kind)
+    {
+    case 0: return Json::Value();
+    case 1: return Json::Value(rng() % 2 == 0);
+    case 2:
+    {
+        // 覆盖 jsoncpp 的 int / uint 分界和 64 位边界
+        static const int64_t kInts[] = { 0, 1, -1, 2147483647, -2147483647 - 1, INT64_MAX, INT64_MIN, 1000000007 };
+        const int64_t value = rng() % 3 == 0 ? kInts[rng() % 8] : static_cast<int64_t>(static_cast<uint64_t>(rng()) << (rng() % 32)) - (rng() % 2 ? 0 : INT64_MAX / 3);
+        if (value > Json::Value::maxInt)
+            return Json::Value(static_cast<Json::Value::LargestUInt>(value));
+        return Json::Value(static_cast<Json::Value::LargestInt>(value));
+    }
+    case 3:
+    {
+        const uint64_t value = rng() % 2 == 0 ? UINT64_MAX - rng() % 3 : (static_cast<uint64_t>(rng()) << 32) | rng();
+        return Json::Value(static_cast<Json::Value::LargestUInt>(value | 0x80000000u));
+    }
+    case 4:
+    {
+        static const double kDoubles[] = { 0.0, 0.1, -2.5, 1e300, -1e-300, 4.9e-324, 1.7976931348623157e308, 3.0, 123456789012.0 };
+        if (rng() % 2 == 0)
+            return Json::Value(kDoubles[rng() % 9]);
+        double value = static_cast<double>(rng()) / (rng() | 1) * pow(10.0, static_cast<int>(rng() % 40) - 20);
+        return Json::Value(rng() % 2 ? value : -value);
+    }
+    case 5:
+    case 6:
+    case 7:
+        return Json::Value(RandomString(rng));
+    case 8:
+    {
+        Json::Value array(Json::arrayValue);
+        const int count = rng() % 6;
+        for (int i = 0; i < count; ++i)
+            array.append(RandomValue(rng, depth + 1));
+        return array;
+    }
+    default:
+    {
+        Json::Value object(Json::objectValue);
+        const int count = rng() % 6;
+        for (int i = 0; i < count; ++i)
+            object[RandomString(rng)] = RandomValue(rng, depth + 1);
+        return object;
+    }
+    }
+}
+
+static void TestMatchesJsoncpp()
+{
+    std::mt19937 rng(32);
+    Json::FastWriter fastWriter;
+    CJsonStreamWriter writer;
+    for (int round = 0; round < 20000; ++round)
+    {
+        Json::Value root = round % 2 == 0 ? RandomValue(rng, 0) : Json::Value(Json::objectValue);
+        if (round % 2 != 0)
+            root["data"] = RandomValue(rng, 1);
+
+        // 输出与 FastWriter 逐字节相同，Reset 后复用缓冲
+        writer.Reset();
+        WriteValue(root, writer);
+        std::string expected = fastWriter.write(root);
+        expected.resize(expected.size() - 1);   // FastWriter 末尾的换行
+        TEST_CHECK(writer.str() == expected);
+
+        // jsoncpp 读回相等；strict 模式要求根节点是容器
+        Json::Reader reader(Json::Features::strictMode());
+        Json::Value parsed;
+        if (root.isObject() || root.isArray())
+        {
+            TEST_CHECK(reader.parse(writer.str(), parsed));
+            TEST_CHECK(parsed == root);
+        }
+
+        // CJsonPullReader 读回相等
+        Json::Value pulled;
+        TEST_CHECK(PullParse(writer.str(), pulled));
+        TEST_CHECK(pulled == root);
+    }
+}
+
+static void TestEscapes()
+{
+    struct
+    {
+        const char* json;
+        const char* expected;
+        size_t expectedSize;
+    } kCases[] = {
+        { "\"plain\"", "plain", 5 },
+        { "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", "\"\\/\b\f\n\r\t", 8 },
+        { "\"\\u0041\\u00e9\\u4F60\"", "A\xC3\xA9\xE4\xBD\xA0", 6 },
+        { "\"\\u0000x\"", "\0x", 2 },
+        { "\"\\ud83d\\ude00\"", "\xF0\x9F\x98\x80", 4 },            // 代理对
+        { "\"\\uDBFF\\uDFFF\"", "\xF4\x8F\xBF\xBF", 4 },            // U+10FFFF
+        { "\"\\udc00\"", "\xED\xB0\x80", 3 },                       // 单独的低位代理与 jsoncpp 一样按 3 字节输出
+        { "\"\xF0\x9F\x98\x80\"", "\xF0\x9F\x98\x80", 4 },          // 原样的 UTF-8
+    };
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i)
+    {
+        const std::string json = kCases[i].json;
+        CJsonPullReader reader(json.data(), json.size());
+        TEST_CHECK(reader.Next() == CJsonPullReader::TokenString);
+        std::string value;
+        TEST_CHECK(reader.GetString(value));
+        TEST_CHECK(value == std::string(kCases[i].expected, kCases[i].expectedSize));
+        TEST_CHECK(reader.TextEquals(kCases[i].expected, kCases[i].expectedSize));
+        TEST_CHECK(reader.Next() == CJsonPullReader::TokenEnd);
+
+        Json::Value root;
+        TEST_CHECK(Json::Reader().parse("[" + json + "]", root));
+        TEST_CHECK(root[0].asString() == value);
+    }
+
+    // 高位代理后面必须紧跟低位代理；词法上合法，解码时报错
+    const char* const kBadPairs[] = { "\"\\ud83d\"", "\"\\ud83dx\"", "\"\\ud83d\\u0041\"", "\"\\ud83d\\ud83d\"", "\"\\ud83d\\n\"" };
+    for (size_t i = 0; i < sizeof(kBadPairs) / sizeof(kBadPairs[0]); ++i)
+    {
+        CJsonPullReader reader(kBadPairs[i], strlen(kBadPairs[i]));
+        TEST_CHECK(reader.Next() == CJsonPullReader::TokenString);
+        std::string value;
+        TEST_CHECK(!reader.GetString(value));
+        TEST_CHECK(!reader.TextEquals("", 0));
+    }
+
+    // 非法转义、字符串中的控制字符
+    const char* const kBadStrings[] = { "\"\\x\"", "\"\\u12\"", "\"\\u12G4\"", "\"\\", "\"a\nb\"", "\"\t\"", "\"\\U0041\"" };
+    for (size_t i = 0; i < sizeof(kBadStrings) / sizeof(kBadStrings[0]); ++i)
+        TEST_CHECK(!PullScan(kBadStrings[i], strlen(kBadStrings[i])));
+
+    // 成员名同样解码，原文可以直接拿到
+    const std::string json = "{\"a\\nb\":1}";
+    CJsonPullReader reader(json.data(), json.size());
+    TEST_CHECK(reader.Next() == CJsonPullReader::TokenBeginObject);
+    TEST_CHECK(reader.Next() == CJsonPullReader::TokenKey);
+    TEST_CHECK(reader.TextEquals("a\nb", 3));
+    TEST_CHECK(std::string(reader.TextBegin(), reader.TextSize()) == "a\\nb");
+
+    // 输出转义：控制字符写成 \u00XX，'/' 和非 ASCII 原样
+    CJsonStreamWriter writer;
+    writer.String(std::string("\x01\x1F\x7F/\xE4\xBD\xA0\0", 8));
+    TEST_CHECK(writer.str() == "\"\\u0001\\u001F\x7F/\xE4\xBD\xA0\\u0000\"");
+}
+
+static void TestDepth()
+{
+    for (int depth = 1; depth <= CJsonPullReader::kMaxDepth + 1; ++depth)
+    {
+        const std::string arrays = std::string(depth, '[') + "1" + std::string(depth, ']');
+        std::string objects;
+        for (int i = 0; i < depth; ++i)
+            objects += "{\"k\":";
+        objects += "1" + std::string(depth, '}');
+        const bool ok = depth <= CJsonPullReader::kMaxDepth;
+        TEST_CHECK(PullScan(arrays.data(), arrays.size()) == ok);
+        TEST_CHECK(PullScan(objects.data(), objects.size()) == ok);
+
+        std::string path = "k";
+        for (int i = 1; i < depth; ++i)
+            path += ".k";
+        struct Handler : public IJsonSelectHandler
+        {
+            int calls = 0;
+            virtual bool OnValue(size_t, size_t, CJsonPullReader& reader)
+            {
+                int64_t value = 0;
+                calls += reader.GetInt64(value) && value == 1;
+                return true;
+            }
+        } handler;
+        const char* paths[] = { path.c_str() };
+        TEST_CHECK(JsonSelect(objects.data(), objects.size(), paths, 1, handler) == ok);
+        TEST_CHECK(handler.calls == (ok ? 1 : 0));
+    }
+
+    // 不进入的子树只数括号层数（不区分种类），深度不受限制，但层数必须配平
+    std::string deep = "{\"skip\":" + std::string(500, '[') + std::string(500, ']') + ",\"id\":7}";
+    struct IdHandler : public IJsonSelectHandler
+    {
+        int64_t id = 0;
+        virtual bool OnValue(size_t, size_t, CJsonPullReader& reader) { return reader.GetInt64(id); }
+    } handler;
+    const char* paths[] = { "id" };
+    TEST_CHECK(JsonSelect(deep.data(), deep.size(), paths, 1, handler) && handler.id == 7);
+    deep = "{\"skip\":[[\"]]\"]],\"id\":7}";
+    TEST_CHECK(JsonSelect(deep.data(), deep.size(), paths, 1, handler));
+    deep = "{\"skip\":[[],\"id\":7}";
+    TEST_CHECK(!JsonSelect(deep.data(), deep.size(), paths, 1, handler));
+}
+
+static CJsonPullReader::Token ReadNumber(const char* text, CJsonPullReader& reader)
+{
+    reader = CJsonPullReader(text, strlen(text));
+    return reader.Next();
+}
+
+static void TestNumbers()
+{
+    CJsonPullReader reader(NULL, 0);
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0;
+
+    TEST_CHECK(ReadNumber("9223372036854775807", reader) == CJsonPullReader::TokenNumber && reader.GetInt64(i) && i == INT64_MAX);
+    TEST_CHECK(ReadNumber("-9223372036854775808", reader) == CJsonPullReader::TokenNumber && reader.GetInt64(i) && i == INT64_MIN);
+    TEST_CHECK(ReadNumber("9223372036854775808", reader) == CJsonPullReader::TokenNumber && !reader.GetInt64(i));
+    TEST_CHECK(reader.GetUInt64(u) && u == 9223372036854775808ULL);
+    TEST_CHECK(ReadNumber("-9223372036854775809", reader) == CJsonPullReader::TokenNumber && !reader.GetInt64(i));
+    TEST_CHECK(ReadNumber("18446744073709551615", reader) == CJsonPullReader::TokenNumber && reader.GetUInt64(u) && u == UINT64_MAX);
+    TEST_CHECK(ReadNumber("18446744073709551616", reader) == CJsonPullReader::TokenNumber && !reader.GetUInt64(u) && !reader.GetInt64(i));
+    TEST_CHECK(reader.GetDouble(d) && d == 18446744073709551616.0);
+    TEST_CHECK(ReadNumber("-0", reader) == CJsonPullReader::TokenNumber && reader.GetInt64(i) && i == 0 && !reader.GetUInt64(u));
+    TEST_CHECK(ReadNumber("-1", reader) == CJsonPullReader::TokenNumber && !reader.GetUInt64(u));
+
+    // 小数和指数形式只能按 double 读
+    TEST_CHECK(ReadNumber("1.0", reader) == CJsonPullReader::TokenNumber && !reader.GetInt64(i) && !reader.GetUInt64(u));
+    TEST_CHECK(reader.GetDouble(d) && d == 1.0);
+    TEST_CHECK(ReadNumber("1e2", reader) == CJsonPullReader::TokenNumber && !reader.GetInt64(i) && reader.GetDouble(d) && d == 100.0);
+    TEST_CHECK(ReadNumber("-2.5E-3", reader) == CJsonPullReader::TokenNumber && reader.GetDouble(d) && d == -2.5e-3);
+    TEST_CHECK(ReadNumber("1e+400", reader) == CJsonPullReader::TokenNumber && reader.GetDouble(d) && isinf(d));
+    TEST_CHECK(ReadNumber("4.9e-324", reader) == CJsonPullReader::TokenNumber && reader.GetDouble(d) && d == 4.9e-324);
+    // GetDouble 的文本长度上限是 63 个字符
+    const std::string longNumber = "0." + std::string(61, '1');
+    TEST_CHECK(ReadNumber(longNumber.c_str(), reader) == CJsonPullReader::TokenNumber && reader.GetDouble(d));
+    const std::string tooLong = "0." + std::string(62, '1');
+    TEST_CHECK(ReadNumber(tooLong.c_str(), reader) == CJsonPullReader::TokenNumber && !reader.GetDouble(d));
+
+    // 类型不符
+    TEST_CHECK(ReadNumber("\"1\"", reader) == CJsonPullReader::TokenString && !reader.GetInt64(i) && !reader.GetDouble(d));
+    bool b = false;
+    TEST_CHECK(ReadNumber("true", reader) == CJsonPullReader::TokenTrue && reader.GetBool(b) && b && !reader.GetInt64(i));
+
+    // RFC 8259 不允许的写法；其中 "01" "1." "-" Json::Reader 会接受
+    const char* const kBad[] = { "01", "-01", "1.", ".5", "-", "+1", "1e", "1e+", "1.e5", "0x10", "NaN", "Infinity", "-Infinity",
+        "1 2", "--1", "1.5.2", "tru", "nul", "True" };
+    for (size_t k = 0; k < sizeof(kBad) / sizeof(kBad[0]); ++k)
+    {
+        TEST_CHECK(!PullScan(kBad[k], strlen(kBad[k])));
+        const std::string inArray = std::string("[") + kBad[k] + "]";
+        TEST_CHECK(!PullScan(inArray.data(), inArray.size()));
+    }
+
+    // 写出的数字读回不变
+    CJsonStreamWriter writer;
+    writer.BeginArray().Int(INT64_MIN).Int(INT64_MAX).UInt(UINT64_MAX).Int(0).Double(0.1).Double(-0.0).Double(1e300)
+        .Double(std::numeric_limits<double>::quiet_NaN()).Double(std::numeric_limits<double>::infinity())
+        .Double(-std::numeric_limits<double>::infinity()).EndArray();
+    TEST_CHECK(writer.str() == "[-9223372036854775808,9223372036854775807,18446744073709551615,0,0.10000000000000001,-0.0,"
+        "1.0000000000000001e+300,null,1e+9999,-1e+9999]");
+    Json::Value array(Json::arrayValue);
+    array.append(Json::Value(std::numeric_limits<double>::quiet_NaN()));
+    array.append(Json::Value(std::numeric_limits<double>::infinity()));
+    array.append(Json::Value(-std::numeric_limits<double>::infinity()));
+    TEST_CHECK(Json::FastWriter().write(array) == "[null,1e+9999,-1e+9999]\n");
+    // Json::Reader 用 istringstream 解析，读不回自己写出的 1e+9999；CJsonPullReader 按 strtod 读成 Inf
+    CJsonPullReader numbers(writer.c_str(), writer.size());
+    std::vector<double> values;
+    while (numbers.Next() != CJsonPullReader::TokenEnd)
+    {
+        TEST_CHECK(numbers.Current() != CJsonPullReader::TokenError);
+        if (numbers.GetDouble(d))
+            values.push_back(d);
+    }
+    TEST_CHECK(values.size() == 9 && values[4] == 0.1 && values[7] == std::numeric_limits<double>::infinity() && values[8] < 0);
+}
+
+static void TestMalformedAndTruncated()
+{
+    const char* const kBad[] = { "", " ", "{", "}", "[", "]", "[1,]", "[,1]", "[1 2]", "{\"a\"}", "{\"a\":}", "{\"a\" 1}",
+        "{\"a\":1,}", "{,\"a\":1}", "{a:1}", "{'a':1}", "{1:1}", "[1}", "{\"a\":1]", "[1]]", "[1] [2]", "[1]x", "\"abc",
+        "[\"abc]", "// c\n[1]", "[1] // c", "[/* c */1]", "{\"a\":1 \"b\":2}", "[\x01]" };
+    for (size_t i = 0; i < sizeof(kBad) / sizeof(kBad[0]); ++i)
+    {
+        TEST_CHECK(!PullScan(kBad[i], strlen(kBad[i])));
+        Json::Value value;
+        TEST_CHECK(!PullParse(kBad[i], value));
+    }
+
+    // 出错之后一直返回 TokenError，ErrorOffset 指向出错位置附近
+    CJsonPullReader reader("[1,]", 4);
+    while (reader.Next() != CJsonPullReader::TokenError)
+        ;
+    TEST_CHECK(reader.ErrorOffset() == 3);
+    TEST_CHECK(reader.Next() == CJsonPullReader::TokenError);
+
+    // 合法的空白、BOM 和顶层标量
+    const char* const kGood[] = { " [ ] ", "\t{\r\n}\n", "\xEF\xBB\xBF{\"a\":[]}", "0", "-1.5e3", "\"s\"", "true", "null",
+        "[[],{},[{}]]", "{\"\":\"\"}" };
+    for (size_t i = 0; i < sizeof(kGood) / sizeof(kGood[0]); ++i)
+        TEST_CHECK(PullScan(kGood[i], strlen(kGood[i])));
+
+    // 合法文档的每一个真前缀都必须报错且不越界：前缀拷到刚好大小的缓冲里
+    std::mt19937 rng(7);
+    for (int round = 0; round < 300; ++round)
+    {
+        Json::Value root(Json::objectValue);
+        root["users"] = RandomValue(rng, 1);
+        root["s"] = RandomString(rng);
+        root["n"] = -12.5e-3;
+        CJsonStreamWriter writer;
+        WriteValue(root, writer);
+        const std::string& text = writer.str();
+        for (size_t size = 0; size < text.size(); ++size)
+        {
+            std::vector<char> prefix(text.begin(), text.begin() + size);
+            TEST_CHECK(!PullScan(prefix.empty() ? NULL : &prefix[0], size));
+
+            struct Handler : public IJsonSelectHandler
+            {
+                std::string value;
+                virtual bool OnValue(size_t, size_t, CJsonPullReader& reader) { reader.GetString(value); return true; }
+            } handler;
+            const char* paths[] = { "s", "users" };
+            TEST_CHECK(!JsonSelect(prefix.empty() ? NULL : &prefix[0], size, paths, 2, handler));
+        }
+        TEST_CHECK(PullScan(text.data(), text.size()));
+    }
+
+    // 在被跳过的子树里截断同样报错
+    const std::string skipped = "{\"skip\":[\"a\\\"]\",{\"b\":[1]}],\"id\":1}";
+    for (size_t size = 0; size < skipped.size(); ++size)
+    {
+        std::vector<char> prefix(skipped.begin(), skipped.begin() + size);
+        struct Handler : public IJsonSelectHandler
+        {
+            virtual bool OnValue(size_t, size_t, CJsonPullReader&) { return true; }
+        } handler;
+        const char* paths[] = { "id" };
+        TEST_CHECK(!JsonSelect(prefix.empty() ? NULL : &prefix[0], size, paths, 1, handler));
+    }
+}
+
+struct RecordHandler : public IJsonSelectHandler
+{
+    std::vector<std::string> calls;     // "路径下标:arrayIndex:值的原文"
+    size_t stopAfter = static_cast<size_t>(-1);
+
+    virtual bool OnValue(size_t pathIndex, size_t arrayIndex, CJsonPullReader& reader)
+    {
+        calls.push_back(std::to_string(pathIndex) + ":" + std::to_string(arrayIndex) + ":" +
+            std::string(reader.TextBegin(), reader.TextSize()));
+        return calls.size() < stopAfter;
+    }
+};
+
+static void TestSelect()
+{
+    const std::string json = "{\"errorCode\":0,\"data\":{\"userSig\":\"sig\",\"token\":{\"x\":1}},"
+        "\"users\":[{\"userId\":\"u0\",\"userToken\":\"t0\"},{\"skip\":[1,{\"userId\":\"no\"}]},{\"userId\":\"u2\"}],"
+        "\"matrix\":[[1,2],[3]],\"TLS.time\":5,\"a\\u002eb\":6,\"errorCode2\":9}";
+    const char* const paths[] = { "errorCode", "data.userSig", "users[].userId", "matrix[][]", "TLS\\.time", "a.b", "data.token",
+        "users" };
+    RecordHandler handler;
+    TEST_CHECK(JsonSelect(json.data(), json.size(), paths, sizeof(paths) / sizeof(paths[0]), handler));
+    const char* const expected[] = { "0:0:0", "1:0:sig", "6:0:{", "7:0:[", "2:0:u0", "2:2:u2", "3:0:1", "3:1:2", "3:0:3", "4:0:5" };
+    TEST_CHECK(handler.calls.size() == sizeof(expected) / sizeof(expected[0]));
+    for (size_t i = 0; i < handler.calls.size(); ++i)
+        TEST_CHECK(handler.calls[i] == expected[i]);
+
+    // 回调返回 false 时提前结束，后面的内容即使有错也不再检查
+    RecordHandler stopping;
+    stopping.stopAfter = 2;
+    const std::string broken = json.substr(0, json.find("\"users\"")) + "\"users\":[}";
+    TEST_CHECK(JsonSelect(broken.data(), broken.size(), paths, sizeof(paths) / sizeof(paths[0]), stopping));
+    TEST_CHECK(stopping.calls.size() == 2);
+
+    // 选中的容器由调用方读取时，JsonSelect 照常进入（users 同时是 users[].userId 的前缀）
+    RecordHandler none;
+    const char* const nothing[] = { "missing", "users[].missing" };
+    TEST_CHECK(JsonSelect(json.data(), json.size(), nothing, 2, none) && none.calls.empty());
+    TEST_CHECK(JsonSelect("[]", 2, nothing, 2, none) && none.calls.empty());
+    TEST_CHECK(!JsonSelect(json.data(), json.size() - 1, nothing, 2, none));
+
+    // 与 jsoncpp 取同一个字段
+    std::mt19937 rng(3);
+    for (int round = 0; round < 2000; ++round)
+    {
+        Json::Value root(Json::objectValue);
+        Json::Value& users = root["users"];
+        users = Json::Value(Json::arrayValue);
+        const int count = rng() % 8;
+        for (int i = 0; i < count; ++i)
+        {
+            Json::Value user = RandomValue(rng, 3);
+            if (rng() % 4 != 0)
+            {
+                if (!user.isObject())
+                    user = Json::Value(Json::objectValue);
+                user["userId"] = RandomString(rng);
+            }
+            users.append(user);
+        }
+        root["noise"] = RandomValue(rng, 1);
+        CJsonStreamWriter writer;
+        WriteValue(root, writer);
+
+        struct UserIdHandler : public IJsonSelectHandler
+        {
+            std::vector<std::pair<size_t, std::string> > ids;
+            virtual bool OnValue(size_t, size_t arrayIndex, CJsonPullReader& reader)
+            {
+                std::string id;
+                if (!reader.GetString(id))
+                    return false;
+                ids.push_back(std::make_pair(arrayIndex, id));
+                return true;
+            }
+        } idHandler;
+        const char* const userPaths[] = { "users[].userId" };
+        TEST_CHECK(JsonSelect(writer.str().data(), writer.size(), userPaths, 1, idHandler));
+        size_t next = 0;
+        for (Json::ArrayIndex i = 0; i < users.size(); ++i)
+        {
+            if (!users[i].isObject() || !users[i].isMember("userId"))
+                continue;
+            TEST_CHECK(next < idHandler.ids.size());
+            TEST_CHECK(idHandler.ids[next].first == i && idHandler.ids[next].second == users[i]["userId"].asString());
+            ++next;
+        }
+        TEST_CHECK(next == idHandler.ids.size());
+    }
+}
+
+static void TestWriterStructure()
+{
+    CJsonStreamWriter writer(4);
+    writer.BeginObject().Key("a").BeginArray().EndArray().Key("b").BeginObject().EndObject().Key("c").BeginArray()
+        .BeginObject().Key("d").Null().EndObject().Bool(false).String("e").EndArray().EndObject();
+    TEST_CHECK(writer.str() == "{\"a\":[],\"b\":{},\"c\":[{\"d\":null},false,\"e\"]}");
+    TEST_CHECK(strcmp(writer.c_str(), writer.str().c_str()) == 0 && writer.size() == writer.str().size());
+
+    // Reset 之后从头开始，不残留逗号状态
+    const size_t capacity = writer.str().capacity();
+    writer.Reset();
+    TEST_CHECK(writer.size() == 0 && writer.str().capacity() == capacity);
+    writer.BeginArray().Int(1).EndArray();
+    TEST_CHECK(writer.str() == "[1]");
+    writer.Reset();
+    writer.Key(std::string("k\0\"", 3).data(), 3).String("v");
+    TEST_CHECK(writer.str() == "\"k\\u0000\\\"\":\"v\"");
+}
+
+int main()
+{
+    TestMatchesJsoncpp();
+    TestEscapes();
+    TestDepth();
+    TestNumbers();
+    TestMalformedAndTruncated();
+    TestSelect();
+    TestWriterStructure();
+    printf("JsonStreamTest passed\n");
+    return 0;
+}
@@ -0,0 +1,255 @@
+/*
+* Module:   LayoutEngineBench
+*
+* Function: 深层控件树的布局耗时：每层 5 个子控件、6 层（19531 个控件），纵向、横向、平铺容器按层交替，
+*           叶子一半固定尺寸、一半按宽度折行的文字。对比原来的 SetPos 循环（LegacyLayout.h，每个容器都往下
+*           整棵子树 SetPos）和 CLayoutEngine 加上 CContainerUI::SetChildPos 的跳过规则（位置没变、自己和
+*           子孙都不需要更新的子控件不再 SetPos）。场景：第一次布局、几何不变时从根重新布局、一个叶子
+*           NeedUpdate 后从根重新布局、根宽度每轮在 1920 和 1921 之间来回。两边的结果逐个控件比较
+*
+*    不是测试，不注册到 ctest：./LayoutEngineBench [轮数]
+*/
+#include "UILayoutEngine.h"
+#include "LegacyLayout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace DuiLib;
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 带子控件的模拟容器。bEngine 为 false 时按原来的循环布局，为 true 时走 CLayoutEngine 和跳过规则
+class TreeControl : public LegacyControl
+{
+public:
+    TreeControl() : pParent(NULL), kind(kLayoutVertical), bEngine(false), bUpdateNeeded(true), bChildUpdateNeeded(false)
+    {
+        layout.m_pHorizontalScrollBar = NULL;
+        layout.m_pVerticalScrollBar = NULL;
+        layout.m_iChildPadding = 4;
+        layout.nAlign = LAYOUT_ALIGN_NEAR;
+        layout.m_szItem.cx = layout.m_szItem.cy = 0;
+        layout.m_nColumns = 1;
+    }
+
+    virtual void SetPos(TLayoutRect rc)
+    {
+        if (rc.right < rc.left) rc.right = rc.left;
+        if (rc.bottom < rc.top) rc.bottom = rc.top;
+        LegacyControl::SetPos(rc);
+        bUpdateNeeded = false;
+        bChildUpdateNeeded = false;
+        if (children.empty())
+            return;
+
+        const TLayoutRect rcInner = { rc.left + 2, rc.top + 2, rc.right - 2, rc.bottom - 2 };
+        if (!bEngine)
+        {
+            LegacyArrange(kind, layout, rcInner);
+            return;
+        }
+        EngineArrange(kind, layout, rcInner, aItems);
+        for (size_t i = 0; i < aItems.size(); ++i)
+            SetChildPos(static_cast<TreeControl*>(aItems[i].pData), aItems[i].rcPos);
+    }
+
+    // CContainerUI::SetChildPos
+    static void SetChildPos(TreeControl* pControl, TLayoutRect rc)
+    {
+        if (rc.right < rc.left) rc.right = rc.left;
+        if (rc.bottom < rc.top) rc.bottom = rc.top;
+        if (!pControl->bUpdateNeeded && !pControl->bChildUpdateNeeded)
+        {
+            const TLayoutRect& rcOld = pControl->GetPos();
+            if (rcOld.left == rc.left && rcOld.top == rc.top && rcOld.right == rc.right && rcOld.bottom == rc.bottom)
+                return;
+        }
+        pControl->SetPos(rc);
+    }
+
+    // CControlUI::NeedUpdate：自己需要更新，祖先都标记有子孙需要更新
+    void NeedUpdate()
+    {
+        bUpdateNeeded = true;
+        for (TreeControl* p = pParent; p != NULL; p = p->pParent)
+            p->bChildUpdateNeeded = true;
+    }
+
+public:
+    TreeControl* pParent;
+    LegacyLayoutKind kind;
+    bool bEngine;
+    bool bUpdateNeeded;
+    bool bChildUpdateNeeded;
+    LegacyContainer layout;
+    std::vector<std::unique_ptr<TreeControl> > children;
+    std::vector<TLayoutItem> aItems;
+};
+
+static const int kFanout = 5;
+static const int kDepth = 6;
+
+static void BuildTree(TreeControl* pNode, int nDepth, unsigned int& seed, bool bEngine)
+{
+    pNode->bEngine = bEngine;
+    if (nDepth == kDepth)
+        return;
+    static const LegacyLayoutKind kKinds[] = { kLayoutVertical, kLayoutHorizontal, kLayoutTile };
+    pNode->kind = kKinds[nDepth % 3];
+    if (pNode->kind == kLayoutTile)
+        pNode->layout.m_szItem.cx = 120;
+    for (int i = 0; i < kFanout; ++i)
+    {
+        std::unique_ptr<TreeControl> pChild(new TreeControl);
+        pChild->pParent = pNode;
+        seed = seed * 1103515245u + 12345u;
+        const unsigned int r = seed >> 16;
+        pChild->rcPadding.left = pChild->rcPadding.right = static_cast<int>(r % 3);
+        if (nDepth + 1 == kDepth)
+        {
+            if (r & 1)
+            {
+                pChild->szFixed.cx = 20 + static_cast<int>(r % 60);
+                pChild->szFixed.cy = 16 + static_cast<int>(r % 20);
+            }
+            else
+            {
+                pChild->nTextWidth = 40 + static_cast<int>(r % 300);
+            }
+        }
+        else if (r % 4 == 0)
+        {
+            // 部分容器固定一边，像皮肤里固定高度的工具栏
+            if (pNode->kind == kLayoutVertical)
+                pChild->szFixed.cy = 200;
+            else
+                pChild->szFixed.cx = 200;
+        }
+        pNode->layout.m_items.push_back(pChild.get());
+        pNode->children.push_back(std::move(pChild));
+        BuildTree(pNode->children.back().get(), nDepth + 1, seed, bEngine);
+    }
+}
+
+struct TreeStats
+{
+    long long nEstimateCalls;
+    long long nSetPosCalls;
+    size_t nNodes;
+};
+
+static void CollectStats(TreeControl* pNode, TreeStats& stats)
+{
+    stats.nEstimateCalls += pNode->nEstimateCalls;
+    stats.nSetPosCalls += pNode->nSetPosCalls;
+    ++stats.nNodes;
+    pNode->nEstimateCalls = pNode->nSetPosCalls = 0;
+    for (size_t i = 0; i < pNode->children.size(); ++i)
+        CollectStats(pNode->children[i].get(), stats);
+}
+
+static bool SameTree(const TreeControl* a, const TreeControl* b)
+{
+    const TLayoutRect& ra = a->GetPos();
+    const TLayoutRect& rb = b->GetPos();
+    if (ra.left != rb.left || ra.top != rb.top || ra.right != rb.right || ra.bottom != rb.bottom)
+        return false;
+    for (size_t i = 0; i < a->children.size(); ++i)
+    {
+        if (!SameTree(a->children[i].get(), b->children[i].get()))
+            return false;
+    }
+    return true;
+}
+
+static TreeControl* MiddleLeaf(TreeControl* pNode)
+{
+    while (!pNode->children.empty())
+        pNode = pNode->children[pNode->children.size() / 2].get();
+    return pNode;
+}
+
+static int g_nFailures = 0;
+
+// 同一场景两棵树各跑 rounds 次，偶数轮用 rcEven、奇数轮用 rcOdd，prepare 在每轮计时前调用
+template<typename Prepare>
+static void Run(const char* pName, TreeControl& legacy, TreeControl& engine, int rounds,
+    const TLayoutRect& rcEven, const TLayoutRect& rcOdd, Prepare prepare)
+{
+    double legacyTime = 0.0, engineTime = 0.0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        const TLayoutRect& rc = (r & 1) ? rcOdd : rcEven;
+        prepare(legacy);
+        double begin = Now();
+        legacy.SetPos(rc);
+        legacyTime += Now() - begin;
+
+        prepare(engine);
+        begin = Now();
+        engine.SetPos(rc);
+        engineTime += Now() - begin;
+    }
+    TreeStats legacyStats = { 0, 0, 0 }, engineStats = { 0, 0, 0 };
+    CollectStats(&legacy, legacyStats);
+    CollectStats(&engine, engineStats);
+    const bool bSame = SameTree(&legacy, &engine);
+    if (!bSame)
+        ++g_nFailures;
+    printf("%-24s old %8.3f ms %7lld SetPos %7lld Estimate   engine %8.3f ms %7lld SetPos %7lld Estimate   %s\n",
+        pName, legacyTime * 1000.0 / rounds, legacyStats.nSetPosCalls / rounds, legacyStats.nEstimateCalls / rounds,
+        engineTime * 1000.0 / rounds, engineStats.nSetPosCalls / rounds, engineStats.nEstimateCalls / rounds,
+        bSame ? "same" : "MISMATCH");
+}
+
+static void PrepareNothing(TreeControl&)
+{
+}
+
+static void PrepareAllDirty(TreeControl& root)
+{
+    struct Local
+    {
+        static void Mark(TreeControl* pNode)
+        {
+            pNode->bUpdateNeeded = true;
+            for (size_t i = 0; i < pNode->children.size(); ++i)
+                Mark(pNode->children[i].get());
+        }
+    };
+    Local::Mark(&root);
+}
+
+static void PrepareOneLeaf(TreeControl& root)
+{
+    MiddleLeaf(&root)->NeedUpdate();
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 50;
+    TreeControl legacy, engine;
+    unsigned int seed = 1;
+    BuildTree(&legacy, 0, seed, false);
+    seed = 1;
+    BuildTree(&engine, 0, seed, true);
+    TreeStats stats = { 0, 0, 0 };
+    CollectStats(&legacy, stats);
+    printf("%zu controls, fanout %d, depth %d, %d rounds\n", stats.nNodes, kFanout, kDepth, rounds);
+
+    const TLayoutRect rc = { 0, 0, 1920, 1080 };
+    const TLayoutRect rcWider = { 0, 0, 1921, 1080 };
+    Run("full layout (all dirty)", legacy, engine, rounds, rc, rc, PrepareAllDirty);
+    Run("root, nothing changed", legacy, engine, rounds, rc, rc, PrepareNothing);
+    Run("root, one leaf dirty", legacy, engine, rounds, rc, rc, PrepareOneLeaf);
+    // 宽度在两个值之间来回，每轮都有变化
+    Run("root width +-1", legacy, engine, rounds, rcWider, rc, PrepareNothing);
+    return g_nFailures == 0 ? 0 : 1;
+}
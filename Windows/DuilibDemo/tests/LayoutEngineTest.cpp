@@ -0,0 +1,275 @@
+/*
+* Module:   LayoutEngineTest
+*
+* Function: CLayoutEngine 与原来的 SetPos 循环（LegacyLayout.h）对照：随机的子控件（内边距、固定/最小/最大尺寸、
+*           折行文字、隐藏和浮动）、滚动条、对齐方式、平铺的列数和 itemsize，纵向、横向、平铺三种布局
+*           得到的位置、需要的尺寸和列数都要一致；另外检查测量缓存和几个手算的例子
+*/
+#include "UILayoutEngine.h"
+#include "LegacyLayout.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+static bool SameRect(const TLayoutRect& a, const TLayoutRect& b)
+{
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+static bool SameSize(const TLayoutSize& a, const TLayoutSize& b)
+{
+    return a.cx == b.cx && a.cy == b.cy;
+}
+
+static TLayoutRect MakeRect(int left, int top, int right, int bottom)
+{
+    TLayoutRect rc = { left, top, right, bottom };
+    return rc;
+}
+
+// 按引用计数测量次数的 ILayoutMeasure，返回固定尺寸
+class CountingMeasure : public ILayoutMeasure
+{
+public:
+    CountingMeasure() : nCalls(0) {}
+
+    virtual TLayoutSize Measure(const TLayoutItem& item, TLayoutSize szAvailable)
+    {
+        (void)szAvailable;
+        ++nCalls;
+        return item.szFixed;
+    }
+
+    int nCalls;
+};
+
+static TLayoutItem MakeItem(int cxFixed, int cyFixed)
+{
+    TLayoutItem item;
+    item.pData = NULL;
+    item.rcPadding = MakeRect(0, 0, 0, 0);
+    item.szFixed.cx = cxFixed;
+    item.szFixed.cy = cyFixed;
+    item.szMin.cx = item.szMin.cy = 0;
+    item.szMax.cx = item.szMax.cy = 9999;
+    CLayoutEngine::ResetItem(item);
+    return item;
+}
+
+static TLayoutBox MakeBox(TLayoutRect rc, int iChildPadding)
+{
+    TLayoutBox box = { rc, { 0, 0 }, { 0, 0 }, iChildPadding, LAYOUT_ALIGN_NEAR };
+    return box;
+}
+
+static void TestVerticalByHand()
+{
+    // 固定 30 高，两个自适应的平分 100 - 30 - 2 * 5 = 60，最后一个拿走余数
+    std::vector<TLayoutItem> items;
+    items.push_back(MakeItem(0, 30));
+    items.push_back(MakeItem(0, 0));
+    items.push_back(MakeItem(0, 0));
+    items[2].rcPadding = MakeRect(4, 1, 6, 0);
+    CountingMeasure measure;
+    TLayoutSize szNeeded = CLayoutEngine::ArrangeVertical(MakeBox(MakeRect(10, 20, 110, 120), 5), items, &measure);
+    TEST_CHECK(SameRect(items[0].rcPos, MakeRect(10, 20, 110, 50)));
+    TEST_CHECK(SameRect(items[1].rcPos, MakeRect(10, 55, 110, 84)));
+    TEST_CHECK(SameRect(items[2].rcPos, MakeRect(14, 90, 104, 120)));
+    TEST_CHECK(szNeeded.cx == 10 && szNeeded.cy == 100);
+    // 自适应的第二遍约束变了要重新测量，固定的只测一次
+    TEST_CHECK(measure.nCalls == 5);
+}
+
+static void TestHorizontalAlign()
+{
+    std::vector<TLayoutItem> items;
+    items.push_back(MakeItem(40, 0));
+    items.push_back(MakeItem(0, 0));
+    items[0].szMax.cy = 20;
+    CountingMeasure measure;
+    TLayoutBox box = MakeBox(MakeRect(0, 0, 200, 100), 0);
+    box.nAlign = LAYOUT_ALIGN_CENTER;
+    CLayoutEngine::ArrangeHorizontal(box, items, &measure);
+    TEST_CHECK(SameRect(items[0].rcPos, MakeRect(0, 40, 40, 60)));
+    TEST_CHECK(SameRect(items[1].rcPos, MakeRect(40, 0, 200, 100)));
+
+    box.nAlign = LAYOUT_ALIGN_FAR;
+    for (size_t i = 0; i < items.size(); ++i)
+        CLayoutEngine::ResetItem(items[i]);
+    CLayoutEngine::ArrangeHorizontal(box, items, &measure);
+    TEST_CHECK(SameRect(items[0].rcPos, MakeRect(0, 80, 40, 100)));
+}
+
+static void TestTileColumns()
+{
+    std::vector<TLayoutItem> items;
+    for (int i = 0; i < 5; ++i)
+        items.push_back(MakeItem(30, 20));
+    CountingMeasure measure;
+    TLayoutSize szItem = { 100, 0 };
+    int nColumns = 1;
+    TLayoutSize szNeeded = CLayoutEngine::ArrangeTile(MakeBox(MakeRect(0, 0, 250, 300), 0), szItem, nColumns, items, &measure);
+    // 250 / 100 两列，每列 125 宽，格子内居中
+    TEST_CHECK(nColumns == 2);
+    TEST_CHECK(SameRect(items[0].rcPos, MakeRect(47, 0, 77, 20)));
+    TEST_CHECK(SameRect(items[3].rcPos, MakeRect(172, 20, 202, 40)));
+    TEST_CHECK(SameRect(items[4].rcPos, MakeRect(47, 40, 77, 60)));
+    TEST_CHECK(szNeeded.cy == 60);
+}
+
+static void TestMeasureCache()
+{
+    TLayoutItem item = MakeItem(10, 10);
+    CountingMeasure measure;
+    TLayoutSize a = { 100, 50 }, b = { 80, 50 }, c = { 60, 50 };
+    CLayoutEngine::Measure(item, a, &measure);
+    CLayoutEngine::Measure(item, a, &measure);
+    CLayoutEngine::Measure(item, b, &measure);
+    CLayoutEngine::Measure(item, b, &measure);
+    TEST_CHECK(measure.nCalls == 2);
+    // 第三种约束占用第二个位置，第一个仍然命中
+    CLayoutEngine::Measure(item, c, &measure);
+    CLayoutEngine::Measure(item, a, &measure);
+    CLayoutEngine::Measure(item, c, &measure);
+    TEST_CHECK(measure.nCalls == 3);
+    CLayoutEngine::Measure(item, b, &measure);
+    TEST_CHECK(measure.nCalls == 4);
+    CLayoutEngine::ResetItem(item);
+    CLayoutEngine::Measure(item, a, &measure);
+    TEST_CHECK(measure.nCalls == 5);
+}
+
+struct RandomLayout
+{
+    LegacyContainer layout;
+    std::vector<std::unique_ptr<LegacyControl> > controls;
+    LegacyScrollBar hscroll;
+    LegacyScrollBar vscroll;
+};
+
+static void MakeRandomLayout(std::mt19937& rng, RandomLayout& out)
+{
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> padding(0, 8);
+    std::uniform_int_distribution<int> fixed(1, 200);
+    std::uniform_int_distribution<int> bound(0, 60);
+    std::uniform_int_distribution<int> text(10, 600);
+    const int nItems = std::uniform_int_distribution<int>(0, 12)(rng);
+    for (int i = 0; i < nItems; ++i)
+    {
+        std::unique_ptr<LegacyControl> pControl(new LegacyControl);
+        pControl->bVisible = percent(rng) < 90;
+        pControl->bFloat = percent(rng) < 5;
+        if (percent(rng) < 50)
+            pControl->rcPadding = MakeRect(padding(rng), padding(rng), padding(rng), padding(rng));
+        if (percent(rng) < 50)
+            pControl->szFixed.cx = fixed(rng);
+        if (percent(rng) < 50)
+            pControl->szFixed.cy = fixed(rng);
+        if (percent(rng) < 30)
+            pControl->szMin.cx = bound(rng);
+        if (percent(rng) < 30)
+            pControl->szMin.cy = bound(rng);
+        if (percent(rng) < 30)
+            pControl->szMax.cx = bound(rng) * 5;
+        if (percent(rng) < 30)
+            pControl->szMax.cy = bound(rng) * 5;
+        if (percent(rng) < 40)
+            pControl->nTextWidth = text(rng);
+        out.layout.m_items.push_back(pControl.get());
+        out.controls.push_back(std::move(pControl));
+    }
+
+    LegacyScrollBar* aScrollBars[2] = { &out.hscroll, &out.vscroll };
+    LegacyScrollBar** aTargets[2] = { &out.layout.m_pHorizontalScrollBar, &out.layout.m_pVerticalScrollBar };
+    for (int i = 0; i < 2; ++i)
+    {
+        aScrollBars[i]->bVisible = percent(rng) < 50;
+        aScrollBars[i]->nRange = std::uniform_int_distribution<int>(0, 400)(rng);
+        aScrollBars[i]->nPos = std::uniform_int_distribution<int>(0, aScrollBars[i]->nRange)(rng);
+        *aTargets[i] = percent(rng) < 30 ? NULL : aScrollBars[i];
+    }
+    out.layout.m_iChildPadding = std::uniform_int_distribution<int>(0, 12)(rng);
+    out.layout.nAlign = std::uniform_int_distribution<int>(LAYOUT_ALIGN_NEAR, LAYOUT_ALIGN_FAR)(rng);
+    out.layout.m_szItem.cx = percent(rng) < 50 ? 0 : std::uniform_int_distribution<int>(20, 200)(rng);
+    out.layout.m_szItem.cy = 0;
+    out.layout.m_nColumns = std::uniform_int_distribution<int>(1, 5)(rng);
+}
+
+// 同一份随机布局复制一份，原来的循环和 CLayoutEngine 各算一次
+static void CopyLayout(const RandomLayout& src, RandomLayout& dst)
+{
+    dst.layout = src.layout;
+    dst.hscroll = src.hscroll;
+    dst.vscroll = src.vscroll;
+    if (src.layout.m_pHorizontalScrollBar != NULL)
+        dst.layout.m_pHorizontalScrollBar = &dst.hscroll;
+    if (src.layout.m_pVerticalScrollBar != NULL)
+        dst.layout.m_pVerticalScrollBar = &dst.vscroll;
+    dst.layout.m_items.clear();
+    for (size_t i = 0; i < src.controls.size(); ++i)
+    {
+        dst.controls.push_back(std::unique_ptr<LegacyControl>(new LegacyControl(*src.controls[i])));
+        dst.layout.m_items.push_back(dst.controls.back().get());
+    }
+}
+
+static void TestRandomEquivalence()
+{
+    std::mt19937 rng(20240607);
+    std::vector<TLayoutItem> aItems;
+    long long nLegacyCalls = 0, nEngineCalls = 0;
+    const int kRuns = 30000;
+    for (int run = 0; run < kRuns; ++run)
+    {
+        const LegacyLayoutKind kind = static_cast<LegacyLayoutKind>(run % 3);
+        RandomLayout legacy, engine;
+        MakeRandomLayout(rng, legacy);
+        CopyLayout(legacy, engine);
+        const int left = std::uniform_int_distribution<int>(-50, 50)(rng);
+        const int top = std::uniform_int_distribution<int>(-50, 50)(rng);
+        const TLayoutRect rc = MakeRect(left, top, left + std::uniform_int_distribution<int>(-10, 800)(rng),
+            top + std::uniform_int_distribution<int>(-10, 600)(rng));
+
+        const TLayoutSize szLegacy = LegacyArrange(kind, legacy.layout, rc);
+        const TLayoutSize szEngine = EngineArrange(kind, engine.layout, rc, aItems);
+        for (size_t i = 0; i < aItems.size(); ++i)
+            static_cast<LegacyControl*>(aItems[i].pData)->SetPos(aItems[i].rcPos);
+
+        if (!SameSize(szLegacy, szEngine))
+            fprintf(stderr, "run %d kind %d: needed %d,%d != %d,%d\n", run, kind, szLegacy.cx, szLegacy.cy, szEngine.cx, szEngine.cy);
+        TEST_CHECK(SameSize(szLegacy, szEngine));
+        TEST_CHECK(legacy.layout.m_nColumns == engine.layout.m_nColumns);
+        for (size_t i = 0; i < legacy.controls.size(); ++i)
+        {
+            const LegacyControl& a = *legacy.controls[i];
+            const LegacyControl& b = *engine.controls[i];
+            TEST_CHECK(a.nSetPosCalls == b.nSetPosCalls);
+            if (!SameRect(a.GetPos(), b.GetPos()))
+                fprintf(stderr, "run %d kind %d item %zu: %d,%d,%d,%d != %d,%d,%d,%d\n", run, kind, i,
+                    a.rcPos.left, a.rcPos.top, a.rcPos.right, a.rcPos.bottom, b.rcPos.left, b.rcPos.top, b.rcPos.right, b.rcPos.bottom);
+            TEST_CHECK(SameRect(a.GetPos(), b.GetPos()));
+            TEST_CHECK(b.nEstimateCalls <= a.nEstimateCalls);
+            nLegacyCalls += a.nEstimateCalls;
+            nEngineCalls += b.nEstimateCalls;
+        }
+    }
+    printf("%d random layouts, EstimateSize %lld -> %lld\n", kRuns, nLegacyCalls, nEngineCalls);
+    TEST_CHECK(nEngineCalls < nLegacyCalls);
+}
+
+int main()
+{
+    TestVerticalByHand();
+    TestHorizontalAlign();
+    TestTileColumns();
+    TestMeasureCache();
+    TestRandomEquivalence();
+    printf("LayoutEngineTest passed\n");
+    return 0;
+}
@@ -0,0 +1,596 @@
+/*
+* Module:   LegacyLayout
+*
+* Function: 原来 CVerticalLayoutUI、CHorizontalLayoutUI、CTileLayoutUI::SetPos 的排列循环（5903521），
+*           作为 CLayoutEngine 的对照（测试）和基准（基准程序）。控件和滚动条换成只有布局属性的模拟类，
+*           SIZE/RECT 换成 TLayoutSize/TLayoutRect，内边距、滚动条宽度已从 rc 中去掉，其余保持原样。
+*           另外按 CContainerUI::PrepareLayoutItems/GetLayoutBox/ApplyLayoutItems 的写法提供走 CLayoutEngine 的版本
+*/
+#ifndef __LEGACY_LAYOUT_H__
+#define __LEGACY_LAYOUT_H__
+
+#include "UILayoutEngine.h"
+
+#include <algorithm>
+#include <vector>
+
+// 只保留布局用到的属性。EstimateSize 默认返回固定尺寸；nTextWidth 大于 0 时像自动计算大小的 CLabelUI，
+// 按可用宽度折行，没有固定尺寸的一边由文字决定，所以两遍排列的约束不同时结果也不同
+class LegacyControl
+{
+public:
+    LegacyControl() : bVisible(true), bFloat(false), nTextWidth(0), nEstimateCalls(0), nSetPosCalls(0)
+    {
+        rcPadding.left = rcPadding.top = rcPadding.right = rcPadding.bottom = 0;
+        szFixed.cx = szFixed.cy = 0;
+        szMin.cx = szMin.cy = 0;
+        szMax.cx = szMax.cy = 9999;
+        rcPos = rcPadding;
+    }
+    virtual ~LegacyControl() {}
+
+    bool IsVisible() const { return bVisible; }
+    bool IsFloat() const { return bFloat; }
+    DuiLib::TLayoutRect GetPadding() const { return rcPadding; }
+    int GetFixedWidth() const { return szFixed.cx; }
+    int GetFixedHeight() const { return szFixed.cy; }
+    int GetMinWidth() const { return szMin.cx; }
+    int GetMinHeight() const { return szMin.cy; }
+    int GetMaxWidth() const { return szMax.cx; }
+    int GetMaxHeight() const { return szMax.cy; }
+    const DuiLib::TLayoutRect& GetPos() const { return rcPos; }
+
+    virtual DuiLib::TLayoutSize EstimateSize(DuiLib::TLayoutSize szAvailable)
+    {
+        ++nEstimateCalls;
+        DuiLib::TLayoutSize sz = szFixed;
+        if (nTextWidth > 0)
+        {
+            const int cxLine = std::max(szAvailable.cx, 1);
+            if (sz.cx == 0)
+                sz.cx = std::min(nTextWidth, cxLine);
+            if (sz.cy == 0)
+                sz.cy = (nTextWidth + cxLine - 1) / cxLine * 16;
+        }
+        return sz;
+    }
+
+    virtual void SetPos(DuiLib::TLayoutRect rc)
+    {
+        ++nSetPosCalls;
+        rcPos = rc;
+    }
+
+public:
+    bool bVisible;
+    bool bFloat;
+    DuiLib::TLayoutRect rcPadding;
+    DuiLib::TLayoutSize szFixed;
+    DuiLib::TLayoutSize szMin;
+    DuiLib::TLayoutSize szMax;
+    int nTextWidth;
+    int nEstimateCalls;
+    int nSetPosCalls;
+    DuiLib::TLayoutRect rcPos;
+};
+
+struct LegacyScrollBar
+{
+    bool bVisible;
+    int nRange;
+    int nPos;
+
+    bool IsVisible() const { return bVisible; }
+    int GetScrollRange() const { return nRange; }
+    int GetScrollPos() const { return nPos; }
+};
+
+// 容器的布局属性。nAlign 用 LAYOUT_ALIGN_*，纵向布局对应 DT_LEFT/DT_CENTER/DT_RIGHT，横向对应 DT_TOP/DT_VCENTER/DT_BOTTOM
+struct LegacyContainer
+{
+    std::vector<LegacyControl*> m_items;
+    LegacyScrollBar* m_pHorizontalScrollBar;
+    LegacyScrollBar* m_pVerticalScrollBar;
+    int m_iChildPadding;
+    int nAlign;
+    DuiLib::TLayoutSize m_szItem;
+    int m_nColumns;
+};
+
+// 返回 ProcessScrollBar 收到的 cxNeeded/cyNeeded
+inline DuiLib::TLayoutSize LegacyVerticalSetPos(LegacyContainer& layout, DuiLib::TLayoutRect rc)
+{
+    using namespace DuiLib;
+    std::vector<LegacyControl*>& m_items = layout.m_items;
+    LegacyScrollBar* m_pHorizontalScrollBar = layout.m_pHorizontalScrollBar;
+    LegacyScrollBar* m_pVerticalScrollBar = layout.m_pVerticalScrollBar;
+    const int m_iChildPadding = layout.m_iChildPadding;
+    TLayoutSize szNone = { 0, 0 };
+    if (m_items.size() == 0)
+        return szNone;
+
+    // Determine the minimum size
+    TLayoutSize szAvailable = { rc.right - rc.left, rc.bottom - rc.top };
+    if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible())
+        szAvailable.cx += m_pHorizontalScrollBar->GetScrollRange();
+    if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible())
+        szAvailable.cy += m_pVerticalScrollBar->GetScrollRange();
+
+    int cxNeeded = 0;
+    int nAdjustables = 0;
+    int cyFixed = 0;
+    int nEstimateNum = 0;
+    TLayoutSize szControlAvailable;
+    int iControlMaxWidth = 0;
+    int iControlMaxHeight = 0;
+    for (size_t it1 = 0; it1 < m_items.size(); it1++) {
+        LegacyControl* pControl = m_items[it1];
+        if (!pControl->IsVisible()) continue;
+        if (pControl->IsFloat()) continue;
+        szControlAvailable = szAvailable;
+        TLayoutRect rcPadding = pControl->GetPadding();
+        szControlAvailable.cx -= rcPadding.left + rcPadding.right;
+        iControlMaxWidth = pControl->GetFixedWidth();
+        iControlMaxHeight = pControl->GetFixedHeight();
+        if (iControlMaxWidth <= 0) iControlMaxWidth = pControl->GetMaxWidth();
+        if (iControlMaxHeight <= 0) iControlMaxHeight = pControl->GetMaxHeight();
+        if (szControlAvailable.cx > iControlMaxWidth) szControlAvailable.cx = iControlMaxWidth;
+        if (szControlAvailable.cy > iControlMaxHeight) szControlAvailable.cy = iControlMaxHeight;
+        TLayoutSize sz = pControl->EstimateSize(szControlAvailable);
+        if (sz.cy == 0) {
+            nAdjustables++;
+        }
+        else {
+            if (sz.cy < pControl->GetMinHeight()) sz.cy = pControl->GetMinHeight();
+            if (sz.cy > pControl->GetMaxHeight()) sz.cy = pControl->GetMaxHeight();
+        }
+        cyFixed += sz.cy + pControl->GetPadding().top + pControl->GetPadding().bottom;
+
+        sz.cx = std::max(sz.cx, 0);
+        if (sz.cx < pControl->GetMinWidth()) sz.cx = pControl->GetMinWidth();
+        if (sz.cx > pControl->GetMaxWidth()) sz.cx = pControl->GetMaxWidth();
+        cxNeeded = std::max(cxNeeded, sz.cx + rcPadding.left + rcPadding.right);
+        nEstimateNum++;
+    }
+    cyFixed += (nEstimateNum - 1) * m_iChildPadding;
+
+    // Place elements
+    int cyNeeded = 0;
+    int cyExpand = 0;
+    if (nAdjustables > 0) cyExpand = std::max(0, (szAvailable.cy - cyFixed) / nAdjustables);
+    // Position the elements
+    TLayoutSize szRemaining = szAvailable;
+    int iPosY = rc.top;
+    if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible()) {
+        iPosY -= m_pVerticalScrollBar->GetScrollPos();
+    }
+
+    int iEstimate = 0;
+    int iAdjustable = 0;
+    int cyFixedRemaining = cyFixed;
+    for (size_t it2 = 0; it2 < m_items.size(); it2++) {
+        LegacyControl* pControl = m_items[it2];
+        if (!pControl->IsVisible()) continue;
+        if (pControl->IsFloat()) continue;
+
+        iEstimate += 1;
+        TLayoutRect rcPadding = pControl->GetPadding();
+        szRemaining.cy -= rcPadding.top;
+
+        szControlAvailable = szRemaining;
+        szControlAvailable.cx -= rcPadding.left + rcPadding.right;
+        iControlMaxWidth = pControl->GetFixedWidth();
+        iControlMaxHeight = pControl->GetFixedHeight();
+        if (iControlMaxWidth <= 0) iControlMaxWidth = pControl->GetMaxWidth();
+        if (iControlMaxHeight <= 0) iControlMaxHeight = pControl->GetMaxHeight();
+        if (szControlAvailable.cx > iControlMaxWidth) szControlAvailable.cx = iControlMaxWidth;
+        if (szControlAvailable.cy > iControlMaxHeight) szControlAvailable.cy = iControlMaxHeight;
+        cyFixedRemaining = cyFixedRemaining - (rcPadding.top + rcPadding.bottom);
+        if (iEstimate > 1) cyFixedRemaining = cyFixedRemaining - m_iChildPadding;
+        TLayoutSize sz = pControl->EstimateSize(szControlAvailable);
+        if (sz.cy == 0) {
+            iAdjustable++;
+            sz.cy = cyExpand;
+            // Distribute remaining to last element (usually round-off left-overs)
+            if (iAdjustable == nAdjustables) {
+                sz.cy = std::max(0, szRemaining.cy - rcPadding.bottom - cyFixedRemaining);
+            }
+            if (sz.cy < pControl->GetMinHeight()) sz.cy = pControl->GetMinHeight();
+            if (sz.cy > pControl->GetMaxHeight()) sz.cy = pControl->GetMaxHeight();
+        }
+        else {
+            if (sz.cy < pControl->GetMinHeight()) sz.cy = pControl->GetMinHeight();
+            if (sz.cy > pControl->GetMaxHeight()) sz.cy = pControl->GetMaxHeight();
+            cyFixedRemaining -= sz.cy;
+        }
+
+        sz.cx = pControl->GetMaxWidth();
+        if (sz.cx == 0) sz.cx = szAvailable.cx - rcPadding.left - rcPadding.right;
+        if (sz.cx < 0) sz.cx = 0;
+        if (sz.cx > szControlAvailable.cx) sz.cx = szControlAvailable.cx;
+        if (sz.cx < pControl->GetMinWidth()) sz.cx = pControl->GetMinWidth();
+
+        if (layout.nAlign == LAYOUT_ALIGN_CENTER) {
+            int iPosX = (rc.right + rc.left) / 2;
+            if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible()) {
+                iPosX += m_pHorizontalScrollBar->GetScrollRange() / 2;
+                iPosX -= m_pHorizontalScrollBar->GetScrollPos();
+            }
+            TLayoutRect rcCtrl = { iPosX - sz.cx / 2, iPosY + rcPadding.top, iPosX + sz.cx - sz.cx / 2, iPosY + sz.cy + rcPadding.top };
+            pControl->SetPos(rcCtrl);
+        }
+        else if (layout.nAlign == LAYOUT_ALIGN_FAR) {
+            int iPosX = rc.right;
+            if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible()) {
+                iPosX += m_pHorizontalScrollBar->GetScrollRange();
+                iPosX -= m_pHorizontalScrollBar->GetScrollPos();
+            }
+            TLayoutRect rcCtrl = { iPosX - rcPadding.right - sz.cx, iPosY + rcPadding.top, iPosX - rcPadding.right, iPosY + sz.cy + rcPadding.top };
+            pControl->SetPos(rcCtrl);
+        }
+        else {
+            int iPosX = rc.left;
+            if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible()) {
+                iPosX -= m_pHorizontalScrollBar->GetScrollPos();
+            }
+            TLayoutRect rcCtrl = { iPosX + rcPadding.left, iPosY + rcPadding.top, iPosX + rcPadding.left + sz.cx, iPosY + sz.cy + rcPadding.top };
+            pControl->SetPos(rcCtrl);
+        }
+
+        iPosY += sz.cy + m_iChildPadding + rcPadding.top + rcPadding.bottom;
+        cyNeeded += sz.cy + rcPadding.top + rcPadding.bottom;
+        szRemaining.cy -= sz.cy + m_iChildPadding + rcPadding.bottom;
+    }
+    cyNeeded += (nEstimateNum - 1) * m_iChildPadding;
+
+    TLayoutSize szNeeded = { cxNeeded, cyNeeded };
+    return szNeeded;
+}
+
+inline DuiLib::TLayoutSize LegacyHorizontalSetPos(LegacyContainer& layout, DuiLib::TLayoutRect rc)
+{
+    using namespace DuiLib;
+    std::vector<LegacyControl*>& m_items = layout.m_items;
+    LegacyScrollBar* m_pVerticalScrollBar = layout.m_pVerticalScrollBar;
+    LegacyScrollBar* m_pHorizontalScrollBar = layout.m_pHorizontalScrollBar;
+    const int m_iChildPadding = layout.m_iChildPadding;
+    TLayoutSize szNone = { 0, 0 };
+    if (m_items.size() == 0)
+        return szNone;
+
+    // Determine the minimum size
+    TLayoutSize szAvailable = { rc.right - rc.left, rc.bottom - rc.top };
+    //if( m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible() )
+    //	szAvailable.cx += m_pHorizontalScrollBar->GetScrollRange();
+    if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible())
+        szAvailable.cy += m_pVerticalScrollBar->GetScrollRange();
+
+    int cyNeeded = 0;
+    int nAdjustables = 0;
+    int cxFixed = 0;
+    int nEstimateNum = 0;
+    TLayoutSize szControlAvailable;
+    int iControlMaxWidth = 0;
+    int iControlMaxHeight = 0;
+    for (size_t it1 = 0; it1 < m_items.size(); it1++) {
+        LegacyControl* pControl = m_items[it1];
+        if (!pControl->IsVisible()) continue;
+        if (pControl->IsFloat()) continue;
+        szControlAvailable = szAvailable;
+        TLayoutRect rcPadding = pControl->GetPadding();
+        szControlAvailable.cy -= rcPadding.top + rcPadding.bottom;
+        iControlMaxWidth = pControl->GetFixedWidth();
+        iControlMaxHeight = pControl->GetFixedHeight();
+        if (iControlMaxWidth <= 0) iControlMaxWidth = pControl->GetMaxWidth();
+        if (iControlMaxHeight <= 0) iControlMaxHeight = pControl->GetMaxHeight();
+        if (szControlAvailable.cx > iControlMaxWidth) szControlAvailable.cx = iControlMaxWidth;
+        if (szControlAvailable.cy > iControlMaxHeight) szControlAvailable.cy = iControlMaxHeight;
+        TLayoutSize sz = pControl->EstimateSize(szControlAvailable);
+        if (sz.cx == 0) {
+            nAdjustables++;
+        }
+        else {
+            if (sz.cx < pControl->GetMinWidth()) sz.cx = pControl->GetMinWidth();
+            if (sz.cx > pControl->GetMaxWidth()) sz.cx = pControl->GetMaxWidth();
+        }
+        cxFixed += sz.cx + pControl->GetPadding().left + pControl->GetPadding().right;
+
+        sz.cy = std::max(sz.cy, 0);
+        if (sz.cy < pControl->GetMinHeight()) sz.cy = pControl->GetMinHeight();
+        if (sz.cy > pControl->GetMaxHeight()) sz.cy = pControl->GetMaxHeight();
+        cyNeeded = std::max(cyNeeded, sz.cy + rcPadding.top + rcPadding.bottom);
+        nEstimateNum++;
+    }
+    cxFixed += (nEstimateNum - 1) * m_iChildPadding;
+
+    // Place elements
+    int cxNeeded = 0;
+    int cxExpand = 0;
+    if (nAdjustables > 0) cxExpand = std::max(0, (szAvailable.cx - cxFixed) / nAdjustables);
+    // Position the elements
+    TLayoutSize szRemaining = szAvailable;
+    int iPosX = rc.left;
+    if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible()) {
+        iPosX -= m_pHorizontalScrollBar->GetScrollPos();
+    }
+    int iEstimate = 0;
+    int iAdjustable = 0;
+    int cxFixedRemaining = cxFixed;
+    for (size_t it2 = 0; it2 < m_items.size(); it2++) {
+        LegacyControl* pControl = m_items[it2];
+        if (!pControl->IsVisible()) continue;
+        if (pControl->IsFloat()) continue;
+
+        iEstimate += 1;
+        TLayoutRect rcPadding = pControl->GetPadding();
+        szRemaining.cx -= rcPadding.left;
+
+        szControlAvailable = szRemaining;
+        szControlAvailable.cy -= rcPadding.top + rcPadding.bottom;
+        iControlMaxWidth = pControl->GetFixedWidth();
+        iControlMaxHeight = pControl->GetFixedHeight();
+        if (iControlMaxWidth <= 0) iControlMaxWidth = pControl->GetMaxWidth();
+        if (iControlMaxHeight <= 0) iControlMaxHeight = pControl->GetMaxHeight();
+        if (szControlAvailable.cx > iControlMaxWidth) szControlAvailable.cx = iControlMaxWidth;
+        if (szControlAvailable.cy > iControlMaxHeight) szControlAvailable.cy = iControlMaxHeight;
+        cxFixedRemaining = cxFixedRemaining - (rcPadding.left + rcPadding.right);
+        if (iEstimate > 1) cxFixedRemaining = cxFixedRemaining - m_iChildPadding;
+        TLayoutSize sz = pControl->EstimateSize(szControlAvailable);
+        if (sz.cx == 0) {
+            iAdjustable++;
+            sz.cx = cxExpand;
+            // Distribute remaining to last element (usually round-off left-overs)
+            if (iAdjustable == nAdjustables) {
+                sz.cx = std::max(0, szRemaining.cx - rcPadding.right - cxFixedRemaining);
+            }
+            if (sz.cx < pControl->GetMinWidth()) sz.cx = pControl->GetMinWidth();
+            if (sz.cx > pControl->GetMaxWidth()) sz.cx = pControl->GetMaxWidth();
+        }
+        else {
+            if (sz.cx < pControl->GetMinWidth()) sz.cx = pControl->GetMinWidth();
+            if (sz.cx > pControl->GetMaxWidth()) sz.cx = pControl->GetMaxWidth();
+            cxFixedRemaining -= sz.cx;
+        }
+
+        sz.cy = pControl->GetMaxHeight();
+        if (sz.cy == 0) sz.cy = szAvailable.cy - rcPadding.top - rcPadding.bottom;
+        if (sz.cy < 0) sz.cy = 0;
+        if (sz.cy > szControlAvailable.cy) sz.cy = szControlAvailable.cy;
+        if (sz.cy < pControl->GetMinHeight()) sz.cy = pControl->GetMinHeight();
+
+        if (layout.nAlign == LAYOUT_ALIGN_CENTER) {
+            int iPosY = (rc.bottom + rc.top) / 2;
+            if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible()) {
+                iPosY += m_pVerticalScrollBar->GetScrollRange() / 2;
+                iPosY -= m_pVerticalScrollBar->GetScrollPos();
+            }
+            TLayoutRect rcCtrl = { iPosX + rcPadding.left, iPosY - sz.cy / 2, iPosX + sz.cx + rcPadding.left, iPosY + sz.cy - sz.cy / 2 };
+            pControl->SetPos(rcCtrl);
+        }
+        else if (layout.nAlign == LAYOUT_ALIGN_FAR) {
+            int iPosY = rc.bottom;
+            if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible()) {
+                iPosY += m_pVerticalScrollBar->GetScrollRange();
+                iPosY -= m_pVerticalScrollBar->GetScrollPos();
+            }
+            TLayoutRect rcCtrl = { iPosX + rcPadding.left, iPosY - rcPadding.bottom - sz.cy, iPosX + sz.cx + rcPadding.left, iPosY - rcPadding.bottom };
+            pControl->SetPos(rcCtrl);
+        }
+        else {
+            int iPosY = rc.top;
+            if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible()) {
+                iPosY -= m_pVerticalScrollBar->GetScrollPos();
+            }
+            TLayoutRect rcCtrl = { iPosX + rcPadding.left, iPosY + rcPadding.top, iPosX + sz.cx + rcPadding.left, iPosY + sz.cy + rcPadding.top };
+            pControl->SetPos(rcCtrl);
+        }
+
+        iPosX += sz.cx + m_iChildPadding + rcPadding.left + rcPadding.right;
+        cxNeeded += sz.cx + rcPadding.left + rcPadding.right;
+        szRemaining.cx -= sz.cx + m_iChildPadding + rcPadding.right;
+    }
+    cxNeeded += (nEstimateNum - 1) * m_iChildPadding;
+
+    TLayoutSize szNeeded = { cxNeeded, cyNeeded };
+    return szNeeded;
+}
+
+// 列数写回 layout.m_nColumns
+inline DuiLib::TLayoutSize LegacyTileSetPos(LegacyContainer& layout, DuiLib::TLayoutRect rc)
+{
+    using namespace DuiLib;
+    std::vector<LegacyControl*>& m_items = layout.m_items;
+    LegacyScrollBar* m_pVerticalScrollBar = layout.m_pVerticalScrollBar;
+    LegacyScrollBar* m_pHorizontalScrollBar = layout.m_pHorizontalScrollBar;
+    const int m_iChildPadding = layout.m_iChildPadding;
+    const TLayoutSize m_szItem = layout.m_szItem;
+    int& m_nColumns = layout.m_nColumns;
+    TLayoutSize szNone = { 0, 0 };
+    if (m_items.size() == 0)
+        return szNone;
+
+    // Position the elements
+    if (m_szItem.cx > 0) m_nColumns = (rc.right - rc.left) / m_szItem.cx;
+    if (m_nColumns == 0) m_nColumns = 1;
+
+    int cyNeeded = 0;
+    int cxWidth = (rc.right - rc.left) / m_nColumns;
+    if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible())
+        cxWidth = (rc.right - rc.left + m_pHorizontalScrollBar->GetScrollRange()) / m_nColumns;
+
+    int cyHeight = 0;
+    int iCount = 0;
+    struct { int x, y; } ptTile = { rc.left, rc.top };
+    if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible()) {
+        ptTile.y -= m_pVerticalScrollBar->GetScrollPos();
+    }
+    int iPosX = rc.left;
+    if (m_pHorizontalScrollBar && m_pHorizontalScrollBar->IsVisible()) {
+        iPosX -= m_pHorizontalScrollBar->GetScrollPos();
+        ptTile.x = iPosX;
+    }
+    for (size_t it1 = 0; it1 < m_items.size(); it1++) {
+        LegacyControl* pControl = m_items[it1];
+        if (!pControl->IsVisible()) continue;
+        if (pControl->IsFloat()) continue;
+
+        // Determine size
+        TLayoutRect rcTile = { ptTile.x, ptTile.y, ptTile.x + cxWidth, ptTile.y };
+        if ((iCount % m_nColumns) == 0)
+        {
+            int iIndex = iCount;
+            for (size_t it2 = it1; it2 < m_items.size(); it2++) {
+                LegacyControl* pLineControl = m_items[it2];
+                if (!pLineControl->IsVisible()) continue;
+                if (pLineControl->IsFloat()) continue;
+
+                TLayoutRect rcPadding = pLineControl->GetPadding();
+                TLayoutSize szAvailable = { rcTile.right - rcTile.left - rcPadding.left - rcPadding.right, 9999 };
+                if (iIndex == iCount || (iIndex + 1) % m_nColumns == 0) {
+                    szAvailable.cx -= m_iChildPadding / 2;
+                }
+                else {
+                    szAvailable.cx -= m_iChildPadding;
+                }
+
+                if (szAvailable.cx < pControl->GetMinWidth()) szAvailable.cx = pControl->GetMinWidth();
+                if (szAvailable.cx > pControl->GetMaxWidth()) szAvailable.cx = pControl->GetMaxWidth();
+
+                TLayoutSize szTile = pLineControl->EstimateSize(szAvailable);
+                if (szTile.cx < pControl->GetMinWidth()) szTile.cx = pControl->GetMinWidth();
+                if (szTile.cx > pControl->GetMaxWidth()) szTile.cx = pControl->GetMaxWidth();
+                if (szTile.cy < pControl->GetMinHeight()) szTile.cy = pControl->GetMinHeight();
+                if (szTile.cy > pControl->GetMaxHeight()) szTile.cy = pControl->GetMaxHeight();
+
+                cyHeight = std::max(cyHeight, szTile.cy + rcPadding.top + rcPadding.bottom);
+                if ((++iIndex % m_nColumns) == 0) break;
+            }
+        }
+
+        TLayoutRect rcPadding = pControl->GetPadding();
+
+        rcTile.left += rcPadding.left + m_iChildPadding / 2;
+        rcTile.right -= rcPadding.right + m_iChildPadding / 2;
+        if ((iCount % m_nColumns) == 0) {
+            rcTile.left -= m_iChildPadding / 2;
+        }
+
+        if (((iCount + 1) % m_nColumns) == 0) {
+            rcTile.right += m_iChildPadding / 2;
+        }
+
+        // Set position
+        rcTile.top = ptTile.y + rcPadding.top;
+        rcTile.bottom = ptTile.y + cyHeight;
+
+        TLayoutSize szAvailable = { rcTile.right - rcTile.left, rcTile.bottom - rcTile.top };
+        TLayoutSize szTile = pControl->EstimateSize(szAvailable);
+        if (szTile.cx == 0) szTile.cx = szAvailable.cx;
+        if (szTile.cy == 0) szTile.cy = szAvailable.cy;
+        if (szTile.cx < pControl->GetMinWidth()) szTile.cx = pControl->GetMinWidth();
+        if (szTile.cx > pControl->GetMaxWidth()) szTile.cx = pControl->GetMaxWidth();
+        if (szTile.cy < pControl->GetMinHeight()) szTile.cy = pControl->GetMinHeight();
+        if (szTile.cy > pControl->GetMaxHeight()) szTile.cy = pControl->GetMaxHeight();
+        TLayoutRect rcPos = { (rcTile.left + rcTile.right - szTile.cx) / 2, (rcTile.top + rcTile.bottom - szTile.cy) / 2,
+            (rcTile.left + rcTile.right - szTile.cx) / 2 + szTile.cx, (rcTile.top + rcTile.bottom - szTile.cy) / 2 + szTile.cy };
+        pControl->SetPos(rcPos);
+
+        if ((++iCount % m_nColumns) == 0) {
+            ptTile.x = iPosX;
+            ptTile.y += cyHeight + m_iChildPadding;
+            cyHeight = 0;
+        }
+        else {
+            ptTile.x += cxWidth;
+        }
+        cyNeeded = rcTile.bottom - rc.top;
+        if (m_pVerticalScrollBar && m_pVerticalScrollBar->IsVisible()) cyNeeded += m_pVerticalScrollBar->GetScrollPos();
+    }
+
+    TLayoutSize szNeeded = { 0, cyNeeded };
+    return szNeeded;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// 现在的容器：和 CContainerUI 一样整理出可见、非浮动的子控件，经 CLayoutEngine 计算后逐个 SetPos
+
+class CLegacyEstimateMeasure : public DuiLib::ILayoutMeasure
+{
+public:
+    virtual DuiLib::TLayoutSize Measure(const DuiLib::TLayoutItem& item, DuiLib::TLayoutSize szAvailable)
+    {
+        return static_cast<LegacyControl*>(item.pData)->EstimateSize(szAvailable);
+    }
+};
+
+inline void PrepareEngineItems(const LegacyContainer& layout, std::vector<DuiLib::TLayoutItem>& aItems)
+{
+    aItems.clear();
+    for (size_t it = 0; it < layout.m_items.size(); it++)
+    {
+        LegacyControl* pControl = layout.m_items[it];
+        if (!pControl->IsVisible() || pControl->IsFloat())
+            continue;
+        DuiLib::TLayoutItem item;
+        item.pData = pControl;
+        item.rcPadding = pControl->GetPadding();
+        item.szFixed = pControl->szFixed;
+        item.szMin = pControl->szMin;
+        item.szMax = pControl->szMax;
+        DuiLib::CLayoutEngine::ResetItem(item);
+        aItems.push_back(item);
+    }
+}
+
+inline DuiLib::TLayoutBox EngineLayoutBox(const LegacyContainer& layout, DuiLib::TLayoutRect rc)
+{
+    DuiLib::TLayoutBox box = { rc, { 0, 0 }, { 0, 0 }, layout.m_iChildPadding, layout.nAlign };
+    if (layout.m_pHorizontalScrollBar && layout.m_pHorizontalScrollBar->IsVisible())
+    {
+        box.szScrollRange.cx = layout.m_pHorizontalScrollBar->GetScrollRange();
+        box.szScrollPos.cx = layout.m_pHorizontalScrollBar->GetScrollPos();
+    }
+    if (layout.m_pVerticalScrollBar && layout.m_pVerticalScrollBar->IsVisible())
+    {
+        box.szScrollRange.cy = layout.m_pVerticalScrollBar->GetScrollRange();
+        box.szScrollPos.cy = layout.m_pVerticalScrollBar->GetScrollPos();
+    }
+    return box;
+}
+
+enum LegacyLayoutKind
+{
+    kLayoutVertical,
+    kLayoutHorizontal,
+    kLayoutTile,
+};
+
+// aItems 由调用者提供，反复布局时复用容量，和 CContainerUI::m_aLayoutItems 一样。
+// 结果留在 aItems 的 rcPos 中，由调用者决定怎样 SetPos
+inline DuiLib::TLayoutSize EngineArrange(LegacyLayoutKind kind, LegacyContainer& layout, DuiLib::TLayoutRect rc,
+    std::vector<DuiLib::TLayoutItem>& aItems)
+{
+    static CLegacyEstimateMeasure s_measure;
+    DuiLib::TLayoutSize szNone = { 0, 0 };
+    aItems.clear();
+    if (layout.m_items.size() == 0)
+        return szNone;
+    PrepareEngineItems(layout, aItems);
+    const DuiLib::TLayoutBox box = EngineLayoutBox(layout, rc);
+    if (kind == kLayoutVertical)
+        return DuiLib::CLayoutEngine::ArrangeVertical(box, aItems, &s_measure);
+    if (kind == kLayoutHorizontal)
+        return DuiLib::CLayoutEngine::ArrangeHorizontal(box, aItems, &s_measure);
+    return DuiLib::CLayoutEngine::ArrangeTile(box, layout.m_szItem, layout.m_nColumns, aItems, &s_measure);
+}
+
+inline DuiLib::TLayoutSize LegacyArrange(LegacyLayoutKind kind, LegacyContainer& layout, DuiLib::TLayoutRect rc)
+{
+    if (kind == kLayoutVertical)
+        return LegacyVerticalSetPos(layout, rc);
+    if (kind == kLayoutHorizontal)
+        return LegacyHorizontalSetPos(layout, rc);
+    return LegacyTileSetPos(layout, rc);
+}
+
+#endif /* __LEGACY_LAYOUT_H__ */
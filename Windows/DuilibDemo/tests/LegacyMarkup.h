@@ -0,0 +1,479 @@
+/*
+* Module:   LegacyMarkup
+*
+* Function: 旧版 CMarkup/CMarkupNode（基线 UIMarkup.cpp）的逐行移植，作为 CMarkupDomT 的对照实现。
+*           TCHAR 换成模板参数 T：CharNext 按一个字符前进，_istalnum 按新解析器的规则（ASCII 字母数字，非 ASCII 都算），
+*           出错信息换成 CMarkupDomT 的错误码，出错位置只记指针（旧版会从这里拷 49 个字符）。
+*           只供测试和基准使用
+*/
+#ifndef __LEGACY_MARKUP_H__
+#define __LEGACY_MARKUP_H__
+
+#include "UIMarkupDom.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+template <typename T>
+class LegacyMarkup
+{
+public:
+    typedef typename DuiLib::CMarkupDomT<T>::Error Error;
+
+    class Node
+    {
+    public:
+        Node() : m_pOwner(NULL), m_iPos(0), m_nAttributes(0) {}
+        Node(LegacyMarkup* pOwner, unsigned long iPos) : m_pOwner(pOwner), m_iPos(iPos), m_nAttributes(0) {}
+
+        bool IsValid() const { return m_pOwner != NULL; }
+
+        Node GetSibling()
+        {
+            if( m_pOwner == NULL ) return Node();
+            unsigned long iPos = m_pOwner->m_pElements[m_iPos].iNext;
+            if( iPos == 0 ) return Node();
+            return Node(m_pOwner, iPos);
+        }
+
+        Node GetChild()
+        {
+            if( m_pOwner == NULL ) return Node();
+            unsigned long iPos = m_pOwner->m_pElements[m_iPos].iChild;
+            if( iPos == 0 ) return Node();
+            return Node(m_pOwner, iPos);
+        }
+
+        Node GetChild(const T* pstrName)
+        {
+            if( m_pOwner == NULL ) return Node();
+            unsigned long iPos = m_pOwner->m_pElements[m_iPos].iChild;
+            while( iPos != 0 ) {
+                if( CompareNoCase(m_pOwner->m_pstrXML + m_pOwner->m_pElements[iPos].iStart, pstrName) == 0 ) {
+                    return Node(m_pOwner, iPos);
+                }
+                iPos = m_pOwner->m_pElements[iPos].iNext;
+            }
+            return Node();
+        }
+
+        Node GetParent()
+        {
+            if( m_pOwner == NULL ) return Node();
+            unsigned long iPos = m_pOwner->m_pElements[m_iPos].iParent;
+            if( iPos == 0 ) return Node();
+            return Node(m_pOwner, iPos);
+        }
+
+        const T* GetName() const
+        {
+            if( m_pOwner == NULL ) return NULL;
+            return m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iStart;
+        }
+
+        const T* GetValue() const
+        {
+            if( m_pOwner == NULL ) return NULL;
+            return m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iData;
+        }
+
+        int GetAttributeCount()
+        {
+            if( m_pOwner == NULL ) return 0;
+            if( m_nAttributes == 0 ) _MapAttributes();
+            return m_nAttributes;
+        }
+
+        const T* GetAttributeName(int iIndex)
+        {
+            if( m_pOwner == NULL ) return NULL;
+            if( m_nAttributes == 0 ) _MapAttributes();
+            if( iIndex < 0 || iIndex >= m_nAttributes ) return Empty();
+            return m_pOwner->m_pstrXML + m_aAttributes[iIndex].iName;
+        }
+
+        const T* GetAttributeValue(int iIndex)
+        {
+            if( m_pOwner == NULL ) return NULL;
+            if( m_nAttributes == 0 ) _MapAttributes();
+            if( iIndex < 0 || iIndex >= m_nAttributes ) return Empty();
+            return m_pOwner->m_pstrXML + m_aAttributes[iIndex].iValue;
+        }
+
+        const T* GetAttributeValue(const T* pstrName)
+        {
+            if( m_pOwner == NULL ) return NULL;
+            if( m_nAttributes == 0 ) _MapAttributes();
+            for( int i = 0; i < m_nAttributes; i++ ) {
+                if( CompareNoCase(m_pOwner->m_pstrXML + m_aAttributes[i].iName, pstrName) == 0 ) return m_pOwner->m_pstrXML + m_aAttributes[i].iValue;
+            }
+            return Empty();
+        }
+
+        bool HasAttribute(const T* pstrName)
+        {
+            if( m_pOwner == NULL ) return false;
+            if( m_nAttributes == 0 ) _MapAttributes();
+            for( int i = 0; i < m_nAttributes; i++ ) {
+                if( CompareNoCase(m_pOwner->m_pstrXML + m_aAttributes[i].iName, pstrName) == 0 ) return true;
+            }
+            return false;
+        }
+
+    private:
+        void _MapAttributes()
+        {
+            m_nAttributes = 0;
+            const T* pstr = m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iStart;
+            const T* pstrEnd = m_pOwner->m_pstrXML + m_pOwner->m_pElements[m_iPos].iData;
+            pstr += Length(pstr) + 1;
+            while( pstr < pstrEnd ) {
+                SkipWhitespace(pstr);
+                m_aAttributes[m_nAttributes].iName = pstr - m_pOwner->m_pstrXML;
+                pstr += Length(pstr) + 1;
+                SkipWhitespace(pstr);
+                if( *pstr++ != '\"' ) return;
+
+                m_aAttributes[m_nAttributes++].iValue = pstr - m_pOwner->m_pstrXML;
+                if( m_nAttributes >= MAX_XML_ATTRIBUTES ) return;
+                pstr += Length(pstr) + 1;
+            }
+        }
+
+        enum { MAX_XML_ATTRIBUTES = 64 };
+
+        struct XMLATTRIBUTE
+        {
+            unsigned long iName;
+            unsigned long iValue;
+        };
+
+        LegacyMarkup* m_pOwner;
+        unsigned long m_iPos;
+        int m_nAttributes;
+        XMLATTRIBUTE m_aAttributes[MAX_XML_ATTRIBUTES];
+    };
+
+public:
+    LegacyMarkup() : m_pstrXML(NULL), m_pElements(NULL), m_nElements(0), m_nReservedElements(0),
+        m_bPreserveWhitespace(true), m_eError(DuiLib::CMarkupDomT<T>::ERROR_NONE), m_pErrorLocation(NULL)
+    {
+    }
+
+    ~LegacyMarkup()
+    {
+        Release();
+    }
+
+    void SetPreserveWhitespace(bool bPreserve) { m_bPreserveWhitespace = bPreserve; }
+
+    // 与旧版 Load 一样先拷贝一份，解析在拷贝上进行。pstrBeyond 非空时接在结尾的 0 之后，
+    // 旧版在结尾处会越过结束的 0 继续读，越界读到的内容会出现在解析结果里
+    bool Load(const T* pstrXML, const T* pstrBeyond = NULL)
+    {
+        Release();
+        size_t cchLen = Length(pstrXML) + 1;
+        size_t cchBeyond = pstrBeyond != NULL ? Length(pstrBeyond) + 1 : 0;
+        m_pstrXML = static_cast<T*>(calloc(cchLen + cchBeyond, sizeof(T)));
+        memcpy(m_pstrXML, pstrXML, cchLen * sizeof(T));
+        if( pstrBeyond != NULL ) memcpy(m_pstrXML + cchLen, pstrBeyond, cchBeyond * sizeof(T));
+        m_nLength = cchLen - 1;
+        bool bRes = _Parse();
+        if( !bRes ) _ReleaseElements();
+        return bRes;
+    }
+
+    void Release()
+    {
+        if( m_pstrXML != NULL ) free(m_pstrXML);
+        _ReleaseElements();
+        m_pstrXML = NULL;
+    }
+
+    bool IsValid() const { return m_pElements != NULL; }
+    // 旧版只判断 m_nElements == 0，空文档（只有保留的 0 号元素）会返回未初始化的 1 号元素
+    Node GetRoot()
+    {
+        if( m_nElements <= 1 ) return Node();
+        return Node(this, 1);
+    }
+    unsigned long GetElementCount() const { return m_nElements == 0 ? 0 : m_nElements - 1; }
+
+    Error GetError() const { return m_eError; }
+    // 出错位置相对拷贝开头的偏移；大于原文长度说明读过了结尾的 0
+    size_t GetErrorOffset() const { return m_pErrorLocation - m_pstrXML; }
+    size_t GetLength() const { return m_nLength; }
+
+    static int CompareNoCase(const T* pLeft, const T* pRight)
+    {
+        for( ; ; ++pLeft, ++pRight ) {
+            unsigned int l = Fold(*pLeft);
+            unsigned int r = Fold(*pRight);
+            if( l != r ) return l < r ? -1 : 1;
+            if( l == 0 ) return 0;
+        }
+    }
+
+private:
+    struct XMLELEMENT
+    {
+        unsigned long iStart;
+        unsigned long iChild;
+        unsigned long iNext;
+        unsigned long iParent;
+        unsigned long iData;
+    };
+
+    static const T* Empty()
+    {
+        static const T kEmpty[1] = { 0 };
+        return kEmpty;
+    }
+
+    static unsigned int Value(T ch)
+    {
+        return static_cast<unsigned int>(ch) & (sizeof(T) == 1 ? 0xFF : 0xFFFFFFFF);
+    }
+
+    static unsigned int Fold(T ch)
+    {
+        unsigned int c = Value(ch);
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+
+    static size_t Length(const T* pstr)
+    {
+        const T* p = pstr;
+        while( *p != 0 ) ++p;
+        return p - pstr;
+    }
+
+    static bool IsAlnum(T ch)
+    {
+        unsigned int c = Value(ch);
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+    }
+
+    template <typename P>
+    static void SkipWhitespace(P*& pstr)
+    {
+        while( Value(*pstr) > 0 && Value(*pstr) <= ' ' ) pstr = pstr + 1;
+    }
+
+    static void SkipIdentifier(T*& pstr)
+    {
+        while( *pstr != 0 && (*pstr == '_' || *pstr == ':' || IsAlnum(*pstr)) ) pstr = pstr + 1;
+    }
+
+    void _ReleaseElements()
+    {
+        if( m_pElements != NULL ) free(m_pElements);
+        m_pElements = NULL;
+        m_nElements = 0;
+    }
+
+    bool _Parse()
+    {
+        _ReserveElement(); // Reserve index 0 for errors
+        m_eError = DuiLib::CMarkupDomT<T>::ERROR_NONE;
+        m_pErrorLocation = NULL;
+        T* pstrXML = m_pstrXML;
+        return _Parse(pstrXML, 0);
+    }
+
+    bool _Parse(T*& pstrText, unsigned long iParent)
+    {
+        SkipWhitespace(pstrText);
+        unsigned long iPrevious = 0;
+        for( ; ; )
+        {
+            if( *pstrText == 0 && iParent <= 1 ) return true;
+            SkipWhitespace(pstrText);
+            if( *pstrText != '<' ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_EXPECTED_START_TAG, pstrText);
+            if( pstrText[1] == '/' ) return true;
+            *pstrText++ = 0;
+            SkipWhitespace(pstrText);
+            // Skip comment or processing directive
+            if( *pstrText == '!' || *pstrText == '?' ) {
+                T ch = *pstrText;
+                if( *pstrText == '!' ) ch = '-';
+                while( *pstrText != 0 && !(*pstrText == ch && *(pstrText + 1) == '>') ) pstrText = pstrText + 1;
+                if( *pstrText != 0 ) pstrText += 2;
+                SkipWhitespace(pstrText);
+                continue;
+            }
+            SkipWhitespace(pstrText);
+            // Fill out element structure
+            XMLELEMENT* pEl = _ReserveElement();
+            unsigned long iPos = pEl - m_pElements;
+            pEl->iStart = pstrText - m_pstrXML;
+            pEl->iParent = iParent;
+            pEl->iNext = pEl->iChild = 0;
+            if( iPrevious != 0 ) m_pElements[iPrevious].iNext = iPos;
+            else if( iParent > 0 ) m_pElements[iParent].iChild = iPos;
+            iPrevious = iPos;
+            // Parse name
+            const T* pstrName = pstrText;
+            SkipIdentifier(pstrText);
+            T* pstrNameEnd = pstrText;
+            if( *pstrText == 0 ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_ELEMENT_NAME, pstrText);
+            // Parse attributes
+            if( !_ParseAttributes(pstrText) ) return false;
+            SkipWhitespace(pstrText);
+            if( pstrText[0] == '/' && pstrText[1] == '>' )
+            {
+                m_pElements[iPos].iData = pstrText - m_pstrXML;
+                *pstrText = 0;
+                pstrText += 2;
+            }
+            else
+            {
+                if( *pstrText != '>' ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_EXPECTED_START_TAG_CLOSING, pstrText);
+                // Parse node data
+                m_pElements[iPos].iData = ++pstrText - m_pstrXML;
+                T* pstrDest = pstrText;
+                if( !_ParseData(pstrText, pstrDest, '<') ) return false;
+                // Determine type of next element
+                if( *pstrText == 0 && iParent <= 1 ) return true;
+                if( *pstrText != '<' ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_EXPECTED_END_TAG_START, pstrText);
+                if( pstrText[0] == '<' && pstrText[1] != '/' )
+                {
+                    if( !_Parse(pstrText, iPos) ) return false;
+                }
+                if( pstrText[0] == '<' && pstrText[1] == '/' )
+                {
+                    *pstrDest = 0;
+                    *pstrText = 0;
+                    pstrText += 2;
+                    SkipWhitespace(pstrText);
+                    size_t cchName = pstrNameEnd - pstrName;
+                    // _tcsncmp：名字中间没有 0，逐个比较即可
+                    for( size_t i = 0; i < cchName; i++ ) {
+                        if( pstrText[i] != pstrName[i] ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_UNMATCHED_CLOSING_TAG, pstrText);
+                    }
+                    pstrText += cchName;
+                    SkipWhitespace(pstrText);
+                    if( *pstrText++ != '>' ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_UNMATCHED_CLOSING_TAG, pstrText);
+                }
+            }
+            *pstrNameEnd = 0;
+            SkipWhitespace(pstrText);
+        }
+    }
+
+    XMLELEMENT* _ReserveElement()
+    {
+        if( m_nElements == 0 ) m_nReservedElements = 0;
+        if( m_nElements >= m_nReservedElements ) {
+            m_nReservedElements += (m_nReservedElements / 2) + 500;
+            m_pElements = static_cast<XMLELEMENT*>(realloc(m_pElements, m_nReservedElements * sizeof(XMLELEMENT)));
+        }
+        return &m_pElements[m_nElements++];
+    }
+
+    bool _ParseAttributes(T*& pstrText)
+    {
+        // 无属性
+        T* pstrIdentifier = pstrText;
+        if( *pstrIdentifier == '/' && *++pstrIdentifier == '>' ) return true;
+        if( *pstrText == '>' ) return true;
+        *pstrText++ = 0;
+        SkipWhitespace(pstrText);
+        while( *pstrText != 0 && *pstrText != '>' && *pstrText != '/' ) {
+            SkipIdentifier(pstrText);
+            T* pstrIdentifierEnd = pstrText;
+            SkipWhitespace(pstrText);
+            if( *pstrText != '=' ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_PARSING_ATTRIBUTES, pstrText);
+            *pstrText++ = ' ';
+            *pstrIdentifierEnd = 0;
+            SkipWhitespace(pstrText);
+            if( *pstrText++ != '\"' ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_EXPECTED_ATTRIBUTE_VALUE, pstrText);
+            T* pstrDest = pstrText;
+            if( !_ParseData(pstrText, pstrDest, '\"') ) return false;
+            if( *pstrText == 0 ) return _Failed(DuiLib::CMarkupDomT<T>::ERROR_PARSING_ATTRIBUTE_STRING, pstrText);
+            *pstrDest = 0;
+            if( pstrText != pstrDest ) *pstrText = ' ';
+            pstrText++;
+            SkipWhitespace(pstrText);
+        }
+        return true;
+    }
+
+    bool _ParseData(T*& pstrText, T*& pstrDest, char cEnd)
+    {
+        while( *pstrText != 0 && *pstrText != cEnd ) {
+            if( *pstrText == '&' ) {
+                while( *pstrText == '&' ) {
+                    _ParseMetaChar(++pstrText, pstrDest);
+                }
+                if( *pstrText == cEnd )
+                    break;
+            }
+
+            if( *pstrText == ' ' ) {
+                *pstrDest++ = *pstrText++;
+                if( !m_bPreserveWhitespace ) SkipWhitespace(pstrText);
+            }
+            else {
+                T* pstrTemp = pstrText + 1;
+                while( pstrText < pstrTemp ) {
+                    *pstrDest++ = *pstrText++;
+                }
+            }
+        }
+        // Make sure that MapAttributes() works correctly when it parses
+        // over a value that has been transformed.
+        T* pstrFill = pstrDest + 1;
+        while( pstrFill < pstrText ) *pstrFill++ = ' ';
+        return true;
+    }
+
+    void _ParseMetaChar(T*& pstrText, T*& pstrDest)
+    {
+        if( pstrText[0] == 'a' && pstrText[1] == 'm' && pstrText[2] == 'p' && pstrText[3] == ';' ) {
+            *pstrDest++ = '&';
+            pstrText += 4;
+        }
+        else if( pstrText[0] == 'l' && pstrText[1] == 't' && pstrText[2] == ';' ) {
+            *pstrDest++ = '<';
+            pstrText += 3;
+        }
+        else if( pstrText[0] == 'g' && pstrText[1] == 't' && pstrText[2] == ';' ) {
+            *pstrDest++ = '>';
+            pstrText += 3;
+        }
+        else if( pstrText[0] == 'q' && pstrText[1] == 'u' && pstrText[2] == 'o' && pstrText[3] == 't' && pstrText[4] == ';' ) {
+            *pstrDest++ = '\"';
+            pstrText += 5;
+        }
+        else if( pstrText[0] == 'a' && pstrText[1] == 'p' && pstrText[2] == 'o' && pstrText[3] == 's' && pstrText[4] == ';' ) {
+            *pstrDest++ = '\'';
+            pstrText += 5;
+        }
+        else {
+            *pstrDest++ = '&';
+        }
+    }
+
+    bool _Failed(Error eError, const T* pstrLocation)
+    {
+        m_eError = eError;
+        m_pErrorLocation = pstrLocation;
+        return false; // Always return 'false'
+    }
+
+private:
+    LegacyMarkup(const LegacyMarkup&);
+    LegacyMarkup& operator=(const LegacyMarkup&);
+
+    T* m_pstrXML;
+    size_t m_nLength;
+    XMLELEMENT* m_pElements;
+    unsigned long m_nElements;
+    unsigned long m_nReservedElements;
+    bool m_bPreserveWhitespace;
+    Error m_eError;
+    const T* m_pErrorLocation;
+};
+
+#endif /* __LEGACY_MARKUP_H__ */
@@ -0,0 +1,190 @@
+/*
+* Module:   LegacyShadow
+*
+* Function: 原来 CShadowUI::MakeShadow 的算阴影代码，作为 CShadowRenderer 的对照（测试）和基准（基准程序）。
+*           PtInRegion 换成查每行的范围，其余保持原样
+*/
+#ifndef __LEGACY_SHADOW_H__
+#define __LEGACY_SHADOW_H__
+
+#include "UIShadowRenderer.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+inline unsigned int LegacyPreMultiply(unsigned int cl, unsigned char nAlpha)
+{
+    return ((cl & 0xFF) * static_cast<unsigned int>(nAlpha) / 255) |
+        (((cl >> 8) & 0xFF) * static_cast<unsigned int>(nAlpha) / 255) << 8 |
+        (((cl >> 16) & 0xFF) * static_cast<unsigned int>(nAlpha) / 255) << 16;
+}
+
+// 原来的 MakeShadow：逐行找父窗体的起止点，腐蚀 nSharpness - nSize 次，再沿轮廓盖上锥形核。
+// 找不到起点的行原来只写了一半的值，这里按空行补全；pShadBits 是自底向上的 DIB
+inline void LegacyMakeShadow(const DuiLib::CShadowRenderer::Params& params, const std::vector<DuiLib::CShadowRenderer::Span>& spans,
+    int cx, int cy, unsigned int* pShadBits)
+{
+    const int m_nSize = params.nSize;
+    const int m_nSharpness = params.nSharpness;
+    const unsigned char m_nDarkness = static_cast<unsigned char>(params.nDarkness);
+    const int m_nxOffset = params.nXOffset;
+    const int m_nyOffset = params.nYOffset;
+    const unsigned int m_Color = params.dwColor;
+    struct { int cx, cy; } szParent = { cx, cy }, szShadow = { cx + 2 * m_nSize, cy + 2 * m_nSize };
+
+    int nAnchors = std::max(szParent.cy, szShadow.cy);
+    int (*ptAnchors)[2] = new int[nAnchors + 2][2];
+    int (*ptAnchorsOri)[2] = new int[szParent.cy][2];
+    ptAnchors[0][0] = szParent.cx;
+    ptAnchors[0][1] = 0;
+    ptAnchors[nAnchors + 1][0] = szParent.cx;
+    ptAnchors[nAnchors + 1][1] = 0;
+    if (m_nSize > 0)
+    {
+        for (int i = 0; i < m_nSize; i++)
+        {
+            ptAnchors[i + 1][0] = szParent.cx;
+            ptAnchors[i + 1][1] = 0;
+            ptAnchors[szShadow.cy - i][0] = szParent.cx;
+            ptAnchors[szShadow.cy - i][1] = 0;
+        }
+        ptAnchors += m_nSize;
+    }
+    for (int i = 0; i < szParent.cy; i++)
+    {
+        const int nLeft = std::max(spans[i].left, 0), nRight = std::min(spans[i].right, szParent.cx);
+        if (nLeft >= nRight)
+        {
+            ptAnchors[i + 1][0] = szParent.cx;
+            ptAnchors[i + 1][1] = 0;
+            ptAnchorsOri[i][0] = szParent.cx;
+            ptAnchorsOri[i][1] = 0;
+        }
+        else
+        {
+            ptAnchors[i + 1][0] = nLeft + m_nSize;
+            ptAnchorsOri[i][0] = nLeft;
+            ptAnchors[i + 1][1] = nRight + m_nSize;
+            ptAnchorsOri[i][1] = nRight;
+        }
+    }
+
+    if (m_nSize > 0)
+        ptAnchors -= m_nSize;
+    int (*ptAnchorsTmp)[2] = new int[nAnchors + 2][2];
+    ptAnchorsTmp[0][0] = szParent.cx;
+    ptAnchorsTmp[0][1] = 0;
+    ptAnchorsTmp[nAnchors + 1][0] = szParent.cx;
+    ptAnchorsTmp[nAnchors + 1][1] = 0;
+    for (int i = 0; i < m_nSharpness - m_nSize; i++)
+    {
+        for (int j = 1; j < nAnchors + 1; j++)
+        {
+            ptAnchorsTmp[j][0] = std::max(ptAnchors[j - 1][0], std::max(ptAnchors[j][0], ptAnchors[j + 1][0])) + 1;
+            ptAnchorsTmp[j][1] = std::min(ptAnchors[j - 1][1], std::min(ptAnchors[j][1], ptAnchors[j + 1][1])) - 1;
+        }
+        int (*ptAnchorsXange)[2] = ptAnchorsTmp;
+        ptAnchorsTmp = ptAnchors;
+        ptAnchors = ptAnchorsXange;
+    }
+
+    ptAnchors += (m_nSize < 0 ? -m_nSize : 0) + 1;
+    int nKernelSize = m_nSize > m_nSharpness ? m_nSize : m_nSharpness;
+    int nCenterSize = m_nSize > m_nSharpness ? (m_nSize - m_nSharpness) : 0;
+    unsigned int* pKernel = new unsigned int[(2 * nKernelSize + 1) * (2 * nKernelSize + 1)];
+    unsigned int* pKernelIter = pKernel;
+    for (int i = 0; i <= 2 * nKernelSize; i++)
+    {
+        for (int j = 0; j <= 2 * nKernelSize; j++)
+        {
+            double dLength = sqrt((i - nKernelSize) * (i - nKernelSize) + (j - nKernelSize) * (double)(j - nKernelSize));
+            if (dLength < nCenterSize)
+                *pKernelIter = m_nDarkness << 24 | LegacyPreMultiply(m_Color, m_nDarkness);
+            else if (dLength <= nKernelSize)
+            {
+                unsigned int nFactor = ((unsigned int)((1 - (dLength - nCenterSize) / (m_nSharpness + 1)) * m_nDarkness));
+                *pKernelIter = nFactor << 24 | LegacyPreMultiply(m_Color, static_cast<unsigned char>(nFactor));
+            }
+            else
+                *pKernelIter = 0;
+            pKernelIter++;
+        }
+    }
+    for (int i = nKernelSize; i < szShadow.cy - nKernelSize; i++)
+    {
+        int j;
+        if (ptAnchors[i][0] < ptAnchors[i][1])
+        {
+            for (j = ptAnchors[i][0];
+                j < std::min(std::max(ptAnchors[i - 1][0], ptAnchors[i + 1][0]) + 1, ptAnchors[i][1]);
+                j++)
+            {
+                for (int k = 0; k <= 2 * nKernelSize; k++)
+                {
+                    unsigned int* pPixel = pShadBits + (szShadow.cy - i - 1 + nKernelSize - k) * szShadow.cx + j - nKernelSize;
+                    unsigned int* pKernelPixel = pKernel + k * (2 * nKernelSize + 1);
+                    for (int l = 0; l <= 2 * nKernelSize; l++)
+                    {
+                        if (*pPixel < *pKernelPixel)
+                            *pPixel = *pKernelPixel;
+                        pPixel++;
+                        pKernelPixel++;
+                    }
+                }
+            }
+            for (j = std::max(j, std::min(ptAnchors[i - 1][1], ptAnchors[i + 1][1]) - 1);
+                j < ptAnchors[i][1];
+                j++)
+            {
+                for (int k = 0; k <= 2 * nKernelSize; k++)
+                {
+                    unsigned int* pPixel = pShadBits + (szShadow.cy - i - 1 + nKernelSize - k) * szShadow.cx + j - nKernelSize;
+                    unsigned int* pKernelPixel = pKernel + k * (2 * nKernelSize + 1);
+                    for (int l = 0; l <= 2 * nKernelSize; l++)
+                    {
+                        if (*pPixel < *pKernelPixel)
+                            *pPixel = *pKernelPixel;
+                        pPixel++;
+                        pKernelPixel++;
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned int clCenter = m_nDarkness << 24 | LegacyPreMultiply(m_Color, m_nDarkness);
+    for (int i = std::min(nKernelSize, std::max(m_nSize - m_nyOffset, 0));
+        i < std::max(szShadow.cy - nKernelSize, std::min(szParent.cy + m_nSize - m_nyOffset, szParent.cy + 2 * m_nSize));
+        i++)
+    {
+        unsigned int* pLine = pShadBits + (szShadow.cy - i - 1) * szShadow.cx;
+        if (i - m_nSize + m_nyOffset < 0 || i - m_nSize + m_nyOffset >= szParent.cy)
+        {
+            for (int j = ptAnchors[i][0]; j < ptAnchors[i][1]; j++)
+                *(pLine + j) = clCenter;
+        }
+        else
+        {
+            for (int j = ptAnchors[i][0];
+                j < std::min(ptAnchorsOri[i - m_nSize + m_nyOffset][0] + m_nSize - m_nxOffset, ptAnchors[i][1]);
+                j++)
+                *(pLine + j) = clCenter;
+            for (int j = std::max(ptAnchorsOri[i - m_nSize + m_nyOffset][0] + m_nSize - m_nxOffset, 0);
+                j < std::min(ptAnchorsOri[i - m_nSize + m_nyOffset][1] + m_nSize - m_nxOffset, szShadow.cx);
+                j++)
+                *(pLine + j) = 0;
+            for (int j = std::max(ptAnchorsOri[i - m_nSize + m_nyOffset][1] + m_nSize - m_nxOffset, ptAnchors[i][0]);
+                j < ptAnchors[i][1];
+                j++)
+                *(pLine + j) = clCenter;
+        }
+    }
+
+    delete[] (ptAnchors - (m_nSize < 0 ? -m_nSize : 0) - 1);
+    delete[] ptAnchorsTmp;
+    delete[] ptAnchorsOri;
+    delete[] pKernel;
+}
+
+#endif /* __LEGACY_SHADOW_H__ */
@@ -0,0 +1,114 @@
+/*
+* Module:   LogBench
+*
+* Function: 日志调用在调用线程上的耗时：log.h 宏（只拷参数进环形缓冲）对比原来的写法
+*           （每次构造 __FILE__/__FUNCTION__ 宽字符串、截短文件名、在调用线程 swprintf 后加锁写文件）
+*
+*    不是测试，不注册到 ctest：./LogBench [调用次数]
+*/
+#define USE_LOG
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+Log::Log(const LogSite* pSites, uint32_t firstSiteId)
+    : m_pSites(pSites)
+    , m_firstSiteId(firstSiteId)
+{
+    if (CAsyncLogger::IsLevelEnabled(InLevel))
+        Log::Write(m_firstSiteId, &m_pSites[0]);
+}
+
+Log::~Log()
+{
+    if (CAsyncLogger::IsLevelEnabled(OutLevel))
+        Log::Write(m_firstSiteId + 1, &m_pSites[1]);
+}
+
+void Log::Write(uint32_t siteId, const LogSite* pSite, ...)
+{
+    va_list ap;
+    va_start(ap, pSite);
+    CAsyncLogger::Instance().WriteV(siteId, pSite, ap);
+    va_end(ap);
+}
+
+// 原来的同步写法
+static std::mutex s_legacyMutex;
+static FILE* s_legacyFile = NULL;
+
+// gcc 的 __FUNCTION__ 不是字面量，不能加 L 前缀，这里在函数内构造宽字符串，开销与原来的 _W(__FUNCTION__) 相同
+static void LegacyWrite(ENM_LOGGER_LEVEL level, const char* fileName, const char* functionName, int line, const wchar_t* format, ...)
+{
+    std::wstring file(fileName, fileName + strlen(fileName));
+    std::wstring function(functionName, functionName + strlen(functionName));
+    std::wstring shortFile = file.substr(file.rfind(L'/') == std::wstring::npos ? 0 : file.rfind(L'/') + 1);
+    std::wstring shortFunc = function.substr(function.rfind(L':') == std::wstring::npos ? 0 : function.rfind(L':') + 1);
+
+    wchar_t content[2048];
+    va_list ap;
+    va_start(ap, format);
+    vswprintf(content, 2048, format, ap);
+    va_end(ap);
+
+    wchar_t lineText[4096];
+    int length = swprintf(lineText, 4096, L"[#LogBench#] [%d] %ls %ls:%d [%ls]\n", level, shortFunc.c_str(), shortFile.c_str(), line, content);
+    std::lock_guard<std::mutex> lock(s_legacyMutex);
+    if (length > 0)
+        fwrite(lineText, sizeof(wchar_t), static_cast<size_t>(length), s_legacyFile);
+}
+
+#define LEGACY_INFO(formatstr, ...) LegacyWrite(InfoLevel, __FILE__, __FUNCTION__, __LINE__, formatstr, ##__VA_ARGS__)
+
+template <typename Fn>
+static void Measure(const char* name, int count, Fn fn)
+{
+    std::vector<double> latency;
+    latency.reserve(count);
+    double total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        fn(i);
+        latency.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count());
+        total += latency.back();
+        // 给后台线程留出时间，测的是调用线程的开销而不是环形缓冲写满后的丢弃
+        if (i % 2000 == 1999)
+            CAsyncLogger::Instance().Flush();
+    }
+    std::sort(latency.begin(), latency.end());
+    printf("%-10s mean %6.0f ns   p50 %6.0f ns   p99 %6.0f ns\n", name, total / count,
+        latency[latency.size() / 2], latency[latency.size() * 99 / 100]);
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+
+    CAsyncLogger::Config config;
+    config.directory = "LogBench_out/";
+    config.moduleName = L"LogBench";
+    config.bDebugOutput = false;
+    CAsyncLogger::Instance().Start(config);
+    s_legacyFile = fopen("LogBench_legacy.log", "wb");
+    if (s_legacyFile == NULL)
+        return 1;
+
+    Measure("legacy", count, [](int i) { LEGACY_INFO(L"onEnterRoom elapsed[%d] userId[%ls]", i, L"user_123"); });
+    Measure("LINFO", count, [](int i) { LINFO(L"onEnterRoom elapsed[%d] userId[%ls]", i, L"user_123"); });
+
+    CAsyncLogger::SetLogLevel(WarningLevel);
+    Measure("filtered", count, [](int i) { LINFO(L"onEnterRoom elapsed[%d] userId[%ls]", i, L"user_123"); });
+
+    CAsyncLogger::Instance().Stop();
+    fclose(s_legacyFile);
+    printf("dropped %llu\n", static_cast<unsigned long long>(CAsyncLogger::Instance().GetDroppedCount()));
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+* Module:   LogTest
+*
+* Function: log.h 日志宏：编译期生成的调用点元数据、级别过滤不对参数求值、延迟格式化的文本日志，
+*           以及二进制日志经 LogDecoder 还原后与文本日志逐行一致
+*/
+#define USE_LOG
+#include "log.h"
+#include "TestUtil.h"
+
+#include <dirent.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// log.cpp 依赖 Windows API 取日志目录，这里只提供宏用到的部分，由测试自己启动 CAsyncLogger
+Log::Log(const LogSite* pSites, uint32_t firstSiteId)
+    : m_pSites(pSites)
+    , m_firstSiteId(firstSiteId)
+{
+    if (CAsyncLogger::IsLevelEnabled(InLevel))
+        Log::Write(m_firstSiteId, &m_pSites[0]);
+}
+
+Log::~Log()
+{
+    if (CAsyncLogger::IsLevelEnabled(OutLevel))
+        Log::Write(m_firstSiteId + 1, &m_pSites[1]);
+}
+
+void Log::Write(uint32_t siteId, const LogSite* pSite, ...)
+{
+    va_list ap;
+    va_start(ap, pSite);
+    CAsyncLogger::Instance().WriteV(siteId, pSite, ap);
+    va_end(ap);
+}
+
+static_assert(LogSiteFileName("C:\\TRTCSDK\\Windows\\DuilibDemo\\TRTCCloudCore.cpp", "") != NULL, "");
+static constexpr const char* kShortFile = LogSiteFileName("C:\\a\\b/c\\TRTCCloudCore.cpp", "C:\\a\\b/c\\TRTCCloudCore.cpp");
+static constexpr const char* kShortFunc = LogSiteFuncName("ns::TRTCCloudCore::onError", "ns::TRTCCloudCore::onError",
+    "ns::TRTCCloudCore::onError", "ns::TRTCCloudCore::onError");
+
+static int g_evalCount = 0;
+
+static int CountEval()
+{
+    return ++g_evalCount;
+}
+
+namespace ns
+{
+    struct TRTCCloudCore
+    {
+        void onError()
+        {
+            LOGGER;
+            LINFO(L"onError errorCode[%d], errorInfo[%ls] %s %.2f %lld %x%%", -5, L"wide", "narrow", 3.14159, 1LL << 40, 255u);
+            LTRACE(L"plain");
+        }
+    };
+}
+
+static void WriteAll()
+{
+    ns::TRTCCloudCore().onError();
+
+    // 级别被过滤时参数不求值
+    g_evalCount = 0;
+    CAsyncLogger::SetLogLevel(InfoLevel);
+    LTRACE(L"filtered %d", CountEval());
+    LINFO(L"kept %d", CountEval());
+    TEST_CHECK(g_evalCount == 1);
+    CAsyncLogger::SetLogLevel(TrackLevel);
+
+    for (int i = 0; i < 100; ++i)
+        LINFO(L"loop %d name %ls %s", i, L"user_123", "room");
+}
+
+static std::vector<std::string> ListFiles(const std::string& directory)
+{
+    std::vector<std::string> files;
+    DIR* dir = opendir(directory.c_str());
+    if (dir == NULL)
+        return files;
+    while (struct dirent* entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+            files.push_back(directory + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static void ClearDirectory(const std::string& directory)
+{
+    std::vector<std::string> files = ListFiles(directory);
+    for (size_t i = 0; i < files.size(); ++i)
+        remove(files[i].c_str());
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    TEST_CHECK(file != NULL);
+    char buffer[4096];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, read);
+    fclose(file);
+    return data;
+}
+
+static std::string RunLogger(const std::string& directory, bool bBinaryFile)
+{
+    ClearDirectory(directory);
+    CAsyncLogger::Config config;
+    config.directory = directory;
+    config.moduleName = L"LogTest";
+    config.bDebugOutput = false;
+    config.bBinaryFile = bBinaryFile;
+    CAsyncLogger::Instance().Start(config);
+    WriteAll();
+    CAsyncLogger::Instance().Flush();
+    CAsyncLogger::Instance().Stop();
+
+    std::vector<std::string> files = ListFiles(directory);
+    TEST_CHECK(files.size() == 1);
+    return files[0];
+}
+
+// 去掉每行的时间字段（第三个 [...]），两次运行只有时间不同
+static std::vector<std::string> StripTime(const std::string& text)
+{
+    std::vector<std::string> lines;
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        size_t end = text.find('\n', begin);
+        TEST_CHECK(end != std::string::npos);
+        std::string line = text.substr(begin, end - begin);
+        begin = end + 1;
+
+        size_t open = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            open = line.find('[', i == 0 ? 0 : open + 1);
+            TEST_CHECK(open != std::string::npos);
+        }
+        size_t close = line.find(']', open);
+        TEST_CHECK(close != std::string::npos);
+        lines.push_back(line.substr(0, open) + line.substr(close + 1));
+    }
+    return lines;
+}
+
+int main()
+{
+    TEST_CHECK(strcmp(kShortFile, "TRTCCloudCore.cpp") == 0);
+    TEST_CHECK(strcmp(kShortFunc, "TRTCCloudCore::onError") == 0);
+
+    // 文本日志：wchar_t 原样写入，内容都是 ASCII，取低字节
+    std::string textPath = RunLogger("LogTest_text/", false);
+    std::string raw = ReadFile(textPath);
+    TEST_CHECK(raw.size() % sizeof(wchar_t) == 0);
+    std::string text;
+    const wchar_t* chars = reinterpret_cast<const wchar_t*>(raw.data());
+    for (size_t i = 0; i < raw.size() / sizeof(wchar_t); ++i)
+        text.push_back(static_cast<char>(chars[i]));
+
+    TEST_CHECK(text.find("[onError errorCode[-5], errorInfo[wide] narrow 3.14 1099511627776 ff%]") != std::string::npos);
+    TEST_CHECK(text.find("LogTest.cpp:") != std::string::npos);
+    TEST_CHECK(text.find("[IN]") != std::string::npos && text.find("[OUT]") != std::string::npos);
+    TEST_CHECK(text.find("filtered") == std::string::npos);
+    TEST_CHECK(text.find("[kept 1]") != std::string::npos);
+    TEST_CHECK(text.find("[loop 99 name user_123 room]") != std::string::npos);
+
+    // 二进制日志解码后与文本日志一致
+    std::string binaryPath = RunLogger("LogTest_bin/", true);
+    std::string decodedPath = "LogTest_decoded.log";
+    std::string command = std::string(LOG_DECODER_PATH) + " " + binaryPath + " " + decodedPath + " 2>/dev/null";
+    TEST_CHECK(system(command.c_str()) == 0);
+    std::string decoded = ReadFile(decodedPath);
+    TEST_CHECK(StripTime(decoded) == StripTime(text));
+
+    ClearDirectory("LogTest_text/");
+    ClearDirectory("LogTest_bin/");
+    remove(decodedPath.c_str());
+    printf("LogTest passed\n");
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+* Module:   LoopbackHttpServer
+*
+* Function: 测试用的 HTTP/1.1 服务器，监听 127.0.0.1 的随机端口，每个连接一个线程，
+*           请求交给 handler 生成完整的响应报文（状态行、头和内容都由 handler 决定）。只在 POSIX 上编译
+*/
+#ifndef __LOOPBACK_HTTP_SERVER_H__
+#define __LOOPBACK_HTTP_SERVER_H__
+
+#include "TestUtil.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class LoopbackHttpServer
+{
+public:
+    struct Request
+    {
+        std::string method;
+        std::string path;
+        std::string head;       // 请求行和头，不含最后的空行
+        std::string body;
+    };
+
+    // 返回 false 表示发送响应之后关闭连接
+    typedef std::function<bool(const Request& request, std::string& response)> Handler;
+
+public:
+    explicit LoopbackHttpServer(const Handler& handler)
+        : m_handler(handler)
+        , m_connections(0)
+        , m_requests(0)
+    {
+        m_listen = ::socket(AF_INET, SOCK_STREAM, 0);
+        TEST_CHECK(m_listen >= 0);
+        int reuse = 1;
+        ::setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        TEST_CHECK(::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        TEST_CHECK(::listen(m_listen, 64) == 0);
+        socklen_t length = sizeof(addr);
+        TEST_CHECK(::getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &length) == 0);
+        m_port = ntohs(addr.sin_port);
+        m_acceptThread = std::thread(&LoopbackHttpServer::AcceptProc, this);
+    }
+
+    // handler 中阻塞的请求要在析构之前放行
+    ~LoopbackHttpServer()
+    {
+        ::shutdown(m_listen, SHUT_RDWR);
+        ::close(m_listen);
+        m_acceptThread.join();
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+                ::shutdown(m_clients[i], SHUT_RDWR);
+            threads.swap(m_threads);
+        }
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+    }
+
+    unsigned short Port() const { return m_port; }
+
+    std::wstring Url(const std::string& path) const
+    {
+        std::string url = "http://127.0.0.1:" + std::to_string(m_port) + path;
+        return std::wstring(url.begin(), url.end());
+    }
+
+    int Connections() const { return m_connections; }
+    int Requests() const { return m_requests; }
+
+    static std::string Response(int status, const std::string& body)
+    {
+        return "HTTP/1.1 " + std::to_string(status) + " X\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+private:
+    void AcceptProc()
+    {
+        for (;;)
+        {
+            int fd = ::accept(m_listen, NULL, NULL);
+            if (fd < 0)
+                return;
+            ++m_connections;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_clients.push_back(fd);
+            m_threads.push_back(std::thread(&LoopbackHttpServer::ClientProc, this, fd));
+        }
+    }
+
+    static bool SendAll(int fd, const std::string& data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            ssize_t count = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0)
+                return false;
+            sent += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    // 收到 size 字节为止，连接关闭时返回 false
+    static bool RecvUntil(int fd, std::string& buffer, size_t size)
+    {
+        char chunk[4096];
+        while (buffer.size() < size)
+        {
+            ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (count <= 0)
+                return false;
+            buffer.append(chunk, count);
+        }
+        return true;
+    }
+
+    // 先从列表中去掉再关闭，析构时不会 shutdown 一个已经被复用的 fd
+    void CloseClient(int fd)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < m_clients.size(); ++i)
+            {
+                if (m_clients[i] == fd)
+                {
+                    m_clients.erase(m_clients.begin() + i);
+                    break;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    void ClientProc(int fd)
+    {
+        std::string buffer;
+        for (;;)
+        {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos)
+            {
+                if (!RecvUntil(fd, buffer, buffer.size() + 1))
+                {
+                    CloseClient(fd);
+                    return;
+                }
+            }
+            Request request;
+            request.head = buffer.substr(0, header_end);
+            size_t content_length = 0;
+            size_t pos = request.head.find("Content-Length: ");
+            if (pos != std::string::npos)
+                content_length = static_cast<size_t>(atoi(request.head.c_str() + pos + 16));
+            if (!RecvUntil(fd, buffer, header_end + 4 + content_length))
+            {
+                CloseClient(fd);
+                return;
+            }
+            request.body = buffer.substr(header_end + 4, content_length);
+            buffer.erase(0, header_end + 4 + content_length);
+            ++m_requests;
+
+            const size_t method_end = request.head.find(' ');
+            const size_t path_end = request.head.find(' ', method_end + 1);
+            request.method = request.head.substr(0, method_end);
+            request.path = request.head.substr(method_end + 1, path_end - method_end - 1);
+
+            std::string response;
+            const bool keep_open = m_handler(request, response);
+            if (!SendAll(fd, response) || !keep_open)
+            {
+                CloseClient(fd);
+                return;
+            }
+        }
+    }
+
+private:
+    Handler m_handler;
+    int m_listen;
+    unsigned short m_port;
+    std::atomic<int> m_connections;
+    std::atomic<int> m_requests;
+    std::thread m_acceptThread;
+    std::mutex m_mutex;
+    std::vector<int> m_clients;
+    std::vector<std::thread> m_threads;
+};
+
+#endif /* __LOOPBACK_HTTP_SERVER_H__ */
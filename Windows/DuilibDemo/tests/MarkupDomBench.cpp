@@ -0,0 +1,142 @@
+/*
+* Module:   MarkupDomBench
+*
+* Function: 解析 Demo 全部皮肤 XML 的耗时：旧版 CMarkup 扫描（LegacyMarkup.h）对比 CMarkupDomT。
+*           只解析一项测的是 Load/Parse；遍历一项再按 CDialogBuilder 的方式走一遍整棵树，
+*           逐个读取属性并按名字查 "name" 和 "float"，旧版每个节点都要重新 _MapAttributes
+*
+*    不是测试，不注册到 ctest：./MarkupDomBench [轮数]
+*/
+#include "UIMarkupDom.h"
+#include "LegacyMarkup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        data.erase(0, 3);
+    return data;
+}
+
+static size_t WalkLegacy(LegacyMarkup<char>::Node node)
+{
+    size_t sum = 0;
+    for (; node.IsValid(); node = node.GetSibling())
+    {
+        const int count = node.GetAttributeCount();
+        for (int i = 0; i < count; ++i)
+            sum += strlen(node.GetAttributeName(i)) + strlen(node.GetAttributeValue(i));
+        sum += strlen(node.GetAttributeValue("name")) + strlen(node.GetAttributeValue("float"));
+        sum += WalkLegacy(node.GetChild());
+    }
+    return sum;
+}
+
+static size_t WalkDom(const CMarkupDomA& dom, const CMarkupDomA::Node* pNode, unsigned int nNameId, unsigned int nFloatId)
+{
+    size_t sum = 0;
+    for (; pNode != NULL; pNode = pNode->pNext)
+    {
+        for (unsigned int i = 0; i < pNode->nAttributes; ++i)
+            sum += strlen(pNode->pAttributes[i].pName) + strlen(pNode->pAttributes[i].pValue);
+        const CMarkupDomA::Attribute* pName = dom.FindAttribute(pNode, nNameId);
+        const CMarkupDomA::Attribute* pFloat = dom.FindAttribute(pNode, nFloatId);
+        sum += (pName != NULL ? strlen(pName->pValue) : 0) + (pFloat != NULL ? strlen(pFloat->pValue) : 0);
+        sum += WalkDom(dom, pNode->pChild, nNameId, nFloatId);
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    std::vector<std::string> skins;
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        skins.push_back(ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]));
+        if (skins.back().empty())
+        {
+            fprintf(stderr, "cannot read %s\n", kSkinFiles[i]);
+            return 1;
+        }
+        totalBytes += skins.back().size();
+    }
+    printf("%zu skin files, %.1f KB, %d rounds\n", skins.size(), totalBytes / 1024.0, rounds);
+
+    // 旧版 Load 自己拷贝一份原文；新版就地解析，每轮拷进复用的缓冲区，拷贝计入耗时
+    std::vector<std::vector<char> > buffers(skins.size());
+    for (size_t i = 0; i < skins.size(); ++i)
+        buffers[i].resize(skins[i].size() + 1);
+
+    size_t checksum = 0;
+    for (int walk = 0; walk < 2; ++walk)
+    {
+        double begin = Now();
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < skins.size(); ++i)
+            {
+                LegacyMarkup<char> markup;
+                if (!markup.Load(skins[i].c_str()))
+                    return 1;
+                checksum += walk ? WalkLegacy(markup.GetRoot()) : markup.GetElementCount();
+            }
+        }
+        const double legacyUs = (Now() - begin) * 1e6 / rounds;
+
+        begin = Now();
+        CMarkupDomA dom;
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (size_t i = 0; i < skins.size(); ++i)
+            {
+                memcpy(&buffers[i][0], skins[i].c_str(), skins[i].size() + 1);
+                if (!dom.Parse(&buffers[i][0], true))
+                    return 1;
+                checksum += walk ? WalkDom(dom, dom.GetRoot(), dom.FindNameId("name"), dom.FindNameId("float")) : dom.GetNodeCount();
+            }
+        }
+        const double domUs = (Now() - begin) * 1e6 / rounds;
+
+        printf("%-14s CMarkup %8.1f us (%6.1f MB/s)   CMarkupDom %8.1f us (%6.1f MB/s)   (%.2fx)\n",
+            walk ? "parse + walk" : "parse only", legacyUs, totalBytes / legacyUs, domUs, totalBytes / domUs, legacyUs / domUs);
+    }
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
@@ -0,0 +1,419 @@
+/*
+* Module:   MarkupDomTest
+*
+* Function: CMarkupDomT 与旧版 CMarkup 扫描（LegacyMarkup.h）对照：随 Demo 发布的皮肤逐节点、逐属性一致，
+*           按名字/id 查找属性和子节点的结果与旧版 _tcsicmp 线性查找一致，出错的输入返回相同的错误和位置；
+*           旧版在结尾处越过结束 0 读取的几种输入，新版在恰好大小的缓冲区内完成
+*/
+#include "UIMarkupDom.h"
+#include "LegacyMarkup.h"
+#include "TestUtil.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        data.erase(0, 3);
+    return data;
+}
+
+// 按码点展开，Windows 上是 UTF-16，这里只需要与 char 版本走同样的分支
+static std::wstring Widen(const std::string& text)
+{
+    std::wstring out;
+    size_t i = 0;
+    while (i < text.size())
+    {
+        uint32_t c = static_cast<unsigned char>(text[i++]);
+        int extra = 0;
+        if (c >= 0xF0) { c &= 0x07; extra = 3; }
+        else if (c >= 0xE0) { c &= 0x0F; extra = 2; }
+        else if (c >= 0xC0) { c &= 0x1F; extra = 1; }
+        for (int k = 0; k < extra && i < text.size(); ++k)
+            c = (c << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+        out += static_cast<wchar_t>(c);
+    }
+    return out;
+}
+
+template <typename T>
+static std::basic_string<T> Convert(const std::string& text);
+
+template <>
+std::string Convert<char>(const std::string& text) { return text; }
+
+template <>
+std::wstring Convert<wchar_t>(const std::string& text) { return Widen(text); }
+
+template <typename T>
+static bool Equal(const T* a, const T* b)
+{
+    while (*a != 0 && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+// 没有结束标签就到了结尾的元素，旧版不截断名字，名字后面带着 '>' 和内容；新版截断在标识符处
+template <typename T>
+static bool EqualName(const T* name, const T* oldName)
+{
+    while (*name != 0 && *name == *oldName)
+    {
+        ++name;
+        ++oldName;
+    }
+    return *name == 0 && (*oldName == 0 || *oldName == '>');
+}
+
+template <typename T>
+static std::basic_string<T> Upper(const T* text)
+{
+    std::basic_string<T> out;
+    for (; *text != 0; ++text)
+        out += (*text >= 'a' && *text <= 'z') ? static_cast<T>(*text - ('a' - 'A')) : *text;
+    return out;
+}
+
+// 新版把整段文本交给 Parse 就地改写；用恰好大小的堆缓冲区，越界读写能被 ASan 发现
+template <typename T>
+struct ExactBuffer
+{
+    explicit ExactBuffer(const std::basic_string<T>& text) : length(text.size()), data(new T[text.size() + 1])
+    {
+        memcpy(data, text.c_str(), (text.size() + 1) * sizeof(T));
+    }
+    ~ExactBuffer() { delete[] data; }
+
+    size_t length;
+    T* data;
+
+private:
+    ExactBuffer(const ExactBuffer&);
+    ExactBuffer& operator=(const ExactBuffer&);
+};
+
+template <typename T>
+static void CompareNodes(CMarkupDomT<T>& dom, const typename CMarkupDomT<T>::Node* pNode, typename LegacyMarkup<T>::Node old)
+{
+    typedef typename CMarkupDomT<T>::Attribute Attribute;
+    for (; pNode != NULL || old.IsValid(); pNode = pNode->pNext, old = old.GetSibling())
+    {
+        TEST_CHECK(pNode != NULL && old.IsValid());
+        TEST_CHECK(EqualName(pNode->pName, old.GetName()));
+        TEST_CHECK(Equal(pNode->pValue, old.GetValue()));
+        TEST_CHECK(static_cast<int>(pNode->nAttributes) == old.GetAttributeCount());
+        for (unsigned int i = 0; i < pNode->nAttributes; ++i)
+        {
+            const Attribute& attr = pNode->pAttributes[i];
+            TEST_CHECK(Equal(attr.pName, old.GetAttributeName(i)));
+            TEST_CHECK(Equal(attr.pValue, old.GetAttributeValue(i)));
+            TEST_CHECK(attr.nNameId == dom.FindNameId(attr.pName));
+            TEST_CHECK((pNode->nAttributeMask & (1u << (attr.nNameId & 31))) != 0);
+
+            // 按名字查找返回第一个同名属性，与旧版一样不区分大小写
+            const Attribute* pFound = dom.FindAttribute(pNode, attr.pName);
+            TEST_CHECK(pFound != NULL && Equal(pFound->pValue, old.GetAttributeValue(attr.pName)));
+            const std::basic_string<T> upper = Upper(attr.pName);
+            pFound = dom.FindAttribute(pNode, upper.c_str());
+            TEST_CHECK(pFound != NULL && Equal(pFound->pValue, old.GetAttributeValue(upper.c_str())));
+            TEST_CHECK(dom.FindAttribute(pNode, attr.nNameId) == dom.FindAttribute(pNode, attr.pName));
+        }
+
+        // 文档中出现过、但这个节点没有的名字：掩码或线性查找都要排除掉
+        const T* pOtherName = pNode->pChild != NULL ? pNode->pChild->pName : pNode->pName;
+        TEST_CHECK((dom.FindAttribute(pNode, pOtherName) != NULL) == old.HasAttribute(pOtherName));
+
+        // 按名字查找子节点：与旧版 GetChild(name) 找到同一个位置的节点
+        int index = 0;
+        for (const typename CMarkupDomT<T>::Node* pChild = pNode->pChild; pChild != NULL; pChild = pChild->pNext, ++index)
+        {
+            typename LegacyMarkup<T>::Node oldFound = old.GetChild(Upper(pChild->pName).c_str());
+            if (!oldFound.IsValid())
+            {
+                // 旧版名字没有截断，只能用完整的旧名字找到
+                TEST_CHECK(pChild->pNext == NULL && pChild->pChild == NULL);
+                continue;
+            }
+            const typename CMarkupDomT<T>::Node* pFound = dom.FindChild(pNode, pChild->pName);
+            TEST_CHECK(pFound != NULL && oldFound.IsValid());
+            TEST_CHECK(pFound->pParent == pNode);
+            int foundIndex = 0;
+            for (typename LegacyMarkup<T>::Node it = old.GetChild(); it.GetName() != oldFound.GetName(); it = it.GetSibling())
+                ++foundIndex;
+            int domIndex = 0;
+            for (const typename CMarkupDomT<T>::Node* it = pNode->pChild; it != pFound; it = it->pNext)
+                ++domIndex;
+            TEST_CHECK(foundIndex == domIndex);
+            TEST_CHECK(domIndex <= index);
+        }
+        CompareNodes(dom, pNode->pChild, old.GetChild());
+    }
+}
+
+// 同一段文本分别交给两个解析器，结果（成功与否、错误码、出错位置、整棵树）必须一致。
+// 旧版越过结尾读取时，出错位置会超过原文长度，新版应停在结尾的 0 上
+template <typename T>
+static bool CompareParse(const std::basic_string<T>& text, bool bPreserveWhitespace)
+{
+    static const T kBeyond[1] = { 0 };
+    LegacyMarkup<T> old;
+    old.SetPreserveWhitespace(bPreserveWhitespace);
+    const bool oldOk = old.Load(text.c_str(), kBeyond);
+
+    ExactBuffer<T> buffer(text);
+    CMarkupDomT<T> dom;
+    const bool ok = dom.Parse(buffer.data, bPreserveWhitespace);
+    TEST_CHECK(ok == oldOk);
+    TEST_CHECK(dom.IsValid() == ok);
+    if (!ok)
+    {
+        TEST_CHECK(dom.GetError() == old.GetError());
+        TEST_CHECK(dom.GetRoot() == NULL);
+        const size_t offset = dom.GetErrorLocation() - buffer.data;
+        TEST_CHECK(offset <= buffer.length);
+        if (old.GetErrorOffset() <= old.GetLength())
+            TEST_CHECK(offset == old.GetErrorOffset());
+        else
+            TEST_CHECK(offset == buffer.length);
+        return false;
+    }
+    TEST_CHECK(dom.GetNodeCount() == old.GetElementCount());
+    CompareNodes(dom, dom.GetRoot(), old.GetRoot());
+    return true;
+}
+
+template <typename T>
+static void CheckSkins()
+{
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        const std::string data = ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]);
+        TEST_CHECK(!data.empty());
+        const std::basic_string<T> text = Convert<T>(data);
+        TEST_CHECK(CompareParse(text, true));
+        TEST_CHECK(CompareParse(text, false));
+
+        // 截断的文件：开头一段逐个长度，后面按步长抽样
+        for (size_t n = 0; n < text.size(); n += (n < 2048 ? 1 : 37))
+            CompareParse(text.substr(0, n), true);
+    }
+}
+
+static void TestShippedSkins()
+{
+    CheckSkins<char>();
+    CheckSkins<wchar_t>();
+}
+
+static void TestLookup()
+{
+    std::string text =
+        "<?xml version=\"1.0\"?><!-- comment -->"
+        "<Window Size=\"1,2\" size=\"dup\" TEXT=\"a &amp; &lt;b&gt; &quot;c&quot; &apos;d&apos; &x\">"
+        "  <Button name=\"b1\"/><button name=\"b2\"/>"
+        "  <Label text=\"t\">label  text</Label>"
+        "</Window>";
+    TEST_CHECK(CompareParse(text, true));
+    TEST_CHECK(CompareParse(text, false));
+
+    CMarkupDomA dom;
+    TEST_CHECK(dom.Parse(&text[0], true));
+    CMarkupDomA::Node* pRoot = dom.GetRoot();
+    TEST_CHECK(pRoot != NULL && strcmp(pRoot->pName, "Window") == 0);
+    TEST_CHECK(strcmp(dom.FindAttribute(pRoot, "SIZE")->pValue, "1,2") == 0);
+    TEST_CHECK(strcmp(dom.FindAttribute(pRoot, "text")->pValue, "a & <b> \"c\" 'd' &x") == 0);
+    TEST_CHECK(dom.FindNameId("size") == dom.FindNameId("Size"));
+    TEST_CHECK(dom.FindNameId("button") == dom.FindNameId("Button"));
+    TEST_CHECK(strcmp(dom.FindAttribute(dom.FindChild(pRoot, "BUTTON"), "name")->pValue, "b1") == 0);
+    TEST_CHECK(strcmp(dom.FindChild(pRoot, "label")->pValue, "label  text") == 0);
+    TEST_CHECK(dom.FindNameId("missing") == CMarkupDomA::INVALID_NAME_ID);
+    TEST_CHECK(dom.FindAttribute(pRoot, "missing") == NULL);
+    TEST_CHECK(dom.FindChild(pRoot, "missing") == NULL);
+    TEST_CHECK(dom.FindAttribute(pRoot, CMarkupDomA::INVALID_NAME_ID) == NULL);
+    TEST_CHECK(dom.FindAttribute(NULL, "size") == NULL);
+    TEST_CHECK(dom.FindChild(NULL, "button") == NULL);
+    TEST_CHECK(dom.FindNameId(NULL) == CMarkupDomA::INVALID_NAME_ID);
+
+    // 超过 32 个名字后 id 在掩码上重叠：掩码放行之后仍由线性查找排除
+    std::string many = "<a n0=\"0\">";
+    for (int i = 1; i < 40; ++i)
+        many += "<b n" + std::to_string(i) + "=\"" + std::to_string(i) + "\"/>";
+    many += "</a>";
+    TEST_CHECK(CompareParse(many, true));
+    TEST_CHECK(dom.Parse(&many[0], true));
+    pRoot = dom.GetRoot();
+    const unsigned int id0 = dom.FindAttribute(pRoot, "n0")->nNameId;
+    int aliased = 0;
+    for (int i = 1; i < 40; ++i)
+    {
+        const std::string name = "n" + std::to_string(i);
+        const unsigned int id = dom.FindNameId(name.c_str());
+        TEST_CHECK(id != CMarkupDomA::INVALID_NAME_ID && id != id0);
+        if ((id & 31) == (id0 & 31))
+            ++aliased;
+        TEST_CHECK(dom.FindAttribute(pRoot, id) == NULL);
+    }
+    TEST_CHECK(aliased > 0);
+
+    // 旧版每个节点最多映射 64 个属性，新版全部保留
+    std::string wide = "<a";
+    for (int i = 0; i < 70; ++i)
+        wide += " k" + std::to_string(i) + "=\"" + std::to_string(i) + "\"";
+    wide += "/>";
+    LegacyMarkup<char> old;
+    TEST_CHECK(old.Load(wide.c_str()));
+    TEST_CHECK(old.GetRoot().GetAttributeCount() == 64);
+    TEST_CHECK(dom.Parse(&wide[0], true));
+    TEST_CHECK(dom.GetRoot()->nAttributes == 70);
+    TEST_CHECK(strcmp(dom.FindAttribute(dom.GetRoot(), "k69")->pValue, "69") == 0);
+
+    // 没有结束标签就到了结尾：名字截断在标识符处，仍能按名字找到
+    std::string open = "<a><b>text";
+    TEST_CHECK(CompareParse(open, true));
+    TEST_CHECK(dom.Parse(&open[0], true));
+    TEST_CHECK(strcmp(dom.GetRoot()->pChild->pName, "b") == 0);
+    TEST_CHECK(strcmp(dom.GetRoot()->pChild->pValue, "text") == 0);
+    TEST_CHECK(dom.FindChild(dom.GetRoot(), "B") == dom.GetRoot()->pChild);
+}
+
+static void TestErrors()
+{
+    struct Case
+    {
+        const char* text;
+        CMarkupDomA::Error error;
+    };
+    static const Case kCases[] = {
+        { "", CMarkupDomA::ERROR_NONE },
+        { "  <!-- only a comment -->  ", CMarkupDomA::ERROR_NONE },
+        { "<a><b>unclosed child at the end", CMarkupDomA::ERROR_NONE },
+        { "<a/><b/>", CMarkupDomA::ERROR_NONE },
+        { "text", CMarkupDomA::ERROR_EXPECTED_START_TAG },
+        { "<a/>junk", CMarkupDomA::ERROR_EXPECTED_START_TAG },
+        { "<a", CMarkupDomA::ERROR_ELEMENT_NAME },
+        { "<a b>", CMarkupDomA::ERROR_PARSING_ATTRIBUTES },
+        { "<a b c=\"1\"/>", CMarkupDomA::ERROR_PARSING_ATTRIBUTES },
+        { "<a b=c/>", CMarkupDomA::ERROR_EXPECTED_ATTRIBUTE_VALUE },
+        { "<a b='c'/>", CMarkupDomA::ERROR_EXPECTED_ATTRIBUTE_VALUE },
+        { "<a b=\"c/>", CMarkupDomA::ERROR_PARSING_ATTRIBUTE_STRING },
+        { "<a / >", CMarkupDomA::ERROR_EXPECTED_START_TAG_CLOSING },
+        { "<a b=\"1\" ?>", CMarkupDomA::ERROR_PARSING_ATTRIBUTES },
+        { "<a><b><c>x", CMarkupDomA::ERROR_EXPECTED_END_TAG_START },
+        { "<a></b>", CMarkupDomA::ERROR_UNMATCHED_CLOSING_TAG },
+        { "<a></A>", CMarkupDomA::ERROR_UNMATCHED_CLOSING_TAG },
+        { "<a></a x>", CMarkupDomA::ERROR_UNMATCHED_CLOSING_TAG },
+        { "<ab><c/></a>", CMarkupDomA::ERROR_UNMATCHED_CLOSING_TAG },
+    };
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i)
+    {
+        const std::string text = kCases[i].text;
+        TEST_CHECK(CompareParse(text, true) == (kCases[i].error == CMarkupDomA::ERROR_NONE));
+        TEST_CHECK(CompareParse(Widen(text), true) == (kCases[i].error == CMarkupDomA::ERROR_NONE));
+        ExactBuffer<char> buffer(text);
+        CMarkupDomA dom;
+        dom.Parse(buffer.data, true);
+        TEST_CHECK(dom.GetError() == kCases[i].error);
+    }
+
+    // 失败之后可以继续解析别的文档
+    CMarkupDomA dom;
+    std::string bad = "<a></b>";
+    TEST_CHECK(!dom.Parse(&bad[0], true));
+    std::string good = "<a x=\"1\"/>";
+    TEST_CHECK(dom.Parse(&good[0], true));
+    TEST_CHECK(dom.GetError() == CMarkupDomA::ERROR_NONE && dom.GetErrorLocation() == NULL);
+    TEST_CHECK(strcmp(dom.FindAttribute(dom.GetRoot(), "X")->pValue, "1") == 0);
+    TEST_CHECK(!dom.Parse(NULL, true));
+}
+
+// 旧版越过结尾 0 读取的输入：把一段 XML 放在结尾的 0 之后，旧版会把它解析进来或把出错位置报在结尾之后；
+// 新版在恰好大小的缓冲区内解析，结果只取决于原文
+static void TestEofOverreads()
+{
+    // 文本末尾的 '&'：旧版拷贝结尾的 0 之后继续读，把后面的 <b/> 当成了子节点
+    {
+        LegacyMarkup<char> old;
+        TEST_CHECK(old.Load("<a>x&", "<b/>"));
+        TEST_CHECK(old.GetRoot().GetChild().IsValid());
+
+        ExactBuffer<char> buffer("<a>x&");
+        CMarkupDomA dom;
+        TEST_CHECK(dom.Parse(buffer.data, true));
+        TEST_CHECK(dom.GetRoot()->pChild == NULL);
+        TEST_CHECK(strcmp(dom.GetRoot()->pValue, "x&") == 0);
+    }
+    // 属性值末尾的 '&'：旧版读到后面的引号，把截断的属性当成完整的
+    {
+        LegacyMarkup<char> old;
+        TEST_CHECK(old.Load("<a b=\"x&", "\"/>"));
+
+        ExactBuffer<char> buffer("<a b=\"x&");
+        CMarkupDomA dom;
+        TEST_CHECK(!dom.Parse(buffer.data, true));
+        TEST_CHECK(dom.GetError() == CMarkupDomA::ERROR_PARSING_ATTRIBUTE_STRING);
+        TEST_CHECK(dom.GetErrorLocation() == buffer.data + buffer.length);
+    }
+    // 期望引号和期望 '>' 时先 ++ 再报错：旧版的出错位置在结尾 0 之后，随后还要从那里拷贝出错文本
+    static const char* const kPastEnd[] = { "<a b=", "<a b= ", "<a></a", "<a></a " };
+    for (size_t i = 0; i < sizeof(kPastEnd) / sizeof(kPastEnd[0]); ++i)
+    {
+        LegacyMarkup<char> old;
+        TEST_CHECK(!old.Load(kPastEnd[i], ""));
+        TEST_CHECK(old.GetErrorOffset() == old.GetLength() + 1);
+
+        ExactBuffer<char> buffer(kPastEnd[i]);
+        CMarkupDomA dom;
+        TEST_CHECK(!dom.Parse(buffer.data, true));
+        TEST_CHECK(dom.GetError() == old.GetError());
+        TEST_CHECK(dom.GetErrorLocation() == buffer.data + buffer.length);
+    }
+    // 实体在结尾处被截断，_ParseMetaChar 的短路比较不会越过 0
+    static const char* const kEntities[] = { "<a>&", "<a>&a", "<a>&am", "<a>&amp", "<a>&q", "<a>&quot", "<a b=\"&lt" };
+    for (size_t i = 0; i < sizeof(kEntities) / sizeof(kEntities[0]); ++i)
+    {
+        CompareParse(std::string(kEntities[i]), true);
+        CompareParse(Widen(kEntities[i]), true);
+    }
+}
+
+int main()
+{
+    TestLookup();
+    TestErrors();
+    TestEofOverreads();
+    TestShippedSkins();
+    printf("MarkupDomTest passed\n");
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+* Module:   Md5Bench
+*
+* Function: md5 吞吐：TenMd5 单条 对比 md5_batch 多条并行；md5_hex 对比逐字节格式化
+*
+*    不是测试，不注册到 ctest：./Md5Bench
+*/
+#include "md5.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main()
+{
+    const size_t kMessages = 64;
+    const size_t kTotalBytes = 128u << 20;
+    const size_t kSizes[] = { 64, 1024, 65536 };
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); ++s)
+    {
+        size_t size = kSizes[s];
+        size_t rounds = kTotalBytes / size;
+        std::vector<std::string> messages(kMessages, std::string(size, 'x'));
+        std::vector<const md5_byte_t*> data;
+        std::vector<size_t> sizes;
+        for (size_t i = 0; i < kMessages; ++i)
+        {
+            data.push_back(reinterpret_cast<const md5_byte_t*>(messages[i].data()));
+            sizes.push_back(size);
+        }
+
+        BYTE digest[16];
+        double begin = Now();
+        for (size_t i = 0; i < rounds; ++i)
+            TenMd5(reinterpret_cast<BYTE*>(&messages[i % kMessages][0]), static_cast<DWORD>(size), digest);
+        double single = Now() - begin;
+
+        std::vector<md5_byte_t[16]> digests(kMessages);
+        begin = Now();
+        for (size_t i = 0; i < rounds; i += kMessages)
+            md5_batch(data.data(), sizes.data(), kMessages, digests.data());
+        double batch = Now() - begin;
+
+        printf("size %6zu   TenMd5 %8.1f MB/s   md5_batch(%d lanes) %8.1f MB/s\n", size,
+            kTotalBytes / single / 1e6, md5_batch_lanes(), kTotalBytes / batch / 1e6);
+    }
+
+    const int kHexRounds = 5000000;
+    md5_byte_t digest[16] = { 0x01, 0x23, 0xab, 0xff };
+    char hex[33];
+    volatile char sink = 0;
+    double begin = Now();
+    for (int i = 0; i < kHexRounds; ++i)
+    {
+        digest[0] = static_cast<md5_byte_t>(i);
+        md5_hex(digest, hex);
+        sink ^= hex[1];
+    }
+    double tableHex = Now() - begin;
+
+    begin = Now();
+    for (int i = 0; i < kHexRounds; ++i)
+    {
+        digest[0] = static_cast<md5_byte_t>(i);
+        for (int k = 0; k < 16; ++k)
+            snprintf(hex + k * 2, 3, "%02x", digest[k]);
+        sink ^= hex[1];
+    }
+    double printfHex = Now() - begin;
+    printf("hex      md5_hex %6.1f ns   snprintf per byte %6.1f ns\n", tableHex / kHexRounds * 1e9, printfHex / kHexRounds * 1e9);
+    return 0;
+}
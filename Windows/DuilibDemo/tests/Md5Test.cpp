@@ -0,0 +1,167 @@
+/*
+* Module:   Md5Test
+*
+* Function: md5 的 RFC 1321 标准向量，md5_batch 与分块 md5_append 的结果一致性，md5_hex，
+*           以及多个线程同时第一次调用 md5_batch（CPU 检测只做一次，ThreadSanitizer 下没有数据竞争）
+*/
+#include "md5.h"
+#include "TestUtil.h"
+
+#include <string.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string Hex(const md5_byte_t digest[16])
+{
+    char hex[33];
+    md5_hex(digest, hex);
+    return hex;
+}
+
+static const char* const kKnownAnswers[][2] = {
+    { "", "d41d8cd98f00b204e9800998ecf8427e" },
+    { "a", "0cc175b9c0f1b6a831c399e269772661" },
+    { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+    { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+    { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+    { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f" },
+    { "12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+};
+
+static const size_t kKnownAnswerCount = sizeof(kKnownAnswers) / sizeof(kKnownAnswers[0]);
+
+static void TestKnownAnswers()
+{
+    std::vector<const md5_byte_t*> data;
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < kKnownAnswerCount; ++i)
+    {
+        const char* message = kKnownAnswers[i][0];
+        BYTE digest[16];
+        TenMd5(reinterpret_cast<BYTE*>(const_cast<char*>(message)), static_cast<DWORD>(strlen(message)), digest);
+        TEST_CHECK(Hex(digest) == kKnownAnswers[i][1]);
+
+        md5_state_t state;
+        md5_init(&state);
+        for (size_t k = 0; message[k] != '\0'; ++k)
+            md5_append(&state, reinterpret_cast<const md5_byte_t*>(message + k), 1);
+        md5_finish(&state, digest);
+        TEST_CHECK(Hex(digest) == kKnownAnswers[i][1]);
+
+        data.push_back(reinterpret_cast<const md5_byte_t*>(message));
+        sizes.push_back(strlen(message));
+    }
+
+    std::vector<md5_byte_t[16]> digests(kKnownAnswerCount);
+    md5_batch(data.data(), sizes.data(), data.size(), digests.data());
+    for (size_t i = 0; i < kKnownAnswerCount; ++i)
+        TEST_CHECK(Hex(digests[i]) == kKnownAnswers[i][1]);
+}
+
+// 随机条数（覆盖不满一组 lane 的情况）和长度（覆盖 55/56/64 字节附近的补位边界）
+static void TestBatchMatchesStreaming()
+{
+    std::mt19937 rng(1);
+    for (int round = 0; round < 2000; ++round)
+    {
+        size_t count = rng() % 21;
+        std::vector<std::string> messages(count);
+        std::vector<const md5_byte_t*> data;
+        std::vector<size_t> sizes;
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t size = rng() % 4 == 0 ? rng() % 5000 : rng() % 300;
+            messages[i].resize(size);
+            for (size_t k = 0; k < size; ++k)
+                messages[i][k] = static_cast<char>(rng());
+            data.push_back(reinterpret_cast<const md5_byte_t*>(messages[i].data()));
+            sizes.push_back(size);
+        }
+
+        std::vector<md5_byte_t[16]> digests(count + 1);
+        md5_batch(data.data(), sizes.data(), count, digests.data());
+        for (size_t i = 0; i < count; ++i)
+        {
+            md5_state_t state;
+            md5_init(&state);
+            size_t pos = 0;
+            while (pos < sizes[i])
+            {
+                size_t chunk = rng() % 150 + 1;
+                if (chunk > sizes[i] - pos)
+                    chunk = sizes[i] - pos;
+                md5_append(&state, data[i] + pos, static_cast<int>(chunk));
+                pos += chunk;
+            }
+            md5_byte_t digest[16];
+            md5_finish(&state, digest);
+            TEST_CHECK(memcmp(digest, digests[i], 16) == 0);
+        }
+    }
+}
+
+static void TestHex()
+{
+    md5_byte_t digest[16];
+    for (int i = 0; i < 16; ++i)
+        digest[i] = static_cast<md5_byte_t>(i * 17);
+    TEST_CHECK(Hex(digest) == "00112233445566778899aabbccddeeff");
+
+    int lanes = md5_batch_lanes();
+    TEST_CHECK(lanes == 1 || lanes == 4 || lanes == 8);
+}
+
+// 要在其他测试之前运行，这样 md5_batch_lanes 的第一次调用发生在多个线程上
+static void TestConcurrentFirstUse()
+{
+    std::vector<std::string> messages;
+    for (int i = 0; i < 16; ++i)
+        messages.push_back(std::string(i * 37, static_cast<char>('a' + i)));
+    std::vector<const md5_byte_t*> data;
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        data.push_back(reinterpret_cast<const md5_byte_t*>(messages[i].data()));
+        sizes.push_back(messages[i].size());
+    }
+
+    std::atomic<bool> go(false);
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&]() {
+            while (!go)
+                std::this_thread::yield();
+            md5_byte_t digests[16][16];
+            md5_batch(&data[0], &sizes[0], data.size(), digests);
+            for (size_t i = 0; i < messages.size(); ++i)
+            {
+                md5_state_t state;
+                md5_byte_t expected[16];
+                md5_init(&state);
+                md5_append(&state, data[i], static_cast<int>(sizes[i]));
+                md5_finish(&state, expected);
+                if (memcmp(expected, digests[i], 16) != 0)
+                    ++mismatches;
+            }
+        }));
+    }
+    go = true;
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+    TEST_CHECK(mismatches == 0);
+}
+
+int main()
+{
+    TestConcurrentFirstUse();
+    TestKnownAnswers();
+    TestBatchMatchesStreaming();
+    TestHex();
+    printf("Md5Test passed (%d lanes)\n", md5_batch_lanes());
+    return 0;
+}
@@ -0,0 +1,394 @@
+/*
+* Module:   PixelConvertBench
+*
+* Function: 1. 大图上 RGBA 转预乘 BGRA 的耗时：原来 LoadImage 中的逐像素循环，对比 UIPixelConvert 的
+*              标量、SSSE3、AVX2 实现；
+*           2. 整套皮肤换色（SetHSL）的耗时：原来 AdjustImage 逐张逐像素的浮点公式，对比颜色表的标量、
+*              SSE 实现和分块并行。拖动色调滑块时每次换一个 H，这里每轮轮换一组 HSL 参数。
+*           像素取自 Demo 皮肤（res/resouce/trtcskin）引用的全部图片解码结果，alpha 分布与真实皮肤一致；
+*           1080p、4K 两档是把这些像素平铺成整屏大小的背景图。括号中是相对原来循环的加速比
+*
+*    不是测试，不注册到 ctest：./PixelConvertBench [轮数]
+*/
+#include "UIMarkupDom.h"
+#include "UIImagePreload.h"
+#include "UIPixelConvert.h"
+#include "../Utils/stb_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <string>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+// 皮肤里常用的 mask 色（品红），转换时等于它的像素置透明
+static const unsigned int kMask = 0xFFFF00FF;
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    return data;
+}
+
+struct RGBAImage
+{
+    int nWidth;
+    int nHeight;
+    std::vector<unsigned char> rgba;
+};
+
+// 按 CollectSkinImages 收集全部皮肤引用的图片，去重后用 stb_image 解码成 RGBA
+static bool LoadSkinImages(std::vector<RGBAImage>& images)
+{
+    std::set<std::string> names;
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        std::string text = ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]);
+        if (text.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            text.erase(0, 3);
+        CMarkupDomA dom;
+        if (text.empty() || !dom.Parse(&text[0], true))
+        {
+            fprintf(stderr, "cannot parse %s\n", kSkinFiles[i]);
+            return false;
+        }
+        std::vector<SkinImageRef<char> > refs;
+        CollectSkinImages(dom, 100, refs);
+        for (size_t k = 0; k < refs.size(); ++k)
+            names.insert(refs[k].sName);
+    }
+    for (std::set<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+    {
+        const std::string data = ReadFile(std::string(SKIN_DIR) + "/" + *it);
+        int x = 0, y = 0, n = 0;
+        unsigned char* pImage = data.empty() ? NULL :
+            stbi_load_from_memory(reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size()), &x, &y, &n, 4);
+        if (pImage == NULL)
+            continue;
+        RGBAImage image;
+        image.nWidth = x;
+        image.nHeight = y;
+        image.rgba.assign(pImage, pImage + static_cast<size_t>(x) * y * 4);
+        stbi_image_free(pImage);
+        images.push_back(image);
+    }
+    return !images.empty();
+}
+
+// 把皮肤像素依次平铺成 nWidth x nHeight 的大图
+static RGBAImage MakeScreenImage(const std::vector<RGBAImage>& images, int nWidth, int nHeight)
+{
+    RGBAImage screen;
+    screen.nWidth = nWidth;
+    screen.nHeight = nHeight;
+    screen.rgba.resize(static_cast<size_t>(nWidth) * nHeight * 4);
+    size_t offset = 0;
+    while (offset < screen.rgba.size())
+    {
+        for (size_t i = 0; i < images.size() && offset < screen.rgba.size(); ++i)
+        {
+            const size_t n = std::min(images[i].rgba.size(), screen.rgba.size() - offset);
+            memcpy(&screen.rgba[offset], images[i].rgba.data(), n);
+            offset += n;
+        }
+    }
+    return screen;
+}
+
+// 原来 CRenderEngine::LoadImage 中的转换循环
+static bool LegacyConvert(const unsigned char* pImage, unsigned char* pDest, int x, int y, unsigned int mask)
+{
+    bool bAlphaChannel = false;
+    for (int i = 0; i < x * y; i++)
+    {
+        pDest[i * 4 + 3] = pImage[i * 4 + 3];
+        if (pDest[i * 4 + 3] < 255)
+        {
+            pDest[i * 4] = static_cast<unsigned char>(static_cast<unsigned int>(pImage[i * 4 + 2]) * pImage[i * 4 + 3] / 255);
+            pDest[i * 4 + 1] = static_cast<unsigned char>(static_cast<unsigned int>(pImage[i * 4 + 1]) * pImage[i * 4 + 3] / 255);
+            pDest[i * 4 + 2] = static_cast<unsigned char>(static_cast<unsigned int>(pImage[i * 4]) * pImage[i * 4 + 3] / 255);
+            bAlphaChannel = true;
+        }
+        else
+        {
+            pDest[i * 4] = pImage[i * 4 + 2];
+            pDest[i * 4 + 1] = pImage[i * 4 + 1];
+            pDest[i * 4 + 2] = pImage[i * 4];
+        }
+        unsigned int pixel;
+        memcpy(&pixel, &pDest[i * 4], 4);
+        if (pixel == mask)
+        {
+            pDest[i * 4] = pDest[i * 4 + 1] = pDest[i * 4 + 2] = pDest[i * 4 + 3] = 0;
+            bAlphaChannel = true;
+        }
+    }
+    return bAlphaChannel;
+}
+
+static const char* const kLevelNames[] = { "scalar", "SSE2", "SSSE3", "AVX2" };
+
+// nLevel < 0 表示原来的循环；返回每轮毫秒数
+static double TimePremultiply(const std::vector<RGBAImage>& images, int nLevel, int rounds, std::vector<unsigned char>& out, size_t& checksum)
+{
+    const double begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            const RGBAImage& image = images[i];
+            const bool bAlpha = nLevel < 0 ?
+                LegacyConvert(image.rgba.data(), &out[0], image.nWidth, image.nHeight, kMask) :
+                ConvertToPremultipliedBGRA(image.rgba.data(), &out[0], static_cast<size_t>(image.nWidth) * image.nHeight, kMask,
+                    static_cast<PixelConvertLevel>(nLevel));
+            checksum += bAlpha + out[image.rgba.size() / 2];
+        }
+    }
+    return (Now() - begin) * 1000.0 / rounds;
+}
+
+static void RunPremultiply(const char* name, const std::vector<RGBAImage>& images, int rounds, size_t& checksum)
+{
+    size_t nPixels = 0;
+    size_t nMax = 0;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        nPixels += static_cast<size_t>(images[i].nWidth) * images[i].nHeight;
+        nMax = std::max(nMax, images[i].rgba.size());
+    }
+    std::vector<unsigned char> out(nMax);
+    const double legacyMs = TimePremultiply(images, -1, rounds, out, checksum);
+    const double scalarMs = TimePremultiply(images, PIXEL_CONVERT_SCALAR, rounds, out, checksum);
+    printf("%-12s %6.2f MP   LoadImage loop %8.3f ms   scalar %8.3f ms", name, nPixels / 1e6, legacyMs, scalarMs);
+    const int levels[] = { PIXEL_CONVERT_SSSE3, PIXEL_CONVERT_AVX2 };
+    for (size_t k = 0; k < sizeof(levels) / sizeof(levels[0]); ++k)
+    {
+        // 超过 CPU 支持的级别会退回较低的实现，结果没有意义
+        if (levels[k] > GetPixelConvertLevel())
+        {
+            printf("   %s n/a", kLevelNames[levels[k]]);
+            continue;
+        }
+        const double ms = TimePremultiply(images, levels[k], rounds, out, checksum);
+        printf("   %s %8.3f ms (%.1fx)", kLevelNames[levels[k]], ms, legacyMs / ms);
+    }
+    printf("\n");
+}
+
+// 原来 UIRender.cpp 的 RGBtoHSL/HSLtoRGB 和 AdjustImage 循环，直接按预乘后的 DWORD 计算
+static const float kOneThird = 1.0f / 3;
+
+static void LegacyRGBtoHSL(unsigned int ARGB, float* H, float* S, float* L)
+{
+    const float
+        R = static_cast<float>(ARGB & 0xFF),
+        G = static_cast<float>((ARGB >> 8) & 0xFF),
+        B = static_cast<float>((ARGB >> 16) & 0xFF),
+        nR = (R < 0 ? 0 : (R > 255 ? 255 : R)) / 255,
+        nG = (G < 0 ? 0 : (G > 255 ? 255 : G)) / 255,
+        nB = (B < 0 ? 0 : (B > 255 ? 255 : B)) / 255,
+        m = std::min(std::min(nR, nG), nB),
+        M = std::max(std::max(nR, nG), nB);
+    *L = (m + M) / 2;
+    if (M == m)
+        *H = *S = 0;
+    else
+    {
+        const float
+            f = (nR == m) ? (nG - nB) : ((nG == m) ? (nB - nR) : (nR - nG)),
+            i = (nR == m) ? 3.0f : ((nG == m) ? 5.0f : 1.0f);
+        *H = (i - f / (M - m));
+        if (*H >= 6)
+            *H -= 6;
+        *H *= 60;
+        *S = (2 * (*L) <= 1) ? ((M - m) / (M + m)) : ((M - m) / (2 - M - m));
+    }
+}
+
+static void LegacyHSLtoRGB(unsigned int* ARGB, float H, float S, float L)
+{
+    const float
+        q = 2 * L < 1 ? L * (1 + S) : (L + S - L * S),
+        p = 2 * L - q,
+        h = H / 360,
+        tr = h + kOneThird,
+        tg = h,
+        tb = h - kOneThird,
+        ntr = tr < 0 ? tr + 1 : (tr > 1 ? tr - 1 : tr),
+        ntg = tg < 0 ? tg + 1 : (tg > 1 ? tg - 1 : tg),
+        ntb = tb < 0 ? tb + 1 : (tb > 1 ? tb - 1 : tb),
+        B = 255 * (6 * ntr < 1 ? p + (q - p) * 6 * ntr : (2 * ntr < 1 ? q : (3 * ntr < 2 ? p + (q - p) * 6 * (2.0f * kOneThird - ntr) : p))),
+        G = 255 * (6 * ntg < 1 ? p + (q - p) * 6 * ntg : (2 * ntg < 1 ? q : (3 * ntg < 2 ? p + (q - p) * 6 * (2.0f * kOneThird - ntg) : p))),
+        R = 255 * (6 * ntb < 1 ? p + (q - p) * 6 * ntb : (2 * ntb < 1 ? q : (3 * ntb < 2 ? p + (q - p) * 6 * (2.0f * kOneThird - ntb) : p)));
+    // RGB() 宏：R 在低字节
+    *ARGB &= 0xFF000000;
+    *ARGB |= static_cast<unsigned int>(static_cast<unsigned char>(R < 0 ? 0 : (R > 255 ? 255 : R))) |
+        (static_cast<unsigned int>(static_cast<unsigned char>(G < 0 ? 0 : (G > 255 ? 255 : G))) << 8) |
+        (static_cast<unsigned int>(static_cast<unsigned char>(B < 0 ? 0 : (B > 255 ? 255 : B))) << 16);
+}
+
+static void LegacyAdjustImage(const unsigned char* pSrcBits, unsigned char* pBits, size_t nPixels, short H, short S, short L)
+{
+    float fH, fS, fL;
+    const float S1 = S / 100.0f;
+    const float L1 = L / 100.0f;
+    for (size_t i = 0; i < nPixels; i++)
+    {
+        unsigned int nPixel;
+        memcpy(&nPixel, pSrcBits + i * 4, 4);
+        LegacyRGBtoHSL(nPixel, &fH, &fS, &fL);
+        fH += (H - 180);
+        fH = fH > 0 ? fH : fH + 360;
+        fS *= S1;
+        fL *= L1;
+        LegacyHSLtoRGB(&nPixel, fH, fS, fL);
+        memcpy(pBits + i * 4, &nPixel, 4);
+    }
+}
+
+static const short kHSLParams[][3] = {
+    { 20, 100, 100 }, { 60, 120, 100 }, { 100, 100, 90 }, { 140, 80, 100 },
+    { 220, 100, 110 }, { 260, 150, 100 }, { 300, 100, 100 }, { 340, 60, 120 },
+};
+static const int kHSLParamCount = sizeof(kHSLParams) / sizeof(kHSLParams[0]);
+
+// 皮肤图片解码后以预乘 BGRA 保存，每次换色都从它们重新计算
+struct PremultipliedSkin
+{
+    std::vector<std::vector<unsigned char> > src;
+    std::vector<std::vector<unsigned char> > dst;
+    std::vector<HSLTask> tasks;
+    size_t nPixels;
+};
+
+static void MakePremultipliedSkin(const std::vector<RGBAImage>& images, PremultipliedSkin& skin)
+{
+    skin.nPixels = 0;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const size_t nPixels = static_cast<size_t>(images[i].nWidth) * images[i].nHeight;
+        skin.src.push_back(std::vector<unsigned char>(nPixels * 4));
+        skin.dst.push_back(std::vector<unsigned char>(nPixels * 4));
+        ConvertToPremultipliedBGRA(images[i].rgba.data(), &skin.src.back()[0], nPixels, kMask);
+        skin.nPixels += nPixels;
+    }
+    for (size_t i = 0; i < skin.src.size(); ++i)
+    {
+        HSLTask task = { skin.src[i].data(), &skin.dst[i][0], skin.src[i].size() / 4 };
+        skin.tasks.push_back(task);
+    }
+}
+
+static const int kHSLLegacy = -1;
+static const int kHSLParallel = -2;
+
+// nLevel 为 kHSLLegacy、kHSLParallel（nThreads 个工作线程）或逐张处理用的 PixelConvertLevel；返回每轮毫秒数
+static double TimeHSL(PremultipliedSkin& skin, int nLevel, unsigned int nThreads, int rounds, size_t& checksum)
+{
+    const double begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        const short* hsl = kHSLParams[r % kHSLParamCount];
+        if (nLevel == kHSLParallel)
+        {
+            AdjustPixelsHSLParallel(skin.tasks.data(), skin.tasks.size(), hsl[0], hsl[1], hsl[2], nThreads);
+        }
+        else
+        {
+            for (size_t i = 0; i < skin.tasks.size(); ++i)
+            {
+                const HSLTask& task = skin.tasks[i];
+                if (nLevel == kHSLLegacy)
+                    LegacyAdjustImage(task.pSrc, task.pDst, task.nPixels, hsl[0], hsl[1], hsl[2]);
+                else
+                    AdjustPixelsHSL(task.pSrc, task.pDst, task.nPixels, hsl[0], hsl[1], hsl[2], static_cast<PixelConvertLevel>(nLevel));
+            }
+        }
+        checksum += skin.dst[r % skin.dst.size()][0];
+    }
+    return (Now() - begin) * 1000.0 / rounds;
+}
+
+static void RunHSL(const char* name, const std::vector<RGBAImage>& images, int rounds, size_t& checksum)
+{
+    PremultipliedSkin skin;
+    MakePremultipliedSkin(images, skin);
+    const double legacyMs = TimeHSL(skin, kHSLLegacy, 0, rounds, checksum);
+    const double scalarMs = TimeHSL(skin, PIXEL_CONVERT_SCALAR, 0, rounds, checksum);
+    printf("%-24s %6.2f MP   AdjustImage %9.3f ms   scalar %8.3f ms (%.1fx)", name, skin.nPixels / 1e6, legacyMs, scalarMs, legacyMs / scalarMs);
+    if (GetPixelConvertLevel() >= PIXEL_CONVERT_SSSE3)
+    {
+        const double sseMs = TimeHSL(skin, PIXEL_CONVERT_SSSE3, 0, rounds, checksum);
+        printf("   SSE %8.3f ms (%.1fx)", sseMs, legacyMs / sseMs);
+    }
+    else
+    {
+        printf("   SSE n/a");
+    }
+    // 0 表示按 CPU 核数，单核机器上只有调用线程自己
+    const unsigned int threads[] = { 0, 3 };
+    for (size_t k = 0; k < sizeof(threads) / sizeof(threads[0]); ++k)
+    {
+        const double ms = TimeHSL(skin, kHSLParallel, threads[k], rounds, checksum);
+        printf("   parallel(%u) %8.3f ms (%.1fx)", threads[k], ms, legacyMs / ms);
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    std::vector<RGBAImage> skin;
+    if (!LoadSkinImages(skin))
+        return 1;
+    printf("%zu skin images, %d rounds, CPU level %s\n", skin.size(), rounds, kLevelNames[GetPixelConvertLevel()]);
+
+    std::vector<RGBAImage> screen1080(1, MakeScreenImage(skin, 1920, 1080));
+    std::vector<RGBAImage> screen4k(1, MakeScreenImage(skin, 3840, 2160));
+
+    size_t checksum = 0;
+    // 皮肤图片都很小，多跑几轮
+    RunPremultiply("skin images", skin, rounds * 20, checksum);
+    RunPremultiply("1920x1080", screen1080, rounds, checksum);
+    RunPremultiply("3840x2160", screen4k, rounds, checksum);
+
+    printf("\nHSL recolor, %u hardware threads\n", std::thread::hardware_concurrency());
+    std::vector<RGBAImage> skinWithBackground(skin);
+    skinWithBackground.push_back(screen1080[0]);
+    RunHSL("skin images", skin, rounds * 2, checksum);
+    RunHSL("skin + 1080p background", skinWithBackground, rounds, checksum);
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
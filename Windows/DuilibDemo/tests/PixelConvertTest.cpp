@@ -0,0 +1,294 @@
+/*
+* Module:   PixelConvertTest
+*
+* Function: UIPixelConvert 的各级 SIMD 实现与标量参考逐字节对照：
+*           RGBA 转预乘 BGRA（全部 (颜色, alpha) 组合、随机长度和 mask 色、原地转换）；
+*           HSL 调整的各级实现结果相同，与原来 CRenderEngine::AdjustImage 的浮点公式相差不超过 1，
+*           预乘结果合法，分块并行与单线程一致
+*/
+#include "UIPixelConvert.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+// 原来 UIImagePreload.cpp 中逐像素的转换
+static bool ReferencePremultiply(const unsigned char* pRGBA, unsigned char* pBGRA, size_t nPixels, unsigned int dwMask)
+{
+    bool bAlpha = false;
+    for (size_t i = 0; i < nPixels; ++i)
+    {
+        const unsigned char* s = pRGBA + i * 4;
+        unsigned char* d = pBGRA + i * 4;
+        unsigned int a = s[3];
+        unsigned char r = s[0], g = s[1], b = s[2];
+        d[3] = static_cast<unsigned char>(a);
+        if (a < 255)
+        {
+            d[0] = static_cast<unsigned char>(b * a / 255);
+            d[1] = static_cast<unsigned char>(g * a / 255);
+            d[2] = static_cast<unsigned char>(r * a / 255);
+            bAlpha = true;
+        }
+        else
+        {
+            d[0] = b;
+            d[1] = g;
+            d[2] = r;
+        }
+        unsigned int nPixel = d[0] | (d[1] << 8) | (d[2] << 16) | (static_cast<unsigned int>(d[3]) << 24);
+        if (nPixel == dwMask)
+        {
+            d[0] = d[1] = d[2] = d[3] = 0;
+            bAlpha = true;
+        }
+    }
+    return bAlpha;
+}
+
+// 原来 UIRender.cpp 中的 RGBtoHSL/HSLtoRGB，按 R、G、B 三个通道计算
+static void ReferenceAdjustRGB(unsigned char& r, unsigned char& g, unsigned char& b, short H, short S, short L)
+{
+    const float kOneThird = 1.0f / 3;
+    const float nR = r / 255.0f, nG = g / 255.0f, nB = b / 255.0f;
+    const float m = std::min(std::min(nR, nG), nB);
+    const float M = std::max(std::max(nR, nG), nB);
+    float fH = 0, fS = 0, fL = (m + M) / 2;
+    if (M != m)
+    {
+        const float f = (nR == m) ? (nG - nB) : ((nG == m) ? (nB - nR) : (nR - nG));
+        const float i = (nR == m) ? 3.0f : ((nG == m) ? 5.0f : 1.0f);
+        fH = i - f / (M - m);
+        if (fH >= 6)
+            fH -= 6;
+        fH *= 60;
+        fS = (2 * fL <= 1) ? ((M - m) / (M + m)) : ((M - m) / (2 - M - m));
+    }
+
+    fH += H - 180;
+    fH = fH > 0 ? fH : fH + 360;
+    fS *= S / 100.0f;
+    fL *= L / 100.0f;
+
+    const float q = 2 * fL < 1 ? fL * (1 + fS) : (fL + fS - fL * fS);
+    const float p = 2 * fL - q;
+    const float h = fH / 360;
+    float t[3] = { h + kOneThird, h, h - kOneThird };
+    float c[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        const float n = t[k] < 0 ? t[k] + 1 : (t[k] > 1 ? t[k] - 1 : t[k]);
+        c[k] = 255 * (6 * n < 1 ? p + (q - p) * 6 * n : (2 * n < 1 ? q : (3 * n < 2 ? p + (q - p) * 6 * (2.0f * kOneThird - n) : p)));
+        c[k] = c[k] < 0 ? 0 : (c[k] > 255 ? 255 : c[k]);
+    }
+    r = static_cast<unsigned char>(c[0]);
+    g = static_cast<unsigned char>(c[1]);
+    b = static_cast<unsigned char>(c[2]);
+}
+
+static const short kHSLParams[][3] = {
+    { 181, 100, 100 }, { 90, 100, 100 }, { 360, 150, 80 }, { 0, 0, 100 },
+    { 200, 200, 200 }, { 180, 100, 50 }, { 270, 60, 130 }, { 10, 180, 20 },
+};
+
+// 每一级实现（超过 CPU 支持的会退回 GetPixelConvertLevel）都要与参考一致，包括原地转换
+static void CheckPremultiply(const std::vector<unsigned char>& src, unsigned int dwMask)
+{
+    const size_t nPixels = src.size() / 4;
+    std::vector<unsigned char> expected(src.size());
+    const bool bExpectedAlpha = ReferencePremultiply(src.data(), expected.data(), nPixels, dwMask);
+
+    for (int level = PIXEL_CONVERT_SCALAR; level <= PIXEL_CONVERT_AVX2; ++level)
+    {
+        std::vector<unsigned char> out(src.size(), 0xCD);
+        TEST_CHECK(ConvertToPremultipliedBGRA(src.data(), out.data(), nPixels, dwMask, static_cast<PixelConvertLevel>(level)) == bExpectedAlpha);
+        TEST_CHECK(out == expected);
+
+        std::vector<unsigned char> inPlace(src);
+        TEST_CHECK(ConvertToPremultipliedBGRA(inPlace.data(), inPlace.data(), nPixels, dwMask, static_cast<PixelConvertLevel>(level)) == bExpectedAlpha);
+        TEST_CHECK(inPlace == expected);
+    }
+}
+
+static void TestPremultiplyExhaustive()
+{
+    // 所有 (颜色, alpha) 组合，三个通道取不同的值
+    std::vector<unsigned char> src;
+    src.reserve(256 * 256 * 4);
+    for (int a = 0; a < 256; ++a)
+    {
+        for (int c = 0; c < 256; ++c)
+        {
+            src.push_back(static_cast<unsigned char>(c));
+            src.push_back(static_cast<unsigned char>(255 - c));
+            src.push_back(static_cast<unsigned char>((c * 7) & 0xFF));
+            src.push_back(static_cast<unsigned char>(a));
+        }
+    }
+    CheckPremultiply(src, 0xFF000000);
+    CheckPremultiply(src, 0);
+    CheckPremultiply(src, 0xFFFF00FF);
+}
+
+static void TestPremultiplyRandom()
+{
+    std::mt19937 rng(1);
+    for (int round = 0; round < 2000; ++round)
+    {
+        // 长度覆盖各级实现的整块和尾部
+        const size_t nPixels = rng() % 67;
+        std::vector<unsigned char> src(nPixels * 4);
+        const int mode = rng() % 3;
+        for (size_t i = 0; i < src.size(); ++i)
+        {
+            src[i] = static_cast<unsigned char>(rng());
+            if (mode == 0 && i % 4 == 3)
+                src[i] = 255;
+            if (mode == 1 && i % 4 < 3)
+                src[i] = (rng() & 1) ? 255 : 0;
+        }
+        // 用第一个像素作为 mask 色，保证有像素命中
+        const unsigned int dwMask = nPixels > 0 ? (src[2] | (src[1] << 8) | (src[0] << 16) | 0xFF000000u) : 0xFF00FF;
+        if (mode == 0 && nPixels > 0)
+            src[3] = 255;
+        CheckPremultiply(src, dwMask);
+        CheckPremultiply(src, 0xDEADBEEF);
+    }
+
+    // 全不透明且没有 mask 色命中时不报告透明
+    std::vector<unsigned char> opaque(37 * 4, 255);
+    for (size_t i = 0; i < opaque.size(); ++i)
+    {
+        if (i % 4 < 3)
+            opaque[i] = static_cast<unsigned char>(i);
+    }
+    CheckPremultiply(opaque, 0);
+    std::vector<unsigned char> out(opaque.size());
+    TEST_CHECK(!ConvertToPremultipliedBGRA(opaque.data(), out.data(), 37, 0));
+}
+
+static void CheckHSLLevelsAgree(const std::vector<unsigned char>& src, short H, short S, short L, std::vector<unsigned char>& out)
+{
+    const size_t nPixels = src.size() / 4;
+    out.assign(src.size(), 0);
+    AdjustPixelsHSL(src.data(), out.data(), nPixels, H, S, L, PIXEL_CONVERT_SCALAR);
+    for (int level = PIXEL_CONVERT_SSE2; level <= PIXEL_CONVERT_AVX2; ++level)
+    {
+        std::vector<unsigned char> simd(src.size(), 0xCD);
+        AdjustPixelsHSL(src.data(), simd.data(), nPixels, H, S, L, static_cast<PixelConvertLevel>(level));
+        TEST_CHECK(simd == out);
+    }
+}
+
+static void TestHSLOpaque()
+{
+    std::mt19937 rng(7);
+    for (size_t k = 0; k < sizeof(kHSLParams) / sizeof(kHSLParams[0]); ++k)
+    {
+        const short H = kHSLParams[k][0], S = kHSLParams[k][1], L = kHSLParams[k][2];
+        std::vector<unsigned char> src(65536 * 4 + 12);
+        for (size_t i = 0; i < src.size(); ++i)
+            src[i] = i % 4 == 3 ? 255 : static_cast<unsigned char>(rng());
+        std::vector<unsigned char> out;
+        CheckHSLLevelsAgree(src, H, S, L, out);
+        for (size_t i = 0; i < src.size(); i += 4)
+        {
+            // 像素是 BGRA
+            unsigned char r = src[i + 2], g = src[i + 1], b = src[i];
+            ReferenceAdjustRGB(r, g, b, H, S, L);
+            TEST_CHECK(abs(out[i] - b) <= 1 && abs(out[i + 1] - g) <= 1 && abs(out[i + 2] - r) <= 1);
+            TEST_CHECK(out[i + 3] == 255);
+        }
+
+        // 单个颜色的接口与像素使用同一套计算
+        const unsigned int dwColor = 0x80000000u | (src[2] << 16) | (src[1] << 8) | src[0];
+        const unsigned int dwAdjusted = AdjustColorHSL(dwColor, H, S, L);
+        TEST_CHECK((dwAdjusted >> 24) == 0x80);
+        TEST_CHECK(((dwAdjusted >> 16) & 0xFF) == out[2] && ((dwAdjusted >> 8) & 0xFF) == out[1] && (dwAdjusted & 0xFF) == out[0]);
+    }
+}
+
+static void TestHSLPremultiplied()
+{
+    std::mt19937 rng(9);
+    for (size_t k = 0; k < sizeof(kHSLParams) / sizeof(kHSLParams[0]); ++k)
+    {
+        const short H = kHSLParams[k][0], S = kHSLParams[k][1], L = kHSLParams[k][2];
+        std::vector<unsigned char> src(4099 * 4);
+        for (size_t i = 0; i < src.size(); i += 4)
+        {
+            const unsigned int a = rng() % 256;
+            for (int c = 0; c < 3; ++c)
+                src[i + c] = static_cast<unsigned char>((rng() & 0xFF) * a / 255);
+            src[i + 3] = static_cast<unsigned char>(a);
+        }
+        std::vector<unsigned char> out;
+        CheckHSLLevelsAgree(src, H, S, L, out);
+        for (size_t i = 0; i < src.size(); i += 4)
+        {
+            TEST_CHECK(out[i + 3] == src[i + 3]);
+            TEST_CHECK(out[i] <= out[i + 3] && out[i + 1] <= out[i + 3] && out[i + 2] <= out[i + 3]);
+        }
+    }
+
+    // (180, 100, 100) 不改变像素
+    std::vector<unsigned char> src(1000 * 4);
+    for (size_t i = 0; i < src.size(); i += 4)
+    {
+        src[i + 3] = static_cast<unsigned char>(rng());
+        for (int c = 0; c < 3; ++c)
+            src[i + c] = static_cast<unsigned char>(std::min<unsigned int>(rng() & 0xFF, src[i + 3]));
+    }
+    std::vector<unsigned char> out(src.size());
+    AdjustPixelsHSL(src.data(), out.data(), 1000, 180, 100, 100);
+    TEST_CHECK(out == src);
+}
+
+static void TestHSLParallel()
+{
+    std::mt19937 rng(3);
+    const size_t nPixels = 1000003;
+    std::vector<unsigned char> src(nPixels * 4);
+    for (size_t i = 0; i < src.size(); i += 4)
+    {
+        src[i + 3] = static_cast<unsigned char>(rng());
+        for (int c = 0; c < 3; ++c)
+            src[i + c] = static_cast<unsigned char>(std::min<unsigned int>(rng() & 0xFF, src[i + 3]));
+    }
+    std::vector<unsigned char> expected(src.size());
+    AdjustPixelsHSL(src.data(), expected.data(), nPixels, 300, 140, 90);
+
+    // 大小不一的多张图片，包括只有 1 个像素的
+    std::vector<unsigned char> out(src.size());
+    const size_t nFirst = nPixels / 3;
+    HSLTask tasks[3] = {
+        { src.data(), out.data(), nFirst },
+        { src.data() + nFirst * 4, out.data() + nFirst * 4, 1 },
+        { src.data() + (nFirst + 1) * 4, out.data() + (nFirst + 1) * 4, nPixels - nFirst - 1 },
+    };
+    AdjustPixelsHSLParallel(tasks, 3, 300, 140, 90, 3);
+    TEST_CHECK(out == expected);
+
+    std::vector<unsigned char> inPlace(src);
+    HSLTask task = { inPlace.data(), inPlace.data(), nPixels };
+    AdjustPixelsHSLParallel(&task, 1, 300, 140, 90);
+    TEST_CHECK(inPlace == expected);
+}
+
+int main()
+{
+    printf("pixel convert level %d\n", static_cast<int>(GetPixelConvertLevel()));
+    TestPremultiplyExhaustive();
+    TestPremultiplyRandom();
+    TestHSLOpaque();
+    TestHSLPremultiplied();
+    TestHSLParallel();
+    printf("PixelConvertTest passed\n");
+    return 0;
+}
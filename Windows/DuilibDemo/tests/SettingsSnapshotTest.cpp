@@ -0,0 +1,275 @@
+/*
+* Module:   SettingsSnapshotTest
+*
+* Function: CSettingsSnapshot 的读写、前后版本兼容、损坏文件识别以及保存不留半写文件
+*/
+#include "SettingsSnapshot.h"
+#include "TestUtil.h"
+
+#include <string.h>
+#include <vector>
+
+static const char* kSnapshotPath = "SettingsSnapshotTest.dat";
+
+static uint32_t Crc32(const uint8_t* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k)
+            crc = (crc & 1) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// 按文件格式手工拼一个快照：header + [tag, size, value]
+class SnapshotBuilder
+{
+public:
+    SnapshotBuilder() : m_version(CSettingsSnapshot::kSchemaVersion), m_fieldCount(0) {}
+
+    void SetVersion(uint16_t version) { m_version = version; }
+
+    void AddInt(uint16_t tag, int32_t value) { AddField(tag, &value, sizeof(value)); }
+
+    void AddField(uint16_t tag, const void* value, uint16_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(value);
+        Append(&tag, 2);
+        Append(&size, 2);
+        m_payload.insert(m_payload.end(), bytes, bytes + size);
+        ++m_fieldCount;
+    }
+
+    std::vector<uint8_t> Build(int fieldCountDelta = 0) const
+    {
+        uint32_t magic = CSettingsSnapshot::kMagic;
+        uint16_t fieldCount = static_cast<uint16_t>(m_fieldCount + fieldCountDelta);
+        uint32_t payloadSize = static_cast<uint32_t>(m_payload.size());
+        uint32_t checksum = Crc32(m_payload.empty() ? NULL : &m_payload[0], m_payload.size());
+        // 一次分配好 header 和 payload，不在 16 字节的 vector 后面再 insert
+        std::vector<uint8_t> file(16 + m_payload.size(), 0);
+        memcpy(&file[0], &magic, 4);
+        memcpy(&file[4], &m_version, 2);
+        memcpy(&file[6], &fieldCount, 2);
+        memcpy(&file[8], &payloadSize, 4);
+        memcpy(&file[12], &checksum, 4);
+        if (!m_payload.empty())
+            memcpy(&file[16], &m_payload[0], m_payload.size());
+        return file;
+    }
+private:
+    void Append(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        m_payload.insert(m_payload.end(), bytes, bytes + size);
+    }
+private:
+    uint16_t m_version;
+    int m_fieldCount;
+    std::vector<uint8_t> m_payload;
+};
+
+static void WriteBytes(const std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(kSnapshotPath, "wb");
+    TEST_CHECK(file != NULL);
+    if (!data.empty())
+        fwrite(&data[0], 1, data.size(), file);
+    fclose(file);
+}
+
+static std::vector<uint8_t> ReadBytes(const char* path)
+{
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return data;
+    int ch = 0;
+    while ((ch = fgetc(file)) != EOF)
+        data.push_back(static_cast<uint8_t>(ch));
+    fclose(file);
+    return data;
+}
+
+static EngineSettings MakeSettings()
+{
+    EngineSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    strcpy(settings.userId, "user_1");
+    settings.videoBitrate = 900;
+    settings.videoFps = 15;
+    settings.micVolume = 80;
+    settings.speakerVolume = 60;
+    return settings;
+}
+
+static void TestRoundTrip()
+{
+    remove(kSnapshotPath);
+    EngineSettings settings = MakeSettings();
+    EngineSettings loaded;
+    memset(&loaded, 0, sizeof(loaded));
+
+    CSettingsSnapshot first(kSnapshotPath);
+    TEST_CHECK(!first.Load(loaded));
+    TEST_CHECK(first.Save(settings));
+
+    CSettingsSnapshot second(kSnapshotPath);
+    TEST_CHECK(second.Load(loaded));
+    TEST_CHECK(memcmp(&loaded, &settings, sizeof(settings)) == 0);
+
+    // 只改一个字段，走增量路径；写完后不能留下临时文件
+    loaded.micVolume = 77;
+    TEST_CHECK(second.Save(loaded));
+    TEST_CHECK(ReadBytes("SettingsSnapshotTest.dat.tmp").empty());
+    TEST_CHECK(second.Save(loaded));
+
+    CSettingsSnapshot third(kSnapshotPath);
+    EngineSettings reloaded;
+    memset(&reloaded, 0, sizeof(reloaded));
+    TEST_CHECK(third.Load(reloaded));
+    TEST_CHECK(memcmp(&reloaded, &loaded, sizeof(loaded)) == 0);
+
+    std::vector<uint8_t> encoded;
+    CSettingsSnapshot::Encode(loaded, encoded);
+    TEST_CHECK(ReadBytes(kSnapshotPath) == encoded);
+}
+
+static void TestNewerFileWithUnknownField()
+{
+    // 新版本追加了老版本不认识的 tag，版本号不变
+    SnapshotBuilder builder;
+    builder.AddInt(SettingTag_VideoFps, 24);
+    builder.AddInt(1000, 12345);
+    builder.AddInt(SettingTag_MicVolume, 55);
+    std::vector<uint8_t> file = builder.Build();
+    WriteBytes(file);
+
+    EngineSettings settings = MakeSettings();
+    CSettingsSnapshot snapshot(kSnapshotPath);
+    TEST_CHECK(snapshot.Load(settings));
+    TEST_CHECK(settings.videoFps == 24 && settings.micVolume == 55);
+    TEST_CHECK(settings.videoBitrate == 900 && strcmp(settings.userId, "user_1") == 0);
+
+    // 缺少已知字段，Save 整体重写为当前格式
+    settings.speakerVolume = 10;
+    TEST_CHECK(snapshot.Save(settings));
+    EngineSettings reloaded;
+    memset(&reloaded, 0, sizeof(reloaded));
+    CSettingsSnapshot again(kSnapshotPath);
+    TEST_CHECK(again.Load(reloaded));
+    TEST_CHECK(memcmp(&reloaded, &settings, sizeof(settings)) == 0);
+}
+
+static void TestUnknownFieldKeptOnIncrementalSave()
+{
+    EngineSettings settings = MakeSettings();
+    std::vector<uint8_t> encoded;
+    CSettingsSnapshot::Encode(settings, encoded);
+
+    // 当前格式的完整字段 + 一个新版本字段
+    SnapshotBuilder builder;
+    size_t pos = 16;
+    while (pos < encoded.size())
+    {
+        uint16_t tag = 0, size = 0;
+        memcpy(&tag, &encoded[pos], 2);
+        memcpy(&size, &encoded[pos + 2], 2);
+        builder.AddField(tag, &encoded[pos + 4], size);
+        pos += 4 + size;
+    }
+    builder.AddInt(1000, 42);
+    WriteBytes(builder.Build());
+
+    CSettingsSnapshot snapshot(kSnapshotPath);
+    EngineSettings loaded = MakeSettings();
+    TEST_CHECK(snapshot.Load(loaded));
+    loaded.videoFps = 30;
+    TEST_CHECK(snapshot.Save(loaded));
+
+    std::vector<uint8_t> saved = ReadBytes(kSnapshotPath);
+    int32_t unknown = 0;
+    TEST_CHECK(saved.size() == encoded.size() + 8);
+    memcpy(&unknown, &saved[saved.size() - 4], 4);
+    TEST_CHECK(unknown == 42);
+
+    CSettingsSnapshot reader(kSnapshotPath);
+    EngineSettings reloaded;
+    memset(&reloaded, 0, sizeof(reloaded));
+    TEST_CHECK(reader.Load(reloaded));
+    TEST_CHECK(reloaded.videoFps == 30);
+}
+
+static void TestRejected(const std::vector<uint8_t>& file)
+{
+    WriteBytes(file);
+    EngineSettings settings = MakeSettings();
+    EngineSettings before = settings;
+    CSettingsSnapshot snapshot(kSnapshotPath);
+    TEST_CHECK(!snapshot.Load(settings));
+    TEST_CHECK(memcmp(&settings, &before, sizeof(settings)) == 0);
+    TEST_CHECK(!CSettingsSnapshot::Decode(file.empty() ? NULL : &file[0], file.size(), settings));
+}
+
+static void TestCorruption()
+{
+    EngineSettings settings = MakeSettings();
+    std::vector<uint8_t> valid;
+    CSettingsSnapshot::Encode(settings, valid);
+
+    // 版本高于当前 schema
+    SnapshotBuilder newer;
+    newer.SetVersion(CSettingsSnapshot::kSchemaVersion + 1);
+    newer.AddInt(SettingTag_VideoFps, 24);
+    TestRejected(newer.Build());
+
+    SnapshotBuilder zeroVersion;
+    zeroVersion.SetVersion(0);
+    zeroVersion.AddInt(SettingTag_VideoFps, 24);
+    TestRejected(zeroVersion.Build());
+
+    // header 中的字段数与记录数不符
+    SnapshotBuilder counted;
+    counted.AddInt(SettingTag_VideoFps, 24);
+    counted.AddInt(SettingTag_MicVolume, 55);
+    TestRejected(counted.Build(1));
+    TestRejected(counted.Build(-1));
+
+    // magic 错误
+    std::vector<uint8_t> file = valid;
+    file[0] ^= 0xFF;
+    TestRejected(file);
+
+    // payload 被改动，CRC 不符
+    file = valid;
+    file[30] ^= 0x55;
+    TestRejected(file);
+
+    // 每一种截断长度
+    for (size_t size = 0; size < valid.size(); ++size)
+        TestRejected(std::vector<uint8_t>(valid.begin(), valid.begin() + size));
+
+    // 字段长度越过 payload 末尾，即使 CRC 正确
+    SnapshotBuilder overrun;
+    overrun.AddInt(SettingTag_VideoFps, 24);
+    file = overrun.Build();
+    uint16_t badSize = 200;
+    memcpy(&file[18], &badSize, 2);
+    uint32_t checksum = Crc32(&file[16], file.size() - 16);
+    memcpy(&file[12], &checksum, 4);
+    TestRejected(file);
+
+    remove(kSnapshotPath);
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestNewerFileWithUnknownField();
+    TestUnknownFieldKeptOnIncrementalSave();
+    TestCorruption();
+    printf("SettingsSnapshotTest passed\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+* Module:   ShadowRendererBench
+*
+* Function: 窗口阴影的生成耗时，父窗体是圆角矩形，1080p 和 4K：原来 MakeShadow 的锥形核（LegacyShadow.h，
+*           PtInRegion 已换成查每行的范围，原来的数字只会更慢）、CShadowRenderer::RenderDirect、
+*           Render 第一次（生成九宫格缓存）以及拖动改变大小时命中缓存只拉伸的耗时
+*
+*    不是测试，不注册到 ctest：./ShadowRendererBench [轮数]
+*/
+#include "UIShadowRenderer.h"
+#include "LegacyShadow.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace DuiLib;
+
+typedef CShadowRenderer::Span Span;
+typedef CShadowRenderer::Params Params;
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<Span> RoundRectSpans(int cx, int cy, int nRadius)
+{
+    std::vector<Span> spans(cy);
+    for (int y = 0; y < cy; ++y)
+    {
+        int nInset = 0;
+        const int dy = y < nRadius ? nRadius - y : (y >= cy - nRadius ? y - (cy - nRadius) + 1 : 0);
+        if (dy > 0)
+            nInset = nRadius - static_cast<int>(sqrt(static_cast<double>(nRadius * nRadius - (dy - 1) * (dy - 1))));
+        spans[y].left = nInset;
+        spans[y].right = cx - nInset;
+    }
+    return spans;
+}
+
+static void Run(int cx, int cy, const Params& params, int rounds)
+{
+    const int nWidth = cx + 2 * params.nSize, nHeight = cy + 2 * params.nSize;
+    // 拖动改变大小时每次差几个像素，缓冲区按最大的分配
+    std::vector<unsigned int> bits(static_cast<size_t>(nWidth + 8) * (nHeight + 8));
+    const std::vector<Span> spans = RoundRectSpans(cx, cy, 8);
+    unsigned int checksum = 0;
+
+    double begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        std::fill(bits.begin(), bits.end(), 0);
+        LegacyMakeShadow(params, spans, cx, cy, &bits[0]);
+        checksum += bits[bits.size() / 2];
+    }
+    const double legacyMs = (Now() - begin) * 1000.0 / rounds;
+
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        CShadowRenderer::RenderDirect(params, &spans[0], cx, cy, &bits[0] + (nHeight - 1) * nWidth, -nWidth);
+        checksum += bits[bits.size() / 2];
+    }
+    const double directMs = (Now() - begin) * 1000.0 / rounds;
+
+    double missMs = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        CShadowRenderer renderer;
+        begin = Now();
+        renderer.Render(params, &spans[0], cx, cy, &bits[0] + (nHeight - 1) * nWidth, -nWidth);
+        missMs += Now() - begin;
+        checksum += bits[bits.size() / 2];
+    }
+    missMs = missMs * 1000.0 / rounds;
+
+    CShadowRenderer renderer;
+    std::vector<std::vector<Span> > resized;
+    for (int d = 0; d < 8; ++d)
+        resized.push_back(RoundRectSpans(cx + d, cy + d, 8));
+    renderer.Render(params, &spans[0], cx, cy, &bits[0] + (nHeight - 1) * nWidth, -nWidth);
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        const int d = r % 8;
+        renderer.Render(params, &resized[d][0], cx + d, cy + d, &bits[0] + (nHeight + d - 1) * (nWidth + d), -(nWidth + d));
+        checksum += bits[bits.size() / 2];
+    }
+    const double hitMs = (Now() - begin) * 1000.0 / rounds;
+
+    printf("%4dx%-4d size %2d sharpness %2d   old %8.3f ms   direct %7.3f ms   first Render %6.3f ms   resize %6.3f ms   (%u/%u hits, %08x)\n",
+        cx, cy, params.nSize, params.nSharpness, legacyMs, directMs, missMs, hitMs,
+        renderer.GetStats().nCacheHits, renderer.GetStats().nRenders, checksum);
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    const Params small = { 10, 5, 150, 0, 0, 0 };
+    const Params large = { 20, 10, 150, 2, 2, 0 };
+    Run(1920, 1080, small, rounds);
+    Run(1920, 1080, large, rounds);
+    Run(3840, 2160, small, rounds);
+    Run(3840, 2160, large, rounds);
+    return 0;
+}
@@ -0,0 +1,257 @@
+/*
+* Module:   ShadowRendererTest
+*
+* Function: CShadowRenderer 与原来 CShadowUI::MakeShadow 的锥形核算法逐像素对照（LegacyMakeShadow，
+*           见 LegacyShadow.h）：矩形、圆角矩形、区域矩形拼成的椭圆和 alpha 蒙版得到的形状，
+*           覆盖负的 nSize、偏移、nSharpness 为 0 和大于 nSize 的情况；九宫格缓存的输出与 RenderDirect 相同，
+*           缓存命中只发生在角的形状和参数都相同时；SpansFromRects、SpansFromAlpha 的阈值和负行距
+*/
+#include "UIShadowRenderer.h"
+#include "LegacyShadow.h"
+#include "TestUtil.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+typedef CShadowRenderer::Span Span;
+typedef CShadowRenderer::Params Params;
+
+// 半径为 nRadius 的圆角矩形，nRadius 为 0 时是矩形
+static std::vector<Span> RoundRectSpans(int cx, int cy, int nRadius)
+{
+    std::vector<Span> spans(cy);
+    for (int y = 0; y < cy; ++y)
+    {
+        int nInset = 0;
+        const int dy = y < nRadius ? nRadius - y : (y >= cy - nRadius ? y - (cy - nRadius) + 1 : 0);
+        if (dy > 0)
+            nInset = nRadius - static_cast<int>(sqrt(static_cast<double>(nRadius * nRadius - (dy - 1) * (dy - 1))));
+        spans[y].left = nInset;
+        spans[y].right = cx - nInset;
+    }
+    return spans;
+}
+
+// 输出写进自底向上的 DIB，和 MakeShadow 一样用负行距
+static std::vector<unsigned int> RenderBottomUp(CShadowRenderer* pRenderer, const Params& params, const std::vector<Span>& spans, int cx, int cy)
+{
+    const int nWidth = cx + 2 * params.nSize, nHeight = cy + 2 * params.nSize;
+    std::vector<unsigned int> bits(static_cast<size_t>(nWidth) * nHeight, 0xCDCDCDCD);
+    if (pRenderer != NULL)
+        pRenderer->Render(params, &spans[0], cx, cy, &bits[0] + (nHeight - 1) * nWidth, -nWidth);
+    else
+        CShadowRenderer::RenderDirect(params, &spans[0], cx, cy, &bits[0] + (nHeight - 1) * nWidth, -nWidth);
+    return bits;
+}
+
+static void CheckMatchesLegacy(const Params& params, const std::vector<Span>& spans, int cx, int cy)
+{
+    const int nWidth = cx + 2 * params.nSize, nHeight = cy + 2 * params.nSize;
+    std::vector<unsigned int> expected(static_cast<size_t>(nWidth) * nHeight, 0);
+    LegacyMakeShadow(params, spans, cx, cy, &expected[0]);
+
+    const std::vector<unsigned int> direct = RenderBottomUp(NULL, params, spans, cx, cy);
+    CShadowRenderer renderer;
+    const std::vector<unsigned int> cached = RenderBottomUp(&renderer, params, spans, cx, cy);
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        if (direct[i] != expected[i] || cached[i] != expected[i])
+        {
+            fprintf(stderr, "%dx%d size %d sharpness %d darkness %d offset %d,%d: pixel (%d, %d) legacy %08x direct %08x cached %08x\n",
+                cx, cy, params.nSize, params.nSharpness, params.nDarkness, params.nXOffset, params.nYOffset,
+                static_cast<int>(i % nWidth), nHeight - 1 - static_cast<int>(i / nWidth), expected[i], direct[i], cached[i]);
+        }
+        TEST_CHECK(direct[i] == expected[i]);
+        TEST_CHECK(cached[i] == expected[i]);
+    }
+}
+
+static Params MakeParams(int nSize, int nSharpness, int nDarkness, int nXOffset, int nYOffset, unsigned int dwColor)
+{
+    Params params = { nSize, nSharpness, nDarkness, nXOffset, nYOffset, dwColor };
+    return params;
+}
+
+static void TestRoundRects()
+{
+    const int sizes[] = { -3, 0, 1, 4, 10, 20 };
+    const int sharpness[] = { 0, 1, 4, 5, 12 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        for (size_t h = 0; h < sizeof(sharpness) / sizeof(sharpness[0]); ++h)
+        {
+            for (int nRadius = 0; nRadius <= 12; nRadius += 6)
+            {
+                const std::vector<Span> spans = RoundRectSpans(90, 70, nRadius);
+                CheckMatchesLegacy(MakeParams(sizes[s], sharpness[h], 150, 0, 0, 0x000000), spans, 90, 70);
+                CheckMatchesLegacy(MakeParams(sizes[s], sharpness[h], 255, 3, -2, 0x3366CC), spans, 90, 70);
+            }
+        }
+    }
+}
+
+static void TestRandomShapes()
+{
+    std::mt19937 rng(43);
+    for (int round = 0; round < 300; ++round)
+    {
+        const int cx = 20 + static_cast<int>(rng() % 120);
+        const int cy = 20 + static_cast<int>(rng() % 90);
+        std::vector<Span> spans = RoundRectSpans(cx, cy, static_cast<int>(rng() % 10));
+        // 一部分改成不规则的轮廓，偶尔有空行
+        if (round % 3 == 0)
+        {
+            for (int y = 0; y < cy; ++y)
+            {
+                spans[y].left = static_cast<int>(rng() % (cx / 3));
+                spans[y].right = cx - static_cast<int>(rng() % (cx / 3));
+                if (rng() % 40 == 0)
+                    spans[y].left = spans[y].right = 0;
+            }
+        }
+        const int nSize = static_cast<int>(rng() % 24) - 4;
+        if (cx + 2 * nSize <= 0 || cy + 2 * nSize <= 0)
+            continue;
+        const Params params = MakeParams(nSize, static_cast<int>(rng() % 16), static_cast<int>(rng() % 256),
+            static_cast<int>(rng() % 9) - 4, static_cast<int>(rng() % 9) - 4, rng() & 0xFFFFFF);
+        CheckMatchesLegacy(params, spans, cx, cy);
+    }
+}
+
+// 区域由多个矩形拼成时每行取外接范围；椭圆用每两行一个矩形
+static void TestRegionShape()
+{
+    const int cx = 120, cy = 80;
+    std::vector<long> rects;
+    for (int y = 0; y < cy; y += 2)
+    {
+        const double t = (y + 1 - cy / 2.0) / (cy / 2.0);
+        const int nHalf = static_cast<int>(cx / 2.0 * sqrt(std::max(0.0, 1 - t * t)));
+        rects.push_back(cx / 2 - nHalf);
+        rects.push_back(y);
+        rects.push_back(cx / 2 + nHalf);
+        rects.push_back(y + 2);
+    }
+    // 同一行的两个矩形取外接范围
+    rects.push_back(0);
+    rects.push_back(40);
+    rects.push_back(5);
+    rects.push_back(41);
+    std::vector<Span> spans;
+    CShadowRenderer::SpansFromRects(&rects[0], static_cast<int>(rects.size() / 4), cx, cy, spans);
+    TEST_CHECK(static_cast<int>(spans.size()) == cy);
+    TEST_CHECK(spans[40].left == 0 && spans[40].right == spans[41].right && spans[41].left > 0);
+    TEST_CHECK(spans[0].left == spans[1].left && spans[0].right == spans[1].right);
+    CheckMatchesLegacy(MakeParams(8, 5, 150, 2, 2, 0), spans, cx, cy);
+    CheckMatchesLegacy(MakeParams(3, 9, 200, 0, 0, 0x102030), spans, cx, cy);
+
+    // 超出父窗体的矩形被裁掉，空的矩形忽略
+    const long outside[] = { -10, -10, 5, 3, 100, 5, 90, 9, 2, 78, 200, 200 };
+    CShadowRenderer::SpansFromRects(outside, 3, cx, cy, spans);
+    TEST_CHECK(spans[0].left == 0 && spans[0].right == 5);
+    TEST_CHECK(spans[3].left >= spans[3].right);
+    TEST_CHECK(spans[6].left >= spans[6].right);
+    TEST_CHECK(spans[79].left == 2 && spans[79].right == cx);
+}
+
+// 分层窗口的形状来自 alpha：圆角以外透明，边缘半透明
+static void TestAlphaShape()
+{
+    const int cx = 64, cy = 48;
+    const std::vector<Span> round = RoundRectSpans(cx, cy, 8);
+    std::vector<unsigned int> pixels(cx * cy, 0);
+    for (int y = 0; y < cy; ++y)
+    {
+        for (int x = round[y].left; x < round[y].right; ++x)
+            pixels[y * cx + x] = 0xFF336699;
+        // 抗锯齿的边缘：低于阈值的不算
+        if (round[y].left > 0)
+            pixels[y * cx + round[y].left - 1] = 0x40112233;
+        if (round[y].right < cx)
+            pixels[y * cx + round[y].right] = 0x80223344;
+    }
+    std::vector<Span> spans;
+    CShadowRenderer::SpansFromAlpha(&pixels[0], cx, cx, cy, 127, spans);
+    TEST_CHECK(static_cast<int>(spans.size()) == cy);
+    for (int y = 0; y < cy; ++y)
+    {
+        TEST_CHECK(spans[y].left == round[y].left);
+        TEST_CHECK(spans[y].right == (round[y].right < cx ? round[y].right + 1 : cx));
+    }
+    // 阈值以下的都不算，全透明的行为空
+    CShadowRenderer::SpansFromAlpha(&pixels[0], cx, cx, cy, 0xFF, spans);
+    TEST_CHECK(spans[0].left >= spans[0].right);
+
+    // 自底向上的 DIB 从最后一行开始，行距为负，结果相同
+    std::vector<unsigned int> flipped(pixels.size());
+    for (int y = 0; y < cy; ++y)
+        memcpy(&flipped[(cy - 1 - y) * cx], &pixels[y * cx], cx * sizeof(unsigned int));
+    std::vector<Span> fromFlipped;
+    CShadowRenderer::SpansFromAlpha(&flipped[(cy - 1) * cx], -cx, cx, cy, 127, fromFlipped);
+    CShadowRenderer::SpansFromAlpha(&pixels[0], cx, cx, cy, 127, spans);
+    for (int y = 0; y < cy; ++y)
+        TEST_CHECK(fromFlipped[y].left == spans[y].left && fromFlipped[y].right == spans[y].right);
+    CheckMatchesLegacy(MakeParams(6, 4, 150, 0, 0, 0), spans, cx, cy);
+}
+
+// 改变大小时只拉伸缓存；角的形状或参数变了就重新生成，输出始终与 RenderDirect 相同
+static void TestNinePatchCache()
+{
+    CShadowRenderer renderer;
+    const Params params = MakeParams(10, 6, 150, 2, 3, 0);
+    const int widths[] = { 300, 420, 301, 800, 120 };
+    for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); ++i)
+    {
+        const int cx = widths[i], cy = widths[i] * 2 / 3;
+        const std::vector<Span> spans = RoundRectSpans(cx, cy, 6);
+        TEST_CHECK(RenderBottomUp(&renderer, params, spans, cx, cy) == RenderBottomUp(NULL, params, spans, cx, cy));
+    }
+    CShadowRenderer::Stats stats = renderer.GetStats();
+    TEST_CHECK(stats.nRenders == 5);
+    TEST_CHECK(stats.nCacheHits == 4);
+
+    // 圆角半径变了，缓存失效
+    std::vector<Span> spans = RoundRectSpans(300, 200, 9);
+    TEST_CHECK(RenderBottomUp(&renderer, params, spans, 300, 200) == RenderBottomUp(NULL, params, spans, 300, 200));
+    TEST_CHECK(renderer.GetStats().nCacheHits == 4);
+    // 参数变了，缓存失效
+    const Params darker = MakeParams(10, 6, 200, 2, 3, 0);
+    TEST_CHECK(RenderBottomUp(&renderer, darker, spans, 300, 200) == RenderBottomUp(NULL, darker, spans, 300, 200));
+    TEST_CHECK(renderer.GetStats().nCacheHits == 4);
+    TEST_CHECK(RenderBottomUp(&renderer, darker, RoundRectSpans(500, 260, 9), 500, 260) == RenderBottomUp(NULL, darker, RoundRectSpans(500, 260, 9), 500, 260));
+    TEST_CHECK(renderer.GetStats().nCacheHits == 5);
+    renderer.ClearCache();
+    TEST_CHECK(RenderBottomUp(&renderer, darker, spans, 300, 200) == RenderBottomUp(NULL, darker, spans, 300, 200));
+    TEST_CHECK(renderer.GetStats().nCacheHits == 5);
+
+    // 随机的圆角矩形、参数和大小
+    std::mt19937 rng(7);
+    for (int round = 0; round < 1000; ++round)
+    {
+        const int cx = 10 + static_cast<int>(rng() % 300);
+        const int cy = 10 + static_cast<int>(rng() % 200);
+        const Params p = MakeParams(static_cast<int>(rng() % 24) - 4, static_cast<int>(rng() % 14), 40 + static_cast<int>(rng() % 216),
+            static_cast<int>(rng() % 11) - 5, static_cast<int>(rng() % 11) - 5, rng() & 0xFFFFFF);
+        if (cx + 2 * p.nSize <= 0 || cy + 2 * p.nSize <= 0)
+            continue;
+        const std::vector<Span> s = RoundRectSpans(cx, cy, static_cast<int>(rng() % 12));
+        TEST_CHECK(RenderBottomUp(&renderer, p, s, cx, cy) == RenderBottomUp(NULL, p, s, cx, cy));
+    }
+}
+
+int main()
+{
+    TestRoundRects();
+    TestRandomShapes();
+    TestRegionShape();
+    TestAlphaShape();
+    TestNinePatchCache();
+    printf("ShadowRendererTest passed\n");
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*
+* Module:   SkinBinaryTest
+*
+* Function: SkinCompiler 生成的预编译皮肤经 CSkinBinaryReader/LoadSkinBinary 得到的 DOM，
+*           与直接解析 XML 得到的 DOM 逐节点、逐属性一致；截断的文件必须被拒绝，逐字节损坏的文件不能崩溃
+*/
+// Windows 上用 wchar_t 实例化；这里 wchar_t 是 4 字节，改用同为 UTF-16 的 char16_t，所以直接包含模板实现
+#include "UIMarkupDom.cpp"
+#include "UISkinBinary.h"
+#include "TestUtil.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace DuiLib { template class CMarkupDomT<char16_t>; }
+
+using namespace DuiLib;
+
+typedef CMarkupDomT<char16_t> DomU16;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+static std::vector<char> ReadFile(const std::string& path)
+{
+    std::vector<char> data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    fclose(file);
+    return data;
+}
+
+static void WriteFile(const std::string& path, const char* text)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    TEST_CHECK(file != NULL);
+    TEST_CHECK(fwrite(text, 1, strlen(text), file) == strlen(text));
+    fclose(file);
+}
+
+static std::u16string Utf8ToUtf16(const std::vector<char>& text)
+{
+    std::u16string out;
+    size_t i = 0;
+    if (text.size() >= 3 && text[0] == '\xEF' && text[1] == '\xBB' && text[2] == '\xBF')
+        i = 3;
+    while (i < text.size())
+    {
+        uint32_t c = static_cast<unsigned char>(text[i++]);
+        int extra = 0;
+        if (c >= 0xF0) { c &= 0x07; extra = 3; }
+        else if (c >= 0xE0) { c &= 0x0F; extra = 2; }
+        else if (c >= 0xC0) { c &= 0x1F; extra = 1; }
+        for (int k = 0; k < extra && i < text.size(); ++k)
+            c = (c << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+        if (c >= 0x10000)
+        {
+            c -= 0x10000;
+            out += static_cast<char16_t>(0xD800 + (c >> 10));
+            out += static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+        }
+        else
+        {
+            out += static_cast<char16_t>(c);
+        }
+    }
+    return out;
+}
+
+static std::string Narrow(const char16_t* text)
+{
+    std::string out;
+    for (; *text != 0; ++text)
+        out += *text < 0x80 ? static_cast<char>(*text) : '?';
+    return out;
+}
+
+static bool Equal(const char16_t* a, const char16_t* b)
+{
+    while (*a != 0 && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+// 按 CDialogBuilder 的转换规则（_ttoi/_tcstoul/_tcsicmp）重新解释原始文本，核对预编译的类型值
+static void CheckTyped(const char16_t* pValue, const CMarkupTypedValue* pTyped)
+{
+    if (pTyped == NULL)
+        return;
+    const std::string value = Narrow(pValue);
+    switch (pTyped->nType)
+    {
+    case CMarkupTypedValue::TYPE_BOOL:
+        TEST_CHECK(strcasecmp(value.c_str(), "true") == 0 || strcasecmp(value.c_str(), "false") == 0);
+        TEST_CHECK(pTyped->aValue[0] == (strcasecmp(value.c_str(), "true") == 0 ? 1 : 0));
+        break;
+    case CMarkupTypedValue::TYPE_COLOR:
+        TEST_CHECK(value[0] == '#');
+        TEST_CHECK(static_cast<uint32_t>(pTyped->aValue[0]) == static_cast<uint32_t>(strtoul(value.c_str() + 1, NULL, 16)));
+        break;
+    case CMarkupTypedValue::TYPE_INTS:
+    {
+        TEST_CHECK(pTyped->nCount >= 1 && pTyped->nCount <= 4);
+        const char* p = value.c_str();
+        for (unsigned int i = 0; i < pTyped->nCount; ++i)
+        {
+            char* pEnd = NULL;
+            TEST_CHECK(strtol(p, &pEnd, 10) == pTyped->aValue[i]);
+            p = *pEnd == ',' ? pEnd + 1 : pEnd;
+        }
+        TEST_CHECK(*p == 0);
+        break;
+    }
+    default:
+        TEST_CHECK(pTyped->nType == CMarkupTypedValue::TYPE_NONE);
+        break;
+    }
+}
+
+static void CompareNodes(const DomU16& xml, const DomU16::Node* pXml, const DomU16& bin, const DomU16::Node* pBin)
+{
+    for (; pXml != NULL || pBin != NULL; pXml = pXml->pNext, pBin = pBin->pNext)
+    {
+        TEST_CHECK(pXml != NULL && pBin != NULL);
+        TEST_CHECK(Equal(pXml->pName, pBin->pName));
+        TEST_CHECK(Equal(pXml->pValue, pBin->pValue));
+        TEST_CHECK((pXml->pParent == NULL) == (pBin->pParent == NULL));
+        TEST_CHECK(pXml->nClassId == 0);
+        TEST_CHECK(pBin->nClassId == GetSkinClassId(Narrow(pXml->pName).c_str()));
+        TEST_CHECK(pXml->nAttributes == pBin->nAttributes);
+        for (unsigned int i = 0; i < pXml->nAttributes; ++i)
+        {
+            const DomU16::Attribute& a = pXml->pAttributes[i];
+            const DomU16::Attribute& b = pBin->pAttributes[i];
+            TEST_CHECK(Equal(a.pName, b.pName));
+            TEST_CHECK(Equal(a.pValue, b.pValue));
+            TEST_CHECK(a.pTyped == NULL);
+            CheckTyped(b.pValue, b.pTyped);
+
+            const DomU16::Attribute* pFoundXml = xml.FindAttribute(pXml, a.pName);
+            const DomU16::Attribute* pFoundBin = bin.FindAttribute(pBin, b.pName);
+            TEST_CHECK(pFoundXml != NULL && pFoundBin != NULL);
+            TEST_CHECK(Equal(pFoundXml->pValue, pFoundBin->pValue));
+        }
+        if (pXml->pChild != NULL)
+        {
+            const DomU16::Node* pChildXml = xml.FindChild(pXml, pXml->pChild->pName);
+            const DomU16::Node* pChildBin = bin.FindChild(pBin, pBin->pChild->pName);
+            TEST_CHECK(pChildXml != NULL && pChildBin != NULL);
+            TEST_CHECK(Equal(pChildXml->pName, pChildBin->pName));
+        }
+        CompareNodes(xml, pXml->pChild, bin, pBin->pChild);
+    }
+}
+
+// 用 SkinCompiler 编译 xmlPath，返回按 4 字节对齐的皮肤数据
+static std::vector<uint32_t> Compile(const std::string& xmlPath, size_t& nSize)
+{
+    const std::string skbPath = xmlPath + ".skb";
+    remove(skbPath.c_str());
+    const std::string command = std::string("\"") + SKIN_COMPILER_PATH + "\" -o \"" + skbPath + "\" \"" + xmlPath + "\"";
+    TEST_CHECK(system(command.c_str()) == 0);
+
+    std::vector<char> data = ReadFile(skbPath);
+    TEST_CHECK(!data.empty());
+    nSize = data.size();
+    std::vector<uint32_t> aligned((data.size() + 3) / 4);
+    memcpy(&aligned[0], &data[0], data.size());
+    return aligned;
+}
+
+static void CheckRoundTrip(const std::string& xmlPath)
+{
+    size_t nSize = 0;
+    const std::vector<uint32_t> skin = Compile(xmlPath, nSize);
+
+    std::u16string text = Utf8ToUtf16(ReadFile(xmlPath));
+    DomU16 xml;
+    TEST_CHECK(xml.Parse(&text[0], true));
+
+    CSkinBinaryReader reader;
+    TEST_CHECK(reader.Open(&skin[0], nSize));
+    DomU16 bin;
+    TEST_CHECK(LoadSkinBinary(reader, bin));
+
+    TEST_CHECK(xml.GetNodeCount() == bin.GetNodeCount());
+    CompareNodes(xml, xml.GetRoot(), bin, bin.GetRoot());
+
+    // 任何截断都必须在 Open 时被拒绝
+    for (size_t n = 0; n < nSize; ++n)
+    {
+        CSkinBinaryReader truncated;
+        TEST_CHECK(!truncated.Open(&skin[0], n));
+    }
+
+    // 逐字节损坏：Open 可以接受（例如只改了字符串内容），但接受之后加载不能越界
+    for (size_t k = 0; k < nSize; ++k)
+    {
+        std::vector<uint32_t> corrupt = skin;
+        reinterpret_cast<unsigned char*>(&corrupt[0])[k] ^= 0x5A;
+        CSkinBinaryReader damaged;
+        if (damaged.Open(&corrupt[0], nSize))
+        {
+            DomU16 dom;
+            LoadSkinBinary(damaged, dom);
+        }
+    }
+}
+
+// 覆盖三种类型值、实体、空值、非 ASCII 文本和不认识的控件名
+static void TestTypedValues()
+{
+    const std::string path = "SkinBinaryTest.xml";
+    WriteFile(path,
+        "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+        "<Window size=\"800,600\" caption=\"0,0,0,32\" roundcorner=\"4,4\" mininfo=\"400,300\">\r\n"
+        "  <Font id=\"0\" name=\"\xE5\xBE\xAE\xE8\xBD\xAF\xE9\x9B\x85\xE9\xBB\x91\" size=\"12\" bold=\"TRUE\" />\r\n"
+        "  <Default name=\"Button\" value=\"textcolor=&quot;#FF000000&quot;\" />\r\n"
+        "  <VerticalLayout bkcolor=\"#FF2B2B2B\" padding=\"-4,0,4,0\" visible=\"false\" text=\"a &amp; b &lt;c&gt;\">\r\n"
+        "    <Button name=\"btn\" width=\"\" height=\"12px\" tooltip=\"\xE7\xA1\xAE\xE5\xAE\x9A\" />\r\n"
+        "    <MyPluginControl pos=\"1,2,3,4,5\" />\r\n"
+        "    <Text>inner text</Text>\r\n"
+        "  </VerticalLayout>\r\n"
+        "</Window>\r\n");
+    CheckRoundTrip(path);
+}
+
+static void TestShippedSkins()
+{
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        // 拷贝到构建目录再编译，不在源码树里留下 .skb
+        const std::vector<char> data = ReadFile(std::string(SKIN_DIR) + "/" + kSkinFiles[i]);
+        TEST_CHECK(!data.empty());
+        const std::string path = kSkinFiles[i];
+        FILE* file = fopen(path.c_str(), "wb");
+        TEST_CHECK(file != NULL);
+        TEST_CHECK(fwrite(&data[0], 1, data.size(), file) == data.size());
+        fclose(file);
+        CheckRoundTrip(path);
+    }
+}
+
+int main()
+{
+    TestTypedValues();
+    TestShippedSkins();
+    printf("SkinBinaryTest passed\n");
+    return 0;
+}
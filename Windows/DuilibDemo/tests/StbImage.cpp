@@ -0,0 +1,8 @@
+/*
+* Module:   StbImage
+*
+* Function: 测试程序用的 stb_image 实现，与 UIRender.cpp 中的编译选项相同（Windows 上由 UIRender.cpp 提供）
+*/
+#define STBI_NO_FAILURE_STRINGS
+#define STB_IMAGE_IMPLEMENTATION
+#include "../Utils/stb_image.h"
@@ -0,0 +1,423 @@
+/*
+* Module:   StringTableBench
+*
+* Function: 原来的链式 CStdStringPtrMap（5903521 的 Utils.cpp，照搬到下面）对比 CStringPtrTableT。
+*           名字取自 Demo 的皮肤：控件最多的设置窗口的控件名（m_mNameHash）、全部皮肤的控件名、
+*           各种 *image 属性的绘制字符串（m_DrawInfoHash、m_ImageHash 的 key），以及
+*           TRTCVideoViewLayout 按 "rotation_<userId>_<streamType>" 生成的视频窗口按钮名。
+*           每组测建表（构造、逐个 Insert、析构）、命中查找（均匀和集中在 8 个热点名字）、
+*           未命中查找和删除后重新插入一半，输出每次操作的纳秒数。
+*           旧表按 m_mNameHash.Resize() 的默认值 83 个桶，不会扩容；查找用默认的 optimize = true。
+*           Linux 上 wchar_t 是 4 字节，Windows 上的 TCHAR 是 2 字节，两边的散列都按字符处理，比例可以参考
+*
+*    不是测试，不注册到 ctest：./StringTableBench [轮数]
+*/
+#include "UIStringTable.h"
+#include "UIMarkupDom.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace DuiLib;
+
+static const char* const kSkinFiles[] = {
+    "trtc_login.xml",
+    "trtc_mainbase.xml",
+    "trtc_mainwnd.xml",
+    "trtc_screentoolwnd.xml",
+    "trtc_setting.xml",
+    "popup.xml",
+    "msg.xml",
+    "devicemenu.xml",
+    "ShareSelect.xml",
+    "ShareSelectItem.xml",
+};
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string ReadFile(const std::string& path)
+{
+    std::string data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return data;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, n);
+    fclose(file);
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        data.erase(0, 3);
+    return data;
+}
+
+// 原来的 CDuiString：63 个字符以内存在对象自己的缓冲区里，更长的才另外分配
+class LegacyString
+{
+public:
+    enum { MAX_LOCAL_STRING_LEN = 63 };
+
+    LegacyString() : m_pstr(m_szBuffer) { m_szBuffer[0] = L'\0'; }
+    ~LegacyString()
+    {
+        if (m_pstr != m_szBuffer)
+            free(m_pstr);
+    }
+
+    void Assign(const wchar_t* pstr)
+    {
+        const size_t cchMax = wcslen(pstr);
+        if (cchMax > MAX_LOCAL_STRING_LEN)
+            m_pstr = static_cast<wchar_t*>(malloc((cchMax + 1) * sizeof(wchar_t)));
+        wcsncpy(m_pstr, pstr, cchMax);
+        m_pstr[cchMax] = L'\0';
+    }
+
+    bool operator==(const wchar_t* pstr) const { return wcscmp(m_pstr, pstr) == 0; }
+    const wchar_t* GetData() const { return m_pstr; }
+
+private:
+    LegacyString(const LegacyString&);
+    LegacyString& operator=(const LegacyString&);
+
+    wchar_t* m_pstr;
+    wchar_t m_szBuffer[MAX_LOCAL_STRING_LEN + 1];
+};
+
+struct LegacyItem
+{
+    LegacyString Key;
+    void* Data;
+    LegacyItem* pPrev;
+    LegacyItem* pNext;
+};
+
+static unsigned int LegacyHashKey(const wchar_t* Key)
+{
+    unsigned int i = 0;
+    size_t len = wcslen(Key);
+    while (len-- > 0) i = (i << 5) + i + Key[len];
+    return i;
+}
+
+// 原来的 CStdStringPtrMap，只保留基准用到的操作
+class LegacyStringPtrMap
+{
+public:
+    explicit LegacyStringPtrMap(int nSize = 83) : m_nCount(0)
+    {
+        if (nSize < 16) nSize = 16;
+        m_nBuckets = nSize;
+        m_aT = new LegacyItem*[nSize];
+        memset(m_aT, 0, nSize * sizeof(LegacyItem*));
+    }
+
+    ~LegacyStringPtrMap()
+    {
+        int len = m_nBuckets;
+        while (len--) {
+            LegacyItem* pItem = m_aT[len];
+            while (pItem) {
+                LegacyItem* pKill = pItem;
+                pItem = pItem->pNext;
+                delete pKill;
+            }
+        }
+        delete[] m_aT;
+    }
+
+    void* Find(const wchar_t* key, bool optimize = true) const
+    {
+        if (m_nBuckets == 0 || m_nCount == 0) return NULL;
+
+        unsigned int slot = LegacyHashKey(key) % m_nBuckets;
+        for (LegacyItem* pItem = m_aT[slot]; pItem; pItem = pItem->pNext) {
+            if (pItem->Key == key) {
+                if (optimize && pItem != m_aT[slot]) {
+                    if (pItem->pNext) {
+                        pItem->pNext->pPrev = pItem->pPrev;
+                    }
+                    pItem->pPrev->pNext = pItem->pNext;
+                    pItem->pPrev = NULL;
+                    pItem->pNext = m_aT[slot];
+                    pItem->pNext->pPrev = pItem;
+                    m_aT[slot] = pItem;
+                }
+                return pItem->Data;
+            }
+        }
+
+        return NULL;
+    }
+
+    bool Insert(const wchar_t* key, void* pData)
+    {
+        if (m_nBuckets == 0) return false;
+        if (Find(key)) return false;
+
+        unsigned int slot = LegacyHashKey(key) % m_nBuckets;
+        LegacyItem* pItem = new LegacyItem;
+        pItem->Key.Assign(key);
+        pItem->Data = pData;
+        pItem->pPrev = NULL;
+        pItem->pNext = m_aT[slot];
+        if (pItem->pNext)
+            pItem->pNext->pPrev = pItem;
+        m_aT[slot] = pItem;
+        m_nCount++;
+        return true;
+    }
+
+    bool Remove(const wchar_t* key)
+    {
+        if (m_nBuckets == 0 || m_nCount == 0) return false;
+
+        unsigned int slot = LegacyHashKey(key) % m_nBuckets;
+        LegacyItem** ppItem = &m_aT[slot];
+        while (*ppItem) {
+            if ((*ppItem)->Key == key) {
+                LegacyItem* pKill = *ppItem;
+                *ppItem = (*ppItem)->pNext;
+                if (*ppItem)
+                    (*ppItem)->pPrev = pKill->pPrev;
+                delete pKill;
+                m_nCount--;
+                return true;
+            }
+            ppItem = &((*ppItem)->pNext);
+        }
+
+        return false;
+    }
+
+private:
+    LegacyItem** m_aT;
+    int m_nBuckets;
+    int m_nCount;
+};
+
+typedef CStringPtrTableT<wchar_t> Table;
+
+struct NameSet
+{
+    const char* pName;
+    std::vector<std::wstring> keys;
+};
+
+// 皮肤里的名字都是 ASCII，绘制字符串中偶尔有中文，按字节展开不影响散列和比较的代价
+static std::wstring Widen(const char* pstr)
+{
+    std::wstring result;
+    for (; *pstr != '\0'; ++pstr)
+        result.push_back(static_cast<wchar_t>(static_cast<unsigned char>(*pstr)));
+    return result;
+}
+
+static bool EndsWith(const char* pstr, const char* pSuffix)
+{
+    const size_t nLen = strlen(pstr), nSuffix = strlen(pSuffix);
+    return nLen >= nSuffix && strcmp(pstr + nLen - nSuffix, pSuffix) == 0;
+}
+
+static void CollectNames(const CMarkupDomA::Node* pNode, std::set<std::wstring>& names, std::set<std::wstring>& images)
+{
+    for (; pNode != NULL; pNode = pNode->pNext)
+    {
+        for (unsigned int i = 0; i < pNode->nAttributes; ++i)
+        {
+            const CMarkupDomA::Attribute& attr = pNode->pAttributes[i];
+            if (attr.pValue[0] == '\0')
+                continue;
+            if (strcmp(attr.pName, "name") == 0)
+                names.insert(Widen(attr.pValue));
+            else if (EndsWith(attr.pName, "image"))
+                images.insert(Widen(attr.pValue));
+        }
+        CollectNames(pNode->pChild, names, images);
+    }
+}
+
+static bool LoadSkin(const char* pFile, std::set<std::wstring>& names, std::set<std::wstring>& images)
+{
+    std::string text = ReadFile(std::string(SKIN_DIR) + "/" + pFile);
+    if (text.empty())
+        return false;
+    CMarkupDomA dom;
+    if (!dom.Parse(&text[0], true))
+        return false;
+    CollectNames(dom.GetRoot(), names, images);
+    return true;
+}
+
+static void* DataOf(size_t i)
+{
+    return reinterpret_cast<void*>(static_cast<size_t>(i * 16 + 16));
+}
+
+struct Timings
+{
+    double build;
+    double hit;
+    double hot;
+    double miss;
+    double churn;
+};
+
+// 查找用的 key 是另外的字符串，和 FindControl 收到的参数一样不是表里的指针
+template<typename Map>
+static Timings RunMap(const NameSet& set, const std::vector<size_t>& order, const std::vector<size_t>& hotOrder,
+    const std::vector<std::wstring>& misses, int rounds, size_t& checksum)
+{
+    const std::vector<std::wstring>& keys = set.keys;
+    Timings t;
+    double begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        Map map;
+        for (size_t i = 0; i < keys.size(); ++i)
+            checksum += map.Insert(keys[i].c_str(), DataOf(i));
+    }
+    t.build = (Now() - begin) * 1e9 / (static_cast<double>(rounds) * keys.size());
+
+    Map map;
+    for (size_t i = 0; i < keys.size(); ++i)
+        map.Insert(keys[i].c_str(), DataOf(i));
+
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < order.size(); ++i)
+            checksum += reinterpret_cast<size_t>(map.Find(keys[order[i]].c_str()));
+    }
+    t.hit = (Now() - begin) * 1e9 / (static_cast<double>(rounds) * order.size());
+
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < hotOrder.size(); ++i)
+            checksum += reinterpret_cast<size_t>(map.Find(keys[hotOrder[i]].c_str()));
+    }
+    t.hot = (Now() - begin) * 1e9 / (static_cast<double>(rounds) * hotOrder.size());
+
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < misses.size(); ++i)
+            checksum += reinterpret_cast<size_t>(map.Find(misses[i].c_str()));
+    }
+    t.miss = (Now() - begin) * 1e9 / (static_cast<double>(rounds) * misses.size());
+
+    // 重建视频窗口、切换窗口时成批删除再插入
+    begin = Now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < keys.size(); i += 2)
+            checksum += map.Remove(keys[i].c_str());
+        for (size_t i = 0; i < keys.size(); i += 2)
+            checksum += map.Insert(keys[i].c_str(), DataOf(i));
+    }
+    t.churn = (Now() - begin) * 1e9 / (static_cast<double>(rounds) * ((keys.size() + 1) / 2 * 2));
+    return t;
+}
+
+static void RunSet(const NameSet& set, int rounds, size_t& checksum)
+{
+    const std::vector<std::wstring>& keys = set.keys;
+    std::mt19937 rng(44);
+    std::vector<size_t> order;
+    for (int k = 0; k < 4; ++k)
+    {
+        for (size_t i = 0; i < keys.size(); ++i)
+            order.push_back(i);
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    // 90% 的查找落在 8 个名字上，例如每次通知都要找的几个按钮
+    std::vector<size_t> hotOrder(order.size());
+    for (size_t i = 0; i < hotOrder.size(); ++i)
+        hotOrder[i] = rng() % 10 != 0 ? order[i % 8] : order[i];
+
+    // 未命中：改掉最后一个字符，长度分布不变
+    std::vector<std::wstring> misses;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        misses.push_back(keys[order[i]]);
+        misses.back().back() = L'#';
+    }
+
+    size_t nChars = 0;
+    for (size_t i = 0; i < keys.size(); ++i)
+        nChars += keys[i].size();
+    printf("%s: %zu keys, %.1f chars on average\n", set.pName, keys.size(), static_cast<double>(nChars) / keys.size());
+
+    const Timings legacy = RunMap<LegacyStringPtrMap>(set, order, hotOrder, misses, rounds, checksum);
+    const Timings table = RunMap<Table>(set, order, hotOrder, misses, rounds, checksum);
+    const char* const kNames[] = { "build", "find hit", "find hot", "find miss", "remove+insert" };
+    const double aLegacy[] = { legacy.build, legacy.hit, legacy.hot, legacy.miss, legacy.churn };
+    const double aTable[] = { table.build, table.hit, table.hot, table.miss, table.churn };
+    for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i)
+        printf("  %-14s chained %7.1f ns   table %7.1f ns   (%4.1fx)\n", kNames[i], aLegacy[i], aTable[i], aLegacy[i] / aTable[i]);
+}
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 200;
+
+    std::vector<NameSet> sets;
+    std::set<std::wstring> allNames, allImages;
+    for (size_t i = 0; i < sizeof(kSkinFiles) / sizeof(kSkinFiles[0]); ++i)
+    {
+        std::set<std::wstring> names, images;
+        if (!LoadSkin(kSkinFiles[i], names, images))
+        {
+            fprintf(stderr, "cannot parse %s\n", kSkinFiles[i]);
+            return 1;
+        }
+        if (strcmp(kSkinFiles[i], "trtc_setting.xml") == 0)
+        {
+            NameSet set = { "trtc_setting.xml names", std::vector<std::wstring>(names.begin(), names.end()) };
+            sets.push_back(set);
+        }
+        allNames.insert(names.begin(), names.end());
+        allImages.insert(images.begin(), images.end());
+    }
+    NameSet all = { "all skin names", std::vector<std::wstring>(allNames.begin(), allNames.end()) };
+    sets.push_back(all);
+    NameSet images = { "draw strings", std::vector<std::wstring>(allImages.begin(), allImages.end()) };
+    sets.push_back(images);
+
+    // 64 个远端用户，大小画面各一路，每路 5 个按钮
+    const char* const kButtons[] = { "rotation", "rendermode", "audioicon", "videoicon", "netsignalicon" };
+    NameSet videos = { "video view buttons", std::vector<std::wstring>() };
+    for (int user = 0; user < 64; ++user)
+    {
+        for (int stream = 0; stream < 2; ++stream)
+        {
+            for (size_t b = 0; b < sizeof(kButtons) / sizeof(kButtons[0]); ++b)
+            {
+                char name[64];
+                snprintf(name, sizeof(name), "%s_%d_%d", kButtons[b], 20481000 + user * 37, stream);
+                videos.keys.push_back(Widen(name));
+            }
+        }
+    }
+    sets.push_back(videos);
+
+    printf("%d rounds\n", rounds);
+    size_t checksum = 0;
+    for (size_t i = 0; i < sets.size(); ++i)
+        RunSet(sets[i], rounds, checksum);
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
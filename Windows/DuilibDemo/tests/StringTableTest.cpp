@@ -0,0 +1,139 @@
+/*
+* Module:   StringTableTest
+*
+* Function: CStringPtrTableT 与 std::map 做随机操作对照（插入、Set、删除、按下标删除、查找、枚举），
+*           以及空 key、扩容和删除后 GetKeyAt 指针不变、字符池整块释放
+*/
+#include "UIStringTable.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <wchar.h>
+#include <map>
+#include <random>
+#include <string>
+
+using namespace DuiLib;
+
+typedef CStringPtrTableT<wchar_t> Table;
+
+static void CheckSame(const Table& table, const std::map<std::wstring, void*>& reference)
+{
+    TEST_CHECK(table.GetSize() == reference.size());
+    for (size_t i = 0; i < table.GetSize(); ++i)
+    {
+        std::map<std::wstring, void*>::const_iterator it = reference.find(table.GetKeyAt(i));
+        TEST_CHECK(it != reference.end());
+        TEST_CHECK(it->second == table.GetDataAt(i));
+        TEST_CHECK(table.Find(table.GetKeyAt(i)) == it->second);
+    }
+}
+
+static void TestMatchesMap()
+{
+    std::mt19937 rng(1);
+    for (int round = 0; round < 20; ++round)
+    {
+        Table table;
+        std::map<std::wstring, void*> reference;
+        // key 的范围逐轮变大，覆盖多次扩容；部分 key 加长，覆盖散列的长 key 路径
+        const unsigned int nRange = 50 + round * 200;
+        for (int op = 0; op < 20000; ++op)
+        {
+            std::wstring key = L"k" + std::to_wstring(rng() % nRange);
+            if (rng() % 4 == 0)
+                key.append(rng() % 40, L'x');
+            void* pData = reinterpret_cast<void*>(static_cast<size_t>(rng() | 1));
+            const unsigned int action = rng() % 10;
+            if (action < 4)
+            {
+                TEST_CHECK(table.Insert(key.c_str(), pData) == reference.insert(std::make_pair(key, pData)).second);
+            }
+            else if (action < 5)
+            {
+                void* pOld = NULL;
+                std::map<std::wstring, void*>::iterator it = reference.find(key);
+                if (it != reference.end())
+                    pOld = it->second;
+                reference[key] = pData;
+                TEST_CHECK(table.Set(key.c_str(), pData) == pOld);
+            }
+            else if (action < 7)
+            {
+                TEST_CHECK(table.Remove(key.c_str()) == (reference.erase(key) == 1));
+            }
+            else if (action < 8)
+            {
+                // 用 GetKeyAt 返回的指针删除：删除过程中不能先释放 key
+                if (table.GetSize() > 0)
+                {
+                    const size_t index = rng() % table.GetSize();
+                    const std::wstring removed = table.GetKeyAt(index);
+                    TEST_CHECK(table.Remove(table.GetKeyAt(index)));
+                    reference.erase(removed);
+                }
+            }
+            else
+            {
+                std::map<std::wstring, void*>::const_iterator it = reference.find(key);
+                TEST_CHECK(table.Find(key.c_str()) == (it == reference.end() ? NULL : it->second));
+            }
+            if (op % 997 == 0)
+                CheckSame(table, reference);
+        }
+        CheckSame(table, reference);
+        if (round % 5 == 4)
+        {
+            table.Clear();
+            TEST_CHECK(table.GetSize() == 0 && table.Find(L"k1") == NULL);
+            TEST_CHECK(table.Insert(L"a", reinterpret_cast<void*>(1)));
+        }
+    }
+}
+
+static void TestEdgeCases()
+{
+    Table empty;
+    TEST_CHECK(empty.Find(L"") == NULL);
+    TEST_CHECK(!empty.Remove(L"a"));
+
+    Table table;
+    TEST_CHECK(table.Insert(L"", reinterpret_cast<void*>(5)));
+    TEST_CHECK(table.Find(L"") == reinterpret_cast<void*>(5));
+    TEST_CHECK(!table.Insert(L"", reinterpret_cast<void*>(6)));
+    TEST_CHECK(table.Remove(L""));
+    TEST_CHECK(!table.Insert(NULL, NULL));
+    TEST_CHECK(table.Find(NULL) == NULL);
+}
+
+static void TestKeyStability()
+{
+    Table table;
+    table.Reserve(10);
+    TEST_CHECK(table.Insert(L"first", reinterpret_cast<void*>(1)));
+    const wchar_t* pFirst = table.GetKeyAt(0);
+    for (int i = 0; i < 5000; ++i)
+        TEST_CHECK(table.Insert((L"n" + std::to_wstring(i)).c_str(), reinterpret_cast<void*>(2)));
+    // 扩容不移动 key
+    TEST_CHECK(pFirst == table.GetKeyAt(0) && wcscmp(pFirst, L"first") == 0);
+    Table::Stats stats = table.GetStats();
+    TEST_CHECK(stats.nCount == 5001);
+    TEST_CHECK(stats.nSlots * 4 >= stats.nCount * 5);
+
+    // 删除之后没有用到的字符块整块释放
+    const size_t nBlocks = stats.nPoolBlocks;
+    for (int i = 0; i < 5000; ++i)
+        TEST_CHECK(table.Remove((L"n" + std::to_wstring(i)).c_str()));
+    stats = table.GetStats();
+    TEST_CHECK(stats.nCount == 1 && stats.nPoolBlocks < nBlocks);
+    TEST_CHECK(table.Find(L"first") == reinterpret_cast<void*>(1));
+}
+
+int main()
+{
+    TestMatchesMap();
+    TestEdgeCases();
+    TestKeyStability();
+    printf("StringTableTest passed\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+* Module:   TcharShim/StdAfx.h
+*
+* Function: 在 Linux 上编译 duilib 字符串代码（Utils/UIString.cpp）时代替 duilib 的 StdAfx.h。
+*           按 _UNICODE 构建：TCHAR 为 wchar_t（Windows 上 2 字节，这里 4 字节），_tcs* 换成对应的 wcs* 函数，
+*           MultiByteToWideChar 只按字节展开 ASCII，CharNext 前进一个字符。只提供 UIString 用到的部分
+*/
+#ifndef __TCHAR_SHIM_STDAFX_H__
+#define __TCHAR_SHIM_STDAFX_H__
+
+#include <alloca.h>
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <utility>
+
+#ifndef _UNICODE
+#define _UNICODE
+#endif
+
+#define UILIB_API
+#define __cdecl
+#define ASSERT(expr) assert(expr)
+#define _ASSERTE(expr) assert(expr)
+
+typedef wchar_t TCHAR;
+typedef wchar_t WCHAR;
+typedef wchar_t* LPTSTR;
+typedef wchar_t* LPWSTR;
+typedef const wchar_t* LPCTSTR;
+typedef const wchar_t* LPCWSTR;
+typedef const char* LPCSTR;
+typedef char* LPSTR;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef unsigned long DWORD;
+
+#define TRUE 1
+#define FALSE 0
+#define _T(x) L##x
+#define CP_ACP 0
+
+#define _tcslen wcslen
+#define _tcscmp wcscmp
+#define _tcsncmp wcsncmp
+#define _tcsicmp wcscasecmp
+#define _tcsnicmp wcsncasecmp
+#define _tcschr wcschr
+#define _tcsrchr wcsrchr
+#define _tcsstr wcsstr
+#define _vsntprintf vswprintf
+#define _alloca alloca
+#define ZeroMemory(p, n) memset((p), 0, (n))
+
+inline BOOL IsBadStringPtr(LPCTSTR, UINT) { return FALSE; }
+inline BOOL IsBadStringPtrA(LPCSTR, UINT) { return FALSE; }
+
+inline LPTSTR _tcsupr(LPTSTR pstr)
+{
+    for (LPTSTR p = pstr; *p != L'\0'; ++p)
+        *p = static_cast<wchar_t>(towupper(*p));
+    return pstr;
+}
+
+inline LPTSTR _tcslwr(LPTSTR pstr)
+{
+    for (LPTSTR p = pstr; *p != L'\0'; ++p)
+        *p = static_cast<wchar_t>(towlower(*p));
+    return pstr;
+}
+
+inline LPCTSTR CharNext(LPCTSTR pstr)
+{
+    return *pstr != L'\0' ? pstr + 1 : pstr;
+}
+
+inline UINT GetACP() { return CP_ACP; }
+
+// 只处理 cchSrc 为 -1（含结尾的 0）的情况，返回写入的字符数
+inline int MultiByteToWideChar(UINT, DWORD, LPCSTR lpMultiByteStr, int, LPWSTR lpWideCharStr, int cchWideChar)
+{
+    int n = 0;
+    for (; n < cchWideChar; ++n)
+    {
+        lpWideCharStr[n] = static_cast<unsigned char>(lpMultiByteStr[n]);
+        if (lpMultiByteStr[n] == '\0')
+            return n + 1;
+    }
+    return 0;
+}
+
+#endif // __TCHAR_SHIM_STDAFX_H__
@@ -0,0 +1,22 @@
+/*
+* Module:   TestUtil
+*
+* Function: 单元测试用的最小断言宏，失败时打印位置并以非 0 退出，Release 下同样生效
+*/
+#ifndef __TEST_UTIL_H__
+#define __TEST_UTIL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_CHECK(expr)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(expr))                                                            \
+        {                                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+#endif /* __TEST_UTIL_H__ */
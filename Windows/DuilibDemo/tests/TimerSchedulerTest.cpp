@@ -0,0 +1,295 @@
+/*
+* Module:   TimerSchedulerTest
+*
+* Function: 用假时钟驱动 CTimerScheduler，与逐个扫描的朴素模型对照（设置、删除、帧对齐、到期顺序、
+*           周期定时器重排、GetTickCount 回绕），以及 CPaintManagerUI 的分发方式：
+*           分发中进入模态循环时其他定时器照常触发，中途删除的定时器不再分发
+*/
+#include "UITimerScheduler.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DuiLib;
+
+struct NaiveTimer
+{
+    void* pTarget;
+    unsigned int nID;
+    unsigned int nDue;
+    unsigned int nPeriod;
+    unsigned int nSeq;
+};
+
+// 每次都扫描全部定时器
+struct NaiveScheduler
+{
+    std::vector<NaiveTimer> timers;
+    unsigned int nSeq = 0;
+    unsigned int nPhase = 0;
+    unsigned int nInterval = 0;
+
+    unsigned int FrameStart(unsigned int nTime) const
+    {
+        return nInterval != 0 ? nTime - (nTime - nPhase) % nInterval : nTime;
+    }
+
+    unsigned int FrameEnd(unsigned int nTime) const
+    {
+        if (nInterval == 0)
+            return nTime;
+        const unsigned int nOffset = (nTime - nPhase) % nInterval;
+        return nOffset != 0 ? nTime + nInterval - nOffset : nTime;
+    }
+
+    static bool Before(const NaiveTimer& a, const NaiveTimer& b)
+    {
+        const int nDiff = static_cast<int>(a.nDue - b.nDue);
+        return nDiff != 0 ? nDiff < 0 : static_cast<int>(a.nSeq - b.nSeq) < 0;
+    }
+
+    void Set(void* pTarget, unsigned int nID, unsigned int nDue, unsigned int nPeriod)
+    {
+        Kill(pTarget, nID);
+        NaiveTimer timer = { pTarget, nID, nDue, nPeriod, nSeq++ };
+        timers.push_back(timer);
+    }
+
+    bool Kill(void* pTarget, unsigned int nID)
+    {
+        for (size_t i = 0; i < timers.size(); ++i)
+        {
+            if (timers[i].pTarget == pTarget && timers[i].nID == nID)
+            {
+                timers.erase(timers.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int KillAll(void* pTarget)
+    {
+        const size_t nOld = timers.size();
+        timers.erase(std::remove_if(timers.begin(), timers.end(),
+            [pTarget](const NaiveTimer& timer) { return timer.pTarget == pTarget; }), timers.end());
+        return static_cast<int>(nOld - timers.size());
+    }
+
+    bool IsSet(void* pTarget, unsigned int nID) const
+    {
+        for (size_t i = 0; i < timers.size(); ++i)
+        {
+            if (timers[i].pTarget == pTarget && timers[i].nID == nID)
+                return true;
+        }
+        return false;
+    }
+
+    bool NextWake(unsigned int& nWake) const
+    {
+        if (timers.empty())
+            return false;
+        NaiveTimer first = timers[0];
+        for (size_t i = 1; i < timers.size(); ++i)
+        {
+            if (Before(timers[i], first))
+                first = timers[i];
+        }
+        nWake = FrameEnd(first.nDue);
+        return true;
+    }
+
+    unsigned int Collect(unsigned int nNow, std::vector<CTimerScheduler::TFired>& aFired)
+    {
+        const unsigned int nFrame = FrameStart(nNow);
+        std::vector<NaiveTimer> fired, keep;
+        for (size_t i = 0; i < timers.size(); ++i)
+            (static_cast<int>(nFrame - timers[i].nDue) >= 0 ? fired : keep).push_back(timers[i]);
+        std::sort(fired.begin(), fired.end(), Before);
+        timers = keep;
+        for (size_t i = 0; i < fired.size(); ++i)
+        {
+            CTimerScheduler::TFired item = { fired[i].pTarget, fired[i].nID };
+            aFired.push_back(item);
+        }
+        for (size_t i = 0; i < fired.size(); ++i)
+        {
+            NaiveTimer timer = fired[i];
+            if (timer.nPeriod == 0)
+                continue;
+            timer.nDue += timer.nPeriod;
+            if (static_cast<int>(timer.nDue - nFrame) <= 0)
+                timer.nDue = nFrame + timer.nPeriod;
+            timer.nSeq = nSeq++;
+            timers.push_back(timer);
+        }
+        return nFrame;
+    }
+};
+
+static void TestMatchesModel()
+{
+    std::mt19937 rng(5);
+    char targets[20];
+    for (int round = 0; round < 300; ++round)
+    {
+        CTimerScheduler scheduler;
+        NaiveScheduler model;
+        // 三分之一的轮次从 GetTickCount 回绕之前开始
+        unsigned int nNow = round % 3 == 0 ? 0xFFFFFFFFu - rng() % 5000 : rng();
+        const unsigned int nInterval = round % 4 == 0 ? 0 : 1 + rng() % 20;
+        const unsigned int nPhase = rng();
+        scheduler.SetFrameClock(nPhase, nInterval);
+        model.nPhase = nPhase;
+        model.nInterval = nInterval;
+
+        for (int op = 0; op < 3000; ++op)
+        {
+            const unsigned int action = rng() % 10;
+            void* pTarget = &targets[rng() % 20];
+            const unsigned int nID = rng() % 4;
+            if (action < 4)
+            {
+                const unsigned int nDue = nNow + rng() % 200;
+                const unsigned int nPeriod = rng() % 3 != 0 ? 0 : 1 + rng() % 100;
+                scheduler.Set(pTarget, nID, nDue, nPeriod);
+                model.Set(pTarget, nID, nDue, nPeriod);
+            }
+            else if (action < 5)
+            {
+                TEST_CHECK(scheduler.Kill(pTarget, nID) == model.Kill(pTarget, nID));
+            }
+            else if (action < 6)
+            {
+                TEST_CHECK(scheduler.KillAll(pTarget) == model.KillAll(pTarget));
+            }
+            else
+            {
+                nNow += rng() % 40;
+                std::vector<CTimerScheduler::TFired> aFired, aExpected;
+                const unsigned int nFrame = scheduler.Collect(nNow, aFired);
+                TEST_CHECK(nFrame == model.Collect(nNow, aExpected));
+                TEST_CHECK(nInterval == 0 || (nFrame - nPhase) % nInterval == 0);
+                TEST_CHECK(aFired.size() == aExpected.size());
+                for (size_t i = 0; i < aFired.size(); ++i)
+                    TEST_CHECK(aFired[i].pTarget == aExpected[i].pTarget && aFired[i].nID == aExpected[i].nID);
+            }
+
+            unsigned int nWake = 0, nExpectedWake = 0;
+            const bool bWake = scheduler.GetNextWake(nWake);
+            TEST_CHECK(bWake == model.NextWake(nExpectedWake));
+            TEST_CHECK(!bWake || nWake == nExpectedWake);
+            TEST_CHECK(scheduler.GetCount() == static_cast<int>(model.timers.size()));
+            TEST_CHECK(scheduler.IsSet(pTarget, nID) == model.IsSet(pTarget, nID));
+        }
+    }
+}
+
+// CPaintManagerUI::_OnSchedulerTimer 的分发方式，系统定时器和消息循环换成假时钟
+struct FakeWindow
+{
+    CTimerScheduler scheduler;
+    std::vector<std::vector<CTimerScheduler::TFired>*> batches;
+    unsigned int nNow = 0;
+    unsigned int nWake = 0;
+    bool bArmed = false;
+    std::vector<CTimerScheduler::TFired> log;
+    void (*pfnHandler)(FakeWindow& window, const CTimerScheduler::TFired& fired) = NULL;
+
+    void Arm()
+    {
+        bArmed = scheduler.GetNextWake(nWake);
+    }
+
+    void Cancel(void* pTarget)
+    {
+        for (size_t iBatch = 0; iBatch < batches.size(); ++iBatch)
+        {
+            std::vector<CTimerScheduler::TFired>& aFired = *batches[iBatch];
+            for (size_t i = 0; i < aFired.size(); ++i)
+            {
+                if (aFired[i].pTarget == pTarget)
+                    aFired[i].pTarget = NULL;
+            }
+        }
+        scheduler.KillAll(pTarget);
+        Arm();
+    }
+
+    void OnTimer()
+    {
+        std::vector<CTimerScheduler::TFired> aFired;
+        scheduler.Collect(nNow, aFired);
+        Arm();
+        if (aFired.empty())
+            return;
+        batches.push_back(&aFired);
+        for (size_t i = 0; i < aFired.size(); ++i)
+        {
+            if (aFired[i].pTarget == NULL)
+                continue;
+            log.push_back(aFired[i]);
+            if (pfnHandler != NULL)
+                pfnHandler(*this, aFired[i]);
+        }
+        batches.pop_back();
+    }
+
+    // 消息循环：时间走到 nUntil，到了唤醒时间就处理定时器
+    void Run(unsigned int nUntil)
+    {
+        while (static_cast<int>(nUntil - nNow) > 0)
+        {
+            ++nNow;
+            if (bArmed && static_cast<int>(nNow - nWake) >= 0)
+                OnTimer();
+        }
+    }
+};
+
+static char g_modalOwner, g_ticker, g_victim;
+
+static void ModalHandler(FakeWindow& window, const CTimerScheduler::TFired& fired)
+{
+    if (fired.pTarget != &g_modalOwner)
+        return;
+    // 弹出模态对话框：同一批里后面的 g_victim 在对话框里被删除，对话框开着的 100 毫秒里 g_ticker 照常触发
+    window.Cancel(&g_victim);
+    window.Run(window.nNow + 100);
+}
+
+static void TestModalLoopDuringDispatch()
+{
+    FakeWindow window;
+    window.scheduler.SetFrameClock(0, 10);
+    window.pfnHandler = ModalHandler;
+    window.scheduler.Set(&g_modalOwner, 1, 10, 0);
+    window.scheduler.Set(&g_victim, 1, 10, 0);
+    window.scheduler.Set(&g_ticker, 1, 20, 20);
+    window.Arm();
+    window.Run(200);
+
+    int nModal = 0, nTicks = 0, nVictim = 0;
+    for (size_t i = 0; i < window.log.size(); ++i)
+    {
+        nModal += window.log[i].pTarget == &g_modalOwner;
+        nTicks += window.log[i].pTarget == &g_ticker;
+        nVictim += window.log[i].pTarget == &g_victim;
+    }
+    TEST_CHECK(nModal == 1 && nVictim == 0);
+    // 20 到 200 每 20 毫秒一次，包括对话框打开期间的 20 到 100
+    TEST_CHECK(nTicks == 10);
+    TEST_CHECK(window.batches.empty());
+}
+
+int main()
+{
+    TestMatchesModel();
+    TestModalLoopDuringDispatch();
+    printf("TimerSchedulerTest passed\n");
+    return 0;
+}
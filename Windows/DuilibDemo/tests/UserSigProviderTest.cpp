@@ -0,0 +1,435 @@
+/*
+* Module:   UserSigProviderTest
+*
+* Function: CUserSigProvider 用假时钟和进程内的签发函数测试：有效期解码、并发请求合并、到期前刷新、
+*           刷新失败保留旧值、析构时丢弃未完成请求的 callback；
+*           以及和 GenerateTestUserSig::getUserSigFromServer 一样经 HttpClient 向本机模拟签发服务器获取
+*/
+#include "util/UserSigProvider.h"
+#include "http/HttpClient.h"
+#include "json/JsonStream.h"
+#include "LoopbackHttpServer.h"
+#include "TestUtil.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static std::atomic<int64_t> g_now(1000000);
+static std::atomic<int> g_fetchCount(0);
+
+// zlib 格式、只用 stored block 的压缩流，InflateZlib 可以解开
+static std::string ZlibStored(const std::string& data)
+{
+    std::string out;
+    out.push_back(static_cast<char>(0x78));
+    out.push_back(static_cast<char>(0x01));
+    out.push_back(static_cast<char>(0x01));
+    uint16_t len = static_cast<uint16_t>(data.size());
+    uint16_t nlen = static_cast<uint16_t>(~len);
+    out.push_back(static_cast<char>(len & 0xFF));
+    out.push_back(static_cast<char>(len >> 8));
+    out.push_back(static_cast<char>(nlen & 0xFF));
+    out.push_back(static_cast<char>(nlen >> 8));
+    out += data;
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        a = (a + static_cast<uint8_t>(data[i])) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>((adler >> shift) & 0xFF));
+    return out;
+}
+
+// UserSig 的 base64 变体：'+' '/' '=' 替换成 '*' '-' '_'
+static std::string UserSigBase64(const std::string& data)
+{
+    static const char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789*-";
+    std::string out;
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        buffer = (buffer << 8) | static_cast<uint8_t>(data[i]);
+        bits += 8;
+        while (bits >= 6)
+        {
+            bits -= 6;
+            out.push_back(kTable[(buffer >> bits) & 0x3F]);
+        }
+    }
+    if (bits > 0)
+        out.push_back(kTable[(buffer << (6 - bits)) & 0x3F]);
+    while (out.size() % 4 != 0)
+        out.push_back('_');
+    return out;
+}
+
+static std::string MakeUserSig(const std::string& userId, int64_t issueTime, int64_t lifetime, int serial)
+{
+    std::string json = "{\"TLS.ver\":\"2.0\",\"TLS.identifier\":\"" + userId + "\",\"TLS.sdkappid\":1400000001,"
+        "\"TLS.expire\":" + std::to_string(lifetime) + ",\"TLS.time\":" + std::to_string(issueTime) +
+        ",\"TLS.sig\":\"serial" + std::to_string(serial) + "\"}";
+    return UserSigBase64(ZlibStored(json));
+}
+
+static int Fetch(uint32_t sdkAppId, const std::string& userId, std::string& userSig)
+{
+    int serial = ++g_fetchCount;
+    if (userId == "fail")
+        return 70001;
+    if (userId == "opaque")
+    {
+        userSig = "not-a-usersig";
+        return 0;
+    }
+    // 让并发的 Get 都在这次获取完成之前到达
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    userSig = MakeUserSig(userId + std::to_string(sdkAppId), g_now.load(), 7200, serial);
+    return 0;
+}
+
+static CUserSigProvider::Config MakeConfig()
+{
+    CUserSigProvider::Config config;
+    config.refreshAheadSeconds = 600;
+    config.retryDelaySeconds = 30;
+    config.pollIntervalMs = 20;
+    return config;
+}
+
+static void TestDecodeExpiry()
+{
+    int64_t issueTime = 0, expireTime = 0;
+    TEST_CHECK(DecodeUserSigExpiry(MakeUserSig("alice", 1000, 86400, 0), issueTime, expireTime));
+    TEST_CHECK(issueTime == 1000 && expireTime == 87400);
+    TEST_CHECK(!DecodeUserSigExpiry("not-a-usersig", issueTime, expireTime));
+    TEST_CHECK(!DecodeUserSigExpiry("", issueTime, expireTime));
+}
+
+static void TestSingleFlightAndRefresh()
+{
+    g_now = 1000000;
+    g_fetchCount = 0;
+    CUserSigProvider provider(Fetch, MakeConfig(), []() { return g_now.load(); });
+
+    std::mutex mutex;
+    std::string results[10];
+    std::atomic<int> successCount(0);
+    std::string userSig;
+    for (int i = 0; i < 10; ++i)
+    {
+        bool bCached = provider.Get(1400000001, "alice", userSig, [&, i](int code, const std::string& sig) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = sig;
+            if (code == 0)
+                ++successCount;
+        });
+        TEST_CHECK(!bCached);
+    }
+    provider.WaitIdle();
+    TEST_CHECK(successCount == 10);
+    TEST_CHECK(g_fetchCount == 1);
+    for (int i = 1; i < 10; ++i)
+        TEST_CHECK(results[i] == results[0]);
+
+    // 命中缓存，不再获取
+    TEST_CHECK(provider.Get(1400000001, "alice", userSig, UserSigCallback()));
+    TEST_CHECK(userSig == results[0]);
+    TEST_CHECK(g_fetchCount == 1);
+
+    // 进入提前刷新窗口：Get 立即返回旧值，后台刷新
+    g_now = 1000000 + 7200 - 500;
+    TEST_CHECK(provider.Get(1400000001, "alice", userSig, UserSigCallback()));
+    TEST_CHECK(userSig == results[0]);
+    provider.WaitIdle();
+    TEST_CHECK(g_fetchCount == 2);
+    TEST_CHECK(provider.GetCached(1400000001, "alice", userSig) && userSig != results[0]);
+
+    // 没有 Get 调用时由工作线程自己刷新
+    int64_t issueTime = 0, expireTime = 0;
+    TEST_CHECK(DecodeUserSigExpiry(userSig, issueTime, expireTime));
+    g_now = expireTime - 300;
+    provider.CheckRefresh();
+    provider.WaitIdle();
+    TEST_CHECK(g_fetchCount == 3);
+
+    // 同一用户不同 sdkAppId 分开缓存
+    provider.Prefetch(1, "bob");
+    provider.Prefetch(2, "bob");
+    provider.WaitIdle();
+    TEST_CHECK(provider.GetCached(1, "bob", userSig) && provider.GetCached(2, "bob", userSig));
+    provider.Invalidate(1, "bob");
+    TEST_CHECK(!provider.GetCached(1, "bob", userSig));
+    TEST_CHECK(provider.GetCached(2, "bob", userSig));
+}
+
+static void TestFallbackAndFailure()
+{
+    g_now = 2000000;
+    CUserSigProvider provider(Fetch, MakeConfig(), []() { return g_now.load(); });
+
+    // 解不出有效期时按 fallbackLifetimeSeconds 缓存
+    std::string userSig;
+    TEST_CHECK(!provider.Get(7, "opaque", userSig, UserSigCallback()));
+    provider.WaitIdle();
+    TEST_CHECK(provider.GetCached(7, "opaque", userSig) && userSig == "not-a-usersig");
+    g_now += 3600;
+    TEST_CHECK(!provider.GetCached(7, "opaque", userSig));
+
+    std::atomic<int> result(0);
+    TEST_CHECK(!provider.Get(7, "fail", userSig, [&](int code, const std::string&) { result = code; }));
+    provider.WaitIdle();
+    TEST_CHECK(result == 70001);
+}
+
+static void TestDestroyDropsPendingCallbacks()
+{
+    std::atomic<bool> bRelease(false);
+    std::atomic<bool> bFetching(false);
+    UserSigFetcher slowFetcher = [&](uint32_t, const std::string& userId, std::string& userSig) {
+        if (userId == "slow")
+        {
+            bFetching = true;
+            while (!bRelease)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        userSig = "sig-" + userId;
+        return 0;
+    };
+
+    std::unique_ptr<CUserSigProvider> provider(new CUserSigProvider(slowFetcher, MakeConfig()));
+    std::thread::id mainThread = std::this_thread::get_id();
+    std::atomic<bool> bSlowCalled(false);
+    std::atomic<bool> bSlowOnWorker(false);
+    std::atomic<bool> bQueuedCalled(false);
+
+    std::string userSig;
+    TEST_CHECK(!provider->Get(1, "slow", userSig, [&](int code, const std::string&) {
+        bSlowCalled = code == 0;
+        bSlowOnWorker = std::this_thread::get_id() != mainThread;
+    }));
+    while (!bFetching)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    TEST_CHECK(!provider->Get(1, "queued", userSig, [&](int, const std::string&) { bQueuedCalled = true; }));
+
+    std::thread releaser([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        bRelease = true;
+    });
+    provider.reset();
+    releaser.join();
+
+    // 正在执行的获取照常在工作线程回调，排队中的直接丢弃
+    TEST_CHECK(bSlowCalled && bSlowOnWorker);
+    TEST_CHECK(!bQueuedCalled);
+}
+
+// 模拟登录 cgi：按请求中的 appid 和 identifier 签发，identifier 为 "denied" 时返回错误码，
+// g_serverDown 时返回 502，每个请求延迟 20 毫秒
+static std::atomic<bool> g_serverDown(false);
+
+namespace
+{
+    const char* const kSignReqPaths[] = { "appid", "identifier" };
+    const char* const kSignRespPaths[] = { "errorCode", "data.userSig" };
+
+    struct SignReqHandler : public IJsonSelectHandler
+    {
+        int64_t appId = 0;
+        std::string identifier;
+
+        virtual bool OnValue(size_t pathIndex, size_t /*arrayIndex*/, CJsonPullReader& reader)
+        {
+            if (pathIndex == 0)
+                reader.GetInt64(appId);
+            else
+                reader.GetString(identifier);
+            return true;
+        }
+    };
+
+    struct SignRespHandler : public IJsonSelectHandler
+    {
+        bool bHasCode = false;
+        int64_t code = -1;
+        std::string userSig;
+
+        virtual bool OnValue(size_t pathIndex, size_t /*arrayIndex*/, CJsonPullReader& reader)
+        {
+            if (pathIndex == 0)
+                bHasCode = reader.GetInt64(code);
+            else
+                reader.GetString(userSig);
+            return true;
+        }
+    };
+}
+
+static bool HandleSignRequest(const LoopbackHttpServer::Request& request, std::string& response)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    SignReqHandler req;
+    if (request.method != "POST" || request.head.find("Content-Type: application/json") == std::string::npos ||
+        !JsonSelect(request.body.data(), request.body.size(), kSignReqPaths, 2, req))
+    {
+        response = LoopbackHttpServer::Response(400, "");
+        return true;
+    }
+    if (g_serverDown)
+    {
+        response = LoopbackHttpServer::Response(502, "");
+        return true;
+    }
+
+    CJsonStreamWriter writer;
+    writer.BeginObject();
+    if (req.identifier == "denied")
+    {
+        writer.Key("errorCode").Int(70003);
+        writer.Key("errorInfo").String("identifier not allowed");
+    }
+    else
+    {
+        writer.Key("errorCode").Int(0);
+        writer.Key("errorInfo").String("");
+        writer.Key("data").BeginObject();
+        writer.Key("userSig").String(MakeUserSig(req.identifier, g_now.load(), 7200, ++g_fetchCount));
+        writer.Key("token").String("unused");
+        writer.EndObject();
+    }
+    writer.EndObject();
+    response = LoopbackHttpServer::Response(200, writer.str());
+    return true;
+}
+
+// 与 GenerateTestUserSig::getUserSigFromServer 相同的请求和解析
+static int FetchFromServer(HttpClient& client, const std::wstring& url, uint32_t sdkAppId, const std::string& userId,
+    std::string& userSig)
+{
+    CJsonStreamWriter writer;
+    writer.BeginObject();
+    writer.Key("pwd").String("123");
+    writer.Key("appid").Int(sdkAppId);
+    writer.Key("roomnum").Int(0);
+    writer.Key("privMap").Int(255);
+    writer.Key("identifier").String(userId);
+    writer.EndObject();
+    std::vector<std::wstring> headers;
+    headers.push_back(L"Content-Type: application/json; charset=utf-8");
+
+    std::string respData;
+    DWORD ret = client.http_post(url, headers, writer.str(), respData);
+    if (0 != ret)
+        return static_cast<int>(ret);
+    if (respData.empty())
+        return EcUserSigEmpty;
+    SignRespHandler resp;
+    if (!JsonSelect(respData.data(), respData.size(), kSignRespPaths, 2, resp) || !resp.bHasCode)
+        return EcUserSigEmpty;
+    if (resp.code != 0)
+        return static_cast<int>(resp.code);
+    userSig = resp.userSig;
+    return 0;
+}
+
+static void TestMockSignServer()
+{
+    g_now = 3000000;
+    g_fetchCount = 0;
+    g_serverDown = false;
+    LoopbackHttpServer server(HandleSignRequest);
+    HttpClient client(L"UserSigProviderTest");
+    const std::wstring url = server.Url("/sxb_dev/?svc=account&cmd=authPrivMap");
+    CUserSigProvider provider([&](uint32_t sdkAppId, const std::string& userId, std::string& userSig) {
+        return FetchFromServer(client, url, sdkAppId, userId, userSig);
+    }, MakeConfig(), []() { return g_now.load(); });
+
+    // 多个线程同时请求同一个用户，服务器只收到一次签发请求
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::string> results;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.push_back(std::thread([&]() {
+            std::string userSig;
+            if (provider.Get(1400000001, "carol", userSig, [&](int code, const std::string& sig) {
+                std::lock_guard<std::mutex> lock(mutex);
+                results.push_back(code == 0 ? sig : std::string());
+                cond.notify_all();
+            }))
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results.push_back(userSig);
+                cond.notify_all();
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        TEST_CHECK(cond.wait_for(lock, std::chrono::seconds(10), [&]() { return results.size() == 8; }));
+    }
+    TEST_CHECK(server.Requests() == 1);
+    int64_t issueTime = 0, expireTime = 0;
+    TEST_CHECK(DecodeUserSigExpiry(results[0], issueTime, expireTime));
+    TEST_CHECK(issueTime == 3000000 && expireTime == 3007200);
+    for (size_t i = 1; i < results.size(); ++i)
+        TEST_CHECK(results[i] == results[0]);
+
+    // 提前刷新走服务器，新旧 UserSig 都通过同一个 keep-alive 连接获取
+    std::string userSig;
+    g_now = 3007200 - 500;
+    TEST_CHECK(provider.Get(1400000001, "carol", userSig, UserSigCallback()) && userSig == results[0]);
+    provider.WaitIdle();
+    TEST_CHECK(server.Requests() == 2);
+    TEST_CHECK(provider.GetCached(1400000001, "carol", userSig) && userSig != results[0]);
+    TEST_CHECK(server.Connections() == 1);
+
+    // 服务器出错时保留旧值，恢复后按 retryDelaySeconds 重试
+    const std::string refreshed = userSig;
+    g_serverDown = true;
+    TEST_CHECK(DecodeUserSigExpiry(refreshed, issueTime, expireTime));
+    g_now = expireTime - 500;
+    provider.CheckRefresh();
+    provider.WaitIdle();
+    TEST_CHECK(server.Requests() == 3);
+    TEST_CHECK(provider.GetCached(1400000001, "carol", userSig) && userSig == refreshed);
+    g_serverDown = false;
+    provider.CheckRefresh();
+    provider.WaitIdle();
+    TEST_CHECK(server.Requests() == 3);
+    g_now += 30;
+    provider.CheckRefresh();
+    provider.WaitIdle();
+    TEST_CHECK(server.Requests() == 4);
+    TEST_CHECK(provider.GetCached(1400000001, "carol", userSig) && userSig != refreshed);
+
+    // 服务器返回的错误码原样交给 callback
+    std::atomic<int> result(0);
+    TEST_CHECK(!provider.Get(1400000001, "denied", userSig, [&](int code, const std::string&) { result = code; }));
+    provider.WaitIdle();
+    TEST_CHECK(result == 70003);
+    TEST_CHECK(!provider.GetCached(1400000001, "denied", userSig));
+}
+
+int main()
+{
+    TestDecodeExpiry();
+    TestSingleFlightAndRefresh();
+    TestFallbackAndFailure();
+    TestDestroyDropsPendingCallbacks();
+    TestMockSignServer();
+    printf("UserSigProviderTest passed\n");
+    return 0;
+}
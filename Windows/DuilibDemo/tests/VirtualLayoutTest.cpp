@@ -0,0 +1,218 @@
+/*
+* Module:   VirtualLayoutTest
+*
+* Function: CVirtualListLayout 与逐行累加的朴素模型对照：随机修改行高、插入和删除行之后，
+*           行位置、总高度、命中测试、可见范围、滚动到指定行和槽位分配都要一致
+*/
+#include "UIVirtualLayout.h"
+#include "TestUtil.h"
+
+#include <stdio.h>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace DuiLib;
+
+// 每次都从第一行累加
+struct NaiveLayout
+{
+    std::vector<int> heights;
+    int spacing;
+
+    int Top(int iIndex) const
+    {
+        int y = 0;
+        for (int i = 0; i < iIndex; ++i)
+            y += heights[i] + spacing;
+        return y;
+    }
+
+    int Total() const
+    {
+        return heights.empty() ? 0 : Top(static_cast<int>(heights.size())) - spacing;
+    }
+
+    void VisibleRange(int nScrollPos, int cyViewport, int& iFirst, int& iLast) const
+    {
+        iFirst = iLast = -1;
+        for (int i = 0; i < static_cast<int>(heights.size()); ++i)
+        {
+            const int top = Top(i);
+            const int bottom = top + heights[i];
+            if (bottom > nScrollPos && top < nScrollPos + cyViewport)
+            {
+                if (iFirst < 0)
+                    iFirst = i;
+                iLast = i;
+            }
+        }
+    }
+};
+
+static void CheckAgainstModel(CVirtualListLayout& layout, const NaiveLayout& model, std::mt19937& rng)
+{
+    const int nCount = static_cast<int>(model.heights.size());
+    const int nTotal = model.Total();
+    TEST_CHECK(layout.GetCount() == nCount);
+    TEST_CHECK(layout.GetTotalHeight() == nTotal);
+    for (int i = 0; i <= nCount; ++i)
+        TEST_CHECK(layout.GetRowTop(i) == model.Top(i));
+    for (int i = 0; i < nCount; ++i)
+        TEST_CHECK(layout.GetRowHeight(i) == model.heights[i]);
+
+    // 落在间距里的纵坐标属于上面的行
+    for (int y = 0; y < nTotal; ++y)
+    {
+        const int row = layout.HitTest(y);
+        TEST_CHECK(row >= 0 && row < nCount);
+        TEST_CHECK(model.Top(row) <= y && (row == nCount - 1 || y < model.Top(row + 1)));
+    }
+    TEST_CHECK(layout.HitTest(-1) == -1);
+    TEST_CHECK(layout.HitTest(nTotal) == -1);
+
+    const int nScrollPos = nTotal > 0 ? static_cast<int>(rng() % nTotal) : 0;
+    const int cyViewport = static_cast<int>(rng() % 100) + 1;
+    int iFirst, iLast, iExpectedFirst, iExpectedLast;
+    layout.GetVisibleRange(nScrollPos, cyViewport, iFirst, iLast);
+    model.VisibleRange(nScrollPos, cyViewport, iExpectedFirst, iExpectedLast);
+    if (iExpectedFirst >= 0)
+    {
+        TEST_CHECK(iFirst == iExpectedFirst && iLast == iExpectedLast);
+    }
+    else if (iFirst >= 0)
+    {
+        // 视口整个落在间距里时给出间距下面的那一行
+        TEST_CHECK(iFirst == iLast && iFirst > 0 && iFirst < nCount);
+        TEST_CHECK(model.Top(iFirst) - model.spacing <= nScrollPos && model.Top(iFirst) >= nScrollPos + cyViewport);
+    }
+
+    if (nCount > 0)
+    {
+        const int iRow = static_cast<int>(rng() % nCount);
+        const int nPos = layout.GetScrollPosToShow(iRow, nScrollPos, cyViewport);
+        const int nMaxPos = nTotal > cyViewport ? nTotal - cyViewport : 0;
+        TEST_CHECK(nPos >= 0 && nPos <= nMaxPos);
+        const int top = model.Top(iRow);
+        const int bottom = top + model.heights[iRow];
+        if (model.heights[iRow] <= cyViewport)
+            TEST_CHECK(top >= nPos && bottom <= nPos + cyViewport);
+    }
+
+    // 可见的每一行恰好有一个槽位，槽位与行互相对应
+    std::vector<int> aRebind;
+    layout.AssignSlots(iFirst, iLast, aRebind);
+    if (iFirst >= 0)
+    {
+        std::set<int> rows;
+        for (int s = 0; s < layout.GetSlotCount(); ++s)
+        {
+            const int row = layout.GetSlotRow(s);
+            if (row < 0)
+                continue;
+            TEST_CHECK(row >= iFirst && row <= iLast);
+            TEST_CHECK(rows.insert(row).second);
+        }
+        TEST_CHECK(static_cast<int>(rows.size()) == iLast - iFirst + 1);
+        for (int i = iFirst; i <= iLast; ++i)
+            TEST_CHECK(layout.GetSlotRow(layout.FindSlot(i)) == i);
+        for (size_t k = 0; k < aRebind.size(); ++k)
+            TEST_CHECK(layout.GetSlotRow(aRebind[k]) >= iFirst);
+    }
+}
+
+static void TestMatchesModel()
+{
+    std::mt19937 rng(1);
+    for (int round = 0; round < 40; ++round)
+    {
+        int nCount = static_cast<int>(rng() % 60);
+        const int cyItem = static_cast<int>(rng() % 20) + 1;
+        const int cySpacing = static_cast<int>(rng() % 4);
+        const bool bEstimated = round % 2 != 0;
+
+        CVirtualListLayout layout;
+        layout.SetItemHeight(cyItem, bEstimated);
+        layout.SetSpacing(cySpacing);
+        layout.Reset(nCount);
+        NaiveLayout model;
+        model.heights.assign(nCount, cyItem);
+        model.spacing = cySpacing;
+
+        for (int op = 0; op < 200; ++op)
+        {
+            const unsigned int action = rng() % 5;
+            if (action == 0 && nCount > 0)
+            {
+                const int iRow = static_cast<int>(rng() % nCount);
+                const int cy = static_cast<int>(rng() % 40) + 1;
+                const bool bChanged = layout.SetRowHeight(iRow, cy);
+                // 固定行高时忽略
+                if (bEstimated)
+                {
+                    TEST_CHECK(bChanged == (model.heights[iRow] != cy));
+                    TEST_CHECK(layout.IsRowMeasured(iRow));
+                    model.heights[iRow] = cy;
+                }
+                else
+                {
+                    TEST_CHECK(!bChanged);
+                }
+            }
+            else if (action == 1)
+            {
+                const int iRow = static_cast<int>(rng() % (nCount + 1));
+                const int nAdd = static_cast<int>(rng() % 3) + 1;
+                layout.InsertRows(iRow, nAdd);
+                model.heights.insert(model.heights.begin() + iRow, nAdd, cyItem);
+                nCount += nAdd;
+            }
+            else if (action == 2 && nCount > 0)
+            {
+                const int iRow = static_cast<int>(rng() % nCount);
+                int nRemove = static_cast<int>(rng() % 3) + 1;
+                if (nRemove > nCount - iRow)
+                    nRemove = nCount - iRow;
+                layout.RemoveRows(iRow, nRemove);
+                model.heights.erase(model.heights.begin() + iRow, model.heights.begin() + iRow + nRemove);
+                nCount -= nRemove;
+            }
+            CheckAgainstModel(layout, model, rng);
+        }
+    }
+}
+
+static void TestScrollSweep()
+{
+    // 10 万行估计行高，边滚动边测量：绑定过的行高度变化，槽位数只取决于视口
+    const int nCount = 100000;
+    CVirtualListLayout layout;
+    layout.SetItemHeight(24, true);
+    layout.SetSpacing(1);
+    layout.Reset(nCount);
+    const int cyViewport = 600;
+    std::vector<int> aRebind;
+    for (int nPos = 0; nPos < layout.GetTotalHeight(); nPos += 97)
+    {
+        int iFirst, iLast;
+        layout.GetVisibleRange(nPos, cyViewport, iFirst, iLast);
+        TEST_CHECK(iFirst >= 0 && iLast >= iFirst);
+        layout.AssignSlots(iFirst, iLast, aRebind);
+        for (size_t k = 0; k < aRebind.size(); ++k)
+        {
+            const int row = layout.GetSlotRow(aRebind[k]);
+            layout.SetRowHeight(row, 20 + row % 17);
+        }
+    }
+    TEST_CHECK(layout.GetSlotCount() <= cyViewport / 20 + 2);
+    TEST_CHECK(layout.HitTest(layout.GetTotalHeight() - 1) == nCount - 1);
+    TEST_CHECK(layout.GetRowTop(nCount) == layout.GetTotalHeight() + 1);
+}
+
+int main()
+{
+    TestMatchesModel();
+    TestScrollSweep();
+    printf("VirtualLayoutTest passed\n");
+    return 0;
+}
@@ -0,0 +1,355 @@
+/*
+* Module:   ZipResourceTest
+*
+* Function: CZipResource 与参考实现对照：用 zlib 压缩生成 zip（stored、各级别和各策略的 deflate、
+*           大小写重名、前置数据、注释），查找结果与 FindZipItem(ic = true) 的顺序查找一致，
+*           读出的数据与原始数据一致；并发读取和预取下 LRU 不超过上限；损坏的 zip 不能崩溃
+*
+*           unzip.cpp 依赖 Windows 头文件，这里用它的查找规则（按中央目录顺序、ASCII 忽略大小写、取第一个）
+*           作为参考模型，解压结果以 zlib 的输入为准
+*/
+#include "ZipResource.h"
+#include "TestUtil.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SourceEntry
+{
+    std::string name;
+    std::string data;
+    uint16_t method;
+};
+
+static void Put16(std::string& out, uint32_t value)
+{
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+
+static void Put32(std::string& out, uint32_t value)
+{
+    Put16(out, value & 0xFFFF);
+    Put16(out, value >> 16);
+}
+
+// level/strategy 不同时 zlib 会产生 stored、固定哈夫曼和动态哈夫曼块
+static std::string Deflate(const std::string& data, int level, int strategy)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    TEST_CHECK(deflateInit2(&stream, level, Z_DEFLATED, -15, 8, strategy) == Z_OK);
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    TEST_CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+static std::string BuildZip(const std::vector<SourceEntry>& entries, const std::string& prefix, const std::string& comment, std::mt19937& rng)
+{
+    static const int kStrategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED };
+
+    std::string zip = prefix;
+    std::string directory;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const SourceEntry& entry = entries[i];
+        const uint32_t crc = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(entry.data.data()), static_cast<uInt>(entry.data.size())));
+        const std::string payload = entry.method == 0 ? entry.data : Deflate(entry.data, static_cast<int>(rng() % 10), kStrategies[rng() % 5]);
+        // 本地头的扩展字段与中央目录不同，偏移要以本地头为准
+        const std::string localExtra(rng() % 3 == 0 ? 8 : 0, '\0');
+        // 偏移相对于 zip 本身，不含前置数据
+        const uint32_t localOffset = static_cast<uint32_t>(zip.size() - prefix.size());
+
+        Put32(zip, 0x04034B50);
+        Put16(zip, 20);
+        Put16(zip, 0);
+        Put16(zip, entry.method);
+        Put32(zip, 0);
+        Put32(zip, crc);
+        Put32(zip, static_cast<uint32_t>(payload.size()));
+        Put32(zip, static_cast<uint32_t>(entry.data.size()));
+        Put16(zip, static_cast<uint32_t>(entry.name.size()));
+        Put16(zip, static_cast<uint32_t>(localExtra.size()));
+        zip += entry.name;
+        zip += localExtra;
+        zip += payload;
+
+        Put32(directory, 0x02014B50);
+        Put16(directory, 20);
+        Put16(directory, 20);
+        Put16(directory, 0);
+        Put16(directory, entry.method);
+        Put32(directory, 0);
+        Put32(directory, crc);
+        Put32(directory, static_cast<uint32_t>(payload.size()));
+        Put32(directory, static_cast<uint32_t>(entry.data.size()));
+        Put16(directory, static_cast<uint32_t>(entry.name.size()));
+        Put16(directory, 0);
+        Put16(directory, 0);
+        Put16(directory, 0);
+        Put16(directory, 0);
+        Put32(directory, 0);
+        Put32(directory, localOffset);
+        directory += entry.name;
+    }
+
+    const uint32_t directoryOffset = static_cast<uint32_t>(zip.size() - prefix.size());
+    zip += directory;
+    Put32(zip, 0x06054B50);
+    Put16(zip, 0);
+    Put16(zip, 0);
+    Put16(zip, static_cast<uint32_t>(entries.size()));
+    Put16(zip, static_cast<uint32_t>(entries.size()));
+    Put32(zip, static_cast<uint32_t>(directory.size()));
+    Put32(zip, directoryOffset);
+    Put16(zip, static_cast<uint32_t>(comment.size()));
+    zip += comment;
+    return zip;
+}
+
+static std::string MakeData(std::mt19937& rng)
+{
+    static const size_t kSizes[] = { 0, 1, 10, 1000, 50000, 300000 };
+    const size_t size = kSizes[rng() % 6];
+    std::string data(size, '\0');
+    switch (rng() % 4)
+    {
+    case 0:
+        for (size_t i = 0; i < size; ++i)
+            data[i] = static_cast<char>(rng());
+        break;
+    case 1:
+        for (size_t i = 0; i < size; ++i)
+            data[i] = "abcdef"[rng() % 6];
+        break;
+    case 2:
+    {
+        const std::string line = "<Window size=\"800,600\"><Button name=\"btn\" /></Window>\r\n";
+        for (size_t i = 0; i < size; ++i)
+            data[i] = line[i % line.size()];
+        break;
+    }
+    default:
+        break;
+    }
+    return data;
+}
+
+static std::vector<SourceEntry> MakeEntries(std::mt19937& rng)
+{
+    static const char* const kDirs[] = { "skin/", "img/", "Skin/Sub/", "", "res/\xE4\xB8\xAD/" };
+    static const char* const kExts[] = { "xml", "png", "PNG" };
+
+    std::vector<SourceEntry> entries(1 + rng() % 120);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        SourceEntry& entry = entries[i];
+        if (i > 0 && rng() % 20 == 0)
+        {
+            // 只有大小写不同的重名条目，查找时应返回前面那个
+            entry.name = entries[rng() % i].name;
+            for (size_t k = 0; k < entry.name.size(); ++k)
+                entry.name[k] = static_cast<char>(toupper(static_cast<unsigned char>(entry.name[k])));
+        }
+        else
+        {
+            entry.name = std::string(kDirs[rng() % 5]) + "file" + std::to_string(rng() % 400) + "." + kExts[rng() % 3];
+        }
+        entry.data = MakeData(rng);
+        entry.method = rng() % 2 == 0 ? 0 : 8;
+    }
+    return entries;
+}
+
+// FindZipItem(ic = true)：按中央目录顺序比较，ASCII 忽略大小写，返回第一个匹配
+static int ReferenceFind(const std::vector<SourceEntry>& entries, const std::string& name)
+{
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const std::string& other = entries[i].name;
+        if (other.size() != name.size())
+            continue;
+        size_t k = 0;
+        while (k < name.size() && tolower(static_cast<unsigned char>(other[k])) == tolower(static_cast<unsigned char>(name[k])))
+            ++k;
+        if (k == name.size())
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+static void CheckArchive(CZipResource& zip, const std::vector<SourceEntry>& entries)
+{
+    TEST_CHECK(zip.GetEntryCount() == entries.size());
+
+    std::vector<std::string> probes;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        std::string upper = entries[i].name;
+        std::string lower = entries[i].name;
+        for (size_t k = 0; k < upper.size(); ++k)
+        {
+            upper[k] = static_cast<char>(toupper(static_cast<unsigned char>(upper[k])));
+            lower[k] = static_cast<char>(tolower(static_cast<unsigned char>(lower[k])));
+        }
+        probes.push_back(entries[i].name);
+        probes.push_back(upper);
+        probes.push_back(lower);
+        probes.push_back(entries[i].name + "x");
+    }
+    probes.push_back("missing.xml");
+    probes.push_back("");
+
+    // 第二遍读 deflate 条目时应当命中 LRU
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (size_t i = 0; i < probes.size(); ++i)
+        {
+            const int expected = ReferenceFind(entries, probes[i]);
+            CZipResource::EntryInfo info;
+            const bool found = zip.Find(probes[i].c_str(), &info);
+            TEST_CHECK(found == (expected >= 0));
+            if (!found)
+            {
+                CZipResource::Item item;
+                TEST_CHECK(!zip.Read(probes[i].c_str(), item));
+                continue;
+            }
+            const SourceEntry& source = entries[expected];
+            TEST_CHECK(info.index == static_cast<uint32_t>(expected));
+            TEST_CHECK(info.method == source.method);
+            TEST_CHECK(info.uncompressedSize == source.data.size());
+
+            CZipResource::Item item;
+            TEST_CHECK(zip.Read(probes[i].c_str(), item));
+            TEST_CHECK(item.size == source.data.size());
+            TEST_CHECK(item.size == 0 || memcmp(item.data, source.data.data(), item.size) == 0);
+            TEST_CHECK((source.method == 0) == !item.holder);
+        }
+    }
+}
+
+static void TestMatchesReference()
+{
+    std::mt19937 rng(7);
+    for (int round = 0; round < 8; ++round)
+    {
+        const std::vector<SourceEntry> entries = MakeEntries(rng);
+        std::string prefix;
+        if (round % 4 == 1)
+        {
+            // 自解压程序之类的前置数据
+            prefix = "MZ";
+            for (int i = 0; i < 5000; ++i)
+                prefix.push_back(static_cast<char>(rng()));
+        }
+        const std::string comment(round % 3 == 0 ? rng() % 900 : 0, 'x');
+        const std::string data = BuildZip(entries, prefix, comment, rng);
+
+        CZipResource::Config config;
+        config.cacheBytes = round % 2 != 0 ? 200000 : 16 * 1024 * 1024;
+        config.workerCount = round % 3;
+        CZipResource zip(config);
+        if (round % 2 != 0)
+        {
+            const std::string path = "ZipResourceTest.zip";
+            FILE* file = fopen(path.c_str(), "wb");
+            TEST_CHECK(file != NULL);
+            TEST_CHECK(fwrite(data.data(), 1, data.size(), file) == data.size());
+            fclose(file);
+            TEST_CHECK(zip.Open(path.c_str()));
+        }
+        else
+        {
+            TEST_CHECK(zip.Open(data.data(), data.size()));
+        }
+        CheckArchive(zip, entries);
+
+        // 预取与多个线程读取交错进行，结果不变，缓存不超过上限
+        std::vector<std::string> names;
+        for (size_t i = 0; i < entries.size(); ++i)
+            names.push_back(entries[i].name);
+        zip.Prefetch(names);
+        std::vector<std::thread> threads;
+        bool failed[6] = {};
+        for (int t = 0; t < 6; ++t)
+        {
+            threads.push_back(std::thread([&, t]() {
+                for (size_t i = t; i < entries.size(); ++i)
+                {
+                    const int expected = ReferenceFind(entries, entries[i].name);
+                    CZipResource::Item item;
+                    if (!zip.Read(entries[i].name.c_str(), item) || item.size != entries[expected].data.size() ||
+                        (item.size != 0 && memcmp(item.data, entries[expected].data.data(), item.size) != 0))
+                    {
+                        failed[t] = true;
+                    }
+                    if (i % 7 == 0)
+                        zip.Prefetch(std::vector<std::string>(1, names[(i * 13) % names.size()]));
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); ++t)
+            threads[t].join();
+        zip.WaitIdle();
+        for (int t = 0; t < 6; ++t)
+            TEST_CHECK(!failed[t]);
+        TEST_CHECK(zip.GetStats().cachedBytes <= config.cacheBytes);
+    }
+}
+
+static void TestCorruptArchives()
+{
+    std::mt19937 rng(11);
+    std::vector<SourceEntry> entries = MakeEntries(rng);
+    // 每轮都要把所有条目解压一遍，数据量控制在几十 KB
+    if (entries.size() > 20)
+        entries.resize(20);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (entries[i].data.size() > 4096)
+            entries[i].data.resize(4096);
+    }
+    const std::string data = BuildZip(entries, "", "", rng);
+
+    // 截断、随机翻转位：Open 可以失败，成功时每个条目的读取都不能越界
+    for (int k = 0; k < 2000; ++k)
+    {
+        std::string damaged = data;
+        const int flips = 1 + rng() % 8;
+        for (int j = 0; j < flips; ++j)
+            damaged[rng() % damaged.size()] ^= static_cast<char>(1 << (rng() % 8));
+        if (k % 5 == 0)
+            damaged.resize(rng() % damaged.size());
+
+        CZipResource zip;
+        if (!zip.Open(damaged.data(), damaged.size()))
+            continue;
+        for (uint32_t i = 0; i < zip.GetEntryCount(); ++i)
+        {
+            CZipResource::Item item;
+            if (zip.ReadAt(i, item) && item.size != 0)
+                TEST_CHECK(item.data != NULL);
+        }
+    }
+}
+
+int main()
+{
+    TestMatchesReference();
+    TestCorruptArchives();
+    printf("ZipResourceTest passed\n");
+    return 0;
+}
@@ -0,0 +1,328 @@
+/*
+* Module:   LogDecoder
+*
+* Function: 把 CAsyncLogger 写出的二进制日志（*.binlog）还原成文本日志
+*
+*    1. 用法：LogDecoder <input.binlog> [output.log]，不指定输出时写到同目录同名 .log，output 为 - 时输出到标准输出。
+*    2. 输出为 UTF-8 文本，每行格式与文本日志一致。
+*    3. 二进制日志中的宽字符按写入端的 wchar_t 宽度存储，Windows 写的日志可以在其他平台解码，反之亦然。
+*
+*    只依赖 Common/util/LogFormat.cpp，其他平台：g++ -std=c++11 -I../../Common/util LogDecoder.cpp ../../Common/util/LogFormat.cpp
+*/
+#include "LogFormat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#ifdef _WIN32
+typedef std::wstring DecoderPath;
+#define DECODER_TEXT(str)   L##str
+#else
+typedef std::string DecoderPath;
+#define DECODER_TEXT(str)   str
+#endif
+
+struct DecodedSite
+{
+    int level;
+    int line;
+    std::string file;
+    std::string function;
+    std::wstring format;
+};
+
+static FILE* OpenFile(const DecoderPath& path, bool bWrite)
+{
+#ifdef _WIN32
+    return ::_wfopen(path.c_str(), bWrite ? L"wb" : L"rb");
+#else
+    return ::fopen(path.c_str(), bWrite ? "wb" : "rb");
+#endif
+}
+
+static bool ReadAll(const DecoderPath& path, std::vector<uint8_t>& data)
+{
+    FILE* file = OpenFile(path, false);
+    if (file == NULL)
+        return false;
+
+    uint8_t buffer[64 * 1024];
+    size_t count = 0;
+    while ((count = ::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+    ::fclose(file);
+    return true;
+}
+
+// 读取 count 个宽度为 unitSize 的字符，转换成本平台的 wchar_t
+static void ReadWideUnits(const uint8_t* data, size_t count, unsigned int unitSize, std::wstring& out)
+{
+    std::vector<uint32_t> codePoints;
+    codePoints.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (unitSize == 2)
+        {
+            uint16_t unit = 0;
+            memcpy(&unit, data + i * 2, 2);
+            uint16_t low = 0;
+            if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < count
+                && (memcpy(&low, data + (i + 1) * 2, 2), low >= 0xDC00 && low <= 0xDFFF))
+            {
+                codePoints.push_back(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                ++i;
+            }
+            else
+            {
+                codePoints.push_back(unit);
+            }
+        }
+        else
+        {
+            uint32_t unit = 0;
+            memcpy(&unit, data + i * 4, 4);
+            codePoints.push_back(unit);
+        }
+    }
+
+    for (size_t i = 0; i < codePoints.size(); ++i)
+    {
+        uint32_t cp = codePoints[i];
+        if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(static_cast<wchar_t>(cp));
+        }
+    }
+}
+
+// 参数区中的宽字符串按写入端宽度存储，宽度不同时转换成本平台的 wchar_t
+static bool ConvertArgs(const uint8_t* data, size_t size, unsigned int unitSize, std::vector<uint8_t>& out)
+{
+    out.clear();
+    size_t pos = 0;
+    while (pos < size)
+    {
+        uint8_t tag = data[pos];
+        if (tag == kLogArgWide || tag == kLogArgNarrow)
+        {
+            uint32_t len = 0;
+            if (pos + 1 + sizeof(len) > size)
+                return false;
+            memcpy(&len, data + pos + 1, sizeof(len));
+            size_t bytes = len * (tag == kLogArgWide ? unitSize : 1);
+            if (pos + 1 + sizeof(len) + bytes > size)
+                return false;
+
+            const uint8_t* value = data + pos + 1 + sizeof(len);
+            if (tag == kLogArgWide && unitSize != sizeof(wchar_t))
+            {
+                std::wstring str;
+                ReadWideUnits(value, len, unitSize, str);
+                uint32_t newLen = static_cast<uint32_t>(str.size());
+                out.push_back(tag);
+                out.insert(out.end(), reinterpret_cast<const uint8_t*>(&newLen), reinterpret_cast<const uint8_t*>(&newLen) + sizeof(newLen));
+                out.insert(out.end(), reinterpret_cast<const uint8_t*>(str.data()), reinterpret_cast<const uint8_t*>(str.data() + str.size()));
+            }
+            else
+            {
+                out.insert(out.end(), data + pos, value + bytes);
+            }
+            pos += 1 + sizeof(len) + bytes;
+        }
+        else
+        {
+            if (pos + 1 + 8 > size)
+                return false;
+            out.insert(out.end(), data + pos, data + pos + 1 + 8);
+            pos += 1 + 8;
+        }
+    }
+    return true;
+}
+
+static void AppendUtf8(std::string& out, const std::wstring& text)
+{
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        uint32_t cp = static_cast<uint32_t>(text[i]);
+        if (sizeof(wchar_t) == 2 && cp >= 0xD800 && cp <= 0xDBFF && i + 1 < text.size())
+        {
+            uint32_t low = static_cast<uint32_t>(text[i + 1]);
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+
+        if (cp < 0x80)
+        {
+            out.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+}
+
+// 解码整个文件，遇到截断的条目时停止（进程崩溃时最后一条可能不完整）
+static bool Decode(const std::vector<uint8_t>& data, std::string& out, size_t& recordCount)
+{
+    LogFileHeader header;
+    if (data.size() < sizeof(header))
+        return false;
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != kLogFileMagic || header.version != kLogFileVersion
+        || (header.wcharSize != 2 && header.wcharSize != 4))
+    {
+        return false;
+    }
+
+    const unsigned int unitSize = header.wcharSize;
+    size_t pos = sizeof(header);
+    if (pos + header.moduleNameChars * unitSize > data.size())
+        return false;
+    std::wstring moduleName;
+    ReadWideUnits(data.data() + pos, header.moduleNameChars, unitSize, moduleName);
+    pos += header.moduleNameChars * unitSize;
+
+    std::unordered_map<uint32_t, DecodedSite> sites;
+    std::vector<uint8_t> args;
+    std::wstring line;
+    recordCount = 0;
+    while (pos + sizeof(LogFileEntryHeader) <= data.size())
+    {
+        LogFileEntryHeader entryHeader;
+        memcpy(&entryHeader, data.data() + pos, sizeof(entryHeader));
+        if (entryHeader.size < sizeof(entryHeader) || pos + entryHeader.size > data.size())
+            break;
+        const uint8_t* entry = data.data() + pos;
+        pos += entryHeader.size;
+
+        line.clear();
+        if (entryHeader.type == kLogEntrySite && entryHeader.size >= sizeof(LogFileSiteEntry))
+        {
+            LogFileSiteEntry siteEntry;
+            memcpy(&siteEntry, entry, sizeof(siteEntry));
+            if (sizeof(siteEntry) + siteEntry.fileChars + siteEntry.functionChars + siteEntry.formatChars * unitSize > entryHeader.size)
+                continue;
+
+            const char* text = reinterpret_cast<const char*>(entry + sizeof(siteEntry));
+            DecodedSite& site = sites[siteEntry.siteId];
+            site.level = siteEntry.level;
+            site.line = siteEntry.line;
+            site.file.assign(text, siteEntry.fileChars);
+            site.function.assign(text + siteEntry.fileChars, siteEntry.functionChars);
+            site.format.clear();
+            ReadWideUnits(entry + sizeof(siteEntry) + siteEntry.fileChars + siteEntry.functionChars, siteEntry.formatChars, unitSize, site.format);
+        }
+        else if (entryHeader.type == kLogEntryRecord && entryHeader.size >= sizeof(LogFileRecordEntry))
+        {
+            LogFileRecordEntry recordEntry;
+            memcpy(&recordEntry, entry, sizeof(recordEntry));
+            std::unordered_map<uint32_t, DecodedSite>::const_iterator it = sites.find(recordEntry.siteId);
+            if (it == sites.end())
+                continue;
+            if (!ConvertArgs(entry + sizeof(recordEntry), entryHeader.size - sizeof(recordEntry), unitSize, args))
+                continue;
+
+            const DecodedSite& site = it->second;
+            LogLineInfo info = { moduleName.c_str(), header.processId, recordEntry.threadId, recordEntry.timestamp,
+                site.level, site.file.c_str(), site.function.c_str(), site.line };
+            LogAppendLine(line, info, site.format.c_str(), args.empty() ? NULL : args.data(), args.size());
+            ++recordCount;
+        }
+        else if (entryHeader.type == kLogEntryDropped && entryHeader.size >= sizeof(LogFileDroppedEntry))
+        {
+            LogFileDroppedEntry droppedEntry;
+            memcpy(&droppedEntry, entry, sizeof(droppedEntry));
+            wchar_t buffer[96];
+            int length = ::swprintf(buffer, 96, L"[logger] %llu records dropped, ring buffer full\n",
+                static_cast<unsigned long long>(droppedEntry.count));
+            if (length > 0)
+                line.assign(buffer, static_cast<size_t>(length));
+        }
+        AppendUtf8(out, line);
+    }
+    return true;
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    if (argc < 2)
+    {
+        ::fprintf(stderr, "usage: LogDecoder <input.binlog> [output.log | -]\n");
+        return 1;
+    }
+
+    DecoderPath input(argv[1]);
+    DecoderPath output;
+    if (argc >= 3)
+    {
+        output = argv[2];
+    }
+    else
+    {
+        const DecoderPath extension(DECODER_TEXT(".binlog"));
+        output = input;
+        if (output.size() > extension.size() && output.compare(output.size() - extension.size(), extension.size(), extension) == 0)
+            output.erase(output.size() - extension.size());
+        output.append(DECODER_TEXT(".log"));
+    }
+
+    std::vector<uint8_t> data;
+    if (!ReadAll(input, data))
+    {
+        ::fprintf(stderr, "LogDecoder: cannot read input file\n");
+        return 2;
+    }
+
+    std::string text;
+    size_t recordCount = 0;
+    if (!Decode(data, text, recordCount))
+    {
+        ::fprintf(stderr, "LogDecoder: not a binary log file or unsupported version\n");
+        return 3;
+    }
+
+    FILE* file = (output == DECODER_TEXT("-")) ? stdout : OpenFile(output, true);
+    if (file == NULL)
+    {
+        ::fprintf(stderr, "LogDecoder: cannot write output file\n");
+        return 4;
+    }
+    ::fwrite(text.data(), 1, text.size(), file);
+    if (file != stdout)
+        ::fclose(file);
+
+    ::fprintf(stderr, "LogDecoder: %u records decoded\n", static_cast<unsigned int>(recordCount));
+    return 0;
+}
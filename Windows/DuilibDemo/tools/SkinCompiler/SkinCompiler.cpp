@@ -0,0 +1,454 @@
+/*
+* Module:   SkinCompiler
+*
+* Function: 把 duilib 皮肤 XML 预编译成二进制皮肤（*.xml.skb），格式见 Common/duilib/Core/UISkinBinary.h
+*
+*    1. 用法：SkinCompiler <skin.xml>...，每个输入在同目录生成 <skin.xml>.skb；SkinCompiler -o <output.skb> <skin.xml> 指定输出文件。
+*    2. 运行时 CMarkup::LoadFromFile 发现同名 .skb 且不比 XML 旧时直接映射使用，否则仍解析 XML，所以修改 XML 后要重新编译。
+*    3. 输入按 UTF-8 读取（可带 BOM），与 LoadFromFile 的默认编码一致；解析时保留空白，得到的文档与 CDialogBuilder 从 XML 得到的相同。
+*    4. 属性值为整数列表、"#" 开头的颜色或 true/false 时额外写入转换好的值，节点写入预解析的类别。
+*
+*    只依赖 Core/UIMarkupDom.cpp 和 Core/UISkinBinary.cpp，其他平台：
+*    g++ -std=c++11 -I../../Common/duilib/Core SkinCompiler.cpp ../../Common/duilib/Core/UIMarkupDom.cpp ../../Common/duilib/Core/UISkinBinary.cpp
+*/
+#include "UIMarkupDom.h"
+#include "UISkinBinary.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace DuiLib;
+
+#ifdef _WIN32
+typedef std::wstring CompilerPath;
+#define COMPILER_TEXT(str)  L##str
+#else
+typedef std::string CompilerPath;
+#define COMPILER_TEXT(str)  str
+#endif
+
+typedef std::basic_string<uint16_t> Utf16String;
+
+static FILE* OpenFile(const CompilerPath& path, bool bWrite)
+{
+#ifdef _WIN32
+    return ::_wfopen(path.c_str(), bWrite ? L"wb" : L"rb");
+#else
+    return ::fopen(path.c_str(), bWrite ? "wb" : "rb");
+#endif
+}
+
+static bool ReadAll(const CompilerPath& path, std::vector<char>& data)
+{
+    FILE* file = OpenFile(path, false);
+    if (file == NULL)
+        return false;
+
+    char buffer[64 * 1024];
+    size_t count = 0;
+    while ((count = ::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+    ::fclose(file);
+    return true;
+}
+
+static std::string ToUtf8Path(const CompilerPath& path)
+{
+#ifdef _WIN32
+    std::string out;
+    for (size_t i = 0; i < path.size(); ++i)
+        out.push_back(path[i] < 0x80 ? static_cast<char>(path[i]) : '?');
+    return out;
+#else
+    return path;
+#endif
+}
+
+// 严格的 UTF-8 解码，非法序列返回 false（运行时 MultiByteToWideChar 会把它们换成 U+FFFD，结果无法对应）
+static bool Utf8ToUtf16(const char* text, size_t size, Utf16String& out)
+{
+    out.clear();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+    const unsigned char* end = p + size;
+    while (p < end)
+    {
+        uint32_t cp = *p++;
+        int extra = 0;
+        uint32_t minValue = 0;
+        if (cp < 0x80)
+            extra = 0;
+        else if ((cp & 0xE0) == 0xC0)
+            extra = 1, cp &= 0x1F, minValue = 0x80;
+        else if ((cp & 0xF0) == 0xE0)
+            extra = 2, cp &= 0x0F, minValue = 0x800;
+        else if ((cp & 0xF8) == 0xF0)
+            extra = 3, cp &= 0x07, minValue = 0x10000;
+        else
+            return false;
+
+        if (end - p < extra)
+            return false;
+        for (int i = 0; i < extra; ++i)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+                return false;
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        p += extra;
+        if (cp < minValue || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            return false;
+
+        if (cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            out.push_back(static_cast<uint16_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<uint16_t>(0xDC00 + (cp & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(static_cast<uint16_t>(cp));
+        }
+    }
+    return true;
+}
+
+static bool EqualsNoCase(const char* value, const char* literal)
+{
+    for (; *literal != 0; ++value, ++literal)
+    {
+        char c = *value;
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        if (c != *literal)
+            return false;
+    }
+    return *value == 0;
+}
+
+// 只识别 CDialogBuilder 按 _tcstol/_tcstoul/_tcsicmp 转换时结果确定的写法，其余保持 TYPE_NONE，运行时仍从字符串转换
+static void ClassifyValue(const char* value, CMarkupTypedValue& typed)
+{
+    memset(&typed, 0, sizeof(typed));
+    if (EqualsNoCase(value, "true") || EqualsNoCase(value, "false"))
+    {
+        typed.nType = CMarkupTypedValue::TYPE_BOOL;
+        typed.nCount = 1;
+        typed.aValue[0] = EqualsNoCase(value, "true") ? 1 : 0;
+        return;
+    }
+
+    if (value[0] == '#')
+    {
+        const char* p = value + 1;
+        uint32_t color = 0;
+        int digits = 0;
+        for (; *p != 0; ++p, ++digits)
+        {
+            int nibble = 0;
+            if (*p >= '0' && *p <= '9')
+                nibble = *p - '0';
+            else if (*p >= 'a' && *p <= 'f')
+                nibble = *p - 'a' + 10;
+            else if (*p >= 'A' && *p <= 'F')
+                nibble = *p - 'A' + 10;
+            else
+                return;
+            color = (color << 4) | static_cast<uint32_t>(nibble);
+        }
+        if (digits == 0 || digits > 8)
+            return;
+        typed.nType = CMarkupTypedValue::TYPE_COLOR;
+        typed.nCount = 1;
+        typed.aValue[0] = static_cast<int>(color);
+        return;
+    }
+
+    // 逗号分隔的十进制整数，最多 4 个，每个都在 int 范围内
+    int values[4] = { 0 };
+    unsigned int count = 0;
+    const char* p = value;
+    for (;;)
+    {
+        if (count == 4)
+            return;
+        bool negative = false;
+        if (*p == '-')
+        {
+            negative = true;
+            ++p;
+        }
+        if (*p < '0' || *p > '9')
+            return;
+        long long number = 0;
+        for (; *p >= '0' && *p <= '9'; ++p)
+        {
+            number = number * 10 + (*p - '0');
+            if (number > static_cast<long long>(INT_MAX) + 1)
+                return;
+        }
+        if (negative)
+            number = -number;
+        if (number > INT_MAX || number < INT_MIN)
+            return;
+        values[count++] = static_cast<int>(number);
+        if (*p == 0)
+            break;
+        if (*p != ',')
+            return;
+        ++p;
+    }
+    typed.nType = CMarkupTypedValue::TYPE_INTS;
+    typed.nCount = count;
+    for (unsigned int i = 0; i < count; ++i)
+        typed.aValue[i] = values[i];
+}
+
+class CSkinWriter
+{
+public:
+    CSkinWriter()
+    {
+        m_strings.push_back(0);     // 偏移 0 为空串
+        m_stringOffsets[Utf16String()] = 0;
+    }
+
+    bool Compile(const CMarkupDomA& dom, std::string& error)
+    {
+        for (const CMarkupDomA::Node* pNode = dom.GetRoot(); pNode != NULL; pNode = pNode->pNext)
+        {
+            if (!AddNode(pNode, SKIN_BINARY_NONE, error))
+                return false;
+        }
+        return true;
+    }
+
+    void Write(std::vector<uint8_t>& out) const
+    {
+        SkinBinaryHeader header;
+        memset(&header, 0, sizeof(header));
+        header.nMagic = SKIN_BINARY_MAGIC;
+        header.nVersion = SKIN_BINARY_VERSION;
+        header.nNodeCount = static_cast<uint32_t>(m_nodes.size());
+        header.nAttributeCount = static_cast<uint32_t>(m_attributes.size());
+        header.nNameCount = static_cast<uint32_t>(m_names.size());
+        header.nStringCount = static_cast<uint32_t>(m_strings.size());
+
+        uint32_t offset = sizeof(header);
+        header.nNodeOffset = offset;
+        offset += header.nNodeCount * sizeof(SkinBinaryNode);
+        header.nAttributeOffset = offset;
+        offset += header.nAttributeCount * sizeof(SkinBinaryAttribute);
+        header.nNameOffset = offset;
+        offset += header.nNameCount * sizeof(SkinBinaryName);
+        header.nStringOffset = offset;
+        offset += header.nStringCount * sizeof(uint16_t);
+        header.nFileSize = (offset + 3) & ~3u;
+
+        out.assign(header.nFileSize, 0);
+        memcpy(&out[0], &header, sizeof(header));
+        if (!m_nodes.empty())
+            memcpy(&out[header.nNodeOffset], &m_nodes[0], m_nodes.size() * sizeof(SkinBinaryNode));
+        if (!m_attributes.empty())
+            memcpy(&out[header.nAttributeOffset], &m_attributes[0], m_attributes.size() * sizeof(SkinBinaryAttribute));
+        if (!m_names.empty())
+            memcpy(&out[header.nNameOffset], &m_names[0], m_names.size() * sizeof(SkinBinaryName));
+        memcpy(&out[header.nStringOffset], &m_strings[0], m_strings.size() * sizeof(uint16_t));
+    }
+
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    size_t GetTypedCount() const { return m_typedCount; }
+
+private:
+    bool Convert(const char* text, Utf16String& out, std::string& error)
+    {
+        if (!Utf8ToUtf16(text, strlen(text), out))
+        {
+            error = "invalid UTF-8 near \"";
+            error.append(text, strnlen(text, 40));
+            error += "\"";
+            return false;
+        }
+        return true;
+    }
+
+    bool AddString(const char* text, uint32_t& offset, std::string& error)
+    {
+        Utf16String value;
+        if (!Convert(text, value, error))
+            return false;
+        std::map<Utf16String, uint32_t>::const_iterator it = m_stringOffsets.find(value);
+        if (it != m_stringOffsets.end())
+        {
+            offset = it->second;
+            return true;
+        }
+        offset = static_cast<uint32_t>(m_strings.size());
+        m_strings.insert(m_strings.end(), value.begin(), value.end());
+        m_strings.push_back(0);
+        m_stringOffsets[value] = offset;
+        return true;
+    }
+
+    // 名字按原样（区分大小写）登记，运行时 CMarkupDomT::AddName 会把只有大小写不同的名字合成同一个 id
+    bool AddName(const char* text, uint32_t& index, std::string& error)
+    {
+        Utf16String value;
+        if (!Convert(text, value, error))
+            return false;
+        std::map<Utf16String, uint32_t>::const_iterator it = m_nameIndices.find(value);
+        if (it != m_nameIndices.end())
+        {
+            index = it->second;
+            return true;
+        }
+        uint32_t offset = 0;
+        if (!AddString(text, offset, error))
+            return false;
+        SkinBinaryName name = { offset, static_cast<uint32_t>(value.size()) };
+        index = static_cast<uint32_t>(m_names.size());
+        m_names.push_back(name);
+        m_nameIndices[value] = index;
+        return true;
+    }
+
+    bool AddNode(const CMarkupDomA::Node* pNode, uint32_t parent, std::string& error)
+    {
+        SkinBinaryNode node;
+        memset(&node, 0, sizeof(node));
+        node.nParent = parent;
+        node.nClassId = GetSkinClassId(pNode->pName);
+        if (!AddName(pNode->pName, node.nName, error) || !AddString(pNode->pValue, node.nValue, error))
+            return false;
+        node.nFirstAttribute = static_cast<uint32_t>(m_attributes.size());
+        node.nAttributeCount = pNode->nAttributes;
+        for (unsigned int i = 0; i < pNode->nAttributes; ++i)
+        {
+            const CMarkupDomA::Attribute& source = pNode->pAttributes[i];
+            SkinBinaryAttribute attr;
+            memset(&attr, 0, sizeof(attr));
+            if (!AddName(source.pName, attr.nName, error) || !AddString(source.pValue, attr.nValue, error))
+                return false;
+            ClassifyValue(source.pValue, attr.typed);
+            if (attr.typed.nType != CMarkupTypedValue::TYPE_NONE)
+                ++m_typedCount;
+            m_attributes.push_back(attr);
+        }
+
+        uint32_t index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(node);
+        for (const CMarkupDomA::Node* pChild = pNode->pChild; pChild != NULL; pChild = pChild->pNext)
+        {
+            if (!AddNode(pChild, index, error))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<SkinBinaryNode> m_nodes;
+    std::vector<SkinBinaryAttribute> m_attributes;
+    std::vector<SkinBinaryName> m_names;
+    std::vector<uint16_t> m_strings;
+    std::map<Utf16String, uint32_t> m_stringOffsets;
+    std::map<Utf16String, uint32_t> m_nameIndices;
+    size_t m_typedCount = 0;
+};
+
+static const char* const kParseErrors[] = {
+    "",
+    "Expected start tag",
+    "Error parsing element name",
+    "Expected start-tag closing",
+    "Expected end-tag start",
+    "Unmatched closing tag",
+    "Error parsing attributes",
+    "Expected attribute value",
+    "Unterminated attribute string",
+    "Out of memory",
+};
+
+static bool CompileFile(const CompilerPath& input, const CompilerPath& output)
+{
+    const std::string name = ToUtf8Path(input);
+    std::vector<char> text;
+    if (!ReadAll(input, text))
+    {
+        ::fprintf(stderr, "SkinCompiler: cannot read %s\n", name.c_str());
+        return false;
+    }
+    size_t skip = 0;
+    if (text.size() >= 3 && text[0] == '\xEF' && text[1] == '\xBB' && text[2] == '\xBF')
+        skip = 3;
+    text.push_back(0);
+
+    CMarkupDomA dom;
+    if (!dom.Parse(&text[skip], true))
+    {
+        std::string location(dom.GetErrorLocation() != NULL ? dom.GetErrorLocation() : "");
+        if (location.size() > 40)
+            location.resize(40);
+        ::fprintf(stderr, "SkinCompiler: %s: %s near \"%s\"\n", name.c_str(), kParseErrors[dom.GetError()], location.c_str());
+        return false;
+    }
+
+    CSkinWriter writer;
+    std::string error;
+    if (!writer.Compile(dom, error))
+    {
+        ::fprintf(stderr, "SkinCompiler: %s: %s\n", name.c_str(), error.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    writer.Write(data);
+    FILE* file = OpenFile(output, true);
+    if (file == NULL || ::fwrite(&data[0], 1, data.size(), file) != data.size())
+    {
+        if (file != NULL)
+            ::fclose(file);
+        ::fprintf(stderr, "SkinCompiler: cannot write output for %s\n", name.c_str());
+        return false;
+    }
+    ::fclose(file);
+
+    ::fprintf(stderr, "SkinCompiler: %s: %u nodes, %u typed attributes, %u bytes\n", name.c_str(),
+        static_cast<unsigned int>(writer.GetNodeCount()), static_cast<unsigned int>(writer.GetTypedCount()),
+        static_cast<unsigned int>(data.size()));
+    return true;
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    if (argc < 2)
+    {
+        ::fprintf(stderr, "usage: SkinCompiler <skin.xml>...\n       SkinCompiler -o <output.skb> <skin.xml>\n");
+        return 1;
+    }
+
+    if (CompilerPath(argv[1]) == COMPILER_TEXT("-o"))
+    {
+        if (argc != 4)
+        {
+            ::fprintf(stderr, "SkinCompiler: -o takes exactly one input\n");
+            return 1;
+        }
+        return CompileFile(argv[3], argv[2]) ? 0 : 2;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        CompilerPath input(argv[i]);
+        if (!CompileFile(input, input + COMPILER_TEXT(".skb")))
+            ++failed;
+    }
+    return failed == 0 ? 0 : 2;
+}
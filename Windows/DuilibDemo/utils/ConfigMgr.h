@@ -43,17 +43,9 @@ namespace Config {
 
 
 
-class SubNode
-{
-public:
-    void InsertElement(std::wstring key, std::wstring value)
-    {
-        sub_node.insert(pair<std::wstring, std::wstring>(key, value));
-    }
-    std::map<std::wstring, std::wstring> sub_node;
-};
+class CIniStore;
 
-//INI文件操作类
+//INI文件操作类，解析和写盘由 CIniStore 完成
 class CConfigMgr
 {
 public:
@@ -62,13 +54,11 @@ public:
 public:
     bool GetValue(std::wstring root, std::wstring key, std::wstring& value );			    //由根结点和键获取值
     bool SetValue(std::wstring root, std::wstring key, std::wstring value);	//设置根结点和键获取值
-    int GetSize() { return map_ini.size(); }
-private:
-    int WriteINI();			//写入INI文件
-    void Clear() { map_ini.clear(); }	//清空
-    void Travel();						//遍历打印INI文件
-    int InitReadINI();
+    int GetIntValue(const std::wstring& root, const std::wstring& key, int defaultValue);
+    bool SetIntValue(const std::wstring& root, const std::wstring& key, int value);
+    int GetSize();
+    bool Flush();                                   //立即写入INI文件
 private:
-    std::map<std::wstring, SubNode> map_ini;		//INI文件内容的存储变量
+    CIniStore* m_pStore;                            //INI文件内容的存储引擎
     std::wstring _IncFilePath;                      //文件路径
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "StdAfx.h"
 #include "DataCenter.h"
 #include "ConfigMgr.h"
+#include "SettingsSnapshot.h"
 #include "TrtcUtil.h"
 #include "util/Base.h"
 #include <mutex>
@@ -26,6 +27,12 @@ CDataCenter::CDataCenter()
     ::InitializeCriticalSection(&g_DataCS);//初始化关键代码段对象
     m_pConfigMgr = new CConfigMgr;
 
+    wchar_t szModulePath[MAX_PATH] = { 0 };
+    ::GetModuleFileNameW(NULL, szModulePath, MAX_PATH);
+    std::wstring snapshotPath = szModulePath;
+    snapshotPath = snapshotPath.substr(0, snapshotPath.find_last_of(L'\\')) + L"\\TrtcConfig.dat";
+    m_pSettingsSnapshot = new CSettingsSnapshot(snapshotPath);
+
     VideoResBitrateTable& info1 = m_videoConfigMap[TRTCVideoResolution_120_120];
     info1.init(150, 40, 200);
     VideoResBitrateTable& info2 = m_videoConfigMap[TRTCVideoResolution_160_160];
@@ -73,6 +80,11 @@ CDataCenter::~CDataCenter()
         delete  m_pConfigMgr;
         m_pConfigMgr = nullptr;
     }
+    if (m_pSettingsSnapshot)
+    {
+        delete m_pSettingsSnapshot;
+        m_pSettingsSnapshot = nullptr;
+    }
 }
 
 void CDataCenter::CleanRoomInfo()
@@ -109,215 +121,124 @@ CDataCenter::VideoResBitrateTable CDataCenter::getVideoConfigInfo(int resolution
 
 void CDataCenter::Init()
 {
-    if (m_pConfigMgr->GetSize() == 0)
-    {
-        m_loginInfo._userId = TrtcUtil::genRandomNumString(8);
-        return;
-    }
-    std::wstring id;
-    bool bIdRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_USER_ID, id);
-    if (id.compare(L"") == 0 || !bIdRet)
-        m_loginInfo._userId = TrtcUtil::genRandomNumString(8);
-    else
-        m_loginInfo._userId = Wide2Ansi(id);
-
-    //音视频参数配置
-    std::wstring strParam;
-    bool bRet = false;
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_BITRATE, strParam);
-    if (bRet)
-        m_videoEncParams.videoBitrate = _wtoi(strParam.c_str());
-    else
-        m_videoEncParams.videoBitrate = 550;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_RESOLUTION, strParam);
-    if (bRet)
-        m_videoEncParams.videoResolution = (TRTCVideoResolution)_wtoi(strParam.c_str());
-    else
-        m_videoEncParams.videoResolution = TRTCVideoResolution_640_360;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_FPS, strParam);
-    if (bRet)
-        m_videoEncParams.videoFps = _wtoi(strParam.c_str());
-    else
-        m_videoEncParams.videoFps = 15;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_QUALITY, strParam);
-    if (bRet)
-        m_qosParams.preference = (TRTCVideoQosPreference)_wtoi(strParam.c_str());
-    else
-        m_qosParams.preference = TRTCVideoQosPreferenceClear;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_QUALITY_CONTROL, strParam);
-    if (bRet)
-        m_qosParams.controlMode = (TRTCQosControlMode)_wtoi(strParam.c_str());
-    else
-        m_qosParams.controlMode = TRTCQosControlModeServer;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_APP_SCENE, strParam);
-    if (bRet)
-        m_sceneParams = (TRTCAppScene)_wtoi(strParam.c_str());
-    else
-        m_sceneParams = TRTCAppSceneVideoCall;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_ROLE_TYPE, strParam);
-    if (bRet)
-        m_roleType = (TRTCRoleType)_wtoi(strParam.c_str());
-    else
-        m_roleType = TRTCRoleAnchor;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_BEAUTY_OPEN, strParam);
-    if (bRet)
-        m_beautyConfig._bOpenBeauty = _wtoi(strParam.c_str());
-    else
-        m_beautyConfig._bOpenBeauty = false;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_BEAUTY_STYLE, strParam);
-    if (bRet)
-        m_beautyConfig._beautyStyle = (TRTCBeautyStyle)_wtoi(strParam.c_str());
-    else
-        m_beautyConfig._beautyStyle = TRTCBeautyStyleSmooth;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_BEAUTY_VALUE, strParam);
-    if (bRet)
-        m_beautyConfig._beautyValue = _wtoi(strParam.c_str());
-    else
-        m_beautyConfig._beautyValue = 0;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_WHITE_VALUE, strParam);
-    if (bRet)
-        m_beautyConfig._whiteValue = _wtoi(strParam.c_str());
+    //配置快照只覆盖其中存在的字段，缺失的字段保持成员默认值
+    EngineSettings settings;
+    CollectEngineSettings(settings);
+    if (m_pSettingsSnapshot->Load(settings))
+        ApplyEngineSettings(settings);
+    else if (m_pConfigMgr->GetSize() > 0)
+        ReadEngineConfigFromIni();
     else
-        m_beautyConfig._whiteValue = 0;
+        m_loginInfo._userId.clear();
 
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_RUDDINESS_VALUE, strParam);
-    if (bRet)
-        m_beautyConfig._ruddinessValue = _wtoi(strParam.c_str());
-    else
-        m_beautyConfig._ruddinessValue = 0;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_SET_PUSH_SMALLVIDEO, strParam);
-    if (bRet)
-        m_bPushSmallVideo = _wtoi(strParam.c_str());
-    else
-        m_bPushSmallVideo = false;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_SET_PLAY_SMALLVIDEO, strParam);
-    if (bRet)
-        m_bPlaySmallVideo = _wtoi(strParam.c_str());
-    else
-        m_bPlaySmallVideo = false;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_SET_NETENV_STYLE, strParam);
-    if (bRet)
-        m_nLinkTestServer = _wtoi(strParam.c_str());
-    else
-        m_nLinkTestServer = 0;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_ROOMCALL_STYLE, strParam);
-    if (bRet)
-        m_bPureAudioStyle = _wtoi(strParam.c_str());
-    else
-        m_bPureAudioStyle = false;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_VIDEO_RES_MODE, strParam);
-    if (bRet)
-        m_videoEncParams.resMode = (TRTCVideoResolutionMode)_wtoi(strParam.c_str());
-    else
-        m_videoEncParams.resMode = TRTCVideoResolutionModeLandscape;
-
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_REMOTE_VIDEO_MIRROR, strParam);
-    if (bRet)
-        m_bRemoteVideoMirror = _wtoi(strParam.c_str());
-    else
-        m_bRemoteVideoMirror = false;
+    if (m_loginInfo._userId.empty())
+        m_loginInfo._userId = TrtcUtil::genRandomNumString(8);
+}
 
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_SHOW_AUDIO_VOLUME, strParam);
-    if (bRet)
-        m_bShowAudioVolume = _wtoi(strParam.c_str());
+void CDataCenter::ReadEngineConfigFromIni()
+{
+    std::wstring id;
+    if (m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_USER_ID, id))
+        m_loginInfo._userId = Wide2Ansi(id);
     else
-        m_bShowAudioVolume = false;
+        m_loginInfo._userId.clear();
 
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_CLOUD_MIX_TRANSCODING, strParam);
-    if (bRet)
-        m_bCDNMixTranscoding = _wtoi(strParam.c_str());
-    else
-        m_bCDNMixTranscoding = false;
+    //音视频参数配置
+    m_videoEncParams.videoBitrate = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_BITRATE, 550);
+    m_videoEncParams.videoResolution = (TRTCVideoResolution)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_RESOLUTION, TRTCVideoResolution_640_360);
+    m_videoEncParams.videoFps = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_FPS, 15);
+    m_qosParams.preference = (TRTCVideoQosPreference)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_QUALITY, TRTCVideoQosPreferenceClear);
+    m_qosParams.controlMode = (TRTCQosControlMode)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_QUALITY_CONTROL, TRTCQosControlModeServer);
+    m_sceneParams = (TRTCAppScene)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_APP_SCENE, TRTCAppSceneVideoCall);
+    m_roleType = (TRTCRoleType)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_ROLE_TYPE, TRTCRoleAnchor);
+
+    m_beautyConfig._bOpenBeauty = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_BEAUTY_OPEN, 0) != 0;
+    m_beautyConfig._beautyStyle = (TRTCBeautyStyle)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_BEAUTY_STYLE, TRTCBeautyStyleSmooth);
+    m_beautyConfig._beautyValue = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_BEAUTY_VALUE, 0);
+    m_beautyConfig._whiteValue = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_WHITE_VALUE, 0);
+    m_beautyConfig._ruddinessValue = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_RUDDINESS_VALUE, 0);
+
+    m_bPushSmallVideo = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_SET_PUSH_SMALLVIDEO, 0) != 0;
+    m_bPlaySmallVideo = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_SET_PLAY_SMALLVIDEO, 0) != 0;
+    m_nLinkTestServer = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_SET_NETENV_STYLE, 0);
+    m_bPureAudioStyle = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_ROOMCALL_STYLE, 0) != 0;
+    m_videoEncParams.resMode = (TRTCVideoResolutionMode)m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_VIDEO_RES_MODE, TRTCVideoResolutionModeLandscape);
+    m_bRemoteVideoMirror = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_REMOTE_VIDEO_MIRROR, 0) != 0;
+    m_bShowAudioVolume = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_SHOW_AUDIO_VOLUME, 0) != 0;
+    m_bCDNMixTranscoding = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_CLOUD_MIX_TRANSCODING, 0) != 0;
+    m_micVolume = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_MIC_VOLUME, 100);
+    m_speakerVolume = m_pConfigMgr->GetIntValue(INI_ROOT_KEY, INI_KEY_SPEAKER_VOLUME, 100);
+}
 
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_MIC_VOLUME, strParam);
-    if (bRet)
-        m_micVolume = _wtoi(strParam.c_str());
-    else
-        m_micVolume = 100;
+void CDataCenter::ApplyEngineSettings(const EngineSettings& settings)
+{
+    m_loginInfo._userId = settings.userId;
+
+    m_videoEncParams.videoBitrate = settings.videoBitrate;
+    m_videoEncParams.videoResolution = (TRTCVideoResolution)settings.videoResolution;
+    m_videoEncParams.videoFps = settings.videoFps;
+    m_videoEncParams.resMode = (TRTCVideoResolutionMode)settings.videoResMode;
+    m_qosParams.preference = (TRTCVideoQosPreference)settings.qosPreference;
+    m_qosParams.controlMode = (TRTCQosControlMode)settings.qosControlMode;
+    m_sceneParams = (TRTCAppScene)settings.appScene;
+    m_roleType = (TRTCRoleType)settings.roleType;
+
+    m_beautyConfig._bOpenBeauty = settings.beautyOpen != 0;
+    m_beautyConfig._beautyStyle = (TRTCBeautyStyle)settings.beautyStyle;
+    m_beautyConfig._beautyValue = settings.beautyValue;
+    m_beautyConfig._whiteValue = settings.whiteValue;
+    m_beautyConfig._ruddinessValue = settings.ruddinessValue;
+
+    m_bPushSmallVideo = settings.pushSmallVideo != 0;
+    m_bPlaySmallVideo = settings.playSmallVideo != 0;
+    m_nLinkTestServer = settings.linkTestServer;
+    m_bPureAudioStyle = settings.pureAudioStyle != 0;
+    m_bLocalVideoMirror = settings.localVideoMirror != 0;
+    m_bRemoteVideoMirror = settings.remoteVideoMirror != 0;
+    m_bShowAudioVolume = settings.showAudioVolume != 0;
+    m_bCDNMixTranscoding = settings.cdnMixTranscoding != 0;
+    m_micVolume = settings.micVolume;
+    m_speakerVolume = settings.speakerVolume;
+}
 
-    bRet = m_pConfigMgr->GetValue(INI_ROOT_KEY, INI_KEY_SPEAKER_VOLUME, strParam);
-    if (bRet)
-        m_speakerVolume = _wtoi(strParam.c_str());
-    else
-        m_speakerVolume = 100;
+void CDataCenter::CollectEngineSettings(EngineSettings& settings)
+{
+    memset(&settings, 0, sizeof(settings));
+    strncpy_s(settings.userId, m_loginInfo._userId.c_str(), _TRUNCATE);
+
+    settings.videoBitrate = m_videoEncParams.videoBitrate;
+    settings.videoResolution = m_videoEncParams.videoResolution;
+    settings.videoFps = m_videoEncParams.videoFps;
+    settings.videoResMode = m_videoEncParams.resMode;
+    settings.qosPreference = m_qosParams.preference;
+    settings.qosControlMode = m_qosParams.controlMode;
+    settings.appScene = m_sceneParams;
+    settings.roleType = m_roleType;
+
+    settings.beautyOpen = m_beautyConfig._bOpenBeauty;
+    settings.beautyStyle = m_beautyConfig._beautyStyle;
+    settings.beautyValue = m_beautyConfig._beautyValue;
+    settings.whiteValue = m_beautyConfig._whiteValue;
+    settings.ruddinessValue = m_beautyConfig._ruddinessValue;
+
+    settings.pushSmallVideo = m_bPushSmallVideo;
+    settings.playSmallVideo = m_bPlaySmallVideo;
+    settings.linkTestServer = m_nLinkTestServer;
+    settings.pureAudioStyle = m_bPureAudioStyle;
+    settings.localVideoMirror = m_bLocalVideoMirror;
+    settings.remoteVideoMirror = m_bRemoteVideoMirror;
+    settings.showAudioVolume = m_bShowAudioVolume;
+    settings.cdnMixTranscoding = m_bCDNMixTranscoding;
+    settings.micVolume = m_micVolume;
+    settings.speakerVolume = m_speakerVolume;
 }
 
 void CDataCenter::WriteEngineConfig()
 {
-    //User Info
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_USER_ID, Ansi2Wide(m_loginInfo._userId));
-    //m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_USER_ID, Ansi2Wide(""));
-    //设备选项
-
-    //m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_CHOOSE_MIC, m_selectMic);
-    //m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_CHOOSE_CAMERA, m_selectCamera);
-    //m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_CHOOSE_SPEAK, m_selectSpeak);
-
-    //音视频参数配置
-    DuiLib::CDuiString strFormat;
-    strFormat.Format(L"%d", m_videoEncParams.videoBitrate);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_VIDEO_BITRATE, strFormat.GetData());
-    strFormat.Format(L"%d", m_videoEncParams.videoResolution);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_VIDEO_RESOLUTION, strFormat.GetData());
-    strFormat.Format(L"%d", m_videoEncParams.videoFps);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_VIDEO_FPS, strFormat.GetData());
-    strFormat.Format(L"%d", m_qosParams.preference);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_VIDEO_QUALITY, strFormat.GetData());
-    strFormat.Format(L"%d", m_qosParams.controlMode);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_VIDEO_QUALITY_CONTROL, strFormat.GetData());
-    strFormat.Format(L"%d", m_sceneParams);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_VIDEO_APP_SCENE, strFormat.GetData());
-    strFormat.Format(L"%d", m_roleType);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_ROLE_TYPE, strFormat.GetData());
-
-    strFormat.Format(L"%d", m_beautyConfig._bOpenBeauty);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_BEAUTY_OPEN, strFormat.GetData());
-    strFormat.Format(L"%d", m_beautyConfig._beautyStyle);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_BEAUTY_STYLE, strFormat.GetData());
-    strFormat.Format(L"%d", m_beautyConfig._beautyValue);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_BEAUTY_VALUE, strFormat.GetData());
-    strFormat.Format(L"%d", m_beautyConfig._whiteValue);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_WHITE_VALUE, strFormat.GetData());
-    strFormat.Format(L"%d", m_beautyConfig._ruddinessValue);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_RUDDINESS_VALUE, strFormat.GetData());
-
-    strFormat.Format(L"%d", m_bPushSmallVideo);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_SET_PUSH_SMALLVIDEO, strFormat.GetData());
-    strFormat.Format(L"%d", m_bPlaySmallVideo);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_SET_PLAY_SMALLVIDEO, strFormat.GetData());
-    strFormat.Format(L"%d", m_nLinkTestServer);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_SET_NETENV_STYLE, strFormat.GetData());
-    strFormat.Format(L"%d", m_bPureAudioStyle);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_ROOMCALL_STYLE, strFormat.GetData());
-
-    strFormat.Format(L"%d", m_bLocalVideoMirror);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_LOCAL_VIDEO_MIRROR, strFormat.GetData());
-    strFormat.Format(L"%d", m_bRemoteVideoMirror);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_REMOTE_VIDEO_MIRROR, strFormat.GetData());
-    strFormat.Format(L"%d", m_bShowAudioVolume);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_SHOW_AUDIO_VOLUME, strFormat.GetData());
-    strFormat.Format(L"%d", m_bCDNMixTranscoding);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_CLOUD_MIX_TRANSCODING, strFormat.GetData());
-
-    strFormat.Format(L"%d", m_micVolume);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_MIC_VOLUME, strFormat.GetData());
-    strFormat.Format(L"%d", m_speakerVolume);
-    m_pConfigMgr->SetValue(INI_ROOT_KEY, INI_KEY_SPEAKER_VOLUME, strFormat.GetData());
+    //INI只在迁移时读取，之后配置都写入快照
+    EngineSettings settings;
+    CollectEngineSettings(settings);
+    m_pSettingsSnapshot->Save(settings);
 }
 
 CDataCenter::BeautyConfig & CDataCenter::GetBeautyConfig()
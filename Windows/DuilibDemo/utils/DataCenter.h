@@ -6,6 +6,8 @@
 #include "TRTCCloudDef.h"
 
 class CConfigMgr;
+class CSettingsSnapshot;
+struct EngineSettings;
 
 
 typedef struct _tagRemoteUserInfo
@@ -92,8 +94,12 @@ public:
     std::string getLocalUserID() { return m_loginInfo._userId; };
     VideoResBitrateTable getVideoConfigInfo(int resolution);
 public:
-    void WriteEngineConfig();
+    void WriteEngineConfig();   //写入配置快照，只改写有变化的字段
     BeautyConfig& GetBeautyConfig();
+private:
+    void ReadEngineConfigFromIni(); //没有配置快照时从老版本的INI迁移
+    void ApplyEngineSettings(const EngineSettings& settings);
+    void CollectEngineSettings(EngineSettings& settings);
 public: //trtc 
     std::wstring m_selectSpeak;
     std::wstring m_selectMic;
@@ -145,6 +151,7 @@ public:  //视频窗口信息
     void removeRemoteUser(std::string userId, int streamType = -1);
 public:
     CConfigMgr* m_pConfigMgr;
+    CSettingsSnapshot* m_pSettingsSnapshot;
 
     LocalUserInfo m_loginInfo;
 
@@ -0,0 +1,334 @@
+#include "SettingsSnapshot.h"
+#include "util/AtomicFile.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// header: magic(4) version(2) fieldCount(2) payloadSize(4) crc32(4)
+static const size_t kHeaderSize = 16;
+static const size_t kChecksumOffset = 12;
+// 字段记录: tag(2) size(2) value(size)
+static const size_t kFieldHeaderSize = 4;
+
+struct SettingFieldDesc
+{
+    uint16_t tag;
+    uint16_t offset;
+    uint16_t size;
+};
+
+#define SETTING_FIELD(tag, member) \
+    { tag, static_cast<uint16_t>(offsetof(EngineSettings, member)), static_cast<uint16_t>(sizeof(((EngineSettings*)0)->member)) }
+
+static const SettingFieldDesc kSettingFields[] = {
+    SETTING_FIELD(SettingTag_UserId, userId),
+    SETTING_FIELD(SettingTag_VideoBitrate, videoBitrate),
+    SETTING_FIELD(SettingTag_VideoResolution, videoResolution),
+    SETTING_FIELD(SettingTag_VideoFps, videoFps),
+    SETTING_FIELD(SettingTag_VideoResMode, videoResMode),
+    SETTING_FIELD(SettingTag_QosPreference, qosPreference),
+    SETTING_FIELD(SettingTag_QosControlMode, qosControlMode),
+    SETTING_FIELD(SettingTag_AppScene, appScene),
+    SETTING_FIELD(SettingTag_RoleType, roleType),
+    SETTING_FIELD(SettingTag_BeautyOpen, beautyOpen),
+    SETTING_FIELD(SettingTag_BeautyStyle, beautyStyle),
+    SETTING_FIELD(SettingTag_BeautyValue, beautyValue),
+    SETTING_FIELD(SettingTag_WhiteValue, whiteValue),
+    SETTING_FIELD(SettingTag_RuddinessValue, ruddinessValue),
+    SETTING_FIELD(SettingTag_PushSmallVideo, pushSmallVideo),
+    SETTING_FIELD(SettingTag_PlaySmallVideo, playSmallVideo),
+    SETTING_FIELD(SettingTag_LinkTestServer, linkTestServer),
+    SETTING_FIELD(SettingTag_PureAudioStyle, pureAudioStyle),
+    SETTING_FIELD(SettingTag_LocalVideoMirror, localVideoMirror),
+    SETTING_FIELD(SettingTag_RemoteVideoMirror, remoteVideoMirror),
+    SETTING_FIELD(SettingTag_ShowAudioVolume, showAudioVolume),
+    SETTING_FIELD(SettingTag_CDNMixTranscoding, cdnMixTranscoding),
+    SETTING_FIELD(SettingTag_MicVolume, micVolume),
+    SETTING_FIELD(SettingTag_SpeakerVolume, speakerVolume),
+};
+
+static const size_t kSettingFieldCount = sizeof(kSettingFields) / sizeof(kSettingFields[0]);
+
+static int FindField(uint16_t tag)
+{
+    for (size_t i = 0; i < kSettingFieldCount; ++i)
+    {
+        if (kSettingFields[i].tag == tag)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// CRC-32（多项式 0xEDB88320）查找表，常量数据，多线程同时计算时不需要初始化
+static const uint32_t kCrc32Table[256] = {
+    0x00000000u, 0x77073096u, 0xee0e612cu, 0x990951bau, 0x076dc419u, 0x706af48fu,
+    0xe963a535u, 0x9e6495a3u, 0x0edb8832u, 0x79dcb8a4u, 0xe0d5e91eu, 0x97d2d988u,
+    0x09b64c2bu, 0x7eb17cbdu, 0xe7b82d07u, 0x90bf1d91u, 0x1db71064u, 0x6ab020f2u,
+    0xf3b97148u, 0x84be41deu, 0x1adad47du, 0x6ddde4ebu, 0xf4d4b551u, 0x83d385c7u,
+    0x136c9856u, 0x646ba8c0u, 0xfd62f97au, 0x8a65c9ecu, 0x14015c4fu, 0x63066cd9u,
+    0xfa0f3d63u, 0x8d080df5u, 0x3b6e20c8u, 0x4c69105eu, 0xd56041e4u, 0xa2677172u,
+    0x3c03e4d1u, 0x4b04d447u, 0xd20d85fdu, 0xa50ab56bu, 0x35b5a8fau, 0x42b2986cu,
+    0xdbbbc9d6u, 0xacbcf940u, 0x32d86ce3u, 0x45df5c75u, 0xdcd60dcfu, 0xabd13d59u,
+    0x26d930acu, 0x51de003au, 0xc8d75180u, 0xbfd06116u, 0x21b4f4b5u, 0x56b3c423u,
+    0xcfba9599u, 0xb8bda50fu, 0x2802b89eu, 0x5f058808u, 0xc60cd9b2u, 0xb10be924u,
+    0x2f6f7c87u, 0x58684c11u, 0xc1611dabu, 0xb6662d3du, 0x76dc4190u, 0x01db7106u,
+    0x98d220bcu, 0xefd5102au, 0x71b18589u, 0x06b6b51fu, 0x9fbfe4a5u, 0xe8b8d433u,
+    0x7807c9a2u, 0x0f00f934u, 0x9609a88eu, 0xe10e9818u, 0x7f6a0dbbu, 0x086d3d2du,
+    0x91646c97u, 0xe6635c01u, 0x6b6b51f4u, 0x1c6c6162u, 0x856530d8u, 0xf262004eu,
+    0x6c0695edu, 0x1b01a57bu, 0x8208f4c1u, 0xf50fc457u, 0x65b0d9c6u, 0x12b7e950u,
+    0x8bbeb8eau, 0xfcb9887cu, 0x62dd1ddfu, 0x15da2d49u, 0x8cd37cf3u, 0xfbd44c65u,
+    0x4db26158u, 0x3ab551ceu, 0xa3bc0074u, 0xd4bb30e2u, 0x4adfa541u, 0x3dd895d7u,
+    0xa4d1c46du, 0xd3d6f4fbu, 0x4369e96au, 0x346ed9fcu, 0xad678846u, 0xda60b8d0u,
+    0x44042d73u, 0x33031de5u, 0xaa0a4c5fu, 0xdd0d7cc9u, 0x5005713cu, 0x270241aau,
+    0xbe0b1010u, 0xc90c2086u, 0x5768b525u, 0x206f85b3u, 0xb966d409u, 0xce61e49fu,
+    0x5edef90eu, 0x29d9c998u, 0xb0d09822u, 0xc7d7a8b4u, 0x59b33d17u, 0x2eb40d81u,
+    0xb7bd5c3bu, 0xc0ba6cadu, 0xedb88320u, 0x9abfb3b6u, 0x03b6e20cu, 0x74b1d29au,
+    0xead54739u, 0x9dd277afu, 0x04db2615u, 0x73dc1683u, 0xe3630b12u, 0x94643b84u,
+    0x0d6d6a3eu, 0x7a6a5aa8u, 0xe40ecf0bu, 0x9309ff9du, 0x0a00ae27u, 0x7d079eb1u,
+    0xf00f9344u, 0x8708a3d2u, 0x1e01f268u, 0x6906c2feu, 0xf762575du, 0x806567cbu,
+    0x196c3671u, 0x6e6b06e7u, 0xfed41b76u, 0x89d32be0u, 0x10da7a5au, 0x67dd4accu,
+    0xf9b9df6fu, 0x8ebeeff9u, 0x17b7be43u, 0x60b08ed5u, 0xd6d6a3e8u, 0xa1d1937eu,
+    0x38d8c2c4u, 0x4fdff252u, 0xd1bb67f1u, 0xa6bc5767u, 0x3fb506ddu, 0x48b2364bu,
+    0xd80d2bdau, 0xaf0a1b4cu, 0x36034af6u, 0x41047a60u, 0xdf60efc3u, 0xa867df55u,
+    0x316e8eefu, 0x4669be79u, 0xcb61b38cu, 0xbc66831au, 0x256fd2a0u, 0x5268e236u,
+    0xcc0c7795u, 0xbb0b4703u, 0x220216b9u, 0x5505262fu, 0xc5ba3bbeu, 0xb2bd0b28u,
+    0x2bb45a92u, 0x5cb36a04u, 0xc2d7ffa7u, 0xb5d0cf31u, 0x2cd99e8bu, 0x5bdeae1du,
+    0x9b64c2b0u, 0xec63f226u, 0x756aa39cu, 0x026d930au, 0x9c0906a9u, 0xeb0e363fu,
+    0x72076785u, 0x05005713u, 0x95bf4a82u, 0xe2b87a14u, 0x7bb12baeu, 0x0cb61b38u,
+    0x92d28e9bu, 0xe5d5be0du, 0x7cdcefb7u, 0x0bdbdf21u, 0x86d3d2d4u, 0xf1d4e242u,
+    0x68ddb3f8u, 0x1fda836eu, 0x81be16cdu, 0xf6b9265bu, 0x6fb077e1u, 0x18b74777u,
+    0x88085ae6u, 0xff0f6a70u, 0x66063bcau, 0x11010b5cu, 0x8f659effu, 0xf862ae69u,
+    0x616bffd3u, 0x166ccf45u, 0xa00ae278u, 0xd70dd2eeu, 0x4e048354u, 0x3903b3c2u,
+    0xa7672661u, 0xd06016f7u, 0x4969474du, 0x3e6e77dbu, 0xaed16a4au, 0xd9d65adcu,
+    0x40df0b66u, 0x37d83bf0u, 0xa9bcae53u, 0xdebb9ec5u, 0x47b2cf7fu, 0x30b5ffe9u,
+    0xbdbdf21cu, 0xcabac28au, 0x53b39330u, 0x24b4a3a6u, 0xbad03605u, 0xcdd70693u,
+    0x54de5729u, 0x23d967bfu, 0xb3667a2eu, 0xc4614ab8u, 0x5d681b02u, 0x2a6f2b94u,
+    0xb40bbe37u, 0xc30c8ea1u, 0x5a05df1bu, 0x2d02ef8du,
+};
+
+static uint32_t Crc32(const uint8_t* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+        crc = kCrc32Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static FILE* OpenFile(const SnapshotPath& path, const char* mode)
+{
+#ifdef _WIN32
+    std::wstring wideMode(mode, mode + strlen(mode));
+    FILE* file = NULL;
+    if (::_wfopen_s(&file, path.c_str(), wideMode.c_str()) != 0)
+        return NULL;
+    return file;
+#else
+    return ::fopen(path.c_str(), mode);
+#endif
+}
+
+CSettingsSnapshot::CSettingsSnapshot(const SnapshotPath& path)
+    : m_path(path)
+    , m_bImageValid(false)
+{
+    memset(&m_saved, 0, sizeof(m_saved));
+}
+
+CSettingsSnapshot::~CSettingsSnapshot()
+{
+}
+
+void CSettingsSnapshot::Encode(const EngineSettings& settings, std::vector<uint8_t>& file)
+{
+    size_t payloadSize = 0;
+    for (size_t i = 0; i < kSettingFieldCount; ++i)
+        payloadSize += kFieldHeaderSize + kSettingFields[i].size;
+
+    file.assign(kHeaderSize + payloadSize, 0);
+    uint8_t* cursor = &file[kHeaderSize];
+    for (size_t i = 0; i < kSettingFieldCount; ++i)
+    {
+        const SettingFieldDesc& field = kSettingFields[i];
+        memcpy(cursor, &field.tag, 2);
+        memcpy(cursor + 2, &field.size, 2);
+        memcpy(cursor + kFieldHeaderSize, reinterpret_cast<const uint8_t*>(&settings) + field.offset, field.size);
+        cursor += kFieldHeaderSize + field.size;
+    }
+
+    uint32_t magic = kMagic;
+    uint16_t version = kSchemaVersion;
+    uint16_t fieldCount = static_cast<uint16_t>(kSettingFieldCount);
+    uint32_t payload = static_cast<uint32_t>(payloadSize);
+    uint32_t checksum = Crc32(&file[kHeaderSize], payloadSize);
+    memcpy(&file[0], &magic, 4);
+    memcpy(&file[4], &version, 2);
+    memcpy(&file[6], &fieldCount, 2);
+    memcpy(&file[8], &payload, 4);
+    memcpy(&file[kChecksumOffset], &checksum, 4);
+}
+
+//************************************************************************
+// 函数说明:		校验 header 和 CRC 后按 tag 解码，未知 tag 或长度不符的字段跳过
+// 返 回 值:   	bool	magic、版本或字段数不符，数据截断或校验失败时返回 false，settings 不被修改
+//************************************************************************
+bool CSettingsSnapshot::Decode(const uint8_t* data, size_t size, EngineSettings& settings)
+{
+    if (data == NULL || size < kHeaderSize)
+        return false;
+
+    uint32_t magic = 0, payloadSize = 0, checksum = 0;
+    uint16_t version = 0, fieldCount = 0;
+    memcpy(&magic, data, 4);
+    memcpy(&version, data + 4, 2);
+    memcpy(&fieldCount, data + 6, 2);
+    memcpy(&payloadSize, data + 8, 4);
+    memcpy(&checksum, data + kChecksumOffset, 4);
+    if (magic != kMagic || version == 0 || version > kSchemaVersion || payloadSize > size - kHeaderSize)
+        return false;
+
+    const uint8_t* payload = data + kHeaderSize;
+    if (Crc32(payload, payloadSize) != checksum)
+        return false;
+
+    EngineSettings decoded = settings;
+    size_t pos = 0;
+    size_t recordCount = 0;
+    while (pos + kFieldHeaderSize <= payloadSize)
+    {
+        uint16_t tag = 0, fieldSize = 0;
+        memcpy(&tag, payload + pos, 2);
+        memcpy(&fieldSize, payload + pos + 2, 2);
+        pos += kFieldHeaderSize;
+        if (pos + fieldSize > payloadSize)
+            return false;
+
+        int index = FindField(tag);
+        if (index >= 0 && kSettingFields[index].size == fieldSize)
+            memcpy(reinterpret_cast<uint8_t*>(&decoded) + kSettingFields[index].offset, payload + pos, fieldSize);
+        pos += fieldSize;
+        ++recordCount;
+    }
+    if (pos != payloadSize || recordCount != fieldCount)
+        return false;
+
+    decoded.userId[sizeof(decoded.userId) - 1] = '\0';
+    settings = decoded;
+    return true;
+}
+
+bool CSettingsSnapshot::IndexFields(const uint8_t* data, size_t size)
+{
+    m_fieldOffsets.assign(kSettingFieldCount, 0);
+    uint32_t payloadSize = 0;
+    memcpy(&payloadSize, data + 8, 4);
+
+    size_t pos = kHeaderSize;
+    size_t end = kHeaderSize + payloadSize;
+    while (pos + kFieldHeaderSize <= end && end <= size)
+    {
+        uint16_t tag = 0, fieldSize = 0;
+        memcpy(&tag, data + pos, 2);
+        memcpy(&fieldSize, data + pos + 2, 2);
+        int index = FindField(tag);
+        if (index >= 0 && kSettingFields[index].size == fieldSize)
+            m_fieldOffsets[index] = static_cast<uint32_t>(pos + kFieldHeaderSize);
+        pos += kFieldHeaderSize + fieldSize;
+    }
+
+    for (size_t i = 0; i < kSettingFieldCount; ++i)
+    {
+        if (m_fieldOffsets[i] == 0)
+            return false;
+    }
+    return true;
+}
+
+bool CSettingsSnapshot::Load(EngineSettings& settings)
+{
+    m_bImageValid = false;
+    FILE* file = OpenFile(m_path, "rb");
+    if (file == NULL)
+        return false;
+
+    std::vector<uint8_t> data;
+    if (::fseek(file, 0, SEEK_END) == 0)
+    {
+        long size = ::ftell(file);
+        if (size > 0 && ::fseek(file, 0, SEEK_SET) == 0)
+        {
+            data.resize(static_cast<size_t>(size));
+            if (::fread(&data[0], 1, data.size(), file) != data.size())
+                data.clear();
+        }
+    }
+    ::fclose(file);
+
+    if (!Decode(data.empty() ? NULL : &data[0], data.size(), settings))
+        return false;
+
+    // 文件里缺少某些字段（老版本写入）时，下次 Save 整体重写一次
+    m_bImageValid = IndexFields(&data[0], data.size());
+    m_image.swap(data);
+    m_saved = settings;
+    return true;
+}
+
+bool CSettingsSnapshot::Save(const EngineSettings& settings)
+{
+    if (m_bImageValid && WriteChanged(settings))
+        return true;
+    return WriteAll(settings);
+}
+
+bool CSettingsSnapshot::WriteAll(const EngineSettings& settings)
+{
+    std::vector<uint8_t> image;
+    Encode(settings, image);
+    if (!WriteFileAtomic(m_path, &image[0], image.size()))
+        return false;
+
+    m_image.swap(image);
+    m_bImageValid = IndexFields(&m_image[0], m_image.size());
+    m_saved = settings;
+    return true;
+}
+
+//************************************************************************
+// 函数说明:		在文件镜像中改写变化的字段和 CRC 后整体原子写回（未知字段原样保留），没有变化时不访问文件
+// 返 回 值:   	bool	写入失败时返回 false，由调用方整体重写
+//************************************************************************
+bool CSettingsSnapshot::WriteChanged(const EngineSettings& settings)
+{
+    const uint8_t* newBytes = reinterpret_cast<const uint8_t*>(&settings);
+    const uint8_t* oldBytes = reinterpret_cast<const uint8_t*>(&m_saved);
+
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < kSettingFieldCount; ++i)
+    {
+        const SettingFieldDesc& field = kSettingFields[i];
+        if (memcmp(newBytes + field.offset, oldBytes + field.offset, field.size) != 0)
+            changed.push_back(i);
+    }
+    if (changed.empty())
+        return true;
+
+    for (size_t i = 0; i < changed.size(); ++i)
+    {
+        const SettingFieldDesc& field = kSettingFields[changed[i]];
+        memcpy(&m_image[m_fieldOffsets[changed[i]]], newBytes + field.offset, field.size);
+    }
+    uint32_t payloadSize = 0;
+    memcpy(&payloadSize, &m_image[8], 4);
+    uint32_t checksum = Crc32(&m_image[kHeaderSize], payloadSize);
+    memcpy(&m_image[kChecksumOffset], &checksum, 4);
+
+    if (!WriteFileAtomic(m_path, &m_image[0], m_image.size()))
+    {
+        m_bImageValid = false;
+        return false;
+    }
+
+    m_saved = settings;
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+* Module:   CSettingsSnapshot
+*
+* Function: 引擎配置的二进制快照（TrtcConfig.dat），替代启动时逐项读取 INI
+*
+*    1. 文件格式：SnapshotHeader + 若干 [tag, size, value] 字段记录，header 中带 schema 版本和 payload 的 CRC32。
+*    2. 读取时按 tag 解析，未知 tag 跳过（新版本文件给老版本读），缺失的 tag 保留默认值（老版本文件给新版本读）。
+*       新增字段不升级 kSchemaVersion；只有记录格式本身不兼容时才升级，老版本读到更高版本的文件直接返回 false。
+*    3. 文件格式与当前 schema 一致时，Save 只在内存镜像中改写变化的字段和 CRC，否则重新编码；两种情况都通过 WriteFileAtomic 落盘后 rename。
+*
+*    不依赖 Windows 头文件，可在其他平台编译。
+*/
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+typedef std::wstring SnapshotPath;
+#else
+typedef std::string SnapshotPath;
+#endif
+
+// 字段 tag 一旦发布就不能修改或复用，新增字段只能追加新的 tag
+enum EngineSettingTag
+{
+    SettingTag_UserId = 1,
+    SettingTag_VideoBitrate = 2,
+    SettingTag_VideoResolution = 3,
+    SettingTag_VideoFps = 4,
+    SettingTag_VideoResMode = 5,
+    SettingTag_QosPreference = 6,
+    SettingTag_QosControlMode = 7,
+    SettingTag_AppScene = 8,
+    SettingTag_RoleType = 9,
+    SettingTag_BeautyOpen = 10,
+    SettingTag_BeautyStyle = 11,
+    SettingTag_BeautyValue = 12,
+    SettingTag_WhiteValue = 13,
+    SettingTag_RuddinessValue = 14,
+    SettingTag_PushSmallVideo = 15,
+    SettingTag_PlaySmallVideo = 16,
+    SettingTag_LinkTestServer = 17,
+    SettingTag_PureAudioStyle = 18,
+    SettingTag_LocalVideoMirror = 19,
+    SettingTag_RemoteVideoMirror = 20,
+    SettingTag_ShowAudioVolume = 21,
+    SettingTag_CDNMixTranscoding = 22,
+    SettingTag_MicVolume = 23,
+    SettingTag_SpeakerVolume = 24,
+};
+
+// 持久化的引擎配置，只包含定长字段，直接按字段 memcpy 读写
+struct EngineSettings
+{
+    char userId[64];
+    int32_t videoBitrate;
+    int32_t videoResolution;
+    int32_t videoFps;
+    int32_t videoResMode;
+    int32_t qosPreference;
+    int32_t qosControlMode;
+    int32_t appScene;
+    int32_t roleType;
+    int32_t beautyOpen;
+    int32_t beautyStyle;
+    int32_t beautyValue;
+    int32_t whiteValue;
+    int32_t ruddinessValue;
+    int32_t pushSmallVideo;
+    int32_t playSmallVideo;
+    int32_t linkTestServer;
+    int32_t pureAudioStyle;
+    int32_t localVideoMirror;
+    int32_t remoteVideoMirror;
+    int32_t showAudioVolume;
+    int32_t cdnMixTranscoding;
+    int32_t micVolume;
+    int32_t speakerVolume;
+};
+
+class CSettingsSnapshot
+{
+public:
+    static const uint32_t kMagic = 0x53535254;     // "TRSS"
+    static const uint16_t kSchemaVersion = 1;
+public:
+    explicit CSettingsSnapshot(const SnapshotPath& path);
+    ~CSettingsSnapshot();
+public:
+    // 读取快照，只覆盖文件中存在的字段；文件不存在、版本过高、被截断或校验失败时返回 false
+    bool Load(EngineSettings& settings);
+    // 写入快照，与上次读写的内容比较，只改写变化的字段
+    bool Save(const EngineSettings& settings);
+
+    static void Encode(const EngineSettings& settings, std::vector<uint8_t>& file);
+    static bool Decode(const uint8_t* data, size_t size, EngineSettings& settings);
+private:
+    bool WriteAll(const EngineSettings& settings);
+    bool WriteChanged(const EngineSettings& settings);
+    bool IndexFields(const uint8_t* data, size_t size);
+private:
+    SnapshotPath m_path;
+    std::vector<uint8_t> m_image;           // 文件当前内容
+    std::vector<uint32_t> m_fieldOffsets;   // 每个已知字段的 value 在 m_image 中的偏移，0 表示文件中没有
+    EngineSettings m_saved;                 // m_image 对应的配置
+    bool m_bImageValid;
+};
@@ -1,18 +1,47 @@
+﻿/*
+* Module:   HttpClient
+*
+* Function: 简单的 HTTP 客户端
+*
+*    1. 同一个 HttpClient 内按 host 复用连接（keep-alive），http_close 或析构时才断开。
+*    2. 响应体直接读入调用方的 resp_data，不再按块分配临时缓冲。
+*    3. http_get_async / http_post_async 在内部工作线程执行请求，完成后在工作线程回调。
+*
+*    Windows 上使用 WinHttp；其他平台使用 socket 实现（仅支持 http，用于本地测试）。
+*/
 #ifndef __HTTPCLIENT_H__
 #define __HTTPCLIENT_H__
 
+#ifdef _WIN32
 #include <Windows.h>
-#include <winhttp.h>
+#else
+#include <stdint.h>
+typedef uint32_t DWORD;
+#define ERROR_SUCCESS   0
+#endif
 #include <string>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
 
 /**************************************************************************/
 
 enum HttpErrorCode
 {
-    EcHttpCodeError = 1
+    EcHttpCodeError = 1,
+    EcHttpAborted = 2,          // HttpClient 析构或 http_close 时尚未执行的异步请求
+    EcHttpProtocolError = 3,    // 响应格式错误
+    EcHttpUnsupported = 4,      // 当前平台不支持的请求（例如非 Windows 平台的 https）
 };
 
+// ret 为 0 表示成功（HTTP 200），否则为系统错误码或 HttpErrorCode；在 HttpClient 的工作线程中调用
+typedef std::function<void(DWORD ret, const std::string& resp_data)> HttpCallback;
+
+class HttpConnectionPool;
+
 class HttpClient
 {
 public:
@@ -23,17 +52,41 @@ public:
         , const std::vector<std::wstring>& headers, std::string& resp_data);
     DWORD http_post(const std::wstring& url
         , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data);
-	DWORD http_put(const std::wstring& url
-		, const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data);
-	void  http_close();
+    DWORD http_put(const std::wstring& url
+        , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data);
+
+    void http_get_async(const std::wstring& url
+        , const std::vector<std::wstring>& headers, HttpCallback callback);
+    void http_post_async(const std::wstring& url
+        , const std::vector<std::wstring>& headers, const std::string& body, HttpCallback callback);
+
+    // 断开所有保持的连接，未执行的异步请求以 EcHttpAborted 回调；正在执行的请求照常完成，
+    // 用完的连接不再复用。可以在回调中调用
+    void http_close();
 private:
+    struct AsyncTask
+    {
+        std::wstring url;
+        std::wstring method;
+        std::vector<std::wstring> headers;
+        std::string body;
+        HttpCallback callback;
+    };
+
     DWORD request(const std::wstring& url, const std::wstring& method
         , const std::vector<std::wstring>& headers, const std::string& body, std::string& resp_data);
+    void post_task(AsyncTask& task);
+    void worker_proc();
+    void abort_pending_tasks();
 private:
     std::wstring m_user_agent;
-    HINTERNET m_hSession;
-    HINTERNET m_hConnect;
-    HINTERNET m_hRequest;
+    HttpConnectionPool* m_pool;
+
+    std::mutex m_task_mutex;
+    std::condition_variable m_task_cond;
+    std::deque<AsyncTask> m_tasks;
+    std::vector<std::thread> m_workers;
+    bool m_stop;
 };
 
 #endif /* __HTTPCLIENT_H__ */
@@ -0,0 +1,143 @@
+﻿/*
+* Module:   JsonStream
+*
+* Function: 热路径使用的流式 JSON 读写，与 jsoncpp 的 Json::Value DOM 并存
+*
+*    1. CJsonPullReader 直接在输入缓冲上逐个返回 token，不建 DOM、不分配内存，字符串只在调用方需要时才解码转义。
+*    2. JsonSelect 按路径（"data.userSig"、"users[].userId"）只提取需要的字段，其余子树整体跳过。
+*    3. CJsonStreamWriter 按调用顺序直接拼接输出，Reset 后保留已分配的缓冲，适合反复生成小报文。
+*
+*    语法和转义规则与 jsoncpp 1.8 的 Json::Reader（strict 模式）/ Json::FastWriter 一致，不依赖 Windows 头文件。
+*
+*    没有在 jsoncpp 上扩展：1.8 的 Json::Reader / CharReader 只有"解析成 Json::Value"一个出口，词法分析
+*    （readToken、decodeString 等）是 Reader 的私有成员并直接写入 DOM，没有 SAX 或 pull 接口可以挂接；
+*    Json::Value 的每个节点都要分配内存，也做不到零分配。所以这里是独立的实现，tests/JsonStreamTest
+*    以 jsoncpp 为参照检查两者对同一输入给出相同的值、输出相同的文本。
+*    与 Json::Reader 的差别：Json::Reader 接受的 "01"、"1."、"-" 和字符串中未转义的控制字符，这里按 RFC 8259 拒绝；
+*    根节点可以是任意值；超过 kMaxDepth 层嵌套时报错。
+*/
+#ifndef __JSON_STREAM_H__
+#define __JSON_STREAM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class CJsonPullReader
+{
+public:
+    enum Token
+    {
+        TokenError,
+        TokenEnd,               // 顶层值已读完
+        TokenBeginObject,
+        TokenEndObject,
+        TokenBeginArray,
+        TokenEndArray,
+        TokenKey,               // 对象成员名，紧接着的 Next 返回成员值
+        TokenString,
+        TokenNumber,
+        TokenTrue,
+        TokenFalse,
+        TokenNull,
+    };
+
+    static const int kMaxDepth = 64;
+public:
+    CJsonPullReader(const char* data, size_t size);
+
+    Token Next();
+    Token Current() const { return m_token; }
+
+    // 当前 token 为 BeginObject/BeginArray 时跳过整个容器，停在对应的 End 上；其他 token 不做任何事
+    bool SkipContainer();
+
+    int Depth() const { return m_depth; }
+    size_t ErrorOffset() const { return m_cursor - m_begin; }
+
+    // 当前 token 的原始文本：字符串和成员名不含引号且未解码转义，数字和字面量为原文
+    const char* TextBegin() const { return m_textBegin; }
+    size_t TextSize() const { return m_textEnd - m_textBegin; }
+
+    // 当前字符串/成员名是否等于 text，不含转义时直接比较原文
+    bool TextEquals(const char* text, size_t size) const;
+
+    // 读取当前 token 的值，类型不符时返回 false
+    bool GetString(std::string& value) const;
+    bool GetInt64(int64_t& value) const;
+    bool GetUInt64(uint64_t& value) const;
+    bool GetDouble(double& value) const;
+    bool GetBool(bool& value) const;
+private:
+    Token Fail();
+    Token ReadValue();
+    Token ReadString(Token token);
+    Token ReadNumber();
+    Token ReadLiteral(const char* literal, size_t size, Token token);
+    void SkipSpace();
+private:
+    const char* m_begin;
+    const char* m_end;
+    const char* m_cursor;
+    const char* m_textBegin = NULL;
+    const char* m_textEnd = NULL;
+    bool m_textEscaped = false;
+    Token m_token = TokenError;
+
+    int m_depth = 0;
+    uint64_t m_arrayBits = 0;   // 第 i 层是否为数组
+    bool m_first = true;        // 当前容器中还没有元素
+    bool m_started = false;
+};
+
+// 路径用 '.' 分隔对象成员，"[]" 表示数组的每个元素，例如 "errorCode"、"data.userSig"、"users[].userId"；
+// 成员名本身含 '.' 或 '[' 时用反斜杠转义，例如 "TLS\\.time"（C 字符串写法）。
+// 每当某条路径上的值出现时回调一次，reader 停在该值上，回调中只读取当前值，不要移动 reader；
+// 容器值回调的是 BeginObject/BeginArray。成员名含转义字符时不参与匹配。
+// arrayIndex 为路径中最内层 "[]" 的元素下标，路径中没有 "[]" 时为 0。回调返回 false 时提前结束。
+class IJsonSelectHandler
+{
+public:
+    virtual ~IJsonSelectHandler() {}
+    virtual bool OnValue(size_t pathIndex, size_t arrayIndex, CJsonPullReader& reader) = 0;
+};
+
+// 只提取 paths 指定的字段，解析失败时返回 false
+bool JsonSelect(const char* data, size_t size, const char* const* paths, size_t pathCount, IJsonSelectHandler& handler);
+
+class CJsonStreamWriter
+{
+public:
+    explicit CJsonStreamWriter(size_t reserveBytes = 256);
+
+    // 清空内容，保留已分配的缓冲
+    void Reset();
+
+    CJsonStreamWriter& BeginObject();
+    CJsonStreamWriter& EndObject();
+    CJsonStreamWriter& BeginArray();
+    CJsonStreamWriter& EndArray();
+    CJsonStreamWriter& Key(const char* name);
+    CJsonStreamWriter& Key(const char* name, size_t size);
+    CJsonStreamWriter& String(const char* value);
+    CJsonStreamWriter& String(const char* value, size_t size);
+    CJsonStreamWriter& String(const std::string& value) { return String(value.data(), value.size()); }
+    CJsonStreamWriter& Int(int64_t value);
+    CJsonStreamWriter& UInt(uint64_t value);
+    CJsonStreamWriter& Double(double value);
+    CJsonStreamWriter& Bool(bool value);
+    CJsonStreamWriter& Null();
+
+    const std::string& str() const { return m_buffer; }
+    const char* c_str() const { return m_buffer.c_str(); }
+    size_t size() const { return m_buffer.size(); }
+private:
+    void Separator();
+    void AppendQuoted(const char* value, size_t size);
+private:
+    std::string m_buffer;
+    bool m_needComma = false;
+    bool m_afterKey = false;
+};
+
+#endif /* __JSON_STREAM_H__ */
@@ -0,0 +1,24 @@
+﻿/*
+* Module:   WriteFileAtomic
+*
+* Function: 原子地替换文件内容：写 <path>.tmp，落盘（fsync / FlushFileBuffers）后 rename 覆盖原文件
+*
+*    任何时刻崩溃或断电，path 要么是原来的完整内容，要么是新的完整内容。CIniStore 和 CSettingsSnapshot 共用。
+*    不依赖 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __ATOMIC_FILE_H__
+#define __ATOMIC_FILE_H__
+
+#include <stddef.h>
+#include <string>
+
+#ifdef _WIN32
+typedef std::wstring AtomicFilePath;
+#else
+typedef std::string AtomicFilePath;
+#endif
+
+// 失败时删除临时文件，原文件不变
+bool WriteFileAtomic(const AtomicFilePath& path, const void* data, size_t size);
+
+#endif /* __ATOMIC_FILE_H__ */
@@ -0,0 +1,28 @@
+﻿/*
+* Module:   Inflate
+*
+* Function: 最小的 DEFLATE（RFC 1951）/ zlib（RFC 1950）解压实现
+*
+*    1. 一次性解压整块数据，不支持流式输入，适合 UserSig、zip 条目这类整块数据。
+*    2. 输出超过 maxOutput 时返回失败，避免异常数据撑爆内存。
+*    3. 9 位以内的码查表解码，更长的码逐位解码；已知解压后大小时可以直接解压到调用方的缓冲区。
+*
+*    不依赖 zlib 头文件和 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __INFLATE_H__
+#define __INFLATE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// 解压原始 DEFLATE 数据，追加到 out；consumed 返回实际消耗的输入字节数（可为 NULL）
+bool InflateRaw(const uint8_t* data, size_t size, std::string& out, size_t maxOutput, size_t* consumed = NULL);
+
+// 解压原始 DEFLATE 数据到 out[0, outSize)，超出时返回 false；produced 返回写入的字节数（可为 NULL）
+bool InflateRawTo(const uint8_t* data, size_t size, uint8_t* out, size_t outSize, size_t* produced = NULL);
+
+// 解压 zlib 格式数据（2 字节头 + DEFLATE + Adler-32），校验失败返回 false
+bool InflateZlib(const uint8_t* data, size_t size, std::string& out, size_t maxOutput);
+
+#endif /* __INFLATE_H__ */
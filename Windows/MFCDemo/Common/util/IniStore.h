@@ -0,0 +1,130 @@
+﻿/*
+* Module:   CIniStore
+*
+* Function: INI 配置存储引擎，CConfigMgr 的底层实现
+*
+*    1. 加载时将文件映射到内存，一遍扫描完成解析，键值以 IniStrRef 的形式指向内部 arena，不做宽字符转换。
+*    2. 通过 (section, key) 哈希索引查找，提供 GetInt/GetBool/GetString 等类型化接口。
+*    3. 保存时先写临时文件再 rename 覆盖，保证配置文件不会写坏；可选开启延迟合并写盘（SetAutoSave）。
+*       写盘在锁外进行，后台写盘期间 UI 线程的 Get/Set 不会等待磁盘。
+*    4. 注释行和空行挂在其后的节或键上，保存时原样写回；键值的顺序保持文件中的顺序，
+*       键、值两侧的空白和无效的行（没有 '='、值为空、不在任何节中）不保留。
+*
+*    内部只使用 UTF-8，不依赖 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __INI_STORE_H__
+#define __INI_STORE_H__
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+
+#ifdef _WIN32
+typedef std::wstring IniPath;
+#else
+typedef std::string IniPath;
+#endif
+
+// 不持有内存的字符串引用，指向 CIniStore 的 arena
+struct IniStrRef
+{
+    const char* data;
+    size_t size;
+
+    IniStrRef() : data(""), size(0) {}
+    IniStrRef(const char* str) : data(str), size(strlen(str)) {}
+    IniStrRef(const char* str, size_t len) : data(str), size(len) {}
+    IniStrRef(const std::string& str) : data(str.c_str()), size(str.size()) {}
+
+    bool empty() const { return size == 0; }
+    std::string str() const { return std::string(data, size); }
+    bool operator==(const IniStrRef& other) const
+    {
+        return size == other.size && memcmp(data, other.data, size) == 0;
+    }
+};
+
+class CIniStore
+{
+public:
+    CIniStore();
+    ~CIniStore();
+public:
+    bool Load(const IniPath& path);     // 加载文件，文件不存在时返回 false，之后 Save 会创建
+    bool Save();                        // 原子写回（临时文件 + rename），无修改时直接返回 true；写盘期间不持有数据锁
+    void SetAutoSave(unsigned int delayMs);  // delayMs > 0 时修改后延迟 delayMs 合并写盘，0 关闭
+
+    // value 指向内部 arena，只在下一次 Set*/Save 之前有效；需要保存时用 GetString
+    bool Get(IniStrRef section, IniStrRef key, IniStrRef& value) const;
+    bool GetString(IniStrRef section, IniStrRef key, std::string& value) const;
+    int GetInt(IniStrRef section, IniStrRef key, int defaultValue) const;
+    bool GetBool(IniStrRef section, IniStrRef key, bool defaultValue) const;
+
+    void SetString(IniStrRef section, IniStrRef key, IniStrRef value);
+    void SetInt(IniStrRef section, IniStrRef key, int value);
+
+    size_t GetSectionCount() const;
+    size_t GetEntryCount() const;
+private:
+    struct Entry
+    {
+        IniStrRef key;
+        IniStrRef value;
+        size_t valueCap;                // value 在 arena 中占用的长度（不含 '\0'），新值不超过它时原地覆盖
+        IniStrRef comment;              // 文件中这一行之前的注释和空行，含换行
+    };
+    struct Section
+    {
+        IniStrRef name;
+        IniStrRef comment;
+        std::vector<size_t> entries;    // m_entries 下标，保持文件中的顺序
+    };
+    struct EntryKey
+    {
+        IniStrRef section;
+        IniStrRef key;
+        bool operator==(const EntryKey& other) const { return section == other.section && key == other.key; }
+    };
+    struct EntryKeyHash
+    {
+        size_t operator()(const EntryKey& k) const;
+    };
+private:
+    void Parse(const char* data, size_t size);
+    IniStrRef Store(IniStrRef str);     // 拷贝到 arena，返回指向 arena 的引用
+    size_t FindOrAddSection(IniStrRef name);
+    const Entry* FindLocked(IniStrRef section, IniStrRef key) const;
+    size_t SetLocked(IniStrRef section, IniStrRef key, IniStrRef value);   // 返回 m_entries 下标
+    void CompactArena();                // 废弃的值占了一半以上时重建 arena，只在写盘后调用
+    void Serialize(std::string& out) const;
+    void AutoSaveProc();
+private:
+    mutable std::mutex m_mutex;
+    std::mutex m_writeMutex;            // 保证写盘的先后与序列化的先后一致；先取它再取 m_mutex
+    IniPath m_path;
+    std::vector<std::unique_ptr<char[]>> m_arena;
+    size_t m_arenaUsed = 0;
+    size_t m_arenaCap = 0;
+    size_t m_arenaBytes = 0;            // 所有块的总大小
+    size_t m_arenaWaste = 0;            // 被新值替换掉、不再引用的字节数
+
+    std::vector<Section> m_sections;
+    std::vector<Entry> m_entries;
+    IniStrRef m_trailer;                // 文件末尾最后一个键之后的注释
+    std::unordered_map<EntryKey, size_t, EntryKeyHash> m_index;
+    bool m_bDirty = false;
+
+    std::thread m_saveThread;
+    std::condition_variable m_saveCond;
+    unsigned int m_saveDelayMs = 0;
+    unsigned long long m_changeSeq = 0;
+    bool m_bStopSave = false;
+};
+
+#endif /* __INI_STORE_H__ */
@@ -0,0 +1,521 @@
+#include "LogFormat.h"
+
+#include <string.h>
+#include <wchar.h>
+#include <time.h>
+
+//////////////////////////////////////////////////////////////////////////格式串解析
+
+enum LogLengthModifier
+{
+    kLenNone, kLenHH, kLenH, kLenL, kLenLL, kLenBigL, kLenSize, kLenI32, kLenI64, kLenW
+};
+
+struct LogFormatSpec
+{
+    wchar_t flags[8];
+    int flagCount;
+    int width;          // -1 表示没有
+    bool bWidthStar;
+    int precision;      // -1 表示没有
+    bool bPrecisionStar;
+    LogLengthModifier length;
+    wchar_t conversion;
+};
+
+// p 指向 '%' 之后的字符，返回说明符之后的位置，格式不完整时返回 NULL
+static const wchar_t* ParseFormatSpec(const wchar_t* p, LogFormatSpec& spec)
+{
+    spec.flagCount = 0;
+    spec.width = -1;
+    spec.bWidthStar = false;
+    spec.precision = -1;
+    spec.bPrecisionStar = false;
+    spec.length = kLenNone;
+
+    while (*p == L'-' || *p == L'+' || *p == L' ' || *p == L'#' || *p == L'0')
+    {
+        if (spec.flagCount < 7)
+            spec.flags[spec.flagCount++] = *p;
+        ++p;
+    }
+    spec.flags[spec.flagCount] = L'\0';
+
+    if (*p == L'*')
+    {
+        spec.bWidthStar = true;
+        ++p;
+    }
+    else if (*p >= L'0' && *p <= L'9')
+    {
+        spec.width = 0;
+        while (*p >= L'0' && *p <= L'9')
+            spec.width = spec.width * 10 + (*p++ - L'0');
+    }
+
+    if (*p == L'.')
+    {
+        ++p;
+        spec.precision = 0;
+        if (*p == L'*')
+        {
+            spec.bPrecisionStar = true;
+            ++p;
+        }
+        else
+        {
+            while (*p >= L'0' && *p <= L'9')
+                spec.precision = spec.precision * 10 + (*p++ - L'0');
+        }
+    }
+
+    switch (*p)
+    {
+    case L'h':
+        spec.length = (p[1] == L'h') ? kLenHH : kLenH;
+        p += (p[1] == L'h') ? 2 : 1;
+        break;
+    case L'l':
+        spec.length = (p[1] == L'l') ? kLenLL : kLenL;
+        p += (p[1] == L'l') ? 2 : 1;
+        break;
+    case L'L': spec.length = kLenBigL; ++p; break;
+    case L'j': spec.length = kLenLL; ++p; break;
+    case L'z':
+    case L't': spec.length = kLenSize; ++p; break;
+    case L'w': spec.length = kLenW; ++p; break;
+    case L'I':
+        if (p[1] == L'6' && p[2] == L'4') { spec.length = kLenI64; p += 3; }
+        else if (p[1] == L'3' && p[2] == L'2') { spec.length = kLenI32; p += 3; }
+        else { spec.length = kLenSize; ++p; }
+        break;
+    default:
+        break;
+    }
+
+    if (*p == L'\0')
+        return NULL;
+    spec.conversion = *p;
+    return p + 1;
+}
+
+static bool IsWideStringSpec(const LogFormatSpec& spec)
+{
+#ifdef _WIN32
+    // 宽字符版 printf：%s 是宽字符串，%S 是窄字符串
+    if (spec.length == kLenH)
+        return false;
+    if (spec.length == kLenL || spec.length == kLenW)
+        return true;
+    return spec.conversion == L's';
+#else
+    if (spec.length == kLenL || spec.length == kLenW)
+        return true;
+    return spec.conversion == L'S';
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////调用线程：参数打包
+
+class LogArgWriter
+{
+public:
+    LogArgWriter(uint8_t* buffer, size_t capacity) : m_buffer(buffer), m_capacity(capacity), m_size(0) {}
+
+    bool PutValue(uint8_t tag, const void* value, size_t size)
+    {
+        if (m_size + 1 + size > m_capacity)
+            return false;
+        m_buffer[m_size] = tag;
+        memcpy(m_buffer + m_size + 1, value, size);
+        m_size += 1 + size;
+        return true;
+    }
+
+    template <typename CharT>
+    bool PutString(uint8_t tag, const CharT* str)
+    {
+        static const CharT kNull[] = { '(', 'n', 'u', 'l', 'l', ')', 0 };
+        if (str == NULL)
+            str = kNull;
+
+        uint32_t len = 0;
+        while (len < kLogMaxStringChars && str[len] != 0)
+            ++len;
+        if (m_size + 1 + sizeof(len) + sizeof(CharT) > m_capacity)
+            return false;
+
+        size_t room = (m_capacity - m_size - 1 - sizeof(len)) / sizeof(CharT);
+        if (len > room)
+            len = static_cast<uint32_t>(room);
+        m_buffer[m_size] = tag;
+        memcpy(m_buffer + m_size + 1, &len, sizeof(len));
+        memcpy(m_buffer + m_size + 1 + sizeof(len), str, len * sizeof(CharT));
+        m_size += 1 + sizeof(len) + len * sizeof(CharT);
+        return true;
+    }
+
+    size_t Size() const { return m_size; }
+private:
+    uint8_t* m_buffer;
+    size_t m_capacity;
+    size_t m_size;
+};
+
+size_t LogPackArgs(const wchar_t* format, va_list args, uint8_t* buffer, size_t capacity)
+{
+    LogArgWriter writer(buffer, capacity);
+    for (const wchar_t* p = format; *p != L'\0'; ++p)
+    {
+        if (*p != L'%')
+            continue;
+        if (p[1] == L'%')
+        {
+            ++p;
+            continue;
+        }
+
+        LogFormatSpec spec;
+        const wchar_t* next = ParseFormatSpec(p + 1, spec);
+        if (next == NULL)
+            break;
+        p = next - 1;
+
+        bool bOk = true;
+        if (spec.bWidthStar)
+        {
+            int64_t star = va_arg(args, int);
+            bOk = writer.PutValue(kLogArgInt, &star, sizeof(star));
+        }
+        if (spec.bPrecisionStar)
+        {
+            int64_t star = va_arg(args, int);
+            bOk = bOk && writer.PutValue(kLogArgInt, &star, sizeof(star));
+        }
+
+        switch (spec.conversion)
+        {
+        case L'd':
+        case L'i':
+        {
+            int64_t value = 0;
+            switch (spec.length)
+            {
+            case kLenHH: value = static_cast<signed char>(va_arg(args, int)); break;
+            case kLenH: value = static_cast<short>(va_arg(args, int)); break;
+            case kLenL: value = va_arg(args, long); break;
+            case kLenLL:
+            case kLenBigL:
+            case kLenI64: value = va_arg(args, long long); break;
+            case kLenSize: value = va_arg(args, ptrdiff_t); break;
+            default: value = va_arg(args, int); break;
+            }
+            bOk = bOk && writer.PutValue(kLogArgInt, &value, sizeof(value));
+            break;
+        }
+        case L'u':
+        case L'o':
+        case L'x':
+        case L'X':
+        {
+            uint64_t value = 0;
+            switch (spec.length)
+            {
+            case kLenHH: value = static_cast<unsigned char>(va_arg(args, unsigned int)); break;
+            case kLenH: value = static_cast<unsigned short>(va_arg(args, unsigned int)); break;
+            case kLenL: value = va_arg(args, unsigned long); break;
+            case kLenLL:
+            case kLenBigL:
+            case kLenI64: value = va_arg(args, unsigned long long); break;
+            case kLenSize: value = va_arg(args, size_t); break;
+            default: value = va_arg(args, unsigned int); break;
+            }
+            bOk = bOk && writer.PutValue(kLogArgUInt, &value, sizeof(value));
+            break;
+        }
+        case L'c':
+        case L'C':
+        {
+            int64_t value = va_arg(args, int);
+            bOk = bOk && writer.PutValue(kLogArgInt, &value, sizeof(value));
+            break;
+        }
+        case L'e': case L'E': case L'f': case L'F':
+        case L'g': case L'G': case L'a': case L'A':
+        {
+            double value = (spec.length == kLenBigL) ? static_cast<double>(va_arg(args, long double)) : va_arg(args, double);
+            bOk = bOk && writer.PutValue(kLogArgDouble, &value, sizeof(value));
+            break;
+        }
+        case L'p':
+        {
+            uint64_t value = reinterpret_cast<uintptr_t>(va_arg(args, void*));
+            bOk = bOk && writer.PutValue(kLogArgPointer, &value, sizeof(value));
+            break;
+        }
+        case L's':
+        case L'S':
+            if (IsWideStringSpec(spec))
+                bOk = bOk && writer.PutString(kLogArgWide, va_arg(args, const wchar_t*));
+            else
+                bOk = bOk && writer.PutString(kLogArgNarrow, va_arg(args, const char*));
+            break;
+        case L'n':
+            (void)va_arg(args, void*);
+            break;
+        default:
+            break;
+        }
+
+        if (!bOk)
+            break;  // 参数区写满，后面的参数按缺失处理
+    }
+    return writer.Size();
+}
+
+//////////////////////////////////////////////////////////////////////////后台线程：格式化
+
+class LogArgReader
+{
+public:
+    LogArgReader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    bool Next(uint8_t& tag, const uint8_t*& value, uint32_t& len)
+    {
+        if (m_pos >= m_size)
+            return false;
+        tag = m_data[m_pos];
+        size_t valueSize = 8;
+        len = 0;
+        if (tag == kLogArgWide || tag == kLogArgNarrow)
+        {
+            if (m_pos + 1 + sizeof(len) > m_size)
+                return false;
+            memcpy(&len, m_data + m_pos + 1, sizeof(len));
+            valueSize = sizeof(len) + len * (tag == kLogArgWide ? sizeof(wchar_t) : 1);
+        }
+        if (m_pos + 1 + valueSize > m_size)
+            return false;
+        value = m_data + m_pos + 1;
+        m_pos += 1 + valueSize;
+        return true;
+    }
+
+    bool NextInt(int64_t& out)
+    {
+        uint8_t tag = 0;
+        const uint8_t* value = NULL;
+        uint32_t len = 0;
+        if (!Next(tag, value, len) || tag != kLogArgInt)
+            return false;
+        memcpy(&out, value, sizeof(out));
+        return true;
+    }
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos;
+};
+
+static void AppendSpec(std::wstring& out, const wchar_t* spec, ...)
+{
+    wchar_t buffer[512];
+    va_list args;
+    va_start(args, spec);
+    int count = ::vswprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), spec, args);
+    va_end(args);
+    if (count > 0)
+        out.append(buffer, static_cast<size_t>(count));
+}
+
+void LogAppendFormatted(std::wstring& out, const wchar_t* format, const uint8_t* args, size_t argBytes)
+{
+    LogArgReader reader(args, argBytes);
+    const wchar_t* literal = format;
+    const wchar_t* p = format;
+    while (*p != L'\0')
+    {
+        if (*p != L'%')
+        {
+            ++p;
+            continue;
+        }
+        out.append(literal, p - literal);
+        if (p[1] == L'%')
+        {
+            out.push_back(L'%');
+            p += 2;
+            literal = p;
+            continue;
+        }
+
+        LogFormatSpec spec;
+        const wchar_t* next = ParseFormatSpec(p + 1, spec);
+        if (next == NULL)
+        {
+            literal = p;
+            break;
+        }
+
+        int64_t starValue = 0;
+        int width = spec.width;
+        int precision = spec.precision;
+        bool bOk = true;
+        if (spec.bWidthStar)
+        {
+            bOk = reader.NextInt(starValue);
+            width = static_cast<int>(starValue);
+        }
+        if (spec.bPrecisionStar)
+        {
+            bOk = bOk && reader.NextInt(starValue);
+            precision = static_cast<int>(starValue);
+        }
+
+        uint8_t tag = 0;
+        const uint8_t* value = NULL;
+        uint32_t len = 0;
+        if (spec.conversion != L'n' && (!bOk || !reader.Next(tag, value, len)))
+        {
+            out.append(p, next - p);    // 参数缺失，原样输出说明符
+            p = next;
+            literal = p;
+            continue;
+        }
+
+        // 统一改写成两端 CRT 行为一致的说明符：整数用 ll，字符和字符串用 l（宽字符）
+        wchar_t specBuffer[32];
+        int specLen = ::swprintf(specBuffer, 32, L"%%%ls", spec.flags);
+        if (width >= 0)
+            specLen += ::swprintf(specBuffer + specLen, 32 - specLen, L"%d", width);
+        if (precision >= 0)
+            specLen += ::swprintf(specBuffer + specLen, 32 - specLen, L".%d", precision);
+
+        switch (tag)
+        {
+        case kLogArgInt:
+        case kLogArgUInt:
+        {
+            int64_t intValue = 0;
+            memcpy(&intValue, value, sizeof(intValue));
+            if (spec.conversion == L'c' || spec.conversion == L'C')
+            {
+                ::swprintf(specBuffer + specLen, 32 - specLen, L"lc");
+                AppendSpec(out, specBuffer, static_cast<wint_t>(intValue));
+            }
+            else
+            {
+                ::swprintf(specBuffer + specLen, 32 - specLen, L"ll%lc", static_cast<wint_t>(spec.conversion));
+                AppendSpec(out, specBuffer, static_cast<long long>(intValue));
+            }
+            break;
+        }
+        case kLogArgDouble:
+        {
+            double doubleValue = 0;
+            memcpy(&doubleValue, value, sizeof(doubleValue));
+            ::swprintf(specBuffer + specLen, 32 - specLen, L"%lc", static_cast<wint_t>(spec.conversion));
+            AppendSpec(out, specBuffer, doubleValue);
+            break;
+        }
+        case kLogArgPointer:
+        {
+            uint64_t pointerValue = 0;
+            memcpy(&pointerValue, value, sizeof(pointerValue));
+            ::swprintf(specBuffer + specLen, 32 - specLen, L"p");
+            AppendSpec(out, specBuffer, reinterpret_cast<void*>(static_cast<uintptr_t>(pointerValue)));
+            break;
+        }
+        case kLogArgWide:
+        case kLogArgNarrow:
+        {
+            std::wstring str;
+            if (tag == kLogArgWide)
+            {
+                str.resize(len);
+                if (len > 0)
+                    memcpy(&str[0], value + sizeof(len), len * sizeof(wchar_t));
+            }
+            else
+            {
+                str.assign(reinterpret_cast<const char*>(value + sizeof(len)), reinterpret_cast<const char*>(value + sizeof(len)) + len);
+            }
+
+            if (width < 0 && precision < 0)
+            {
+                out.append(str);
+            }
+            else
+            {
+                ::swprintf(specBuffer + specLen, 32 - specLen, L"ls");
+                AppendSpec(out, specBuffer, str.c_str());
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        p = next;
+        literal = p;
+    }
+    out.append(literal);
+}
+
+static const wchar_t* GetLevelName(int level)
+{
+    static const wchar_t* const kLevelNames[] = { L"[T]", L"[I]", L"[W]", L"[E]", L"[F]", L"[IN]", L"[OUT]" };
+    return (level >= 0 && level < static_cast<int>(sizeof(kLevelNames) / sizeof(kLevelNames[0]))) ? kLevelNames[level] : L"";
+}
+
+static void LocalTimeOf(time_t seconds, struct tm& result)
+{
+#ifdef _WIN32
+    ::localtime_s(&result, &seconds);
+#else
+    ::localtime_r(&seconds, &result);
+#endif
+}
+
+static void AppendNarrow(std::wstring& out, const char* str)
+{
+    for (; str != NULL && *str != '\0'; ++str)
+        out.push_back(static_cast<wchar_t>(static_cast<unsigned char>(*str)));
+}
+
+void LogAppendLine(std::wstring& out, const LogLineInfo& info, const wchar_t* format, const uint8_t* args, size_t argBytes)
+{
+    time_t seconds = static_cast<time_t>(info.timestamp / 1000000);
+    unsigned int millis = static_cast<unsigned int>((info.timestamp / 1000) % 1000);
+    struct tm localTime;
+    memset(&localTime, 0, sizeof(localTime));
+    LocalTimeOf(seconds, localTime);
+
+    wchar_t moduleField[64];
+    wchar_t pidField[48];
+    wchar_t timeField[48];
+    ::swprintf(moduleField, 64, L"[#%ls#]", info.moduleName ? info.moduleName : L"");
+    ::swprintf(pidField, 48, L"[%lu, %lu]", info.processId, info.threadId);
+    ::swprintf(timeField, 48, L"[%02d-%02d %02d:%02d:%02d.%u]", localTime.tm_mon + 1, localTime.tm_mday,
+        localTime.tm_hour, localTime.tm_min, localTime.tm_sec, millis);
+
+    std::wstring function;
+    AppendNarrow(function, info.function);
+    std::wstring file;
+    AppendNarrow(file, info.file);
+    if (info.level != OutLevel)
+    {
+        wchar_t lineField[16];
+        ::swprintf(lineField, 16, L":%d", info.line);
+        file.append(lineField);
+    }
+
+    wchar_t prefix[640];
+    int count = ::swprintf(prefix, 640, L"%-20ls %-14ls %-24ls %-8ls %-48ls %-32ls [", moduleField, pidField, timeField,
+        GetLevelName(info.level), function.c_str(), file.c_str());
+    if (count > 0)
+        out.append(prefix, static_cast<size_t>(count));
+
+    LogAppendFormatted(out, format ? format : L"", args, argBytes);
+    out.append(L"]\n");
+}
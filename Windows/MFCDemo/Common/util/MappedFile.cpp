@@ -0,0 +1,127 @@
+﻿#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char kEmpty[1] = { 0 };
+
+CMappedFile::CMappedFile()
+    : m_data(kEmpty)
+    , m_size(0)
+    , m_bOpen(false)
+{
+}
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool CMappedFile::Open(const char* path)
+{
+    Close();
+    HANDLE hFile = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    return Map(hFile);
+}
+
+bool CMappedFile::Open(const wchar_t* path)
+{
+    Close();
+    HANDLE hFile = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    return Map(hFile);
+}
+
+bool CMappedFile::Map(void* hFile)
+{
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize = { 0 };
+    if (!::GetFileSizeEx(hFile, &fileSize))
+    {
+        ::CloseHandle(hFile);
+        return false;
+    }
+    if (fileSize.QuadPart == 0)
+    {
+        ::CloseHandle(hFile);
+        m_bOpen = true;
+        return true;
+    }
+
+    // 映射对象和文件句柄在映射视图存在期间可以先关闭
+    HANDLE hMapping = ::CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    const char* view = hMapping ? static_cast<const char*>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+    if (hMapping)
+        ::CloseHandle(hMapping);
+    ::CloseHandle(hFile);
+    if (view == NULL)
+        return false;
+
+    m_data = view;
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    m_bOpen = true;
+    return true;
+}
+
+void CMappedFile::Close()
+{
+    if (m_size != 0)
+        ::UnmapViewOfFile(m_data);
+    m_data = kEmpty;
+    m_size = 0;
+    m_bOpen = false;
+}
+#else
+bool CMappedFile::Open(const char* path)
+{
+    Close();
+    return Map(::open(path, O_RDONLY));
+}
+
+bool CMappedFile::Map(int fd)
+{
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        m_bOpen = true;
+        return true;
+    }
+
+    void* view = ::mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(st.st_size);
+    m_bOpen = true;
+    return true;
+}
+
+void CMappedFile::Close()
+{
+    if (m_size != 0)
+        ::munmap(const_cast<char*>(m_data), m_size);
+    m_data = kEmpty;
+    m_size = 0;
+    m_bOpen = false;
+}
+#endif
@@ -0,0 +1,42 @@
+﻿/*
+* Module:   CMappedFile
+*
+* Function: 只读文件映射，一次映射整个文件，代替按块 fread 拼接
+*
+*    空文件打开成功，Data() 指向空串、Size() 为 0。不依赖 Windows 头文件，可在其他平台编译。
+*/
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <stddef.h>
+
+class CMappedFile
+{
+public:
+    CMappedFile();
+    ~CMappedFile();
+
+    bool Open(const char* path);
+#ifdef _WIN32
+    bool Open(const wchar_t* path);
+#endif
+    void Close();
+
+    bool IsOpen() const { return m_bOpen; }
+    const char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+private:
+    CMappedFile(const CMappedFile&);
+    CMappedFile& operator=(const CMappedFile&);
+#ifdef _WIN32
+    bool Map(void* hFile);
+#else
+    bool Map(int fd);
+#endif
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_bOpen;
+};
+
+#endif /* __MAPPED_FILE_H__ */
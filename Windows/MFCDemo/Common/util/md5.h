@@ -33,6 +33,7 @@
   <ghost@aladdin.com>.  Other authors are noted in the change history
   that follows (in reverse chronological order):
 
+  2026-10-18 Added md5_hex, md5_batch and md5_batch_lanes.
   1999-11-04 lpd Edited comments slightly for automatic TOC extraction.
   1999-10-18 lpd Fixed typo in header comment (ansi2knr rather than md5);
 	added conditionalization for C++ compilation from Martin
@@ -42,7 +43,11 @@
 #ifdef _WIN32
 #include <Windows.h>
 #include <stdio.h>
+#else
+typedef unsigned int DWORD;
+typedef unsigned char BYTE;
 #endif
+#include <stddef.h>
 
 #ifndef md5_INCLUDED
 #define md5_INCLUDED
@@ -81,7 +86,7 @@ void md5_init(P1(md5_state_t *pms));
 void md5_init(md5_state_t *pms);
 #endif
 
-/* Append a string to the message. */
+/* Append a string to the message; may be called any number of times. */
 #ifdef P3
 void md5_append(P3(md5_state_t *pms, const md5_byte_t *data, int nbytes));
 #else
@@ -95,6 +100,19 @@ void md5_finish(P2(md5_state_t *pms, md5_byte_t digest[16]));
 void md5_finish(md5_state_t *pms, md5_byte_t digest[16]);
 #endif
 
+/* Lower-case hex of a digest; hex receives 32 characters and a NUL. */
+void md5_hex(const md5_byte_t digest[16], char hex[33]);
+
+/*
+ * Hash count independent messages, digests[i] = MD5(data[i], sizes[i]).
+ * Messages are hashed side by side in SIMD lanes (8 with AVX2, 4 with
+ * SSE2), so batches of similar-sized messages run fastest.
+ */
+void md5_batch(const md5_byte_t *const *data, const size_t *sizes, size_t count, md5_byte_t (*digests)[16]);
+
+/* Number of messages md5_batch hashes per pass on this CPU (1, 4 or 8). */
+int md5_batch_lanes(void);
+
 #ifdef __cplusplus
 }  /* end extern "C" */
 #endif
@@ -7,8 +7,11 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 #include <stdint.h>
 #include "http/HttpClient.h"
+#include "json/JsonStream.h"
+#include "util/UserSigProvider.h"
 struct UserInfo
 {
     std::string userId;
@@ -46,6 +49,11 @@ struct TXCloudAccountInfo
     */
     std::wstring _loginServer = L"https://www.qcloudtrtc.com/sxb_dev/?svc=account&cmd=authPrivMap";
 
+    /*
+    *  getUserSig 的签发方式：false 为本地计算（getUserSigFromLocal），true 为请求 _loginServer（getUserSigFromServer）。
+    */
+    bool _userSigFromServer = false;
+
     /*
     *  TRTCDuilibDemo源码 TRTCCloudCore.h->updateMixTranCodeInfo 混流接口功能实现需要补齐此账号信息。
     *  获取途径：腾讯云网页控制台->实时音视频->您的应用(eg客服通话)->账号信息面板可以获取appid/bizid
@@ -71,7 +79,7 @@ public:
     *
     * 该方案仅适合本地跑通demo和功能调试，产品真正上线发布，要使用服务器获取方案避免私钥被破解。
     */
-    std::string getUserSigFromLocal(std::string userId) const;
+    std::string getUserSigFromLocal(std::string userId);
 
     /**
     * 通过 http 请求到客户的业务服务器上获取 userid 和 usersig
@@ -79,13 +87,31 @@ public:
     *
     * 但本demo中的 getUserSigFromServer 函数仅作为示例代码，要跑通该逻辑，您需要参考：https://cloud.tencent.com/document/product/647/17275#GetFromServer
     */
-    //此示例代码仅供参考
+    //此示例代码仅供参考；该函数会阻塞等待 http 请求，不要在 UI 线程调用
     std::string getUserSigFromServer(std::string userId, int roomId);
+
+    /**
+    * 获取 userid 对应的 usersig，不会阻塞调用线程，UI 线程请使用该接口。
+    *
+    * 缓存中有未过期的 usersig 时直接写入 userSig 并返回 true；否则返回 false，
+    * 在后台按 TXCloudAccountInfo._userSigFromServer 的方式签发，完成后在后台线程调用 callback。
+    * 同一用户的并发请求只签发一次，usersig 过期前会在后台自动刷新。
+    */
+    bool getUserSig(const std::string& userId, std::string& userSig, const UserSigCallback& callback);
+
+    // 提前在后台签发 usersig，例如登录界面已知用户名时
+    void prefetchUserSig(const std::string& userId);
 public:
     // 获取腾讯云实时音视频账号配置信息。详情参考： SdkAppInfo 定义
     TXCloudAccountInfo getTXCloudAccountInfo() const {  return m_AccountInfo; };
 private:
     TXCloudAccountInfo m_AccountInfo;
+private:
+    std::string signUserSigLocal(const std::string& userId) const;
+    int fetchUserSig(uint32_t sdkAppId, const std::string& userId, std::string& userSig);
 private:
     HttpClient m_http_client;
+    std::mutex m_loginReqMutex;             // 保护 m_loginReqWriter，请求通常只在 m_userSigProvider 的工作线程中发出
+    CJsonStreamWriter m_loginReqWriter;     // 登录请求体，每次 Reset 后复用缓冲
+    CUserSigProvider m_userSigProvider;
 };
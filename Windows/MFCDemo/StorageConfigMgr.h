@@ -16,17 +16,9 @@ namespace Config {
     #define INI_KEY_SET_APP_SENSE L"INI_KEY_SET_APP_SENSE"
 };
 
-class SubNode
-{
-public:
-    void InsertElement(std::wstring key, std::wstring value)
-    {
-        sub_node.insert(std::pair<std::wstring, std::wstring>(key, value));
-    }
-    std::map<std::wstring, std::wstring> sub_node;
-};
+class CIniStore;
 
-//INIļ
+//INIļ࣬д CIniStore 
 class CConfigMgr
 {
 public:
@@ -35,14 +27,12 @@ public:
 public:
     std::wstring GetValue(std::wstring root, std::wstring key);			    //ɸͼȡֵ
     bool SetValue(std::wstring root, std::wstring key, std::wstring value);	//øͼȡֵ
-    int GetSize() { return map_ini.size(); }
-private:
-    int WriteINI();			//дINIļ
-    void Clear() { map_ini.clear(); }	//
-    void Travel();						//ӡINIļ
-    int InitReadINI();
+    int GetIntValue(const std::wstring& root, const std::wstring& key, int defaultValue);
+    bool SetIntValue(const std::wstring& root, const std::wstring& key, int value);
+    int GetSize();
+    bool Flush();                                   //дINIļ
 private:
-    std::map<std::wstring, SubNode> map_ini;		//INIļݵĴ洢
+    CIniStore* m_pStore;                            //INIļݵĴ洢
     std::wstring _IncFilePath;                      //ļ·
 };
 
@@ -73,6 +73,9 @@ BOOL TRTCLoginViewController::OnInitDialog()
     pEditUserId->SetWindowTextW(L"TRTC_TEST_USER01");
     pEditUserId->SetFont(&newFont);
 
+    //ǰں̨ǩĬû usersigʱٵȴ
+    GenerateTestUserSig::instance().prefetchUserSig("TRTC_TEST_USER01");
+
     CWnd *pEnterRoomBtn = GetDlgItem(IDC_ENTER_ROOM);
     pEnterRoomBtn->EnableWindow(TRUE);
 
@@ -101,6 +104,7 @@ void TRTCLoginViewController::OnCancel()
 BEGIN_MESSAGE_MAP(TRTCLoginViewController, CDialogEx)
     ON_BN_CLICKED(IDC_ENTER_ROOM, &TRTCLoginViewController::OnBnClickedEnterRoom)
     ON_MESSAGE(WM_CUSTOM_CLOSE_MAINVIEW, OnMsgMainViewClose)
+    ON_MESSAGE(WM_CUSTOM_USERSIG_READY, OnMsgUserSigReady)
 END_MESSAGE_MAP()
 
 
@@ -134,16 +138,27 @@ void TRTCLoginViewController::joinRoom(int roomId)
     }
     std::string userId = Wide2Ansi(strUserId);
 
-    //ӱؼ㷨ȡ userid Ӧ usersig
-    std::string userSig = GenerateTestUserSig::instance().getUserSigFromLocal(userId);
-    if (userSig == "")
+    //ȡ userid Ӧ usersigδʱں̨ǩؼͨ http Эȡɺ½
+    std::string userSig;
+    HWND hWnd = GetSafeHwnd();
+    bool bCached = GenerateTestUserSig::instance().getUserSig(userId, userSig, [hWnd](int code, const std::string& userSig) {
+        std::string* pUserSig = new std::string(userSig);
+        if (!::PostMessage(hWnd, WM_CUSTOM_USERSIG_READY, (WPARAM)code, (LPARAM)pUserSig))
+            delete pUserSig;
+    });
+    if (!bCached)
     {
-        //Ҳͨ http Эһ̨ȡ userid Ӧ usersig
-        //ʾTRTCGetUserIDAndUserSig::instance().getUserSigFromServer();
-        MessageBoxW(L"userSig ȡʧܣǷд˺Ϣ", L"", MB_OK);
+        m_bWaitUserSig = true;
+        m_nPendingRoomId = roomId;
+        m_pendingUserId = userId;
+        GetDlgItem(IDC_ENTER_ROOM)->EnableWindow(FALSE);
         return;
     }
+    enterRoom(roomId, userId, userSig);
+}
 
+void TRTCLoginViewController::enterRoom(int roomId, const std::string& userId, const std::string& userSig)
+{
     if (m_pTRTCMainViewController == nullptr)
     {
         m_pTRTCMainViewController = new TRTCMainViewController(this);
@@ -182,6 +197,26 @@ void TRTCLoginViewController::OnBnClickedEnterRoom()
     joinRoom(roomId);
 }
 
+LRESULT TRTCLoginViewController::OnMsgUserSigReady(WPARAM wParam, LPARAM lParam)
+{
+    //ֱôص UserSig һ joinRoom
+    std::string* pUserSig = reinterpret_cast<std::string*>(lParam);
+    std::string userSig = pUserSig != nullptr ? *pUserSig : std::string();
+    delete pUserSig;
+    if (!m_bWaitUserSig)
+        return LRESULT();
+    m_bWaitUserSig = false;
+    GetDlgItem(IDC_ENTER_ROOM)->EnableWindow(TRUE);
+
+    if ((int)wParam != 0 || userSig.empty())
+    {
+        MessageBoxW(L"userSig ȡʧܣǷд˺Ϣ", L"", MB_OK);
+        return LRESULT();
+    }
+    enterRoom(m_nPendingRoomId, m_pendingUserId, userSig);
+    return LRESULT();
+}
+
 LRESULT TRTCLoginViewController::OnMsgMainViewClose(WPARAM wParam, LPARAM lParam)
 {
     if (m_pTRTCMainViewController != nullptr)
@@ -1,5 +1,6 @@
 #pragma once
 #include "afxwin.h"
+#include <string>
 
 /*
 * Module:   TRTCLoginViewController
@@ -32,6 +33,7 @@ public:
 public:
     //뷿
     void joinRoom(int roomId);
+    void enterRoom(int roomId, const std::string& userId, const std::string& userSig);
     
 protected:
     virtual BOOL OnInitDialog();
@@ -41,7 +43,11 @@ protected:
 protected:
     afx_msg void OnBnClickedEnterRoom();
     afx_msg LRESULT OnMsgMainViewClose(WPARAM wParam, LPARAM lParam);
+    afx_msg LRESULT OnMsgUserSigReady(WPARAM wParam, LPARAM lParam);
 private:
     CFont newFont;
     TRTCMainViewController * m_pTRTCMainViewController = nullptr;
+    bool m_bWaitUserSig = false;    // ں̨ǩ UserSigɺ WM_CUSTOM_USERSIG_READY ֪ͨ
+    int m_nPendingRoomId = 0;
+    std::string m_pendingUserId;
 };
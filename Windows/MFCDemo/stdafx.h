@@ -49,4 +49,5 @@
 
 #define WM_CUSTOM_CLOSE_MAINVIEW (WM_USER + 1)
 #define WM_CUSTOM_CLOSE_SETTINGVIEW (WM_USER + 1)
+#define WM_CUSTOM_USERSIG_READY (WM_USER + 2)     // ̨ǩ UserSig ɣwParam Ϊ룬lParam Ϊ new  std::string*UserSigɽշ delete
 